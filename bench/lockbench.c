@@ -0,0 +1,263 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/*
+ * Measures the cost of plug-in context locking through the public API.
+ * The context lock is taken exclusively by cp_set_timings and in shared
+ * mode by cp_is_logged, so the results reflect the mutex implementation
+ * selected at configure time (for example --disable-srwlock on Windows).
+ *
+ * Usage: lockbench [iterations [max_threads]]
+ *
+ * Output is one line per measurement with tab separated fields:
+ * backend, workload, threads, total operations, nanoseconds per operation.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cpluff.h>
+
+#if !defined(CP_THREADS)
+#define LB_BACKEND "none"
+#elif defined(_WIN32)
+#include <windows.h>
+#ifdef HAVE_SRWLOCK
+#define LB_BACKEND "srwlock"
+#else
+#define LB_BACKEND "kernel"
+#endif
+#else
+#include <pthread.h>
+#define LB_BACKEND "pthread"
+#endif
+
+#if !defined(_WIN32)
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// The measured workloads
+typedef enum lb_workload_t {
+
+	/// Exclusive locking only
+	LB_EXCLUSIVE,
+
+	/// Shared locking only
+	LB_SHARED,
+
+	/// Mostly shared locking with every 16th operation exclusive
+	LB_MIXED
+
+} lb_workload_t;
+
+/// Per-thread benchmark parameters
+typedef struct lb_worker_t {
+
+	/// The context being locked
+	cp_context_t *ctx;
+
+	/// The workload
+	lb_workload_t workload;
+
+	/// The number of operations to perform
+	unsigned long iterations;
+
+} lb_worker_t;
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+static double now_ns(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER freq, count;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double) count.QuadPart * 1e9 / (double) freq.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec * 1e9 + (double) tv.tv_usec * 1e3;
+#endif
+}
+
+static void run_worker(lb_worker_t *w) {
+	unsigned long i;
+
+	switch (w->workload) {
+		case LB_EXCLUSIVE:
+			for (i = 0; i < w->iterations; i++) {
+				cp_set_timings(w->ctx, 0);
+			}
+			break;
+		case LB_SHARED:
+			for (i = 0; i < w->iterations; i++) {
+				cp_is_logged(w->ctx, CP_LOG_DEBUG);
+			}
+			break;
+		case LB_MIXED:
+			for (i = 0; i < w->iterations; i++) {
+				if ((i & 15) == 0) {
+					cp_set_timings(w->ctx, 0);
+				} else {
+					cp_is_logged(w->ctx, CP_LOG_DEBUG);
+				}
+			}
+			break;
+	}
+}
+
+#if defined(CP_THREADS) && defined(_WIN32)
+static DWORD WINAPI thread_main(LPVOID arg) {
+	run_worker(arg);
+	return 0;
+}
+#elif defined(CP_THREADS)
+static void *thread_main(void *arg) {
+	run_worker(arg);
+	return NULL;
+}
+#endif
+
+/**
+ * Runs the specified workload in the specified number of threads and
+ * returns the elapsed wall clock time in nanoseconds.
+ */
+static double run_threads(lb_worker_t *w, int num_threads) {
+	double start;
+
+	start = now_ns();
+	if (num_threads == 1) {
+		run_worker(w);
+	} else {
+#if defined(CP_THREADS) && defined(_WIN32)
+		HANDLE *threads;
+		int i;
+
+		if ((threads = malloc(num_threads * sizeof(HANDLE))) == NULL) {
+			fprintf(stderr, "lockbench: out of memory\n");
+			exit(1);
+		}
+		for (i = 0; i < num_threads; i++) {
+			if ((threads[i] = CreateThread(NULL, 0, thread_main, w, 0, NULL)) == NULL) {
+				fprintf(stderr, "lockbench: could not create a thread\n");
+				exit(1);
+			}
+		}
+		for (i = 0; i < num_threads; i++) {
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+		free(threads);
+#elif defined(CP_THREADS)
+		pthread_t *threads;
+		int i;
+
+		if ((threads = malloc(num_threads * sizeof(pthread_t))) == NULL) {
+			fprintf(stderr, "lockbench: out of memory\n");
+			exit(1);
+		}
+		for (i = 0; i < num_threads; i++) {
+			if (pthread_create(threads + i, NULL, thread_main, w)) {
+				fprintf(stderr, "lockbench: could not create a thread\n");
+				exit(1);
+			}
+		}
+		for (i = 0; i < num_threads; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		free(threads);
+#endif
+	}
+	return now_ns() - start;
+}
+
+int main(int argc, char *argv[]) {
+	static const char * const names[] = { "exclusive", "shared", "mixed" };
+	cp_context_t *ctx;
+	cp_status_t status;
+	unsigned long iterations = 1000000;
+	int max_threads = 8;
+	int workload;
+
+	if (argc > 1) {
+		iterations = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		max_threads = atoi(argv[2]);
+	}
+#if !defined(CP_THREADS)
+	max_threads = 1;
+#endif
+	if (iterations == 0 || max_threads < 1) {
+		fprintf(stderr, "Usage: %s [iterations [max_threads]]\n", argv[0]);
+		return 1;
+	}
+
+	if ((status = cp_init()) != CP_OK
+		|| (ctx = cp_create_context(&status)) == NULL) {
+		fprintf(stderr, "lockbench: could not initialize C-Pluff (status %d)\n", (int) status);
+		return 1;
+	}
+
+	printf("# backend\tworkload\tthreads\tops\tns_per_op\n");
+	for (workload = LB_EXCLUSIVE; workload <= LB_MIXED; workload++) {
+		int num_threads;
+
+		for (num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+			lb_worker_t w;
+			double elapsed;
+			unsigned long ops;
+
+			w.ctx = ctx;
+			w.workload = workload;
+			w.iterations = iterations / num_threads;
+			ops = w.iterations * num_threads;
+			elapsed = run_threads(&w, num_threads);
+			printf("%s\t%s\t%d\t%lu\t%.1f\n",
+				LB_BACKEND, names[workload], num_threads, ops, elapsed / ops);
+			fflush(stdout);
+		}
+	}
+
+	cp_destroy();
+	return 0;
+}
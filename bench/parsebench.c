@@ -0,0 +1,423 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/*
+ * Measures the throughput of plug-in descriptor parsing through
+ * cp_load_plugin_descriptor and cp_load_plugin_descriptor_from_memory.
+ * The small and medium descriptors are the minimal and maximal test
+ * descriptors. The large descriptor is the maximal test descriptor with
+ * added extensions carrying deep configuration element trees.
+ *
+ * Each descriptor is parsed from memory, from a file, from a file with
+ * the descriptor cache enabled and from memory with lazy configuration
+ * parsing. Allocations are counted through cp_set_allocator and only
+ * include memory allocated by the framework, not by the XML parser.
+ *
+ * Usage: parsebench [-i iterations] [-s seed_dir] [-d work_dir]
+ *
+ * Output is one line per measurement with tab separated fields:
+ * mode, descriptor, descriptor bytes, iterations, MB per second,
+ * descriptors per second, allocations per descriptor, peak RSS in kB.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cpluff.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <direct.h>
+#define MKDIR(d) _mkdir(d)
+#define RMDIR(d) _rmdir(d)
+#else
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#define MKDIR(d) mkdir((d), 0777)
+#define RMDIR(d) rmdir(d)
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// The number of deep extensions in the large descriptor
+#define PB_LARGE_EXTENSIONS 16
+
+/// The nesting depth of the configuration of a deep extension
+#define PB_LARGE_DEPTH 64
+
+/// The number of leaf elements at each level of a deep extension
+#define PB_LARGE_LEAVES 8
+
+/// The maximum length of generated paths
+#define PB_PATH_SIZE 1024
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// The parsing modes
+typedef enum pb_mode_t {
+
+	/// Parsing from memory
+	PB_MEMORY,
+
+	/// Parsing from a file
+	PB_FILE,
+
+	/// Parsing from a file with the descriptor cache enabled
+	PB_FILE_CACHED,
+
+	/// Parsing from memory with lazy configuration parsing
+	PB_MEMORY_LAZY
+
+} pb_mode_t;
+
+/// A benchmarked descriptor
+typedef struct pb_descriptor_t {
+
+	/// The name of the descriptor
+	const char *name;
+
+	/// The descriptor contents
+	char *data;
+
+	/// The size of the descriptor
+	size_t size;
+
+	/// The plug-in directory holding the descriptor as plugin.xml
+	char dir[PB_PATH_SIZE];
+
+} pb_descriptor_t;
+
+
+/* ------------------------------------------------------------------------
+ * Variables
+ * ----------------------------------------------------------------------*/
+
+/// The number of allocations made by the framework
+static unsigned long allocations = 0;
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+static double now_ns(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER freq, count;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double) count.QuadPart * 1e9 / (double) freq.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec * 1e9 + (double) tv.tv_usec * 1e3;
+#endif
+}
+
+/**
+ * Returns the peak resident set size of the process in kilobytes, or zero
+ * if not available.
+ */
+static long peak_rss_kb(void) {
+#if defined(_WIN32)
+	return 0;
+#else
+	struct rusage ru;
+	
+	if (getrusage(RUSAGE_SELF, &ru)) {
+		return 0;
+	}
+#if defined(__APPLE__)
+	return ru.ru_maxrss / 1024;
+#else
+	return ru.ru_maxrss;
+#endif
+#endif
+}
+
+static void fail(const char *msg, cp_status_t status) {
+	fprintf(stderr, "parsebench: %s (status %d)\n", msg, (int) status);
+	exit(1);
+}
+
+static void *count_malloc(size_t size, void *user_data) {
+	allocations++;
+	return malloc(size);
+}
+
+static void *count_realloc(void *ptr, size_t size, void *user_data) {
+	allocations++;
+	return realloc(ptr, size);
+}
+
+static void count_free(void *ptr, void *user_data) {
+	free(ptr);
+}
+
+/**
+ * Reads the specified file into memory.
+ */
+static char *read_file(const char *path, size_t *size) {
+	FILE *f;
+	char *data = NULL;
+	size_t n = 0, len = 0;
+	
+	if ((f = fopen(path, "rb")) == NULL) {
+		fprintf(stderr, "parsebench: could not open %s\n", path);
+		exit(1);
+	}
+	do {
+		if (len == n) {
+			n = (n == 0 ? 4096 : n * 2);
+			if ((data = realloc(data, n)) == NULL) {
+				fail("out of memory", CP_ERR_RESOURCE);
+			}
+		}
+		len += fread(data + len, 1, n - len, f);
+	} while (len == n);
+	fclose(f);
+	*size = len;
+	return data;
+}
+
+/**
+ * Appends formatted text to a growing buffer.
+ */
+static void append(pb_descriptor_t *d, size_t *capacity, const char *str) {
+	size_t len = strlen(str);
+	
+	while (d->size + len + 1 > *capacity) {
+		*capacity *= 2;
+		if ((d->data = realloc(d->data, *capacity)) == NULL) {
+			fail("out of memory", CP_ERR_RESOURCE);
+		}
+	}
+	memcpy(d->data + d->size, str, len + 1);
+	d->size += len;
+}
+
+/**
+ * Builds the large descriptor by adding deep extensions to the seed.
+ */
+static void make_large(pb_descriptor_t *d, const char *seed, size_t seed_size) {
+	const char *end;
+	char buf[256];
+	size_t capacity = seed_size * 4;
+	int e, l, k;
+	
+	if ((end = strstr(seed, "</plugin>")) == NULL) {
+		fail("malformed seed descriptor", CP_ERR_MALFORMED);
+	}
+	if ((d->data = malloc(capacity)) == NULL) {
+		fail("out of memory", CP_ERR_RESOURCE);
+	}
+	d->size = end - seed;
+	memcpy(d->data, seed, d->size);
+	d->data[d->size] = '\0';
+	for (e = 0; e < PB_LARGE_EXTENSIONS; e++) {
+		snprintf(buf, sizeof(buf), "\t<extension point=\"deep.extpt\" id=\"deep%d\" name=\"Deep extension %d\">\n", e, e);
+		append(d, &capacity, buf);
+		for (l = 0; l < PB_LARGE_DEPTH; l++) {
+			snprintf(buf, sizeof(buf), "<level depth=\"%d\" name=\"level %d of %d\">\n", l, l, e);
+			append(d, &capacity, buf);
+			for (k = 0; k < PB_LARGE_LEAVES; k++) {
+				snprintf(buf, sizeof(buf), "<leaf key=\"key%d\" type=\"string\">value &amp; text %d/%d</leaf>\n", k, l, k);
+				append(d, &capacity, buf);
+			}
+		}
+		for (l = 0; l < PB_LARGE_DEPTH; l++) {
+			append(d, &capacity, "</level>\n");
+		}
+		append(d, &capacity, "\t</extension>\n");
+	}
+	append(d, &capacity, end);
+}
+
+/**
+ * Writes the descriptor into a plug-in directory under the work directory.
+ */
+static void write_descriptor(pb_descriptor_t *d, const char *work_dir) {
+	char path[PB_PATH_SIZE];
+	FILE *f;
+	
+	if (snprintf(d->dir, sizeof(d->dir), "%s/parse-%s", work_dir, d->name) >= (int) sizeof(d->dir)
+		|| snprintf(path, sizeof(path), "%s/plugin.xml", d->dir) >= (int) sizeof(path)) {
+		fail("too long path", CP_ERR_RESOURCE);
+	}
+	MKDIR(d->dir);
+	if ((f = fopen(path, "wb")) == NULL
+		|| fwrite(d->data, 1, d->size, f) != d->size
+		|| fclose(f)) {
+		fprintf(stderr, "parsebench: could not write %s\n", path);
+		exit(1);
+	}
+}
+
+static void remove_descriptor(pb_descriptor_t *d) {
+	char path[PB_PATH_SIZE];
+	
+	snprintf(path, sizeof(path), "%s/plugin.xml", d->dir);
+	remove(path);
+	RMDIR(d->dir);
+}
+
+/**
+ * Parses the specified descriptor repeatedly in the specified mode and
+ * reports the results.
+ */
+static void bench_descriptor(pb_mode_t mode, pb_descriptor_t *d, unsigned long iterations, const char *work_dir) {
+	static const char * const names[] = { "memory", "file", "file_cached", "memory_lazy" };
+	char cache[PB_PATH_SIZE];
+	cp_context_t *ctx;
+	cp_status_t status;
+	unsigned long i, allocs;
+	double start, elapsed;
+	
+	if ((ctx = cp_create_context(&status)) == NULL) {
+		fail("could not create a plug-in context", status);
+	}
+	if (mode == PB_FILE_CACHED) {
+		snprintf(cache, sizeof(cache), "%s/parse-%s.cache", work_dir, d->name);
+		remove(cache);
+		if ((status = cp_set_descriptor_cache(ctx, cache)) != CP_OK) {
+			fail("could not set the descriptor cache", status);
+		}
+	}
+	cp_set_lazy_cfg(ctx, mode == PB_MEMORY_LAZY);
+	
+	allocs = allocations;
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		cp_plugin_info_t *plugin;
+		
+		if (mode == PB_FILE || mode == PB_FILE_CACHED) {
+			plugin = cp_load_plugin_descriptor(ctx, d->dir, &status);
+		} else {
+			plugin = cp_load_plugin_descriptor_from_memory(ctx, d->data, d->size, &status);
+		}
+		if (plugin == NULL) {
+			fail("could not load a descriptor", status);
+		}
+		cp_release_info(ctx, plugin);
+	}
+	elapsed = now_ns() - start;
+	allocs = allocations - allocs;
+	
+	printf("%s\t%s\t%lu\t%lu\t%.2f\t%.1f\t%.1f\t%ld\n",
+		names[mode], d->name, (unsigned long) d->size, iterations,
+		d->size * (double) iterations / elapsed * 1e3,
+		iterations / elapsed * 1e9,
+		(double) allocs / iterations,
+		peak_rss_kb());
+	fflush(stdout);
+	
+	cp_destroy_context(ctx);
+	if (mode == PB_FILE_CACHED) {
+		remove(cache);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const char *seed_dir = "../test/plugins";
+	const char *work_dir = "tmp";
+	char path[PB_PATH_SIZE];
+	pb_descriptor_t descriptors[3];
+	unsigned long iterations = 2000;
+	cp_status_t status;
+	int i, mode;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+			iterations = strtoul(argv[++i], NULL, 10);
+		} else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			seed_dir = argv[++i];
+		} else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			work_dir = argv[++i];
+		} else {
+			iterations = 0;
+		}
+	}
+	if (iterations == 0) {
+		fprintf(stderr, "Usage: %s [-i iterations] [-s seed_dir] [-d work_dir]\n", argv[0]);
+		return 1;
+	}
+	
+	// Prepare the descriptors
+	memset(descriptors, 0, sizeof(descriptors));
+	descriptors[0].name = "small";
+	snprintf(path, sizeof(path), "%s/minimal/plugin.xml", seed_dir);
+	descriptors[0].data = read_file(path, &descriptors[0].size);
+	descriptors[1].name = "medium";
+	snprintf(path, sizeof(path), "%s/maximal/plugin.xml", seed_dir);
+	descriptors[1].data = read_file(path, &descriptors[1].size);
+	descriptors[2].name = "large";
+	make_large(descriptors + 2, descriptors[1].data, descriptors[1].size);
+	MKDIR(work_dir);
+	for (i = 0; i < 3; i++) {
+		write_descriptor(descriptors + i, work_dir);
+	}
+
+	cp_set_allocator(count_malloc, count_realloc, count_free, NULL);
+	if ((status = cp_init()) != CP_OK) {
+		fail("could not initialize C-Pluff", status);
+	}
+	printf("# mode\tdescriptor\tbytes\titerations\tmb_per_s\tdescriptors_per_s\tallocs_per_descriptor\tpeak_rss_kb\n");
+	for (mode = PB_MEMORY; mode <= PB_MEMORY_LAZY; mode++) {
+		for (i = 0; i < 3; i++) {
+			unsigned long n = iterations;
+			
+			// Keep the large descriptor from dominating the run time
+			if (descriptors[i].size > 64 * 1024) {
+				n = (n + 99) / 100;
+			}
+			bench_descriptor(mode, descriptors + i, n, work_dir);
+		}
+	}
+	cp_destroy();
+	cp_set_allocator(NULL, NULL, NULL, NULL);
+
+	for (i = 0; i < 3; i++) {
+		remove_descriptor(descriptors + i);
+		free(descriptors[i].data);
+	}
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/*
+ * Plug-in runtime used by scalebench for measuring symbol resolution. It
+ * defines a context specific symbol when started and exports a static
+ * symbol through its symbol table.
+ */
+
+#include <stdlib.h>
+#include <cpluff.h>
+
+typedef struct plugin_data_t plugin_data_t;
+
+struct plugin_data_t {
+	cp_context_t *ctx;
+	int value;
+};
+
+static void *create(cp_context_t *ctx) {
+	plugin_data_t *data = malloc(sizeof(plugin_data_t));
+
+	if (data != NULL) {
+		data->ctx = ctx;
+		data->value = 0;
+	}
+	return data;
+}
+
+static int start(void *d) {
+	plugin_data_t *data = d;
+	
+	return cp_define_symbol(data->ctx, "benchrt_defined", &data->value);
+}
+
+static void destroy(void *d) {
+	free(d);
+}
+
+CP_EXPORT cp_plugin_runtime_t benchrt_runtime = {
+	create,
+	start,
+	NULL,
+	destroy
+};
+
+static const int exported_value = 1;
+
+static const cp_symbol_export_t benchrt_exports[] = {
+	{ "benchrt_exported", (void *) &exported_value }
+};
+
+CP_EXPORT cp_symbol_table_t benchrt_symbols = {
+	CP_SYMBOL_TABLE_VERSION,
+	sizeof(benchrt_exports) / sizeof(benchrt_exports[0]),
+	benchrt_exports
+};
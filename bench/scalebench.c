@@ -0,0 +1,501 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/*
+ * Measures how the plug-in framework scales with the number of plug-ins.
+ * For each requested size a synthetic plug-in collection is generated with
+ * imports forming a directed acyclic graph, an extension point in every
+ * tenth plug-in, two extensions per plug-in and nested configuration. The
+ * benchmark then measures scanning the collection, querying the extensions
+ * of every extension point, starting all plug-ins, resolving symbols from
+ * several threads and destroying the context.
+ *
+ * Symbol resolution needs the benchrt plug-in collection installed by
+ * "make bench". The symbol workloads are skipped if it is not found.
+ *
+ * Usage: scalebench [-i iterations] [-t max_threads] [-r runtime_dir]
+ *                   [-d work_dir] [sizes...]
+ *
+ * Output is one line per measurement with tab separated fields:
+ * benchmark, plug-ins, threads, total operations, nanoseconds per operation.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cpluff.h>
+
+#if !defined(CP_THREADS)
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(_WIN32)
+#include <direct.h>
+#define MKDIR(d) _mkdir(d)
+#define RMDIR(d) _rmdir(d)
+#else
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#define MKDIR(d) mkdir((d), 0777)
+#define RMDIR(d) rmdir(d)
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Every this many plug-ins one defines an extension point
+#define SB_EXT_POINT_INTERVAL 10
+
+/// The number of extensions contributed by each plug-in
+#define SB_EXTENSIONS 2
+
+/// The maximum number of imports of a plug-in
+#define SB_MAX_IMPORTS 3
+
+/// The maximum length of generated paths
+#define SB_PATH_SIZE 1024
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// Per-thread symbol resolution parameters
+typedef struct sb_worker_t {
+
+	/// The plug-in context
+	cp_context_t *ctx;
+
+	/// The name of the resolved symbol
+	const char *symbol;
+
+	/// The number of operations to perform
+	unsigned long iterations;
+
+	/// The number of failed resolutions
+	unsigned long failures;
+
+} sb_worker_t;
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+static double now_ns(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER freq, count;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double) count.QuadPart * 1e9 / (double) freq.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec * 1e9 + (double) tv.tv_usec * 1e3;
+#endif
+}
+
+static void report(const char *benchmark, int num_plugins, int num_threads, unsigned long ops, double elapsed) {
+	printf("%s\t%d\t%d\t%lu\t%.1f\n",
+		benchmark, num_plugins, num_threads, ops, ops > 0 ? elapsed / ops : 0.0);
+	fflush(stdout);
+}
+
+static void fail(const char *msg, cp_status_t status) {
+	fprintf(stderr, "scalebench: %s (status %d)\n", msg, (int) status);
+	exit(1);
+}
+
+/**
+ * Formats the path of a file or the directory of a synthetic plug-in.
+ */
+static void plugin_path(char *path, const char *dir, int k, const char *file) {
+	if (snprintf(path, SB_PATH_SIZE, "%s/bench.p%d%s", dir, k, file) >= SB_PATH_SIZE) {
+		fail("too long path", CP_ERR_RESOURCE);
+	}
+}
+
+/**
+ * Returns the plug-ins imported by the specified plug-in. The imports
+ * always refer to plug-ins with a lower index so that they form a directed
+ * acyclic graph of logarithmic depth.
+ */
+static int get_imports(int k, int *imports) {
+	int n = 0, i, j;
+	
+	if (k == 0) {
+		return 0;
+	}
+	imports[n++] = (k - 1) / 2;
+	for (i = 1; i < SB_MAX_IMPORTS; i++) {
+		int target = (int) ((k * 2654435761UL + i * 40503UL) % k);
+		int dup = 0;
+		
+		for (j = 0; j < n && !dup; j++) {
+			dup = (imports[j] == target);
+		}
+		if (!dup) {
+			imports[n++] = target;
+		}
+	}
+	return n;
+}
+
+/**
+ * Writes the descriptor of the specified synthetic plug-in.
+ */
+static int write_descriptor(FILE *f, int k, int num_plugins, int import_runtime) {
+	int imports[SB_MAX_IMPORTS];
+	int num_imports, num_ext_points, i, j, l;
+	
+	num_imports = get_imports(k, imports);
+	num_ext_points = (num_plugins + SB_EXT_POINT_INTERVAL - 1) / SB_EXT_POINT_INTERVAL;
+	fprintf(f, "<?xml version=\"1.0\"?>\n");
+	fprintf(f, "<plugin id=\"bench.p%d\" name=\"Benchmark plug-in %d\" version=\"1.0.%d\" provider-name=\"C-Pluff benchmarks\">\n", k, k, k);
+	if (num_imports > 0 || import_runtime) {
+		fprintf(f, "\t<requires>\n");
+		for (i = 0; i < num_imports; i++) {
+			fprintf(f, "\t\t<import plugin=\"bench.p%d\"/>\n", imports[i]);
+		}
+		if (import_runtime) {
+			fprintf(f, "\t\t<import plugin=\"benchrt\"/>\n");
+		}
+		fprintf(f, "\t</requires>\n");
+	}
+	if (k % SB_EXT_POINT_INTERVAL == 0) {
+		fprintf(f, "\t<extension-point id=\"ep\" name=\"Extension point %d\"/>\n", k);
+	}
+	for (i = 0; i < SB_EXTENSIONS; i++) {
+		int ep = (int) ((k * 31UL + i * 17UL) % num_ext_points) * SB_EXT_POINT_INTERVAL;
+		
+		fprintf(f, "\t<extension point=\"bench.p%d.ep\" id=\"ext%d\" name=\"Extension %d of plug-in %d\">\n", ep, i, i, k);
+		fprintf(f, "\t\t<settings priority=\"%d\">\n", (k + i) % 100);
+		for (j = 0; j < 2; j++) {
+			fprintf(f, "\t\t\t<group name=\"group%d\">\n", j);
+			for (l = 0; l < 3; l++) {
+				fprintf(f, "\t\t\t\t<item key=\"key%d\" type=\"string\">value %d/%d/%d</item>\n", l, k, j, l);
+			}
+			fprintf(f, "\t\t\t</group>\n");
+		}
+		fprintf(f, "\t\t</settings>\n");
+		fprintf(f, "\t</extension>\n");
+	}
+	fprintf(f, "</plugin>\n");
+	return ferror(f) ? -1 : 0;
+}
+
+/**
+ * Generates a collection of the specified number of synthetic plug-ins
+ * into the specified directory.
+ */
+static void generate_collection(const char *dir, int num_plugins, int import_runtime) {
+	char path[SB_PATH_SIZE];
+	int k;
+	
+	MKDIR(dir);
+	for (k = 0; k < num_plugins; k++) {
+		FILE *f;
+		
+		plugin_path(path, dir, k, "");
+		MKDIR(path);
+		plugin_path(path, dir, k, "/plugin.xml");
+		if ((f = fopen(path, "w")) == NULL
+			|| write_descriptor(f, k, num_plugins, import_runtime && k == 0)) {
+			fprintf(stderr, "scalebench: could not write %s\n", path);
+			exit(1);
+		}
+		fclose(f);
+	}
+}
+
+/**
+ * Removes a collection generated by ::generate_collection.
+ */
+static void remove_collection(const char *dir, int num_plugins) {
+	char path[SB_PATH_SIZE];
+	int k;
+	
+	for (k = 0; k < num_plugins; k++) {
+		plugin_path(path, dir, k, "/plugin.xml");
+		remove(path);
+		plugin_path(path, dir, k, "");
+		RMDIR(path);
+	}
+	RMDIR(dir);
+}
+
+static void run_worker(sb_worker_t *w) {
+	unsigned long i;
+	
+	for (i = 0; i < w->iterations; i++) {
+		void *ptr;
+		
+		if ((ptr = cp_resolve_symbol(w->ctx, "benchrt", w->symbol, NULL)) != NULL) {
+			cp_release_symbol(w->ctx, ptr);
+		} else {
+			w->failures++;
+		}
+	}
+}
+
+#if defined(CP_THREADS) && defined(_WIN32)
+static DWORD WINAPI thread_main(LPVOID arg) {
+	run_worker(arg);
+	return 0;
+}
+#elif defined(CP_THREADS)
+static void *thread_main(void *arg) {
+	run_worker(arg);
+	return NULL;
+}
+#endif
+
+/**
+ * Resolves the specified symbol in the specified number of threads and
+ * returns the elapsed wall clock time in nanoseconds.
+ */
+static double run_threads(sb_worker_t *workers, int num_threads) {
+	double start;
+
+	start = now_ns();
+	if (num_threads == 1) {
+		run_worker(workers);
+	} else {
+#if defined(CP_THREADS) && defined(_WIN32)
+		HANDLE *threads;
+		int i;
+
+		if ((threads = malloc(num_threads * sizeof(HANDLE))) == NULL) {
+			fail("out of memory", CP_ERR_RESOURCE);
+		}
+		for (i = 0; i < num_threads; i++) {
+			if ((threads[i] = CreateThread(NULL, 0, thread_main, workers + i, 0, NULL)) == NULL) {
+				fail("could not create a thread", CP_ERR_RESOURCE);
+			}
+		}
+		for (i = 0; i < num_threads; i++) {
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+		free(threads);
+#elif defined(CP_THREADS)
+		pthread_t *threads;
+		int i;
+
+		if ((threads = malloc(num_threads * sizeof(pthread_t))) == NULL) {
+			fail("out of memory", CP_ERR_RESOURCE);
+		}
+		for (i = 0; i < num_threads; i++) {
+			if (pthread_create(threads + i, NULL, thread_main, workers + i)) {
+				fail("could not create a thread", CP_ERR_RESOURCE);
+			}
+		}
+		for (i = 0; i < num_threads; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		free(threads);
+#endif
+	}
+	return now_ns() - start;
+}
+
+/**
+ * Measures symbol resolution throughput for the specified symbol with
+ * increasing numbers of threads.
+ */
+static void bench_symbol(cp_context_t *ctx, const char *benchmark, const char *symbol, int num_plugins, unsigned long iterations, int max_threads) {
+	sb_worker_t *workers;
+	int num_threads;
+	
+	if ((workers = malloc(max_threads * sizeof(sb_worker_t))) == NULL) {
+		fail("out of memory", CP_ERR_RESOURCE);
+	}
+	for (num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+		unsigned long failures = 0;
+		double elapsed;
+		int i;
+		
+		for (i = 0; i < num_threads; i++) {
+			workers[i].ctx = ctx;
+			workers[i].symbol = symbol;
+			workers[i].iterations = iterations / num_threads;
+			workers[i].failures = 0;
+		}
+		elapsed = run_threads(workers, num_threads);
+		for (i = 0; i < num_threads; i++) {
+			failures += workers[i].failures;
+		}
+		if (failures > 0) {
+			fail("could not resolve a symbol", CP_ERR_UNKNOWN);
+		}
+		report(benchmark, num_plugins, num_threads, workers[0].iterations * num_threads, elapsed);
+	}
+	free(workers);
+}
+
+/**
+ * Runs all measurements for a collection of the specified size.
+ */
+static void bench_size(int num_plugins, unsigned long iterations, int max_threads, const char *runtime_dir, const char *work_dir) {
+	char dir[SB_PATH_SIZE];
+	char id[64];
+	cp_context_t *ctx;
+	cp_status_t status;
+	double start;
+	unsigned long i, ops;
+	int num_ext_points, k;
+	
+	snprintf(dir, sizeof(dir), "%s/scale-%d", work_dir, num_plugins);
+	generate_collection(dir, num_plugins, runtime_dir != NULL);
+	
+	// Scanning
+	start = now_ns();
+	if ((ctx = cp_create_context(&status)) == NULL
+		|| (status = cp_register_pcollection(ctx, dir)) != CP_OK
+		|| (runtime_dir != NULL && (status = cp_register_pcollection(ctx, runtime_dir)) != CP_OK)
+		|| (status = cp_scan_plugins(ctx, 0)) != CP_OK) {
+		fail("could not scan the plug-ins", status);
+	}
+	report("scan", num_plugins, 1, num_plugins, now_ns() - start);
+	
+	// Extension queries
+	num_ext_points = (num_plugins + SB_EXT_POINT_INTERVAL - 1) / SB_EXT_POINT_INTERVAL;
+	ops = (iterations < (unsigned long) num_ext_points ? (unsigned long) num_ext_points : iterations);
+	start = now_ns();
+	for (i = 0; i < ops; i++) {
+		cp_extension_t **exts;
+		int num;
+		
+		snprintf(id, sizeof(id), "bench.p%lu.ep", (i % num_ext_points) * SB_EXT_POINT_INTERVAL);
+		if ((exts = cp_get_extensions_info(ctx, id, &status, &num)) == NULL) {
+			fail("could not get extensions", status);
+		}
+		cp_release_info(ctx, exts);
+	}
+	report("extensions_info", num_plugins, 1, ops, now_ns() - start);
+	
+	// Starting every plug-in, most of them already started as imports
+	start = now_ns();
+	for (k = num_plugins - 1; k >= 0; k--) {
+		snprintf(id, sizeof(id), "bench.p%d", k);
+		if ((status = cp_start_plugin(ctx, id)) != CP_OK) {
+			fail("could not start a plug-in", status);
+		}
+	}
+	report("start_all", num_plugins, 1, num_plugins, now_ns() - start);
+	
+	// Symbol resolution
+	if (runtime_dir != NULL) {
+		bench_symbol(ctx, "resolve_defined", "benchrt_defined", num_plugins, iterations, max_threads);
+		bench_symbol(ctx, "resolve_exported", "benchrt_exported", num_plugins, iterations, max_threads);
+	}
+	
+	// Teardown
+	start = now_ns();
+	cp_destroy_context(ctx);
+	report("destroy", num_plugins, 1, num_plugins, now_ns() - start);
+	
+	remove_collection(dir, num_plugins);
+}
+
+int main(int argc, char *argv[]) {
+	static const int default_sizes[] = { 100, 1000, 10000 };
+	const char *runtime_dir = "tmp/runtime";
+	const char *work_dir = "tmp";
+	char path[SB_PATH_SIZE];
+	unsigned long iterations = 100000;
+	int max_threads = 8;
+	int *sizes = NULL;
+	int num_sizes = 0;
+	cp_status_t status;
+	FILE *f;
+	int i;
+
+	if ((sizes = malloc((argc + 3) * sizeof(int))) == NULL) {
+		fail("out of memory", CP_ERR_RESOURCE);
+	}
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+			iterations = strtoul(argv[++i], NULL, 10);
+		} else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			max_threads = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			runtime_dir = argv[++i];
+		} else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			work_dir = argv[++i];
+		} else if ((sizes[num_sizes++] = atoi(argv[i])) <= 0) {
+			iterations = 0;
+		}
+	}
+#if !defined(CP_THREADS)
+	max_threads = 1;
+#endif
+	if (iterations == 0 || max_threads < 1) {
+		fprintf(stderr, "Usage: %s [-i iterations] [-t max_threads] [-r runtime_dir] [-d work_dir] [sizes...]\n", argv[0]);
+		return 1;
+	}
+	if (num_sizes == 0) {
+		memcpy(sizes, default_sizes, sizeof(default_sizes));
+		num_sizes = sizeof(default_sizes) / sizeof(default_sizes[0]);
+	}
+	
+	// Check for the runtime plug-in collection
+	snprintf(path, sizeof(path), "%s/benchrt/plugin.xml", runtime_dir);
+	if ((f = fopen(path, "r")) != NULL) {
+		fclose(f);
+	} else {
+		fprintf(stderr, "scalebench: %s not found, skipping symbol resolution\n", path);
+		runtime_dir = NULL;
+	}
+
+	if ((status = cp_init()) != CP_OK) {
+		fail("could not initialize C-Pluff", status);
+	}
+	MKDIR(work_dir);
+	printf("# benchmark\tplugins\tthreads\tops\tns_per_op\n");
+	for (i = 0; i < num_sizes; i++) {
+		bench_size(sizes[i], iterations, max_threads, runtime_dir, work_dir);
+	}
+
+	cp_destroy();
+	free(sizes);
+	return 0;
+}
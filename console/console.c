@@ -35,6 +35,12 @@
 #include <locale.h>
 #endif
 #include <assert.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
 #include <cpluff.h>
 #include "console.h"
 
@@ -53,6 +59,9 @@ static void cmd_load_plugin(int argc, char *argv[]);
 static void cmd_scan_plugins(int argc, char *argv[]);
 static void cmd_list_plugins(int argc, char *argv[]);
 static void cmd_show_plugin_info(int argc, char *argv[]);
+static void cmd_show_memory_stats(int argc, char *argv[]);
+static void cmd_stats(int argc, char *argv[]);
+static void cmd_profile(int argc, char *argv[]);
 static void cmd_list_ext_points(int argc, char *argv[]);
 static void cmd_list_extensions(int argc, char *argv[]);
 static void cmd_set_context_args(int argc, char *argv[]);
@@ -93,6 +102,9 @@ CP_HIDDEN const command_info_t commands[] = {
 	{ "list-ext-points", N_("lists the installed extension points"), cmd_list_ext_points, CPC_COMPL_NONE },
 	{ "list-extensions", N_("lists the installed extensions"), cmd_list_extensions, CPC_COMPL_NONE },
 	{ "show-plugin-info", N_("shows static plug-in information"), cmd_show_plugin_info, CPC_COMPL_PLUGIN },
+	{ "show-memory-stats", N_("shows the memory used by a plug-in or by all plug-ins"), cmd_show_memory_stats, CPC_COMPL_PLUGIN },
+	{ "stats", N_("shows registry sizes and other framework statistics"), cmd_stats, CPC_COMPL_NONE },
+	{ "profile", N_("runs a command and shows the time it took"), cmd_profile, CPC_COMPL_COMMAND },
 	{ "quit", N_("quits the program"), cmd_exit, CPC_COMPL_NONE },
 	{ "exit", N_("quits the program"), cmd_exit, CPC_COMPL_NONE },
 	{ NULL, NULL, NULL, CPC_COMPL_NONE }
@@ -158,6 +170,51 @@ static int cmdline_parse(char *cmdline, char **argv[]) {
 	}
 }
 
+/**
+ * Runs the specified parsed command line.
+ * 
+ * @param argc the number of command line elements
+ * @param argv the command and its arguments
+ */
+static void run_command(int argc, char *argv[]) {
+	int i;
+	
+	for (i = 0; commands[i].name != NULL; i++) {
+		if (!strcmp(argv[0], commands[i].name)) {
+			commands[i].implementation(argc, argv);
+			break;
+		}
+	}
+	if (commands[i].name == NULL) {
+		printf(_("Unknown command %s.\n"), argv[0]);
+	}
+}
+
+/**
+ * Returns the current time of a monotonic clock in nanoseconds.
+ * 
+ * @return the current time
+ */
+static double now_ns(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER freq, count;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double) count.QuadPart * 1e9 / (double) freq.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec * 1e9 + (double) tv.tv_usec * 1e3;
+#endif
+}
+
 static void cmd_exit(int argc, char *argv[]) {
 	
 	// Uninitialize input
@@ -641,9 +698,13 @@ static void cmd_show_plugin_info(int argc, char *argv[]) {
 			fputs("  imports = {},\n", stdout);
 		}
 		printf("  runtime_lib_name = %s,\n"
-			"  runtime_funcs_symbol = %s,\n",
+			"  runtime_funcs_symbol = %s,\n"
+			"  runtime_symbols_symbol = %s,\n"
+			"  lazy_activation = %d,\n",
 			str_or_null(plugin->runtime_lib_name),
-			str_or_null(plugin->runtime_funcs_symbol));
+			str_or_null(plugin->runtime_funcs_symbol),
+			str_or_null(plugin->runtime_symbols_symbol),
+			plugin->lazy_activation);
 		if (plugin->num_ext_points) {
 			fputs("  ext_points = {{\n", stdout);
 			for (i = 0; i < plugin->num_ext_points; i++) {
@@ -672,6 +733,177 @@ static void cmd_show_plugin_info(int argc, char *argv[]) {
 	}
 }
 
+static void cmd_show_memory_stats(int argc, char *argv[]) {
+	cp_memory_stats_t stats;
+	cp_status_t status;
+	
+	if (argc > 2) {
+		/* TRANSLATORS: Usage instructions for showing memory usage */
+		printf(_("Usage: %s [<plugin>]\n"), argv[0]);
+	} else if ((status = cp_get_memory_stats(context, argc == 2 ? argv[1] : NULL, &stats)) != CP_OK) {
+		api_failed("cp_get_memory_stats", status);
+	} else {
+		const char format[] = "  %-20s %10lu %10lu\n";
+		
+		if (argc == 2) {
+			printf(_("Memory used by plug-in %s:\n"), argv[1]);
+		} else {
+			fputs(_("Memory used by the plug-in environment:\n"), stdout);
+		}
+		printf("  %-20s %10s %10s\n", _("CATEGORY"), _("OBJECTS"), _("BYTES"));
+		printf(format, _("descriptors"), stats.descriptor_objects, stats.descriptor_bytes);
+		printf(format, _("configuration"), stats.cfg_elements, stats.cfg_bytes);
+		printf(format, _("contexts"), stats.contexts, stats.context_bytes);
+		printf(format, _("defined symbols"), stats.defined_symbols, stats.defined_symbol_bytes);
+		printf(format, _("resolved symbols"), stats.resolved_symbols, stats.resolved_symbol_bytes);
+		printf(format, _("listeners"), stats.listeners, stats.listener_bytes);
+		printf(format, _("loggers"), stats.loggers, stats.logger_bytes);
+		printf(format, _("run functions"), stats.run_funcs, stats.run_func_bytes);
+		printf("  %-20s %10s %10lu\n", _("total"), "", stats.total_bytes);
+	}
+}
+
+/**
+ * Prints the lock contention statistics and the API functions that held
+ * the plug-in environment lock longest.
+ */
+static void print_lock_stats(void) {
+	cp_lock_stats_t lstats;
+	cp_lock_holder_stats_t *holders;
+	cp_status_t status;
+	const char format[] = "  %-22s %10lu\n";
+	const char time_format[] = "  %-22s %10.3f\n";
+	int i, n;
+	
+	cp_get_lock_stats(context, &lstats);
+	fputs(_("Lock:\n"), stdout);
+	printf(format, _("acquisitions"), lstats.acquisitions);
+	printf(format, _("contended"), lstats.contended);
+	printf(time_format, _("total wait (ms)"), lstats.wait_total / 1e6);
+	printf(time_format, _("max wait (ms)"), lstats.wait_max / 1e6);
+	printf(time_format, _("total hold (ms)"), lstats.hold_total / 1e6);
+	printf(time_format, _("max hold (ms)"), lstats.hold_max / 1e6);
+	if ((holders = cp_get_lock_holder_stats(context, &status, &n)) == NULL) {
+		api_failed("cp_get_lock_holder_stats", status);
+		return;
+	}
+	if (n > 0) {
+		fputs(_("Lock holders:\n"), stdout);
+		printf("  %-32s %8s %12s %12s\n", _("FUNCTION"), _("HOLDS"), _("TOTAL (ms)"), _("MAX (ms)"));
+		for (i = 0; i < n && i < 10; i++) {
+			printf("  %-32s %8lu %12.3f %12.3f\n",
+				holders[i].function != NULL ? holders[i].function : _("(internal)"),
+				holders[i].holds, holders[i].hold_total / 1e6, holders[i].hold_max / 1e6);
+		}
+	}
+	cp_release_info(context, holders);
+}
+
+static void cmd_stats(int argc, char *argv[]) {
+	cp_registry_stats_t rstats;
+	cp_memory_stats_t mstats;
+	cp_status_t status;
+	
+	if (argc != 1) {
+		/* TRANSLATORS: Usage instructions for showing framework statistics */
+		printf(_("Usage: %s\n"), argv[0]);
+	} else if ((status = cp_get_memory_stats(context, NULL, &mstats)) != CP_OK) {
+		api_failed("cp_get_memory_stats", status);
+	} else {
+		const char table_format[] = "  %-22s %10lu %10lu %6.2f\n";
+		const char format[] = "  %-22s %10lu\n";
+		
+		cp_get_registry_stats(context, &rstats);
+		fputs(_("Registry tables:\n"), stdout);
+		printf("  %-22s %10s %10s %6s\n", _("TABLE"), _("ENTRIES"), _("SLOTS"), _("LOAD"));
+		printf(table_format, _("plug-ins"), rstats.plugins, rstats.plugin_slots,
+			rstats.plugin_slots > 0 ? (double) rstats.plugins / rstats.plugin_slots : 0.0);
+		printf(table_format, _("extension points"), rstats.ext_points, rstats.ext_point_slots,
+			rstats.ext_point_slots > 0 ? (double) rstats.ext_points / rstats.ext_point_slots : 0.0);
+		printf(table_format, _("extension lists"), rstats.extension_lists, rstats.extension_list_slots,
+			rstats.extension_list_slots > 0 ? (double) rstats.extension_lists / rstats.extension_list_slots : 0.0);
+		printf(table_format, _("information objects"), rstats.infos, rstats.info_slots,
+			rstats.info_slots > 0 ? (double) rstats.infos / rstats.info_slots : 0.0);
+		fputs(_("Counters:\n"), stdout);
+		printf(format, _("extensions"), rstats.extensions);
+		printf(format, _("extension indexes"), rstats.extension_indexes);
+		printf(format, _("interned strings"), rstats.interned_strings);
+		printf(format, _("started plug-ins"), rstats.started_plugins);
+		printf(format, _("run functions"), rstats.run_funcs);
+		printf(format, _("queued run functions"), rstats.queued_run_funcs);
+		printf(format, _("defined symbols"), mstats.defined_symbols);
+		printf(format, _("resolved symbols"), mstats.resolved_symbols);
+		printf(format, _("listeners"), mstats.listeners);
+		printf(format, _("loggers"), mstats.loggers);
+		printf(format, _("registry generation"), (unsigned long) rstats.generation);
+		print_lock_stats();
+	}
+}
+
+static void cmd_profile(int argc, char *argv[]) {
+	if (argc < 2) {
+		/* TRANSLATORS: Usage instructions for profiling a command */
+		printf(_("Usage: %s <command> [<argument>...]\n"), argv[0]);
+	} else if (!strcmp(argv[1], argv[0])) {
+		printf(_("Command %s can not be profiled.\n"), argv[1]);
+	} else {
+		cp_timings_summary_t before, after;
+		const char format[] = "  %-12s %12.3f %6.1f%%\n";
+		double start, elapsed;
+		
+		// Record the plug-in lifecycle phases while running the command
+		cp_get_timings_summary(context, &before);
+		cp_set_timings(context, 1);
+		start = now_ns();
+		run_command(argc - 1, argv + 1);
+		elapsed = now_ns() - start;
+		cp_set_timings(context, 0);
+		cp_get_timings_summary(context, &after);
+		
+		printf(_("Command %s took %.3f ms.\n"), argv[1], elapsed / 1e6);
+		if (elapsed <= 0) {
+			elapsed = 1;
+		}
+		printf("  %-12s %12s %7s\n", _("PHASE"), _("TIME (ms)"), _("SHARE"));
+		printf(format, _("parse"), (after.parse_total - before.parse_total) / 1e6,
+			(after.parse_total - before.parse_total) * 100.0 / elapsed);
+		printf(format, _("resolve"), (after.resolve_total - before.resolve_total) / 1e6,
+			(after.resolve_total - before.resolve_total) * 100.0 / elapsed);
+		printf(format, _("load"), (after.load_total - before.load_total) / 1e6,
+			(after.load_total - before.load_total) * 100.0 / elapsed);
+		printf(format, _("create"), (after.create_total - before.create_total) / 1e6,
+			(after.create_total - before.create_total) * 100.0 / elapsed);
+		printf(format, _("start"), (after.start_total - before.start_total) / 1e6,
+			(after.start_total - before.start_total) * 100.0 / elapsed);
+		fputs(_("Phases of nested plug-in operations overlap, so the shares may exceed 100%.\n"), stdout);
+	}
+}
+
+/*
+ * Orders extension points by identifier for listing.
+ */
+static int comp_ext_points(const void *a, const void *b) {
+	const cp_ext_point_t *ep1 = *(const cp_ext_point_t * const *) a;
+	const cp_ext_point_t *ep2 = *(const cp_ext_point_t * const *) b;
+	
+	return strcmp(ep1->identifier, ep2->identifier);
+}
+
+/*
+ * Orders extensions by plug-in identifier and then in declaration order
+ * for listing, as anonymous extensions have no identifier of their own.
+ */
+static int comp_extensions(const void *a, const void *b) {
+	const cp_extension_t *e1 = *(const cp_extension_t * const *) a;
+	const cp_extension_t *e2 = *(const cp_extension_t * const *) b;
+	int c;
+	
+	if ((c = strcmp(e1->plugin->identifier, e2->plugin->identifier)) != 0) {
+		return c;
+	}
+	return (e1 > e2) - (e1 < e2);
+}
+
 static void cmd_list_ext_points(int argc, char *argv[]) {
 	cp_ext_point_t **ext_points;
 	cp_status_t status;
@@ -688,6 +920,8 @@ static void cmd_list_ext_points(int argc, char *argv[]) {
 		printf(format,
 			_("IDENTIFIER"),
 			_("NAME"));
+		for (i = 0; ext_points[i] != NULL; i++);
+		qsort(ext_points, i, sizeof(cp_ext_point_t *), comp_ext_points);
 		for (i = 0; ext_points[i] != NULL; i++) {
 			printf(format,
 				ext_points[i]->identifier,
@@ -713,6 +947,8 @@ static void cmd_list_extensions(int argc, char *argv[]) {
 		printf(format,
 			_("IDENTIFIER"),
 			_("NAME"));
+		for (i = 0; extensions[i] != NULL; i++);
+		qsort(extensions, i, sizeof(cp_extension_t *), comp_extensions);
 		for (i = 0; extensions[i] != NULL; i++) {
 			if (extensions[i]->identifier == NULL) {
 				char buffer[128];
@@ -852,7 +1088,6 @@ static void cmd_uninstall_plugins(int argc, char *argv[]) {
 
 int main(int argc, char *argv[]) {
 	char *prompt;
-	int i;
 	cp_status_t status;
 
 	// Set locale
@@ -888,6 +1123,9 @@ int main(int argc, char *argv[]) {
 		exit(1);
 	}
 
+	// Collect lock statistics for the stats command
+	cp_set_lock_stats(context, 1);
+
 	// Initialize logging
 	cp_register_logger(context, logger, NULL, log_levels[1].level);
 	printf(_("Using display log level %s (%s).\n"), log_levels[1].name, _(log_levels[1].description));
@@ -917,15 +1155,7 @@ int main(int argc, char *argv[]) {
 			continue;
 		}
 		
-		// Choose command 
-		for (i = 0; commands[i].name != NULL; i++) {
-			if (!strcmp(argv[0], commands[i].name)) {
-				commands[i].implementation(argc, argv);
-				break;
-			}
-		}
-		if (commands[i].name == NULL) {
-			printf(_("Unknown command %s.\n"), argv[0]);
-		}
+		// Run command 
+		run_command(argc, argv);
 	}
 }
@@ -71,6 +71,9 @@ typedef enum arg_compl_t {
 	/// Use plug-in identifier completion
 	CPC_COMPL_PLUGIN,
 	
+	/// Use command name completion
+	CPC_COMPL_COMMAND,
+	
 } arg_compl_t;
 
 /// Type for command implementations 
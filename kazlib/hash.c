@@ -22,6 +22,9 @@
  * Modified by Johannes Lehtinen in 2006-2007.
  * Included the definition of CP_HIDDEN macro and used it in declarations and
  * definitions to hide Kazlib symbols when building a shared C-Pluff library.
+ * Added hash_reserve for growing a dynamic table ahead of bulk insertion.
+ * Memory is allocated using the C-Pluff allocator and nodes using its
+ * small object pools.
  */
 
 #include <stdlib.h>
@@ -30,6 +33,7 @@
 #include <string.h>
 #define HASH_IMPLEMENTATION
 #include "hash.h"
+#include "../libcpluff/util.h"
 
 #ifdef KAZLIB_RCSID
 static const char rcsid[] = "$Id: hash.c,v 1.36.2.11 2000/11/13 01:36:45 kaz Exp $";
@@ -165,7 +169,7 @@ static void grow_table(hash_t *hash)
 
     assert (2 * hash->nchains > hash->nchains);	/* 1 */
 
-    newtable = realloc(hash->table,
+    newtable = cpi_realloc(hash->table,
 	    sizeof *newtable * hash->nchains * 2);	/* 4 */
 
     if (newtable) {	/* 5 */
@@ -253,7 +257,7 @@ static void shrink_table(hash_t *hash)
 	else
 	    assert (hash->table[chain] == NULL);	/* 6 */
     }
-    newtable = realloc(hash->table,
+    newtable = cpi_realloc(hash->table,
 	    sizeof *newtable * nchains);		/* 7 */
     if (newtable)					/* 8 */
 	hash->table = newtable;
@@ -302,10 +306,10 @@ CP_HIDDEN hash_t *hash_create(hashcount_t maxcount, hash_comp_t compfun,
     if (hash_val_t_bit == 0)	/* 1 */
 	compute_bits();
 
-    hash = malloc(sizeof *hash);	/* 2 */
+    hash = cpi_malloc(sizeof *hash);	/* 2 */
 
     if (hash) {		/* 3 */
-	hash->table = malloc(sizeof *hash->table * INIT_SIZE);	/* 4 */
+	hash->table = cpi_malloc(sizeof *hash->table * INIT_SIZE);	/* 4 */
 	if (hash->table) {	/* 5 */
 	    hash->nchains = INIT_SIZE;		/* 6 */
 	    hash->highmark = INIT_SIZE * 2;
@@ -323,7 +327,7 @@ CP_HIDDEN hash_t *hash_create(hashcount_t maxcount, hash_comp_t compfun,
 	    assert (hash_verify(hash));
 	    return hash;
 	} 
-	free(hash);
+	cpi_free(hash);
     }
 
     return NULL;
@@ -384,8 +388,8 @@ CP_HIDDEN void hash_destroy(hash_t *hash)
 {
     assert (hash_val_t_bit != 0);
     assert (hash_isempty(hash));
-    free(hash->table);
-    free(hash);
+    cpi_free(hash->table);
+    cpi_free(hash);
 }
 
 /*
@@ -545,6 +549,30 @@ CP_HIDDEN void hash_insert(hash_t *hash, hnode_t *node, const void *key)
     assert (hash_verify(hash));
 }
 
+/*
+ * Prepare a dynamic table for the insertion of the given number of nodes.
+ * Notes:
+ * 1. Static tables are left untouched.
+ * 2. Grow the table until the nodes fit below the high mark, so that the
+ *    insertions do not have to grow it one step at a time. Stop if growing
+ *    fails; the insertions will then try again.
+ */
+
+CP_HIDDEN void hash_reserve(hash_t *hash, hashcount_t count)
+{
+    if (!hash->dynamic)		/* 1 */
+	return;
+
+    while (hash->nodecount + count > hash->highmark
+	    && 2 * hash->nchains > hash->nchains) {	/* 2 */
+	hashcount_t old_nchains = hash->nchains;
+
+	grow_table(hash);
+	if (hash->nchains == old_nchains)
+	    break;
+    }
+}
+
 /*
  * Find a node in the hash table and return a pointer to it.
  * Notes:
@@ -575,6 +603,31 @@ CP_HIDDEN hnode_t *hash_lookup(hash_t *hash, const void *key)
     return NULL;
 }
 
+/*
+ * Find a node in the hash table using a precomputed hash value of the key.
+ * The hash value must have been computed using the hashing function of the
+ * table, for example hash_fun_string() for tables using the default one.
+ * Keys are compared by pointer before the comparison function is invoked
+ * so that lookups using interned keys are cheap.
+ */
+
+CP_HIDDEN hnode_t *hash_lookup_hashed(hash_t *hash, const void *key, hash_val_t hkey)
+{
+    hash_val_t chain;
+    hnode_t *nptr;
+
+    assert (hkey == hash->function(key));
+    chain = hkey & hash->mask;
+
+    for (nptr = hash->table[chain]; nptr; nptr = nptr->next) {
+	if (nptr->hkey == hkey
+		&& (nptr->key == key || hash->compare(nptr->key, key) == 0))
+	    return nptr;
+    }
+
+    return NULL;
+}
+
 /*
  * Delete the given node from the hash table.  Since the chains
  * are singly linked, we must locate the start of the node's chain
@@ -747,12 +800,12 @@ CP_HIDDEN int hash_isempty(hash_t *hash)
 
 static hnode_t *hnode_alloc(void *context)
 {
-    return malloc(sizeof *hnode_alloc(NULL));
+    return cpi_pool_alloc(sizeof *hnode_alloc(NULL));
 }
 
 static void hnode_free(hnode_t *node, void *context)
 {
-    free(node);
+    cpi_pool_free(node, sizeof *node);
 }
 
 
@@ -762,7 +815,7 @@ static void hnode_free(hnode_t *node, void *context)
 
 CP_HIDDEN hnode_t *hnode_create(void *data)
 {
-    hnode_t *node = malloc(sizeof *node);
+    hnode_t *node = cpi_pool_alloc(sizeof *node);
     if (node) {
 	node->data = data;
 	node->next = NULL;
@@ -787,7 +840,7 @@ CP_HIDDEN hnode_t *hnode_init(hnode_t *hnode, void *data)
 
 CP_HIDDEN void hnode_destroy(hnode_t *hnode)
 {
-    free(hnode);
+    cpi_pool_free(hnode, sizeof *hnode);
 }
 
 #undef hnode_put
@@ -843,6 +896,16 @@ static hash_val_t hash_fun_default(const void *key)
     return acc;
 }
 
+/*
+ * The default hashing function for string keys, exported so that callers
+ * can precompute hash values for hash_lookup_hashed().
+ */
+
+CP_HIDDEN hash_val_t hash_fun_string(const void *key)
+{
+    return hash_fun_default(key);
+}
+
 static int hash_comp_default(const void *key1, const void *key2)
 {
     return strcmp(key1, key2);
@@ -22,6 +22,7 @@
  * Modified by Johannes Lehtinen in 2006-2007.
  * Included the definition of CP_HIDDEN macro and used it in declarations and
  * definitions to hide Kazlib symbols when building a shared C-Pluff library.
+ * Added hash_reserve for growing a dynamic table ahead of bulk insertion.
  */
 
 #ifndef HASH_H
@@ -202,7 +203,10 @@ CP_HIDDEN extern void hash_free(hash_t *);
 CP_HIDDEN extern hash_t *hash_init(hash_t *, hashcount_t, hash_comp_t,
 	hash_fun_t, hnode_t **, hashcount_t);
 CP_HIDDEN extern void hash_insert(hash_t *, hnode_t *, const void *);
+CP_HIDDEN extern void hash_reserve(hash_t *, hashcount_t);
 CP_HIDDEN extern hnode_t *hash_lookup(hash_t *, const void *);
+CP_HIDDEN extern hnode_t *hash_lookup_hashed(hash_t *, const void *, hash_val_t);
+CP_HIDDEN extern hash_val_t hash_fun_string(const void *);
 CP_HIDDEN extern hnode_t *hash_delete(hash_t *, hnode_t *);
 CP_HIDDEN extern int hash_alloc_insert(hash_t *, const void *, void *);
 CP_HIDDEN extern void hash_delete_free(hash_t *, hnode_t *);
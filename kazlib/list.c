@@ -22,6 +22,8 @@
  * Modified by Johannes Lehtinen in 2006-2007.
  * Included the definition of CP_HIDDEN macro and used it in declarations and
  * definitions to hide Kazlib symbols when building a shared C-Pluff library.
+ * Memory is allocated using the C-Pluff allocator and nodes using its
+ * small object pools.
  */
 
 
@@ -30,6 +32,7 @@
 #include <assert.h>
 #define LIST_IMPLEMENTATION
 #include "list.h"
+#include "../libcpluff/util.h"
 
 #define next list_next
 #define prev list_prev
@@ -71,14 +74,14 @@ CP_HIDDEN list_t *list_init(list_t *list, listcount_t maxcount)
 }
 
 /*
- * Dynamically allocate a list object using malloc(), and initialize it so that
+ * Dynamically allocate a list object using cpi_malloc(), and initialize it so that
  * it is a valid empty list. If the list is to be ``unbounded'', the maxcount
  * should be specified as LISTCOUNT_T_MAX, or, alternately, as -1.
  */
 
 CP_HIDDEN list_t *list_create(listcount_t maxcount)
 {
-    list_t *new = malloc(sizeof *new);
+    list_t *new = cpi_malloc(sizeof *new);
     if (new) {
 	assert (maxcount != 0);
 	new->nilnode.next = &new->nilnode;
@@ -97,7 +100,7 @@ CP_HIDDEN list_t *list_create(listcount_t maxcount)
 CP_HIDDEN void list_destroy(list_t *list)
 {
     assert (list_isempty(list));
-    free(list);
+    cpi_free(list);
 }
 
 /*
@@ -234,7 +237,7 @@ CP_HIDDEN void list_process(list_t *list, void *context,
 
 CP_HIDDEN lnode_t *lnode_create(void *data)
 {
-    lnode_t *new = malloc(sizeof *new);
+    lnode_t *new = cpi_pool_alloc(sizeof *new);
     if (new) {
 	new->data = data;
 	new->next = NULL;
@@ -262,7 +265,7 @@ CP_HIDDEN lnode_t *lnode_init(lnode_t *lnode, void *data)
 CP_HIDDEN void lnode_destroy(lnode_t *lnode)
 {
     assert (!lnode_is_in_a_list(lnode));
-    free(lnode);
+    cpi_pool_free(lnode, sizeof *lnode);
 }
 
 /*
@@ -299,12 +302,12 @@ CP_HIDDEN lnodepool_t *lnode_pool_create(listcount_t n)
 
     assert (n != 0);
 
-    pool = malloc(sizeof *pool);
+    pool = cpi_malloc(sizeof *pool);
     if (!pool)
 	return NULL;
-    nodes = malloc(n * sizeof *nodes);
+    nodes = cpi_malloc(n * sizeof *nodes);
     if (!nodes) {
-	free(pool);
+	cpi_free(pool);
 	return NULL;
     }
     lnode_pool_init(pool, nodes, n);
@@ -336,8 +339,8 @@ CP_HIDDEN int lnode_pool_isfrom(lnodepool_t *pool, lnode_t *node)
 
 CP_HIDDEN void lnode_pool_destroy(lnodepool_t *p)
 {
-    free(p->pool);
-    free(p);
+    cpi_free(p->pool);
+    cpi_free(p);
 }
 
 /*
@@ -43,6 +43,22 @@
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// A plug-in loader created by the framework
+typedef struct framework_ploader_t {
+	
+	/// The loader structure given to the client program
+	cp_plugin_loader_t loader;
+	
+	/// The default registration options
+	cpi_ploader_options_t options;
+	
+} framework_ploader_t;
+
+
 /* ------------------------------------------------------------------------
  * Variables
  * ----------------------------------------------------------------------*/
@@ -50,6 +66,12 @@
 /// Existing contexts
 static list_t *contexts = NULL;
 
+/// Plug-in loaders created by the framework, protected by the framework lock
+static cpi_hmap_t *framework_ploaders = NULL;
+
+/// Contexts abandoned by a fast exit, kept reachable for leak checkers
+static list_t *exited_contexts = NULL;
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
@@ -61,51 +83,123 @@ static void free_plugin_env(cp_plugin_env_t *env) {
 	assert(env != NULL);
 	
 	// Free environment data
-	if (env->plugin_listeners != NULL) {
-		cpi_unregister_plisteners(env->plugin_listeners, NULL);
-		list_destroy(env->plugin_listeners);
-		env->plugin_listeners = NULL;
+	cpi_unregister_plisteners(&(env->plugin_listeners), NULL);
+	if (env->plugin_listener_index != NULL) {
+		cpi_unregister_indexed_plisteners(env->plugin_listener_index, NULL);
+		hash_destroy(env->plugin_listener_index);
+		env->plugin_listener_index = NULL;
 	}
-	if (env->loggers != NULL) {
-		cpi_unregister_loggers(env->loggers, NULL);
-		list_destroy(env->loggers);
-		env->loggers = NULL;
+	cpi_unregister_plisteners(&(env->batch_listeners), NULL);
+#ifdef CP_THREADS
+	assert(env->event_thread == NULL);
+	cpi_free(env->event_queue);
+#endif
+	cpi_unregister_loggers(env, NULL);
+	if (env->log_thresholds != NULL) {
+		cpi_free_log_thresholds(env);
+		hash_destroy(env->log_thresholds);
+		env->log_thresholds = NULL;
 	}
+#ifdef CP_SHARED_LOGGING
+	assert(env->log_ring == NULL);
+	assert(env->num_snapshot_waiters == 0);
+	cpi_free(env->logger_snapshot);
+	env->logger_snapshot = NULL;
+#endif
 	if (env->local_loader != NULL) {
 		cp_destroy_local_ploader(env->local_loader);
 		env->local_loader = NULL;
 	}
+	if (env->descriptor_cache != NULL) {
+		cpi_free_descriptor_cache(env->descriptor_cache);
+		env->descriptor_cache = NULL;
+	}
 	if (env->loaders_to_plugins != NULL) {
-		assert(hash_isempty(env->loaders_to_plugins));
-		hash_destroy(env->loaders_to_plugins);
+		assert(cpi_hmap_count(env->loaders_to_plugins) == 0);
+		cpi_destroy_hmap(env->loaders_to_plugins);
 		env->loaders_to_plugins = NULL;
 	}
+	if (env->ploader_options != NULL) {
+		assert(cpi_hmap_count(env->ploader_options) == 0);
+		cpi_destroy_hmap(env->ploader_options);
+		env->ploader_options = NULL;
+	}
 	if (env->infos != NULL) {
-		assert(hash_isempty(env->infos));
-		hash_destroy(env->infos);
+		assert(cpi_hmap_count(env->infos) == 0);
+		cpi_destroy_hmap(env->infos);
 		env->infos = NULL;
 	}
 	if (env->plugins != NULL) {
-		assert(hash_isempty(env->plugins));
-		hash_destroy(env->plugins);
+		assert(cpi_hmap_count(env->plugins) == 0);
+		cpi_destroy_hmap(env->plugins);
 		env->plugins = NULL;
 	}
-	if (env->started_plugins != NULL) {
-		assert(list_isempty(env->started_plugins));
-		list_destroy(env->started_plugins);
-		env->started_plugins = NULL;
-	}
+	assert(env->started_plugins.num == 0);
+	cpi_plugin_set_clear(&(env->started_plugins));
+	cpi_free_dependents(env);
 	if (env->ext_points != NULL) {
-		assert(hash_isempty(env->ext_points));
-		hash_destroy(env->ext_points);
+		assert(cpi_hmap_count(env->ext_points) == 0);
+		cpi_destroy_hmap(env->ext_points);
 	}
 	if (env->extensions != NULL) {
-		assert(hash_isempty(env->extensions));
-		hash_destroy(env->extensions);
+		assert(cpi_hmap_count(env->extensions) == 0);
+		cpi_destroy_hmap(env->extensions);
+	}
+	if (env->extension_snapshots != NULL) {
+		cpi_free_extensions_snapshots(env);
+		hash_destroy(env->extension_snapshots);
+	}
+	if (env->cfg_streams != NULL) {
+		cpi_unregister_cfg_streams(env, NULL);
+		hash_destroy(env->cfg_streams);
+	}
+	if (env->cfg_schemas != NULL) {
+		cpi_unregister_cfg_schemas(env, NULL);
+		hash_destroy(env->cfg_schemas);
+	}
+	if (env->retained_runtimes != NULL) {
+		assert(hash_isempty(env->retained_runtimes));
+		hash_destroy(env->retained_runtimes);
+	}
+	if (env->retained_order != NULL) {
+		assert(list_isempty(env->retained_order));
+		list_destroy(env->retained_order);
+	}
+	if (env->ext_point_generations != NULL) {
+		hash_free_nodes(env->ext_point_generations);
+		hash_destroy(env->ext_point_generations);
+	}
+	if (env->plugin_handles != NULL) {
+		hash_free_nodes(env->plugin_handles);
+		hash_destroy(env->plugin_handles);
+	}
+	if (env->extension_indexes != NULL) {
+		cpi_destroy_extension_indexes(env);
+		list_destroy(env->extension_indexes);
 	}
 	if (env->run_funcs != NULL) {
-		assert(list_isempty(env->run_funcs));
-		list_destroy(env->run_funcs);
+		assert(hash_isempty(env->run_funcs));
+		hash_destroy(env->run_funcs);
+	}
+	if (env->run_queue != NULL) {
+		assert(list_isempty(env->run_queue));
+		list_destroy(env->run_queue);
+	}
+#ifdef CP_THREADS
+	if (env->async_ops != NULL) {
+		assert(list_isempty(env->async_ops));
+		list_destroy(env->async_ops);
+	}
+	assert(env->async_thread == NULL);
+#endif
+	assert(env->num_run_delayed == 0);
+	cpi_free(env->run_delayed);
+	if (env->strings != NULL) {
+		hash_free_nodes(env->strings);
+		hash_destroy(env->strings);
+	}
+	if (env->strings_arena != NULL) {
+		cpi_destroy_arena(env->strings_arena);
 	}
 	
 	// Destroy mutex 
@@ -113,10 +207,19 @@ static void free_plugin_env(cp_plugin_env_t *env) {
 	if (env->mutex != NULL) {
 		cpi_destroy_mutex(env->mutex);
 	}
+#ifdef CP_SHARED_INFOS
+	if (env->infos_mutex != NULL) {
+		cpi_destroy_mutex(env->infos_mutex);
+	}
+#endif
+	if (env->lock_stats != NULL) {
+		cpi_free(env->lock_stats->holders);
+		cpi_free(env->lock_stats);
+	}
 #endif
 
 	// Free environment
-	free(env);
+	cpi_free(env);
 
 }
 
@@ -129,6 +232,9 @@ CP_HIDDEN void cpi_free_context(cp_context_t *context) {
 	}
 	
 	// Destroy symbol lists
+#ifdef CP_SYMBOL_CACHE
+	cpi_free_symbol_cache(context);
+#endif
 	if (context->resolved_symbols != NULL) {
 		assert(hash_isempty(context->resolved_symbols));
 		hash_destroy(context->resolved_symbols);
@@ -139,7 +245,7 @@ CP_HIDDEN void cpi_free_context(cp_context_t *context) {
 	}
 
 	// Free context
-	free(context);	
+	cpi_free(context);	
 }
 
 CP_HIDDEN cp_context_t * cpi_new_context(cp_plugin_t *plugin, cp_plugin_env_t *env, cp_status_t *error) {
@@ -152,7 +258,7 @@ CP_HIDDEN cp_context_t * cpi_new_context(cp_plugin_t *plugin, cp_plugin_env_t *e
 	do {
 		
 		// Allocate memory for the context
-		if ((context = malloc(sizeof(cp_context_t))) == NULL) {
+		if ((context = cpi_malloc(sizeof(cp_context_t))) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -162,12 +268,16 @@ CP_HIDDEN cp_context_t * cpi_new_context(cp_plugin_t *plugin, cp_plugin_env_t *e
 		context->env = env;
 		context->resolved_symbols = NULL;
 		context->symbol_providers = NULL;
+		context->log_threshold = cpi_log_threshold(env, plugin);
+#ifdef CP_SYMBOL_CACHE
+		context->symbol_cache = NULL;
+#endif
 		
 	} while (0);
 	
 	// Free context on error
 	if (status != CP_OK && context != NULL) {
-		free(context);
+		cpi_free(context);
 		context = NULL;
 	}
 	
@@ -184,7 +294,7 @@ CP_C_API cp_context_t * cp_create_context(cp_status_t *error) {
 	do {
 	
 		// Allocate memory for the plug-in environment
-		if ((env = malloc(sizeof(cp_plugin_env_t))) == NULL) {
+		if ((env = cpi_malloc(sizeof(cp_plugin_env_t))) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -198,33 +308,73 @@ CP_C_API cp_context_t * cp_create_context(cp_status_t *error) {
 		env->argv = NULL;
 		env->plugin_descriptor_name = CP_PLUGIN_DESCRIPTOR;
 		env->plugin_descriptor_root_element = CP_PLUGIN_ROOT_ELEMENT;
-		env->plugin_listeners = list_create(LISTCOUNT_T_MAX);
-		env->loggers = list_create(LISTCOUNT_T_MAX);
+		env->plugin_listener_index = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL);
 		env->log_min_severity = CP_LOG_NONE;
+		env->log_default_threshold = CP_LOG_DEBUG;
+		env->log_thresholds = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL);
+		env->cfg_streams = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL);
+		env->cfg_schemas = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL);
 		env->local_loader = NULL;
-		env->loaders_to_plugins = hash_create(LISTCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
-		env->infos = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
-		env->plugins = hash_create(HASHCOUNT_T_MAX,
-			(int (*)(const void *, const void *)) strcmp, NULL);
-		env->started_plugins = list_create(LISTCOUNT_T_MAX);
-		env->ext_points = hash_create(HASHCOUNT_T_MAX,
-			(int (*)(const void *, const void *)) strcmp, NULL);
-		env->extensions = hash_create(HASHCOUNT_T_MAX,
+		env->loaders_to_plugins = cpi_create_hmap(cpi_comp_ptr, cpi_hashfunc_ptr);
+		env->ploader_options = cpi_create_hmap(cpi_comp_ptr, cpi_hashfunc_ptr);
+		env->infos = cpi_create_hmap(cpi_comp_ptr, cpi_hashfunc_ptr);
+#ifdef CP_SHARED_INFOS
+		env->infos_mutex = cpi_create_mutex();
+#endif
+		env->plugins = cpi_create_hmap(cpi_comp_str, NULL);
+		env->dependents = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL);
+		env->ext_points = cpi_create_hmap(cpi_comp_str, NULL);
+		env->extensions = cpi_create_hmap(cpi_comp_str, NULL);
+		env->extension_snapshots = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL);
+		env->ext_point_generations = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL);
+		env->extension_indexes = list_create(LISTCOUNT_T_MAX);
+		env->strings = hash_create(HASHCOUNT_T_MAX,
 			(int (*)(const void *, const void *)) strcmp, NULL);
-		env->run_funcs = list_create(LISTCOUNT_T_MAX);
-		env->run_wait = NULL;
-		if (env->plugin_listeners == NULL
-			|| env->loggers == NULL
+		env->strings_arena = cpi_create_arena();
+		if (env->strings_arena != NULL
+			&& (!cpi_parse_version(env->strings_arena, CP_VERSION, &env->cpluff_version)
+#ifdef CP_ABI_COMPATIBILITY
+				|| !cpi_parse_version(env->strings_arena, CP_ABI_COMPATIBILITY, &env->cpluff_abi_compatibility)
+#endif
+				)) {
+			cpi_destroy_arena(env->strings_arena);
+			env->strings_arena = NULL;
+		}
+		env->run_funcs = hash_create(HASHCOUNT_T_MAX, cpi_comp_run_func, cpi_hashfunc_run_func);
+		env->run_queue = list_create(LISTCOUNT_T_MAX);
+		env->num_run_executing = 0;
+#ifdef CP_THREADS
+		env->async_ops = list_create(LISTCOUNT_T_MAX);
+		env->async_thread = NULL;
+#endif
+		env->run_delayed = NULL;
+		env->num_run_delayed = 0;
+		env->max_run_delayed = 0;
+		if (env->plugin_listener_index == NULL
+			|| env->log_thresholds == NULL
+			|| env->cfg_streams == NULL
+			|| env->cfg_schemas == NULL
 #ifdef CP_THREADS
 			|| env->mutex == NULL
+			|| env->async_ops == NULL
 #endif
 			|| env->loaders_to_plugins == NULL
+			|| env->ploader_options == NULL
 			|| env->infos == NULL
+#ifdef CP_SHARED_INFOS
+			|| env->infos_mutex == NULL
+#endif
 			|| env->plugins == NULL
-			|| env->started_plugins == NULL
+			|| env->dependents == NULL
 			|| env->ext_points == NULL
 			|| env->extensions == NULL
-			|| env->run_funcs == NULL) {
+			|| env->extension_snapshots == NULL
+			|| env->ext_point_generations == NULL
+			|| env->extension_indexes == NULL
+			|| env->strings == NULL
+			|| env->strings_arena == NULL
+			|| env->run_funcs == NULL
+			|| env->run_queue == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -275,6 +425,21 @@ CP_C_API cp_context_t * cp_create_context(cp_status_t *error) {
 	return context;
 }
 
+CP_HIDDEN char *cpi_intern_string(cp_context_t *context, const char *str) {
+	hnode_t *node;
+	char *istr;
+	
+	assert(cpi_is_context_locked(context));
+	if ((node = hash_lookup(context->env->strings, str)) != NULL) {
+		return hnode_get(node);
+	}
+	if ((istr = cpi_arena_strdup(context->env->strings_arena, str)) == NULL
+		|| !hash_alloc_insert(context->env->strings, istr, istr)) {
+		return NULL;
+	}
+	return istr;
+}
+
 CP_C_API void cp_set_plugin_descriptor_root_element(cp_context_t *context, const char *root) {
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(context->env);
@@ -289,6 +454,136 @@ CP_C_API void cp_set_plugin_descriptor_name(cp_context_t *context, const char *n
 	context->env->plugin_descriptor_name = name;
 }
 
+CP_C_API void cp_set_lazy_cfg(cp_context_t *context, int lazy) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(context->env);
+	context->env->lazy_cfg = lazy;
+}
+
+CP_C_API void cp_set_lazy_activation(cp_context_t *context, int lazy) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(context->env);
+	cpi_lock_context(context);
+	context->env->lazy_activation = lazy;
+	cpi_unlock_context(context);
+}
+
+CP_C_API void cp_set_shared_descriptors(cp_context_t *context, int enabled) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(context->env);
+	context->env->shared_descriptors = enabled;
+}
+
+CP_C_API void cp_set_fast_exit(cp_context_t *context, int num_threads) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(context->env);
+	cpi_lock_context(context);
+	context->env->fast_exit_threads = (num_threads > 0 ? num_threads : 0);
+	cpi_unlock_context(context);
+}
+
+CP_C_API void cp_set_timings(cp_context_t *context, int enabled) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(context->env);
+	cpi_lock_context(context);
+	context->env->timings_enabled = enabled;
+	cpi_unlock_context(context);
+}
+
+CP_C_API void cp_set_trace_hook(cp_context_t *context, cp_trace_hook_func_t hook, void *user_data) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(context->env);
+	cpi_lock_context(context);
+	context->env->trace_hook = hook;
+	context->env->trace_user_data = user_data;
+	cpi_unlock_context(context);
+}
+
+CP_C_API cp_status_t cp_set_lock_stats(cp_context_t *context, int enabled) {
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(context->env);
+#ifdef CP_THREADS
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	if (enabled) {
+		cpi_lock_stats_t *stats = context->env->lock_stats;
+		
+		if (stats == NULL) {
+			if ((stats = cpi_malloc(sizeof(cpi_lock_stats_t))) == NULL) {
+				status = CP_ERR_RESOURCE;
+			} else {
+				memset(stats, 0, sizeof(cpi_lock_stats_t));
+			}
+		} else {
+			cpi_set_mutex_stats(context->env->mutex, NULL);
+			cpi_lock_stats_reset(stats);
+		}
+		if (stats != NULL) {
+			context->env->lock_stats = stats;
+			cpi_set_mutex_stats(context->env->mutex, stats);
+			cpi_set_mutex_holder(context->env->mutex, __func__);
+		}
+	} else if (context->env->lock_stats != NULL) {
+		cpi_set_mutex_stats(context->env->mutex, NULL);
+		cpi_free(context->env->lock_stats->holders);
+		cpi_free(context->env->lock_stats);
+		context->env->lock_stats = NULL;
+	}
+	cpi_unlock_context(context);
+	if (status != CP_OK) {
+		cpi_error(context, N_("Lock statistics could not be enabled due to insufficient memory."));
+	}
+#endif
+	return status;
+}
+
+CP_HIDDEN void cpi_call_trace_hook(cp_context_t *context, cp_trace_event_t event, const char *plugin_id, const char *name, cp_status_t status, unsigned long long duration) {
+	cp_trace_record_t record;
+	
+	record.event = event;
+	record.plugin_id = plugin_id;
+	record.name = name;
+	record.status = status;
+	record.time = cpi_monotonic_time();
+	record.duration = duration;
+	context->env->trace_hook(&record, context->env->trace_user_data);
+}
+
+/**
+ * Stops the active plug-ins of a context being destroyed in fast exit mode
+ * and abandons the context without uninstalling the plug-ins or releasing
+ * any resources. The context has already been removed from the context
+ * list.
+ * 
+ * @param context the plug-in context
+ */
+static void exit_context_fast(cp_context_t *context) {
+	lnode_t *node;
+	
+	// Stop the plug-ins, serially in the reverse start order if not in parallel
+	if (context->env->fast_exit_threads > 1) {
+		cp_stop_plugins_parallel(context, context->env->fast_exit_threads);
+	} else {
+		cp_stop_plugins(context);
+	}
+	
+	// Pass the remaining events and messages on
+	cpi_stop_event_dispatcher(context);
+	cpi_stop_async_logging(context);
+	
+	// Keep the context reachable
+	cpi_lock_framework();
+	if (exited_contexts == NULL) {
+		exited_contexts = list_create(LISTCOUNT_T_MAX);
+	}
+	if (exited_contexts != NULL && (node = lnode_create(context)) != NULL) {
+		list_append(exited_contexts, node);
+	}
+	cpi_unlock_framework();
+}
+
 CP_C_API void cp_destroy_context(cp_context_t *context) {
 	CHECK_NOT_NULL(context);
 	if (context->plugin != NULL) {
@@ -298,7 +593,10 @@ CP_C_API void cp_destroy_context(cp_context_t *context) {
 	// Check invocation
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_save_descriptor_cache(context);
 	cpi_unlock_context(context);
+	cpi_stop_async_control(context);
+	cpi_stop_prefetch(context);
 
 #ifdef CP_THREADS
 	assert(context->env->mutex == NULL || !cpi_is_mutex_locked(context->env->mutex));
@@ -318,9 +616,19 @@ CP_C_API void cp_destroy_context(cp_context_t *context) {
 	}
 	cpi_unlock_framework();
 
-	// Unload all plug-ins 
+	// Only stop the plug-ins in fast exit mode
+	if (context->env->fast_exit_threads > 0) {
+		exit_context_fast(context);
+		return;
+	}
+
+	// Unload all plug-ins without retaining their runtime libraries
+	cp_set_runtime_retention(context, 0);
 	cp_uninstall_plugins(context);
 	
+	// Deliver the remaining events to batch plug-in listeners
+	cpi_stop_event_dispatcher(context);
+	
 	// Unregister all plug-in loaders
 	cp_unregister_ploaders(context);
 	
@@ -332,10 +640,40 @@ CP_C_API void cp_destroy_context(cp_context_t *context) {
 	// Release remaining information objects
 	cpi_release_infos(context);
 	
+	// Pass the remaining queued messages to the loggers
+	cpi_stop_async_logging(context);
+	
 	// Free context
 	cpi_free_context(context);
 }
 
+CP_HIDDEN void cpi_client_memory(cp_plugin_env_t *env, cp_memory_stats_t *stats) {
+	cpi_lock_framework();
+	if (contexts != NULL) {
+		lnode_t *node;
+		
+		for (node = list_first(contexts); node != NULL; node = list_next(contexts, node)) {
+			cp_context_t *context = lnode_get(node);
+			
+			if (context->env == env) {
+				stats->contexts++;
+				stats->context_bytes += sizeof(lnode_t) + sizeof(cp_context_t) + sizeof(cp_plugin_env_t);
+				cpi_symbol_memory(context, stats);
+			}
+		}
+	}
+	cpi_unlock_framework();
+}
+
+CP_HIDDEN int cpi_has_exited_contexts(void) {
+	int exited;
+	
+	cpi_lock_framework();
+	exited = (exited_contexts != NULL && !list_isempty(exited_contexts));
+	cpi_unlock_framework();
+	return exited;
+}
+
 CP_HIDDEN void cpi_destroy_all_contexts(void) {
 	cpi_lock_framework();
 	if (contexts != NULL) {
@@ -353,6 +691,112 @@ CP_HIDDEN void cpi_destroy_all_contexts(void) {
 }
 
 
+// Forking
+
+/*
+ * Quiesces the specified context for forking and leaves it locked. Stops
+ * the framework threads of the context and waits for plug-in operations,
+ * run functions and plug-in scans in progress to complete.
+ * 
+ * @param context the plug-in context
+ */
+static void prepare_context_fork(cp_context_t *context) {
+	cp_plugin_env_t *env = context->env;
+	
+	// Check invocation
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, "cp_prepare_fork");
+	cpi_unlock_context(context);
+	
+	// Stop the framework threads
+	cpi_stop_async_control(context);
+	cpi_stop_prefetch(context);
+	cpi_stop_event_dispatcher(context);
+	cpi_suspend_async_logging(context);
+	
+	// Wait for the operations in progress
+	cpi_lock_context(context);
+	while (env->lifecycle_holders > 0 || env->num_run_executing > 0) {
+		cpi_wait_context(context);
+	}
+	cpi_wait_loader_scans(context);
+#ifdef CP_SHARED_INFOS
+	cpi_lock_mutex(env->infos_mutex);
+#endif
+}
+
+/*
+ * Releases the specified context locked by prepare_context_fork and
+ * restarts the framework threads needed to deliver events and messages.
+ * 
+ * @param context the plug-in context
+ * @param child whether called in the child process
+ */
+static void after_context_fork(cp_context_t *context, int child) {
+#ifdef CP_SHARED_INFOS
+	if (child) {
+		cpi_reset_mutex(context->env->infos_mutex);
+	}
+	cpi_unlock_mutex(context->env->infos_mutex);
+#endif
+#ifdef CP_THREADS
+	if (child && context->env->mutex != NULL) {
+		cpi_reset_mutex(context->env->mutex);
+	}
+#endif
+	cpi_unlock_context(context);
+	cpi_resume_event_dispatcher(context);
+	cpi_resume_async_logging(context);
+}
+
+CP_C_API void cp_prepare_fork(void) {
+	cpi_lock_framework();
+	if (contexts != NULL) {
+		lnode_t *node;
+		
+		for (node = list_first(contexts); node != NULL; node = list_next(contexts, node)) {
+			cpi_unlock_framework();
+			prepare_context_fork(lnode_get(node));
+			cpi_lock_framework();
+		}
+	}
+	cpi_unlock_framework();
+#ifdef CP_THREADS
+	cpi_prepare_framework_fork();
+#endif
+}
+
+/*
+ * Releases everything locked by cp_prepare_fork.
+ * 
+ * @param child whether called in the child process
+ */
+static void after_fork(int child) {
+#ifdef CP_THREADS
+	cpi_after_framework_fork(child);
+#endif
+	cpi_lock_framework();
+	if (contexts != NULL) {
+		lnode_t *node;
+		
+		for (node = list_first(contexts); node != NULL; node = list_next(contexts, node)) {
+			cpi_unlock_framework();
+			after_context_fork(lnode_get(node), child);
+			cpi_lock_framework();
+		}
+	}
+	cpi_unlock_framework();
+}
+
+CP_C_API void cp_after_fork_parent(void) {
+	after_fork(0);
+}
+
+CP_C_API void cp_after_fork_child(void) {
+	after_fork(1);
+}
+
+
 // Plug-in directories
 
 /*
@@ -381,6 +825,7 @@ CP_C_API cp_status_t cp_register_pcollection(cp_context_t *context, const char *
 	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_wait_loader_scans(context);
 	do {
 	
 		// Initialize plug-in loader
@@ -410,6 +855,7 @@ CP_C_API void cp_unregister_pcollection(cp_context_t *context, const char *dir)
 	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_wait_loader_scans(context);
 	if (context->env->local_loader != NULL) {
 		cp_lpl_unregister_dir(context->env->local_loader, dir);
 	}
@@ -421,6 +867,7 @@ CP_C_API void cp_unregister_pcollections(cp_context_t *context) {
 	CHECK_NOT_NULL(context);
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_wait_loader_scans(context);
 	if (context->env->local_loader != NULL) {
 		cp_lpl_unregister_dirs(context->env->local_loader);
 	}
@@ -431,21 +878,129 @@ CP_C_API void cp_unregister_pcollections(cp_context_t *context) {
 
 // Plug-in loaders
 
-CP_C_API cp_status_t cp_register_ploader(cp_context_t *ctx, cp_plugin_loader_t *loader) {
+CP_HIDDEN cp_plugin_loader_t *cpi_create_ploader(const cpi_ploader_options_t *options) {
+	framework_ploader_t *fpl;
+	
+	if ((fpl = cpi_malloc(sizeof(framework_ploader_t))) == NULL) {
+		return NULL;
+	}
+	memset(fpl, 0, sizeof(framework_ploader_t));
+	if (options != NULL) {
+		fpl->options = *options;
+	}
+	cpi_lock_framework();
+	if (framework_ploaders == NULL) {
+		framework_ploaders = cpi_create_hmap(cpi_comp_ptr, cpi_hashfunc_ptr);
+	}
+	if (framework_ploaders == NULL
+		|| !cpi_hmap_put(framework_ploaders, &(fpl->loader), fpl)) {
+		cpi_free(fpl);
+		fpl = NULL;
+	}
+	cpi_unlock_framework();
+	return (fpl != NULL ? &(fpl->loader) : NULL);
+}
+
+CP_HIDDEN void cpi_destroy_ploader(cp_plugin_loader_t *loader) {
+	framework_ploader_t *fpl;
+	
+	assert(loader != NULL);
+	cpi_lock_framework();
+	assert(framework_ploaders != NULL);
+	fpl = cpi_hmap_remove(framework_ploaders, loader);
+	assert(fpl != NULL);
+	if (cpi_hmap_count(framework_ploaders) == 0) {
+		cpi_destroy_hmap(framework_ploaders);
+		framework_ploaders = NULL;
+	}
+	cpi_unlock_framework();
+	cpi_free(fpl);
+}
+
+/**
+ * Replaces the registration options of a registered plug-in loader. The
+ * caller must hold the context lock and no loader scans may be running.
+ * Options equal to the defaults are not stored.
+ * 
+ * @param context the plug-in context
+ * @param loader the plug-in loader
+ * @param options the new options
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t set_ploader_options(cp_context_t *context, cp_plugin_loader_t *loader, const cpi_ploader_options_t *options) {
+	cpi_ploader_options_t *old, *new = NULL;
+	
+	assert(options != NULL);
+	if (options->flags != 0 || options->scan_changes != NULL) {
+		if ((new = cpi_malloc(sizeof(cpi_ploader_options_t))) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		*new = *options;
+	}
+	old = cpi_hmap_get(context->env->ploader_options, loader);
+	if (new != NULL) {
+		if (!cpi_hmap_put(context->env->ploader_options, loader, new)) {
+			cpi_free(new);
+			return CP_ERR_RESOURCE;
+		}
+	} else if (old != NULL) {
+		cpi_hmap_remove(context->env->ploader_options, loader);
+	}
+	cpi_free(old);
+	return CP_OK;
+}
+
+/**
+ * Returns the default registration options of a plug-in loader. Loaders
+ * created by the framework have their own defaults, other loaders none.
+ * 
+ * @param loader the plug-in loader
+ * @param options filled with the default options
+ */
+static void get_default_ploader_options(cp_plugin_loader_t *loader, cpi_ploader_options_t *options) {
+	framework_ploader_t *fpl = NULL;
+	
+	cpi_lock_framework();
+	if (framework_ploaders != NULL) {
+		fpl = cpi_hmap_get(framework_ploaders, loader);
+	}
+	if (fpl != NULL) {
+		*options = fpl->options;
+	} else {
+		memset(options, 0, sizeof(cpi_ploader_options_t));
+	}
+	cpi_unlock_framework();
+}
+
+/**
+ * Registers a plug-in loader with the specified options. The options of
+ * an already registered loader are replaced. The caller must hold the
+ * context lock and no loader scans may be running.
+ * 
+ * @param ctx the plug-in context
+ * @param loader the plug-in loader
+ * @param options the registration options
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t register_ploader(cp_context_t *ctx, cp_plugin_loader_t *loader, const cpi_ploader_options_t *options) {
 	cp_status_t status = CP_OK;
 	hash_t *loader_plugins = NULL;
 	
-	CHECK_NOT_NULL(ctx);
-	CHECK_NOT_NULL(loader);
-	
-	cpi_lock_context(ctx);
-	cpi_check_invocation(ctx, CPI_CF_ANY, __func__);
+	assert(cpi_is_context_locked(ctx));
 	do {
+		if (cpi_hmap_get(ctx->env->loaders_to_plugins, loader) != NULL) {
+			status = set_ploader_options(ctx, loader, options);
+			break;
+		}
 		if ((loader_plugins = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
-		if (!hash_alloc_insert(ctx->env->loaders_to_plugins, loader, loader_plugins)) {
+		if ((status = set_ploader_options(ctx, loader, options)) != CP_OK) {
+			break;
+		}
+		if (!cpi_hmap_put(ctx->env->loaders_to_plugins, loader, loader_plugins)) {
+			cpi_free(cpi_hmap_remove(ctx->env->ploader_options, loader));
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -457,7 +1012,6 @@ CP_C_API cp_status_t cp_register_ploader(cp_context_t *ctx, cp_plugin_loader_t *
 	} else {
 		cpi_debugf(ctx, N_("The plug-in loader %p was registered."), (void *) loader);
 	}
-	cpi_unlock_context(ctx);
 	
 	// Release resources
 	if (status != CP_OK) {
@@ -470,17 +1024,80 @@ CP_C_API cp_status_t cp_register_ploader(cp_context_t *ctx, cp_plugin_loader_t *
 	return status;
 }
 
+CP_C_API cp_status_t cp_register_ploader(cp_context_t *ctx, cp_plugin_loader_t *loader) {
+	cpi_ploader_options_t options;
+	cp_status_t status;
+	
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(loader);
+	
+	get_default_ploader_options(loader, &options);
+	cpi_lock_context(ctx);
+	cpi_check_invocation(ctx, CPI_CF_ANY, __func__);
+	cpi_wait_loader_scans(ctx);
+	status = register_ploader(ctx, loader, &options);
+	cpi_unlock_context(ctx);
+	return status;
+}
+
+CP_C_API cp_status_t cp_register_ploader_flags(cp_context_t *ctx, cp_plugin_loader_t *loader, int flags) {
+	cpi_ploader_options_t options;
+	cp_status_t status;
+	
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(loader);
+	
+	get_default_ploader_options(loader, &options);
+	options.flags = flags;
+	cpi_lock_context(ctx);
+	cpi_check_invocation(ctx, CPI_CF_ANY, __func__);
+	cpi_wait_loader_scans(ctx);
+	status = register_ploader(ctx, loader, &options);
+	cpi_unlock_context(ctx);
+	return status;
+}
+
+CP_C_API cp_status_t cp_set_ploader_scan_changes(cp_context_t *ctx, cp_plugin_loader_t *loader, cp_scan_changes_func_t scan_changes) {
+	cp_status_t status;
+	
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(loader);
+	
+	cpi_lock_context(ctx);
+	cpi_check_invocation(ctx, CPI_CF_ANY, __func__);
+	cpi_wait_loader_scans(ctx);
+	if (cpi_hmap_get(ctx->env->loaders_to_plugins, loader) != NULL) {
+		const cpi_ploader_options_t *old = cpi_hmap_get(ctx->env->ploader_options, loader);
+		cpi_ploader_options_t options;
+		
+		if (old != NULL) {
+			options = *old;
+		} else {
+			memset(&options, 0, sizeof(cpi_ploader_options_t));
+		}
+		options.scan_changes = scan_changes;
+		status = set_ploader_options(ctx, loader, &options);
+	} else {
+		cpi_errorf(ctx, N_("The plug-in loader %p has not been registered."), (void *) loader);
+		status = CP_ERR_UNKNOWN;
+	}
+	cpi_unlock_context(ctx);
+	return status;
+}
+
 CP_C_API void cp_unregister_ploader(cp_context_t *ctx, cp_plugin_loader_t *loader) {
-	hnode_t *hnode;
+	hash_t *loader_plugins;
+	cpi_invocation_t lifecycle;
 	
 	CHECK_NOT_NULL(ctx);
 	CHECK_NOT_NULL(loader);
 
 	cpi_lock_context(ctx);
 	cpi_check_invocation(ctx, CPI_CF_ANY, __func__);
-	hnode = hash_lookup(ctx->env->loaders_to_plugins, loader);
-	if (hnode != NULL) {
-		hash_t *loader_plugins = hnode_get(hnode);
+	cpi_begin_lifecycle(ctx, &lifecycle);
+	cpi_wait_loader_scans(ctx);
+	loader_plugins = cpi_hmap_get(ctx->env->loaders_to_plugins, loader);
+	if (loader_plugins != NULL) {
 
 		// Uninstall all plug-ins loaded by the loader
 		while (!hash_isempty(loader_plugins)) {
@@ -494,11 +1111,13 @@ CP_C_API void cp_unregister_ploader(cp_context_t *ctx, cp_plugin_loader_t *loade
 			status = cp_uninstall_plugin(ctx, hnode_getkey(hnode2));
 			assert(status == CP_OK);
 		}
-		hash_delete_free(ctx->env->loaders_to_plugins, hnode);
+		cpi_hmap_remove(ctx->env->loaders_to_plugins, loader);
+		cpi_free(cpi_hmap_remove(ctx->env->ploader_options, loader));
 		assert(hash_isempty(loader_plugins));
 		hash_destroy(loader_plugins);
 		cpi_debugf(ctx, N_("The plug-in loader %p was unregistered."), (void *) loader);
 	}
+	cpi_end_lifecycle(ctx, &lifecycle);
 	cpi_unlock_context(ctx);
 }
 
@@ -510,15 +1129,15 @@ CP_C_API void cp_unregister_ploaders(cp_context_t *ctx) {
 	cpi_lock_context(ctx);
 	cpi_check_invocation(ctx, CPI_CF_ANY, __func__);
 	do {
-		hscan_t hscan;
-		hnode_t *hnode;
+		cpi_hmap_scan_t hscan;
+		const void *key = NULL;
 		
-		hash_scan_begin(&hscan, ctx->env->loaders_to_plugins);
-		do {
-			hnode = hash_scan_next(&hscan);
-		} while (hnode != NULL && hnode_getkey(hnode) == ctx->env->local_loader);
-		if (hnode != NULL) {
-			cp_plugin_loader_t *loader = (cp_plugin_loader_t *) hnode_getkey(hnode);
+		cpi_hmap_scan_begin(&hscan, ctx->env->loaders_to_plugins);
+		while (cpi_hmap_scan_next(&hscan, &key) != NULL && key == ctx->env->local_loader) {
+			key = NULL;
+		}
+		if (key != NULL) {
+			cp_plugin_loader_t *loader = (cp_plugin_loader_t *) key;
 			cp_unregister_ploader(ctx, loader);
 			found = 1;
 		} else {
@@ -530,6 +1149,169 @@ CP_C_API void cp_unregister_ploaders(cp_context_t *ctx) {
 }
 
 
+// Context cloning
+
+CP_C_API cp_context_t * cp_clone_context(cp_context_t *src, int flags, cp_status_t *error) {
+	cp_context_t *context = NULL;
+	cp_plugin_info_t **plugins = NULL;
+	cp_plugin_loader_t **loaders = NULL;
+	const char **started = NULL;
+	unsigned int n = 0, num_started = 0, i;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(src);
+	
+	cpi_lock_context(src);
+	cpi_check_invocation(src, CPI_CF_ANY, __func__);
+	cpi_wait_loader_scans(src);
+	do {
+		cpi_hmap_scan_t scan;
+		const void *key;
+		cp_plugin_t *rp;
+		size_t num_plugins = cpi_hmap_count(src->env->plugins);
+		
+		/*
+		 * Create the new context with the same settings. It is locked
+		 * while the source context is locked but can not be reached by
+		 * other threads yet.
+		 */
+		if ((context = cp_create_context(&status)) == NULL) {
+			break;
+		}
+		cpi_lock_context(context);
+		context->env->argc = src->env->argc;
+		context->env->argv = src->env->argv;
+		context->env->plugin_descriptor_name = src->env->plugin_descriptor_name;
+		context->env->plugin_descriptor_root_element = src->env->plugin_descriptor_root_element;
+		context->env->lazy_cfg = src->env->lazy_cfg;
+		context->env->lazy_activation = src->env->lazy_activation;
+		context->env->shared_descriptors = src->env->shared_descriptors;
+		context->env->timings_enabled = src->env->timings_enabled;
+		context->env->fast_exit_threads = src->env->fast_exit_threads;
+		context->env->max_retained_runtimes = src->env->max_retained_runtimes;
+		
+		// Register the same plug-in loaders and plug-in collections
+		cpi_hmap_scan_begin(&scan, src->env->loaders_to_plugins);
+		while (status == CP_OK && cpi_hmap_scan_next(&scan, &key) != NULL) {
+			if (key == src->env->local_loader) {
+				if ((status = init_local_ploader(context)) == CP_OK) {
+					status = cpi_lpl_copy(context->env->local_loader, src->env->local_loader);
+				}
+			} else {
+				cpi_ploader_options_t options;
+				const cpi_ploader_options_t *src_options = cpi_hmap_get(src->env->ploader_options, key);
+				
+				if (src_options != NULL) {
+					options = *src_options;
+				} else {
+					memset(&options, 0, sizeof(cpi_ploader_options_t));
+				}
+				status = register_ploader(context, (cp_plugin_loader_t *) key, &options);
+			}
+		}
+		if (status != CP_OK || num_plugins == 0) {
+			break;
+		}
+		
+		// Share or copy the information of the installed plug-ins
+		if ((plugins = cpi_malloc(num_plugins * sizeof(cp_plugin_info_t *))) == NULL
+			|| (loaders = cpi_malloc(num_plugins * sizeof(cp_plugin_loader_t *))) == NULL
+			|| !cpi_hmap_reserve(context->env->plugins, num_plugins)) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		cpi_hmap_scan_begin(&scan, src->env->plugins);
+		while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			if (cpi_is_shared_info(rp->plugin)) {
+				cpi_use_info(src, rp->plugin);
+				plugins[n] = rp->plugin;
+			} else if ((plugins[n] = cpi_compact_plugin(context, rp->plugin, 0)) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			loaders[n] = (rp->loader == src->env->local_loader ?
+				context->env->local_loader : rp->loader);
+			
+			// Add the plug-in to the loader map
+			if (loaders[n] != NULL
+				&& !hash_alloc_insert(cpi_hmap_get(context->env->loaders_to_plugins, loaders[n]), plugins[n]->identifier, NULL)) {
+				cpi_release_info(context, plugins[n]);
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			n++;
+		}
+		
+		// Install the plug-ins in a single batch
+		if (status == CP_OK) {
+			status = cpi_install_plugins(context, plugins, loaders, n, CP_IP_ATOMIC, NULL);
+		}
+		
+		// Remove the plug-ins from the loader maps on failure
+		if (status != CP_OK) {
+			for (i = 0; i < n; i++) {
+				if (loaders[i] != NULL) {
+					hash_t *loader_plugins = cpi_hmap_get(context->env->loaders_to_plugins, loaders[i]);
+					
+					hash_delete_free(loader_plugins, hash_lookup(loader_plugins, plugins[i]->identifier));
+				}
+			}
+			break;
+		}
+		
+		// Record the plug-ins to be started in the original start order
+		if ((flags & CP_CL_START) && src->env->started_plugins.num > 0) {
+			if ((started = cpi_malloc(src->env->started_plugins.num * sizeof(char *))) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			for (i = 0; i < (unsigned int) src->env->started_plugins.num; i++) {
+				rp = cpi_hmap_get(context->env->plugins, src->env->started_plugins.plugins[i]->plugin->identifier);
+				assert(rp != NULL);
+				started[num_started++] = rp->plugin->identifier;
+			}
+		}
+		
+	} while (0);
+	
+	// Release the references held for the installation
+	if (context != NULL) {
+		for (i = 0; i < n; i++) {
+			cpi_release_info(context, plugins[i]);
+		}
+		cpi_unlock_context(context);
+	}
+	cpi_free(plugins);
+	cpi_free(loaders);
+	
+	// Report the result
+	if (status != CP_OK) {
+		cpi_error(src, N_("The plug-in context could not be cloned."));
+	} else {
+		cpi_debugf(src, N_("The plug-in context was cloned with %u installed plug-ins."), n);
+	}
+	cpi_unlock_context(src);
+	
+	// Start the plug-ins that were active in the source context
+	for (i = 0; i < num_started && status == CP_OK; i++) {
+		status = cp_start_plugin(context, started[i]);
+	}
+	cpi_free(started);
+	
+	// Destroy a partially initialized context on failure
+	if (status != CP_OK && context != NULL) {
+		cp_destroy_context(context);
+		context = NULL;
+	}
+	
+	// Return the final status
+	if (error != NULL) {
+		*error = status;
+	}
+	return context;
+}
+
+
 // Startup arguments
 
 CP_C_API void cp_set_context_args(cp_context_t *ctx, char **argv) {
@@ -551,12 +1333,12 @@ CP_C_API char **cp_get_context_args(cp_context_t *ctx, int *argc) {
 	char **argv;
 	
 	CHECK_NOT_NULL(ctx);
-	cpi_lock_context(ctx);
+	cpi_lock_context_shared(ctx);
 	if (argc != NULL) {
 		*argc = ctx->env->argc;
 	}
 	argv = ctx->env->argv;
-	cpi_unlock_context(ctx);
+	cpi_unlock_context_shared(ctx);
 	return argv;
 }
 
@@ -564,30 +1346,38 @@ CP_C_API char **cp_get_context_args(cp_context_t *ctx, int *argc) {
 // Checking API call invocation
 
 CP_HIDDEN void cpi_check_invocation(cp_context_t *ctx, int funcmask, const char *func) {
+	int cf;
+	
 	assert(ctx != NULL);
 	assert(funcmask != 0);
 	assert(func != NULL);
-	assert(cpi_is_context_locked(ctx));
-	if ((funcmask & CPI_CF_LOGGER)
-		&&ctx->env->in_logger_invocation) {
+#ifdef CP_THREADS
+	if (ctx->env->lock_stats != NULL) {
+		cpi_set_mutex_holder(ctx->env->mutex, func);
+	}
+#endif
+	if (!(cf = cpi_in_invocation(ctx->env, (funcmask | CPI_CF_CREATE | CPI_CF_DESTROY) & ~CPI_CF_LIFECYCLE))) {
+		return;
+	}
+	if (cf & CPI_CF_LOGGER) {
 		cpi_fatalf(_("Function %s was called from within a logger invocation."), func);
 	}
-	if ((funcmask & CPI_CF_LISTENER)
-		&& ctx->env->in_event_listener_invocation) {
+	if (cf & CPI_CF_LISTENER) {
 		cpi_fatalf(_("Function %s was called from within an event listener invocation."), func);
 	}
-	if ((funcmask & CPI_CF_START)
-		&& ctx->env->in_start_func_invocation) {
+	if (cf & CPI_CF_START) {
 		cpi_fatalf(_("Function %s was called from within a plug-in start function invocation."), func);
 	}
-	if ((funcmask & CPI_CF_STOP)
-		&& ctx->env->in_stop_func_invocation) {
+	if (cf & CPI_CF_STOP) {
 		cpi_fatalf(_("Function %s was called from within a plug-in stop function invocation."), func);
 	}
-	if (ctx->env->in_create_func_invocation) {
+	if (cf & CPI_CF_VISITOR) {
+		cpi_fatalf(_("Function %s was called from within a visitor invocation."), func);
+	}
+	if (cf & CPI_CF_CREATE) {
 		cpi_fatalf(_("Function %s was called from within a plug-in create function invocation."), func);
 	}
-	if (ctx->env->in_destroy_func_invocation) {
+	if (cf & CPI_CF_DESTROY) {
 		cpi_fatalf(_("Function %s was called from within a plug-in destroy function invocation."), func);
 	}
 }
@@ -597,9 +1387,31 @@ CP_HIDDEN void cpi_check_invocation(cp_context_t *ctx, int funcmask, const char
 
 #if defined(CP_THREADS) || !defined(NDEBUG)
 
+#ifdef CP_THREADS
+
+/**
+ * Reports a context lock wait to the USDT probe and to the trace hook.
+ * The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param waited the time waited in nanoseconds
+ */
+static void trace_lock_wait(cp_context_t *context, unsigned long long waited) {
+	CPI_PROBE(lock_wait, context, NULL, NULL, CP_OK, waited);
+	if (context->env->trace_hook != NULL) {
+		cpi_call_trace_hook(context, CP_TRACE_LOCK_WAIT, NULL, NULL, CP_OK, waited);
+	}
+}
+
+#endif
+
 CP_HIDDEN void cpi_lock_context(cp_context_t *context) {
 #if defined(CP_THREADS)
-	cpi_lock_mutex(context->env->mutex);
+	unsigned long long waited;
+	
+	if ((waited = cpi_lock_mutex(context->env->mutex)) != 0) {
+		trace_lock_wait(context, waited);
+	}
 #elif !defined(NDEBUG)
 	context->env->locked++;
 #endif
@@ -614,6 +1426,27 @@ CP_HIDDEN void cpi_unlock_context(cp_context_t *context) {
 #endif
 }
 
+CP_HIDDEN void cpi_lock_context_shared(cp_context_t *context) {
+#if defined(CP_THREADS)
+	unsigned long long waited;
+	
+	if ((waited = cpi_lock_mutex_shared(context->env->mutex)) != 0) {
+		trace_lock_wait(context, waited);
+	}
+#elif !defined(NDEBUG)
+	context->env->locked++;
+#endif
+}
+
+CP_HIDDEN void cpi_unlock_context_shared(cp_context_t *context) {
+#if defined(CP_THREADS)
+	cpi_unlock_mutex_shared(context->env->mutex);
+#elif !defined(NDEBUG)
+	assert(context->env->locked > 0);
+	context->env->locked--;
+#endif
+}
+
 CP_HIDDEN void cpi_wait_context(cp_context_t *context) {
 #if defined(CP_THREADS)
 	cpi_wait_mutex(context->env->mutex);
@@ -631,6 +1464,16 @@ CP_HIDDEN void cpi_signal_context(cp_context_t *context) {
 #endif
 }
 
+CP_HIDDEN void cpi_wait_loader_scans(cp_context_t *context) {
+#if defined(CP_THREADS)
+	while (context->env->concurrent_scan) {
+		cpi_wait_mutex(context->env->mutex);
+	}
+#elif !defined(NDEBUG)
+	assert(context->env->locked > 0);
+#endif
+}
+
 
 // Debug helpers
 
@@ -650,3 +1493,59 @@ CP_HIDDEN char *cpi_context_owner(cp_context_t *ctx, char *name, size_t size) {
 }
 
 #endif
+
+/// Invocations during which the calling thread holds the lifecycle lock
+#define CPI_CF_LIFECYCLE_HELD (CPI_CF_LIFECYCLE | CPI_CF_START | CPI_CF_STOP | CPI_CF_CREATE | CPI_CF_DESTROY)
+
+CP_HIDDEN void cpi_begin_lifecycle(cp_context_t *context, cpi_invocation_t *inv) {
+	cp_plugin_env_t *env = context->env;
+	
+	assert(cpi_is_context_locked(context));
+	if (!cpi_in_invocation(env, CPI_CF_LIFECYCLE_HELD)) {
+		while (env->lifecycle_holders > env->lifecycle_yields) {
+			cpi_wait_context(context);
+		}
+		env->lifecycle_holders++;
+	}
+	cpi_begin_invocation(env, inv, CPI_CF_LIFECYCLE);
+}
+
+CP_HIDDEN void cpi_end_lifecycle(cp_context_t *context, cpi_invocation_t *inv) {
+	cp_plugin_env_t *env = context->env;
+	
+	assert(cpi_is_context_locked(context));
+	cpi_end_invocation(inv);
+	if (!cpi_in_invocation(env, CPI_CF_LIFECYCLE_HELD)) {
+		assert(env->lifecycle_holders > 0);
+		env->lifecycle_holders--;
+		cpi_signal_context(context);
+	}
+}
+
+CP_HIDDEN int cpi_is_sole_lifecycle_holder(cp_context_t *context) {
+	cp_plugin_env_t *env = context->env;
+	
+	assert(cpi_is_context_locked(context));
+	return env->lifecycle_holders == 1
+		&& env->lifecycle_yields == 0
+		&& cpi_in_invocation(env, CPI_CF_LIFECYCLE_HELD) == CPI_CF_LIFECYCLE;
+}
+
+CP_HIDDEN void cpi_wait_context_yielding(cp_context_t *context) {
+	cp_plugin_env_t *env = context->env;
+	
+	assert(cpi_is_context_locked(context));
+	env->lifecycle_yields++;
+	cpi_signal_context(context);
+	cpi_wait_context(context);
+	env->lifecycle_yields--;
+}
+
+CP_HIDDEN void cpi_wait_context_timed(cp_context_t *context, unsigned long long timeout) {
+#if defined(CP_THREADS)
+	cpi_wait_mutex_timed(context->env->mutex, timeout);
+#else
+	assert(cpi_is_context_locked(context));
+	cpi_sleep(timeout);
+#endif
+}
@@ -46,6 +46,35 @@
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Granularity of the small object size classes
+#define CP_POOL_GRANULARITY 16
+
+/// Number of small object size classes
+#define CP_POOL_CLASSES 4
+
+/// Maximum number of released objects kept on a free list
+#define CP_POOL_MAX_FREE 1024
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// A released small object on a free list
+typedef struct cpi_pool_node_t cpi_pool_node_t;
+
+struct cpi_pool_node_t {
+	
+	/// The next released object
+	cpi_pool_node_t *next;
+	
+};
+
+
 /* ------------------------------------------------------------------------
  * Variables
  * ----------------------------------------------------------------------*/
@@ -58,16 +87,56 @@ static int initialized = 0;
 /// Framework mutex
 static cpi_mutex_t *framework_mutex = NULL;
 
-#elif !defined(NDEBUG)
+/// Callback function invocations in progress, per thread
+static cpi_tls_t *invocations = NULL;
+
+#else
+
+#if !defined(NDEBUG)
 
 /// Framework locking count
 static int framework_locked = 0;
 
 #endif
 
+/// Callback function invocations in progress
+static cpi_invocation_t *invocations = NULL;
+
+#endif
+
 /// Fatal error handler, or NULL for default 
 static cp_fatal_error_func_t fatal_error_handler = NULL;
 
+/// Memory allocation function, or NULL for the system allocator
+static cp_malloc_func_t malloc_func = NULL;
+
+/// Memory reallocation function, or NULL for the system allocator
+static cp_realloc_func_t realloc_func = NULL;
+
+/// Memory release function, or NULL for the system allocator
+static cp_free_func_t free_func = NULL;
+
+/// User data passed to the allocator functions
+static void *allocator_data = NULL;
+
+/// Free lists of released small objects, one per size class
+static cpi_pool_node_t *pools[CP_POOL_CLASSES];
+
+/// Number of objects on each free list
+static unsigned int pool_sizes[CP_POOL_CLASSES];
+
+#ifdef CP_THREADS
+
+/// Mutex protecting the small object free lists
+static cpi_mutex_t *pool_mutex = NULL;
+
+#else
+
+/// Whether the small object free lists are in use
+static int pools_enabled = 0;
+
+#endif
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
@@ -98,12 +167,216 @@ CP_HIDDEN void cpi_unlock_framework(void) {
 #endif
 }
 
+#ifdef CP_THREADS
+
+CP_HIDDEN void cpi_prepare_framework_fork(void) {
+	cpi_lock_mutex(framework_mutex);
+	cpi_lock_mutex(pool_mutex);
+}
+
+CP_HIDDEN void cpi_after_framework_fork(int child) {
+	if (child) {
+		cpi_reset_mutex(framework_mutex);
+		cpi_reset_mutex(pool_mutex);
+	}
+	cpi_unlock_mutex(pool_mutex);
+	cpi_unlock_mutex(framework_mutex);
+}
+
+#endif
+
+CP_HIDDEN void cpi_begin_invocation(cp_plugin_env_t *env, cpi_invocation_t *inv, int cf) {
+	inv->env = env;
+	inv->cf = cf;
+#ifdef CP_THREADS
+	inv->enclosing = cpi_get_tls(invocations);
+	cpi_set_tls(invocations, inv);
+#else
+	inv->enclosing = invocations;
+	invocations = inv;
+#endif
+}
+
+CP_HIDDEN void cpi_end_invocation(cpi_invocation_t *inv) {
+#ifdef CP_THREADS
+	assert(cpi_get_tls(invocations) == inv);
+	cpi_set_tls(invocations, inv->enclosing);
+#else
+	assert(invocations == inv);
+	invocations = inv->enclosing;
+#endif
+}
+
+CP_HIDDEN int cpi_in_invocation(cp_plugin_env_t *env, int funcmask) {
+	cpi_invocation_t *inv;
+	int cf = 0;
+	
+#ifdef CP_THREADS
+	inv = cpi_get_tls(invocations);
+#else
+	inv = invocations;
+#endif
+	for (; inv != NULL; inv = inv->enclosing) {
+		if (inv->env == env) {
+			cf |= inv->cf;
+		}
+	}
+	return cf & funcmask;
+}
+
+CP_HIDDEN void *cpi_malloc(size_t size) {
+	if (malloc_func != NULL) {
+		return malloc_func(size, allocator_data);
+	} else {
+		return malloc(size);
+	}
+}
+
+CP_HIDDEN void *cpi_calloc(size_t nmemb, size_t size) {
+	void *ptr;
+	
+	if (size != 0 && nmemb > ((size_t) -1) / size) {
+		return NULL;
+	}
+	if ((ptr = cpi_malloc(nmemb * size)) != NULL) {
+		memset(ptr, 0, nmemb * size);
+	}
+	return ptr;
+}
+
+CP_HIDDEN void *cpi_realloc(void *ptr, size_t size) {
+	if (realloc_func != NULL) {
+		return realloc_func(ptr, size, allocator_data);
+	} else {
+		return realloc(ptr, size);
+	}
+}
+
+CP_HIDDEN void cpi_free(void *ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	if (free_func != NULL) {
+		free_func(ptr, allocator_data);
+	} else {
+		free(ptr);
+	}
+}
+
+CP_HIDDEN char *cpi_strdup(const char *str) {
+	size_t len = strlen(str) + 1;
+	char *dup;
+	
+	if ((dup = cpi_malloc(len)) != NULL) {
+		memcpy(dup, str, len);
+	}
+	return dup;
+}
+
+CP_HIDDEN void *cpi_pool_alloc(size_t size) {
+	cpi_pool_node_t *node = NULL;
+	size_t c;
+	
+	assert(size > 0);
+	c = (size - 1) / CP_POOL_GRANULARITY;
+	if (c >= CP_POOL_CLASSES) {
+		return cpi_malloc(size);
+	}
+	
+	// Reuse a released object of the same size class, if any
+#ifdef CP_THREADS
+	if (pool_mutex != NULL) {
+		cpi_lock_mutex(pool_mutex);
+		if ((node = pools[c]) != NULL) {
+			pools[c] = node->next;
+			pool_sizes[c]--;
+		}
+		cpi_unlock_mutex(pool_mutex);
+	}
+#else
+	if (pools_enabled && (node = pools[c]) != NULL) {
+		pools[c] = node->next;
+		pool_sizes[c]--;
+	}
+#endif
+	if (node != NULL) {
+		return node;
+	}
+	
+	// Objects are always allocated with the size of their class
+	return cpi_malloc((c + 1) * CP_POOL_GRANULARITY);
+}
+
+CP_HIDDEN void cpi_pool_free(void *ptr, size_t size) {
+	cpi_pool_node_t *node = ptr;
+	size_t c;
+	
+	if (ptr == NULL) {
+		return;
+	}
+	assert(size > 0);
+	c = (size - 1) / CP_POOL_GRANULARITY;
+	if (c < CP_POOL_CLASSES) {
+#ifdef CP_THREADS
+		if (pool_mutex != NULL) {
+			cpi_lock_mutex(pool_mutex);
+			if (pool_sizes[c] < CP_POOL_MAX_FREE) {
+				node->next = pools[c];
+				pools[c] = node;
+				pool_sizes[c]++;
+				node = NULL;
+			}
+			cpi_unlock_mutex(pool_mutex);
+		}
+#else
+		if (pools_enabled && pool_sizes[c] < CP_POOL_MAX_FREE) {
+			node->next = pools[c];
+			pools[c] = node;
+			pool_sizes[c]++;
+			node = NULL;
+		}
+#endif
+	}
+	cpi_free(node);
+}
+
+/**
+ * Releases the objects on the small object free lists and disables
+ * the free lists.
+ */
+static void drain_pools(void) {
+	int i;
+	
+#ifdef CP_THREADS
+	if (pool_mutex != NULL) {
+		cpi_destroy_mutex(pool_mutex);
+		pool_mutex = NULL;
+	}
+#else
+	pools_enabled = 0;
+#endif
+	for (i = 0; i < CP_POOL_CLASSES; i++) {
+		while (pools[i] != NULL) {
+			cpi_pool_node_t *node = pools[i];
+			
+			pools[i] = node->next;
+			cpi_free(node);
+		}
+		pool_sizes[i] = 0;
+	}
+}
+
 static void reset(void) {
+	drain_pools();
 #ifdef CP_THREADS
 	if (framework_mutex != NULL) {
 		cpi_destroy_mutex(framework_mutex);
 		framework_mutex = NULL;
 	}
+	if (invocations != NULL) {
+		cpi_destroy_tls(invocations);
+		invocations = NULL;
+	}
 #endif
 }
 
@@ -115,10 +388,14 @@ CP_C_API cp_status_t cp_init(void) {
 		if (!initialized) {
 			bindtextdomain(PACKAGE, CP_DATADIR CP_FNAMESEP_STR "locale");
 #ifdef CP_THREADS
-			if ((framework_mutex = cpi_create_mutex()) == NULL) {
+			if ((framework_mutex = cpi_create_mutex()) == NULL
+				|| (invocations = cpi_create_tls()) == NULL
+				|| (pool_mutex = cpi_create_mutex()) == NULL) {
 				status = CP_ERR_RESOURCE;
 				break;
 			}
+#else
+			pools_enabled = 1;
 #endif
 #ifdef DLOPEN_LIBTOOL
 			if (lt_dlinit()) {
@@ -150,8 +427,11 @@ CP_C_API void cp_destroy(void) {
 		assert(!framework_locked);
 #endif
 		cpi_destroy_all_contexts();
+		cpi_free_shared_descriptors();
 #ifdef DLOPEN_LIBTOOL
-		lt_dlexit();
+		if (!cpi_has_exited_contexts()) {
+			lt_dlexit();
+		}
 #endif
 		reset();
 	}
@@ -161,6 +441,23 @@ CP_C_API void cp_set_fatal_error_handler(cp_fatal_error_func_t error_handler) {
 	fatal_error_handler = error_handler;
 }
 
+CP_C_API void cp_set_allocator(cp_malloc_func_t mallocf, cp_realloc_func_t reallocf, cp_free_func_t freef, void *user_data) {
+	if (initialized) {
+		cpi_fatalf(_("Attempt to change the allocator of an initialized framework."));
+	}
+	if (mallocf != NULL && reallocf != NULL && freef != NULL) {
+		malloc_func = mallocf;
+		realloc_func = reallocf;
+		free_func = freef;
+		allocator_data = user_data;
+	} else {
+		malloc_func = NULL;
+		realloc_func = NULL;
+		free_func = NULL;
+		allocator_data = NULL;
+	}
+}
+
 CP_C_API void cpi_fatalf(const char *msg, ...) {
 	va_list params;
 	char fmsg[256];
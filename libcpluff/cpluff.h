@@ -38,6 +38,7 @@
  * Preprocessor defines.
  */
  
+#include <stddef.h>
 #include <cpluffdef.h>
 
 #ifdef __cplusplus
@@ -61,6 +62,16 @@ extern "C" {
 #define CP_C_API CP_IMPORT
 #endif
 
+/**
+ * @def CP_CFG_RECORD_ALIGN
+ * @ingroup cDefines
+ *
+ * The alignment, in bytes, of the configuration records built for
+ * extensions according to a configuration schema (see
+ * ::cp_register_cfg_schema). Records are aligned to a cache line.
+ */
+#define CP_CFG_RECORD_ALIGN 64
+
 
 /**
  * @defgroup cScanFlags Flags for plug-in scanning
@@ -96,6 +107,202 @@ extern "C" {
  */
 #define CP_SP_RESTART_ACTIVE 0x08
 
+/**
+ * This flag restricts the scan to plug-ins that have been added or modified
+ * since the previous scan by the same plug-in loader. Plug-in loaders that
+ * do not support incremental scanning, see ::cp_set_ploader_scan_changes,
+ * are scanned fully.
+ */
+#define CP_SP_INCREMENTAL 0x10
+
+/**
+ * This flag limits the plug-ins stopped for an upgrade to the upgraded
+ * plug-ins and the active plug-ins importing them, directly or indirectly.
+ * Other active plug-ins keep running. The stopped plug-ins are restarted
+ * after the upgrade, concurrently where they do not depend on each other.
+ * This flag has no effect together with #CP_SP_STOP_ALL_ON_UPGRADE or
+ * #CP_SP_STOP_ALL_ON_INSTALL.
+ */
+#define CP_SP_RESTART_AFFECTED 0x20
+
+/*@}*/
+
+/**
+ * @defgroup cInstallFlags Flags for plug-in installation
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the flags
+ * parameter of ::cp_install_plugins.
+ */
+/*@{*/
+
+/**
+ * This flag makes a batch installation all or nothing. If any of the
+ * plug-ins can not be installed then none of them are installed.
+ */
+#define CP_IP_ATOMIC 0x01
+
+/*@}*/
+
+/**
+ * @defgroup cListenerFlags Flags for batch plug-in listeners
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the flags
+ * parameter of ::cp_register_plistener_batch.
+ */
+/*@{*/
+
+/**
+ * This flag collapses the events of a single batch concerning the same
+ * plug-in into one event from the first old state to the last new state.
+ * For example, RESOLVED to STARTING followed by STARTING to ACTIVE is
+ * reported as RESOLVED to ACTIVE. Events for plug-ins that end up in their
+ * original state are left out.
+ */
+#define CP_PLF_COALESCE 0x01
+
+/*@}*/
+
+/**
+ * @defgroup cAsyncLoggingFlags Flags for asynchronous logging
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the flags
+ * parameter of ::cp_set_async_logging.
+ */
+/*@{*/
+
+/**
+ * This flag makes a thread logging a message wait for space in a full
+ * logging ring. By default messages that do not fit are dropped and
+ * counted, see ::cp_get_dropped_log_messages.
+ */
+#define CP_AL_BLOCK 0x01
+
+/*@}*/
+
+/**
+ * @defgroup cStateMasks Plug-in state masks
+ * @ingroup cDefines
+ *
+ * These macros build the state mask parameter of
+ * ::cp_register_plistener_filtered. Masks can be orred together.
+ */
+/*@{*/
+
+/** The mask selecting changes to the specified new plug-in state */
+#define CP_STATE_MASK(state) (1 << (state))
+
+/** The mask selecting all plug-in state changes */
+#define CP_STATE_MASK_ALL (~0)
+
+/*@}*/
+
+/**
+ * The current version of the @ref cp_symbol_table_t structure.
+ * @ingroup cDefines
+ */
+#define CP_SYMBOL_TABLE_VERSION 1
+
+/**
+ * Returns a value for a @ref cp_run_func_t "run function" to return when
+ * it should be called again after the specified delay in microseconds,
+ * at most INT_MAX. A delay of zero requests the run function to be called
+ * again without delay, like any other non-zero value.
+ * @ingroup cDefines
+ */
+#define CP_RUN_AFTER(delay_us) (-1 - (int) (delay_us))
+
+/**
+ * @defgroup cPrefetchFlags Flags for runtime library prefetch
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the flags
+ * parameter of ::cp_prefetch_plugins.
+ */
+/*@{*/
+
+/**
+ * This flag makes the prefetch also load the runtime libraries. The
+ * loaded libraries are then used when the plug-ins are resolved.
+ */
+#define CP_PF_DLOPEN 0x01
+
+/*@}*/
+
+/**
+ * @defgroup cCompactFlags Flags for context compaction
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the flags
+ * parameter of ::cp_compact_context.
+ */
+/*@{*/
+
+/**
+ * This flag makes the compaction shrink the registry hash tables of the
+ * plug-in environment to fit the registered entries.
+ */
+#define CP_CC_REGISTRIES 0x01
+
+/**
+ * This flag makes the compaction copy the descriptions of installed and
+ * resolved plug-ins into single memory blocks of the exact size.
+ */
+#define CP_CC_DESCRIPTORS 0x02
+
+/**
+ * This flag makes the compaction replace the configuration trees of
+ * installed and resolved plug-ins by their markup. The trees are parsed
+ * again when accessed through ::cp_get_extension_cfg. Implies
+ * @ref CP_CC_DESCRIPTORS.
+ */
+#define CP_CC_CFG 0x04
+
+/*@}*/
+
+/**
+ * @defgroup cCloneFlags Flags for context cloning
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the flags
+ * parameter of ::cp_clone_context.
+ */
+/*@{*/
+
+/**
+ * This flag makes the cloning also start the plug-ins that are active in
+ * the source context, in the order they were started there.
+ */
+#define CP_CL_START 0x01
+
+/*@}*/
+
+/**
+ * @defgroup cPloaderFlags Flags for plug-in loader registration
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the flags
+ * parameter of ::cp_register_ploader_flags.
+ */
+/*@{*/
+
+/**
+ * This flag declares the scanning functions of the plug-in loader
+ * thread-safe. ::cp_scan_plugins may then call them in a separate thread
+ * without holding the plug-in context lock, concurrently with the scanning
+ * of the other plug-in loaders registered with the same context. The
+ * functions may use the plug-in framework API, such as
+ * ::cp_load_plugin_descriptor, but they must synchronize any access to
+ * loader data shared with other threads. The plug-in collections of the
+ * context are not changed and plug-in loaders are not unregistered while
+ * loaders are being scanned concurrently. Without this flag the scanning
+ * functions are always called by the thread calling ::cp_scan_plugins
+ * while it holds the context lock.
+ */
+#define CP_PLR_THREAD_SAFE 0x01
+
 /*@}*/
 
 
@@ -254,6 +461,125 @@ enum cp_log_severity_t {
 	
 };
 
+/**
+ * An enumeration of the types of arguments carried by a
+ * @ref cp_log_record_t "structured log record".
+ */
+enum cp_log_arg_type_t {
+	
+	/** A signed integer for a d, i or c conversion, stored in i */
+	CP_LOG_ARG_INT,
+	
+	/** An unsigned integer for a u, o, x or X conversion, stored in u */
+	CP_LOG_ARG_UINT,
+	
+	/** A string for an s conversion, stored in s */
+	CP_LOG_ARG_STRING,
+	
+	/** A pointer for a p conversion, stored in p */
+	CP_LOG_ARG_POINTER
+	
+};
+
+/**
+ * An enumeration of the framework events reported to the
+ * @ref cp_trace_hook_func_t "trace hook". The same events are available
+ * as USDT static probes of provider @c cpluff if the framework was built
+ * with probe support. The probe names are the lower case constant names
+ * without the @c CP_TRACE_ prefix, for example @c start_begin, and the
+ * probe arguments are the plug-in context pointer followed by the
+ * plug-in identifier, name, status and duration members of the
+ * corresponding @ref cp_trace_record_t "trace record".
+ */
+enum cp_trace_event_t {
+	
+	/** Loading of a plug-in descriptor begins, the name is the plug-in path */
+	CP_TRACE_LOAD_BEGIN,
+	
+	/** Loading of a plug-in descriptor has ended, the name is the plug-in path */
+	CP_TRACE_LOAD_END,
+	
+	/** A plug-in has been installed */
+	CP_TRACE_INSTALL,
+	
+	/** Resolving of a plug-in begins */
+	CP_TRACE_RESOLVE_BEGIN,
+	
+	/** Resolving of a plug-in has ended */
+	CP_TRACE_RESOLVE_END,
+	
+	/** Loading of a plug-in runtime library begins, the name is the library name */
+	CP_TRACE_DLOPEN_BEGIN,
+	
+	/** Loading of a plug-in runtime library has ended, the name is the library name */
+	CP_TRACE_DLOPEN_END,
+	
+	/** The plug-in create function is about to be called */
+	CP_TRACE_CREATE_BEGIN,
+	
+	/** The plug-in create function has returned */
+	CP_TRACE_CREATE_END,
+	
+	/** The plug-in start function is about to be called */
+	CP_TRACE_START_BEGIN,
+	
+	/** The plug-in start function has returned */
+	CP_TRACE_START_END,
+	
+	/** The plug-in stop function is about to be called */
+	CP_TRACE_STOP_BEGIN,
+	
+	/** The plug-in stop function has returned */
+	CP_TRACE_STOP_END,
+	
+	/** The plug-in destroy function is about to be called */
+	CP_TRACE_DESTROY_BEGIN,
+	
+	/** The plug-in destroy function has returned */
+	CP_TRACE_DESTROY_END,
+	
+	/** A symbol of the plug-in has been resolved, the name is the symbol name */
+	CP_TRACE_SYMBOL_RESOLVE,
+	
+	/** A resolved symbol of the plug-in has been released */
+	CP_TRACE_SYMBOL_RELEASE,
+	
+	/** A run function of the plug-in is about to be called */
+	CP_TRACE_RUN_BEGIN,
+	
+	/** A run function of the plug-in has returned */
+	CP_TRACE_RUN_END,
+	
+	/** A thread had to wait for the context lock, the duration is the wait time */
+	CP_TRACE_LOCK_WAIT
+	
+};
+
+/**
+ * An enumeration of the value types of the fields of a
+ * @ref cp_cfg_schema_t "configuration schema". The type determines how
+ * the configuration value is converted and the C type of the record
+ * member it is stored in.
+ */
+enum cp_cfg_type_t {
+	
+	/** An interned string, stored as const char * */
+	CP_CFG_STRING,
+	
+	/** A decimal, octal or hexadecimal integer, stored as long */
+	CP_CFG_INT,
+	
+	/** A floating point number, stored as double */
+	CP_CFG_DOUBLE,
+	
+	/** A boolean "true", "false", "1" or "0", stored as int */
+	CP_CFG_BOOL,
+	
+	/** One of the listed enumeration values, stored as the int index of the value */
+	CP_CFG_ENUM
+	
+};
+
 /*@}*/
 
 
@@ -280,6 +606,30 @@ enum cp_log_severity_t {
  */
 typedef struct cp_context_t cp_context_t;
 
+/**
+ * A compiled configuration path. A configuration path is compiled using
+ * ::cp_compile_cfg_path and it can then be used repeatedly with
+ * ::cp_lookup_cfg_compiled and ::cp_lookup_cfg_value_compiled without
+ * parsing the path again.
+ */
+typedef struct cp_cfg_path_t cp_cfg_path_t;
+
+/**
+ * An index of the extensions of an extension point by the value of a
+ * configuration attribute or element. An index is created using
+ * ::cp_create_extension_index and the framework keeps it up to date as
+ * extensions are installed and uninstalled.
+ */
+typedef struct cp_extension_index_t cp_extension_index_t;
+
+/**
+ * A stable handle to the state of a plug-in. A handle is obtained for a
+ * plug-in identifier using ::cp_get_plugin_handle and its state can then
+ * be polled using ::cp_get_plugin_handle_state without looking up the
+ * plug-in or contending for the plug-in context.
+ */
+typedef struct cp_plugin_handle_t cp_plugin_handle_t;
+
 /*@}*/
 
  /**
@@ -304,12 +654,66 @@ typedef struct cp_extension_t cp_extension_t;
 /** A type for cp_cfg_element_t structure. */
 typedef struct cp_cfg_element_t cp_cfg_element_t;
 
+/** A type for cp_cfg_stream_t structure. */
+typedef struct cp_cfg_stream_t cp_cfg_stream_t;
+
+/** A type for cp_cfg_field_t structure. */
+typedef struct cp_cfg_field_t cp_cfg_field_t;
+
+/** A type for cp_cfg_schema_t structure. */
+typedef struct cp_cfg_schema_t cp_cfg_schema_t;
+
 /** A type for cp_plugin_runtime_t structure. */
 typedef struct cp_plugin_runtime_t cp_plugin_runtime_t;
 
 /** A type for cp_plugin_loader_t structure. */
 typedef struct cp_plugin_loader_t cp_plugin_loader_t;
 
+/** A type for cp_symbol_export_t structure. */
+typedef struct cp_symbol_export_t cp_symbol_export_t;
+
+/** A type for cp_symbol_table_t structure. */
+typedef struct cp_symbol_table_t cp_symbol_table_t;
+
+/** A type for cp_symbol_key_t structure. */
+typedef struct cp_symbol_key_t cp_symbol_key_t;
+
+/** A type for cp_extensions_snapshot_t structure. */
+typedef struct cp_extensions_snapshot_t cp_extensions_snapshot_t;
+
+/** A type for cp_timing_t structure. */
+typedef struct cp_timing_t cp_timing_t;
+
+/** A type for cp_plugin_timings_t structure. */
+typedef struct cp_plugin_timings_t cp_plugin_timings_t;
+
+/** A type for cp_timings_summary_t structure. */
+typedef struct cp_timings_summary_t cp_timings_summary_t;
+
+/** A type for cp_memory_stats_t structure. */
+typedef struct cp_memory_stats_t cp_memory_stats_t;
+
+/** A type for cp_registry_stats_t structure. */
+typedef struct cp_registry_stats_t cp_registry_stats_t;
+
+/** A type for cp_lock_stats_t structure. */
+typedef struct cp_lock_stats_t cp_lock_stats_t;
+
+/** A type for cp_lock_holder_stats_t structure. */
+typedef struct cp_lock_holder_stats_t cp_lock_holder_stats_t;
+
+/** A type for cp_plugin_event_t structure. */
+typedef struct cp_plugin_event_t cp_plugin_event_t;
+
+/** A type for cp_log_arg_t structure. */
+typedef struct cp_log_arg_t cp_log_arg_t;
+
+/** A type for cp_log_record_t structure. */
+typedef struct cp_log_record_t cp_log_record_t;
+
+/** A type for cp_trace_record_t structure. */
+typedef struct cp_trace_record_t cp_trace_record_t;
+
 /** A type for cp_status_t enumeration. */
 typedef enum cp_status_t cp_status_t;
 
@@ -319,6 +723,15 @@ typedef enum cp_plugin_state_t cp_plugin_state_t;
 /** A type for cp_log_severity_t enumeration. */
 typedef enum cp_log_severity_t cp_log_severity_t;
 
+/** A type for cp_log_arg_type_t enumeration. */
+typedef enum cp_log_arg_type_t cp_log_arg_type_t;
+
+/** A type for cp_trace_event_t enumeration. */
+typedef enum cp_trace_event_t cp_trace_event_t;
+
+/** A type for cp_cfg_type_t enumeration. */
+typedef enum cp_cfg_type_t cp_cfg_type_t;
+
 /*@}*/
 
 /**
@@ -334,7 +747,8 @@ typedef enum cp_log_severity_t cp_log_severity_t;
  * @ref cFuncsInit "Library initialization",
  * @ref cFuncsContext "plug-in context management",
  * @ref cFuncsPlugin "plug-in management",
- * listener registration (::cp_register_plistener and ::cp_unregister_plistener)
+ * listener registration (::cp_register_plistener, ::cp_unregister_plistener
+ * and their batch counterparts)
  * and @ref cFuncsSymbols "dynamic symbol" functions must not be called from
  * within a plug-in listener invocation. Listener functions are registered
  * using ::cp_register_plistener.
@@ -346,11 +760,46 @@ typedef enum cp_log_severity_t cp_log_severity_t;
  */
 typedef void (*cp_plugin_listener_func_t)(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data);
 
+/**
+ * A listener function called asynchronously with a batch of plugin state
+ * changes. The events are delivered in the order the changes occurred by
+ * a framework dispatcher thread without the plug-in context being locked,
+ * so the plug-in state may have changed further by the time the listener
+ * is called and other threads are not blocked by a slow listener. Events
+ * delivered synchronously, as described at ::cp_register_plistener_batch,
+ * are delivered with the context locked. The same restrictions apply
+ * as for @ref cp_plugin_listener_func_t "plug-in listeners". The
+ * event array is only valid for the duration of the call. Batch listener
+ * functions are registered using ::cp_register_plistener_batch.
+ * 
+ * @param events the plug-in events
+ * @param num_events the number of events
+ * @param user_data the user data pointer supplied at listener registration
+ */
+typedef void (*cp_plugin_batch_listener_func_t)(const cp_plugin_event_t *events, int num_events, void *user_data);
+
+/**
+ * A completion callback called when an asynchronous plug-in start or stop
+ * requested using ::cp_start_plugin_async or ::cp_stop_plugin_async has
+ * finished. The callback is usually called by a framework worker thread
+ * without the plug-in context being locked. It may call framework
+ * functions except ::cp_destroy_context and ::cp_destroy.
+ * 
+ * @param plugin_id the plug-in identifier
+ * @param status the final status of the operation, as returned by ::cp_start_plugin or ::cp_stop_plugin
+ * @param user_data the user data pointer supplied with the request
+ */
+typedef void (*cp_plugin_op_func_t)(const char *plugin_id, cp_status_t status, void *user_data);
+
 /**
  * A logger function called to log selected plug-in framework messages. The
  * messages may be localized. Plug-in framework API functions must not
  * be called from within a logger function invocation. In a multi-threaded
- * environment logger function invocations are serialized by the framework.
+ * environment logger function invocations are serialized by the framework
+ * unless concurrent logging has been enabled using
+ * ::cp_set_concurrent_logging. If asynchronous logging has been enabled
+ * using ::cp_set_async_logging, logger functions are called by a framework
+ * logging thread some time after the message was logged.
  * Logger functions are registered using ::cp_register_logger.
  *
  * @param severity the severity of the message
@@ -360,6 +809,32 @@ typedef void (*cp_plugin_listener_func_t)(const char *plugin_id, cp_plugin_state
  */
 typedef void (*cp_logger_func_t)(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data);
 
+/**
+ * A structured logger function called with the unformatted log record of
+ * selected plug-in framework messages. The message text is not formatted
+ * unless the logger calls ::cp_render_log_record. The record is only valid
+ * for the duration of the call. Otherwise the same rules apply as for
+ * @ref cp_logger_func_t "logger functions". Structured logger functions
+ * are registered using ::cp_register_structured_logger.
+ *
+ * @param record the log record
+ * @param user_data the user data pointer given when the logger was registered
+ */
+typedef void (*cp_structured_logger_func_t)(const cp_log_record_t *record, void *user_data);
+
+/**
+ * A trace hook function called at key framework events, such as plug-in
+ * lifecycle transitions and context lock waits. The hook is usually called
+ * with the plug-in context locked and it may be called concurrently by
+ * several threads. Plug-in framework API functions must not be called from
+ * within a trace hook invocation. The record is only valid for the duration
+ * of the call. The trace hook is set using ::cp_set_trace_hook.
+ *
+ * @param record the trace record
+ * @param user_data the user data pointer given when the hook was set
+ */
+typedef void (*cp_trace_hook_func_t)(const cp_trace_record_t *record, void *user_data);
+
 /**
  * A fatal error handler for handling unrecoverable errors. If the error
  * handler returns then the framework aborts the program. Plug-in framework
@@ -371,10 +846,57 @@ typedef void (*cp_logger_func_t)(cp_log_severity_t severity, const char *msg, co
  */
 typedef void (*cp_fatal_error_func_t)(const char *msg);
 
+/**
+ * A memory allocation function used by the framework instead of the
+ * system allocator. The allocator is set using ::cp_set_allocator.
+ *
+ * @param size the number of bytes to allocate
+ * @param user_data the user data pointer given when the allocator was set
+ * @return the allocated memory or NULL if memory allocation failed
+ */
+typedef void *(*cp_malloc_func_t)(size_t size, void *user_data);
+
+/**
+ * A memory reallocation function used by the framework instead of the
+ * system allocator. It must behave like the standard realloc function.
+ *
+ * @param ptr the memory to be resized or NULL
+ * @param size the new size in bytes
+ * @param user_data the user data pointer given when the allocator was set
+ * @return the resized memory or NULL if memory allocation failed
+ */
+typedef void *(*cp_realloc_func_t)(void *ptr, size_t size, void *user_data);
+
+/**
+ * A memory release function used by the framework instead of the
+ * system allocator. The framework never passes a NULL pointer.
+ *
+ * @param ptr the memory to be released
+ * @param user_data the user data pointer given when the allocator was set
+ */
+typedef void (*cp_free_func_t)(void *ptr, void *user_data);
+
+/**
+ * An incremental scanning function of a plug-in loader, called instead of
+ * the @a scan_plugins function of the loader when ::cp_scan_plugins is
+ * called with #CP_SP_INCREMENTAL. Loads and returns plug-in descriptors
+ * only for those plug-ins that have been added or modified since the
+ * previous scan by the loader. The returned data is released by calling
+ * the @a release_plugins function of the loader. Incremental scanning
+ * functions are set using ::cp_set_ploader_scan_changes.
+ *
+ * @param data plug-in loader data
+ * @param ctx the associated plug-in context
+ * @return pointer to a NULL-terminated array of plug-in information pointers, or NULL on failure
+ */
+typedef cp_plugin_info_t **(*cp_scan_changes_func_t)(void *data, cp_context_t *ctx);
+
 /**
  * A run function registered by a plug-in to perform work.
  * The run function  should perform a finite chunk of work and it should
- * return a non-zero value if there is more work to be done. Run functions
+ * return a non-zero value if there is more work to be done. A value
+ * returned by @ref CP_RUN_AFTER makes the run function wait for the given
+ * delay before it is called again. Run functions
  * are registered using ::cp_run_function and the usage is discussed in
  * more detail in the @ref cFuncsPluginExec "serial execution" section.
  * 
@@ -383,6 +905,30 @@ typedef void (*cp_fatal_error_func_t)(const char *msg);
  */
 typedef int (*cp_run_func_t)(void *plugin_data);
 
+/**
+ * A visitor function called for each plug-in by ::cp_foreach_plugin. The
+ * plug-in information is only valid during the invocation unless the
+ * visitor takes a reference to it using ::cp_get_plugin_info. Plug-in
+ * management functions must not be called from within a visitor
+ * invocation while information and symbol functions can be called.
+ * 
+ * @param plugin the plug-in information
+ * @param user_data the user data pointer supplied to ::cp_foreach_plugin
+ * @return zero to continue the iteration or non-zero to stop it
+ */
+typedef int (*cp_plugin_visitor_func_t)(const cp_plugin_info_t *plugin, void *user_data);
+
+/**
+ * A visitor function called for each extension by ::cp_foreach_extension.
+ * The extension is only valid during the invocation. The same restrictions
+ * apply as for @ref cp_plugin_visitor_func_t.
+ * 
+ * @param extension the extension
+ * @param user_data the user data pointer supplied to ::cp_foreach_extension
+ * @return zero to continue the iteration or non-zero to stop it
+ */
+typedef int (*cp_extension_visitor_func_t)(const cp_extension_t *extension, void *user_data);
+
 /*@}*/
 
 
@@ -523,6 +1069,26 @@ struct cp_plugin_info_t {
 	 */
 	cp_extension_t *extensions;
 
+	/**
+	 * The symbol pointing to the static symbol export table of the plug-in
+	 * runtime library, or NULL if none. The symbol with this name should
+	 * point to an instance of @ref cp_symbol_table_t structure. This
+	 * corresponds to the @a symbols attribute of the @a runtime element in
+	 * a plug-in descriptor.
+	 */
+	char *runtime_symbols_symbol;
+
+	/**
+	 * Whether the plug-in is activated lazily. 1 for lazy and 0 for eager
+	 * activation. A lazily activated plug-in is not started together with
+	 * the plug-ins importing it, nor when all installed plug-ins are started
+	 * using ::cp_start_plugins_parallel. It stays resolved until it is
+	 * started explicitly or until a symbol it defines is first resolved
+	 * using ::cp_resolve_symbol. This corresponds to the @a activation
+	 * attribute of the @a runtime element in a plug-in descriptor.
+	 */
+	int lazy_activation;
+
 };
 
 /**
@@ -709,20 +1275,143 @@ struct cp_cfg_element_t {
 
 /**
  * @ingroup cStructs
- * Container for plug-in runtime information. A plug-in runtime defines a
- * static instance of this structure to pass information to the plug-in
- * framework. The plug-in framework then uses the information
- * to create and control plug-in instances. The symbol pointing
- * to the runtime information instance is named by the @a funcs
- * attribute of the @a runtime element in a plug-in descriptor.
- * 
- * The following graph displays how these functions are used to control the
- * state of the plug-in instance. 
+ * Streaming consumer of extension configuration, registered for an
+ * extension point using ::cp_register_cfg_stream. While parsing a plug-in
+ * descriptor, the framework passes the configuration of each extension
+ * attached to the extension point to the consumer as parsing events
+ * instead of building a configuration element tree. The configuration of
+ * such an extension only contains the @a extension element itself, without
+ * children or value.
  * 
- * @dot
- * digraph lifecycle {
- *   rankdir=LR;
- *   node [shape=ellipse, fontname=Helvetica, fontsize=10];
+ * The events are delivered from the thread parsing the descriptor without
+ * the framework holding any locks, so events for different descriptors may
+ * be delivered concurrently. The extension passed to the functions is
+ * still being constructed and is only valid during the call; its plug-in
+ * has not been installed yet and may fail to install later. Any function
+ * pointer can be NULL if the consumer is not interested in those events.
+ * A function returns zero on success and non-zero to reject the
+ * configuration, in which case the descriptor is reported as malformed.
+ */
+struct cp_cfg_stream_t {
+	
+	/**
+	 * Called at the start of each configuration element, starting with
+	 * the @a extension element itself at depth zero.
+	 * 
+	 * @param user_data the user data pointer given at registration
+	 * @param ext the extension being parsed
+	 * @param name the element name
+	 * @param atts the NULL-terminated list of alternating attribute names and values
+	 * @param depth the depth of the element below the extension element
+	 * @return zero on success or non-zero to reject the configuration
+	 */
+	int (*start_element)(void *user_data, const cp_extension_t *ext, const char *name, const char * const *atts, int depth);
+	
+	/**
+	 * Called for character data within a configuration element. The data
+	 * is not NUL-terminated and the character data of an element may be
+	 * passed on in several calls. Whitespace is passed on as is.
+	 * 
+	 * @param user_data the user data pointer given at registration
+	 * @param ext the extension being parsed
+	 * @param text the character data
+	 * @param len the length of the character data
+	 * @return zero on success or non-zero to reject the configuration
+	 */
+	int (*text)(void *user_data, const cp_extension_t *ext, const char *text, int len);
+	
+	/**
+	 * Called at the end of each configuration element, ending with the
+	 * @a extension element itself at depth zero.
+	 * 
+	 * @param user_data the user data pointer given at registration
+	 * @param ext the extension being parsed
+	 * @param name the element name
+	 * @param depth the depth of the element below the extension element
+	 * @return zero on success or non-zero to reject the configuration
+	 */
+	int (*end_element)(void *user_data, const cp_extension_t *ext, const char *name, int depth);
+	
+};
+
+/**
+ * @ingroup cStructs
+ * A field of a @ref cp_cfg_schema_t "configuration schema". The field
+ * designates a configuration value of an extension and the record member
+ * its converted value is stored in.
+ */
+struct cp_cfg_field_t {
+	
+	/**
+	 * The path of the configuration value relative to the root
+	 * configuration element of an extension, with the same syntax as for
+	 * ::cp_lookup_cfg_value, for example "@type".
+	 */
+	const char *path;
+	
+	/** The value type, determining the type of the record member */
+	cp_cfg_type_t type;
+	
+	/** The offset of the record member, as given by offsetof */
+	size_t offset;
+	
+	/** Whether an extension without the value is rejected */
+	int required;
+	
+	/**
+	 * The value used if the configuration does not have the value, or
+	 * NULL if the record member is then left zero. The default value is
+	 * converted like a configured value.
+	 */
+	const char *default_value;
+	
+	/**
+	 * The NULL-terminated list of accepted values for @ref CP_CFG_ENUM
+	 * fields, otherwise ignored.
+	 */
+	const char * const *values;
+	
+};
+
+/**
+ * @ingroup cStructs
+ * A configuration schema registered for an extension point using
+ * ::cp_register_cfg_schema. The framework validates the configuration of
+ * each extension attached to the extension point against the schema once,
+ * when the extension is installed, and converts it into a binary record
+ * of the consumer defined type. The consumer then reads the typed record
+ * members directly instead of looking up and parsing configuration
+ * strings.
+ */
+struct cp_cfg_schema_t {
+	
+	/** The size of the record type in bytes */
+	size_t record_size;
+	
+	/** The number of fields in the @ref fields array */
+	unsigned int num_fields;
+	
+	/** The fields of the schema */
+	const cp_cfg_field_t *fields;
+	
+};
+
+/**
+ * @ingroup cStructs
+ * Container for plug-in runtime information. A plug-in runtime defines a
+ * static instance of this structure to pass information to the plug-in
+ * framework. The plug-in framework then uses the information
+ * to create and control plug-in instances. The symbol pointing
+ * to the runtime information instance is named by the @a funcs
+ * attribute of the @a runtime element in a plug-in descriptor.
+ * 
+ * The following graph displays how these functions are used to control the
+ * state of the plug-in instance. 
+ * 
+ * @dot
+ * digraph lifecycle {
+ *   rankdir=LR;
+ *   node [shape=ellipse, fontname=Helvetica, fontsize=10];
  *   edge [fontname=Helvetica, fontsize=10];
  *   none [label="no instance"];
  *   inactive [label="inactive"];
@@ -901,6 +1590,442 @@ struct cp_plugin_loader_t {
 
 };
 
+/**
+ * A symbol exported through a static symbol export table.
+ */
+struct cp_symbol_export_t {
+
+	/** The name of the symbol */
+	const char *name;
+	
+	/** The pointer associated with the symbol */
+	void *ptr;
+
+};
+
+/**
+ * A static symbol export table of a plug-in runtime library. A plug-in may
+ * publish its symbols through a table instead of defining them at start
+ * using ::cp_define_symbol. The table is found using the symbol named by
+ * @ref cp_plugin_info_t::runtime_symbols_symbol and it is registered
+ * when the plug-in is resolved. Symbols in the table are looked up after
+ * context specific symbols and before global symbols of the runtime
+ * library.
+ */
+struct cp_symbol_table_t {
+
+	/** The version of this structure, must be #CP_SYMBOL_TABLE_VERSION */
+	int version;
+	
+	/** The number of symbols in @ref symbols */
+	unsigned int num_symbols;
+	
+	/**
+	 * An array of @ref num_symbols exported symbols sorted by name in
+	 * ascending strcmp order. Names must be unique.
+	 */
+	const cp_symbol_export_t *symbols;
+
+};
+
+/**
+ * A pre-hashed symbol name obtained using ::cp_symbol_key. Resolving a
+ * symbol by key using ::cp_resolve_symbol_by_key avoids hashing the symbol
+ * name on every resolution. The contents must not be modified by the
+ * client program.
+ */
+struct cp_symbol_key_t {
+
+	/**
+	 * The interned symbol name. It remains valid until the plug-in
+	 * framework is destroyed.
+	 */
+	const char *name;
+	
+	/** The precomputed hash value of the symbol name */
+	unsigned long hash;
+
+};
+
+/**
+ * An immutable snapshot of the extensions installed for an extension
+ * point, obtained using ::cp_get_extensions_snapshot. The snapshot is
+ * owned by the plug-in framework.
+ */
+struct cp_extensions_snapshot_t {
+
+	/**
+	 * The registry generation the snapshot was taken at, as returned by
+	 * ::cp_get_registry_generation. A different generation in a later
+	 * snapshot indicates that the installed extensions may have changed
+	 * in between.
+	 */
+	unsigned int generation;
+	
+	/** The number of extensions in @ref extensions */
+	int num_extensions;
+	
+	/**
+	 * A NULL-terminated array of @ref num_extensions extensions in
+	 * installation order.
+	 */
+	cp_extension_t * const *extensions;
+
+};
+
+/**
+ * The time interval of a plug-in lifecycle phase. The times are
+ * nanoseconds of a monotonic clock with an unspecified origin. Both
+ * times are zero if the phase has not been recorded.
+ */
+struct cp_timing_t {
+
+	/** The time when the phase began */
+	unsigned long long begin;
+	
+	/** The time when the phase ended */
+	unsigned long long end;
+
+};
+
+/**
+ * The lifecycle timeline of a plug-in, as returned by
+ * ::cp_get_plugin_timings. Timings are only recorded while enabled by
+ * ::cp_set_timings. A phase that has been executed several times
+ * holds the timing of the latest execution.
+ */
+struct cp_plugin_timings_t {
+
+	/** Parsing of the plug-in descriptor */
+	cp_timing_t parse;
+	
+	/**
+	 * Resolving of the plug-in, including the resolving of its imports
+	 * and the loading of its runtime library
+	 */
+	cp_timing_t resolve;
+	
+	/** Loading of the plug-in runtime library and runtime symbols */
+	cp_timing_t load;
+	
+	/** The plug-in create function invocation */
+	cp_timing_t create;
+	
+	/** The plug-in start function invocation */
+	cp_timing_t start;
+
+};
+
+/**
+ * A framework-wide summary of the recorded plug-in lifecycle timings, as
+ * returned by ::cp_get_timings_summary. The totals are sums of phase
+ * durations in nanoseconds over all phases recorded in the context,
+ * including those of plug-ins that have since been uninstalled. Only top
+ * level resolving is included in the resolving total so that the resolving
+ * of imports is not counted twice.
+ */
+struct cp_timings_summary_t {
+
+	/** Total time spent parsing plug-in descriptors */
+	unsigned long long parse_total;
+	
+	/** Total time spent resolving plug-ins */
+	unsigned long long resolve_total;
+	
+	/** Total time spent loading runtime libraries */
+	unsigned long long load_total;
+	
+	/** Total time spent in plug-in create functions */
+	unsigned long long create_total;
+	
+	/** Total time spent in plug-in start functions */
+	unsigned long long start_total;
+	
+	/** The earliest recorded time of any phase, or zero if none */
+	unsigned long long first;
+	
+	/** The latest recorded time of any phase, or zero if none */
+	unsigned long long last;
+
+};
+
+/**
+ * The memory used by a plug-in or by a whole plug-in environment, as
+ * returned by ::cp_get_memory_stats. Byte counts include the bookkeeping
+ * structures of the framework, such as hash and list nodes, but not the
+ * overhead of the system memory allocator. Memory allocated by the plug-in
+ * runtime itself is not included.
+ */
+struct cp_memory_stats_t {
+
+	/**
+	 * Bytes allocated for plug-in descriptions, including their
+	 * configuration trees and unused space of the allocation blocks
+	 */
+	unsigned long descriptor_bytes;
+	
+	/** The number of objects allocated for plug-in descriptions */
+	unsigned long descriptor_objects;
+	
+	/** Bytes used by parsed configuration trees, included in @a descriptor_bytes */
+	unsigned long cfg_bytes;
+	
+	/** The number of parsed configuration elements */
+	unsigned long cfg_elements;
+	
+	/** Bytes used by plug-in contexts and plug-in instance records */
+	unsigned long context_bytes;
+	
+	/** The number of plug-in contexts */
+	unsigned long contexts;
+	
+	/** Bytes used by symbols defined using ::cp_define_symbol */
+	unsigned long defined_symbol_bytes;
+	
+	/** The number of symbols defined using ::cp_define_symbol */
+	unsigned long defined_symbols;
+	
+	/** Bytes used to track symbols resolved using ::cp_resolve_symbol */
+	unsigned long resolved_symbol_bytes;
+	
+	/** The number of resolved symbols in use */
+	unsigned long resolved_symbols;
+	
+	/** Bytes used by registered plug-in listeners */
+	unsigned long listener_bytes;
+	
+	/** The number of registered plug-in listeners */
+	unsigned long listeners;
+	
+	/** Bytes used by registered loggers */
+	unsigned long logger_bytes;
+	
+	/** The number of registered loggers */
+	unsigned long loggers;
+	
+	/** Bytes used by registered run functions */
+	unsigned long run_func_bytes;
+	
+	/** The number of registered run functions */
+	unsigned long run_funcs;
+	
+	/** The total number of bytes, not counting @a cfg_bytes twice */
+	unsigned long total_bytes;
+
+};
+
+/**
+ * The sizes of the registries of a plug-in environment, as returned by
+ * ::cp_get_registry_stats. The load factor of a registry table is the
+ * number of entries divided by the number of slots.
+ */
+struct cp_registry_stats_t {
+
+	/** The number of installed plug-ins */
+	unsigned long plugins;
+	
+	/** The number of slots in the plug-in table */
+	unsigned long plugin_slots;
+	
+	/** The number of installed extension points */
+	unsigned long ext_points;
+	
+	/** The number of slots in the extension point table */
+	unsigned long ext_point_slots;
+	
+	/** The number of extension points having installed extensions */
+	unsigned long extension_lists;
+	
+	/** The number of slots in the extension table */
+	unsigned long extension_list_slots;
+	
+	/** The number of installed extensions */
+	unsigned long extensions;
+	
+	/** The number of extension indexes */
+	unsigned long extension_indexes;
+	
+	/** The number of interned strings */
+	unsigned long interned_strings;
+	
+	/**
+	 * The number of reference counted information objects in use, or zero
+	 * if the framework was built without the debugging table tracking them
+	 */
+	unsigned long infos;
+	
+	/** The number of slots in the information object table */
+	unsigned long info_slots;
+	
+	/** The number of started plug-ins */
+	unsigned long started_plugins;
+	
+	/** The number of registered run functions */
+	unsigned long run_funcs;
+	
+	/** The number of run functions queued for execution */
+	unsigned long queued_run_funcs;
+	
+	/** The current registry generation, see ::cp_get_registry_generation */
+	unsigned int generation;
+
+};
+
+/**
+ * Contention statistics of the lock protecting a plug-in environment, as
+ * returned by ::cp_get_lock_stats. Recursive locking by a thread already
+ * holding the lock is not counted. Times are in nanoseconds.
+ */
+struct cp_lock_stats_t {
+	
+	/** The number of exclusive and shared acquisitions */
+	unsigned long acquisitions;
+	
+	/** The number of acquisitions that had to wait for another thread */
+	unsigned long contended;
+	
+	/** The total time spent waiting for the lock */
+	unsigned long long wait_total;
+	
+	/** The longest single wait for the lock */
+	unsigned long long wait_max;
+	
+	/** The total time the lock was held exclusively */
+	unsigned long long hold_total;
+	
+	/** The longest single exclusive hold of the lock */
+	unsigned long long hold_max;
+	
+};
+
+/**
+ * The exclusive lock holds attributed to a single API function, as
+ * returned by ::cp_get_lock_holder_stats. Times are in nanoseconds.
+ */
+struct cp_lock_holder_stats_t {
+	
+	/**
+	 * The name of the API function that held the lock, or NULL for holds
+	 * by framework threads and internal activity not attributed to an
+	 * API function
+	 */
+	const char *function;
+	
+	/** The number of exclusive holds */
+	unsigned long holds;
+	
+	/** The total time the lock was held */
+	unsigned long long hold_total;
+	
+	/** The longest single hold */
+	unsigned long long hold_max;
+	
+};
+
+/**
+ * A plug-in state change, as delivered to
+ * @ref cp_plugin_batch_listener_func_t "batch plug-in listeners".
+ */
+struct cp_plugin_event_t {
+	
+	/** The plug-in identifier */
+	const char *plugin_id;
+	
+	/** The old plug-in state */
+	cp_plugin_state_t old_state;
+	
+	/** The new plug-in state */
+	cp_plugin_state_t new_state;
+	
+};
+
+/**
+ * An argument of a @ref cp_log_record_t "structured log record".
+ */
+struct cp_log_arg_t {
+	
+	/** The argument type selecting the valid value member */
+	cp_log_arg_type_t type;
+	
+	/** The argument value */
+	union {
+		
+		/** The value of a ::CP_LOG_ARG_INT argument */
+		long i;
+		
+		/** The value of a ::CP_LOG_ARG_UINT argument */
+		unsigned long u;
+		
+		/** The value of a ::CP_LOG_ARG_STRING argument */
+		const char *s;
+		
+		/** The value of a ::CP_LOG_ARG_POINTER argument */
+		const void *p;
+		
+	} value;
+	
+};
+
+/**
+ * A log message before formatting, as delivered to
+ * @ref cp_structured_logger_func_t "structured loggers".
+ */
+struct cp_log_record_t {
+	
+	/** The severity of the message */
+	cp_log_severity_t severity;
+	
+	/**
+	 * The format string of the message before localization. Framework
+	 * messages use constant format strings, so the pointer value
+	 * identifies the message for the lifetime of the framework library.
+	 * Messages logged using ::cp_log are passed as is.
+	 */
+	const char *format;
+	
+	/**
+	 * The possibly localized format string used for rendering the message.
+	 * If there are no arguments, this is the literal message text.
+	 */
+	const char *localized_format;
+	
+	/** The identifier of the activating plug-in or NULL for the main program */
+	const char *apid;
+	
+	/** The number of arguments */
+	int num_args;
+	
+	/** The arguments consumed by the conversions of the format string, in order */
+	const cp_log_arg_t *args;
+	
+};
+
+/**
+ * A framework event, as delivered to the
+ * @ref cp_trace_hook_func_t "trace hook".
+ */
+struct cp_trace_record_t {
+	
+	/** The event */
+	cp_trace_event_t event;
+	
+	/** The identifier of the plug-in concerned, or NULL if none or not yet known */
+	const char *plugin_id;
+	
+	/** The event specific name, or NULL if none */
+	const char *name;
+	
+	/** The status of the completed operation for end events, otherwise @ref CP_OK */
+	cp_status_t status;
+	
+	/** The monotonic time of the event in nanoseconds */
+	unsigned long long time;
+	
+	/** The wait time in nanoseconds for @ref CP_TRACE_LOCK_WAIT, otherwise zero */
+	unsigned long long duration;
+	
+};
+
 /*@}*/
 
 
@@ -970,11 +2095,29 @@ CP_C_API const char *cp_get_host_type(void) CP_GCC_PURE;
  */
 CP_C_API void cp_set_fatal_error_handler(cp_fatal_error_func_t error_handler);
 
+/**
+ * Sets the memory allocator used by the framework. All memory owned by
+ * the framework, including its internal lists and hash tables, is
+ * allocated and released using the given functions. Small internal
+ * nodes released by the framework are cached and reused until the
+ * framework is destroyed. Setting any of the functions to NULL restores
+ * the system allocator. This function is not thread-safe and it must be
+ * called before the framework is initialized or after it has been
+ * destroyed. Memory allocated by plug-in loaders for the plug-in arrays
+ * they return is not affected, see ::cp_plugin_loader_t.
+ *
+ * @param malloc_func the memory allocation function
+ * @param realloc_func the memory reallocation function
+ * @param free_func the memory release function
+ * @param user_data a user data pointer passed to the allocator functions
+ */
+CP_C_API void cp_set_allocator(cp_malloc_func_t malloc_func, cp_realloc_func_t realloc_func, cp_free_func_t free_func, void *user_data);
+
 /**
  * Initializes the plug-in framework. This function must be called
  * by the main program before calling any other plug-in framework
- * functions except @ref cFuncsFrameworkInfo "framework information" functions and
- * ::cp_set_fatal_error_handler. This function may be
+ * functions except @ref cFuncsFrameworkInfo "framework information" functions,
+ * ::cp_set_fatal_error_handler and ::cp_set_allocator. This function may be
  * called several times but it is not thread-safe. Library resources
  * should be released by calling ::cp_destroy when the framework is
  * not needed anymore.
@@ -992,13 +2135,48 @@ CP_C_API cp_status_t cp_init(void);
  * The plug-in framework is only destroyed after this function has
  * been called as many times as ::cp_init. This function is not
  * thread-safe. Plug-in framework functions other than ::cp_init,
- * ::cp_get_framework_info and ::cp_set_fatal_error_handler
+ * ::cp_get_framework_info, ::cp_set_fatal_error_handler and ::cp_set_allocator
  * must not be called after the plug-in framework has been destroyed.
  * All contexts are destroyed and all data references returned by the
  * framework become invalid.
  */
 CP_C_API void cp_destroy(void);
 
+/**
+ * Prepares the plug-in framework for forking a child process. A pre-fork
+ * server can set up its plug-in contexts once, by scanning, installing and
+ * resolving plug-ins, and then fork worker processes which inherit the
+ * populated registries copy-on-write and start the plug-ins they need.
+ * This function stops the framework threads of each plug-in context,
+ * waits for plug-in operations and run functions in progress to finish
+ * and then keeps the contexts and the framework locked so that the child
+ * process inherits them in a consistent state. The framework threads are
+ * started again on demand. Must be followed by ::cp_after_fork_parent in
+ * the parent process and by ::cp_after_fork_child in the child process,
+ * for example by registering the three functions with @c pthread_atfork.
+ *
+ * This function can only be called by the main program. Other threads of
+ * the main program must not create or destroy plug-in contexts or use
+ * them between this function and the matching after-fork function.
+ * Plug-ins started before forking are active in both processes, so
+ * plug-ins that create threads of their own should be started in the
+ * child process.
+ */
+CP_C_API void cp_prepare_fork(void);
+
+/**
+ * Releases the locks taken by ::cp_prepare_fork in the parent process
+ * after forking.
+ */
+CP_C_API void cp_after_fork_parent(void);
+
+/**
+ * Reinitializes the locks taken by ::cp_prepare_fork in the child process
+ * after forking and releases them. The child process can then use the
+ * inherited plug-in contexts normally.
+ */
+CP_C_API void cp_after_fork_child(void);
+
 /*@}*/
 
 
@@ -1032,6 +2210,31 @@ CP_C_API void cp_destroy(void);
  */
 CP_C_API cp_context_t * cp_create_context(cp_status_t *status);
 
+/**
+ * Creates a new plug-in context with the same plug-ins installed as in the
+ * specified source context. This is much faster than registering the
+ * plug-in collections, scanning them and installing the plug-ins again.
+ * The new context gets the descriptor, parsing and timing settings and the
+ * startup arguments of the source context, the same plug-in loaders and
+ * copies of its plug-in collections. The installed plug-ins are associated
+ * with the corresponding loaders, so later scans of the new context only
+ * report changes relative to the source context.
+ *
+ * Plug-in information shared between contexts (see
+ * ::cp_set_shared_descriptors) is shared with the new context as well.
+ * Other plug-in information is copied into a single memory block per
+ * plug-in. Only the per-context plug-in state is created anew, in a single
+ * installation batch. Plug-ins are installed but not resolved or started
+ * unless @ref CP_CL_START is specified. Loggers, listeners, configuration
+ * streams, the descriptor cache and plug-in runtime state are not copied.
+ *
+ * @param src the source plug-in context
+ * @param flags the bitmask of @ref cCloneFlags "cloning flags"
+ * @param status pointer to the location where status code is to be stored, or NULL
+ * @return the newly created plug-in context, or NULL on failure
+ */
+CP_C_API cp_context_t * cp_clone_context(cp_context_t *src, int flags, cp_status_t *status) CP_GCC_NONNULL(1);
+
 /**
  * Changes the file name in the plug-in the plug-in descriptor is loaded from.
  * The default name is "plugin.xml"
@@ -1051,15 +2254,215 @@ CP_C_API void cp_set_plugin_descriptor_name(cp_context_t *ctx, const char *name)
  */
 CP_C_API void cp_set_plugin_descriptor_root_element(cp_context_t *ctx, const char *root);
 
+/**
+ * Enables a persistent plug-in descriptor cache for the specified plug-in
+ * context, or disables it if @a path is NULL. When the cache is enabled,
+ * loaded plug-in descriptors are stored in a compact binary file, one entry
+ * per plug-in, keyed by the plug-in path and by the modification time and
+ * size of the descriptor file. Later loads of an unmodified descriptor,
+ * typically on the next start of the application, reconstruct the plug-in
+ * information from the cache instead of parsing the descriptor. The cache
+ * file is updated at the end of each plug-in scan and when the context is
+ * destroyed, dropping the entries of plug-ins that were not encountered.
+ * A missing or invalid cache file is treated as an empty cache.
+ *
+ * Modifications that preserve both the size and the modification time
+ * (at the resolution of the file system) of a descriptor are not detected.
+ *
+ * @param ctx the plug-in context
+ * @param path the cache file path, or NULL to disable the cache
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_set_descriptor_cache(cp_context_t *ctx, const char *path) CP_GCC_NONNULL(1);
+
+/**
+ * Enables or disables lazy parsing of extension configuration for the
+ * specified plug-in context. In lazy mode the configuration markup of each
+ * extension is only recorded when a plug-in descriptor is loaded and the
+ * configuration element tree is built on first access through
+ * ::cp_get_extension_cfg. Until then the @a configuration field of the
+ * extension is NULL. Lazy parsing is disabled by default.
+ *
+ * @param ctx the plug-in context
+ * @param lazy non-zero to enable lazy parsing, zero to disable it
+ */
+CP_C_API void cp_set_lazy_cfg(cp_context_t *ctx, int lazy) CP_GCC_NONNULL(1);
+
+/**
+ * Enables or disables lazy activation of all plug-ins in the specified
+ * plug-in context. In lazy mode every plug-in is treated as if its
+ * descriptor requested lazy activation (see
+ * @ref cp_plugin_info_t::lazy_activation): starting a plug-in only resolves
+ * its imports and an imported plug-in is started on demand when a symbol
+ * it defines is first resolved using ::cp_resolve_symbol. The same applies
+ * recursively to the imports of a plug-in started on demand. Extension
+ * information is available without starting the contributing plug-ins.
+ * Plug-ins using lazy imports must access them through resolved symbols
+ * rather than by calling into their runtime libraries directly before
+ * that. Lazy activation is disabled by default.
+ *
+ * @param ctx the plug-in context
+ * @param lazy non-zero to enable lazy activation, zero to disable it
+ */
+CP_C_API void cp_set_lazy_activation(cp_context_t *ctx, int lazy) CP_GCC_NONNULL(1);
+
+/**
+ * Enables or disables sharing of loaded plug-in descriptors with other
+ * plug-in contexts. When enabled, the plug-in information loaded by
+ * ::cp_load_plugin_descriptor (and by plug-in scans) is published in a
+ * framework wide table keyed by the plug-in path. Other contexts with
+ * sharing enabled then get a new reference to the same information instead
+ * of parsing the descriptor again, as long as the size and modification
+ * time of the descriptor file and the descriptor file name and root element
+ * settings are unchanged. Shared information is reference counted across
+ * contexts and remains valid until the last reference is released, also
+ * if the context that loaded it is destroyed.
+ *
+ * Shared information is always parsed in full: lazy configuration parsing
+ * (see ::cp_set_lazy_cfg) is not applied, and descriptors are not shared
+ * while configuration streams (see ::cp_register_cfg_stream) are
+ * registered. Shared descriptions are not compacted by
+ * ::cp_compact_context. Sharing is disabled by default.
+ *
+ * @param ctx the plug-in context
+ * @param enabled non-zero to enable sharing, zero to disable it
+ */
+CP_C_API void cp_set_shared_descriptors(cp_context_t *ctx, int enabled) CP_GCC_NONNULL(1);
+
+/**
+ * Registers a streaming consumer for the configuration of the extensions
+ * attached to the specified extension point. The configuration of such
+ * extensions in descriptors parsed afterwards is passed to the consumer as
+ * parsing events instead of being stored as a configuration element tree,
+ * also in lazy mode. See ::cp_cfg_stream_t for details. A previous consumer
+ * registered for the extension point is replaced. Descriptors are not
+ * served from the descriptor cache while consumers are registered. If
+ * registered by a plug-in, the consumer is unregistered automatically when
+ * the plug-in is stopped.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the identifier of the extension point
+ * @param stream the consumer functions, copied by the framework
+ * @param user_data the user data pointer passed to the consumer functions
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_register_cfg_stream(cp_context_t *ctx, const char *extpt_id, const cp_cfg_stream_t *stream, void *user_data) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Unregisters the streaming configuration consumer of the specified
+ * extension point. Does nothing if there is no consumer registered.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the identifier of the extension point
+ */
+CP_C_API void cp_unregister_cfg_stream(cp_context_t *ctx, const char *extpt_id) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Registers a configuration schema for the extensions attached to the
+ * specified extension point. The configuration of each installed
+ * extension is validated against the schema and converted into a
+ * configuration record, which can then be obtained using
+ * ::cp_get_extension_record. The configuration of extensions installed
+ * later is converted when they are installed and a plug-in with an
+ * extension not matching the schema fails to install with
+ * @ref CP_ERR_MALFORMED. If an already installed extension does not match
+ * the schema, the schema is not registered. The schema is copied by the
+ * framework and it replaces any previous schema of the extension point.
+ * If registered by a plug-in, the schema is unregistered automatically
+ * when the plug-in is stopped.
+ *
+ * The extension point does not have to be installed. Configuration
+ * delivered to a streaming consumer (see ::cp_register_cfg_stream) is not
+ * available for conversion.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the identifier of the extension point
+ * @param schema the configuration schema
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_MALFORMED if an installed extension does not match the schema or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_register_cfg_schema(cp_context_t *ctx, const char *extpt_id, const cp_cfg_schema_t *schema) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Unregisters the configuration schema of the specified extension point
+ * and frees the configuration records built according to it. Does nothing
+ * if there is no schema registered.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the identifier of the extension point
+ */
+CP_C_API void cp_unregister_cfg_schema(cp_context_t *ctx, const char *extpt_id) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the configuration record of an installed extension, built
+ * according to the configuration schema of its extension point (see
+ * ::cp_register_cfg_schema). The record is aligned to
+ * @ref CP_CFG_RECORD_ALIGN bytes. It must not be modified and it remains
+ * valid until the plug-in contributing the extension is uninstalled or
+ * the schema is unregistered, so the caller can keep the pointer instead
+ * of calling this function on every use.
+ *
+ * @param ctx the plug-in context
+ * @param ext the extension
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @return the configuration record or NULL if no schema is registered for the extension point (@ref CP_ERR_UNKNOWN)
+ */
+CP_C_API const void * cp_get_extension_record(cp_context_t *ctx, const cp_extension_t *ext, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Enables or disables the recording of plug-in lifecycle timings for the
+ * specified plug-in context. When enabled, the framework records the time
+ * spent parsing descriptors, resolving plug-ins, loading runtime libraries
+ * and calling the create and start functions of each plug-in. The recorded
+ * timings can be retrieved using ::cp_get_plugin_timings and
+ * ::cp_get_timings_summary. Recording is disabled by default and costs a
+ * flag check per phase while disabled.
+ *
+ * @param ctx the plug-in context
+ * @param enabled non-zero to enable recording, zero to disable it
+ */
+CP_C_API void cp_set_timings(cp_context_t *ctx, int enabled) CP_GCC_NONNULL(1);
+
+/**
+ * Sets the trace hook of the specified plug-in context, replacing any
+ * previously set hook, or removes it if @a hook is NULL. The hook is
+ * called for the @ref cp_trace_event_t "framework events" of the whole
+ * plug-in environment. Symbols served from a symbol cache are not
+ * reported. While no hook is set, tracing costs a pointer check per event.
+ *
+ * @param ctx the plug-in context
+ * @param hook the trace hook, or NULL to remove the hook
+ * @param user_data the user data pointer passed to the hook
+ */
+CP_C_API void cp_set_trace_hook(cp_context_t *ctx, cp_trace_hook_func_t hook, void *user_data) CP_GCC_NONNULL(1);
+
 /**
  * Destroys the specified plug-in context and releases the associated resources.
  * Stops and uninstalls all plug-ins in the context. The context must not be
- * accessed after calling this function.
+ * accessed after calling this function. In fast exit mode (see
+ * ::cp_set_fast_exit) the plug-ins are only stopped.
  * 
  * @param ctx the context to be destroyed
  */
 CP_C_API void cp_destroy_context(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Enables or disables fast exit mode for the specified plug-in context.
+ * This is intended for a process that destroys the context, or the whole
+ * framework using ::cp_destroy, just before exiting. In fast exit mode
+ * ::cp_destroy_context only stops the active plug-ins, so that their stop
+ * functions can complete external side effects, and then abandons the
+ * context. The plug-in destroy functions are not called, the plug-ins are
+ * not uninstalled, no memory is released and the runtime libraries are
+ * not unloaded. If @a num_threads is greater than one, the plug-ins are
+ * stopped in parallel as by ::cp_stop_plugins_parallel, otherwise serially
+ * in the reverse order they were started. Fast exit mode is disabled by
+ * default.
+ *
+ * @param ctx the plug-in context
+ * @param num_threads the number of threads stopping the plug-ins, or zero to disable fast exit mode
+ */
+CP_C_API void cp_set_fast_exit(cp_context_t *ctx, int num_threads) CP_GCC_NONNULL(1);
+
 /**
  * Registers a local plug-in collection with a plug-in context. A local plug-in collection
  * is a directory that has plug-ins as its immediate subdirectories. The
@@ -1118,6 +2521,37 @@ CP_C_API void cp_unregister_pcollections(cp_context_t *ctx) CP_GCC_NONNULL(1);
  */
 CP_C_API cp_status_t cp_register_ploader(cp_context_t *ctx, cp_plugin_loader_t *loader) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Registers a plug-in loader with a plug-in context using the specified
+ * registration flags. This is like ::cp_register_ploader except that the
+ * flags replace the defaults. The plug-in loaders created by the framework
+ * are registered as #CP_PLR_THREAD_SAFE by default while the loaders
+ * allocated by the client program are registered without flags. Registering
+ * an already registered loader again just replaces its flags.
+ *
+ * @param ctx the plug-in context
+ * @param loader the plug-in loader
+ * @param flags the bitmask of registration flags, see @ref cPloaderFlags
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_register_ploader_flags(cp_context_t *ctx, cp_plugin_loader_t *loader, int flags) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Sets the function used to scan a registered plug-in loader incrementally
+ * when ::cp_scan_plugins is called with #CP_SP_INCREMENTAL. A loader
+ * without one is scanned fully. The plug-in loaders created by the
+ * framework get their incremental scanning function, if any, when they
+ * are registered. The function is not a member of @ref cp_plugin_loader_t
+ * so that loader structures allocated by the client program keep their
+ * layout.
+ *
+ * @param ctx the plug-in context
+ * @param loader the registered plug-in loader
+ * @param scan_changes the incremental scanning function, or NULL to always scan fully
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_UNKNOWN if the loader has not been registered or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_set_ploader_scan_changes(cp_context_t *ctx, cp_plugin_loader_t *loader, cp_scan_changes_func_t scan_changes) CP_GCC_NONNULL(1, 2);
+
 /**
  * Unregisters a previously registered plug-in loader from a plug-in context.
  * All plug-ins loaded by the loader are uninstalled. Does nothing if the
@@ -1138,6 +2572,25 @@ CP_C_API void cp_unregister_ploader(cp_context_t *ctx, cp_plugin_loader_t *loade
  */
 CP_C_API void cp_unregister_ploaders(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Compacts the memory used by the plug-in environment of the specified
+ * context. This is intended to be called once the plug-ins have been
+ * installed and started, to recover the memory left over from scanning.
+ * Descriptions of plug-ins which are not active and which are not
+ * referenced by the client program are replaced by compact copies.
+ * Descriptions shared with other contexts (see ::cp_set_shared_descriptors)
+ * are left as they are.
+ * Extension lists previously returned by ::cp_get_extensions_snapshot are
+ * invalidated for the affected extension points. With @ref CP_CC_CFG the
+ * @a configuration field of the affected extensions is NULL until the
+ * configuration is requested through ::cp_get_extension_cfg.
+ * 
+ * @param ctx the plug-in context
+ * @param flags the bitmask of @ref cCompactFlags "compaction flags"
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_compact_context(cp_context_t *ctx, int flags) CP_GCC_NONNULL(1);
+
 /*@}*/
 
 
@@ -1176,6 +2629,45 @@ CP_C_API cp_status_t cp_register_logger(cp_context_t *ctx, cp_logger_func_t logg
  */
 CP_C_API void cp_unregister_logger(cp_context_t *ctx, cp_logger_func_t logger) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Registers a structured logger with a plug-in framework. Structured
+ * loggers receive the unformatted log records of the selected messages
+ * and they share the severity selection and the registration rules of
+ * ordinary loggers, see ::cp_register_logger. Framework messages are not
+ * formatted at all if only structured loggers select them and none of them
+ * calls ::cp_render_log_record. When asynchronous logging is enabled the
+ * records carry the already formatted message text without arguments.
+ * 
+ * @param ctx the plug-in context
+ * @param logger the structured logger function to be called
+ * @param user_data the user data pointer passed to the logger
+ * @param min_severity the minimum severity of messages passed to logger
+ * @return ::CP_OK (zero) on success or ::CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_register_structured_logger(cp_context_t *ctx, cp_structured_logger_func_t logger, void *user_data, cp_log_severity_t min_severity) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Removes a structured logger registration.
+ *
+ * @param ctx the plug-in context
+ * @param logger the structured logger function to be unregistered
+ */
+CP_C_API void cp_unregister_structured_logger(cp_context_t *ctx, cp_structured_logger_func_t logger) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Formats the message text of a structured log record. Conversions of the
+ * localized format string that do not match the record arguments are
+ * copied as is. Like snprintf, this function writes at most the
+ * specified number of characters including the terminating null
+ * character.
+ * 
+ * @param record the log record
+ * @param buffer the buffer for the message text, or NULL if size is zero
+ * @param size the size of the buffer in characters
+ * @return the length of the complete message text, excluding the terminating null character
+ */
+CP_C_API int cp_render_log_record(const cp_log_record_t *record, char *buffer, int size) CP_GCC_NONNULL(1);
+
 /**
  * Emits a new log message.
  * 
@@ -1194,6 +2686,68 @@ CP_C_API void cp_log(cp_context_t *ctx, cp_log_severity_t severity, const char *
  */
 CP_C_API int cp_is_logged(cp_context_t *ctx, cp_log_severity_t severity) CP_GCC_NONNULL(1);
 
+/**
+ * Sets the minimum severity of messages logged for the specified plug-in,
+ * or the default for the main program and for the plug-ins without a
+ * threshold of their own. Messages below the threshold are discarded
+ * before they are formatted, regardless of the severities selected by
+ * the loggers, and ::cp_is_logged reports them as not logged. This makes
+ * it possible to register a debug logger and to trace a single plug-in
+ * without formatting the debug messages of the others. A threshold can
+ * be set before the plug-in is installed and it is retained when the
+ * plug-in is uninstalled. By default all messages are passed to the
+ * loggers.
+ * 
+ * @param ctx the plug-in context
+ * @param plugin_id the identifier of the plug-in or NULL to set the default threshold
+ * @param min_severity the minimum severity of messages logged, or ::CP_LOG_ERROR + 1 to log nothing
+ * @return ::CP_OK (zero) on success or ::CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_set_log_threshold(cp_context_t *ctx, const char *plugin_id, cp_log_severity_t min_severity) CP_GCC_NONNULL(1);
+
+/**
+ * Enables or disables concurrent logging for the specified plug-in context.
+ * When enabled, messages emitted using ::cp_log are passed to the loggers
+ * without holding the context lock, so several threads can log at the same
+ * time and the registered loggers must be thread-safe. Messages logged by
+ * the framework itself are still serialized. A logger being unregistered
+ * may still be executing a concurrent invocation until the unregistering
+ * function returns. Concurrent logging is disabled by default and it has
+ * no effect without multi-threading support.
+ * 
+ * @param ctx the plug-in context
+ * @param enabled non-zero to enable concurrent logging, zero to disable it
+ */
+CP_C_API void cp_set_concurrent_logging(cp_context_t *ctx, int enabled) CP_GCC_NONNULL(1);
+
+/**
+ * Enables or disables asynchronous logging for the specified plug-in
+ * context. When enabled, logged messages are copied into a bounded ring
+ * of the specified capacity without waiting for the loggers and a
+ * framework logging thread passes them to the loggers in order. Logger
+ * invocations remain serialized. Messages longer than the ring slots are
+ * truncated. When the ring is full the message is dropped, or the logging
+ * thread waits for space if ::CP_AL_BLOCK is specified. Disabling
+ * asynchronous logging or changing the capacity first passes the queued
+ * messages to the loggers. Asynchronous logging is disabled by default
+ * and this function has no effect without multi-threading support.
+ * 
+ * @param ctx the plug-in context
+ * @param capacity the number of messages the ring can hold, rounded up to a power of two, or zero to disable asynchronous logging
+ * @param flags the flags, see @ref cAsyncLoggingFlags
+ * @return ::CP_OK (zero) on success or ::CP_ERR_RESOURCE if out of resources
+ */
+CP_C_API cp_status_t cp_set_async_logging(cp_context_t *ctx, int capacity, int flags) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the number of messages dropped so far because the asynchronous
+ * logging ring was full.
+ * 
+ * @param ctx the plug-in context
+ * @return the number of dropped messages
+ */
+CP_C_API unsigned long cp_get_dropped_log_messages(cp_context_t *ctx) CP_GCC_NONNULL(1);
+
 /*@}*/
 
 
@@ -1261,6 +2815,23 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
  */
 CP_C_API cp_status_t cp_install_plugin(cp_context_t *ctx, cp_plugin_info_t *pi) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Installs a batch of plug-ins to the specified plug-in context. This is
+ * equivalent to calling ::cp_install_plugin for each of the plug-ins but
+ * the whole batch is checked for conflicts, including conflicts between
+ * the plug-ins of the batch, before any of them is installed and the
+ * installation events are delivered only after all plug-ins have been
+ * installed. Unless #CP_IP_ATOMIC is specified in @a flags, the plug-ins
+ * that can be installed are installed even if some others fail.
+ *
+ * @param ctx the plug-in context
+ * @param pis the plug-in information structures
+ * @param n the number of plug-ins
+ * @param flags the bitmask of @ref cInstallFlags "installation flags"
+ * @return @ref CP_OK (zero) if all plug-ins were installed or the first error code
+ */
+CP_C_API cp_status_t cp_install_plugins(cp_context_t *ctx, cp_plugin_info_t **pis, unsigned int n, int flags) CP_GCC_NONNULL(1);
+
 /**
  * Scans for plug-ins in the registered plug-in directories, installing
  * new plug-ins and upgrading installed plug-ins. This function can be used to
@@ -1275,6 +2846,14 @@ CP_C_API cp_status_t cp_install_plugin(cp_context_t *ctx, cp_plugin_info_t *pi)
  * all active plug-ins are stopped if any plug-ins are to be installed or
  * upgraded. Finally, if #CP_SP_RESTART_ACTIVE is set all currently active
  * plug-ins will be restarted after the changes (if they were stopped).
+ * Alternatively, #CP_SP_RESTART_AFFECTED stops only the plug-ins that
+ * depend on the upgraded plug-ins and restarts them after the upgrade.
+ * 
+ * If #CP_SP_INCREMENTAL is set then plug-in loaders supporting it only
+ * report plug-ins that have been added or modified since their previous
+ * scan. This makes periodic rescans cheap when nothing has changed, but
+ * unchanged plug-ins that are not installed, for example because they were
+ * explicitly uninstalled, are not installed again by an incremental scan.
  * 
  * When removing plug-in files from the plug-in directories, the
  * plug-ins to be removed must be first unloaded. Therefore this function
@@ -1287,12 +2866,21 @@ CP_C_API cp_status_t cp_install_plugin(cp_context_t *ctx, cp_plugin_info_t *pi)
 CP_C_API cp_status_t cp_scan_plugins(cp_context_t *ctx, int flags) CP_GCC_NONNULL(1);
 
 /**
- * Starts a plug-in. Also starts any imported plug-ins. If the plug-in is
+ * Starts a plug-in. Also starts any imported plug-ins except those
+ * activated lazily, which are only resolved and started on first use
+ * (see ::cp_set_lazy_activation). If the plug-in is
  * already starting then
  * this function blocks until the plug-in has started or failed to start.
  * If the plug-in is already active then this function returns immediately.
  * If the plug-in is stopping then this function blocks until the plug-in
  * has stopped and then starts the plug-in.
+ *
+ * Plug-ins are started and stopped one operation at a time, so concurrent
+ * calls to functions changing the plug-in states wait for each other.
+ * While the plug-in start and stop functions are being run without other
+ * such operations in progress, the context lock is released and other
+ * threads can query plug-in information, install plug-ins and resolve
+ * symbols of active plug-ins.
  * 
  * @param ctx the plug-in context
  * @param id identifier of the plug-in to be started
@@ -1321,6 +2909,94 @@ CP_C_API cp_status_t cp_stop_plugin(cp_context_t *ctx, const char *id) CP_GCC_NO
  */
 CP_C_API void cp_stop_plugins(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Starts a plug-in asynchronously. Works like ::cp_start_plugin but
+ * returns without waiting for the plug-in and its imports to start. The
+ * start is performed by a framework worker thread which then reports the
+ * final status to the specified callback. Plug-in state changes are
+ * reported to plug-in listeners as usual. Requests are performed one at a
+ * time in the order they were made, and any requests still queued are
+ * completed before the plug-in context is destroyed. Without
+ * multi-threading support the plug-in is started and the callback called
+ * before this function returns. This function can only be called by the
+ * main program.
+ * 
+ * @param ctx the plug-in context
+ * @param id identifier of the plug-in to be started
+ * @param callback the completion callback, or NULL if none
+ * @param user_data the user data pointer passed to the callback
+ * @return @ref CP_OK (zero) if the request was accepted or @ref CP_ERR_RESOURCE if out of resources
+ */
+CP_C_API cp_status_t cp_start_plugin_async(cp_context_t *ctx, const char *id, cp_plugin_op_func_t callback, void *user_data) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Stops a plug-in asynchronously. Works like ::cp_stop_plugin but returns
+ * without waiting for the plug-in and its dependent plug-ins to stop.
+ * Otherwise works like ::cp_start_plugin_async.
+ * 
+ * @param ctx the plug-in context
+ * @param id identifier of the plug-in to be stopped
+ * @param callback the completion callback, or NULL if none
+ * @param user_data the user data pointer passed to the callback
+ * @return @ref CP_OK (zero) if the request was accepted or @ref CP_ERR_RESOURCE if out of resources
+ */
+CP_C_API cp_status_t cp_stop_plugin_async(cp_context_t *ctx, const char *id, cp_plugin_op_func_t callback, void *user_data) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Starts the specified plug-ins and their dependencies using several
+ * threads. Plug-ins that do not depend on each other are started
+ * concurrently but the imported plug-ins of a plug-in are always active
+ * before the plug-in itself is started. Plug-in create functions are called
+ * with the context locked, one at a time, while the start functions run
+ * without holding the context lock. If a plug-in fails to start, the
+ * plug-ins depending on it are not started but other plug-ins are.
+ * If at most one thread is specified or the framework was built without
+ * multi-threading support, the plug-ins are started serially.
+ * Lazily activated plug-ins are only started if explicitly listed
+ * (see ::cp_set_lazy_activation).
+ *
+ * Other threads starting, stopping or uninstalling plug-ins wait until
+ * the plug-ins have been started.
+ *
+ * @param ctx the plug-in context
+ * @param ids NULL-terminated array of plug-in identifiers, or NULL for all installed plug-ins
+ * @param num_threads the total number of threads, including the calling thread
+ * @return @ref CP_OK (zero) on success or the first error code encountered
+ */
+CP_C_API cp_status_t cp_start_plugins_parallel(cp_context_t *ctx, const char * const *ids, int num_threads) CP_GCC_NONNULL(1);
+
+/**
+ * Stops all active plug-ins using several threads. A plug-in is stopped
+ * only after all active plug-ins importing it have been stopped, the
+ * reverse of the order used by ::cp_start_plugins_parallel. Plug-in stop
+ * functions run without holding the context lock.
+ *
+ * Other threads starting, stopping or uninstalling plug-ins wait until
+ * the plug-ins have been stopped.
+ *
+ * @param ctx the plug-in context
+ * @param num_threads the total number of threads, including the calling thread
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if the plug-ins had to be stopped serially
+ */
+CP_C_API cp_status_t cp_stop_plugins_parallel(cp_context_t *ctx, int num_threads) CP_GCC_NONNULL(1);
+
+/**
+ * Prefetches the runtime libraries of installed plug-ins that have not
+ * been resolved yet. The library files are read ahead into the operating
+ * system file cache and, if #CP_PF_DLOPEN is specified, loaded so that
+ * later plug-in starts do not have to wait for the disk. With
+ * multi-threading support the prefetch runs in a background thread and
+ * this function returns immediately. Otherwise the files are prefetched
+ * before this function returns. A new call cancels any prefetch still in
+ * progress. Plug-ins installed by a loader that resolves plug-in files on
+ * demand are not prefetched.
+ *
+ * @param ctx the plug-in context
+ * @param flags the bitmask of @ref cPrefetchFlags "prefetch flags"
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_prefetch_plugins(cp_context_t *ctx, int flags) CP_GCC_NONNULL(1);
+
 /**
  * Uninstalls the specified plug-in. The plug-in is first stopped if it is active.
  * Then uninstalls the plug-in and any dependent plug-ins.
@@ -1337,7 +3013,38 @@ CP_C_API cp_status_t cp_uninstall_plugin(cp_context_t *ctx, const char *id) CP_G
  * 
  * @param ctx the plug-in context
  */
-CP_C_API void cp_uninstall_plugins(cp_context_t *ctx) CP_GCC_NONNULL(1);
+CP_C_API void cp_uninstall_plugins(cp_context_t *ctx) CP_GCC_NONNULL(1);
+
+/**
+ * Sets the number of runtime libraries retained after their plug-ins have
+ * been uninstalled. A retained runtime library stays loaded together with
+ * its resolved runtime function information and symbol export table. If a
+ * plug-in with the same identifier is later installed and resolved again,
+ * and its version, required C-Pluff version, plug-in path, runtime library
+ * name and runtime symbol names are unchanged, the retained library is
+ * taken back into use without building the library path, loading the
+ * library or resolving the runtime symbols. Restarting such a plug-in
+ * only costs calling its create and start functions. This is intended for
+ * applications that reload their configuration by uninstalling and
+ * reinstalling the same plug-ins. Once more libraries are retained than
+ * allowed, the least recently retained ones are closed. Lowering the
+ * limit closes the excess libraries immediately. Retention is disabled
+ * by default.
+ *
+ * @param ctx the plug-in context
+ * @param max_libs the maximum number of retained runtime libraries, or zero to disable retention
+ */
+CP_C_API void cp_set_runtime_retention(cp_context_t *ctx, int max_libs) CP_GCC_NONNULL(1);
+
+/**
+ * Closes all runtime libraries currently retained for uninstalled plug-ins
+ * (see ::cp_set_runtime_retention), for example when the application is
+ * under memory pressure. The retention limit is not changed.
+ *
+ * @param ctx the plug-in context
+ * @return the number of runtime libraries closed
+ */
+CP_C_API int cp_release_retained_runtimes(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
 /*@}*/
 
@@ -1410,6 +3117,124 @@ CP_C_API cp_ext_point_t ** cp_get_ext_points_info(cp_context_t *ctx, cp_status_t
  */
 CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *ctx, const char *extpt_id, cp_status_t *status, int *num) CP_GCC_NONNULL(1);
 
+/**
+ * Returns the current generation of the plug-in registry. The generation
+ * is advanced whenever plug-ins, extension points or extensions are
+ * installed or uninstalled, so a cache of the information returned by
+ * ::cp_get_plugins_info, ::cp_get_ext_points_info or
+ * ::cp_get_extensions_info is still valid if the generation has not
+ * changed since the information was obtained. Where atomic operations are
+ * available this function does not lock the plug-in context.
+ *
+ * @param ctx the plug-in context
+ * @return the registry generation
+ */
+CP_C_API unsigned int cp_get_registry_generation(cp_context_t *ctx) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the registry generation at which the specified extension point or
+ * its extensions last changed, or zero if they have not changed since the
+ * plug-in context was created. The value only changes when the extension
+ * point itself or the installed extensions for it change.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the extension point identifier
+ * @return the generation of the extension point
+ */
+CP_C_API unsigned int cp_get_ext_point_generation(cp_context_t *ctx, const char *extpt_id) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns a borrowed snapshot of the extensions currently installed for
+ * the specified extension point. Unlike ::cp_get_extensions_info, this
+ * function returns the same snapshot without allocating memory for as long
+ * as the extensions of the extension point stay unchanged. The snapshot
+ * must not be modified or released. It remains valid until a plug-in
+ * contributing to the extension point is installed or uninstalled or the
+ * context is compacted using ::cp_compact_context, so callers caching it
+ * must not use it across such changes. The
+ * generation of the snapshot can be compared to detect changes.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the extension point identifier
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @return the snapshot of the extensions or NULL on failure
+ */
+CP_C_API const cp_extensions_snapshot_t *cp_get_extensions_snapshot(cp_context_t *ctx, const char *extpt_id, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Calls the specified visitor function for each installed plug-in until
+ * the visitor returns a non-zero value. Unlike ::cp_get_plugins_info, this
+ * function does not allocate memory and the plug-in information is
+ * visited in place. The plug-in context is locked for the duration of
+ * the iteration.
+ *
+ * @param ctx the plug-in context
+ * @param visitor the visitor function
+ * @param user_data the user data pointer passed to the visitor
+ * @return the non-zero value returned by the visitor to stop the iteration, or zero
+ */
+CP_C_API int cp_foreach_plugin(cp_context_t *ctx, cp_plugin_visitor_func_t visitor, void *user_data) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Calls the specified visitor function for each installed extension of
+ * the specified extension point, or of all extension points, until the
+ * visitor returns a non-zero value. Unlike ::cp_get_extensions_info, this
+ * function does not allocate memory and the extensions are visited in
+ * place. The plug-in context is locked for the duration of the iteration.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the extension point identifier or NULL for all extensions
+ * @param visitor the visitor function
+ * @param user_data the user data pointer passed to the visitor
+ * @return the non-zero value returned by the visitor to stop the iteration, or zero
+ */
+CP_C_API int cp_foreach_extension(cp_context_t *ctx, const char *extpt_id, cp_extension_visitor_func_t visitor, void *user_data) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Creates an index of the extensions installed for the specified extension
+ * point by the configuration value designated by the specified path. The
+ * path has the same syntax as for ::cp_lookup_cfg_value and it is relative
+ * to the root configuration element of an extension, for example "@type".
+ * The framework maintains the index as plug-ins contributing to the
+ * extension point are installed and uninstalled. Extensions without the
+ * value are not indexed. The index must be destroyed using
+ * ::cp_destroy_extension_index when not needed anymore. Remaining indexes
+ * are destroyed together with the plug-in context.
+ *
+ * @param ctx the plug-in context
+ * @param extpt_id the extension point identifier
+ * @param path the path of the indexed configuration value
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @return the index or NULL on failure
+ */
+CP_C_API cp_extension_index_t * cp_create_extension_index(cp_context_t *ctx, const char *extpt_id, const char *path, cp_status_t *status) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Destroys an extension index created using ::cp_create_extension_index.
+ *
+ * @param ctx the plug-in context
+ * @param index the index to be destroyed
+ */
+CP_C_API void cp_destroy_extension_index(cp_context_t *ctx, cp_extension_index_t *index) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the currently installed extensions whose indexed configuration
+ * value equals the specified value. The extensions are returned in the
+ * order they were installed. The cost of the query does not depend on the
+ * number of installed extensions. The returned information must not be
+ * modified and the caller must release the information by calling
+ * ::cp_release_info when the information is not needed anymore.
+ *
+ * @param ctx the plug-in context
+ * @param index the extension index
+ * @param value the configuration value to look for
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @param num a pointer to the location where the number of returned extensions is to be stored, or NULL
+ * @return pointer to a NULL-terminated list of pointers to extension
+ *			information or NULL on failure
+ */
+CP_C_API cp_extension_t ** cp_query_extension_index(cp_context_t *ctx, const cp_extension_index_t *index, const char *value, cp_status_t *status, int *num) CP_GCC_NONNULL(1, 2, 3);
+
 /**
  * Releases a previously obtained reference counted information object. The
  * documentation for functions returning such information refers
@@ -1432,6 +3257,116 @@ CP_C_API void cp_release_info(cp_context_t *ctx, void *info) CP_GCC_NONNULL(1, 2
  */
 CP_C_API cp_plugin_state_t cp_get_plugin_state(cp_context_t *ctx, const char *id) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Returns a stable handle to the state of the specified plug-in. The
+ * handle is bound to the plug-in identifier rather than to a particular
+ * installation. It stays valid when the plug-in is uninstalled, when it
+ * reports #CP_PLUGIN_UNINSTALLED, and follows the plug-in if it is
+ * installed again. The plug-in does not have to be installed when the
+ * handle is obtained. Repeated calls for the same identifier return the
+ * same handle. The handle must be released using ::cp_release_info.
+ * 
+ * @param ctx the plug-in context
+ * @param id the plug-in identifier
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @return the plug-in handle or NULL on failure
+ */
+CP_C_API cp_plugin_handle_t * cp_get_plugin_handle(cp_context_t *ctx, const char *id, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the current state of the plug-in of the specified handle. With
+ * multi-threading and atomic operation support this is a single atomic
+ * load which does not lock the plug-in context, so it is suitable for
+ * frequent polling. Otherwise the context is locked for reading as in
+ * ::cp_get_plugin_state.
+ * 
+ * @param ctx the plug-in context
+ * @param handle the plug-in handle obtained using ::cp_get_plugin_handle
+ * @return the current state of the plug-in
+ */
+CP_C_API cp_plugin_state_t cp_get_plugin_handle_state(cp_context_t *ctx, const cp_plugin_handle_t *handle) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the recorded lifecycle timings of the specified plug-in. See
+ * ::cp_set_timings for enabling the recording.
+ * 
+ * @param ctx the plug-in context
+ * @param id the plug-in identifier
+ * @param timings filled with the recorded timings
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_UNKNOWN if no such plug-in exists
+ */
+CP_C_API cp_status_t cp_get_plugin_timings(cp_context_t *ctx, const char *id, cp_plugin_timings_t *timings) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Returns a summary of the lifecycle timings recorded in the specified
+ * plug-in context. See ::cp_set_timings for enabling the recording.
+ * 
+ * @param ctx the plug-in context
+ * @param summary filled with the timings summary
+ */
+CP_C_API void cp_get_timings_summary(cp_context_t *ctx, cp_timings_summary_t *summary) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the memory used by the specified plug-in or, if @a id is NULL,
+ * by the whole plug-in environment of the specified context. The
+ * environment totals cover all installed plug-ins and the client program.
+ * The figures are collected from the counters and registries maintained by
+ * the framework when this function is called.
+ * 
+ * @param ctx the plug-in context
+ * @param id the plug-in identifier or NULL for the whole environment
+ * @param stats filled with the memory usage
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_UNKNOWN if no such plug-in exists
+ */
+CP_C_API cp_status_t cp_get_memory_stats(cp_context_t *ctx, const char *id, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Returns the sizes of the registries of the plug-in environment of the
+ * specified context. This is intended for diagnostics.
+ * 
+ * @param ctx the plug-in context
+ * @param stats filled with the registry sizes
+ */
+CP_C_API void cp_get_registry_stats(cp_context_t *ctx, cp_registry_stats_t *stats) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Enables or disables the collection of lock contention statistics for
+ * the plug-in environment of the specified context. Enabling resets the
+ * statistics. While enabled, the framework counts lock acquisitions and
+ * measures lock wait and exclusive hold times, attributing the holds to
+ * the API functions holding the lock. Collection is disabled by default.
+ * Without multi-threading support no statistics are collected. This
+ * function can only be called by the main program.
+ *
+ * @param ctx the plug-in context
+ * @param enabled non-zero to enable collection, zero to disable it
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_set_lock_stats(cp_context_t *ctx, int enabled) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the lock contention statistics collected for the plug-in
+ * environment of the specified context since they were enabled using
+ * ::cp_set_lock_stats. The statistics are zero if collection is disabled.
+ *
+ * @param ctx the plug-in context
+ * @param stats filled with the lock statistics
+ */
+CP_C_API void cp_get_lock_stats(cp_context_t *ctx, cp_lock_stats_t *stats) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the exclusive lock holds of the plug-in environment of the
+ * specified context per API function, in descending order of total hold
+ * time. Holds still in progress are not included. The returned array must
+ * be released using ::cp_release_info.
+ *
+ * @param ctx the plug-in context
+ * @param error filled with an error code, if non-NULL
+ * @param num filled with the number of returned entries, if non-NULL
+ * @return the array of hold statistics, or NULL on failure
+ */
+CP_C_API cp_lock_holder_stats_t *cp_get_lock_holder_stats(cp_context_t *ctx, cp_status_t *error, int *num) CP_GCC_NONNULL(1);
+
 /**
  * Registers a plug-in listener with a plug-in context. The listener is called
  * synchronously immediately after a plug-in state change. There can be several
@@ -1456,6 +3391,56 @@ CP_C_API cp_status_t cp_register_plistener(cp_context_t *ctx, cp_plugin_listener
  */
 CP_C_API void cp_unregister_plistener(cp_context_t *ctx, cp_plugin_listener_func_t listener) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Registers a plug-in listener which is only called for selected plug-in
+ * state changes. The listener is called for changes of the specified
+ * plug-in into one of the states selected by the
+ * @ref cStateMasks "state mask". Listeners for a specific plug-in are
+ * indexed by the plug-in identifier, so they do not slow down the delivery
+ * of events concerning other plug-ins. The plug-in need not be installed
+ * yet. Otherwise works like ::cp_register_plistener and the listener is
+ * unregistered using ::cp_unregister_plistener.
+ * 
+ * @param ctx the plug-in context
+ * @param listener the plug-in listener to be added
+ * @param user_data user data pointer supplied to the listener
+ * @param plugin_id identifier of the plug-in of interest or NULL for all plug-ins
+ * @param state_mask the mask of new states of interest, such as @ref CP_STATE_MASK(CP_PLUGIN_ACTIVE)
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if out of resources
+ */
+CP_C_API cp_status_t cp_register_plistener_filtered(cp_context_t *ctx, cp_plugin_listener_func_t listener, void *user_data, const char *plugin_id, int state_mask) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Registers a batch plug-in listener with a plug-in context. Unlike a
+ * plug-in listener, a batch listener is not called by the thread changing
+ * the plug-in state. The events are queued and a dispatcher thread
+ * delivers the queued events in batches, so a burst of state changes
+ * results in a few listener invocations. Queued events are delivered
+ * before the context is destroyed. Without multi-threading support, or if
+ * the dispatcher thread can not be created, each event is delivered
+ * synchronously as a batch of one event. A batch listener is unregistered
+ * like a plug-in listener, using ::cp_unregister_plistener_batch.
+ * 
+ * @param ctx the plug-in context
+ * @param listener the batch plug-in listener to be added
+ * @param user_data user data pointer supplied to the listener
+ * @param flags the bitmask of @ref cListenerFlags "listener flags"
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if out of resources
+ */
+CP_C_API cp_status_t cp_register_plistener_batch(cp_context_t *ctx, cp_plugin_batch_listener_func_t listener, void *user_data, int flags) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Removes a batch plug-in listener from a plug-in context. Does nothing if
+ * the specified listener was not registered. Events still queued are not
+ * delivered to the removed listener. A batch of events being delivered
+ * may still invoke the listener until this function returns. The same
+ * applies to the batch listeners of a plug-in removed when it stops.
+ * 
+ * @param ctx the plug-in context
+ * @param listener the batch plug-in listener to be removed
+ */
+CP_C_API void cp_unregister_plistener_batch(cp_context_t *ctx, cp_plugin_batch_listener_func_t listener) CP_GCC_NONNULL(1, 2);
+
 /**
  * Traverses a configuration element tree and returns the specified element.
  * The target element is specified by a base element and a relative path from
@@ -1463,7 +3448,8 @@ CP_C_API void cp_unregister_plistener(cp_context_t *ctx, cp_plugin_listener_func
  * separated by slash '/'. Two dots ".." can be used to designate a parent
  * element. Returns NULL if the specified element does not exist. If there are
  * several subelements with the same name, this function chooses the first one
- * when traversing the tree.
+ * when traversing the tree. Elements with many children are indexed on the
+ * first lookup so that later lookups do not scan the siblings.
  *
  * @param base the base configuration element
  * @param path the path to the target element
@@ -1471,6 +3457,19 @@ CP_C_API void cp_unregister_plistener(cp_context_t *ctx, cp_plugin_listener_func
  */
 CP_C_API cp_cfg_element_t * cp_lookup_cfg_element(cp_cfg_element_t *base, const char *path) CP_GCC_PURE CP_GCC_NONNULL(1, 2);
 
+/**
+ * Returns the configuration element tree of an extension, parsing the
+ * recorded configuration first if it was loaded in lazy mode (see
+ * ::cp_set_lazy_cfg). The returned tree is owned by the plug-in
+ * information and remains valid as long as it does.
+ *
+ * @param ctx the plug-in context
+ * @param ext the extension
+ * @param status pointer to the location where status code is to be stored, or NULL
+ * @return the configuration element tree or NULL on failure
+ */
+CP_C_API cp_cfg_element_t * cp_get_extension_cfg(cp_context_t *ctx, cp_extension_t *ext, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
 /**
  * Traverses a configuration element tree and returns the value of the
  * specified element or attribute. The target element or attribute is specified
@@ -1489,6 +3488,44 @@ CP_C_API cp_cfg_element_t * cp_lookup_cfg_element(cp_cfg_element_t *base, const
  */
 CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) CP_GCC_PURE CP_GCC_NONNULL(1, 2);
 
+/**
+ * Compiles a configuration path for repeated lookups. The path has the
+ * same syntax as for ::cp_lookup_cfg_value. The path is split into
+ * segments once and the element names are interned so that they can be
+ * compared by pointer against the configuration element trees loaded into
+ * the same plug-in context. The compiled path remains valid until it is
+ * released using ::cp_release_info.
+ *
+ * @param ctx the plug-in context
+ * @param path the path to be compiled
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @return the compiled path or NULL on failure
+ */
+CP_C_API cp_cfg_path_t * cp_compile_cfg_path(cp_context_t *ctx, const char *path, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Traverses a configuration element tree along a compiled path and returns
+ * the specified element. This works like ::cp_lookup_cfg_element except
+ * that an attribute name at the end of the path is ignored, so the element
+ * carrying the attribute is returned.
+ *
+ * @param base the base configuration element
+ * @param path the compiled path to the target element
+ * @return the target element or NULL if nonexisting
+ */
+CP_C_API cp_cfg_element_t * cp_lookup_cfg_compiled(cp_cfg_element_t *base, const cp_cfg_path_t *path) CP_GCC_PURE CP_GCC_NONNULL(1, 2);
+
+/**
+ * Traverses a configuration element tree along a compiled path and returns
+ * the value of the specified element or attribute. This works like
+ * ::cp_lookup_cfg_value.
+ *
+ * @param base the base configuration element
+ * @param path the compiled path to the target element or attribute
+ * @return the value of the target element or attribute or NULL
+ */
+CP_C_API char * cp_lookup_cfg_value_compiled(cp_cfg_element_t *base, const cp_cfg_path_t *path) CP_GCC_PURE CP_GCC_NONNULL(1, 2);
+
 /*@}*/
 
 
@@ -1498,13 +3535,20 @@ CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) CP
  *
  * These functions support a plug-in controlled execution model. Started plug-ins can
  * use ::cp_run_function to register @ref cp_run_func_t "a run function" which is called when the
- * main program calls ::cp_run_plugins or ::cp_run_plugins_step. A run
+ * main program calls ::cp_run_plugins, ::cp_run_plugins_step or
+ * ::cp_run_plugins_parallel. A run
  * function should do a finite chunk of work and then return telling whether
  * there is more work to be done. A run function is automatically unregistered
  * when the plug-in is stopped. Run functions make it possible for plug-ins
  * to control the flow of execution or they can be used as a coarse
  * way of task switching if there is no multi-threading support.
  *
+ * Waiting run functions are scheduled fairly between plug-ins. The plug-ins
+ * having waiting run functions take turns in round-robin order and the run
+ * functions of a single plug-in are run in the order they became waiting.
+ * A plug-in registering many run functions therefore does not delay the
+ * run functions of other plug-ins.
+ *
  * The C-Pluff distribution includes a generic main program, cpluff-loader,
  * which only acts as a plug-in loader. It loads and starts up the
  * specified plug-ins, passing any additional startup arguments to them and
@@ -1532,10 +3576,26 @@ CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) CP
  */
 CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Registers a new run function to be called once the specified delay has
+ * elapsed. Otherwise works like ::cp_run_function. The delayed run function
+ * is not counted as waiting to be run until it is due but it keeps
+ * ::cp_run_plugins running, sleeping until the next run function is due if
+ * there is nothing else to run.
+ * 
+ * @param ctx the plug-in context of the registering plug-in
+ * @param runfunc the run function to be registered
+ * @param delay_us the delay in microseconds
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_C_API cp_status_t cp_run_function_after(cp_context_t *ctx, cp_run_func_t runfunc, unsigned long delay_us) CP_GCC_NONNULL(1, 2);
+
 /**
  * Runs the started plug-ins as long as there is something to run.
  * This function calls repeatedly run functions registered by started plug-ins
- * until there are no more active run functions. This function is normally
+ * until there are no more active run functions. If only delayed run
+ * functions are left, this function sleeps until the next one is due
+ * or until another thread registers a run function. This function is normally
  * called by a thin main proram, a loader, which loads plug-ins, starts some
  * plug-ins and then passes control over to the started plug-ins.
  * 
@@ -1548,14 +3608,65 @@ CP_C_API void cp_run_plugins(cp_context_t *ctx) CP_GCC_NONNULL(1);
  * active run function registered by a started plug-in. When the run function
  * returns this function also returns and passes control back to the main
  * program. The return value can be used to determine whether there are any
- * active run functions left. This function does nothing if there are no active
- * registered run functions.
+ * active run functions left. This function does nothing if there are no
+ * run functions waiting to be run. Delayed run functions are run once
+ * they are due but this function does not wait for them.
  * 
  * @param ctx the plug-in context containing the plug-ins
- * @return whether there are active run functions waiting to be run
+ * @return whether there are active run functions waiting to be run or delayed
  */
 CP_C_API int cp_run_plugins_step(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Runs registered run functions until the specified time budget has been
+ * used. This function calls waiting run functions one at a time and
+ * returns when there are no more waiting run functions or when the
+ * budget has elapsed after a run function returns. At least one run
+ * function is run if there is one waiting. A run function is never
+ * interrupted, so a long running run function may exceed the budget.
+ * Delayed run functions are run if they become due within the budget but
+ * this function does not wait for them. The main program can use this
+ * function to interleave plug-in work with its own event loop.
+ * 
+ * @param ctx the plug-in context containing the plug-ins
+ * @param budget_us the time budget in microseconds
+ * @return whether there are active run functions waiting to be run or delayed
+ */
+CP_C_API int cp_run_plugins_for(cp_context_t *ctx, unsigned long budget_us) CP_GCC_NONNULL(1);
+
+/**
+ * Waits until there is a run function waiting to be run or the specified
+ * timeout has elapsed. A run function becomes waiting when a plug-in
+ * registers it, when a running run function asks to be called again or
+ * when a delayed run function is due. This function does not run any run
+ * functions. The main program can use it between calls to
+ * ::cp_run_plugins_step instead of polling. Without multi-threading support
+ * this function returns as soon as there is nothing that could become
+ * waiting within the timeout.
+ * 
+ * @param ctx the plug-in context containing the plug-ins
+ * @param timeout_us the timeout in microseconds, zero to return immediately or negative to wait indefinitely
+ * @return whether there are run functions waiting to be run
+ */
+CP_C_API int cp_run_plugins_wait(cp_context_t *ctx, long timeout_us) CP_GCC_NONNULL(1);
+
+/**
+ * Runs the started plug-ins using several threads as long as there is
+ * something to run. The threads share the queue of registered run
+ * functions and each idle thread calls the next waiting run function, so
+ * different run functions are executed in parallel but a single run
+ * function is never executed concurrently with itself. This function
+ * returns when there are no more active run functions and the helper
+ * threads have terminated. If at most one thread is specified or the
+ * framework was built without multi-threading support, this function
+ * behaves like ::cp_run_plugins. This function must not be called from
+ * within a run function.
+ * 
+ * @param ctx the plug-in context containing the plug-ins
+ * @param num_threads the total number of threads, including the calling thread
+ */
+CP_C_API void cp_run_plugins_parallel(cp_context_t *ctx, int num_threads) CP_GCC_NONNULL(1);
+
 /**
  * Sets startup arguments for the specified plug-in context. Like for usual
  * C main functions, the first argument is expected to be the name of the
@@ -1655,6 +3766,63 @@ CP_C_API void *cp_resolve_symbol(cp_context_t *ctx, const char *id, const char *
  */
 CP_C_API void cp_release_symbol(cp_context_t *ctx, const void *ptr) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Resolves several symbols provided by the specified plug-in at once. This
+ * is equivalent to calling ::cp_resolve_symbol for each symbol name but the
+ * plug-in context is locked and the plug-in is looked up and started only
+ * once. Either all or none of the symbols are resolved. The symbols can be
+ * released using ::cp_release_symbols or ::cp_release_symbol.
+ *
+ * @param ctx the plug-in context
+ * @param id the identifier of the symbol defining plug-in
+ * @param names the names of the symbols
+ * @param ptrs filled with the pointers associated with the symbols, or NULLs on failure
+ * @param n the number of symbols
+ * @param status a pointer to the location where the status code is to be stored, or NULL
+ * @return the number of resolved symbols, @a n on success or zero on failure
+ */
+CP_C_API int cp_resolve_symbols(cp_context_t *ctx, const char *id, const char * const *names, void **ptrs, int n, cp_status_t *status) CP_GCC_NONNULL(1, 2, 3, 4);
+
+/**
+ * Releases several previously obtained symbols at once, as if
+ * ::cp_release_symbol was called for each of them. NULL pointers are
+ * ignored so that the result of a failed ::cp_resolve_symbols can be
+ * passed in.
+ *
+ * @param ctx the plug-in context
+ * @param ptrs the pointers associated with the symbols
+ * @param n the number of pointers
+ */
+CP_C_API void cp_release_symbols(cp_context_t *ctx, void * const *ptrs, int n) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Initializes a pre-hashed symbol key for the specified symbol name. The
+ * name is interned and its hash value is computed once so that plug-ins
+ * resolving the same symbol repeatedly can use ::cp_resolve_symbol_by_key
+ * instead of ::cp_resolve_symbol. The key can be used with any plug-in
+ * context that shares the same plug-in framework and it remains valid
+ * until the framework is destroyed.
+ *
+ * @param ctx the plug-in context
+ * @param name the name of the symbol
+ * @param key the key to be initialized
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_C_API cp_status_t cp_symbol_key(cp_context_t *ctx, const char *name, cp_symbol_key_t *key) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Resolves a symbol provided by the specified plug-in using a pre-hashed
+ * symbol key. This is otherwise equivalent to ::cp_resolve_symbol. The
+ * symbol can be released using ::cp_release_symbol.
+ *
+ * @param ctx the plug-in context
+ * @param id the identifier of the symbol defining plug-in
+ * @param key the symbol key initialized using ::cp_symbol_key
+ * @param status a pointer to the location where the status code is to be stored, or NULL
+ * @return the pointer associated with the symbol or NULL on failure
+ */
+CP_C_API void *cp_resolve_symbol_by_key(cp_context_t *ctx, const char *id, const cp_symbol_key_t *key, cp_status_t *status) CP_GCC_NONNULL(1, 2, 3);
+
 /*@}*/
 
 
@@ -1662,9 +3830,9 @@ CP_C_API void cp_release_symbol(cp_context_t *ctx, const void *ptr) CP_GCC_NONNU
  * @defgroup cFuncsLoaders Plug-in loaders
  * @ingroup cFuncs
  *
- * These functions are used to construct standard plug-in loaders. Currently
- * there is a single plug-in loader for loading plug-ins from local plug-in
- * collections. 
+ * These functions are used to construct standard plug-in loaders. There is
+ * a plug-in loader for loading plug-ins from local plug-in collections and
+ * a plug-in loader for loading plug-ins from a registry snapshot.
  */
 /*@{*/
 
@@ -1720,6 +3888,207 @@ CP_C_API void cp_lpl_unregister_dir(cp_plugin_loader_t *loader, const char *dir)
  */
 CP_C_API void cp_lpl_unregister_dirs(cp_plugin_loader_t *loader) CP_GCC_NONNULL(1);
 
+/**
+ * Sets the number of threads the specified local plug-in loader uses for
+ * parsing plug-in descriptors during a plug-in scan. By default the
+ * descriptors are parsed serially by the scanning thread. If more than one
+ * thread is specified, the descriptors are parsed concurrently and the
+ * context is locked only for logging and for merging the results. The
+ * plug-in versions chosen are the same as with serial parsing. This
+ * setting has no effect if the framework was built without multi-threading
+ * support.
+ *
+ * @param loader the plug-in loader obtained from ::cp_create_local_ploader
+ * @param num_threads the number of parser threads, or 0 or 1 for serial parsing
+ */
+CP_C_API void cp_lpl_set_parser_threads(cp_plugin_loader_t *loader, int num_threads) CP_GCC_NONNULL(1);
+
+/**
+ * Saves a registry snapshot of the plug-ins currently installed in the
+ * specified plug-in context. The snapshot contains the complete plug-in
+ * information of the installed plug-ins, including the extension
+ * configuration, and it can be loaded using a snapshot plug-in loader
+ * created by ::cp_create_snapshot_ploader. Loading plug-ins from a
+ * snapshot avoids scanning plug-in collections and parsing plug-in
+ * descriptors. An existing snapshot file is replaced.
+ *
+ * @param ctx the plug-in context
+ * @param path the snapshot file path
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_IO if the snapshot could not be written or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_save_snapshot(cp_context_t *ctx, const char *path) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Creates and returns a new instance of a snapshot plug-in loader. The
+ * loader provides the plug-ins stored in the specified registry snapshot
+ * file previously saved using ::cp_save_snapshot. The snapshot file is
+ * read when plug-ins are scanned. The created plug-in loader can be
+ * registered with a plug-in context using ::cp_register_ploader. The
+ * resources used by the returned instance can be released by calling
+ * ::cp_destroy_snapshot_ploader when the loader is not needed anymore.
+ *
+ * @param path the snapshot file path
+ * @param status pointer to the location where status code is to be stored, or NULL
+ * @return the new plug-in loader instance, or NULL on failure
+ */
+CP_C_API cp_plugin_loader_t *cp_create_snapshot_ploader(const char *path, cp_status_t *status) CP_GCC_NONNULL(1);
+
+/**
+ * Releases the resources allocated by a previously created snapshot
+ * plug-in loader. The specified loader must have been obtained by a call
+ * to ::cp_create_snapshot_ploader. The loader to be destroyed must not be
+ * registered with any plug-in context.
+ *
+ * @param loader the plug-in loader to be destroyed
+ */
+CP_C_API void cp_destroy_snapshot_ploader(cp_plugin_loader_t *loader) CP_GCC_NONNULL(1);
+
+/**
+ * Saves the plug-ins currently installed in the specified plug-in context
+ * into a packed plug-in archive. The archive is a single file containing
+ * an index, the complete plug-in information of the installed plug-ins
+ * and their runtime libraries. Other files in the plug-in directories
+ * are not included. The archive can be loaded using an archive plug-in
+ * loader created by ::cp_create_archive_ploader. An existing archive file
+ * is replaced.
+ *
+ * @param ctx the plug-in context
+ * @param path the archive file path
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_IO if a runtime library could not be read or the archive could not be written or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_save_archive(cp_context_t *ctx, const char *path) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Creates and returns a new instance of an archive plug-in loader. The
+ * loader provides the plug-ins stored in the specified plug-in archive
+ * previously saved using ::cp_save_archive. The archive is mapped into
+ * memory and its index is read when plug-ins are scanned, so scanning does
+ * not access the individual plug-in directories. The runtime library of a
+ * plug-in is extracted from the archive only when the plug-in is resolved,
+ * into a subdirectory named after the plug-in identifier in the
+ * specified extraction directory, which becomes the plug-in path. The
+ * created plug-in loader can be registered with a plug-in context using
+ * ::cp_register_ploader. The resources used by the returned instance can
+ * be released by calling ::cp_destroy_archive_ploader when the loader is
+ * not needed anymore.
+ *
+ * @param path the archive file path
+ * @param extract_dir the directory for extracted runtime libraries, or NULL to use the archive path followed by ".d"
+ * @param status pointer to the location where status code is to be stored, or NULL
+ * @return the new plug-in loader instance, or NULL on failure
+ */
+CP_C_API cp_plugin_loader_t *cp_create_archive_ploader(const char *path, const char *extract_dir, cp_status_t *status) CP_GCC_NONNULL(1);
+
+/**
+ * Releases the resources allocated by a previously created archive
+ * plug-in loader. The specified loader must have been obtained by a call
+ * to ::cp_create_archive_ploader. The loader to be destroyed must not be
+ * registered with any plug-in context. Extracted runtime libraries are
+ * not removed.
+ *
+ * @param loader the plug-in loader to be destroyed
+ */
+CP_C_API void cp_destroy_archive_ploader(cp_plugin_loader_t *loader) CP_GCC_NONNULL(1);
+
+/**
+ * Exports the plug-ins currently installed in the specified plug-in context
+ * into a plug-in repository directory that can be published on an HTTP
+ * server and used by remote plug-in loaders created by
+ * ::cp_create_remote_ploader. The plug-in descriptor and the runtime
+ * library of each plug-in are copied into a subdirectory named after the
+ * plug-in identifier and the repository index is written last, listing
+ * the SHA-256 hashes and the sizes of the copied files. Finally the SHA-256 hash of the
+ * index itself is written into a file named index.sha256, in the format
+ * used by the sha256sum utility. That hash is meant to be passed to the
+ * users of the repository through a trusted channel, see
+ * ::cp_rpl_set_index_hash. Other files in the plug-in directories are not
+ * included. Existing files are replaced.
+ *
+ * @param ctx the plug-in context
+ * @param dir the repository directory
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_IO if a file could not be read or written or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_save_repository(cp_context_t *ctx, const char *dir) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Creates and returns a new instance of a remote plug-in loader. The
+ * loader provides the plug-ins listed in the index of a plug-in repository
+ * previously exported using ::cp_save_repository. The repository is
+ * accessed using the specified base URL, which is either an HTTP URL,
+ * a file URL or a local directory path. When plug-ins are scanned the
+ * loader fetches the repository index and the plug-in descriptors, and the
+ * runtime library of a plug-in is fetched only when the plug-in is
+ * resolved. All fetched files are verified against the hashes listed in
+ * the index and kept in a content-addressed cache in the specified local
+ * directory, so files already in the cache are never fetched again, also
+ * across restarts and by other processes sharing the cache. If the
+ * repository can not be reached, the index saved on the last successful
+ * scan is used. The plug-in path of a plug-in is its cache subdirectory.
+ * An HTTP download fails as soon as it exceeds the size of the file
+ * listed in the index, or 64 MiB if no size is listed. Only a trusted
+ * index can raise the limit above 64 MiB.
+ *
+ * The hashes in the index only protect against damaged downloads and
+ * cache files. They do not authenticate the repository because an
+ * attacker able to modify a plain HTTP response can replace the index as
+ * well. A repository accessed over HTTP is therefore trusted only if the
+ * hash of its index has been pinned using ::cp_rpl_set_index_hash, in
+ * which case every index not matching the pinned hash is rejected. Plug-in
+ * descriptors are loaded from untrusted repositories but their runtime
+ * libraries are never loaded, so resolving such plug-ins fails. A
+ * repository on the local file system is trusted like a local plug-in
+ * collection. Whoever can write to the cache directory can replace the
+ * cached files, so it must not be writable by untrusted users.
+ *
+ * The created plug-in loader can be registered with a plug-in context
+ * using ::cp_register_ploader. The resources used by the returned instance
+ * can be released by calling ::cp_destroy_remote_ploader when the loader
+ * is not needed anymore.
+ *
+ * @param url the repository base URL
+ * @param cache_dir the local cache directory
+ * @param status pointer to the location where status code is to be stored, or NULL
+ * @return the new plug-in loader instance, or NULL on failure
+ */
+CP_C_API cp_plugin_loader_t *cp_create_remote_ploader(const char *url, const char *cache_dir, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Releases the resources allocated by a previously created remote
+ * plug-in loader. The specified loader must have been obtained by a call
+ * to ::cp_create_remote_ploader. The loader to be destroyed must not be
+ * registered with any plug-in context. The cache is not removed.
+ *
+ * @param loader the plug-in loader to be destroyed
+ */
+CP_C_API void cp_destroy_remote_ploader(cp_plugin_loader_t *loader) CP_GCC_NONNULL(1);
+
+/**
+ * Sets the number of threads used by a remote plug-in loader to download
+ * plug-in descriptors concurrently when plug-ins are scanned. By default,
+ * and if the number is 0 or 1, the descriptors are downloaded serially by
+ * the scanning thread. Without multi-threading support the descriptors are
+ * always downloaded serially.
+ *
+ * @param loader the plug-in loader obtained from ::cp_create_remote_ploader
+ * @param num_threads the number of download threads, or 0 or 1 for serial downloads
+ */
+CP_C_API void cp_rpl_set_download_threads(cp_plugin_loader_t *loader, int num_threads) CP_GCC_NONNULL(1);
+
+/**
+ * Pins the SHA-256 hash of the repository index of a remote plug-in
+ * loader. The loader then rejects any index not matching the hash and
+ * loads runtime libraries also from a repository accessed over plain
+ * HTTP. The hash is written by ::cp_save_repository into the index.sha256
+ * file of the repository and must be obtained through a channel the
+ * client program trusts, not from the repository server. This must be
+ * called before the loader is registered with any plug-in context.
+ *
+ * @param loader the plug-in loader obtained from ::cp_create_remote_ploader
+ * @param hash the hash of the index in hexadecimal notation, or NULL to remove the pin
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_MALFORMED if the hash is not valid
+ */
+CP_C_API cp_status_t cp_rpl_set_index_hash(cp_plugin_loader_t *loader, const char *hash) CP_GCC_NONNULL(1);
+
 /*@}*/
 
 
@@ -43,10 +43,39 @@
 #include "../kazlib/list.h"
 #include "../kazlib/hash.h"
 #include "cpluff.h"
+#include "util.h"
 #ifdef CP_THREADS
 #include "thread.h"
 #endif
 #include "shared.h"
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Configuration
+ * ----------------------------------------------------------------------*/
+
+/// Whether repeated symbol resolutions are served from a lock-free cache
+#if defined(CP_THREADS) && defined(HAVE_ATOMIC_BUILTINS)
+#define CP_SYMBOL_CACHE
+#endif
+
+/// Whether information objects can be released without locking the context
+#if defined(CP_THREADS) && defined(HAVE_ATOMIC_BUILTINS)
+#define CP_ATOMIC_INFOS
+#endif
+
+/// Whether messages can be passed to loggers without locking the context
+#if defined(CP_THREADS) && defined(HAVE_ATOMIC_BUILTINS)
+#define CP_SHARED_LOGGING
+#endif
+
+/// Whether information objects can be returned with shared access to the context
+#if defined(CP_ATOMIC_INFOS) && defined(NDEBUG)
+#define CP_SHARED_INFOS
+#endif
 
 
 #ifdef __cplusplus
@@ -73,6 +102,18 @@ extern "C" {
 /// Callback function stop function
 #define CPI_CF_STOP 8
 
+/// Callback function plug-in or extension visitor function
+#define CPI_CF_VISITOR 16
+
+/// Callback function create function, no framework function may be called
+#define CPI_CF_CREATE 32
+
+/// Callback function destroy function, no framework function may be called
+#define CPI_CF_DESTROY 64
+
+/// Not a callback function, marks an operation holding the lifecycle lock
+#define CPI_CF_LIFECYCLE 128
+
 /// Bitmask corresponding to any callback function
 #define CPI_CF_ANY (~0)
 
@@ -120,6 +161,74 @@ extern "C" {
 
 typedef struct cp_plugin_t cp_plugin_t;
 typedef struct cp_plugin_env_t cp_plugin_env_t;
+typedef struct cpi_descriptor_cache_t cpi_descriptor_cache_t;
+typedef struct cpi_prefetch_t cpi_prefetch_t;
+typedef struct cpi_logger_t cpi_logger_t;
+typedef struct cpi_logger_snapshot_t cpi_logger_snapshot_t;
+typedef struct cpi_log_ring_t cpi_log_ring_t;
+typedef struct cpi_symbol_cache_t cpi_symbol_cache_t;
+typedef struct cpi_plugin_set_t cpi_plugin_set_t;
+typedef struct cpi_plistener_t cpi_plistener_t;
+typedef struct cpi_plistener_set_t cpi_plistener_set_t;
+typedef struct cpi_cfg_stream_t cpi_cfg_stream_t;
+typedef struct cpi_ploader_options_t cpi_ploader_options_t;
+struct stat;
+
+/// Pre-parsed versions of a plug-in description
+typedef struct cpi_plugin_versions_t {
+	
+	/// The plug-in version
+	cpi_version_t version;
+	
+	/// The ABI backwards compatibility version
+	cpi_version_t abi_bw_compatibility;
+	
+	/// The required C-Pluff version
+	cpi_version_t req_cpluff_version;
+	
+	/// The required import versions, indexed like the imports, or NULL if no imports
+	cpi_version_t *imports;
+	
+} cpi_plugin_versions_t;
+
+/// Registration options of a plug-in loader kept apart from the loader structure
+struct cpi_ploader_options_t {
+	
+	/// The registration flags
+	int flags;
+	
+	/// The incremental scanning function, or NULL if not supported
+	cp_scan_changes_func_t scan_changes;
+	
+};
+
+/// A set of plug-ins stored in a growable array, used for dependency edges
+struct cpi_plugin_set_t {
+	
+	/// The plug-ins, or NULL if nothing has been allocated
+	cp_plugin_t **plugins;
+	
+	/// The number of plug-ins in the set
+	int num;
+	
+	/// The allocated size of the array
+	int size;
+	
+};
+
+/// Plug-in listener registrations stored in a growable array
+struct cpi_plistener_set_t {
+	
+	/// The registrations in registration order, or NULL if nothing has been allocated
+	cpi_plistener_t *listeners;
+	
+	/// The number of registrations
+	int num;
+	
+	/// The allocated size of the array
+	int size;
+	
+};
 
 // Plug-in context
 struct cp_context_t {
@@ -136,6 +245,16 @@ struct cp_context_t {
 	/// Information about symbol providing plugins or NULL if not initialized
 	hash_t *symbol_providers;
 	
+	/// The minimum severity of messages logged for this context
+	const int *log_threshold;
+	
+#ifdef CP_SYMBOL_CACHE
+
+	/// Lock-free cache of resolved symbols or NULL if not initialized
+	cpi_symbol_cache_t *symbol_cache;
+
+#endif
+	
 };
 
 // Plug-in environment
@@ -151,6 +270,12 @@ struct cp_plugin_env_t {
 	int locked;
 #endif
 
+	/// Number of threads holding the lifecycle lock
+	int lifecycle_holders;
+	
+	/// Number of lifecycle lock holders waiting for run functions to return
+	int lifecycle_yields;
+
 	/// Number of startup arguments
 	int argc;
 	
@@ -163,62 +288,248 @@ struct cp_plugin_env_t {
 	/// Plugin descriptor's XML root element
 	const char *plugin_descriptor_root_element;
 
-	/// Installed plug-in listeners 
-	list_t *plugin_listeners;
+	/// Persistent plug-in descriptor cache, or NULL if none
+	cpi_descriptor_cache_t *descriptor_cache;
+	
+	/// Whether extension configuration is parsed lazily
+	int lazy_cfg;
+	
+	/// Whether all plug-ins are activated lazily
+	int lazy_activation;
+	
+	/// Whether loaded plug-in descriptors are shared with other contexts
+	int shared_descriptors;
+	
+	/// The number of threads stopping plug-ins in fast exit mode, or 0 if not enabled
+	int fast_exit_threads;
+	
+	/// The maximum number of runtime libraries retained for reinstalled plug-ins, or 0 if none
+	int max_retained_runtimes;
+	
+	/// Retained runtime libraries keyed by plug-in identifier, or NULL if none retained yet
+	hash_t *retained_runtimes;
+	
+	/// Retained runtime libraries, least recently retained first, or NULL if none retained yet
+	list_t *retained_order;
+	
+	/// Streaming configuration consumers keyed by extension point identifier
+	hash_t *cfg_streams;
+	
+	/// Configuration schemas keyed by extension point identifier
+	hash_t *cfg_schemas;
+	
+	/// Runtime library prefetch in progress, or NULL if none
+	cpi_prefetch_t *prefetch;
+	
+#ifdef CP_THREADS
+	/// Queued asynchronous plug-in start and stop requests
+	list_t *async_ops;
+	
+	/// The asynchronous plug-in control worker, or NULL if not running
+	cpi_thread_t *async_thread;
+	
+	/// Whether the worker should exit once the queued requests are done
+	int async_shutdown;
+	
+	/// Lock contention statistics, or NULL if not collected
+	cpi_lock_stats_t *lock_stats;
+#endif
+	
+	/// Whether plug-in lifecycle timings are recorded
+	int timings_enabled;
+	
+	/// Summary of the recorded plug-in lifecycle timings
+	cp_timings_summary_t timings;
+	
+	/// The trace hook, or NULL if none
+	cp_trace_hook_func_t trace_hook;
+	
+	/// The user data pointer passed to the trace hook
+	void *trace_user_data;
+
+	/// Installed plug-in listeners not restricted to a single plug-in
+	cpi_plistener_set_t plugin_listeners;
+	
+	/// Plug-in listeners for a single plug-in, sets keyed by plug-in identifier
+	hash_t *plugin_listener_index;
+	
+	/// Installed batch plug-in listeners
+	cpi_plistener_set_t batch_listeners;
+	
+#ifdef CP_THREADS
+	/// Plug-in events queued for the batch plug-in listeners
+	cp_plugin_event_t *event_queue;
+	
+	/// The number of queued plug-in events
+	int num_events;
 	
-	/// Registered loggers
-	list_t *loggers;
+	/// The capacity of the plug-in event queue
+	int max_events;
+	
+	/// The batch plug-in listener dispatcher, or NULL if not running
+	cpi_thread_t *event_thread;
+	
+	/// Whether the dispatcher should exit once the queued events are delivered
+	int event_shutdown;
+	
+	/// Whether the dispatcher is delivering events without the context lock
+	int delivering_events;
+#endif
+	
+	/// Registered loggers in the order they were registered
+	cpi_logger_t *loggers;
+	
+	/// The number of registered loggers
+	int num_loggers;
+	
+	/// The allocated size of the logger array
+	int loggers_size;
 
 	/// Minimum logger selection severity
 	int log_min_severity;
+	
+	/// Minimum severity logged for contexts without a threshold of their own
+	int log_default_threshold;
+	
+	/// Maps plug-in identifiers to the minimum severities logged for them
+	hash_t *log_thresholds;
+	
+	/// Whether cp_log passes messages to loggers without holding the lock
+	int concurrent_logging;
+	
+#ifdef CP_SHARED_LOGGING
+	/// Immutable copy of the registered loggers, or NULL if not available
+	cpi_logger_snapshot_t *logger_snapshot;
+	
+	/// The number of threads waiting for a replaced logger snapshot to be released
+	int num_snapshot_waiters;
+	
+	/// The logger snapshot in use by the asynchronous logging thread, or NULL
+	cpi_logger_snapshot_t *logger_hazard;
+	
+	/// The asynchronous logging ring, or NULL if logging synchronously
+	cpi_log_ring_t *log_ring;
+	
+	/// The number of messages dropped because the logging ring was full
+	unsigned long log_dropped;
+	
+	/// The capacity of the logging ring stopped for forking, or 0 if none
+	int fork_log_capacity;
+	
+	/// The flags of the logging ring stopped for forking
+	int fork_log_flags;
+#endif
 
     /// The implicit local plug-in loader, or NULL if none
     cp_plugin_loader_t *local_loader;
 
 	/// Maps registered plug-in loaders to the lists of plug-in identifiers
-	hash_t *loaders_to_plugins;
+	cpi_hmap_t *loaders_to_plugins;
+	
+	/// Maps registered plug-in loaders having options to their options
+	cpi_hmap_t *ploader_options;
+
+#ifdef CP_THREADS
+	/// Whether thread-safe plug-in loaders are being scanned concurrently
+	int concurrent_scan;
+#endif
 	
-	/// Map of in-use reference counted information objects
-	hash_t *infos;
+	/// Set of in-use reference counted information objects
+	cpi_hmap_t *infos;
+
+#ifdef CP_SHARED_INFOS
+
+	/// Mutex protecting the set of information objects, a leaf lock
+	cpi_mutex_t *infos_mutex;
+
+#endif
 
 	/// Maps plug-in identifiers to plug-in state structures 
-	hash_t *plugins;
+	cpi_hmap_t *plugins;
 
-	/// List of started plug-ins in the order they were started 
-	list_t *started_plugins;
+	/// Started plug-ins in the order they were started 
+	cpi_plugin_set_t started_plugins;
+	
+	/// Maps imported plug-in identifiers to the installed plug-ins importing them
+	hash_t *dependents;
+	
+	/// Cached topological order of the installed plug-ins, imported plug-ins first
+	cpi_plugin_set_t topo_order;
+	
+	/// The pre-parsed C-Pluff version
+	cpi_version_t cpluff_version;
+	
+	/// The pre-parsed C-Pluff ABI compatibility version
+	cpi_version_t cpluff_abi_compatibility;
+	
+	/// Whether the cached topological order is up to date
+	int topo_valid;
 
 	/// Maps extension point names to installed extension points
-	hash_t *ext_points;
+	cpi_hmap_t *ext_points;
 	
 	/// Maps extension point names to installed extensions
-	hash_t *extensions;
+	cpi_hmap_t *extensions;
 	
-	/// FIFO queue of run functions, currently running functions at front
-	list_t *run_funcs;
+	/// Maps extension point names to snapshots of installed extensions
+	hash_t *extension_snapshots;
 	
-	/// First waiting run function, or NULL if none
-	lnode_t *run_wait;
-
-	/// Is logger currently being invoked
-	int in_logger_invocation;
-
-	/// Whether currently in event listener invocation
-	int in_event_listener_invocation;
+	/// Maps plug-in identifiers to plug-in handles, or NULL if none created yet
+	hash_t *plugin_handles;
+	
+	/// Generation of the plug-in registry, updated atomically if available
+	unsigned int registry_generation;
+	
+	/// Maps extension point names to the registry generation of their last change
+	hash_t *ext_point_generations;
+	
+	/// Whether a change of an extension point could not be recorded
+	int ext_point_generations_lost;
+	
+	/// Extension indexes maintained for the installed extensions
+	list_t *extension_indexes;
+	
+	/// Set of interned strings
+	hash_t *strings;
+	
+	/// Memory arena holding the interned strings
+	struct cpi_arena_t *strings_arena;
+	
+	/// All registered run functions, including those in execution
+	hash_t *run_funcs;
 	
-	/// Whether currently in start function invocation
-	int in_start_func_invocation;
+	/// Round-robin queue of plug-ins having waiting run functions
+	list_t *run_queue;
 	
-	/// Whether currently in stop function invocation
-	int in_stop_func_invocation;
+	/// The number of run functions currently in execution
+	int num_run_executing;
 	
-	/// Whether currently in create function invocation
-	int in_create_func_invocation;
+	/// Delayed run functions as a binary heap ordered by due time
+	lnode_t **run_delayed;
 	
-	/// Whether currently in destroy function invocation
-	int in_destroy_func_invocation;
+	/// The number of delayed run functions
+	unsigned int num_run_delayed;
 	
-	/// Whether currently in plug-in loader function invocation
-	int in_plugin_loader_invocation;
+	/// The capacity of the delayed run function heap
+	unsigned int max_run_delayed;
+
+#ifdef CP_SYMBOL_CACHE
+
+	/// Generation of cached symbols, incremented when a plug-in stops
+	unsigned int symbol_generation;
+
+#endif
+	
+};
+
+/// A stable handle to the state of a plug-in
+struct cp_plugin_handle_t {
+	
+	/// The plug-in identifier
+	char *identifier;
+	
+	/// The current plug-in state, updated atomically if available
+	int state;
 	
 };
 
@@ -237,17 +548,35 @@ struct cp_plugin_t {
 	/// The current state of the plug-in 
 	cp_plugin_state_t state;
 	
-	/// The set of imported plug-ins, or NULL if not resolved 
-	list_t *imported;
+	/// The set of imported plug-ins, empty if not resolved 
+	cpi_plugin_set_t imported;
 	
 	/// The set of plug-ins importing this plug-in 
-	list_t *importing;
+	cpi_plugin_set_t importing;
+	
+	/// Installed plug-ins matching the imports, indexed like the imports, or NULL
+	cp_plugin_t **import_targets;
+	
+	/// Installed plug-ins declaring an import of this plug-in, or NULL if none
+	cpi_plugin_set_t *dependents;
+	
+	/// Nodes of the extensions in the extension lists, indexed like the extensions, or NULL
+	lnode_t *extension_nodes;
+	
+	/// The handle publishing the plug-in state, or NULL if none
+	cp_plugin_handle_t *handle;
 	
 	/// The runtime library handle, or NULL if not resolved 
 	DLHANDLE runtime_lib;
 	
+	/// The runtime library handle opened by a prefetch, or NULL if none
+	DLHANDLE prefetched_lib;
+	
 	/// Plug-in runtime function information, or NULL if not resolved
 	cp_plugin_runtime_t *runtime_funcs;
+	
+	/// Static symbol export table, or NULL if none or not resolved
+	const cp_symbol_table_t *symbol_table;
 
 	/// Plug-in instance data or NULL if instance does not exist
 	void *plugin_data;
@@ -258,6 +587,18 @@ struct cp_plugin_t {
 	/// Used by recursive operations: has this plug-in been processed already
 	int processed;
 	
+	/// Recorded lifecycle timings, excluding descriptor parsing
+	cp_plugin_timings_t timings;
+	
+	/// FIFO queue of the waiting run functions of the plug-in
+	list_t run_wait;
+	
+	/// Node in the round-robin queue of the plug-in environment
+	lnode_t run_queue_node;
+	
+	/// The number of run functions of the plug-in currently in execution
+	int num_run_executing;
+	
 };
 
 
@@ -270,6 +611,37 @@ struct cp_plugin_t {
  */
 typedef void (*cpi_dealloc_func_t)(cp_context_t *ctx, void *resource);
 
+/**
+ * The header stored immediately before each reference counted information
+ * object. The union makes the object following the header suitably aligned.
+ */
+typedef union cpi_info_header_t {
+	
+	/// The header fields
+	struct {
+	
+		/// Magic value identifying a registered information object
+		unsigned int magic;
+		
+		/// Usage count, updated atomically if ::CP_ATOMIC_INFOS is defined
+		int usage_count;
+		
+		/// Deallocation function
+		cpi_dealloc_func_t dealloc_func;
+		
+	} h;
+	
+	/// Alignment for pointer members of the object
+	void *align_ptr;
+	
+	/// Alignment for floating point members of the object
+	long double align_ld;
+	
+} cpi_info_header_t;
+
+/// Returns the header of the specified information object
+#define cpi_info_header(res) (((cpi_info_header_t *) (res)) - 1)
+
 typedef struct cpi_plugin_event_t cpi_plugin_event_t;
 
 /// Plug-in event information
@@ -285,13 +657,88 @@ struct cpi_plugin_event_t {
 	cp_plugin_state_t new_state;
 };
 
+typedef struct cpi_invocation_t cpi_invocation_t;
+
+/// A callback function invocation in progress in the current thread
+struct cpi_invocation_t {
+	
+	/// The plug-in environment invoking the callback
+	cp_plugin_env_t *env;
+	
+	/// The type of the callback function, one of the CPI_CF_* flags
+	int cf;
+	
+	/// The enclosing invocation of the thread or NULL if none
+	cpi_invocation_t *enclosing;
+};
+
 
 /* ------------------------------------------------------------------------
  * Function declarations
  * ----------------------------------------------------------------------*/
 
 
-// Locking data structures for exclusive access 
+// Locking data structures for exclusive and shared access 
+
+/*
+ * Lock order. The lifecycle lock of a plug-in environment serializes
+ * plug-in lifecycle transitions, that is starting, stopping, resolving,
+ * unresolving and uninstalling plug-ins, while the context lock protects
+ * the registry and all other environment data. The lifecycle lock is
+ * acquired first, then the context lock and finally the framework lock.
+ * The lifecycle lock is implemented on top of the context lock so that
+ * waiting for it releases the context lock. A thread invoking a plug-in
+ * start or stop function on behalf of a lifecycle operation is considered
+ * to hold the lifecycle lock. The sole holder of the lifecycle lock
+ * releases the context lock while invoking plug-in start and stop
+ * functions, so that unrelated API calls, such as information queries,
+ * logging and resolving symbols of active plug-ins, do not have to wait
+ * for them. The plug-ins being started or stopped are in a transitional
+ * state meanwhile and any lifecycle operation concerning them waits.
+ */
+
+/**
+ * Acquires the lifecycle lock of the specified plug-in context unless the
+ * calling thread already holds it. The context lock is released while
+ * waiting. The caller must hold the context lock and must look up any
+ * plug-ins only after this call. The invocation record must be passed to
+ * ::cpi_end_lifecycle when the lifecycle operation is complete.
+ * 
+ * @param context the plug-in context
+ * @param inv the invocation record to be initialized
+ */
+CP_HIDDEN void cpi_begin_lifecycle(cp_context_t *context, cpi_invocation_t *inv) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Releases the lifecycle lock acquired by ::cpi_begin_lifecycle once the
+ * outermost lifecycle operation of the calling thread is complete. The
+ * caller must hold the context lock.
+ * 
+ * @param context the plug-in context
+ * @param inv the invocation record
+ */
+CP_HIDDEN void cpi_end_lifecycle(cp_context_t *context, cpi_invocation_t *inv) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns whether the calling thread may release the context lock while
+ * invoking a plug-in start or stop function, that is whether it is the
+ * sole holder of the lifecycle lock and not already invoking plug-in
+ * code. The caller must hold the context lock.
+ * 
+ * @param context the plug-in context
+ * @return non-zero if the context lock may be released
+ */
+CP_HIDDEN int cpi_is_sole_lifecycle_holder(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Waits until the specified plug-in context is signalled, letting other
+ * threads perform lifecycle operations meanwhile. This is used by a
+ * lifecycle operation waiting for run functions, which may themselves
+ * start or stop plug-ins, to return.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_wait_context_yielding(cp_context_t *context) CP_GCC_NONNULL(1);
 
 #if defined(CP_THREADS) || !defined(NDEBUG)
 
@@ -307,6 +754,24 @@ CP_HIDDEN void cpi_lock_framework(void);
  */
 CP_HIDDEN void cpi_unlock_framework(void);
 
+#ifdef CP_THREADS
+
+/**
+ * Locks the framework and the small object free lists for forking a child
+ * process. The caller must have locked the plug-in contexts first.
+ */
+CP_HIDDEN void cpi_prepare_framework_fork(void);
+
+/**
+ * Releases the locks taken by ::cpi_prepare_framework_fork, reinitializing
+ * them first in a child process.
+ * 
+ * @param child whether called in the child process
+ */
+CP_HIDDEN void cpi_after_framework_fork(int child);
+
+#endif
+
 /**
  * Acquires exclusive access to a plug-in context and the associated
  * plug-in environment.
@@ -322,6 +787,25 @@ CP_HIDDEN void cpi_lock_context(cp_context_t *context) CP_GCC_NONNULL(1);
  */
 CP_HIDDEN void cpi_unlock_context(cp_context_t *context) CP_GCC_NONNULL(1);
 
+/**
+ * Acquires shared access to a plug-in context and the associated
+ * plug-in environment. Several threads may access the environment in
+ * shared mode at the same time, so the caller must not modify the
+ * environment, log messages or invoke client code while holding
+ * shared access. A thread that already has exclusive access keeps it.
+ * Shared access must not be acquired recursively.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_lock_context_shared(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Releases shared access to a plug-in context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_unlock_context_shared(cp_context_t *context) CP_GCC_NONNULL(1);
+
 /**
  * Waits until the specified plug-in context is signalled.
  * 
@@ -336,15 +820,36 @@ CP_HIDDEN void cpi_wait_context(cp_context_t *context) CP_GCC_NONNULL(1);
  */
 CP_HIDDEN void cpi_signal_context(cp_context_t *context) CP_GCC_NONNULL(1);
 
+/**
+ * Waits until no plug-in loaders of the specified plug-in context are
+ * being scanned concurrently. The caller must hold the context lock.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_wait_loader_scans(cp_context_t *context) CP_GCC_NONNULL(1);
+
 #else
 #define cpi_lock_context(dummy) do {} while (0)
 #define cpi_unlock_context(dummy) do {} while (0)
+#define cpi_lock_context_shared(dummy) do {} while (0)
+#define cpi_unlock_context_shared(dummy) do {} while (0)
 #define cpi_wait_context(dummy) do {} while (0)
 #define cpi_signal_context(dummy) do {} while (0)
+#define cpi_wait_loader_scans(dummy) do {} while (0)
 #define cpi_lock_framework() do {} while(0)
 #define cpi_unlock_framework() do {} while(0)
 #endif
 
+/**
+ * Waits until the specified plug-in context is signalled or the specified
+ * timeout has elapsed. Without multi-threading support this function just
+ * sleeps for the duration of the timeout.
+ * 
+ * @param context the plug-in context
+ * @param timeout the timeout in nanoseconds
+ */
+CP_HIDDEN void cpi_wait_context_timed(cp_context_t *context, unsigned long long timeout) CP_GCC_NONNULL(1);
+
 /** 
  * @def cpi_is_context_locked
  * 
@@ -398,7 +903,7 @@ CP_HIDDEN void cpi_logf(cp_context_t *ctx, cp_log_severity_t severity, const cha
  * @param severity the severity
  * @return whether the messages of the specified severity level are logged
  */
-#define cpi_is_logged(context, severity) (assert(cpi_is_context_locked(context)), (severity) >= (context)->env->log_min_severity)
+#define cpi_is_logged(context, severity) (assert(cpi_is_context_locked(context)), (severity) >= (context)->env->log_min_severity && (severity) >= *(context)->log_threshold)
 
 // Convenience macros for efficient logging
 #define cpi_log_cond(ctx, level, msg) do { if (cpi_is_logged((ctx), (level))) cpi_log((ctx), (level), (msg)); } while (0)
@@ -413,22 +918,106 @@ CP_HIDDEN void cpi_logf(cp_context_t *ctx, cp_log_severity_t severity, const cha
 #define cpi_debugf(ctx, msg, ...) cpi_logf_cond((ctx), CP_LOG_DEBUG, (msg), __VA_ARGS__)
 
 /**
- * Unregisters loggers in the specified logger list. Either unregisters all
- * loggers or only loggers installed by the specified plug-in.
+ * Unregisters loggers of the specified plug-in environment. Either
+ * unregisters all loggers or only loggers installed by the specified
+ * plug-in. The logger array is released when all loggers are unregistered.
  * 
- * @param loggers the logger list
+ * @param env the plug-in environment
  * @param plugin the plug-in whose loggers to unregister or NULL for all
  */
-CP_HIDDEN void cpi_unregister_loggers(list_t *loggers, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+CP_HIDDEN void cpi_unregister_loggers(cp_plugin_env_t *env, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Updates the logging limits and the logger snapshot after the registered
+ * loggers have changed. Waits for any concurrent logger invocations using
+ * the previous snapshot to return. The caller must have locked the
+ * context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_loggers_changed(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the location of the logging threshold applying to a context of
+ * the specified plug-in. The location remains valid as long as the
+ * plug-in environment exists.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the plug-in or NULL for the main program
+ * @return the location of the minimum severity logged
+ */
+CP_HIDDEN const int *cpi_log_threshold(cp_plugin_env_t *env, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Frees the per-plug-in logging thresholds of a plug-in environment.
+ * 
+ * @param env the plug-in environment
+ */
+CP_HIDDEN void cpi_free_log_thresholds(cp_plugin_env_t *env) CP_GCC_NONNULL(1);
+
+#ifdef CP_SHARED_LOGGING
+
+/**
+ * Passes the messages queued for asynchronous logging to the loggers and
+ * stops the asynchronous logging thread, if running. Later messages are
+ * logged synchronously. The caller must not hold the context lock.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_stop_async_logging(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Stops asynchronous logging like ::cpi_stop_async_logging but remembers
+ * the logging ring settings so that asynchronous logging can be resumed
+ * using ::cpi_resume_async_logging. Used when forking.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_suspend_async_logging(cp_context_t *context) CP_GCC_NONNULL(1);
 
 /**
- * Unregisters plug-in listeners in the specified list. Either unregisters all
- * listeners or only listeners installed by the specified plug-in.
+ * Resumes asynchronous logging suspended by ::cpi_suspend_async_logging,
+ * if it was enabled.
  * 
- * @param listeners the listener list
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_resume_async_logging(cp_context_t *context) CP_GCC_NONNULL(1);
+
+#else
+#define cpi_stop_async_logging(dummy) do {} while (0)
+#define cpi_suspend_async_logging(dummy) do {} while (0)
+#define cpi_resume_async_logging(dummy) do {} while (0)
+#endif
+
+/**
+ * Unregisters plug-in listeners in the specified set. Either unregisters all
+ * listeners or only listeners installed by the specified plug-in. The
+ * listener array is released when the set becomes empty.
+ * 
+ * @param listeners the listener set
  * @param plugin the plug-in whose listeners to unregister or NULL for all
  */
-CP_HIDDEN void cpi_unregister_plisteners(list_t *listeners, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+CP_HIDDEN void cpi_unregister_plisteners(cpi_plistener_set_t *listeners, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Unregisters the plug-in listeners indexed by plug-in identifier which
+ * have been registered by the specified plug-in, or all of them.
+ * 
+ * @param index the plug-in listener index
+ * @param plugin the plug-in whose listeners are to be unregistered or NULL for all
+ */
+CP_HIDDEN void cpi_unregister_indexed_plisteners(hash_t *index, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Unregisters the batch plug-in listeners registered by the specified
+ * plug-in, or all of them, and waits for a delivery in progress to
+ * complete so that the removed listeners are no longer being called.
+ * The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in whose listeners are to be unregistered or NULL for all
+ */
+CP_HIDDEN void cpi_unregister_batch_plisteners(cp_context_t *context, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
 
 /**
  * Returns the owner name for a context.
@@ -448,10 +1037,41 @@ CP_HIDDEN char *cpi_context_owner(cp_context_t *ctx, char *name, size_t size) CP
  */
 CP_HIDDEN void cpi_fatal_null_arg(const char *arg, const char *func) CP_GCC_NORETURN CP_GCC_NONNULL(1, 2);
 
+/**
+ * Records that the calling thread is about to invoke a callback function
+ * for the specified plug-in environment. The invocation record is
+ * usually allocated from the stack of the caller and it must be passed to
+ * ::cpi_end_invocation once the callback function returns.
+ * 
+ * @param env the plug-in environment
+ * @param inv the invocation record to be initialized
+ * @param cf the type of the callback function, one of the CPI_CF_* flags
+ */
+CP_HIDDEN void cpi_begin_invocation(cp_plugin_env_t *env, cpi_invocation_t *inv, int cf) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Records that a callback function invocation started by the calling
+ * thread has returned. Invocations must end in the reverse order.
+ * 
+ * @param inv the invocation record
+ */
+CP_HIDDEN void cpi_end_invocation(cpi_invocation_t *inv) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the types of the callback functions among the specified ones
+ * the calling thread is currently invoking for the specified plug-in
+ * environment. The context does not need to be locked.
+ * 
+ * @param env the plug-in environment
+ * @param funcmask the bitmask of callback functions
+ * @return the bitmask of the callback functions being invoked, zero if none
+ */
+CP_HIDDEN int cpi_in_invocation(cp_plugin_env_t *env, int funcmask) CP_GCC_NONNULL(1);
+
 /**
  * Checks that we are currently not in a specific callback function invocation.
- * Otherwise, reports a fatal error. The caller must have locked the context
- * before calling this function.
+ * Otherwise, reports a fatal error. The invocations are tracked per thread,
+ * so the context does not need to be locked.
  * 
  * @param ctx the associated plug-in context
  * @param funcmask the bitmask of disallowed callback functions
@@ -486,9 +1106,88 @@ CP_HIDDEN void cpi_free_context(cp_context_t *context) CP_GCC_NONNULL(1);
  */
 CP_HIDDEN void cpi_destroy_all_contexts(void);
 
-
-// Delivering plug-in events 
-
+/**
+ * Returns whether some contexts have been destroyed in fast exit mode and
+ * their resources, including the runtime libraries, are still in use.
+ * 
+ * @return whether there are abandoned contexts
+ */
+CP_HIDDEN int cpi_has_exited_contexts(void);
+
+
+// Memory accounting
+
+/**
+ * Adds the memory used by the client program contexts of the specified
+ * plug-in environment, and by the environment itself, to the memory
+ * statistics.
+ * 
+ * @param env the plug-in environment
+ * @param stats the memory statistics
+ */
+CP_HIDDEN void cpi_client_memory(cp_plugin_env_t *env, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Adds the memory used by a plug-in description, including the parsed
+ * configuration trees, to the memory statistics.
+ * 
+ * @param plugin the plug-in description
+ * @param stats the memory statistics
+ */
+CP_HIDDEN void cpi_descriptor_memory(const cp_plugin_info_t *plugin, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Adds the memory used by a configuration element and its descendants to
+ * the configuration counters of the memory statistics.
+ * 
+ * @param ce the configuration element
+ * @param stats the memory statistics
+ */
+CP_HIDDEN void cpi_cfg_memory(const cp_cfg_element_t *ce, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Adds the memory used by the symbols defined by the plug-in of a context
+ * and by the symbols resolved by the context to the memory statistics.
+ * The caller must hold the context lock.
+ * 
+ * @param context the plug-in context
+ * @param stats the memory statistics
+ */
+CP_HIDDEN void cpi_symbol_memory(cp_context_t *context, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Adds the memory used by the plug-in listeners registered by a plug-in
+ * to the memory statistics. The caller must hold the context lock.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the registering plug-in or NULL for the client program
+ * @param stats the memory statistics
+ */
+CP_HIDDEN void cpi_listener_memory(cp_plugin_env_t *env, cp_plugin_t *plugin, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Adds the memory used by the loggers registered by a plug-in to the
+ * memory statistics. The caller must hold the context lock.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the registering plug-in or NULL for the client program
+ * @param stats the memory statistics
+ */
+CP_HIDDEN void cpi_logger_memory(cp_plugin_env_t *env, cp_plugin_t *plugin, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Adds the memory used by the run functions registered by a plug-in to the
+ * memory statistics. The caller must hold the context lock.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the registering plug-in
+ * @param stats the memory statistics
+ */
+CP_HIDDEN void cpi_run_func_memory(cp_plugin_env_t *env, cp_plugin_t *plugin, cp_memory_stats_t *stats) CP_GCC_NONNULL(1, 2, 3);
+
+
+// Delivering plug-in events 
+
 /**
  * Delivers a plug-in event to registered event listeners.
  * 
@@ -497,6 +1196,46 @@ CP_HIDDEN void cpi_destroy_all_contexts(void);
  */
 CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t *event) CP_GCC_NONNULL(1, 2);
 
+#ifdef CP_THREADS
+
+/**
+ * Delivers the queued plug-in events to batch plug-in listeners and stops
+ * the batch listener dispatcher, if running. Later events are delivered
+ * synchronously.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_stop_event_dispatcher(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Starts the batch listener dispatcher again after it has been stopped
+ * using ::cpi_stop_event_dispatcher, if batch listeners are registered.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_resume_event_dispatcher(cp_context_t *context) CP_GCC_NONNULL(1);
+
+#else
+#define cpi_stop_event_dispatcher(dummy) do {} while (0)
+#define cpi_resume_event_dispatcher(dummy) do {} while (0)
+#endif
+
+
+// String interning
+
+/**
+ * Returns the interned copy of the specified string. Equal strings
+ * interned in the same plug-in environment share a single copy which
+ * remains valid until the environment is destroyed. Interned strings can
+ * therefore be compared by pointer before comparing the contents. The
+ * caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param str the string to be interned
+ * @return the interned string or NULL if memory allocation failed
+ */
+CP_HIDDEN char *cpi_intern_string(cp_context_t *context, const char *str) CP_GCC_NONNULL(1, 2);
+
 
 // Plug-in management
 
@@ -510,6 +1249,168 @@ CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t
  */
 CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Installs a batch of plug-ins in a single pass. The whole batch is checked
+ * for conflicts before the context is modified and the installation events
+ * are delivered once all plug-ins have been registered. Unless
+ * @ref CP_IP_ATOMIC is specified, the plug-ins that do not fail are
+ * installed even if some others fail.
+ *
+ * @param context the plug-in context
+ * @param plugins the plug-in information structures
+ * @param loaders the associated plug-in loaders, or NULL for none
+ * @param n the number of plug-ins
+ * @param flags the bitmask of installation flags
+ * @param statuses array for the status codes of the individual plug-ins, or NULL
+ * @return @ref CP_OK (zero) if all plug-ins were installed or the first error code
+ */
+CP_HIDDEN cp_status_t cpi_install_plugins(cp_context_t *context, cp_plugin_info_t * const *plugins, cp_plugin_loader_t * const *loaders, unsigned int n, int flags, cp_status_t *statuses) CP_GCC_NONNULL(1);
+
+/**
+ * Releases the plug-in information returned by the scan functions of the
+ * bundled plug-in loaders. This is used as the @a release_plugins function
+ * of the loaders, whose pointer arrays are allocated using ::cpi_malloc.
+ * 
+ * @param data the loader data
+ * @param context the plug-in context
+ * @param plugins the NULL-terminated array of plug-in information
+ */
+CP_HIDDEN void cpi_release_loaded_plugins(void *data, cp_context_t *context, cp_plugin_info_t **plugins) CP_GCC_NONNULL(2, 3);
+
+/**
+ * Allocates a zero initialized plug-in loader structure for a plug-in
+ * loader bundled with the framework. The specified options are used when
+ * the loader is registered using ::cp_register_ploader.
+ * 
+ * @param options the default registration options, or NULL if none
+ * @return the loader or NULL if insufficient memory
+ */
+CP_HIDDEN cp_plugin_loader_t *cpi_create_ploader(const cpi_ploader_options_t *options);
+
+/**
+ * Releases a plug-in loader structure allocated using ::cpi_create_ploader.
+ * 
+ * @param loader the loader
+ */
+CP_HIDDEN void cpi_destroy_ploader(cp_plugin_loader_t *loader) CP_GCC_NONNULL(1);
+
+/**
+ * Copies the registered plug-in directories, the parser settings and the
+ * descriptor status recorded by the previous scans of a local plug-in
+ * loader into another local plug-in loader. Scanning of the source loader
+ * must not be in progress.
+ * 
+ * @param dst the destination loader
+ * @param src the source loader
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_HIDDEN cp_status_t cpi_lpl_copy(cp_plugin_loader_t *dst, const cp_plugin_loader_t *src) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Allocates a new zero-initialized plug-in description. The description
+ * owns a memory arena from which its contents are allocated using
+ * ::cpi_plugin_alloc and ::cpi_plugin_strdup.
+ * 
+ * @param size the total size of the contents if known in advance, or zero
+ * @return the plug-in description or NULL if memory allocation failed
+ */
+CP_HIDDEN cp_plugin_info_t *cpi_new_plugin(size_t size);
+
+/**
+ * Returns the number of bytes used by a plug-in description and its
+ * contents, excluding the unused space of its memory arena. This is the
+ * size to pass to ::cpi_new_plugin for an exact copy.
+ * 
+ * @param plugin the plug-in description
+ * @return the number of bytes in use
+ */
+CP_HIDDEN size_t cpi_plugin_size(const cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Allocates memory for the contents of a plug-in description. The memory
+ * is released when the plug-in description is freed.
+ * 
+ * @param plugin the plug-in description
+ * @param size the number of bytes to allocate
+ * @return pointer to the allocated memory or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_plugin_alloc(cp_plugin_info_t *plugin, size_t size) CP_GCC_NONNULL(1);
+
+/**
+ * Makes a copy of a string for the contents of a plug-in description.
+ * The memory is released when the plug-in description is freed.
+ * 
+ * @param plugin the plug-in description
+ * @param str the string to be copied
+ * @return the copy or NULL if memory allocation failed
+ */
+CP_HIDDEN char *cpi_plugin_strdup(cp_plugin_info_t *plugin, const char *str) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the unparsed configuration source of an extension whose
+ * configuration is parsed lazily, or NULL if the configuration has
+ * already been parsed.
+ * 
+ * @param ext the extension
+ * @return the configuration source or NULL
+ */
+CP_HIDDEN char *cpi_get_cfg_source(const cp_extension_t *ext) CP_GCC_NONNULL(1);
+
+/**
+ * Sets the unparsed configuration source of an extension. The source must
+ * have been allocated using ::cpi_plugin_alloc for the owning plug-in.
+ * 
+ * @param ext the extension
+ * @param source the configuration source or NULL to clear it
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_HIDDEN cp_status_t cpi_set_cfg_source(cp_extension_t *ext, char *source) CP_GCC_NONNULL(1);
+
+/**
+ * Parses the configuration of an extension whose configuration is parsed
+ * lazily and stores the resulting tree as the extension configuration.
+ * Does nothing if the configuration has already been parsed. The caller
+ * must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param ext the extension
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_HIDDEN cp_status_t cpi_materialize_cfg(cp_context_t *context, cp_extension_t *ext) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Unregisters the streaming configuration consumers registered by the
+ * specified plug-in, or all consumers if the plug-in is NULL.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the registering plug-in or NULL for all consumers
+ */
+CP_HIDDEN void cpi_unregister_cfg_streams(cp_plugin_env_t *env, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Releases the table of plug-in descriptors shared by the contexts of the
+ * framework. Shared information objects still in use are not freed.
+ */
+CP_HIDDEN void cpi_free_shared_descriptors(void);
+
+/**
+ * Parses the versions of a plug-in description into comparison keys. This
+ * must be called once the description is complete and before it is
+ * installed or compared with other descriptions.
+ * 
+ * @param plugin the plug-in description
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_HIDDEN cp_status_t cpi_parse_plugin_versions(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the pre-parsed versions of a plug-in description.
+ * 
+ * @param plugin the plug-in description
+ * @return the versions parsed by ::cpi_parse_plugin_versions
+ */
+CP_HIDDEN const cpi_plugin_versions_t *cpi_plugin_versions(const cp_plugin_info_t *plugin) CP_GCC_NONNULL(1) CP_GCC_PURE;
+
 /**
  * Frees any resources allocated for a plug-in description.
  * 
@@ -517,6 +1418,49 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
  */
 CP_HIDDEN void cpi_free_plugin(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
 
+/**
+ * Adds a plug-in to a plug-in set unless already included.
+ * 
+ * @param set the set being operated on
+ * @param plugin the plug-in being added
+ * @return non-zero if the operation was successful, zero if allocation failed
+ */
+CP_HIDDEN int cpi_plugin_set_add(cpi_plugin_set_t *set, cp_plugin_t *plugin) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Removes a plug-in from a plug-in set, if it is included. The order of
+ * the remaining plug-ins is preserved.
+ * 
+ * @param set the set being operated on
+ * @param plugin the plug-in being removed
+ * @return whether the plug-in was included in the set
+ */
+CP_HIDDEN int cpi_plugin_set_remove(cpi_plugin_set_t *set, const cp_plugin_t *plugin) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns whether a plug-in is included in a plug-in set.
+ * 
+ * @param set the set being operated on
+ * @param plugin the plug-in
+ * @return non-zero if the plug-in is included, zero otherwise
+ */
+CP_HIDDEN int cpi_plugin_set_contains(const cpi_plugin_set_t *set, const cp_plugin_t *plugin) CP_GCC_NONNULL(1, 2) CP_GCC_PURE;
+
+/**
+ * Frees the memory allocated for a plug-in set and makes it empty.
+ * 
+ * @param set the set being operated on
+ */
+CP_HIDDEN void cpi_plugin_set_clear(cpi_plugin_set_t *set) CP_GCC_NONNULL(1);
+
+/**
+ * Frees the dependency graph index of a plug-in environment. All plug-ins
+ * must have been uninstalled.
+ * 
+ * @param env the plug-in environment
+ */
+CP_HIDDEN void cpi_free_dependents(cp_plugin_env_t *env) CP_GCC_NONNULL(1);
+
 /**
  * Starts the specified plug-in and its dependencies.
  * 
@@ -526,11 +1470,226 @@ CP_HIDDEN void cpi_free_plugin(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
  */
 CP_HIDDEN cp_status_t cpi_start_plugin(cp_context_t *context, cp_plugin_t *plugin) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Stops the specified plug-ins and the active plug-ins importing them,
+ * directly or indirectly, using several threads. Other active plug-ins
+ * keep running. The plug-ins that were active are added to the specified
+ * set in the order they were started.
+ *
+ * @param context the plug-in context
+ * @param plugins the plug-ins
+ * @param n the number of plug-ins
+ * @param num_threads the total number of threads, including the calling thread
+ * @param stopped the set receiving the stopped plug-ins
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if the set could not be completed
+ */
+CP_HIDDEN cp_status_t cpi_stop_affected_plugins(cp_context_t *context, cp_plugin_t * const *plugins, int n, int num_threads, cpi_plugin_set_t *stopped) CP_GCC_NONNULL(1, 5);
+
+#ifdef CP_THREADS
+
+/**
+ * Completes the queued asynchronous plug-in start and stop requests and
+ * stops the asynchronous plug-in control worker, if running.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_stop_async_control(cp_context_t *context) CP_GCC_NONNULL(1);
+
+#else
+#define cpi_stop_async_control(dummy) do {} while (0)
+#endif
+
+
+// Plug-in descriptor cache
+
+/**
+ * Returns a copy of the cached plug-in information for the specified
+ * plug-in path if the cache is in use and the cached information matches
+ * the specified descriptor file status. The plug-in path of the returned
+ * information is not set and the information is not registered. The caller
+ * must have locked the plug-in context.
+ * 
+ * @param context the plug-in context
+ * @param path the plug-in path
+ * @param st the status of the plug-in descriptor file
+ * @return the plug-in information, or NULL if not cached
+ */
+CP_HIDDEN cp_plugin_info_t *cpi_get_cached_descriptor(cp_context_t *context, const char *path, const struct stat *st) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Stores the specified plug-in information into the descriptor cache if
+ * the cache is in use. The caller must have locked the plug-in context.
+ * 
+ * @param context the plug-in context
+ * @param path the plug-in path
+ * @param st the status of the plug-in descriptor file
+ * @param plugin the plug-in information
+ */
+CP_HIDDEN void cpi_put_cached_descriptor(cp_context_t *context, const char *path, const struct stat *st, const cp_plugin_info_t *plugin) CP_GCC_NONNULL(1, 2, 3, 4);
+
+/**
+ * Writes the descriptor cache to its file if the cache is in use and it
+ * has changed. Failures are only logged. The caller must have locked the
+ * plug-in context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_save_descriptor_cache(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Frees the specified descriptor cache without saving it.
+ * 
+ * @param cache the descriptor cache
+ */
+CP_HIDDEN void cpi_free_descriptor_cache(cpi_descriptor_cache_t *cache) CP_GCC_NONNULL(1);
+
+/**
+ * Returns a compact copy of the specified plug-in information, allocated
+ * from a single memory block of the exact size with identifiers interned.
+ * Configuration trees can be replaced by their markup, to be parsed again
+ * on demand by ::cpi_materialize_cfg. The copy is registered as a
+ * reference counted information object with a usage count of one. The
+ * caller must have locked the plug-in context.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @param drop_cfg whether to replace configuration trees by their markup
+ * @return the copy or NULL if insufficient memory
+ */
+CP_HIDDEN cp_plugin_info_t *cpi_compact_plugin(cp_context_t *context, const cp_plugin_info_t *plugin, int drop_cfg) CP_GCC_NONNULL(1, 2);
+
+
+// Runtime library prefetch
+
+/**
+ * Returns the path of the runtime library of the specified plug-in. The
+ * plug-in must have a runtime library. The caller is responsible for
+ * freeing the returned path.
+ * 
+ * @param plugin the plug-in information
+ * @return the runtime library path or NULL if insufficient memory
+ */
+CP_HIDDEN char *cpi_runtime_lib_path(const cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Cancels a runtime library prefetch in progress, if any, and waits for
+ * it to terminate. The caller must not have locked the plug-in context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_stop_prefetch(cp_context_t *context) CP_GCC_NONNULL(1);
+
+
+// Lifecycle timings
+
+/**
+ * Starts timing a lifecycle phase if lifecycle timings are being recorded.
+ * The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param timing the phase timing, a cp_timing_t lvalue
+ */
+#define cpi_timing_begin(ctx, timing) do { if ((ctx)->env->timings_enabled) { (timing).begin = cpi_monotonic_time(); (timing).end = 0; } } while (0)
+
+/**
+ * Finishes timing a lifecycle phase started by ::cpi_timing_begin and adds
+ * its duration to the specified summary total. The caller must have locked
+ * the context.
+ * 
+ * @param ctx the plug-in context
+ * @param timing the phase timing, a cp_timing_t lvalue
+ * @param total the summary total, or NULL if the phase is not summarized
+ */
+#define cpi_timing_end(ctx, timing, total) do { if ((ctx)->env->timings_enabled && (timing).begin != 0) cpi_record_timing((ctx), &(timing), (total)); } while (0)
+
+/**
+ * Records the end of a lifecycle phase and updates the timings summary.
+ * Use ::cpi_timing_end instead of calling this function directly.
+ * 
+ * @param context the plug-in context
+ * @param timing the phase timing
+ * @param total the summary total, or NULL if the phase is not summarized
+ */
+CP_HIDDEN void cpi_record_timing(cp_context_t *context, cp_timing_t *timing, unsigned long long *total) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the descriptor parsing timing of the specified plug-in.
+ * 
+ * @param plugin the plug-in information
+ * @return pointer to the parsing timing stored with the plug-in information
+ */
+CP_HIDDEN cp_timing_t *cpi_parse_timing(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
+
+
+// Tracing
+
+/**
+ * Fires a USDT static probe of provider cpluff, if the framework was
+ * built with probe support.
+ * 
+ * @param probe the probe name, the lower case event name
+ * @param ctx the plug-in context
+ * @param pid the plug-in identifier or NULL
+ * @param name the event specific name or NULL
+ * @param status the status code
+ * @param duration the duration in nanoseconds
+ */
+#ifdef HAVE_SYS_SDT_H
+#define CPI_PROBE(probe, ctx, pid, name, status, duration) STAP_PROBE5(cpluff, probe, (ctx), (pid), (name), (status), (duration))
+#else
+#define CPI_PROBE(probe, ctx, pid, name, status, duration) do {} while (0)
+#endif
+
+/**
+ * Reports a framework event to the USDT probe and to the trace hook, if
+ * one has been set. The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param probe the probe name, the lower case event name
+ * @param event the event, a cp_trace_event_t constant
+ * @param pid the plug-in identifier or NULL
+ * @param name the event specific name or NULL
+ * @param status the status code
+ */
+#define cpi_trace(ctx, probe, event, pid, name, status) do { CPI_PROBE(probe, (ctx), (pid), (name), (status), 0ULL); if ((ctx)->env->trace_hook != NULL) cpi_call_trace_hook((ctx), (event), (pid), (name), (status), 0); } while (0)
+
+/**
+ * Calls the trace hook. Use ::cpi_trace instead of calling this function
+ * directly.
+ * 
+ * @param context the plug-in context
+ * @param event the event
+ * @param plugin_id the plug-in identifier or NULL
+ * @param name the event specific name or NULL
+ * @param status the status code
+ * @param duration the duration in nanoseconds
+ */
+CP_HIDDEN void cpi_call_trace_hook(cp_context_t *context, cp_trace_event_t event, const char *plugin_id, const char *name, cp_status_t status, unsigned long long duration) CP_GCC_NONNULL(1);
+
 
 // Dynamic resource management
 
 /**
- * Registers a new reference counted information object.
+ * Allocates memory for a reference counted information object preceded by
+ * its header. The object must be registered using ::cpi_register_info and
+ * it must be freed using ::cpi_free_info.
+ * 
+ * @param size the size of the object
+ * @return the object or NULL if insufficient memory
+ */
+CP_HIDDEN void *cpi_alloc_info(size_t size);
+
+/**
+ * Frees memory allocated using ::cpi_alloc_info.
+ * 
+ * @param res the object
+ */
+CP_HIDDEN void cpi_free_info(void *res) CP_GCC_NONNULL(1);
+
+/**
+ * Registers a new reference counted information object. The object must
+ * be preceded by a header, either by allocating it using ::cpi_alloc_info
+ * or by embedding the header into the enclosing structure.
  * Initializes the reference count to 1. The object is released and
  * deallocated using the specified deallocation function @a df when its
  * reference count becomes zero. Reference count is incresed by
@@ -544,6 +1703,29 @@ CP_HIDDEN cp_status_t cpi_start_plugin(cp_context_t *context, cp_plugin_t *plugi
  */
 CP_HIDDEN cp_status_t cpi_register_info(cp_context_t *ctx, void *res, cpi_dealloc_func_t df) CP_GCC_NONNULL(1, 2, 3);
 
+/**
+ * Registers a new reference counted information object that may be used
+ * by several plug-in contexts. Works like ::cpi_register_info except that
+ * the object is tracked by the framework instead of a context and its
+ * reference count is changed under the framework lock. The deallocation
+ * function is called with the framework locked.
+ * 
+ * @param ctx the registering plug-in context
+ * @param res the resource
+ * @param df the deallocation function
+ * @return CP_OK (0) on success, CP_ERR_RESOURCE if insufficient resources
+ */
+CP_HIDDEN cp_status_t cpi_register_shared_info(cp_context_t *ctx, void *res, cpi_dealloc_func_t df) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Returns whether the specified information object has been registered
+ * using ::cpi_register_shared_info.
+ * 
+ * @param res the resource
+ * @return whether the object is shared by contexts
+ */
+CP_HIDDEN int cpi_is_shared_info(void *res) CP_GCC_NONNULL(1);
+
 /**
  * Increases the reference count for the specified information object.
  * The caller must have locked the plug-in context.
@@ -570,9 +1752,198 @@ CP_HIDDEN void cpi_release_info(cp_context_t *ctx, void *res) CP_GCC_NONNULL(1,
  */
 CP_HIDDEN void cpi_release_infos(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Advances the registry generation. This must be called whenever plug-ins,
+ * extension points or extensions are registered or unregistered. The
+ * caller must have locked the plug-in context.
+ * 
+ * @param ctx the plug-in context
+ */
+CP_HIDDEN void cpi_registry_changed(cp_context_t *ctx) CP_GCC_NONNULL(1);
+
+/**
+ * Associates a newly registered plug-in with an existing handle for the
+ * same plug-in identifier, if any, and publishes the plug-in state to it.
+ * The caller must have locked the plug-in context.
+ * 
+ * @param ctx the plug-in context
+ * @param plugin the registered plug-in
+ */
+CP_HIDDEN void cpi_attach_plugin_handle(cp_context_t *ctx, cp_plugin_t *plugin) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Publishes the state of a plug-in to the plug-in handle, if any. Must be
+ * called whenever the state of a registered plug-in changes. The caller
+ * must have locked the plug-in context.
+ * 
+ * @param plugin the plug-in
+ */
+CP_HIDDEN void cpi_publish_plugin_state(cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Drops the extension snapshot of the specified extension point, if any,
+ * advances the registry generation and records it as the generation of
+ * the extension point. This must be called whenever the extension point
+ * or its extensions change. The caller must have locked the plug-in
+ * context.
+ * 
+ * @param ctx the plug-in context
+ * @param extpt_id the extension point identifier
+ */
+CP_HIDDEN void cpi_invalidate_extensions_snapshot(cp_context_t *ctx, const char *extpt_id) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Frees all extension snapshots of the specified plug-in environment.
+ * 
+ * @param env the plug-in environment
+ */
+CP_HIDDEN void cpi_free_extensions_snapshots(cp_plugin_env_t *env) CP_GCC_NONNULL(1);
+
+/**
+ * Adds the specified extension to the extension indexes of its extension
+ * point. This must be called when an extension is registered. The caller
+ * must have locked the plug-in context.
+ * 
+ * @param ctx the plug-in context
+ * @param ext the registered extension
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if out of resources
+ */
+CP_HIDDEN cp_status_t cpi_index_extension(cp_context_t *ctx, cp_extension_t *ext) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Removes the specified extension from the extension indexes, if it has
+ * been indexed. This must be called when an extension is unregistered.
+ * The caller must have locked the plug-in context.
+ * 
+ * @param ctx the plug-in context
+ * @param ext the extension being unregistered
+ */
+CP_HIDDEN void cpi_unindex_extension(cp_context_t *ctx, cp_extension_t *ext) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns whether an extension index is maintained for the extension point
+ * of the specified extension. The caller must have locked the plug-in
+ * context.
+ * 
+ * @param ctx the plug-in context
+ * @param ext the extension
+ * @return non-zero if the extension point is indexed, otherwise zero
+ */
+CP_HIDDEN int cpi_is_extension_indexed(cp_context_t *ctx, const cp_extension_t *ext) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Destroys all extension indexes of the specified plug-in environment.
+ * 
+ * @param env the plug-in environment
+ */
+CP_HIDDEN void cpi_destroy_extension_indexes(cp_plugin_env_t *env) CP_GCC_NONNULL(1);
+
+/**
+ * Validates the configuration of the specified extension against the
+ * configuration schema of its extension point, if any, and builds its
+ * configuration record. This must be called when an extension is
+ * registered. The caller must have locked the plug-in context.
+ * 
+ * @param ctx the plug-in context
+ * @param ext the registered extension
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_MALFORMED if the configuration does not match the schema or @ref CP_ERR_RESOURCE if out of resources
+ */
+CP_HIDDEN cp_status_t cpi_bind_extension_cfg(cp_context_t *ctx, cp_extension_t *ext) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Frees the configuration record of the specified extension, if any. This
+ * must be called when an extension is unregistered. The caller must have
+ * locked the plug-in context.
+ * 
+ * @param ctx the plug-in context
+ * @param ext the extension being unregistered
+ */
+CP_HIDDEN void cpi_unbind_extension_cfg(cp_context_t *ctx, cp_extension_t *ext) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns whether a configuration schema is registered for the extension
+ * point of the specified extension. The caller must have locked the
+ * plug-in context.
+ * 
+ * @param ctx the plug-in context
+ * @param ext the extension
+ * @return non-zero if the extension point has a schema, otherwise zero
+ */
+CP_HIDDEN int cpi_is_extension_bound(cp_context_t *ctx, const cp_extension_t *ext) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Unregisters the configuration schemas registered by the specified
+ * plug-in, or all schemas if the plug-in is NULL, and frees their
+ * configuration records.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the registering plug-in or NULL for all schemas
+ */
+CP_HIDDEN void cpi_unregister_cfg_schemas(cp_plugin_env_t *env, cp_plugin_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Frees the lookup indexes built for the specified configuration element
+ * tree. This must be called before the tree itself is released.
+ * 
+ * @param ce the root of the configuration element tree
+ */
+CP_HIDDEN void cpi_free_cfg_indexes(cp_cfg_element_t *ce) CP_GCC_NONNULL(1);
+
+
+// Symbol cache
+
+#ifdef CP_SYMBOL_CACHE
+
+/**
+ * Invalidates the cached symbols of all contexts in the plug-in
+ * environment. This is called before a plug-in is stopped so that symbols
+ * of stopped plug-ins are not returned from the cache. The caller must
+ * have locked the context.
+ * 
+ * @param context the plug-in context
+ */
+#define cpi_invalidate_symbol_caches(context) ((void) cpi_atomic_inc(&(context)->env->symbol_generation))
+
+/**
+ * Drops all cached symbols of the specified context, converting the
+ * references handed out from the cache into ordinary references so that
+ * they can be released normally. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_clear_symbol_cache(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Frees the symbol cache of the specified context, if any. There must be
+ * no concurrent access to the context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_free_symbol_cache(cp_context_t *context) CP_GCC_NONNULL(1);
+
+#endif
+
 
 // Serialized execution
 
+/**
+ * Compares two run function holders by the run function and the
+ * registering plug-in.
+ * 
+ * @param rf1 the first run function holder
+ * @param rf2 the second run function holder
+ * @return zero if the holders refer to the same registration
+ */
+CP_HIDDEN int cpi_comp_run_func(const void *rf1, const void *rf2) CP_GCC_PURE;
+
+/**
+ * Returns a hash value for a run function holder.
+ * 
+ * @param rf the run function holder
+ * @return the hash value
+ */
+CP_HIDDEN hash_val_t cpi_hashfunc_run_func(const void *rf) CP_GCC_PURE;
+
 /**
  * Waits for all the run functions registered by the specified plug-in to
  * return and then unregisters them. The caller must have locked the
@@ -40,16 +40,45 @@
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Buffer size for the activating plug-in of an asynchronously logged message
+#define CP_LOG_RING_APID_SIZE 128
+
+/// Buffer size for an asynchronously logged message
+#define CP_LOG_RING_MSG_SIZE 256
+
+/// Time in nanoseconds to sleep between attempts to put into a full ring
+#define CP_LOG_RING_RETRY_NS 100000
+
+/// Time in nanoseconds between checks for the logging thread to catch up
+#define CP_LOG_RING_POLL_NS 1000000
+
+/// Maximum number of arguments in a structured log record
+#define CP_LOG_MAX_ARGS 8
+
+/// Buffer size for a single conversion specification of a format string
+#define CP_LOG_SPEC_SIZE 16
+
+/// Buffer size for a formatted log message
+#define CP_LOG_MSG_SIZE 256
+
+
 /* ------------------------------------------------------------------------
  * Data types
  * ----------------------------------------------------------------------*/
 
 /// Contains information about installed loggers
-typedef struct logger_t {
+struct cpi_logger_t {
 	
-	/// Pointer to logger
+	/// Pointer to logger or NULL for a structured logger
 	cp_logger_func_t logger;
 	
+	/// Pointer to structured logger or NULL for an ordinary logger
+	cp_structured_logger_func_t slogger;
+	
 	/// Pointer to registering plug-in or NULL for the main program
 	cp_plugin_t *plugin;
 	
@@ -61,7 +90,109 @@ typedef struct logger_t {
 	
 	/// Selected environment or NULL
 	cp_plugin_env_t *env_selection;
-} logger_t;
+};
+
+/// A message being logged, formatted as text on demand
+typedef struct log_message_t {
+	
+	/// The log record passed to structured loggers
+	cp_log_record_t record;
+	
+	/// Whether the format string of the record is a constant string
+	int constant_format;
+	
+	/// The arguments of the record
+	cp_log_arg_t args[CP_LOG_MAX_ARGS];
+	
+	/// The message text or NULL if not formatted yet
+	const char *text;
+	
+	/// Buffer for the formatted message text
+	char buffer[CP_LOG_MSG_SIZE];
+	
+} log_message_t;
+
+#ifdef CP_SHARED_LOGGING
+
+/// An immutable copy of the registered loggers
+struct cpi_logger_snapshot_t {
+	
+	/// The number of concurrent logger invocations using the snapshot
+	int usage_count;
+	
+	/// The number of loggers
+	int num_loggers;
+	
+	/// The loggers, stored after the snapshot structure
+	cpi_logger_t *loggers;
+	
+};
+
+/// A message slot of the asynchronous logging ring
+typedef struct log_slot_t {
+	
+	/// Sequence number telling whether the slot is free or holds a message
+	unsigned int sequence;
+	
+	/// The severity of the message
+	cp_log_severity_t severity;
+	
+	/// The constant format string of the message or NULL if not available
+	const char *format;
+	
+	/// Whether the message has an activating plug-in
+	int has_apid;
+	
+	/// The identifier of the activating plug-in, possibly truncated
+	char apid[CP_LOG_RING_APID_SIZE];
+	
+	/// The message, possibly truncated
+	char msg[CP_LOG_RING_MSG_SIZE];
+	
+} log_slot_t;
+
+/**
+ * A bounded ring of log messages with lock-free producers and a single
+ * consumer thread passing the messages to the loggers. Each slot has a
+ * sequence number which equals the position of the next message to be
+ * put into the slot while it is free and the position plus one once a
+ * message has been put into it.
+ */
+struct cpi_log_ring_t {
+	
+	/// The plug-in environment
+	cp_plugin_env_t *env;
+	
+	/// The asynchronous logging flags
+	int flags;
+	
+	/// The number of slots minus one, the number of slots being a power of two
+	unsigned int mask;
+	
+	/// The position of the next message to be put
+	unsigned int enqueue_pos;
+	
+	/// The position of the next message to be taken, updated by the consumer only
+	unsigned int dequeue_pos;
+	
+	/// Mutex used by the consumer to wait for messages, never held while waiting for the context lock
+	cpi_mutex_t *mutex;
+	
+	/// Whether the consumer is waiting for messages
+	int sleeping;
+	
+	/// Whether the consumer should exit once the ring is empty
+	int shutdown;
+	
+	/// The consumer thread
+	cpi_thread_t *thread;
+	
+	/// The message slots
+	log_slot_t *slots;
+	
+};
+
+#endif
 
 
 /* ------------------------------------------------------------------------
@@ -73,52 +204,188 @@ typedef struct logger_t {
  * context.
  */
 static void update_logging_limits(cp_context_t *context) {
-	lnode_t *node;
 	int nms = CP_LOG_NONE;
+	int i;
 	
-	node = list_first(context->env->loggers);
-	while (node != NULL) {
-		logger_t *lh = lnode_get(node);
-		if (lh->min_severity < nms) {
-			nms = lh->min_severity;
+	for (i = 0; i < context->env->num_loggers; i++) {
+		if (context->env->loggers[i].min_severity < nms) {
+			nms = context->env->loggers[i].min_severity;
 		}
-		node = list_next(context->env->loggers, node);
 	}
 	context->env->log_min_severity = nms;
 }
 
-static int comp_logger(const void *p1, const void *p2) {
-	const logger_t *l1 = p1;
-	const logger_t *l2 = p2;
-	return l1->logger != l2->logger;
+#ifdef CP_SHARED_LOGGING
+
+/**
+ * Creates a snapshot of the registered loggers. The caller must have
+ * locked the context.
+ * 
+ * @param context the plug-in context
+ * @return the snapshot or NULL if out of memory
+ */
+static cpi_logger_snapshot_t *create_logger_snapshot(cp_context_t *context) {
+	cpi_logger_snapshot_t *snapshot;
+	int n = context->env->num_loggers;
+	
+	if ((snapshot = cpi_malloc(sizeof(cpi_logger_snapshot_t) + n * sizeof(cpi_logger_t))) == NULL) {
+		return NULL;
+	}
+	snapshot->usage_count = 0;
+	snapshot->num_loggers = n;
+	snapshot->loggers = (cpi_logger_t *) (snapshot + 1);
+	if (n > 0) {
+		memcpy(snapshot->loggers, context->env->loggers, n * sizeof(cpi_logger_t));
+	}
+	return snapshot;
 }
 
-CP_C_API cp_status_t cp_register_logger(cp_context_t *context, cp_logger_func_t logger, void *user_data, cp_log_severity_t min_severity) {
-	logger_t l;
-	logger_t *lh = NULL;
-	lnode_t *node = NULL;
+/**
+ * Releases a logger snapshot used by a concurrent logger invocation and
+ * wakes up a thread waiting for the snapshot to be released.
+ * 
+ * @param context the plug-in context
+ * @param snapshot the snapshot
+ */
+static void release_logger_snapshot(cp_context_t *context, cpi_logger_snapshot_t *snapshot) {
+	if (cpi_atomic_dec(&snapshot->usage_count) == 0
+		&& cpi_atomic_load(&context->env->num_snapshot_waiters) > 0) {
+		cpi_lock_context(context);
+		cpi_signal_context(context);
+		cpi_unlock_context(context);
+	}
+}
+
+#endif
+
+CP_HIDDEN void cpi_loggers_changed(cp_context_t *context) {
+#ifdef CP_SHARED_LOGGING
+	cp_plugin_env_t *env = context->env;
+	cpi_logger_snapshot_t *snapshot;
+#endif
+	
+	assert(cpi_is_context_locked(context));
+	update_logging_limits(context);
+#ifdef CP_SHARED_LOGGING
+	
+	// Let queued messages reach the loggers registered when they were logged
+	if (env->log_ring != NULL) {
+		cpi_log_ring_t *ring = env->log_ring;
+		
+		while (cpi_atomic_load(&ring->dequeue_pos) != cpi_atomic_load(&ring->enqueue_pos)) {
+			cpi_wait_context_timed(context, CP_LOG_RING_POLL_NS);
+		}
+	}
+	
+	// Publish a new snapshot, logging falls back to locking if none
+	snapshot = env->logger_snapshot;
+	cpi_atomic_store(&env->logger_snapshot, create_logger_snapshot(context));
+	
+	// Wait for concurrent invocations of the replaced loggers to return
+	if (snapshot != NULL) {
+		cpi_atomic_inc(&env->num_snapshot_waiters);
+		while (cpi_atomic_load(&snapshot->usage_count) > 0) {
+			cpi_wait_context(context);
+		}
+		cpi_atomic_dec(&env->num_snapshot_waiters);
+		
+		/*
+		 * The asynchronous logging thread does not signal the context
+		 * because it must never wait for the context lock.
+		 */
+		while (cpi_atomic_load(&env->logger_hazard) == snapshot) {
+			cpi_wait_context_timed(context, CP_LOG_RING_POLL_NS);
+		}
+		cpi_free(snapshot);
+	}
+#endif
+}
+
+CP_HIDDEN const int *cpi_log_threshold(cp_plugin_env_t *env, cp_plugin_t *plugin) {
+	hnode_t *node;
+	
+	if (plugin != NULL
+		&& (node = hash_lookup(env->log_thresholds, plugin->plugin->identifier)) != NULL) {
+		return hnode_get(node);
+	}
+	return &env->log_default_threshold;
+}
+
+CP_HIDDEN void cpi_free_log_thresholds(cp_plugin_env_t *env) {
+	hscan_t scan;
+	hnode_t *node;
+	
+	hash_scan_begin(&scan, env->log_thresholds);
+	while ((node = hash_scan_next(&scan)) != NULL) {
+		char *id = (char *) hnode_getkey(node);
+		int *threshold = hnode_get(node);
+		
+		hash_scan_delfree(env->log_thresholds, node);
+		cpi_free(id);
+		cpi_free(threshold);
+	}
+}
+
+/**
+ * Returns the index of a registered logger.
+ * 
+ * @param env the plug-in environment
+ * @param logger the logger or NULL
+ * @param slogger the structured logger or NULL
+ * @return the index of the logger or -1 if not registered
+ */
+static int find_logger(cp_plugin_env_t *env, cp_logger_func_t logger, cp_structured_logger_func_t slogger) {
+	int i;
+	
+	for (i = 0; i < env->num_loggers; i++) {
+		if (env->loggers[i].logger == logger && env->loggers[i].slogger == slogger) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Registers an ordinary or a structured logger.
+ * 
+ * @param context the plug-in context
+ * @param logger the logger or NULL
+ * @param slogger the structured logger or NULL
+ * @param user_data the user data pointer passed to the logger
+ * @param min_severity the minimum severity of messages passed to logger
+ * @param func the name of the calling API function
+ * @return ::CP_OK (zero) on success or ::CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t register_logger(cp_context_t *context, cp_logger_func_t logger, cp_structured_logger_func_t slogger, void *user_data, cp_log_severity_t min_severity, const char *func) {
+	cp_plugin_env_t *env = context->env;
+	cpi_logger_t *lh;
 	cp_status_t status = CP_OK;
+	int i;
 
-	CHECK_NOT_NULL(context);
-	CHECK_NOT_NULL(logger);
 	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	cpi_check_invocation(context, CPI_CF_LOGGER, func);
 	do {
 	
-		// Check if logger already exists and allocate new holder if necessary
-		l.logger = logger;
-		if ((node = list_find(context->env->loggers, &l, comp_logger)) == NULL) {
-			lh = malloc(sizeof(logger_t));
-			node = lnode_create(lh);
-			if (lh == NULL || node == NULL) {
-				status = CP_ERR_RESOURCE;
-				break;
+		// Check if logger already exists and add a new holder if necessary
+		if ((i = find_logger(env, logger, slogger)) < 0) {
+			if (env->num_loggers == env->loggers_size) {
+				int size = (env->loggers_size == 0 ? 4 : env->loggers_size * 2);
+				
+				if ((lh = cpi_realloc(env->loggers, size * sizeof(cpi_logger_t))) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				env->loggers = lh;
+				env->loggers_size = size;
 			}
+			i = env->num_loggers++;
+			lh = env->loggers + i;
+			memset(lh, 0, sizeof(cpi_logger_t));
 			lh->logger = logger;
+			lh->slogger = slogger;
 			lh->plugin = context->plugin;
-			list_append(context->env->loggers, node);
 		} else {
-			lh = lnode_get(node);
+			lh = env->loggers + i;
 		}
 		
 		// Initialize or update the logger holder
@@ -126,7 +393,7 @@ CP_C_API cp_status_t cp_register_logger(cp_context_t *context, cp_logger_func_t
 		lh->min_severity = min_severity;
 		
 		// Update global limits
-		update_logging_limits(context);
+		cpi_loggers_changed(context);
 		
 	} while (0);
 
@@ -140,35 +407,40 @@ CP_C_API cp_status_t cp_register_logger(cp_context_t *context, cp_logger_func_t
 	}
 	cpi_unlock_context(context);
 
-	// Release resources on error
-	if (status != CP_OK) {
-		if (node != NULL) {
-			lnode_destroy(node);
-		}
-		if (lh != NULL) {
-			free(lh);
-		}
-	}
-
 	return status;
 }
 
-CP_C_API void cp_unregister_logger(cp_context_t *context, cp_logger_func_t logger) {
-	logger_t l;
-	lnode_t *node;
-	
+CP_C_API cp_status_t cp_register_logger(cp_context_t *context, cp_logger_func_t logger, void *user_data, cp_log_severity_t min_severity) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(logger);
+	return register_logger(context, logger, NULL, user_data, min_severity, __func__);
+}
+
+CP_C_API cp_status_t cp_register_structured_logger(cp_context_t *context, cp_structured_logger_func_t logger, void *user_data, cp_log_severity_t min_severity) {
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(logger);
+	return register_logger(context, NULL, logger, user_data, min_severity, __func__);
+}
+
+/**
+ * Unregisters an ordinary or a structured logger.
+ * 
+ * @param context the plug-in context
+ * @param logger the logger or NULL
+ * @param slogger the structured logger or NULL
+ * @param func the name of the calling API function
+ */
+static void unregister_logger(cp_context_t *context, cp_logger_func_t logger, cp_structured_logger_func_t slogger, const char *func) {
+	cp_plugin_env_t *env = context->env;
+	int i;
+	
 	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	cpi_check_invocation(context, CPI_CF_LOGGER, func);
 	
-	l.logger = logger;
-	if ((node = list_find(context->env->loggers, &l, comp_logger)) != NULL) {
-		logger_t *lh = lnode_get(node);
-		list_delete(context->env->loggers, node);
-		lnode_destroy(node);
-		free(lh);
-		update_logging_limits(context);
+	if ((i = find_logger(env, logger, slogger)) >= 0) {
+		env->num_loggers--;
+		memmove(env->loggers + i, env->loggers + i + 1, (env->num_loggers - i) * sizeof(cpi_logger_t));
+		cpi_loggers_changed(context);
 	}
 	if (cpi_is_logged(context, CP_LOG_DEBUG)) {
 		char owner[64];
@@ -178,38 +450,585 @@ CP_C_API void cp_unregister_logger(cp_context_t *context, cp_logger_func_t logge
 	cpi_unlock_context(context);
 }
 
-static void do_log(cp_context_t *context, cp_log_severity_t severity, const char *msg) {
-	lnode_t *node;
-	const char *apid = NULL;
+CP_C_API void cp_unregister_logger(cp_context_t *context, cp_logger_func_t logger) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(logger);
+	unregister_logger(context, logger, NULL, __func__);
+}
+
+CP_C_API void cp_unregister_structured_logger(cp_context_t *context, cp_structured_logger_func_t logger) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(logger);
+	unregister_logger(context, NULL, logger, __func__);
+}
+
+/**
+ * Returns the identifier of the activating plug-in of a context.
+ * 
+ * @param context the plug-in context
+ * @return the plug-in identifier or NULL for the main program
+ */
+static const char *activating_plugin(cp_context_t *context) {
+	if (context->plugin != NULL) {
+		return context->plugin->plugin->identifier;
+	}
+	return NULL;
+}
+
+/**
+ * Parses a conversion specification of a log message format string.
+ * 
+ * @param spec pointer to the percent sign starting the specification
+ * @param type filled with the argument type or -1 if no argument is consumed
+ * @param length filled with the length modifier or '\0' if none
+ * @return pointer to the character following the specification or NULL if not supported
+ */
+static const char *parse_conversion(const char *spec, int *type, char *length) {
+	const char *p = spec + 1;
+	
+	*length = '\0';
+	if (*p == '%') {
+		*type = -1;
+		return p + 1;
+	}
+	p += strspn(p, "-+ #0");
+	p += strspn(p, "0123456789");
+	if (*p == '.') {
+		p++;
+		p += strspn(p, "0123456789");
+	}
+	if (*p == 'l' || *p == 'z') {
+		*length = *p++;
+	}
+	switch (*p) {
+		case 'd':
+		case 'i':
+			if (*length == 'z') {
+				return NULL;
+			}
+			*type = CP_LOG_ARG_INT;
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			*type = CP_LOG_ARG_UINT;
+			break;
+		case 'c':
+		case 's':
+		case 'p':
+			if (*length != '\0') {
+				return NULL;
+			}
+			*type = (*p == 'c' ? CP_LOG_ARG_INT : (*p == 's' ? CP_LOG_ARG_STRING : CP_LOG_ARG_POINTER));
+			break;
+		default:
+			return NULL;
+	}
+	p++;
+	if (p - spec >= CP_LOG_SPEC_SIZE) {
+		return NULL;
+	}
+	return p;
+}
+
+/**
+ * Collects the arguments of a log message without formatting it.
+ * 
+ * @param format the format string
+ * @param va the arguments
+ * @param args filled with the arguments
+ * @return the number of arguments or -1 if the format string is not supported
+ */
+static int collect_log_args(const char *format, va_list va, cp_log_arg_t *args) {
+	const char *p = format;
+	int n = 0;
+	
+	while ((p = strchr(p, '%')) != NULL) {
+		int type;
+		char length;
+		
+		if ((p = parse_conversion(p, &type, &length)) == NULL) {
+			return -1;
+		}
+		if (type < 0) {
+			continue;
+		}
+		if (n >= CP_LOG_MAX_ARGS) {
+			return -1;
+		}
+		args[n].type = type;
+		switch (type) {
+			case CP_LOG_ARG_INT:
+				args[n].value.i = (length == 'l' ? va_arg(va, long) : va_arg(va, int));
+				break;
+			case CP_LOG_ARG_UINT:
+				if (length == 'l') {
+					args[n].value.u = va_arg(va, unsigned long);
+				} else if (length == 'z') {
+					args[n].value.u = va_arg(va, size_t);
+				} else {
+					args[n].value.u = va_arg(va, unsigned int);
+				}
+				break;
+			case CP_LOG_ARG_STRING:
+				args[n].value.s = va_arg(va, const char *);
+				break;
+			default:
+				args[n].value.p = va_arg(va, const void *);
+				break;
+		}
+		n++;
+	}
+	return n;
+}
+
+CP_C_API int cp_render_log_record(const cp_log_record_t *record, char *buffer, int size) {
+	const char *p;
+	int len = 0;
+	int i = 0;
+	
+	CHECK_NOT_NULL(record);
+	if (size > 0) {
+		CHECK_NOT_NULL(buffer);
+	}
+	p = record->localized_format;
+	while (*p != '\0') {
+		const char *end = NULL;
+		int type = -1;
+		char length;
+		
+		// Copy text and unmatched conversions as is
+		if (record->num_args > 0 && *p == '%') {
+			end = parse_conversion(p, &type, &length);
+		}
+		if (end == NULL
+			|| (type >= 0 && (i >= record->num_args || record->args[i].type != (cp_log_arg_type_t) type))) {
+			if (len < size - 1) {
+				buffer[len] = *p;
+			}
+			len++;
+			p++;
+			continue;
+		}
+		
+		// Format a matching conversion
+		if (type < 0) {
+			if (len < size - 1) {
+				buffer[len] = '%';
+			}
+			len++;
+		} else {
+			const cp_log_arg_t *arg = record->args + i++;
+			char spec[CP_LOG_SPEC_SIZE];
+			char *out = (len < size ? buffer + len : NULL);
+			size_t avail = (len < size ? size - len : 0);
+			int n;
+			
+			memcpy(spec, p, end - p);
+			spec[end - p] = '\0';
+			switch (type) {
+				case CP_LOG_ARG_INT:
+					n = (length == 'l' ? snprintf(out, avail, spec, arg->value.i) : snprintf(out, avail, spec, (int) arg->value.i));
+					break;
+				case CP_LOG_ARG_UINT:
+					if (length == 'l') {
+						n = snprintf(out, avail, spec, arg->value.u);
+					} else if (length == 'z') {
+						n = snprintf(out, avail, spec, (size_t) arg->value.u);
+					} else {
+						n = snprintf(out, avail, spec, (unsigned int) arg->value.u);
+					}
+					break;
+				case CP_LOG_ARG_STRING:
+					n = snprintf(out, avail, spec, arg->value.s != NULL ? arg->value.s : "(null)");
+					break;
+				default:
+					n = snprintf(out, avail, spec, arg->value.p);
+					break;
+			}
+			if (n > 0) {
+				len += n;
+			}
+		}
+		p = end;
+	}
+	if (size > 0) {
+		buffer[len < size ? len : size - 1] = '\0';
+	}
+	return len;
+}
+
+/**
+ * Initializes a message whose text is known.
+ * 
+ * @param m the message
+ * @param severity the severity of the message
+ * @param format the message or its format string before localization
+ * @param text the message text
+ * @param constant_format whether the format string is a constant string
+ */
+static void init_literal_message(log_message_t *m, cp_log_severity_t severity, const char *format, const char *text, int constant_format) {
+	m->record.severity = severity;
+	m->record.format = format;
+	m->record.localized_format = text;
+	m->record.apid = NULL;
+	m->record.num_args = 0;
+	m->record.args = m->args;
+	m->constant_format = constant_format;
+	m->text = text;
+}
+
+/**
+ * Makes the formatted text of a message end with an ellipsis if it had to
+ * be truncated.
+ * 
+ * @param m the message
+ * @param len the length of the complete text
+ */
+static void mark_truncated(log_message_t *m, int len) {
+	if (len < 0 || len >= (int) sizeof(m->buffer)) {
+		strcpy(m->buffer + sizeof(m->buffer) - 4, "...");
+	}
+}
+
+/**
+ * Initializes a message from a constant format string and its arguments.
+ * The message text is formatted only on demand unless the format string
+ * is not supported for structured log records.
+ * 
+ * @param m the message
+ * @param severity the severity of the message
+ * @param format the format string before localization
+ * @param va the arguments
+ */
+static void init_formatted_message(log_message_t *m, cp_log_severity_t severity, const char *format, va_list va) {
+	va_list args;
+	int n;
+	
+	init_literal_message(m, severity, format, _(format), 1);
+	va_copy(args, va);
+	n = collect_log_args(format, args, m->args);
+	va_end(args);
+	if (n > 0) {
+		m->record.num_args = n;
+		m->text = NULL;
+	} else if (n < 0 || strchr(format, '%') != NULL) {
+		mark_truncated(m, vsnprintf(m->buffer, sizeof(m->buffer), m->record.localized_format, va));
+		m->record.localized_format = m->text = m->buffer;
+	}
+}
+
+/**
+ * Returns the text of a message, formatting it if necessary.
+ * 
+ * @param m the message
+ * @return the message text
+ */
+static const char *message_text(log_message_t *m) {
+	if (m->text == NULL) {
+		mark_truncated(m, cp_render_log_record(&m->record, m->buffer, sizeof(m->buffer)));
+		m->text = m->buffer;
+	}
+	return m->text;
+}
+
+/**
+ * Passes a message to a logger.
+ * 
+ * @param lh the logger holder
+ * @param m the message
+ */
+static void invoke_logger(const cpi_logger_t *lh, log_message_t *m) {
+	if (lh->slogger != NULL) {
+		lh->slogger(&m->record, lh->user_data);
+	} else {
+		lh->logger(m->record.severity, message_text(m), m->record.apid, lh->user_data);
+	}
+}
+
+#ifdef CP_SHARED_LOGGING
+
+/**
+ * Copies a string into a buffer, truncating it with an ellipsis if
+ * necessary.
+ * 
+ * @param buffer the buffer
+ * @param size the buffer size, at least four characters
+ * @param str the string
+ */
+static void copy_truncated(char *buffer, size_t size, const char *str) {
+	size_t len = strlen(str);
+	
+	if (len < size) {
+		memcpy(buffer, str, len + 1);
+	} else {
+		memcpy(buffer, str, size - 4);
+		strcpy(buffer + size - 4, "...");
+	}
+}
+
+/**
+ * Puts a message into the asynchronous logging ring. Drops the message or
+ * waits for space if the ring is full, as selected by the ring flags. The
+ * caller must hold the context lock in either mode so that the ring is not
+ * destroyed meanwhile.
+ * 
+ * @param ring the logging ring
+ * @param m the message
+ * @return whether the consumer must be woken up using ::wake_log_ring
+ */
+static int ring_put(cpi_log_ring_t *ring, log_message_t *m) {
+	unsigned int pos = cpi_atomic_load(&ring->enqueue_pos);
+	log_slot_t *slot;
+	
+	// Reserve a free slot
+	for (;;) {
+		int diff;
+		
+		slot = ring->slots + (pos & ring->mask);
+		diff = (int) (cpi_atomic_load(&slot->sequence) - pos);
+		if (diff == 0) {
+			if (cpi_atomic_cas(&ring->enqueue_pos, &pos, pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+			if (!(ring->flags & CP_AL_BLOCK)) {
+				cpi_atomic_inc(&ring->env->log_dropped);
+				return 0;
+			}
+			cpi_sleep(CP_LOG_RING_RETRY_NS);
+			pos = cpi_atomic_load(&ring->enqueue_pos);
+		} else {
+			pos = cpi_atomic_load(&ring->enqueue_pos);
+		}
+	}
+	
+	// Fill in and publish the message
+	slot->severity = m->record.severity;
+	slot->format = (m->constant_format ? m->record.format : NULL);
+	slot->has_apid = (m->record.apid != NULL);
+	if (m->record.apid != NULL) {
+		copy_truncated(slot->apid, sizeof(slot->apid), m->record.apid);
+	}
+	copy_truncated(slot->msg, sizeof(slot->msg), message_text(m));
+	cpi_atomic_store(&slot->sequence, pos + 1);
+	return cpi_atomic_load(&ring->sleeping);
+}
+
+/**
+ * Wakes up the consumer of the asynchronous logging ring.
+ * 
+ * @param ring the logging ring
+ */
+static void wake_log_ring(cpi_log_ring_t *ring) {
+	cpi_lock_mutex(ring->mutex);
+	cpi_signal_mutex(ring->mutex);
+	cpi_unlock_mutex(ring->mutex);
+}
+
+/**
+ * Returns the next message in the asynchronous logging ring. Only called
+ * by the consumer thread.
+ * 
+ * @param ring the logging ring
+ * @return the slot holding the next message or NULL if the ring is empty
+ */
+static log_slot_t *ring_peek(cpi_log_ring_t *ring) {
+	log_slot_t *slot = ring->slots + (ring->dequeue_pos & ring->mask);
+	
+	if (cpi_atomic_load(&slot->sequence) != ring->dequeue_pos + 1) {
+		return NULL;
+	}
+	return slot;
+}
+
+/**
+ * Frees the slot of the message returned by ::ring_peek for reuse. Only
+ * called by the consumer thread.
+ * 
+ * @param ring the logging ring
+ * @param slot the slot
+ */
+static void ring_release(cpi_log_ring_t *ring, log_slot_t *slot) {
+	cpi_atomic_store(&slot->sequence, ring->dequeue_pos + ring->mask + 1);
+	cpi_atomic_store(&ring->dequeue_pos, ring->dequeue_pos + 1);
+}
+
+/**
+ * Returns the current logger snapshot, protecting it from being freed
+ * until ::unpin_logger_snapshot is called. Only called by the consumer
+ * thread of the asynchronous logging ring.
+ * 
+ * @param env the plug-in environment
+ * @return the snapshot or NULL if none
+ */
+static cpi_logger_snapshot_t *pin_logger_snapshot(cp_plugin_env_t *env) {
+	cpi_logger_snapshot_t *snapshot;
+	
+	do {
+		snapshot = cpi_atomic_load(&env->logger_snapshot);
+		cpi_atomic_store(&env->logger_hazard, snapshot);
+	} while (cpi_atomic_load(&env->logger_snapshot) != snapshot);
+	return snapshot;
+}
+
+/**
+ * Releases the logger snapshot pinned by ::pin_logger_snapshot.
+ * 
+ * @param env the plug-in environment
+ */
+static void unpin_logger_snapshot(cp_plugin_env_t *env) {
+	cpi_atomic_store(&env->logger_hazard, (cpi_logger_snapshot_t *) NULL);
+}
+
+/**
+ * Asynchronous logging consumer main function. Passes the messages to the
+ * loggers without locking the context until the ring is shut down and
+ * empty.
+ * 
+ * @param arg the logging ring
+ */
+static void log_ring_thread(void *arg) {
+	cpi_log_ring_t *ring = arg;
+	cp_plugin_env_t *env = ring->env;
+	
+	for (;;) {
+		log_slot_t *slot;
+		
+		// Deliver the available messages
+		if ((slot = ring_peek(ring)) != NULL) {
+			cpi_logger_snapshot_t *snapshot = pin_logger_snapshot(env);
+			cpi_invocation_t inv;
+			
+			cpi_begin_invocation(env, &inv, CPI_CF_LOGGER);
+			do {
+				log_message_t m;
+				int i;
+				
+				init_literal_message(&m, slot->severity, slot->format != NULL ? slot->format : slot->msg, slot->msg, 0);
+				m.record.apid = (slot->has_apid ? slot->apid : NULL);
+				for (i = 0; snapshot != NULL && i < snapshot->num_loggers; i++) {
+					const cpi_logger_t *lh = snapshot->loggers + i;
+					
+					if (slot->severity >= lh->min_severity) {
+						invoke_logger(lh, &m);
+					}
+				}
+				ring_release(ring, slot);
+			} while ((slot = ring_peek(ring)) != NULL);
+			cpi_end_invocation(&inv);
+			unpin_logger_snapshot(env);
+			continue;
+		}
+		
+		// Wait for more messages
+		cpi_lock_mutex(ring->mutex);
+		cpi_atomic_store(&ring->sleeping, 1);
+		if (ring_peek(ring) == NULL) {
+			if (ring->shutdown) {
+				cpi_unlock_mutex(ring->mutex);
+				break;
+			}
+			cpi_wait_mutex(ring->mutex);
+		}
+		cpi_atomic_store(&ring->sleeping, 0);
+		cpi_unlock_mutex(ring->mutex);
+	}
+}
+
+/**
+ * Delivers the remaining messages of a logging ring which is no longer
+ * used by producers, stops the consumer thread and frees the ring.
+ * 
+ * @param ring the logging ring
+ */
+static void destroy_log_ring(cpi_log_ring_t *ring) {
+	cpi_lock_mutex(ring->mutex);
+	ring->shutdown = 1;
+	cpi_signal_mutex(ring->mutex);
+	cpi_unlock_mutex(ring->mutex);
+	cpi_join_thread(ring->thread);
+	cpi_destroy_mutex(ring->mutex);
+	cpi_free(ring->slots);
+	cpi_free(ring);
+}
+
+CP_HIDDEN void cpi_stop_async_logging(cp_context_t *context) {
+	cpi_log_ring_t *ring;
+	
+	cpi_lock_context(context);
+	ring = context->env->log_ring;
+	context->env->log_ring = NULL;
+	cpi_unlock_context(context);
+	if (ring != NULL) {
+		destroy_log_ring(ring);
+	}
+}
+
+CP_HIDDEN void cpi_suspend_async_logging(cp_context_t *context) {
+	cpi_lock_context(context);
+	if (context->env->log_ring != NULL) {
+		context->env->fork_log_capacity = context->env->log_ring->mask + 1;
+		context->env->fork_log_flags = context->env->log_ring->flags;
+	}
+	cpi_unlock_context(context);
+	cpi_stop_async_logging(context);
+}
+
+CP_HIDDEN void cpi_resume_async_logging(cp_context_t *context) {
+	int capacity;
+	
+	cpi_lock_context(context);
+	capacity = context->env->fork_log_capacity;
+	context->env->fork_log_capacity = 0;
+	cpi_unlock_context(context);
+	if (capacity > 0) {
+		cp_set_async_logging(context, capacity, context->env->fork_log_flags);
+	}
+}
+
+#endif
+
+static void do_log(cp_context_t *context, log_message_t *m) {
+	cpi_invocation_t inv;
+	int i;
 
 	assert(cpi_is_context_locked(context));	
-	if (context->env->in_logger_invocation) {
+	if (cpi_in_invocation(context->env, CPI_CF_LOGGER)) {
 		cpi_fatalf(_("Encountered a recursive logging request within a logger invocation."));
 	}
-	if (context->plugin != NULL) {
-		apid = context->plugin->plugin->identifier;
+	m->record.apid = activating_plugin(context);
+#ifdef CP_SHARED_LOGGING
+	if (context->env->log_ring != NULL) {
+		if (ring_put(context->env->log_ring, m)) {
+			wake_log_ring(context->env->log_ring);
+		}
+		return;
 	}
-	context->env->in_logger_invocation++;
-	node = list_first(context->env->loggers);
-	while (node != NULL) {
-		logger_t *lh = lnode_get(node);
-		if (severity >= lh->min_severity) {
-			lh->logger(severity, msg, apid, lh->user_data);
+#endif
+	cpi_begin_invocation(context->env, &inv, CPI_CF_LOGGER);
+	for (i = 0; i < context->env->num_loggers; i++) {
+		const cpi_logger_t *lh = context->env->loggers + i;
+		if (m->record.severity >= lh->min_severity) {
+			invoke_logger(lh, m);
 		}
-		node = list_next(context->env->loggers, node);
 	}
-	context->env->in_logger_invocation--;
+	cpi_end_invocation(&inv);
 }
 
 CP_HIDDEN void cpi_log(cp_context_t *context, cp_log_severity_t severity, const char *msg) {
+	log_message_t m;
+	
 	assert(context != NULL);
 	assert(msg != NULL);
 	assert(severity >= CP_LOG_DEBUG && severity <= CP_LOG_ERROR);
-	do_log(context, severity, _(msg));
+	init_literal_message(&m, severity, msg, _(msg), 1);
+	do_log(context, &m);
 }
 
 CP_HIDDEN void cpi_logf(cp_context_t *context, cp_log_severity_t severity, const char *msg, ...) {
-	char buffer[256];
+	log_message_t m;
 	va_list va;
 	
 	assert(context != NULL);
@@ -217,46 +1036,269 @@ CP_HIDDEN void cpi_logf(cp_context_t *context, cp_log_severity_t severity, const
 	assert(severity >= CP_LOG_DEBUG && severity <= CP_LOG_ERROR);
 		
 	va_start(va, msg);
-	vsnprintf(buffer, sizeof(buffer), _(msg), va);
+	init_formatted_message(&m, severity, msg, va);
 	va_end(va);
-	strcpy(buffer + sizeof(buffer)/sizeof(char) - 4, "...");
-	do_log(context, severity, buffer);
+	do_log(context, &m);
 }
 
-static void process_unregister_logger(list_t *list, lnode_t *node, void *plugin) {
-	logger_t *lh = lnode_get(node);
-	if (plugin == NULL || lh->plugin == plugin) {
-		list_delete(list, node);
-		lnode_destroy(node);
-		free(lh);
+CP_HIDDEN void cpi_unregister_loggers(cp_plugin_env_t *env, cp_plugin_t *plugin) {
+	int i, j = 0;
+	
+	// Compact the remaining loggers preserving the registration order
+	for (i = 0; i < env->num_loggers; i++) {
+		if (plugin != NULL && env->loggers[i].plugin != plugin) {
+			env->loggers[j++] = env->loggers[i];
+		}
+	}
+	env->num_loggers = j;
+	if (j == 0) {
+		cpi_free(env->loggers);
+		env->loggers = NULL;
+		env->loggers_size = 0;
 	}
 }
 
-CP_HIDDEN void cpi_unregister_loggers(list_t *loggers, cp_plugin_t *plugin) {
-	list_process(loggers, plugin, process_unregister_logger);
+CP_HIDDEN void cpi_logger_memory(cp_plugin_env_t *env, cp_plugin_t *plugin, cp_memory_stats_t *stats) {
+	int i;
+	
+	for (i = 0; i < env->num_loggers; i++) {
+		if (env->loggers[i].plugin == plugin) {
+			stats->loggers++;
+			stats->logger_bytes += sizeof(cpi_logger_t);
+		}
+	}
 }
 
+#ifdef CP_SHARED_LOGGING
+
+/**
+ * Passes a message to the loggers of a snapshot without holding the
+ * context lock.
+ * 
+ * @param context the plug-in context
+ * @param snapshot the logger snapshot, being used by the caller
+ * @param m the message
+ */
+static void do_log_concurrent(cp_context_t *context, const cpi_logger_snapshot_t *snapshot, log_message_t *m) {
+	cpi_invocation_t inv;
+	int i;
+	
+	m->record.apid = activating_plugin(context);
+	cpi_begin_invocation(context->env, &inv, CPI_CF_LOGGER);
+	for (i = 0; i < snapshot->num_loggers; i++) {
+		const cpi_logger_t *lh = snapshot->loggers + i;
+		
+		if (m->record.severity >= lh->min_severity) {
+			invoke_logger(lh, m);
+		}
+	}
+	cpi_end_invocation(&inv);
+}
+
+#endif
+
 CP_C_API void cp_log(cp_context_t *context, cp_log_severity_t severity, const char *msg) {
+	log_message_t m;
+#ifdef CP_SHARED_LOGGING
+	cpi_logger_snapshot_t *snapshot = NULL;
+#endif
+	
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(msg);
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
 	if (severity < CP_LOG_DEBUG || severity > CP_LOG_ERROR) {
 		cpi_fatalf(_("Illegal severity value in call to %s."), __func__);
 	}
+	init_literal_message(&m, severity, msg, msg, 0);
+#ifdef CP_SHARED_LOGGING
+	
+	// Take a snapshot of the loggers for a concurrent invocation
+	cpi_lock_context_shared(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	if (!cpi_is_logged(context, severity)) {
+		cpi_unlock_context_shared(context);
+		return;
+	}
+	if (context->env->log_ring != NULL) {
+		m.record.apid = activating_plugin(context);
+		if (ring_put(context->env->log_ring, &m)) {
+			wake_log_ring(context->env->log_ring);
+		}
+		cpi_unlock_context_shared(context);
+		return;
+	}
+	if (context->env->concurrent_logging
+		&& (snapshot = context->env->logger_snapshot) != NULL) {
+		cpi_atomic_inc(&snapshot->usage_count);
+	}
+	cpi_unlock_context_shared(context);
+	if (snapshot != NULL) {
+		do_log_concurrent(context, snapshot, &m);
+		release_logger_snapshot(context, snapshot);
+		return;
+	}
+	
+#endif
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
 	if (cpi_is_logged(context, severity)) {
-		do_log(context, severity, msg);
+		do_log(context, &m);
+	}
+	cpi_unlock_context(context);
+}
+
+CP_C_API cp_status_t cp_set_log_threshold(cp_context_t *context, const char *plugin_id, cp_log_severity_t min_severity) {
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	if (min_severity < CP_LOG_DEBUG || min_severity > CP_LOG_ERROR + 1) {
+		cpi_fatalf(_("Illegal severity value in call to %s."), __func__);
+	}
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	if (plugin_id == NULL) {
+		context->env->log_default_threshold = min_severity;
+	} else {
+		hnode_t *node;
+		
+		if ((node = hash_lookup(context->env->log_thresholds, plugin_id)) != NULL) {
+			*((int *) hnode_get(node)) = min_severity;
+		} else {
+			char *id = NULL;
+			int *threshold = NULL;
+			
+			if ((id = cpi_strdup(plugin_id)) == NULL
+				|| (threshold = cpi_malloc(sizeof(int))) == NULL
+				|| !hash_alloc_insert(context->env->log_thresholds, id, threshold)) {
+				cpi_free(id);
+				cpi_free(threshold);
+				status = CP_ERR_RESOURCE;
+			} else {
+				cp_plugin_t *plugin;
+				
+				*threshold = min_severity;
+				
+				// Switch a running plug-in over to its own threshold
+				if ((plugin = cpi_hmap_get(context->env->plugins, plugin_id)) != NULL
+					&& plugin->context != NULL) {
+					plugin->context->log_threshold = threshold;
+				}
+			}
+		}
 	}
+	if (status != CP_OK) {
+		cpi_error(context, N_("Logging threshold could not be set due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	return status;
+}
+
+CP_C_API void cp_set_concurrent_logging(cp_context_t *context, int enabled) {
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	context->env->concurrent_logging = enabled;
 	cpi_unlock_context(context);
 }
 
+CP_C_API cp_status_t cp_set_async_logging(cp_context_t *context, int capacity, int flags) {
+#ifdef CP_SHARED_LOGGING
+	cpi_log_ring_t *ring = NULL;
+	cp_status_t status = CP_OK;
+#endif
+	
+	CHECK_NOT_NULL(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+#ifdef CP_SHARED_LOGGING
+	
+	// Flush and stop the previous ring, if any
+	cpi_stop_async_logging(context);
+	if (capacity <= 0) {
+		return CP_OK;
+	}
+	
+	do {
+		unsigned int n = 2;
+		unsigned int i;
+		
+		// Allocate a ring with a power of two slots
+		while (n < (unsigned int) capacity && n < (1U << 30)) {
+			n <<= 1;
+		}
+		if ((ring = cpi_malloc(sizeof(cpi_log_ring_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(ring, 0, sizeof(cpi_log_ring_t));
+		ring->env = context->env;
+		ring->flags = flags;
+		ring->mask = n - 1;
+		if ((ring->slots = cpi_malloc(n * sizeof(log_slot_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			ring->slots[i].sequence = i;
+		}
+		if ((ring->mutex = cpi_create_mutex()) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Start the consumer and publish the ring
+		if ((ring->thread = cpi_create_thread(log_ring_thread, ring)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		cpi_lock_context(context);
+		if (context->env->log_ring == NULL) {
+			context->env->log_ring = ring;
+			ring = NULL;
+		}
+		cpi_unlock_context(context);
+		
+		// Another thread enabled asynchronous logging meanwhile
+		if (ring != NULL) {
+			destroy_log_ring(ring);
+			ring = NULL;
+		}
+		
+	} while (0);
+	
+	// Report error and release resources on failure
+	if (status != CP_OK) {
+		cpi_lock_context(context);
+		cpi_error(context, N_("Asynchronous logging could not be enabled due to insufficient system resources."));
+		cpi_unlock_context(context);
+		if (ring != NULL) {
+			if (ring->mutex != NULL) {
+				cpi_destroy_mutex(ring->mutex);
+			}
+			cpi_free(ring->slots);
+			cpi_free(ring);
+		}
+	}
+	return status;
+#else
+	return CP_OK;
+#endif
+}
+
+CP_C_API unsigned long cp_get_dropped_log_messages(cp_context_t *context) {
+	CHECK_NOT_NULL(context);
+#ifdef CP_SHARED_LOGGING
+	return cpi_atomic_load(&context->env->log_dropped);
+#else
+	return 0;
+#endif
+}
+
 CP_C_API int cp_is_logged(cp_context_t *context, cp_log_severity_t severity) {
 	int is_logged;
 	
 	CHECK_NOT_NULL(context);
-	cpi_lock_context(context);
+	cpi_lock_context_shared(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
 	is_logged = cpi_is_logged(context, severity);
-	cpi_unlock_context(context);
+	cpi_unlock_context_shared(context);
 	return is_logged;
 }
@@ -0,0 +1,2031 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/** @file
+ * Persistent plug-in descriptor cache, registry snapshots and plug-in archives
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && defined(HAVE_MUNMAP)
+#define CP_USE_MMAP
+#include <sys/mman.h>
+#endif
+#include "cpluff.h"
+#include "defines.h"
+#include "util.h"
+#include "internal.h"
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Cache file magic
+#define CP_DCACHE_MAGIC "CPDC"
+
+/// Cache file format version
+#define CP_DCACHE_VERSION 3
+
+/// Initial serialization buffer size
+#define CP_DCACHE_BUFFER_INITSIZE 1024
+
+/// Snapshot file magic
+#define CP_SNAPSHOT_MAGIC "CPRS"
+
+/// Snapshot file format version
+#define CP_SNAPSHOT_VERSION 3
+
+/// Archive file magic
+#define CP_ARCHIVE_MAGIC "CPPA"
+
+/// Archive file format version
+#define CP_ARCHIVE_VERSION 2
+
+/// Size of the archive header
+#define CP_ARCHIVE_HEADER_SIZE 12
+
+/// Size of an archive index entry
+#define CP_ARCHIVE_ENTRY_SIZE 32
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// A cached plug-in descriptor
+typedef struct dcache_entry_t {
+
+	/// The plug-in path
+	char *path;
+	
+	/// Modification time of the descriptor file
+	unsigned long long mtime;
+	
+	/// Size of the descriptor file
+	unsigned long long size;
+	
+	/// The serialized plug-in information
+	unsigned char *data;
+	
+	/// The length of the serialized plug-in information
+	size_t data_len;
+	
+	/// Whether this entry was used since the cache was loaded
+	int used;
+	
+} dcache_entry_t;
+
+// Descriptor cache
+struct cpi_descriptor_cache_t {
+
+	/// The cache file path
+	char *path;
+	
+	/// Maps plug-in paths to cache entries
+	hash_t *entries;
+	
+	/// Whether the cache has been changed since it was loaded or saved
+	int dirty;
+	
+};
+
+/// Serialization buffer
+typedef struct dcache_writer_t {
+
+	/// The buffer
+	unsigned char *data;
+	
+	/// The current data length
+	size_t len;
+	
+	/// The allocated buffer size
+	size_t size;
+	
+	/// Whether a memory allocation has failed
+	int error;
+	
+	/// Whether configuration trees are written as markup
+	int cfg_markup;
+
+} dcache_writer_t;
+
+/// Deserialization state
+typedef struct dcache_reader_t {
+
+	/// The data being read
+	const unsigned char *data;
+	
+	/// The data length
+	size_t len;
+	
+	/// The current read position
+	size_t pos;
+	
+	/// Whether the data was found to be invalid or memory allocation failed
+	int error;
+	
+	/// The plug-in being read, providing memory for the data, or NULL
+	cp_plugin_info_t *plugin;
+	
+	/// The plug-in context used for interning strings, or NULL
+	cp_context_t *context;
+	
+	/// The total size of the plug-in contents if known, or zero
+	size_t size;
+	
+	/// Whether recorded configuration sources are left unparsed
+	int keep_sources;
+
+} dcache_reader_t;
+
+/// File contents mapped or read into memory
+typedef struct file_contents_t {
+
+	/// The contents
+	const unsigned char *data;
+	
+	/// The length of the contents
+	size_t len;
+	
+	/// The buffer holding the contents if read into memory, or NULL
+	unsigned char *buffer;
+	
+#ifdef CP_USE_MMAP
+
+	/// The mapping holding the contents if mapped, or NULL
+	void *map;
+
+#endif
+
+} file_contents_t;
+
+/// Snapshot plug-in loader data
+typedef struct snapshot_data_t {
+
+	/// The snapshot file path
+	char *path;
+
+} snapshot_data_t;
+
+/// A runtime library stored in a plug-in archive
+typedef struct archive_library_t {
+
+	/// The identifier of the plug-in
+	char *plugin_id;
+	
+	/// The version of the plug-in, or NULL if none
+	char *version;
+	
+	/// The offset of the library in the archive
+	size_t offset;
+	
+	/// The size of the library
+	size_t size;
+	
+	/// Whether the library has been extracted by this loader
+	int extracted;
+
+} archive_library_t;
+
+/// Archive plug-in loader data
+typedef struct archive_data_t {
+
+	/// The archive file path
+	char *path;
+	
+	/// The directory the runtime libraries are extracted to
+	char *extract_dir;
+	
+	/// The archive contents as of the last scan
+	file_contents_t contents;
+	
+	/// Maps plug-in identifiers to the runtime libraries of the last scan
+	hash_t *libraries;
+
+#ifdef CP_THREADS
+
+	/// Mutex protecting the contents and the libraries
+	cpi_mutex_t *mutex;
+
+#endif
+
+} archive_data_t;
+
+
+/* ------------------------------------------------------------------------
+ * Variables
+ * ----------------------------------------------------------------------*/
+
+/// Registration options of snapshot and archive plug-in loaders
+static const cpi_ploader_options_t loader_options = { CP_PLR_THREAD_SAFE, NULL };
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+// Serialization
+
+static void write_bytes(dcache_writer_t *w, const void *src, size_t len) {
+	if (w->error) {
+		return;
+	}
+	if (w->len + len > w->size) {
+		unsigned char *nd;
+		size_t ns;
+		
+		ns = (w->size == 0 ? CP_DCACHE_BUFFER_INITSIZE : w->size);
+		while (w->len + len > ns) {
+			ns *= 2;
+		}
+		if ((nd = cpi_realloc(w->data, ns)) == NULL) {
+			w->error = 1;
+			return;
+		}
+		w->data = nd;
+		w->size = ns;
+	}
+	memcpy(w->data + w->len, src, len);
+	w->len += len;
+}
+
+static void write_u32(dcache_writer_t *w, unsigned long v) {
+	unsigned char b[4];
+	
+	b[0] = v & 0xff;
+	b[1] = (v >> 8) & 0xff;
+	b[2] = (v >> 16) & 0xff;
+	b[3] = (v >> 24) & 0xff;
+	write_bytes(w, b, 4);
+}
+
+static void write_u64(dcache_writer_t *w, unsigned long long v) {
+	write_u32(w, (unsigned long) (v & 0xffffffffUL));
+	write_u32(w, (unsigned long) (v >> 32));
+}
+
+/**
+ * Writes a string. Strings are stored as their length plus one followed
+ * by the characters so that zero length denotes a NULL string.
+ */
+static void write_str(dcache_writer_t *w, const char *str) {
+	if (str == NULL) {
+		write_u32(w, 0);
+	} else {
+		size_t len = strlen(str);
+		
+		write_u32(w, len + 1);
+		write_bytes(w, str, len);
+	}
+}
+
+static void write_cfg_element(dcache_writer_t *w, const cp_cfg_element_t *ce) {
+	unsigned int i;
+	
+	write_str(w, ce->name);
+	write_u32(w, ce->num_atts);
+	for (i = 0; i < ce->num_atts * 2; i++) {
+		write_str(w, ce->atts[i]);
+	}
+	write_str(w, ce->value);
+	write_u32(w, ce->index);
+	write_u32(w, ce->num_children);
+	for (i = 0; i < ce->num_children; i++) {
+		write_cfg_element(w, ce->children + i);
+	}
+}
+
+/**
+ * Writes character data as markup, escaping the characters significant
+ * in element content or, with their whitespace, in attribute values.
+ */
+static void write_markup_text(dcache_writer_t *w, const char *str, int attribute) {
+	const char *run = str;
+	
+	for (; *str != '\0'; str++) {
+		const char *esc;
+		
+		switch (*str) {
+			case '&':
+				esc = "&amp;";
+				break;
+			case '<':
+				esc = "&lt;";
+				break;
+			case '>':
+				esc = "&gt;";
+				break;
+			case '\r':
+				esc = "&#13;";
+				break;
+			case '"':
+				esc = (attribute ? "&quot;" : NULL);
+				break;
+			case '\t':
+				esc = (attribute ? "&#9;" : NULL);
+				break;
+			case '\n':
+				esc = (attribute ? "&#10;" : NULL);
+				break;
+			default:
+				esc = NULL;
+				break;
+		}
+		if (esc != NULL) {
+			write_bytes(w, run, str - run);
+			write_bytes(w, esc, strlen(esc));
+			run = str + 1;
+		}
+	}
+	write_bytes(w, run, str - run);
+}
+
+/**
+ * Writes a configuration element and its children as markup which the
+ * descriptor parser turns back into an equal element tree.
+ */
+static void write_cfg_markup(dcache_writer_t *w, const cp_cfg_element_t *ce) {
+	unsigned int i;
+	
+	write_bytes(w, "<", 1);
+	write_bytes(w, ce->name, strlen(ce->name));
+	for (i = 0; i < ce->num_atts * 2; i += 2) {
+		write_bytes(w, " ", 1);
+		write_bytes(w, ce->atts[i], strlen(ce->atts[i]));
+		write_bytes(w, "=\"", 2);
+		write_markup_text(w, ce->atts[i + 1], 1);
+		write_bytes(w, "\"", 1);
+	}
+	if (ce->value == NULL && ce->num_children == 0) {
+		write_bytes(w, "/>", 2);
+		return;
+	}
+	write_bytes(w, ">", 1);
+	if (ce->value != NULL) {
+		write_markup_text(w, ce->value, 0);
+	}
+	for (i = 0; i < ce->num_children; i++) {
+		write_cfg_markup(w, ce->children + i);
+	}
+	write_bytes(w, "</", 2);
+	write_bytes(w, ce->name, strlen(ce->name));
+	write_bytes(w, ">", 1);
+}
+
+static void write_plugin(dcache_writer_t *w, const cp_plugin_info_t *plugin) {
+	unsigned int i;
+	
+	write_str(w, plugin->identifier);
+	write_str(w, plugin->name);
+	write_str(w, plugin->version);
+	write_str(w, plugin->provider_name);
+	write_str(w, plugin->abi_bw_compatibility);
+	write_str(w, plugin->api_bw_compatibility);
+	write_str(w, plugin->req_cpluff_version);
+	write_str(w, plugin->runtime_lib_name);
+	write_str(w, plugin->runtime_funcs_symbol);
+	write_str(w, plugin->runtime_symbols_symbol);
+	write_u32(w, plugin->lazy_activation);
+	write_u32(w, plugin->num_imports);
+	for (i = 0; i < plugin->num_imports; i++) {
+		write_str(w, plugin->imports[i].plugin_id);
+		write_str(w, plugin->imports[i].version);
+		write_u32(w, plugin->imports[i].optional);
+	}
+	write_u32(w, plugin->num_ext_points);
+	for (i = 0; i < plugin->num_ext_points; i++) {
+		write_str(w, plugin->ext_points[i].local_id);
+		write_str(w, plugin->ext_points[i].identifier);
+		write_str(w, plugin->ext_points[i].name);
+		write_str(w, plugin->ext_points[i].schema_path);
+	}
+	write_u32(w, plugin->num_extensions);
+	for (i = 0; i < plugin->num_extensions; i++) {
+		write_str(w, plugin->extensions[i].ext_point_id);
+		write_str(w, plugin->extensions[i].local_id);
+		write_str(w, plugin->extensions[i].identifier);
+		write_str(w, plugin->extensions[i].name);
+		if (plugin->extensions[i].configuration != NULL && w->cfg_markup) {
+			dcache_writer_t m;
+			
+			// Configuration tree replaced by its markup
+			memset(&m, 0, sizeof(dcache_writer_t));
+			write_cfg_markup(&m, plugin->extensions[i].configuration);
+			write_bytes(&m, "", 1);
+			if (m.error) {
+				w->error = 1;
+			} else {
+				write_u32(w, 2);
+				write_str(w, (char *) m.data);
+			}
+			cpi_free(m.data);
+		} else if (plugin->extensions[i].configuration != NULL) {
+			write_u32(w, 1);
+			write_cfg_element(w, plugin->extensions[i].configuration);
+		} else if (cpi_get_cfg_source(plugin->extensions + i) != NULL) {
+			
+			// Configuration source recorded in lazy mode
+			write_u32(w, 2);
+			write_str(w, cpi_get_cfg_source(plugin->extensions + i));
+		} else {
+			write_u32(w, 0);
+		}
+	}
+}
+
+
+// Deserialization
+
+static const unsigned char *read_bytes(dcache_reader_t *r, size_t len) {
+	const unsigned char *p;
+	
+	if (r->error || len > r->len - r->pos) {
+		r->error = 1;
+		return NULL;
+	}
+	p = r->data + r->pos;
+	r->pos += len;
+	return p;
+}
+
+static unsigned long read_u32(dcache_reader_t *r) {
+	const unsigned char *b;
+	
+	if ((b = read_bytes(r, 4)) == NULL) {
+		return 0;
+	}
+	return (unsigned long) b[0]
+		| ((unsigned long) b[1] << 8)
+		| ((unsigned long) b[2] << 16)
+		| ((unsigned long) b[3] << 24);
+}
+
+static unsigned long long read_u64(dcache_reader_t *r) {
+	unsigned long long low = read_u32(r);
+	
+	return low | ((unsigned long long) read_u32(r) << 32);
+}
+
+/**
+ * Reads an element count and checks that it is plausible given the
+ * remaining data so that corrupted data does not cause huge allocations.
+ */
+static unsigned int read_count(dcache_reader_t *r) {
+	unsigned long n = read_u32(r);
+	
+	if (n > r->len - r->pos) {
+		r->error = 1;
+		return 0;
+	}
+	return n;
+}
+
+static char *read_str(dcache_reader_t *r) {
+	unsigned long n;
+	const unsigned char *p;
+	char *str;
+	
+	if ((n = read_u32(r)) == 0) {
+		return NULL;
+	}
+	if ((p = read_bytes(r, n - 1)) == NULL) {
+		return NULL;
+	}
+	if (r->plugin != NULL) {
+		str = cpi_plugin_alloc(r->plugin, n * sizeof(char));
+	} else {
+		str = cpi_malloc(n * sizeof(char));
+	}
+	if (str == NULL) {
+		r->error = 1;
+		return NULL;
+	}
+	memcpy(str, p, n - 1);
+	str[n - 1] = '\0';
+	return str;
+}
+
+/**
+ * Reads a string and returns its interned copy, or a plain copy if there
+ * is no context to intern the string in.
+ */
+static char *read_istr(dcache_reader_t *r) {
+	unsigned long n;
+	const unsigned char *p;
+	char buffer[128];
+	char *str, *istr;
+	
+	if (r->context == NULL) {
+		return read_str(r);
+	}
+	if ((n = read_u32(r)) == 0) {
+		return NULL;
+	}
+	if ((p = read_bytes(r, n - 1)) == NULL) {
+		return NULL;
+	}
+	if (n <= sizeof(buffer)) {
+		str = buffer;
+	} else if ((str = cpi_malloc(n * sizeof(char))) == NULL) {
+		r->error = 1;
+		return NULL;
+	}
+	memcpy(str, p, n - 1);
+	str[n - 1] = '\0';
+	if ((istr = cpi_intern_string(r->context, str)) == NULL) {
+		r->error = 1;
+	}
+	if (str != buffer) {
+		cpi_free(str);
+	}
+	return istr;
+}
+
+/**
+ * Checks whether the next string matches the specified string.
+ */
+static int read_str_matches(dcache_reader_t *r, const char *str) {
+	unsigned long n;
+	const unsigned char *p;
+	
+	n = read_u32(r);
+	if (r->error || n == 0 || n - 1 != strlen(str)) {
+		return 0;
+	}
+	if ((p = read_bytes(r, n - 1)) == NULL) {
+		return 0;
+	}
+	return !memcmp(p, str, n - 1);
+}
+
+/**
+ * Allocates a zero-initialized array for the contents of the plug-in
+ * being read.
+ */
+static void *read_array(dcache_reader_t *r, unsigned int num, size_t size) {
+	void *array;
+	
+	assert(r->plugin != NULL);
+	if (r->error || num == 0) {
+		return NULL;
+	}
+	if ((array = cpi_plugin_alloc(r->plugin, num * size)) == NULL) {
+		r->error = 1;
+		return NULL;
+	}
+	memset(array, 0, num * size);
+	return array;
+}
+
+/**
+ * Reads attributes into the layout used by the descriptor parser, a
+ * single block of character data referenced by the attribute array.
+ */
+static char **read_atts(dcache_reader_t *r, unsigned int num) {
+	char **atts;
+	char *attr_data;
+	size_t attr_size = 0;
+	size_t offset;
+	size_t pos;
+	unsigned int i;
+	
+	// Calculate the amount of space required
+	pos = r->pos;
+	for (i = 0; i < num * 2; i++) {
+		unsigned long n = read_u32(r);
+		
+		if (n == 0) {
+			r->error = 1;
+		}
+		read_bytes(r, n - 1);
+		attr_size += n;
+	}
+	if (r->error || (atts = read_array(r, num * 2, sizeof(char *))) == NULL) {
+		return NULL;
+	}
+	if ((attr_data = cpi_plugin_alloc(r->plugin, attr_size * sizeof(char))) == NULL) {
+		r->error = 1;
+		return NULL;
+	}
+	
+	// Copy the attribute data
+	r->pos = pos;
+	for (i = 0, offset = 0; i < num * 2; i++) {
+		unsigned long n = read_u32(r);
+		
+		memcpy(attr_data + offset, read_bytes(r, n - 1), n - 1);
+		attr_data[offset + n - 1] = '\0';
+		atts[i] = attr_data + offset;
+		offset += n;
+	}
+	return atts;
+}
+
+static void read_cfg_element(dcache_reader_t *r, cp_cfg_element_t *ce, cp_cfg_element_t *parent) {
+	unsigned int num;
+	unsigned int i;
+	
+	ce->name = read_istr(r);
+	num = read_count(r);
+	if ((ce->atts = read_atts(r, num)) != NULL) {
+		ce->num_atts = num;
+	}
+	ce->value = read_str(r);
+	ce->parent = parent;
+	ce->index = read_u32(r);
+	num = read_count(r);
+	if ((ce->children = read_array(r, num, sizeof(cp_cfg_element_t))) != NULL) {
+		ce->num_children = num;
+	}
+	for (i = 0; i < ce->num_children && !r->error; i++) {
+		read_cfg_element(r, ce->children + i, ce);
+	}
+}
+
+static cp_plugin_info_t *read_plugin(dcache_reader_t *r) {
+	cp_plugin_info_t *plugin;
+	unsigned int num;
+	unsigned int i;
+	
+	if (r->error) {
+		return NULL;
+	}
+	if ((plugin = cpi_new_plugin(r->size)) == NULL) {
+		r->error = 1;
+		return NULL;
+	}
+	r->plugin = plugin;
+	plugin->identifier = read_istr(r);
+	plugin->name = read_str(r);
+	plugin->version = read_str(r);
+	plugin->provider_name = read_str(r);
+	plugin->abi_bw_compatibility = read_str(r);
+	plugin->api_bw_compatibility = read_str(r);
+	plugin->req_cpluff_version = read_str(r);
+	plugin->runtime_lib_name = read_str(r);
+	plugin->runtime_funcs_symbol = read_str(r);
+	plugin->runtime_symbols_symbol = read_str(r);
+	plugin->lazy_activation = read_u32(r);
+	num = read_count(r);
+	if ((plugin->imports = read_array(r, num, sizeof(cp_plugin_import_t))) != NULL) {
+		plugin->num_imports = num;
+	}
+	for (i = 0; i < plugin->num_imports; i++) {
+		plugin->imports[i].plugin_id = read_istr(r);
+		plugin->imports[i].version = read_str(r);
+		plugin->imports[i].optional = read_u32(r);
+	}
+	num = read_count(r);
+	if ((plugin->ext_points = read_array(r, num, sizeof(cp_ext_point_t))) != NULL) {
+		plugin->num_ext_points = num;
+	}
+	for (i = 0; i < plugin->num_ext_points; i++) {
+		plugin->ext_points[i].plugin = plugin;
+		plugin->ext_points[i].local_id = read_str(r);
+		plugin->ext_points[i].identifier = read_istr(r);
+		plugin->ext_points[i].name = read_str(r);
+		plugin->ext_points[i].schema_path = read_str(r);
+	}
+	num = read_count(r);
+	if ((plugin->extensions = read_array(r, num, sizeof(cp_extension_t))) != NULL) {
+		plugin->num_extensions = num;
+	}
+	for (i = 0; i < plugin->num_extensions && !r->error; i++) {
+		cp_extension_t *ext = plugin->extensions + i;
+		
+		ext->plugin = plugin;
+		ext->ext_point_id = read_istr(r);
+		ext->local_id = read_str(r);
+		ext->identifier = read_str(r);
+		ext->name = read_str(r);
+		switch (read_u32(r)) {
+			case 1:
+				if ((ext->configuration = read_array(r, 1, sizeof(cp_cfg_element_t))) != NULL) {
+					read_cfg_element(r, ext->configuration, NULL);
+				}
+				break;
+			case 2: {
+				char *source;
+				
+				if ((source = read_str(r)) != NULL
+					&& cpi_set_cfg_source(ext, source) != CP_OK) {
+					r->error = 1;
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	
+	// Pre-parse the versions for comparisons
+	if (!r->error && cpi_parse_plugin_versions(plugin) != CP_OK) {
+		r->error = 1;
+	}
+	
+	// Build the recorded configuration trees unless in lazy mode
+	if (!r->error && r->context != NULL && !r->keep_sources && !r->context->env->lazy_cfg) {
+		for (i = 0; i < plugin->num_extensions && !r->error; i++) {
+			if (cpi_materialize_cfg(r->context, plugin->extensions + i) != CP_OK) {
+				r->error = 1;
+			}
+		}
+	}
+	
+	// Release resources on failure
+	r->plugin = NULL;
+	if (r->error || plugin->identifier == NULL) {
+		cpi_free_plugin(plugin);
+		return NULL;
+	}
+	return plugin;
+}
+
+
+// File access
+
+/**
+ * Reads the whole contents of an open file into memory.
+ * 
+ * @param fh the file
+ * @param data pointer to the location where the data pointer is stored
+ * @param data_len pointer to the location where the data length is stored
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t read_file(FILE *fh, unsigned char **data, size_t *data_len) {
+	size_t size = 0;
+	
+	*data = NULL;
+	*data_len = 0;
+	while (!feof(fh) && !ferror(fh)) {
+		if (*data_len == size) {
+			unsigned char *nd;
+			
+			size = (size == 0 ? CP_DCACHE_BUFFER_INITSIZE * 16 : size * 2);
+			if ((nd = cpi_realloc(*data, size)) == NULL) {
+				return CP_ERR_RESOURCE;
+			}
+			*data = nd;
+		}
+		*data_len += fread(*data + *data_len, 1, size - *data_len, fh);
+	}
+	return ferror(fh) ? CP_ERR_IO : CP_OK;
+}
+
+/**
+ * Maps the specified file into memory or, if mapping is not possible,
+ * reads its contents into a buffer.
+ * 
+ * @param path the file path
+ * @param fc the structure receiving the contents
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t load_file_contents(const char *path, file_contents_t *fc) {
+	FILE *fh;
+	cp_status_t status = CP_OK;
+	
+	memset(fc, 0, sizeof(file_contents_t));
+	if ((fh = fopen(path, "rb")) == NULL) {
+		return CP_ERR_IO;
+	}
+#ifdef CP_USE_MMAP
+	{
+		struct stat st;
+		void *map;
+		
+		if (!fstat(fileno(fh), &st)
+			&& S_ISREG(st.st_mode)
+			&& st.st_size > 0
+			&& (map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fh), 0)) != MAP_FAILED) {
+			fc->map = map;
+			fc->data = map;
+			fc->len = st.st_size;
+		}
+	}
+#endif
+	if (fc->data == NULL) {
+		if ((status = read_file(fh, &fc->buffer, &fc->len)) == CP_OK) {
+			fc->data = fc->buffer;
+		} else {
+			cpi_free(fc->buffer);
+			fc->buffer = NULL;
+		}
+	}
+	fclose(fh);
+	return status;
+}
+
+/**
+ * Releases file contents obtained using ::load_file_contents.
+ * 
+ * @param fc the file contents
+ */
+static void release_file_contents(file_contents_t *fc) {
+#ifdef CP_USE_MMAP
+	if (fc->map != NULL) {
+		munmap(fc->map, fc->len);
+	}
+#endif
+	cpi_free(fc->buffer);
+	memset(fc, 0, sizeof(file_contents_t));
+}
+
+/**
+ * Writes serialized data into a temporary file and then replaces the
+ * specified file with it so that readers never see a partially written file.
+ * 
+ * @param path the file path
+ * @param w the serialized data
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t write_file(const char *path, const dcache_writer_t *w) {
+	char *tmp_path;
+	FILE *fh = NULL;
+	cp_status_t status = CP_ERR_IO;
+	
+	if ((tmp_path = cpi_malloc((strlen(path) + 5) * sizeof(char))) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	strcpy(tmp_path, path);
+	strcat(tmp_path, ".tmp");
+	do {
+		if ((fh = fopen(tmp_path, "wb")) == NULL) {
+			break;
+		}
+		if (fwrite(w->data, 1, w->len, fh) != w->len) {
+			break;
+		}
+		if (fclose(fh)) {
+			fh = NULL;
+			break;
+		}
+		fh = NULL;
+		if (rename(tmp_path, path)) {
+			remove(path);
+			if (rename(tmp_path, path)) {
+				break;
+			}
+		}
+		status = CP_OK;
+	} while (0);
+	
+	// Release resources
+	if (fh != NULL) {
+		fclose(fh);
+	}
+	if (status != CP_OK) {
+		remove(tmp_path);
+	}
+	cpi_free(tmp_path);
+	return status;
+}
+
+
+// Cache management
+
+static void free_entry(dcache_entry_t *entry) {
+	cpi_free(entry->path);
+	cpi_free(entry->data);
+	cpi_free(entry);
+}
+
+static void clear_entries(hash_t *entries) {
+	hscan_t scan;
+	hnode_t *node;
+	
+	hash_scan_begin(&scan, entries);
+	while ((node = hash_scan_next(&scan)) != NULL) {
+		dcache_entry_t *entry = hnode_get(node);
+		hash_scan_delfree(entries, node);
+		free_entry(entry);
+	}
+}
+
+/**
+ * Loads the cache entries from the cache file. A missing or invalid cache
+ * file results in an empty cache.
+ * 
+ * @param context the plug-in context
+ * @param cache the cache to be loaded
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t load_cache(cp_context_t *context, cpi_descriptor_cache_t *cache) {
+	unsigned char *data = NULL;
+	size_t data_len = 0;
+	FILE *fh;
+	cp_status_t status = CP_OK;
+	
+	if ((fh = fopen(cache->path, "rb")) == NULL) {
+		return CP_OK;
+	}
+	do {
+		dcache_reader_t r;
+		
+		// Read the whole file into memory
+		if ((status = read_file(fh, &data, &data_len)) == CP_ERR_IO) {
+			cpi_warnf(context, N_("Could not read plug-in descriptor cache %s."), cache->path);
+			status = CP_OK;
+			break;
+		} else if (status != CP_OK) {
+			break;
+		}
+		
+		// Check the header
+		memset(&r, 0, sizeof(dcache_reader_t));
+		r.data = data;
+		r.len = data_len;
+		if (data_len < 8 || memcmp(data, CP_DCACHE_MAGIC, 4)) {
+			cpi_warnf(context, N_("Ignoring invalid plug-in descriptor cache %s."), cache->path);
+			break;
+		}
+		r.pos = 4;
+		if (read_u32(&r) != CP_DCACHE_VERSION) {
+			break;
+		}
+		
+		// Read the entries
+		while (r.pos < r.len && !r.error) {
+			dcache_entry_t *entry;
+			const unsigned char *p;
+			
+			if ((entry = cpi_malloc(sizeof(dcache_entry_t))) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			memset(entry, 0, sizeof(dcache_entry_t));
+			entry->path = read_str(&r);
+			entry->mtime = read_u64(&r);
+			entry->size = read_u64(&r);
+			entry->data_len = read_count(&r);
+			if ((p = read_bytes(&r, entry->data_len)) != NULL
+				&& (entry->data = cpi_malloc(entry->data_len)) != NULL) {
+				memcpy(entry->data, p, entry->data_len);
+			}
+			if (r.error || entry->path == NULL || entry->data == NULL
+				|| hash_lookup(cache->entries, entry->path) != NULL) {
+				r.error = 1;
+				free_entry(entry);
+				break;
+			}
+			if (!hash_alloc_insert(cache->entries, entry->path, entry)) {
+				free_entry(entry);
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+		}
+		if (status == CP_OK && r.error) {
+			cpi_warnf(context, N_("Ignoring invalid plug-in descriptor cache %s."), cache->path);
+			clear_entries(cache->entries);
+		}
+		
+	} while (0);
+	
+	// Release resources
+	fclose(fh);
+	cpi_free(data);
+	if (status != CP_OK) {
+		clear_entries(cache->entries);
+	}
+	return status;
+}
+
+static void free_cache(cpi_descriptor_cache_t *cache) {
+	if (cache->entries != NULL) {
+		clear_entries(cache->entries);
+		hash_destroy(cache->entries);
+	}
+	cpi_free(cache->path);
+	cpi_free(cache);
+}
+
+CP_HIDDEN void cpi_save_descriptor_cache(cp_context_t *context) {
+	cpi_descriptor_cache_t *cache;
+	dcache_writer_t w;
+	hscan_t scan;
+	hnode_t *node;
+	int ok = 0;
+	
+	assert(cpi_is_context_locked(context));
+	cache = context->env->descriptor_cache;
+	if (cache == NULL) {
+		return;
+	}
+	
+	/*
+	 * Entries not used since the cache was loaded are stale once some
+	 * other entry has been used, and they are dropped when saving.
+	 */
+	if (!cache->dirty) {
+		int used = 0, unused = 0;
+		
+		hash_scan_begin(&scan, cache->entries);
+		while ((node = hash_scan_next(&scan)) != NULL) {
+			dcache_entry_t *entry = hnode_get(node);
+			
+			if (entry->used) {
+				used = 1;
+			} else {
+				unused = 1;
+			}
+		}
+		if (!used || !unused) {
+			return;
+		}
+	}
+	memset(&w, 0, sizeof(dcache_writer_t));
+	do {
+		
+		// Serialize the entries that are still in use
+		write_bytes(&w, CP_DCACHE_MAGIC, 4);
+		write_u32(&w, CP_DCACHE_VERSION);
+		hash_scan_begin(&scan, cache->entries);
+		while ((node = hash_scan_next(&scan)) != NULL) {
+			dcache_entry_t *entry = hnode_get(node);
+			
+			if (entry->used) {
+				write_str(&w, entry->path);
+				write_u64(&w, entry->mtime);
+				write_u64(&w, entry->size);
+				write_u32(&w, entry->data_len);
+				write_bytes(&w, entry->data, entry->data_len);
+			}
+		}
+		if (w.error) {
+			break;
+		}
+		
+		// Write to a temporary file and replace the cache file
+		if (write_file(cache->path, &w) != CP_OK) {
+			break;
+		}
+		ok = 1;
+		cache->dirty = 0;
+		
+		// Drop stale entries
+		hash_scan_begin(&scan, cache->entries);
+		while ((node = hash_scan_next(&scan)) != NULL) {
+			dcache_entry_t *entry = hnode_get(node);
+			
+			if (!entry->used) {
+				hash_scan_delfree(cache->entries, node);
+				free_entry(entry);
+			}
+		}
+		
+	} while (0);
+	
+	// Report failure and release resources
+	if (!ok) {
+		cpi_warnf(context, N_("Could not write plug-in descriptor cache %s."), cache->path);
+	}
+	cpi_free(w.data);
+}
+
+CP_HIDDEN void cpi_free_descriptor_cache(cpi_descriptor_cache_t *cache) {
+	assert(cache != NULL);
+	free_cache(cache);
+}
+
+CP_HIDDEN cp_plugin_info_t *cpi_get_cached_descriptor(cp_context_t *context, const char *path, const struct stat *st) {
+	dcache_entry_t *entry;
+	dcache_reader_t r;
+	hnode_t *node;
+	cp_plugin_info_t *plugin = NULL;
+	
+	assert(cpi_is_context_locked(context));
+	if (context->env->descriptor_cache == NULL
+		|| (node = hash_lookup(context->env->descriptor_cache->entries, path)) == NULL) {
+		return NULL;
+	}
+	entry = hnode_get(node);
+	if (entry->mtime != (unsigned long long) st->st_mtime
+		|| entry->size != (unsigned long long) st->st_size) {
+		return NULL;
+	}
+	
+	// Check that the descriptor settings match and read the plug-in
+	memset(&r, 0, sizeof(dcache_reader_t));
+	r.data = entry->data;
+	r.len = entry->data_len;
+	r.context = context;
+	if (read_str_matches(&r, context->env->plugin_descriptor_name)
+		&& read_str_matches(&r, context->env->plugin_descriptor_root_element)) {
+		plugin = read_plugin(&r);
+	}
+	if (plugin != NULL) {
+		entry->used = 1;
+	}
+	return plugin;
+}
+
+CP_HIDDEN void cpi_put_cached_descriptor(cp_context_t *context, const char *path, const struct stat *st, const cp_plugin_info_t *plugin) {
+	cpi_descriptor_cache_t *cache;
+	dcache_entry_t *entry = NULL;
+	dcache_writer_t w;
+	hnode_t *node;
+	
+	assert(cpi_is_context_locked(context));
+	if ((cache = context->env->descriptor_cache) == NULL) {
+		return;
+	}
+	
+	// Serialize the plug-in along with the descriptor settings
+	memset(&w, 0, sizeof(dcache_writer_t));
+	write_str(&w, context->env->plugin_descriptor_name);
+	write_str(&w, context->env->plugin_descriptor_root_element);
+	write_plugin(&w, plugin);
+	if (w.error) {
+		cpi_free(w.data);
+		return;
+	}
+	
+	// Replace an existing entry or create a new one
+	if ((node = hash_lookup(cache->entries, path)) != NULL) {
+		entry = hnode_get(node);
+		cpi_free(entry->data);
+	} else {
+		if ((entry = cpi_malloc(sizeof(dcache_entry_t))) == NULL) {
+			cpi_free(w.data);
+			return;
+		}
+		memset(entry, 0, sizeof(dcache_entry_t));
+		if ((entry->path = cpi_strdup(path)) == NULL
+			|| !hash_alloc_insert(cache->entries, entry->path, entry)) {
+			cpi_free(w.data);
+			free_entry(entry);
+			return;
+		}
+	}
+	entry->mtime = st->st_mtime;
+	entry->size = st->st_size;
+	entry->data = w.data;
+	entry->data_len = w.len;
+	entry->used = 1;
+	cache->dirty = 1;
+}
+
+CP_C_API cp_status_t cp_set_descriptor_cache(cp_context_t *context, const char *path) {
+	cpi_descriptor_cache_t *cache = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	do {
+		
+		// Save and release the current cache, if any
+		if (context->env->descriptor_cache != NULL) {
+			cpi_save_descriptor_cache(context);
+			free_cache(context->env->descriptor_cache);
+			context->env->descriptor_cache = NULL;
+		}
+		if (path == NULL) {
+			break;
+		}
+		
+		// Create and load a new cache
+		if ((cache = cpi_malloc(sizeof(cpi_descriptor_cache_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(cache, 0, sizeof(cpi_descriptor_cache_t));
+		if ((cache->path = cpi_strdup(path)) == NULL
+			|| (cache->entries = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if ((status = load_cache(context, cache)) != CP_OK) {
+			break;
+		}
+		
+		context->env->descriptor_cache = cache;
+		cpi_debugf(context, N_("Using plug-in descriptor cache %s."), path);
+		
+	} while (0);
+	
+	// Report error and release resources on failure
+	if (status != CP_OK) {
+		cpi_errorf(context, N_("Plug-in descriptor cache %s could not be loaded due to insufficient system resources."), path);
+		if (cache != NULL) {
+			free_cache(cache);
+		}
+	}
+	cpi_unlock_context(context);
+	
+	return status;
+}
+
+
+// Registry snapshots
+
+static void dealloc_snapshot_plugin(cp_context_t *context, cp_plugin_info_t *plugin) {
+	cpi_free_plugin(plugin);
+}
+
+CP_HIDDEN cp_plugin_info_t *cpi_compact_plugin(cp_context_t *context, const cp_plugin_info_t *plugin, int drop_cfg) {
+	dcache_writer_t w;
+	dcache_reader_t r;
+	cp_plugin_info_t *copy = NULL;
+	int pass;
+	
+	assert(cpi_is_context_locked(context));
+	memset(&w, 0, sizeof(dcache_writer_t));
+	w.cfg_markup = drop_cfg;
+	write_plugin(&w, plugin);
+	write_str(&w, plugin->plugin_path);
+	
+	// Read the plug-in twice, the second time into a block of the exact size
+	for (pass = 0; pass < 2 && !w.error; pass++) {
+		memset(&r, 0, sizeof(dcache_reader_t));
+		r.data = w.data;
+		r.len = w.len;
+		r.context = context;
+		r.keep_sources = 1;
+		if (copy != NULL) {
+			r.size = cpi_plugin_size(copy);
+			cpi_free_plugin(copy);
+		}
+		if ((copy = read_plugin(&r)) == NULL) {
+			break;
+		}
+		r.plugin = copy;
+		copy->plugin_path = read_str(&r);
+		r.plugin = NULL;
+		if (r.error) {
+			cpi_free_plugin(copy);
+			copy = NULL;
+			break;
+		}
+	}
+	cpi_free(w.data);
+	if (copy != NULL) {
+		*cpi_parse_timing(copy) = *cpi_parse_timing((cp_plugin_info_t *) plugin);
+		if (cpi_register_info(context, copy, (void (*)(cp_context_t *, void *)) dealloc_snapshot_plugin) != CP_OK) {
+			cpi_free_plugin(copy);
+			copy = NULL;
+		}
+	}
+	return copy;
+}
+
+CP_C_API cp_status_t cp_save_snapshot(cp_context_t *context, const char *path) {
+	dcache_writer_t w;
+	cpi_hmap_scan_t scan;
+	cp_plugin_t *rp;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(path);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	memset(&w, 0, sizeof(dcache_writer_t));
+	do {
+		
+		// Serialize the installed plug-ins followed by their plug-in paths
+		write_bytes(&w, CP_SNAPSHOT_MAGIC, 4);
+		write_u32(&w, CP_SNAPSHOT_VERSION);
+		cpi_hmap_scan_begin(&scan, context->env->plugins);
+		while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			write_plugin(&w, rp->plugin);
+			write_str(&w, rp->plugin->plugin_path);
+		}
+		if (w.error) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Write to a temporary file and replace the snapshot file
+		status = write_file(path, &w);
+		
+	} while (0);
+	
+	// Report the result
+	switch (status) {
+		case CP_OK:
+			cpi_debugf(context, N_("Saved a registry snapshot to %s."), path);
+			break;
+		case CP_ERR_RESOURCE:
+			cpi_errorf(context, N_("Registry snapshot %s could not be saved due to insufficient system resources."), path);
+			break;
+		default:
+			cpi_errorf(context, N_("Registry snapshot %s could not be written."), path);
+			break;
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources
+	cpi_free(w.data);
+	
+	return status;
+}
+
+static cp_plugin_info_t **snapshot_scan_plugins(void *d, cp_context_t *context) {
+	snapshot_data_t *data = d;
+	file_contents_t fc;
+	cp_plugin_info_t **plugins = NULL;
+	size_t num_plugins = 0;
+	size_t plugins_size = 0;
+	cp_status_t status = CP_OK;
+	
+	// Map the snapshot file or read it into memory without the context lock
+	memset(&fc, 0, sizeof(file_contents_t));
+	status = load_file_contents(data->path, &fc);
+	
+	cpi_lock_context(context);
+	do {
+		dcache_reader_t r;
+		
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Check the header
+		memset(&r, 0, sizeof(dcache_reader_t));
+		r.data = fc.data;
+		r.len = fc.len;
+		r.context = context;
+		if (fc.len < 8 || memcmp(fc.data, CP_SNAPSHOT_MAGIC, 4)) {
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		r.pos = 4;
+		if (read_u32(&r) != CP_SNAPSHOT_VERSION) {
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		
+		// Read the plug-ins
+		do {
+			cp_plugin_info_t *plugin = NULL;
+			
+			// Allocate space for the plug-in pointers and the NULL terminator
+			if (num_plugins + 1 >= plugins_size) {
+				cp_plugin_info_t **np;
+				size_t ns = (plugins_size == 0 ? 16 : plugins_size * 2);
+				
+				if ((np = cpi_realloc(plugins, ns * sizeof(cp_plugin_info_t *))) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				plugins = np;
+				plugins_size = ns;
+			}
+			plugins[num_plugins] = NULL;
+			if (r.pos >= r.len) {
+				break;
+			}
+			
+			// Read the plug-in and its path into the plug-in memory
+			if ((plugin = read_plugin(&r)) != NULL) {
+				r.plugin = plugin;
+				plugin->plugin_path = read_str(&r);
+				r.plugin = NULL;
+			}
+			if (plugin == NULL || r.error || plugin->plugin_path == NULL) {
+				if (plugin != NULL) {
+					cpi_free_plugin(plugin);
+				}
+				status = CP_ERR_MALFORMED;
+				break;
+			}
+			if ((status = cpi_register_info(context, plugin, (void (*)(cp_context_t *, void *)) dealloc_snapshot_plugin)) != CP_OK) {
+				cpi_free_plugin(plugin);
+				break;
+			}
+			plugins[num_plugins++] = plugin;
+			
+		} while (1);
+		
+	} while (0);
+	
+	// Report failure
+	switch (status) {
+		case CP_OK:
+			break;
+		case CP_ERR_IO:
+			cpi_errorf(context, N_("Registry snapshot %s could not be read."), data->path);
+			break;
+		case CP_ERR_MALFORMED:
+			cpi_errorf(context, N_("Registry snapshot %s is invalid."), data->path);
+			break;
+		default:
+			cpi_errorf(context, N_("Registry snapshot %s could not be loaded due to insufficient system resources."), data->path);
+			break;
+	}
+	
+	// Release resources
+	if (status != CP_OK && plugins != NULL) {
+		size_t i;
+		
+		for (i = 0; i < num_plugins; i++) {
+			cpi_release_info(context, plugins[i]);
+		}
+		cpi_free(plugins);
+		plugins = NULL;
+	}
+	cpi_unlock_context(context);
+	release_file_contents(&fc);
+	
+	return plugins;
+}
+
+CP_C_API cp_plugin_loader_t *cp_create_snapshot_ploader(const char *path, cp_status_t *error) {
+	cp_plugin_loader_t *loader = NULL;
+	snapshot_data_t *data;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(path);
+	do {
+	
+		// Allocate memory for the loader
+		if ((loader = cpi_create_ploader(&loader_options)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Initialize loader
+		loader->data = data = cpi_malloc(sizeof(snapshot_data_t));
+		loader->scan_plugins = snapshot_scan_plugins;
+		loader->resolve_files = NULL;
+		loader->release_plugins = cpi_release_loaded_plugins;
+		if (data == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(data, 0, sizeof(snapshot_data_t));
+		if ((data->path = cpi_strdup(path)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+	} while (0);
+	
+	// Release resources on failure
+	if (status != CP_OK) {
+		if (loader != NULL) {
+			cp_destroy_snapshot_ploader(loader);
+		}
+		loader = NULL;
+	}
+	
+	// Return the final status 
+	if (error != NULL) {
+		*error = status;
+	}
+	
+	return loader;
+}
+
+CP_C_API void cp_destroy_snapshot_ploader(cp_plugin_loader_t *loader) {
+	snapshot_data_t *data;
+	
+	CHECK_NOT_NULL(loader);
+	if ((data = loader->data) != NULL) {
+		cpi_free(data->path);
+		cpi_free(data);
+	}
+	cpi_destroy_ploader(loader);
+}
+
+
+// Plug-in archives
+
+/**
+ * Creates the specified directory unless it already exists.
+ * 
+ * @param path the directory path
+ * @return non-zero on success or zero on failure
+ */
+static int ensure_dir(const char *path) {
+#ifdef _WIN32
+	return !_mkdir(path) || errno == EEXIST;
+#else
+	return !mkdir(path, 0777) || errno == EEXIST;
+#endif
+}
+
+/**
+ * Appends the contents of a file to the serialized data.
+ * 
+ * @param w the serialized data
+ * @param path the file path
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t write_file_contents(dcache_writer_t *w, const char *path) {
+	file_contents_t fc;
+	cp_status_t status;
+	
+	if ((status = load_file_contents(path, &fc)) != CP_OK) {
+		return status;
+	}
+	write_bytes(w, fc.data, fc.len);
+	release_file_contents(&fc);
+	return w->error ? CP_ERR_RESOURCE : CP_OK;
+}
+
+CP_C_API cp_status_t cp_save_archive(cp_context_t *context, const char *path) {
+	dcache_writer_t w, dw, lw;
+	cp_plugin_t **plugins = NULL;
+	size_t *desc_offsets = NULL;
+	char *lib_path = NULL;
+	int lib_failed = 0;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(path);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	memset(&w, 0, sizeof(dcache_writer_t));
+	memset(&dw, 0, sizeof(dcache_writer_t));
+	memset(&lw, 0, sizeof(dcache_writer_t));
+	do {
+		size_t num_plugins = cpi_hmap_count(context->env->plugins);
+		size_t desc_base, lib_base, i;
+		cpi_hmap_scan_t scan;
+		cp_plugin_t *rp;
+		
+		// Serialize the descriptors of the installed plug-ins
+		if ((plugins = cpi_malloc((num_plugins + 1) * sizeof(cp_plugin_t *))) == NULL
+			|| (desc_offsets = cpi_malloc((num_plugins + 1) * sizeof(size_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		i = 0;
+		cpi_hmap_scan_begin(&scan, context->env->plugins);
+		while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			plugins[i] = rp;
+			desc_offsets[i] = dw.len;
+			write_plugin(&dw, plugins[i]->plugin);
+			i++;
+		}
+		desc_offsets[num_plugins] = dw.len;
+		
+		// Write the header and the index, collecting the runtime libraries
+		desc_base = CP_ARCHIVE_HEADER_SIZE + num_plugins * CP_ARCHIVE_ENTRY_SIZE;
+		lib_base = desc_base + dw.len;
+		write_bytes(&w, CP_ARCHIVE_MAGIC, 4);
+		write_u32(&w, CP_ARCHIVE_VERSION);
+		write_u32(&w, num_plugins);
+		for (i = 0; i < num_plugins && status == CP_OK; i++) {
+			cp_plugin_info_t *plugin = plugins[i]->plugin;
+			size_t lib_offset = lw.len;
+			
+			if (plugin->runtime_lib_name != NULL) {
+				cpi_free(lib_path);
+				if ((lib_path = cpi_runtime_lib_path(plugin)) == NULL) {
+					status = CP_ERR_RESOURCE;
+				} else if ((status = write_file_contents(&lw, lib_path)) == CP_ERR_IO) {
+					lib_failed = 1;
+				}
+			}
+			write_u64(&w, desc_base + desc_offsets[i]);
+			write_u64(&w, desc_offsets[i + 1] - desc_offsets[i]);
+			write_u64(&w, lw.len > lib_offset ? lib_base + lib_offset : 0);
+			write_u64(&w, lw.len - lib_offset);
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Write the archive to a temporary file and replace the archive
+		write_bytes(&w, dw.data, dw.len);
+		write_bytes(&w, lw.data, lw.len);
+		if (w.error || dw.error || lw.error) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		status = write_file(path, &w);
+		
+	} while (0);
+	
+	// Report the result
+	switch (status) {
+		case CP_OK:
+			cpi_debugf(context, N_("Saved a plug-in archive to %s."), path);
+			break;
+		case CP_ERR_RESOURCE:
+			cpi_errorf(context, N_("Plug-in archive %s could not be saved due to insufficient system resources."), path);
+			break;
+		default:
+			if (lib_failed) {
+				cpi_errorf(context, N_("Plug-in archive %s could not be saved because runtime library %s could not be read."), path, lib_path);
+			} else {
+				cpi_errorf(context, N_("Plug-in archive %s could not be written."), path);
+			}
+			break;
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources
+	cpi_free(plugins);
+	cpi_free(desc_offsets);
+	cpi_free(lib_path);
+	cpi_free(w.data);
+	cpi_free(dw.data);
+	cpi_free(lw.data);
+	
+	return status;
+}
+
+static void free_archive_library(archive_library_t *lib) {
+	cpi_free(lib->plugin_id);
+	cpi_free(lib->version);
+	cpi_free(lib);
+}
+
+/**
+ * Frees a map of archived runtime libraries.
+ * 
+ * @param libraries the map
+ */
+static void free_archive_libraries(hash_t *libraries) {
+	hscan_t scan;
+	hnode_t *node;
+	
+	hash_scan_begin(&scan, libraries);
+	while ((node = hash_scan_next(&scan)) != NULL) {
+		archive_library_t *lib = hnode_get(node);
+		
+		hash_scan_delfree(libraries, node);
+		free_archive_library(lib);
+	}
+	hash_destroy(libraries);
+}
+
+/**
+ * Records the location of the runtime library of an archived plug-in.
+ * 
+ * @param libraries the map of archived runtime libraries
+ * @param plugin the plug-in
+ * @param offset the offset of the library in the archive
+ * @param size the size of the library
+ * @return @ref CP_OK or @ref CP_ERR_RESOURCE
+ */
+static cp_status_t add_archive_library(hash_t *libraries, const cp_plugin_info_t *plugin, size_t offset, size_t size) {
+	archive_library_t *lib;
+	
+	if ((lib = cpi_malloc(sizeof(archive_library_t))) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	memset(lib, 0, sizeof(archive_library_t));
+	lib->offset = offset;
+	lib->size = size;
+	if ((lib->plugin_id = cpi_strdup(plugin->identifier)) == NULL
+		|| (plugin->version != NULL && (lib->version = cpi_strdup(plugin->version)) == NULL)
+		|| !hash_alloc_insert(libraries, lib->plugin_id, lib)) {
+		free_archive_library(lib);
+		return CP_ERR_RESOURCE;
+	}
+	return CP_OK;
+}
+
+/**
+ * Reads the plug-in described by the specified archive index entry and
+ * sets its plug-in path to the extraction directory of the plug-in.
+ * 
+ * @param context the plug-in context
+ * @param data the loader data
+ * @param fc the archive contents
+ * @param entry the reader positioned at the index entry
+ * @param libraries the map receiving the runtime library location
+ * @param status pointer to the location where status code is to be stored
+ * @return the plug-in or NULL on failure
+ */
+static cp_plugin_info_t *read_archive_entry(cp_context_t *context, archive_data_t *data, const file_contents_t *fc, dcache_reader_t *entry, hash_t *libraries, cp_status_t *status) {
+	unsigned long long desc_offset, desc_len, lib_offset, lib_len;
+	cp_plugin_info_t *plugin;
+	dcache_reader_t r;
+	char *path;
+	
+	desc_offset = read_u64(entry);
+	desc_len = read_u64(entry);
+	lib_offset = read_u64(entry);
+	lib_len = read_u64(entry);
+	if (entry->error
+		|| desc_offset > fc->len || desc_len > fc->len - desc_offset
+		|| lib_offset > fc->len || lib_len > fc->len - lib_offset) {
+		*status = CP_ERR_MALFORMED;
+		return NULL;
+	}
+	
+	// Read the descriptor, which must take up the whole record
+	memset(&r, 0, sizeof(dcache_reader_t));
+	r.data = fc->data;
+	r.len = desc_offset + desc_len;
+	r.pos = desc_offset;
+	r.context = context;
+	if ((plugin = read_plugin(&r)) == NULL || r.pos != r.len) {
+		if (plugin != NULL) {
+			cpi_free_plugin(plugin);
+		}
+		*status = CP_ERR_MALFORMED;
+		return NULL;
+	}
+	
+	// Runtime libraries are extracted to a directory of their own
+	if ((path = cpi_malloc(strlen(data->extract_dir) + strlen(plugin->identifier) + 2)) == NULL) {
+		cpi_free_plugin(plugin);
+		*status = CP_ERR_RESOURCE;
+		return NULL;
+	}
+	strcpy(path, data->extract_dir);
+	strcat(path, CP_FNAMESEP_STR);
+	strcat(path, plugin->identifier);
+	plugin->plugin_path = cpi_plugin_strdup(plugin, path);
+	cpi_free(path);
+	if (plugin->plugin_path == NULL
+		|| (lib_offset != 0 && (*status = add_archive_library(libraries, plugin, lib_offset, lib_len)) != CP_OK)) {
+		cpi_free_plugin(plugin);
+		*status = CP_ERR_RESOURCE;
+		return NULL;
+	}
+	return plugin;
+}
+
+static cp_plugin_info_t **archive_scan_plugins(void *d, cp_context_t *context) {
+	archive_data_t *data = d;
+	file_contents_t fc;
+	hash_t *libraries = NULL;
+	cp_plugin_info_t **plugins = NULL;
+	unsigned int num_plugins = 0;
+	cp_status_t status = CP_OK;
+	
+	// Map the archive file or read it into memory without the context lock
+	memset(&fc, 0, sizeof(file_contents_t));
+	status = load_file_contents(data->path, &fc);
+	
+	cpi_lock_context(context);
+	do {
+		dcache_reader_t r;
+		unsigned int count;
+		
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Check the header
+		memset(&r, 0, sizeof(dcache_reader_t));
+		r.data = fc.data;
+		r.len = fc.len;
+		if (fc.len < CP_ARCHIVE_HEADER_SIZE || memcmp(fc.data, CP_ARCHIVE_MAGIC, 4)) {
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		r.pos = 4;
+		if (read_u32(&r) != CP_ARCHIVE_VERSION
+			|| (count = read_u32(&r)) > (fc.len - CP_ARCHIVE_HEADER_SIZE) / CP_ARCHIVE_ENTRY_SIZE) {
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		
+		// Read the plug-ins listed in the index
+		if ((plugins = cpi_malloc((count + 1) * sizeof(cp_plugin_info_t *))) == NULL
+			|| (libraries = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		plugins[0] = NULL;
+		while (num_plugins < count) {
+			cp_plugin_info_t *plugin;
+			
+			if ((plugin = read_archive_entry(context, data, &fc, &r, libraries, &status)) == NULL) {
+				break;
+			}
+			if ((status = cpi_register_info(context, plugin, (void (*)(cp_context_t *, void *)) dealloc_snapshot_plugin)) != CP_OK) {
+				cpi_free_plugin(plugin);
+				break;
+			}
+			plugins[num_plugins++] = plugin;
+			plugins[num_plugins] = NULL;
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Keep the contents for extracting the runtime libraries
+#ifdef CP_THREADS
+		cpi_lock_mutex(data->mutex);
+#endif
+		release_file_contents(&data->contents);
+		data->contents = fc;
+		memset(&fc, 0, sizeof(file_contents_t));
+		if (data->libraries != NULL) {
+			free_archive_libraries(data->libraries);
+		}
+		data->libraries = libraries;
+		libraries = NULL;
+#ifdef CP_THREADS
+		cpi_unlock_mutex(data->mutex);
+#endif
+		
+	} while (0);
+	
+	// Report failure
+	switch (status) {
+		case CP_OK:
+			break;
+		case CP_ERR_IO:
+			cpi_errorf(context, N_("Plug-in archive %s could not be read."), data->path);
+			break;
+		case CP_ERR_MALFORMED:
+			cpi_errorf(context, N_("Plug-in archive %s is invalid."), data->path);
+			break;
+		default:
+			cpi_errorf(context, N_("Plug-in archive %s could not be loaded due to insufficient system resources."), data->path);
+			break;
+	}
+	
+	// Release resources
+	if (status != CP_OK && plugins != NULL) {
+		unsigned int i;
+		
+		for (i = 0; i < num_plugins; i++) {
+			cpi_release_info(context, plugins[i]);
+		}
+		cpi_free(plugins);
+		plugins = NULL;
+	}
+	cpi_unlock_context(context);
+	if (libraries != NULL) {
+		free_archive_libraries(libraries);
+	}
+	release_file_contents(&fc);
+	
+	return plugins;
+}
+
+static int archive_resolve_files(void *d, cp_context_t *context, cp_plugin_info_t *plugin) {
+	archive_data_t *data = d;
+	archive_library_t *lib = NULL;
+	char *lib_path = NULL;
+	hnode_t *node;
+	int ok = 0;
+	
+	if (plugin->runtime_lib_name == NULL) {
+		return 1;
+	}
+#ifdef CP_THREADS
+	cpi_lock_mutex(data->mutex);
+#endif
+	do {
+		dcache_writer_t w;
+		
+		// Check whether the library is available or already extracted
+		if (data->libraries != NULL
+			&& (node = hash_lookup(data->libraries, plugin->identifier)) != NULL) {
+			lib = hnode_get(node);
+		}
+		if (lib == NULL
+			|| (lib->version == NULL) != (plugin->version == NULL)
+			|| (lib->version != NULL && strcmp(lib->version, plugin->version))) {
+			cpi_errorf(context, N_("The runtime library of plug-in %s is not included in plug-in archive %s."), plugin->identifier, data->path);
+			break;
+		}
+		if (lib->extracted) {
+			ok = 1;
+			break;
+		}
+		
+		// Extract the library
+		if ((lib_path = cpi_runtime_lib_path(plugin)) == NULL) {
+			cpi_errorf(context, N_("The runtime library of plug-in %s could not be extracted due to insufficient system resources."), plugin->identifier);
+			break;
+		}
+		memset(&w, 0, sizeof(dcache_writer_t));
+		w.data = (unsigned char *) data->contents.data + lib->offset;
+		w.len = w.size = lib->size;
+		if (!ensure_dir(data->extract_dir)
+			|| !ensure_dir(plugin->plugin_path)
+			|| write_file(lib_path, &w) != CP_OK) {
+			cpi_errorf(context, N_("The runtime library of plug-in %s could not be extracted to %s."), plugin->identifier, lib_path);
+			break;
+		}
+		lib->extracted = 1;
+		ok = 1;
+		
+	} while (0);
+#ifdef CP_THREADS
+	cpi_unlock_mutex(data->mutex);
+#endif
+	cpi_free(lib_path);
+	return ok;
+}
+
+CP_C_API cp_plugin_loader_t *cp_create_archive_ploader(const char *path, const char *extract_dir, cp_status_t *error) {
+	cp_plugin_loader_t *loader = NULL;
+	archive_data_t *data;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(path);
+	do {
+	
+		// Allocate memory for the loader
+		if ((loader = cpi_create_ploader(&loader_options)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Initialize loader
+		loader->data = data = cpi_malloc(sizeof(archive_data_t));
+		loader->scan_plugins = archive_scan_plugins;
+		loader->resolve_files = archive_resolve_files;
+		loader->release_plugins = cpi_release_loaded_plugins;
+		if (data == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(data, 0, sizeof(archive_data_t));
+		if ((data->path = cpi_strdup(path)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// By default the libraries are extracted next to the archive
+		if (extract_dir != NULL) {
+			data->extract_dir = cpi_strdup(extract_dir);
+		} else if ((data->extract_dir = cpi_malloc(strlen(path) + 3)) != NULL) {
+			strcpy(data->extract_dir, path);
+			strcat(data->extract_dir, ".d");
+		}
+		if (data->extract_dir == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+#ifdef CP_THREADS
+		if ((data->mutex = cpi_create_mutex()) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+#endif
+		
+	} while (0);
+	
+	// Release resources on failure
+	if (status != CP_OK) {
+		if (loader != NULL) {
+			cp_destroy_archive_ploader(loader);
+		}
+		loader = NULL;
+	}
+	
+	// Return the final status 
+	if (error != NULL) {
+		*error = status;
+	}
+	
+	return loader;
+}
+
+CP_C_API void cp_destroy_archive_ploader(cp_plugin_loader_t *loader) {
+	archive_data_t *data;
+	
+	CHECK_NOT_NULL(loader);
+	if ((data = loader->data) != NULL) {
+		if (data->libraries != NULL) {
+			free_archive_libraries(data->libraries);
+		}
+		release_file_contents(&data->contents);
+#ifdef CP_THREADS
+		if (data->mutex != NULL) {
+			cpi_destroy_mutex(data->mutex);
+		}
+#endif
+		cpi_free(data->path);
+		cpi_free(data->extract_dir);
+		cpi_free(data);
+	}
+	cpi_destroy_ploader(loader);
+}
@@ -42,6 +42,180 @@
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// A plug-in description together with the arena holding its contents
+typedef struct plugin_block_t {
+
+	/// The reference counting header, must immediately precede the description
+	cpi_info_header_t header;
+
+	/// The plug-in description
+	cp_plugin_info_t plugin;
+	
+	/// The arena holding this block and the contents of the description
+	cpi_arena_t *arena;
+	
+	/// Unparsed configuration sources indexed by extension, or NULL
+	char **cfg_sources;
+	
+	/// Size of the allocated configuration source table
+	unsigned int cfg_sources_size;
+	
+	/// Timing of the descriptor parsing
+	cp_timing_t parse_timing;
+	
+	/// The pre-parsed versions
+	cpi_plugin_versions_t versions;
+	
+#ifndef NDEBUG
+	/// Whether the versions have been parsed
+	int versions_parsed;
+#endif
+	
+} plugin_block_t;
+
+/// A runtime library retained after its plug-in was unresolved
+typedef struct retained_runtime_t {
+	
+	/// The plug-in identifier
+	char *identifier;
+	
+	/// The plug-in version, or NULL if none
+	char *version;
+	
+	/// The required C-Pluff version, or NULL if none
+	char *req_cpluff_version;
+	
+	/// The plug-in path, or NULL if none
+	char *plugin_path;
+	
+	/// The name of the runtime library
+	char *runtime_lib_name;
+	
+	/// The symbol of the runtime function information, or NULL if none
+	char *runtime_funcs_symbol;
+	
+	/// The symbol of the static symbol export table, or NULL if none
+	char *runtime_symbols_symbol;
+	
+	/// The runtime library handle, or NULL if taken back into use
+	DLHANDLE runtime_lib;
+	
+	/// Plug-in runtime function information, or NULL if none
+	cp_plugin_runtime_t *runtime_funcs;
+	
+	/// Static symbol export table, or NULL if none
+	const cp_symbol_table_t *symbol_table;
+	
+	/// Node in the list of retained runtime libraries
+	lnode_t node;
+	
+} retained_runtime_t;
+
+/// A plug-in taking part in a parallel start or stop
+typedef struct pjob_entry_t {
+	
+	/// The plug-in
+	cp_plugin_t *plugin;
+	
+	/// The number of unfinished plug-ins this plug-in must wait for
+	int waiting;
+	
+	/// Whether the plug-in has been queued for processing
+	int queued;
+	
+	/// Whether the plug-in has been processed
+	int done;
+	
+	/// Used when looking for a dependency loop
+	int visited;
+	
+} pjob_entry_t;
+
+/// State shared by the threads of a parallel start or stop
+typedef struct pjob_t {
+	
+	/// The plug-in context
+	cp_context_t *context;
+	
+	/// Whether plug-ins are being stopped rather than started
+	int stop;
+	
+	/// Whether the context lock is released during start and stop functions
+	int unlocked;
+	
+	/// The participating plug-ins
+	pjob_entry_t *entries;
+	
+	/// Map from plug-ins to their entries
+	hash_t *entry_map;
+	
+	/// The number of participating plug-ins
+	int num_entries;
+	
+	/// The queue of plug-ins ready for processing
+	pjob_entry_t **ready;
+	
+	/// The index of the first plug-in in the ready queue
+	int ready_head;
+	
+	/// The index after the last plug-in in the ready queue
+	int ready_tail;
+	
+	/// The number of plug-ins not yet processed
+	int num_left;
+	
+	/// The number of plug-ins being processed
+	int num_running;
+	
+	/// The number of helper threads still running
+	int num_active;
+	
+#ifdef CP_THREADS
+	/// The helper threads to be joined
+	cpi_thread_t **threads;
+	
+	/// The number of helper threads
+	int num_threads;
+#endif
+
+	/// The first error encountered
+	cp_status_t status;
+	
+} pjob_t;
+
+/// A queued asynchronous plug-in start or stop request
+typedef struct async_op_t {
+	
+	/// Identifier of the plug-in
+	char *plugin_id;
+	
+	/// Whether the plug-in is to be stopped rather than started
+	int stop;
+	
+	/// The completion callback or NULL if none
+	cp_plugin_op_func_t callback;
+	
+	/// The user data pointer for the callback
+	void *user_data;
+	
+} async_op_t;
+
+/// The installed plug-ins declaring an import of a plug-in identifier
+typedef struct dependents_t {
+	
+	/// The imported plug-in identifier, owned by this structure
+	char *plugin_id;
+	
+	/// The installed plug-ins importing the identifier
+	cpi_plugin_set_t importers;
+	
+} dependents_t;
+
+
 /* ------------------------------------------------------------------------
  * Function definitions
  * ----------------------------------------------------------------------*/
@@ -50,12 +224,11 @@
 
 #ifndef NDEBUG
 static void assert_processed_zero(cp_context_t *context) {
-	hscan_t scan;
-	hnode_t *node;
+	cpi_hmap_scan_t scan;
+	cp_plugin_t *plugin;
 	
-	hash_scan_begin(&scan, context->env->plugins);
-	while ((node = hash_scan_next(&scan)) != NULL) {
-		cp_plugin_t *plugin = hnode_get(node);
+	cpi_hmap_scan_begin(&scan, context->env->plugins);
+	while ((plugin = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
 		assert(plugin->processed == 0);
 	}
 }
@@ -63,117 +236,488 @@ static void assert_processed_zero(cp_context_t *context) {
 #define assert_processed_zero(c) assert(1)
 #endif
 
-static void unregister_extensions(cp_context_t *context, cp_plugin_info_t *plugin) {
+// Dependency graph
+
+/**
+ * Makes sure that a plug-in set has room for the specified number of
+ * plug-ins, so that appending them can not fail.
+ * 
+ * @param set the set being operated on
+ * @param num the total number of plug-ins
+ * @return non-zero if the operation was successful, zero if allocation failed
+ */
+static int plugin_set_reserve(cpi_plugin_set_t *set, int num) {
+	if (num > set->size) {
+		cp_plugin_t **plugins;
+		int size = (set->size == 0 ? 4 : set->size * 2);
+		
+		if (size < num) {
+			size = num;
+		}
+		if ((plugins = cpi_realloc(set->plugins, size * sizeof(cp_plugin_t *))) == NULL) {
+			return 0;
+		}
+		set->plugins = plugins;
+		set->size = size;
+	}
+	return 1;
+}
+
+/**
+ * Appends a plug-in to a plug-in set without checking whether it is
+ * already included.
+ * 
+ * @param set the set being operated on
+ * @param plugin the plug-in being appended
+ * @return non-zero if the operation was successful, zero if allocation failed
+ */
+static int plugin_set_append(cpi_plugin_set_t *set, cp_plugin_t *plugin) {
+	if (!plugin_set_reserve(set, set->num + 1)) {
+		return 0;
+	}
+	set->plugins[set->num++] = plugin;
+	return 1;
+}
+
+CP_HIDDEN int cpi_plugin_set_add(cpi_plugin_set_t *set, cp_plugin_t *plugin) {
+	if (cpi_plugin_set_contains(set, plugin)) {
+		return 1;
+	}
+	return plugin_set_append(set, plugin);
+}
+
+CP_HIDDEN int cpi_plugin_set_remove(cpi_plugin_set_t *set, const cp_plugin_t *plugin) {
 	int i;
 	
-	for (i = 0; i < plugin->num_ext_points; i++) {
-		cp_ext_point_t *ep = plugin->ext_points + i;
-		hnode_t *hnode;
+	// Search from the end, recently added plug-ins are usually removed first
+	for (i = set->num - 1; i >= 0; i--) {
+		if (set->plugins[i] == plugin) {
+			set->num--;
+			memmove(set->plugins + i, set->plugins + i + 1, (set->num - i) * sizeof(cp_plugin_t *));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+CP_HIDDEN int cpi_plugin_set_contains(const cpi_plugin_set_t *set, const cp_plugin_t *plugin) {
+	int i;
+	
+	for (i = 0; i < set->num; i++) {
+		if (set->plugins[i] == plugin) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+CP_HIDDEN void cpi_plugin_set_clear(cpi_plugin_set_t *set) {
+	cpi_free(set->plugins);
+	set->plugins = NULL;
+	set->num = 0;
+	set->size = 0;
+}
+
+/**
+ * Points the imports of the specified identifier at the specified plug-in.
+ * 
+ * @param plugin the importing plug-in
+ * @param id the identifier of the imported plug-in
+ * @param target the installed plug-in or NULL if not installed
+ */
+static void set_import_targets(cp_plugin_t *plugin, const char *id, cp_plugin_t *target) {
+	int i;
+	
+	for (i = 0; i < plugin->plugin->num_imports; i++) {
+		if (!strcmp(plugin->plugin->imports[i].plugin_id, id)) {
+			plugin->import_targets[i] = target;
+		}
+	}
+}
+
+/**
+ * Adds a registered plug-in to the dependency graph. The imports of the
+ * plug-in are linked to the installed plug-ins and the imports of the
+ * installed plug-ins are linked to this plug-in. The plug-in must already
+ * be included in the plug-in map.
+ * 
+ * @param context the plug-in context
+ * @param rp the registered plug-in
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t link_dependencies(cp_context_t *context, cp_plugin_t *rp) {
+	cp_plugin_env_t *env = context->env;
+	hnode_t *hnode;
+	cp_plugin_t *target;
+	int i;
+	
+	env->topo_valid = 0;
+	
+	// Link the imports of this plug-in
+	if (rp->plugin->num_imports > 0
+		&& (rp->import_targets = cpi_calloc(rp->plugin->num_imports, sizeof(cp_plugin_t *))) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	for (i = 0; i < rp->plugin->num_imports; i++) {
+		const char *id = rp->plugin->imports[i].plugin_id;
+		dependents_t *deps;
 		
-		if ((hnode = hash_lookup(context->env->ext_points, ep->identifier)) != NULL
-			&& hnode_get(hnode) == ep) {
-			hash_delete_free(context->env->ext_points, hnode);
+		if ((hnode = hash_lookup(env->dependents, id)) != NULL) {
+			deps = hnode_get(hnode);
+		} else {
+			if ((deps = cpi_malloc(sizeof(dependents_t))) == NULL) {
+				return CP_ERR_RESOURCE;
+			}
+			memset(deps, 0, sizeof(dependents_t));
+			if ((deps->plugin_id = cpi_strdup(id)) == NULL
+				|| !hash_alloc_insert(env->dependents, deps->plugin_id, deps)) {
+				cpi_free(deps->plugin_id);
+				cpi_free(deps);
+				return CP_ERR_RESOURCE;
+			}
+			if ((target = cpi_hmap_get(env->plugins, id)) != NULL) {
+				target->dependents = &(deps->importers);
+			}
 		}
+		
+		// The same identifier may be imported several times
+		if ((deps->importers.num == 0
+				|| deps->importers.plugins[deps->importers.num - 1] != rp)
+			&& !plugin_set_append(&(deps->importers), rp)) {
+			return CP_ERR_RESOURCE;
+		}
+		rp->import_targets[i] = cpi_hmap_get(env->plugins, id);
 	}
-	for (i = 0; i < plugin->num_extensions; i++) {
-		cp_extension_t *e = plugin->extensions + i;
+	
+	// Link the installed plug-ins importing this plug-in
+	if ((hnode = hash_lookup(env->dependents, rp->plugin->identifier)) != NULL) {
+		dependents_t *deps = hnode_get(hnode);
+		
+		rp->dependents = &(deps->importers);
+		for (i = 0; i < deps->importers.num; i++) {
+			set_import_targets(deps->importers.plugins[i], rp->plugin->identifier, rp);
+		}
+	}
+	
+	return CP_OK;
+}
+
+/**
+ * Removes a plug-in from the dependency graph. Also handles a plug-in
+ * which was only partially linked by ::link_dependencies.
+ * 
+ * @param context the plug-in context
+ * @param rp the registered plug-in
+ */
+static void unlink_dependencies(cp_context_t *context, cp_plugin_t *rp) {
+	cp_plugin_env_t *env = context->env;
+	int i;
+	
+	env->topo_valid = 0;
+	
+	// Unlink the installed plug-ins importing this plug-in
+	if (rp->dependents != NULL) {
+		for (i = 0; i < rp->dependents->num; i++) {
+			set_import_targets(rp->dependents->plugins[i], rp->plugin->identifier, NULL);
+		}
+		rp->dependents = NULL;
+	}
+	
+	// Unlink the imports of this plug-in
+	for (i = 0; rp->import_targets != NULL && i < rp->plugin->num_imports; i++) {
+		const char *id = rp->plugin->imports[i].plugin_id;
 		hnode_t *hnode;
+		cp_plugin_t *target;
+		dependents_t *deps;
 		
-		if ((hnode = hash_lookup(context->env->extensions, e->ext_point_id)) != NULL) {
-			list_t *el = hnode_get(hnode);
-			lnode_t *lnode = list_first(el);
-			
-			while (lnode != NULL) {
-				lnode_t *nn = list_next(el, lnode);
-				if (lnode_get(lnode) == e) {
-					list_delete(el, lnode);
-					lnode_destroy(lnode);
-					break;
-				}
-				lnode = nn;
-			}
-			if (list_isempty(el)) {
-				char *epid = (char *) hnode_getkey(hnode);				
-				hash_delete_free(context->env->extensions, hnode);
-				free(epid);
-				list_destroy(el);
+		if ((hnode = hash_lookup(env->dependents, id)) == NULL) {
+			continue;
+		}
+		deps = hnode_get(hnode);
+		cpi_plugin_set_remove(&(deps->importers), rp);
+		if (deps->importers.num == 0) {
+			hash_delete_free(env->dependents, hnode);
+			if ((target = cpi_hmap_get(env->plugins, id)) != NULL) {
+				target->dependents = NULL;
 			}
+			cpi_plugin_set_clear(&(deps->importers));
+			cpi_free(deps->plugin_id);
+			cpi_free(deps);
 		}
 	}
+	cpi_free(rp->import_targets);
+	rp->import_targets = NULL;
 }
 
-CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader) {
-	cp_plugin_t *rp = NULL;
-	cp_status_t status = CP_OK;
-	cpi_plugin_event_t event;
+CP_HIDDEN void cpi_free_dependents(cp_plugin_env_t *env) {
+	if (env->dependents != NULL) {
+		assert(hash_isempty(env->dependents));
+		hash_destroy(env->dependents);
+		env->dependents = NULL;
+	}
+	cpi_plugin_set_clear(&(env->topo_order));
+	env->topo_valid = 0;
+}
+
+static void topo_order_visit(cpi_plugin_set_t *order, cp_plugin_t *plugin) {
 	int i;
+	
+	if (plugin->processed) {
+		return;
+	}
+	plugin->processed = 1;
+	for (i = 0; i < plugin->plugin->num_imports; i++) {
+		if (plugin->import_targets[i] != NULL) {
+			topo_order_visit(order, plugin->import_targets[i]);
+		}
+	}
+	order->plugins[order->num++] = plugin;
+}
 
-	assert(cpi_is_context_locked(context));
-	do {
+/**
+ * Returns the installed plug-ins in a topological order of the static
+ * dependency graph, imported plug-ins first. Dependency loops are broken
+ * at an arbitrary point. The order is cached until a plug-in is installed
+ * or uninstalled.
+ * 
+ * @param context the plug-in context
+ * @return the installed plug-ins or NULL if insufficient memory
+ */
+static cpi_plugin_set_t *topo_order(cp_context_t *context) {
+	cp_plugin_env_t *env = context->env;
+	cpi_plugin_set_t *order = &(env->topo_order);
+	cpi_hmap_scan_t scan;
+	cp_plugin_t *rp;
+	int size, i;
+	
+	if (env->topo_valid) {
+		return order;
+	}
+	
+	// Make room for all installed plug-ins
+	size = cpi_hmap_count(env->plugins);
+	if (size > order->size) {
+		cp_plugin_t **plugins;
 		
-		// Check that there is no conflicting plug-in already loaded 
-		if (hash_lookup(context->env->plugins, plugin->identifier) != NULL) {
-			cpi_errorf(context,
-				N_("Plug-in %s could not be installed because a plug-in with the same identifier is already installed."), 
-				plugin->identifier);
-			status = CP_ERR_CONFLICT;
-			break;
+		if ((plugins = cpi_realloc(order->plugins, size * sizeof(cp_plugin_t *))) == NULL) {
+			return NULL;
 		}
+		order->plugins = plugins;
+		order->size = size;
+	}
+	
+	// Order the plug-ins depth first
+	assert_processed_zero(context);
+	order->num = 0;
+	cpi_hmap_scan_begin(&scan, env->plugins);
+	while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+		topo_order_visit(order, rp);
+	}
+	assert(order->num == size);
+	for (i = 0; i < order->num; i++) {
+		order->plugins[i]->processed = 0;
+	}
+	env->topo_valid = 1;
+	
+	return order;
+}
 
-		// Increase usage count for the plug-in descriptor
-		cpi_use_info(context, plugin);
+static void unregister_extensions(cp_context_t *context, cp_plugin_t *rp) {
+	cp_plugin_info_t *plugin = rp->plugin;
+	int i;
+	
+	for (i = 0; i < plugin->num_ext_points; i++) {
+		cp_ext_point_t *ep = plugin->ext_points + i;
+		
+		if (cpi_hmap_get(context->env->ext_points, ep->identifier) == ep) {
+			cpi_invalidate_extensions_snapshot(context, ep->identifier);
+			cpi_hmap_remove(context->env->ext_points, ep->identifier);
+		}
+	}
+	
+	// Unlink the extensions using the nodes recorded at registration
+	for (i = 0; rp->extension_nodes != NULL && i < plugin->num_extensions; i++) {
+		cp_extension_t *e = plugin->extensions + i;
+		lnode_t *lnode = rp->extension_nodes + i;
+		list_t *el;
+		
+		if (!lnode_is_in_a_list(lnode)) {
+			continue;
+		}
+		cpi_invalidate_extensions_snapshot(context, e->ext_point_id);
+		el = cpi_hmap_get(context->env->extensions, e->ext_point_id);
+		assert(el != NULL);
+		cpi_unindex_extension(context, e);
+		cpi_unbind_extension_cfg(context, e);
+		list_delete(el, lnode);
+		if (list_isempty(el)) {
+			cpi_hmap_remove(context->env->extensions, e->ext_point_id);
+			list_destroy(el);
+		}
+	}
+	cpi_free(rp->extension_nodes);
+	rp->extension_nodes = NULL;
+}
 
-		// Allocate space for the plug-in state 
-		if ((rp = malloc(sizeof(cp_plugin_t))) == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
+/**
+ * Checks whether the specified plug-in conflicts with installed plug-ins or
+ * with plug-ins accepted earlier in the same batch. Logs an error on
+ * conflict.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @param batch_plugins identifiers of plug-ins accepted earlier in the batch
+ * @param batch_ext_points identifiers of extension points accepted earlier in the batch
+ * @return @ref CP_OK, @ref CP_ERR_CONFLICT or @ref CP_ERR_RESOURCE
+ */
+static cp_status_t check_install_conflicts(cp_context_t *context, cp_plugin_info_t *plugin, hash_t *batch_plugins, hash_t *batch_ext_points) {
+	int i, j;
+	
+	// Check for a plug-in with the same identifier 
+	if (cpi_hmap_get(context->env->plugins, plugin->identifier) != NULL
+		|| hash_lookup(batch_plugins, plugin->identifier) != NULL) {
+		cpi_errorf(context,
+			N_("Plug-in %s could not be installed because a plug-in with the same identifier is already installed."), 
+			plugin->identifier);
+		return CP_ERR_CONFLICT;
+	}
+	
+	// Check for conflicting extension points
+	for (i = 0; i < plugin->num_ext_points; i++) {
+		cp_ext_point_t *ep = plugin->ext_points + i;
+		int dup = 0;
+		
+		for (j = 0; j < i && !dup; j++) {
+			dup = !strcmp(ep->identifier, plugin->ext_points[j].identifier);
+		}
+		if (dup
+			|| cpi_hmap_get(context->env->ext_points, ep->identifier) != NULL
+			|| hash_lookup(batch_ext_points, ep->identifier) != NULL) {
+			cpi_errorf(context, N_("Plug-in %s could not be installed because extension point %s conflicts with an already installed extension point."), plugin->identifier, ep->identifier);
+			return CP_ERR_CONFLICT;
+		}
+	}
+	
+	// Reserve the identifiers for the rest of the batch
+	if (!hash_alloc_insert(batch_plugins, plugin->identifier, plugin)) {
+		return CP_ERR_RESOURCE;
+	}
+	for (i = 0; i < plugin->num_ext_points; i++) {
+		if (!hash_alloc_insert(batch_ext_points, plugin->ext_points[i].identifier, NULL)) {
+			return CP_ERR_RESOURCE;
 		}
+	}
+	return CP_OK;
+}
+
+/**
+ * Sets the state of a registered plug-in and publishes it to the plug-in
+ * handle, if any.
+ * 
+ * @param plugin the plug-in
+ * @param state the new state
+ * @return the new state
+ */
+static cp_plugin_state_t set_plugin_state(cp_plugin_t *plugin, cp_plugin_state_t state) {
+	plugin->state = state;
+	cpi_publish_plugin_state(plugin);
+	return state;
+}
+
+/**
+ * Removes a plug-in registered by ::register_plugin from the context and
+ * frees its state. No event is delivered.
+ * 
+ * @param context the plug-in context
+ * @param rp the registered plug-in
+ */
+static void unregister_plugin(cp_context_t *context, cp_plugin_t *rp) {
+	unregister_extensions(context, rp);
+	unlink_dependencies(context, rp);
+	if (cpi_hmap_get(context->env->plugins, rp->plugin->identifier) == rp) {
+		cpi_registry_changed(context);
+		cpi_hmap_remove(context->env->plugins, rp->plugin->identifier);
+	}
+	cpi_release_info(context, rp->plugin);
+	cpi_plugin_set_clear(&rp->importing);
+	cpi_free(rp);
+}
+
+/**
+ * Registers a plug-in and its extension points and extensions with the
+ * context. The caller must have checked for conflicts. No event is
+ * delivered.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @param loader the associated plug-in loader or NULL for none
+ * @param error pointer to the location where the status code is stored
+ * @return the registered plug-in or NULL on failure
+ */
+static cp_plugin_t *register_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader, cp_status_t *error) {
+	cp_plugin_t *rp;
+	cp_status_t status = CP_OK;
+	int i;
 	
-		// Initialize plug-in state 
-		memset(rp, 0, sizeof(cp_plugin_t));
-		rp->context = NULL;
-		rp->plugin = plugin;
-		rp->loader = loader;
-		rp->state = CP_PLUGIN_INSTALLED;
-		rp->imported = NULL;
-		rp->runtime_lib = NULL;
-		rp->runtime_funcs = NULL;
-		rp->plugin_data = NULL;
-		rp->importing = list_create(LISTCOUNT_T_MAX);
-		if (rp->importing == NULL) {
+	// Allocate space for the plug-in state 
+	if ((rp = cpi_malloc(sizeof(cp_plugin_t))) == NULL) {
+		*error = CP_ERR_RESOURCE;
+		return NULL;
+	}
+
+	// Initialize plug-in state 
+	memset(rp, 0, sizeof(cp_plugin_t));
+	rp->context = NULL;
+	rp->plugin = plugin;
+	rp->loader = loader;
+	rp->state = CP_PLUGIN_INSTALLED;
+	rp->runtime_lib = NULL;
+	rp->runtime_funcs = NULL;
+	rp->symbol_table = NULL;
+	rp->plugin_data = NULL;
+	list_init(&rp->run_wait, LISTCOUNT_T_MAX);
+	lnode_init(&rp->run_queue_node, rp);
+	cpi_use_info(context, plugin);
+	do {
+		if (!cpi_hmap_put(context->env->plugins, plugin->identifier, rp)) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
-		if (!hash_alloc_insert(context->env->plugins, plugin->identifier, rp)) {
-			status = CP_ERR_RESOURCE;
+		cpi_registry_changed(context);
+		
+		// Add the plug-in to the dependency graph
+		if ((status = link_dependencies(context, rp)) != CP_OK) {
 			break;
 		}
 		
 		// Register extension points
 		for (i = 0; status == CP_OK && i < plugin->num_ext_points; i++) {
 			cp_ext_point_t *ep = plugin->ext_points + i;
-			hnode_t *hnode;
 			
-			if ((hnode = hash_lookup(context->env->ext_points, ep->identifier)) != NULL) {
-				cpi_errorf(context, N_("Plug-in %s could not be installed because extension point %s conflicts with an already installed extension point."), plugin->identifier, ep->identifier);
-				status = CP_ERR_CONFLICT;
-			} else if (!hash_alloc_insert(context->env->ext_points, ep->identifier, ep)) {
+			if (!cpi_hmap_put(context->env->ext_points, ep->identifier, ep)) {
 				status = CP_ERR_RESOURCE;
 			}
+			cpi_invalidate_extensions_snapshot(context, ep->identifier);
 		}
 		
-		// Register extensions
+		// Register extensions, keeping their list nodes for unregistration
+		if (status == CP_OK
+			&& plugin->num_extensions > 0
+			&& (rp->extension_nodes = cpi_calloc(plugin->num_extensions, sizeof(lnode_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+		}
 		for (i = 0; status == CP_OK && i < plugin->num_extensions; i++) {
 			cp_extension_t *e = plugin->extensions + i;
-			hnode_t *hnode;
-			lnode_t *lnode;
 			list_t *el;
 			
-			if ((hnode = hash_lookup(context->env->extensions, e->ext_point_id)) == NULL) {
+			cpi_invalidate_extensions_snapshot(context, e->ext_point_id);
+			if ((el = cpi_hmap_get(context->env->extensions, e->ext_point_id)) == NULL) {
 				char *epid;
+				
+				// The interned identifier remains valid as long as the environment
 				if ((el = list_create(LISTCOUNT_T_MAX)) != NULL
-					&& (epid = strdup(e->ext_point_id)) != NULL) {
-					if (!hash_alloc_insert(context->env->extensions, epid, el)) {
+					&& (epid = cpi_intern_string(context, e->ext_point_id)) != NULL) {
+					if (!cpi_hmap_put(context->env->extensions, epid, el)) {
 						list_destroy(el);
 						status = CP_ERR_RESOURCE;
 						break;
@@ -185,50 +729,159 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 					status = CP_ERR_RESOURCE;
 					break;
 				}
-			} else {
-				el = hnode_get(hnode);
 			}
-			if ((lnode = lnode_create(e)) != NULL) {
-				list_append(el, lnode);
-			} else {
-				status = CP_ERR_RESOURCE;
-				break;
+			list_append(el, lnode_init(rp->extension_nodes + i, e));
+			if ((status = cpi_index_extension(context, e)) == CP_OK) {
+				status = cpi_bind_extension_cfg(context, e);
 			}
 		}
-
-		// Break if previous loops failed
-		if (status != CP_OK) {
-			break;
-		}
 		
-		// Plug-in installed 
-		event.plugin_id = plugin->identifier;
-		event.old_state = CP_PLUGIN_UNINSTALLED;
-		event.new_state = rp->state;
-		cpi_deliver_event(context, &event);
-
 	} while (0);
-
+	
 	// Release resources on failure
 	if (status != CP_OK) {
-		if (rp != NULL) {
-			if (rp->importing != NULL) {
-				list_destroy(rp->importing);
+		unregister_plugin(context, rp);
+		rp = NULL;
+	}
+	
+	*error = status;
+	return rp;
+}
+
+CP_HIDDEN cp_status_t cpi_install_plugins(cp_context_t *context, cp_plugin_info_t * const *plugins, cp_plugin_loader_t * const *loaders, unsigned int n, int flags, cp_status_t *statuses) {
+	cp_plugin_t **rps = NULL;
+	cp_status_t *sts = statuses;
+	hash_t *batch_plugins = NULL;
+	hash_t *batch_ext_points = NULL;
+	cp_status_t status = CP_OK;
+	hashcount_t num_ext_points = 0, num_extensions = 0;
+	int rollback = 0;
+	unsigned int i;
+	
+	assert(cpi_is_context_locked(context));
+	assert(n == 0 || plugins != NULL);
+	if (n == 0) {
+		return CP_OK;
+	}
+	do {
+		
+		// Allocate the bookkeeping for the batch
+		if (sts == NULL && (sts = cpi_malloc(n * sizeof(cp_status_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			rollback = 1;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			sts[i] = CP_OK;
+		}
+		if ((rps = cpi_calloc(n, sizeof(cp_plugin_t *))) == NULL
+			|| (batch_plugins = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL
+			|| (batch_ext_points = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			rollback = 1;
+			break;
+		}
+		
+		// Check the whole batch for conflicts before modifying the context
+		for (i = 0; i < n; i++) {
+			if ((sts[i] = check_install_conflicts(context, plugins[i], batch_plugins, batch_ext_points)) != CP_OK) {
+				if (status == CP_OK) {
+					status = sts[i];
+				}
+				if (sts[i] == CP_ERR_RESOURCE) {
+					break;
+				}
+			} else {
+				num_ext_points += plugins[i]->num_ext_points;
+				num_extensions += plugins[i]->num_extensions;
+			}
+		}
+		if (status == CP_ERR_RESOURCE
+			|| (status != CP_OK && (flags & CP_IP_ATOMIC))) {
+			rollback = 1;
+			break;
+		}
+		
+		// Size the registries for the whole batch
+		cpi_hmap_reserve(context->env->plugins, cpi_hmap_count(context->env->plugins) + hash_count(batch_plugins));
+		cpi_hmap_reserve(context->env->ext_points, cpi_hmap_count(context->env->ext_points) + num_ext_points);
+		cpi_hmap_reserve(context->env->extensions, cpi_hmap_count(context->env->extensions) + num_extensions);
+		
+		// Register the plug-ins
+		for (i = 0; i < n; i++) {
+			if (sts[i] != CP_OK) {
+				continue;
+			}
+			if ((rps[i] = register_plugin(context, plugins[i], loaders != NULL ? loaders[i] : NULL, sts + i)) == NULL) {
+				if (sts[i] == CP_ERR_MALFORMED) {
+					cpi_errorf(context,
+						N_("Plug-in %s could not be installed because its extension configuration does not match the configuration schema."), plugins[i]->identifier);
+				} else {
+					cpi_errorf(context,
+						N_("Plug-in %s could not be installed due to insufficient system resources."), plugins[i]->identifier);
+				}
+				if (status == CP_OK) {
+					status = sts[i];
+				}
+				if (flags & CP_IP_ATOMIC) {
+					rollback = 1;
+					break;
+				}
+			}
+		}
+		if (rollback) {
+			break;
+		}
+		
+		// Deliver the installation events once the whole batch is registered
+		for (i = 0; i < n; i++) {
+			if (rps[i] != NULL) {
+				cpi_plugin_event_t event;
+				
+				cpi_trace(context, install, CP_TRACE_INSTALL, plugins[i]->identifier, NULL, CP_OK);
+				cpi_attach_plugin_handle(context, rps[i]);
+				event.plugin_id = plugins[i]->identifier;
+				event.old_state = CP_PLUGIN_UNINSTALLED;
+				event.new_state = rps[i]->state;
+				cpi_deliver_event(context, &event);
+			}
+		}
+		
+	} while (0);
+	
+	// Roll back the batch if it could not be installed as a whole
+	if (rollback) {
+		for (i = 0; i < n; i++) {
+			if (rps != NULL && rps[i] != NULL) {
+				unregister_plugin(context, rps[i]);
+			}
+			if (statuses != NULL && (sts != statuses || statuses[i] == CP_OK)) {
+				statuses[i] = status;
 			}
-			free(rp);
 		}
-		unregister_extensions(context, plugin);
 	}
-
-	// Report possible resource error
-	if (status == CP_ERR_RESOURCE) {
-		cpi_errorf(context,
-			N_("Plug-in %s could not be installed due to insufficient system resources."), plugin->identifier);
+	
+	// Release the bookkeeping
+	if (batch_plugins != NULL) {
+		hash_free_nodes(batch_plugins);
+		hash_destroy(batch_plugins);
 	}
-
+	if (batch_ext_points != NULL) {
+		hash_free_nodes(batch_ext_points);
+		hash_destroy(batch_ext_points);
+	}
+	if (sts != statuses) {
+		cpi_free(sts);
+	}
+	cpi_free(rps);
+	
 	return status;
 }
 
+CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader) {
+	return cpi_install_plugins(context, &plugin, &loader, 1, 0, NULL);
+}
+
 CP_C_API cp_status_t cp_install_plugin(cp_context_t *context, cp_plugin_info_t *plugin) {
 	cp_status_t status;
 
@@ -243,29 +896,251 @@ CP_C_API cp_status_t cp_install_plugin(cp_context_t *context, cp_plugin_info_t *
 	return status;
 }
 
+CP_C_API cp_status_t cp_install_plugins(cp_context_t *context, cp_plugin_info_t **plugins, unsigned int n, int flags) {
+	cp_status_t status;
+
+	CHECK_NOT_NULL(context);
+	if (n > 0) {
+		CHECK_NOT_NULL(plugins);
+	}
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	status = cpi_install_plugins(context, plugins, NULL, n, flags, NULL);
+	cpi_unlock_context(context);
+
+	return status;
+}
+
+/**
+ * Compares two optional strings for equality.
+ * 
+ * @param s1 the first string, or NULL
+ * @param s2 the second string, or NULL
+ * @return non-zero if both are NULL or equal, otherwise zero
+ */
+static int opt_str_equal(const char *s1, const char *s2) {
+	return s1 == s2 || (s1 != NULL && s2 != NULL && !strcmp(s1, s2));
+}
+
+/**
+ * Duplicates an optional string.
+ * 
+ * @param dst the location where the copy, or NULL, is stored
+ * @param src the string to be copied, or NULL
+ * @return non-zero on success or zero if insufficient memory
+ */
+static int opt_str_dup(char **dst, const char *src) {
+	*dst = (src != NULL ? cpi_strdup(src) : NULL);
+	return src == NULL || *dst != NULL;
+}
+
+/**
+ * Frees a retained runtime library entry, closing the runtime library
+ * unless it has been taken back into use.
+ * 
+ * @param rr the retained runtime library
+ */
+static void free_retained_runtime(retained_runtime_t *rr) {
+	if (rr->runtime_lib != NULL) {
+		DLCLOSE(rr->runtime_lib);
+	}
+	cpi_free(rr->identifier);
+	cpi_free(rr->version);
+	cpi_free(rr->req_cpluff_version);
+	cpi_free(rr->plugin_path);
+	cpi_free(rr->runtime_lib_name);
+	cpi_free(rr->runtime_funcs_symbol);
+	cpi_free(rr->runtime_symbols_symbol);
+	cpi_free(rr);
+}
+
+/**
+ * Removes a retained runtime library from the retention structures.
+ * 
+ * @param env the plug-in environment
+ * @param rr the retained runtime library
+ */
+static void remove_retained_runtime(cp_plugin_env_t *env, retained_runtime_t *rr) {
+	hnode_t *node;
+	
+	node = hash_lookup(env->retained_runtimes, rr->identifier);
+	assert(node != NULL && hnode_get(node) == rr);
+	hash_delete_free(env->retained_runtimes, node);
+	list_delete(env->retained_order, &rr->node);
+}
+
+/**
+ * Closes the least recently retained runtime libraries until at most the
+ * specified number of libraries is retained.
+ * 
+ * @param env the plug-in environment
+ * @param max the maximum number of libraries to be retained
+ * @return the number of libraries closed
+ */
+static int evict_retained_runtimes(cp_plugin_env_t *env, int max) {
+	int n = 0;
+	
+	if (env->retained_order == NULL) {
+		return 0;
+	}
+	while (list_count(env->retained_order) > (listcount_t) max) {
+		retained_runtime_t *rr = lnode_get(list_first(env->retained_order));
+		
+		remove_retained_runtime(env, rr);
+		free_retained_runtime(rr);
+		n++;
+	}
+	return n;
+}
+
+/**
+ * Retains the runtime library of a plug-in being unresolved so that it
+ * can be taken back into use if the same plug-in is installed and resolved
+ * again. On success the plug-in runtime information is owned by the
+ * retention structures.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the plug-in being unresolved
+ * @return non-zero if the library was retained, otherwise zero
+ */
+static int retain_plugin_runtime(cp_plugin_env_t *env, cp_plugin_t *plugin) {
+	const cp_plugin_info_t *pi = plugin->plugin;
+	retained_runtime_t *rr;
+	hnode_t *node;
+	
+	// Create the retention structures on first use
+	if (env->retained_runtimes == NULL
+		&& (env->retained_runtimes = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL) {
+		return 0;
+	}
+	if (env->retained_order == NULL
+		&& (env->retained_order = list_create(LISTCOUNT_T_MAX)) == NULL) {
+		return 0;
+	}
+	
+	// Replace any stale entry for the same plug-in
+	if ((node = hash_lookup(env->retained_runtimes, pi->identifier)) != NULL) {
+		rr = hnode_get(node);
+		remove_retained_runtime(env, rr);
+		free_retained_runtime(rr);
+	}
+	
+	// Record the descriptor data the runtime library was resolved for
+	if ((rr = cpi_malloc(sizeof(retained_runtime_t))) == NULL) {
+		return 0;
+	}
+	memset(rr, 0, sizeof(retained_runtime_t));
+	if (!opt_str_dup(&rr->identifier, pi->identifier)
+		|| !opt_str_dup(&rr->version, pi->version)
+		|| !opt_str_dup(&rr->req_cpluff_version, pi->req_cpluff_version)
+		|| !opt_str_dup(&rr->plugin_path, pi->plugin_path)
+		|| !opt_str_dup(&rr->runtime_lib_name, pi->runtime_lib_name)
+		|| !opt_str_dup(&rr->runtime_funcs_symbol, pi->runtime_funcs_symbol)
+		|| !opt_str_dup(&rr->runtime_symbols_symbol, pi->runtime_symbols_symbol)
+		|| !hash_alloc_insert(env->retained_runtimes, rr->identifier, rr)) {
+		free_retained_runtime(rr);
+		return 0;
+	}
+	list_append(env->retained_order, lnode_init(&rr->node, rr));
+	
+	// Take over the runtime library
+	rr->runtime_lib = plugin->runtime_lib;
+	rr->runtime_funcs = plugin->runtime_funcs;
+	rr->symbol_table = plugin->symbol_table;
+	plugin->runtime_lib = NULL;
+	evict_retained_runtimes(env, env->max_retained_runtimes);
+	return 1;
+}
+
+/**
+ * Takes back into use a runtime library retained for the specified plug-in,
+ * if the runtime related descriptor data has not changed since the library
+ * was retained. A retained library not matching the descriptor is closed.
+ * 
+ * @param env the plug-in environment
+ * @param plugin the plug-in being resolved
+ * @return non-zero if a retained library was taken into use, otherwise zero
+ */
+static int take_retained_runtime(cp_plugin_env_t *env, cp_plugin_t *plugin) {
+	const cp_plugin_info_t *pi = plugin->plugin;
+	retained_runtime_t *rr;
+	hnode_t *node;
+	int taken = 0;
+	
+	if (env->retained_runtimes == NULL
+		|| (node = hash_lookup(env->retained_runtimes, pi->identifier)) == NULL) {
+		return 0;
+	}
+	rr = hnode_get(node);
+	remove_retained_runtime(env, rr);
+	if (opt_str_equal(rr->version, pi->version)
+		&& opt_str_equal(rr->req_cpluff_version, pi->req_cpluff_version)
+		&& opt_str_equal(rr->plugin_path, pi->plugin_path)
+		&& opt_str_equal(rr->runtime_lib_name, pi->runtime_lib_name)
+		&& opt_str_equal(rr->runtime_funcs_symbol, pi->runtime_funcs_symbol)
+		&& opt_str_equal(rr->runtime_symbols_symbol, pi->runtime_symbols_symbol)) {
+		plugin->runtime_lib = rr->runtime_lib;
+		plugin->runtime_funcs = rr->runtime_funcs;
+		plugin->symbol_table = rr->symbol_table;
+		rr->runtime_lib = NULL;
+		taken = 1;
+	}
+	free_retained_runtime(rr);
+	return taken;
+}
+
 /**
  * Unresolves the plug-in runtime information.
  * 
+ * @param context the plug-in context
  * @param plugin the plug-in to unresolve
+ * @param retain whether the runtime library may be retained for reuse
  */
-static void unresolve_plugin_runtime(cp_plugin_t *plugin) {
+static void unresolve_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin, int retain) {
 
 	// Destroy the plug-in instance, if necessary
 	if (plugin->context != NULL) {
-		plugin->context->env->in_destroy_func_invocation++;
+		cpi_invocation_t inv;
+		
+		cpi_trace(plugin->context, destroy_begin, CP_TRACE_DESTROY_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+		cpi_begin_invocation(plugin->context->env, &inv, CPI_CF_DESTROY);
 		plugin->runtime_funcs->destroy(plugin->plugin_data);
-		plugin->context->env->in_destroy_func_invocation--;
+		cpi_end_invocation(&inv);
+		cpi_trace(plugin->context, destroy_end, CP_TRACE_DESTROY_END, plugin->plugin->identifier, NULL, CP_OK);
 		plugin->plugin_data = NULL;
 		cpi_free_context(plugin->context);
 		plugin->context = NULL;
 	}
 
-	// Close plug-in runtime library	
-	plugin->runtime_funcs = NULL;
-	if (plugin->runtime_lib != NULL) {
+	// Retain or close plug-in runtime library
+	if (plugin->runtime_lib != NULL
+		&& !(retain
+			&& context->env->max_retained_runtimes > 0
+			&& retain_plugin_runtime(context->env, plugin))) {
 		DLCLOSE(plugin->runtime_lib);
-		plugin->runtime_lib = NULL;
-	}	
+	}
+	plugin->runtime_lib = NULL;
+	plugin->runtime_funcs = NULL;
+	plugin->symbol_table = NULL;
+}
+
+CP_HIDDEN char *cpi_runtime_lib_path(const cp_plugin_info_t *plugin) {
+	char *rlpath;
+	size_t ppath_len, lname_len, rlpath_len;
+	
+	assert(plugin->runtime_lib_name != NULL);
+	ppath_len = strlen(plugin->plugin_path);
+	lname_len = strlen(plugin->runtime_lib_name);
+	rlpath_len = ppath_len + lname_len + strlen(CP_SHREXT) + 2;
+	if ((rlpath = cpi_malloc(rlpath_len * sizeof(char))) == NULL) {
+		return NULL;
+	}
+	strcpy(rlpath, plugin->plugin_path);
+	rlpath[ppath_len] = CP_FNAMESEP_CHAR;
+	strcpy(rlpath + ppath_len + 1, plugin->runtime_lib_name);
+	strcpy(rlpath + ppath_len + 1 + lname_len, CP_SHREXT);
+	return rlpath;
 }
 
 /**
@@ -277,7 +1152,6 @@ static void unresolve_plugin_runtime(cp_plugin_t *plugin) {
  */
 static int resolve_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 	char *rlpath = NULL;
-	int rlpath_len;
 	cp_status_t status = CP_OK;
 	
 	assert(plugin->runtime_lib == NULL);
@@ -285,18 +1159,21 @@ static int resolve_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 		return CP_OK;
 	}
 	
+	cpi_trace(context, dlopen_begin, CP_TRACE_DLOPEN_BEGIN, plugin->plugin->identifier, plugin->plugin->runtime_lib_name, CP_OK);
+	cpi_timing_begin(context, plugin->timings.load);
 	do {
-		int ppath_len, lname_len;
 		int cpluff_compatibility = 1;
 	
 		// Check C-Pluff compatibility
 		if (plugin->plugin->req_cpluff_version != NULL) {
+			const cpi_plugin_versions_t *req = cpi_plugin_versions(plugin->plugin);
+			
 #ifdef CP_ABI_COMPATIBILITY
 			cpluff_compatibility = (
-				cpi_vercmp(plugin->plugin->req_cpluff_version, CP_VERSION) <= 0
-			 	&& cpi_vercmp(plugin->plugin->req_cpluff_version, CP_ABI_COMPATIBILITY) >= 0);
+				cpi_version_cmp(&req->req_cpluff_version, &context->env->cpluff_version) <= 0
+			 	&& cpi_version_cmp(&req->req_cpluff_version, &context->env->cpluff_abi_compatibility) >= 0);
 #else
-			cpluff_compatibility = (cpi_vercmp(plugin->plugin->req_cpluff_version, CP_VERSION) == 0);
+			cpluff_compatibility = (cpi_version_cmp(&req->req_cpluff_version, &context->env->cpluff_version) == 0);
 #endif
 		}
 		if (!cpluff_compatibility) {
@@ -314,23 +1191,29 @@ static int resolve_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 			}
 		}
 
+		// Reuse a runtime library retained from an earlier installation
+		if (take_retained_runtime(context->env, plugin)) {
+			if (plugin->prefetched_lib != NULL) {
+				DLCLOSE(plugin->prefetched_lib);
+				plugin->prefetched_lib = NULL;
+			}
+			break;
+		}
+
 		// Construct a path to plug-in runtime library.
-		ppath_len = strlen(plugin->plugin->plugin_path);
-		lname_len = strlen(plugin->plugin->runtime_lib_name);
-		rlpath_len = ppath_len + lname_len + strlen(CP_SHREXT) + 2;
-		if ((rlpath = malloc(rlpath_len * sizeof(char))) == NULL) {
+		if ((rlpath = cpi_runtime_lib_path(plugin->plugin)) == NULL) {
 			cpi_errorf(context, N_("Plug-in %s runtime library could not be loaded due to insufficient memory."), plugin->plugin->identifier);
 			status = CP_ERR_RESOURCE;
 			break;
 		}
-		memset(rlpath, 0, rlpath_len * sizeof(char));
-		strcpy(rlpath, plugin->plugin->plugin_path);
-		rlpath[ppath_len] = CP_FNAMESEP_CHAR;
-		strcpy(rlpath + ppath_len + 1, plugin->plugin->runtime_lib_name);
-		strcpy(rlpath + ppath_len + 1 + lname_len, CP_SHREXT);
 		
-		// Open the plug-in runtime library 
-		plugin->runtime_lib = DLOPEN(rlpath);
+		// Open the plug-in runtime library unless already prefetched
+		if (plugin->prefetched_lib != NULL) {
+			plugin->runtime_lib = plugin->prefetched_lib;
+			plugin->prefetched_lib = NULL;
+		} else {
+			plugin->runtime_lib = DLOPEN(rlpath);
+		}
 		if (plugin->runtime_lib == NULL) {
 			const char *error = DLERROR();
 			if (error == NULL) {
@@ -360,47 +1243,75 @@ static int resolve_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 				break;
 			}
 		}
+		
+		// Register the static symbol export table
+		if (plugin->plugin->runtime_symbols_symbol != NULL) {
+			const cp_symbol_table_t *table;
+			unsigned int i;
+			
+			table = (const cp_symbol_table_t *) DLSYM(plugin->runtime_lib, plugin->plugin->runtime_symbols_symbol);
+			if (table == NULL) {
+				const char *error = DLERROR();
+				if (error == NULL) {
+					error = _("Unspecified error.");
+				}
+				cpi_errorf(context, N_("Plug-in %s symbol %s containing the symbol export table could not be resolved: %s"), plugin->plugin->identifier, plugin->plugin->runtime_symbols_symbol, error);
+				status = CP_ERR_RUNTIME;
+				break;
+			}
+			if (table->version != CP_SYMBOL_TABLE_VERSION) {
+				cpi_errorf(context, N_("Plug-in %s symbol export table has unsupported version %d."), plugin->plugin->identifier, table->version);
+				status = CP_ERR_RUNTIME;
+				break;
+			}
+			for (i = 1; i < table->num_symbols && strcmp(table->symbols[i - 1].name, table->symbols[i].name) < 0; i++);
+			if (i < table->num_symbols) {
+				cpi_errorf(context, N_("Plug-in %s symbol export table is not sorted by unique symbol names."), plugin->plugin->identifier);
+				status = CP_ERR_RUNTIME;
+				break;
+			}
+			plugin->symbol_table = table;
+		}
 
 	} while (0);
 	
+	cpi_timing_end(context, plugin->timings.load, &context->env->timings.load_total);
+	cpi_trace(context, dlopen_end, CP_TRACE_DLOPEN_END, plugin->plugin->identifier, plugin->plugin->runtime_lib_name, status);
+	
 	// Release resources 
-	free(rlpath);
+	cpi_free(rlpath);
 	if (status != CP_OK) {
-		unresolve_plugin_runtime(plugin);
+		unresolve_plugin_runtime(context, plugin, 0);
 	}
 	
 	return status;
 }
 
 /**
- * Resolves the specified plug-in import into a plug-in pointer. Does not
- * try to resolve the imported plug-in.
+ * Resolves the specified plug-in import into a plug-in pointer using the
+ * dependency graph. Does not try to resolve the imported plug-in.
  * 
  * @param context the plug-in context
  * @param plugin the plug-in being resolved
- * @param import the plug-in import to resolve
+ * @param i the index of the plug-in import to resolve
  * @param ipptr filled with pointer to the resolved plug-in or NULL
  * @return CP_OK on success or error code on failure
  */
-static int resolve_plugin_import(cp_context_t *context, cp_plugin_t *plugin, cp_plugin_import_t *import, cp_plugin_t **ipptr) {
-	cp_plugin_t *ip = NULL;
-	hnode_t *node;
+static int resolve_plugin_import(cp_context_t *context, cp_plugin_t *plugin, int i, cp_plugin_t **ipptr) {
+	cp_plugin_import_t *import = plugin->plugin->imports + i;
+	const cpi_version_t *req = cpi_plugin_versions(plugin->plugin)->imports + i;
+	cp_plugin_t *ip = plugin->import_targets[i];
+	const cpi_plugin_versions_t *iv = (ip != NULL ? cpi_plugin_versions(ip->plugin) : NULL);
 
-	// Lookup the plug-in 
-	node = hash_lookup(context->env->plugins, import->plugin_id);
-	if (node != NULL) {
-		ip = hnode_get(node);
-	}
-			
 	// Check plug-in version
 	if (ip != NULL
 		&& import->version != NULL
 		&& (ip->plugin->version == NULL
 			|| (ip->plugin->abi_bw_compatibility == NULL
-				&& cpi_vercmp(import->version, ip->plugin->version) != 0)
+				&& cpi_version_cmp(req, &iv->version) != 0)
 			|| (ip->plugin->abi_bw_compatibility != NULL
-				&& (cpi_vercmp(import->version, ip->plugin->version) > 0
-					|| cpi_vercmp(import->version, ip->plugin->abi_bw_compatibility) < 0)))) {
+				&& (cpi_version_cmp(req, &iv->version) > 0
+					|| cpi_version_cmp(req, &iv->abi_bw_compatibility) < 0)))) {
 		cpi_errorf(context,
 			N_("Plug-in %s could not be resolved due to version incompatibility with plug-in %s."),
 			plugin->plugin->identifier,
@@ -430,12 +1341,12 @@ static int resolve_plugin_import(cp_context_t *context, cp_plugin_t *plugin, cp_
  * 
  * @param context the plug-in context
  * @param plugin the plug-in
+ * @param affected the set of plug-ins processed so far, for committing or cleaning up
  * @return CP_OK (zero) or CP_OK_PRELIMINARY or an error code
  */
-static int resolve_plugin_prel_rec(cp_context_t *context, cp_plugin_t *plugin) {
+static int resolve_plugin_prel_rec(cp_context_t *context, cp_plugin_t *plugin, cpi_plugin_set_t *affected) {
 	cp_status_t status = CP_OK;
 	int error_reported = 0;
-	lnode_t *node = NULL;
 	int i;
 
 	// Check if already resolved
@@ -447,45 +1358,38 @@ static int resolve_plugin_prel_rec(cp_context_t *context, cp_plugin_t *plugin) {
 	if (plugin->processed) {
 		return CP_OK_PRELIMINARY;
 	}
+	if (!plugin_set_append(affected, plugin)) {
+		cpi_errorf(context, N_("Plug-in %s could not be resolved because of insufficient memory."), plugin->plugin->identifier);
+		return CP_ERR_RESOURCE;
+	}
 	plugin->processed = 1;
 
+	cpi_trace(context, resolve_begin, CP_TRACE_RESOLVE_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+	cpi_timing_begin(context, plugin->timings.resolve);
 	do {
 
 		// Recursively resolve the imported plug-ins
-		assert(plugin->imported == NULL);
-		if ((plugin->imported = list_create(LISTCOUNT_T_MAX)) == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
+		assert(plugin->imported.num == 0);
 		for (i = 0; i < plugin->plugin->num_imports; i++) {
 			cp_plugin_t *ip;
 			int s;
 				
-			if ((node = lnode_create(NULL)) == NULL) {
-				status = CP_ERR_RESOURCE;
-				break;
-			}
-			if ((s = resolve_plugin_import(context, plugin, plugin->plugin->imports + i, &ip)) != CP_OK) {
+			if ((s = resolve_plugin_import(context, plugin, i, &ip)) != CP_OK) {
 				error_reported = 1;
 				status = s;
 				break;
 			}
-			if (ip != NULL) {
-				lnode_put(node, ip);
-				list_append(plugin->imported, node);
-				node = NULL;
-				if (!cpi_ptrset_add(ip->importing, plugin)) {
+			if (ip != NULL && !cpi_plugin_set_contains(&plugin->imported, ip)) {
+				if (!plugin_set_append(&plugin->imported, ip)
+					|| !plugin_set_append(&ip->importing, plugin)) {
 					status = CP_ERR_RESOURCE;
 					break;
-				} else if ((s = resolve_plugin_prel_rec(context, ip)) != CP_OK && s != CP_OK_PRELIMINARY) {
+				} else if ((s = resolve_plugin_prel_rec(context, ip, affected)) != CP_OK && s != CP_OK_PRELIMINARY) {
 					cpi_errorf(context, N_("Plug-in %s could not be resolved because it depends on plug-in %s which could not be resolved."), plugin->plugin->identifier, ip->plugin->identifier);
 					error_reported = 1;
 					status = s;
 					break;
 				}
-			} else {
-				lnode_destroy(node);
-				node = NULL;
 			}
 		}
 		if (status != CP_OK) {
@@ -507,89 +1411,77 @@ static int resolve_plugin_prel_rec(cp_context_t *context, cp_plugin_t *plugin) {
 			plugin->processed = 0;
 			event.plugin_id = plugin->plugin->identifier;
 			event.old_state = plugin->state;
-			event.new_state = plugin->state = CP_PLUGIN_RESOLVED;
+			event.new_state = set_plugin_state(plugin, CP_PLUGIN_RESOLVED);
 			cpi_deliver_event(context, &event);
 		}
 
 	} while (0);
 
-	// Clean up
-	if (node != NULL) {
-		lnode_destroy(node);
-	}
-
 	// Handle errors
 	if (status == CP_ERR_RESOURCE && !error_reported) {
 		cpi_errorf(context, N_("Plug-in %s could not be resolved because of insufficient memory."), plugin->plugin->identifier);
 	}
+	cpi_timing_end(context, plugin->timings.resolve, NULL);
+	cpi_trace(context, resolve_end, CP_TRACE_RESOLVE_END, plugin->plugin->identifier, NULL, status);
 	
 	return status;
 }
 
 /**
- * Recursively commits the resolving process for the specified plug-in and
- * its dependencies.
+ * Commits the resolving process for the plug-ins processed by
+ * ::resolve_plugin_prel_rec.
  * 
  * @param context the plug-in context
- * @param plugin the plug-in
+ * @param affected the processed plug-ins
  */
-static void resolve_plugin_commit_rec(cp_context_t *context, cp_plugin_t *plugin) {
-	
-	// Check if already committed
-	if (!plugin->processed) {
-		return;
-	}
-	plugin->processed = 0;
+static void resolve_plugin_commit(cp_context_t *context, cpi_plugin_set_t *affected) {
+	int i;
 	
-	// Commit if only preliminarily resolved
-	if (plugin->state < CP_PLUGIN_RESOLVED) {
+	// Commit dependencies first, they were processed after their importers
+	for (i = affected->num - 1; i >= 0; i--) {
+		cp_plugin_t *plugin = affected->plugins[i];
+		
+		if (!plugin->processed) {
+			continue;
+		}
+		plugin->processed = 0;
+		
+		// Notify event listeners and update state if only preliminarily resolved
+		if (plugin->state < CP_PLUGIN_RESOLVED) {
 			cpi_plugin_event_t event;
-			lnode_t *node;
-
-			// Recursively commit dependencies
-			node = list_first(plugin->imported);
-			while (node != NULL) {
-				resolve_plugin_commit_rec(context, (cp_plugin_t *) lnode_get(node));
-				node = list_next(plugin->imported, node);
-			}
 			
-			// Notify event listeners and update state
 			event.plugin_id = plugin->plugin->identifier;
 			event.old_state = plugin->state;
-			event.new_state = plugin->state = CP_PLUGIN_RESOLVED;
+			event.new_state = set_plugin_state(plugin, CP_PLUGIN_RESOLVED);
 			cpi_deliver_event(context, &event);		
+		}
 	}
 }
 
 /**
- * Recursively cleans up the specified plug-in and its dependencies after
- * a failed resolving attempt.
+ * Cleans up the plug-ins processed by ::resolve_plugin_prel_rec after a
+ * failed resolving attempt.
  * 
- * @param plugin the plug-in
+ * @param affected the processed plug-ins
  */
-static void resolve_plugin_failed_rec(cp_plugin_t *plugin) {
-	
-	// Check if already cleaned up
-	if (!plugin->processed) {
-		return;
-	}
-	plugin->processed = 0;
+static void resolve_plugin_failed(cpi_plugin_set_t *affected) {
+	int i, j;
 	
-	// Clean up if only preliminarily resolved
-	if (plugin->state < CP_PLUGIN_RESOLVED) {
-		lnode_t *node;
-
-		// Recursively clean up depedencies
-		while ((node = list_first(plugin->imported)) != NULL) {
-			cp_plugin_t *ip = lnode_get(node);
-			
-			resolve_plugin_failed_rec(ip);
-			cpi_ptrset_remove(ip->importing, plugin);
-			list_delete(plugin->imported, node);
-			lnode_destroy(node);
+	for (i = 0; i < affected->num; i++) {
+		cp_plugin_t *plugin = affected->plugins[i];
+		
+		if (!plugin->processed) {
+			continue;
+		}
+		plugin->processed = 0;
+		
+		// Clean up if only preliminarily resolved
+		if (plugin->state < CP_PLUGIN_RESOLVED) {
+			for (j = 0; j < plugin->imported.num; j++) {
+				cpi_plugin_set_remove(&plugin->imported.plugins[j]->importing, plugin);
+			}
+			cpi_plugin_set_clear(&plugin->imported);
 		}
-		list_destroy(plugin->imported);
-		plugin->imported = NULL;
 	}
 }
 
@@ -601,15 +1493,28 @@ static void resolve_plugin_failed_rec(cp_plugin_t *plugin) {
  * @return CP_OK (zero) on success or an error code on failure
  */
 static int resolve_plugin(cp_context_t *context, cp_plugin_t *plugin) {
+	cpi_plugin_set_t affected = { NULL, 0, 0 };
 	cp_status_t status;
+	cp_timing_t timing = { 0, 0 };
 	
-	if ((status = resolve_plugin_prel_rec(context, plugin)) == CP_OK || status == CP_OK_PRELIMINARY) {
+	cpi_timing_begin(context, timing);
+	if ((status = resolve_plugin_prel_rec(context, plugin, &affected)) == CP_OK || status == CP_OK_PRELIMINARY) {
 		status = CP_OK;
-		resolve_plugin_commit_rec(context, plugin);
+		resolve_plugin_commit(context, &affected);
 	} else {
-		resolve_plugin_failed_rec(plugin);
+		resolve_plugin_failed(&affected);
 	}
-	assert_processed_zero(context);
+#ifndef NDEBUG
+	{
+		int i;
+		
+		for (i = 0; i < affected.num; i++) {
+			assert(affected.plugins[i]->processed == 0);
+		}
+	}
+#endif
+	cpi_plugin_set_clear(&affected);
+	cpi_timing_end(context, timing, &context->env->timings.resolve_total);
 	return status;
 }
 
@@ -620,19 +1525,19 @@ static int resolve_plugin(cp_context_t *context, cp_plugin_t *plugin) {
  * 
  * @param context the plug-in context
  * @param plugin the plug-in
+ * @param unlocked whether to release the context lock while calling the start function even if not the sole lifecycle lock holder
  * @return CP_OK (zero) on success or an error code on failure
  */
-static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
+static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin, int unlocked) {
 	cp_status_t status = CP_OK;
 	cpi_plugin_event_t event;
-	lnode_t *node = NULL;
+	cpi_invocation_t inv;
 
 	event.plugin_id = plugin->plugin->identifier;
 	do {
 
-		// Allocate space for the list node 
-		node = lnode_create(plugin);
-		if (node == NULL) {
+		// Reserve space in the list of started plug-ins 
+		if (!plugin_set_reserve(&(context->env->started_plugins), context->env->started_plugins.num + 1)) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -645,9 +1550,13 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 				if ((plugin->context = cpi_new_context(plugin, context->env, &status)) == NULL) {
 					break;
 				}
-				context->env->in_create_func_invocation++;
+				cpi_trace(context, create_begin, CP_TRACE_CREATE_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+				cpi_begin_invocation(context->env, &inv, CPI_CF_CREATE);
+				cpi_timing_begin(context, plugin->timings.create);
 				plugin->plugin_data = plugin->runtime_funcs->create(plugin->context);
-				context->env->in_create_func_invocation--;
+				cpi_timing_end(context, plugin->timings.create, &context->env->timings.create_total);
+				cpi_end_invocation(&inv);
+				cpi_trace(context, create_end, CP_TRACE_CREATE_END, plugin->plugin->identifier, NULL, plugin->plugin_data != NULL ? CP_OK : CP_ERR_RUNTIME);
 				if (plugin->plugin_data == NULL) {
 					status = CP_ERR_RUNTIME;
 					break;
@@ -660,13 +1569,24 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 			
 				// About to start the plug-in 
 				event.old_state = plugin->state;
-				event.new_state = plugin->state = CP_PLUGIN_STARTING;
+				event.new_state = set_plugin_state(plugin, CP_PLUGIN_STARTING);
 				cpi_deliver_event(context, &event);
 		
-				// Start the plug-in
-				context->env->in_start_func_invocation++;
+				// Start the plug-in, letting unrelated API calls proceed
+				unlocked = unlocked || cpi_is_sole_lifecycle_holder(context);
+				cpi_trace(context, start_begin, CP_TRACE_START_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+				cpi_begin_invocation(context->env, &inv, CPI_CF_START);
+				cpi_timing_begin(context, plugin->timings.start);
+				if (unlocked) {
+					cpi_unlock_context(context);
+				}
 				s = plugin->runtime_funcs->start(plugin->plugin_data);
-				context->env->in_start_func_invocation--;
+				if (unlocked) {
+					cpi_lock_context(context);
+				}
+				cpi_timing_end(context, plugin->timings.start, &context->env->timings.start_total);
+				cpi_end_invocation(&inv);
+				cpi_trace(context, start_end, CP_TRACE_START_END, plugin->plugin->identifier, NULL, s == CP_OK ? CP_OK : CP_ERR_RUNTIME);
 
 				if (s != CP_OK) {
 			
@@ -675,19 +1595,23 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 
 						// Update state					
 						event.old_state = plugin->state;
-						event.new_state = plugin->state = CP_PLUGIN_STOPPING;
+						event.new_state = set_plugin_state(plugin, CP_PLUGIN_STOPPING);
 						cpi_deliver_event(context, &event);
 					
 						// Call stop function
-						context->env->in_stop_func_invocation++;
+						cpi_trace(context, stop_begin, CP_TRACE_STOP_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+						cpi_begin_invocation(context->env, &inv, CPI_CF_STOP);
 						plugin->runtime_funcs->stop(plugin->plugin_data);
-						context->env->in_stop_func_invocation--;
+						cpi_end_invocation(&inv);
+						cpi_trace(context, stop_end, CP_TRACE_STOP_END, plugin->plugin->identifier, NULL, CP_OK);
 					}
 				
 					// Destroy plug-in object
-					context->env->in_destroy_func_invocation++;
+					cpi_trace(context, destroy_begin, CP_TRACE_DESTROY_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+					cpi_begin_invocation(context->env, &inv, CPI_CF_DESTROY);
 					plugin->runtime_funcs->destroy(plugin->plugin_data);
-					context->env->in_destroy_func_invocation--;
+					cpi_end_invocation(&inv);
+					cpi_trace(context, destroy_end, CP_TRACE_DESTROY_END, plugin->plugin->identifier, NULL, CP_OK);
 			
 					status = CP_ERR_RUNTIME;
 					break;
@@ -696,25 +1620,22 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 		}
 		
 		// Plug-in active 
-		list_append(context->env->started_plugins, node);
+		plugin_set_append(&(context->env->started_plugins), plugin);
 		event.old_state = plugin->state;
-		event.new_state = plugin->state = CP_PLUGIN_ACTIVE;
+		event.new_state = set_plugin_state(plugin, CP_PLUGIN_ACTIVE);
 		cpi_deliver_event(context, &event);
 		
 	} while (0);
 
 	// Release resources and roll back plug-in state on failure
 	if (status != CP_OK) {
-		if (node != NULL) {
-			lnode_destroy(node);
-		}
 		if (plugin->context != NULL) {
 			cpi_free_context(plugin->context);
 			plugin->context = NULL;
 		}
 		if (plugin->state != CP_PLUGIN_RESOLVED) {
 			event.old_state = plugin->state;
-			event.new_state = plugin->state = CP_PLUGIN_RESOLVED;
+			event.new_state = set_plugin_state(plugin, CP_PLUGIN_RESOLVED);
 			cpi_deliver_event(context, &event);
 		}
 		plugin->plugin_data = NULL;
@@ -739,11 +1660,11 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 	return status;
 }
 
-static void warn_dependency_loop(cp_context_t *context, cp_plugin_t *plugin, list_t *importing, int dynamic) {
+static void warn_dependency_loop(cp_context_t *context, cp_plugin_t *plugin, cpi_plugin_set_t *importing, int dynamic) {
 	char *msgbase;
 	char *msg;
 	int msgsize;
-	lnode_t *node;
+	int i;
 	
 	// Take the message base
 	if (dynamic) {
@@ -756,48 +1677,50 @@ static void warn_dependency_loop(cp_context_t *context, cp_plugin_t *plugin, lis
 	msgsize = 0;
 	msgsize += strlen(plugin->plugin->identifier);
 	msgsize += 2;
-	node = list_last(importing);
-	while (node != NULL) {
-		cp_plugin_t *p = lnode_get(node);
-		if (p == plugin) {
-			break;
-		}
-		msgsize += strlen(p->plugin->identifier);
+	for (i = importing->num - 1; i >= 0 && importing->plugins[i] != plugin; i--) {
+		msgsize += strlen(importing->plugins[i]->plugin->identifier);
 		msgsize += 2;
-		node = list_prev(importing, node);
 	}
-	msg = malloc(sizeof(char) * msgsize);
+	msg = cpi_malloc(sizeof(char) * msgsize);
 	if (msg != NULL) {
 		strcpy(msg, plugin->plugin->identifier);
-		node = list_last(importing);
-		while (node != NULL) {
-			cp_plugin_t *p = lnode_get(node);
-			if (p == plugin) {
-				break;
-			}
+		for (i = importing->num - 1; i >= 0 && importing->plugins[i] != plugin; i--) {
 			strcat(msg, ", ");
-			strcat(msg, p->plugin->identifier);
-			node = list_prev(importing, node);
+			strcat(msg, importing->plugins[i]->plugin->identifier);
 		}
 		strcat(msg, ".");
 		cpi_infof(context, msgbase, msg);
-		free(msg);
+		cpi_free(msg);
 	} else {
 		cpi_infof(context, msgbase, plugin->plugin->identifier);
 	}
 }
 
 /**
- * Starts the specified plug-in and its dependencies.
+ * Returns whether the specified plug-in is activated lazily, that is only
+ * when explicitly requested or on first symbol resolution.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in
+ * @return non-zero if the plug-in is activated lazily
+ */
+static int is_lazy_plugin(cp_context_t *context, cp_plugin_t *plugin) {
+	return context->env->lazy_activation || plugin->plugin->lazy_activation;
+}
+
+/**
+ * Starts the specified plug-in and its dependencies, except lazily
+ * activated ones. The plug-ins on the
+ * stack of importing plug-ins are marked processed.
  * 
  * @param context the plug-in context
  * @param plugin the plug-in
  * @param importing stack of importing plug-ins
  * @return CP_OK (zero) on success or an error code on failure
  */
-static int start_plugin_rec(cp_context_t *context, cp_plugin_t *plugin, list_t *importing) {
+static int start_plugin_rec(cp_context_t *context, cp_plugin_t *plugin, cpi_plugin_set_t *importing) {
 	cp_status_t status = CP_OK;
-	lnode_t *node;
+	int i;
 	
 	// Check if already started or starting
 	if (plugin->state == CP_PLUGIN_ACTIVE) {
@@ -809,32 +1732,33 @@ static int start_plugin_rec(cp_context_t *context, cp_plugin_t *plugin, list_t *
 	assert(plugin->state == CP_PLUGIN_RESOLVED);
 	
 	// Check for dependency loops
-	if (cpi_ptrset_contains(importing, plugin)) {
+	if (plugin->processed) {
 		warn_dependency_loop(context, plugin, importing, 0);
 		return CP_OK;
 	}
-	if (!cpi_ptrset_add(importing, plugin)) {
+	if (!plugin_set_append(importing, plugin)) {
 		cpi_errorf(context,
 			N_("Plug-in %s could not be started due to insufficient memory."),
 			plugin->plugin->identifier);
 		return CP_ERR_RESOURCE;
 	}
+	plugin->processed = 1;
 
-	// Start up dependencies
-	node = list_first(plugin->imported);
-	while (node != NULL) {
-		cp_plugin_t *ip = lnode_get(node);
-		
-		if ((status = start_plugin_rec(context, ip, importing)) != CP_OK) {
+	// Start up dependencies, leaving lazy ones resolved until first use
+	for (i = 0; i < plugin->imported.num; i++) {
+		if (is_lazy_plugin(context, plugin->imported.plugins[i])) {
+			continue;
+		}
+		if ((status = start_plugin_rec(context, plugin->imported.plugins[i], importing)) != CP_OK) {
 			break;
 		}
-		node = list_next(plugin->imported, node);
 	}
-	cpi_ptrset_remove(importing, plugin);
+	plugin->processed = 0;
+	importing->num--;
 	
 	// Start up this plug-in
 	if (status == CP_OK) {
-		status = start_plugin_runtime(context, plugin);
+		status = start_plugin_runtime(context, plugin, 0);
 	}
 
 	return status;
@@ -844,24 +1768,19 @@ CP_HIDDEN cp_status_t cpi_start_plugin(cp_context_t *context, cp_plugin_t *plugi
 	cp_status_t status;
 	
 	if ((status = resolve_plugin(context, plugin)) == CP_OK) {
-		list_t *importing = list_create(LISTCOUNT_T_MAX);
-		if (importing != NULL) {
-			status = start_plugin_rec(context, plugin, importing);
-			assert(list_isempty(importing));
-			list_destroy(importing);
-		} else {
-			cpi_errorf(context,
-				N_("Plug-in %s could not be started due to insufficient memory."),
-				plugin->plugin->identifier);
-			status = CP_ERR_RESOURCE;
-		}
+		cpi_plugin_set_t importing = { NULL, 0, 0 };
+		
+		status = start_plugin_rec(context, plugin, &importing);
+		assert(importing.num == 0);
+		cpi_plugin_set_clear(&importing);
 	}
 	return status;
 }
 
 CP_C_API cp_status_t cp_start_plugin(cp_context_t *context, const char *id) {
-	hnode_t *node;
+	cp_plugin_t *plugin;
 	cp_status_t status = CP_OK;
+	cpi_invocation_t lifecycle;
 
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(id);
@@ -869,13 +1788,15 @@ CP_C_API cp_status_t cp_start_plugin(cp_context_t *context, const char *id) {
 	// Look up and start the plug-in 
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
-	node = hash_lookup(context->env->plugins, id);
-	if (node != NULL) {
-		status = cpi_start_plugin(context, hnode_get(node));
+	cpi_begin_lifecycle(context, &lifecycle);
+	plugin = cpi_hmap_get(context->env->plugins, id);
+	if (plugin != NULL) {
+		status = cpi_start_plugin(context, plugin);
 	} else {
 		cpi_warnf(context, N_("Unknown plug-in %s could not be started."), id);
 		status = CP_ERR_UNKNOWN;
 	}
+	cpi_end_lifecycle(context, &lifecycle);
 	cpi_unlock_context(context);
 
 	return status;
@@ -887,14 +1808,21 @@ CP_C_API cp_status_t cp_start_plugin(cp_context_t *context, const char *id) {
  * 
  * @param context the plug-in context
  * @param plugin the plug-in
+ * @param unlocked whether to release the context lock while calling the stop function even if not the sole lifecycle lock holder
  */
-static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
+static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin, int unlocked) {
 	cpi_plugin_event_t event;
+	cpi_invocation_t inv;
 	
 	// Destroy plug-in instance
 	event.plugin_id = plugin->plugin->identifier;
 	if (plugin->context != NULL) {
 	
+#ifdef CP_SYMBOL_CACHE
+		// Stop serving symbols of this plug-in from symbol caches
+		cpi_invalidate_symbol_caches(context);
+#endif
+
 		// Wait until possible run functions have stopped
 		cpi_stop_plugin_run(plugin);
 
@@ -903,23 +1831,42 @@ static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 
 			// About to stop the plug-in 
 			event.old_state = plugin->state;
-			event.new_state = plugin->state = CP_PLUGIN_STOPPING;
+			event.new_state = set_plugin_state(plugin, CP_PLUGIN_STOPPING);
 			cpi_deliver_event(context, &event);
 	
-			// Invoke stop function	
-			context->env->in_stop_func_invocation++;
+			// Invoke stop function, letting unrelated API calls proceed
+			unlocked = unlocked || cpi_is_sole_lifecycle_holder(context);
+			cpi_trace(context, stop_begin, CP_TRACE_STOP_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+			cpi_begin_invocation(context->env, &inv, CPI_CF_STOP);
+			if (unlocked) {
+				cpi_unlock_context(context);
+			}
 			plugin->runtime_funcs->stop(plugin->plugin_data);
-			context->env->in_stop_func_invocation--;
+			if (unlocked) {
+				cpi_lock_context(context);
+			}
+			cpi_end_invocation(&inv);
+			cpi_trace(context, stop_end, CP_TRACE_STOP_END, plugin->plugin->identifier, NULL, CP_OK);
 
 		}
 
 		// Unregister all logger functions
-		cpi_unregister_loggers(plugin->context->env->loggers, plugin);
+		cpi_unregister_loggers(plugin->context->env, plugin);
+		cpi_loggers_changed(plugin->context);
 
 		// Unregister all plug-in listeners
-		cpi_unregister_plisteners(plugin->context->env->plugin_listeners, plugin);	
+		cpi_unregister_plisteners(&(plugin->context->env->plugin_listeners), plugin);
+		cpi_unregister_indexed_plisteners(plugin->context->env->plugin_listener_index, plugin);
+		cpi_unregister_batch_plisteners(plugin->context, plugin);
+
+		// Unregister all streaming configuration consumers and schemas
+		cpi_unregister_cfg_streams(plugin->context->env, plugin);
+		cpi_unregister_cfg_schemas(plugin->context->env, plugin);
 
 		// Release resolved symbols
+#ifdef CP_SYMBOL_CACHE
+		cpi_clear_symbol_cache(plugin->context);
+#endif
 		if (plugin->context->resolved_symbols != NULL) {
 			while (!hash_isempty(plugin->context->resolved_symbols)) {
 				hscan_t scan;
@@ -933,116 +1880,826 @@ static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 			}
 			assert(hash_isempty(plugin->context->resolved_symbols));
 		}
-		if (plugin->context->symbol_providers != NULL) {
-			assert(hash_isempty(plugin->context->symbol_providers));
+		if (plugin->context->symbol_providers != NULL) {
+			assert(hash_isempty(plugin->context->symbol_providers));
+		}
+
+		// Release defined symbols
+		if (plugin->defined_symbols != NULL) {
+			hscan_t scan;
+			hnode_t *node;
+			
+			hash_scan_begin(&scan, plugin->defined_symbols);
+			while ((node = hash_scan_next(&scan)) != NULL) {
+				hash_scan_delfree(plugin->defined_symbols, node);
+			}
+			hash_destroy(plugin->defined_symbols);
+			plugin->defined_symbols = NULL;
+		}
+		
+	}
+	
+	// Plug-in stopped 
+	cpi_plugin_set_remove(&(context->env->started_plugins), plugin);
+	event.old_state = plugin->state;
+	event.new_state = set_plugin_state(plugin, CP_PLUGIN_RESOLVED);
+	cpi_deliver_event(context, &event);
+}
+
+/**
+ * Stops the plug-in and all plug-ins depending on it.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in
+ */
+static void stop_plugin_rec(cp_context_t *context, cp_plugin_t *plugin) {
+	int i;
+	
+	// Check if already stopped
+	if (plugin->state < CP_PLUGIN_ACTIVE) {
+		return;
+	}
+	
+	// Check for dependency loops
+	if (plugin->processed) {
+		return;
+	}
+	plugin->processed = 1;
+	
+	// Stop the depending plug-ins, rescanning the set because stopping a
+	// plug-in removes its dynamic dependencies from the set
+	for (i = 0; i < plugin->importing.num; i++) {
+		cp_plugin_t *ip = plugin->importing.plugins[i];
+		
+		if (ip->state == CP_PLUGIN_ACTIVE && !ip->processed) {
+			stop_plugin_rec(context, ip);
+			i = -1;
+		}
+	}
+
+	// Stop this plug-in
+	assert(plugin->state == CP_PLUGIN_ACTIVE);
+	stop_plugin_runtime(context, plugin, 0);
+	assert(plugin->state < CP_PLUGIN_ACTIVE);
+	
+	// Clear processed flag
+	plugin->processed = 0;
+}
+
+static void stop_plugin(cp_context_t *context, cp_plugin_t *plugin) {
+	stop_plugin_rec(context, plugin);
+	assert_processed_zero(context);
+}
+
+CP_C_API cp_status_t cp_stop_plugin(cp_context_t *context, const char *id) {
+	cp_plugin_t *plugin;
+	cp_status_t status = CP_OK;
+	cpi_invocation_t lifecycle;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+
+	// Look up and stop the plug-in 
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_begin_lifecycle(context, &lifecycle);
+	plugin = cpi_hmap_get(context->env->plugins, id);
+	if (plugin != NULL) {
+		stop_plugin(context, plugin);
+	} else {
+		cpi_warnf(context, N_("Unknown plug-in %s could not be stopped."), id);
+		status = CP_ERR_UNKNOWN;
+	}
+	cpi_end_lifecycle(context, &lifecycle);
+	cpi_unlock_context(context);
+
+	return status;
+}
+
+CP_C_API void cp_stop_plugins(cp_context_t *context) {
+	cpi_plugin_set_t *started;
+	cpi_invocation_t lifecycle;
+	
+	CHECK_NOT_NULL(context);
+	
+	// Stop the active plug-ins in the reverse order they were started 
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_begin_lifecycle(context, &lifecycle);
+	started = &(context->env->started_plugins);
+	while (started->num > 0) {
+		stop_plugin(context, started->plugins[started->num - 1]);
+	}
+	cpi_end_lifecycle(context, &lifecycle);
+	cpi_unlock_context(context);
+}
+
+// Asynchronous plug-in start and stop
+
+/**
+ * Executes an asynchronous start or stop request, reports the result to
+ * the completion callback and releases the request. The context lock is
+ * released while invoking the callback. The caller must have locked the
+ * context exactly once.
+ * 
+ * @param context the plug-in context
+ * @param op the request
+ */
+static void run_async_op(cp_context_t *context, async_op_t *op) {
+	cp_plugin_t *plugin;
+	cpi_invocation_t lifecycle;
+	cp_status_t status = CP_OK;
+	
+	assert(cpi_is_context_locked(context));
+	cpi_begin_lifecycle(context, &lifecycle);
+	if ((plugin = cpi_hmap_get(context->env->plugins, op->plugin_id)) != NULL) {
+		if (op->stop) {
+			stop_plugin(context, plugin);
+		} else {
+			status = cpi_start_plugin(context, plugin);
+		}
+	} else {
+		if (op->stop) {
+			cpi_warnf(context, N_("Unknown plug-in %s could not be stopped."), op->plugin_id);
+		} else {
+			cpi_warnf(context, N_("Unknown plug-in %s could not be started."), op->plugin_id);
+		}
+		status = CP_ERR_UNKNOWN;
+	}
+	cpi_end_lifecycle(context, &lifecycle);
+	if (op->callback != NULL) {
+		cpi_unlock_context(context);
+		op->callback(op->plugin_id, status, op->user_data);
+		cpi_lock_context(context);
+	}
+	cpi_free(op->plugin_id);
+	cpi_free(op);
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Asynchronous plug-in control worker main function. Executes the queued
+ * requests until the worker is shut down and the queue is empty.
+ * 
+ * @param arg the plug-in context
+ */
+static void async_thread(void *arg) {
+	cp_context_t *context = arg;
+	
+	cpi_lock_context(context);
+	for (;;) {
+		if (!list_isempty(context->env->async_ops)) {
+			lnode_t *node = list_del_first(context->env->async_ops);
+			async_op_t *op = lnode_get(node);
+			
+			lnode_destroy(node);
+			run_async_op(context, op);
+		} else if (context->env->async_shutdown) {
+			break;
+		} else {
+			cpi_wait_context(context);
+		}
+	}
+	cpi_unlock_context(context);
+}
+
+CP_HIDDEN void cpi_stop_async_control(cp_context_t *context) {
+	cpi_thread_t *thread;
+	
+	cpi_lock_context(context);
+	thread = context->env->async_thread;
+	context->env->async_thread = NULL;
+	context->env->async_shutdown = 1;
+	cpi_signal_context(context);
+	cpi_unlock_context(context);
+	if (thread != NULL) {
+		cpi_join_thread(thread);
+	}
+	cpi_lock_context(context);
+	context->env->async_shutdown = 0;
+	cpi_unlock_context(context);
+}
+
+#endif
+
+/**
+ * Queues an asynchronous plug-in start or stop request. The request is
+ * executed in the calling thread if there is no multi-threading support
+ * or if the worker thread can not be created.
+ * 
+ * @param context the plug-in context
+ * @param id identifier of the plug-in
+ * @param stop whether the plug-in is to be stopped rather than started
+ * @param callback the completion callback or NULL
+ * @param user_data the user data pointer for the callback
+ * @param func the name of the calling API function
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if out of resources
+ */
+static cp_status_t queue_async_op(cp_context_t *context, const char *id, int stop, cp_plugin_op_func_t callback, void *user_data, const char *func) {
+	async_op_t *op = NULL;
+	cp_status_t status = CP_OK;
+	
+	if (context->plugin != NULL) {
+		cpi_fatalf(_("Only the main program can call %s."), func);
+	}
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, func);
+	do {
+#ifdef CP_THREADS
+		lnode_t *node;
+#endif
+		
+		// Allocate the request
+		if ((op = cpi_malloc(sizeof(async_op_t))) == NULL
+			|| (op->plugin_id = cpi_strdup(id)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		op->stop = stop;
+		op->callback = callback;
+		op->user_data = user_data;
+		
+#ifdef CP_THREADS
+		// Start the worker on first use and pass the request to it
+		if (context->env->async_thread == NULL) {
+			context->env->async_thread = cpi_create_thread(async_thread, context);
+		}
+		if (context->env->async_thread != NULL) {
+			if ((node = lnode_create(op)) == NULL) {
+				cpi_free(op->plugin_id);
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			list_append(context->env->async_ops, node);
+			cpi_signal_context(context);
+			op = NULL;
+			break;
+		}
+#endif
+		
+		// Otherwise execute the request in the calling thread
+		run_async_op(context, op);
+		op = NULL;
+		
+	} while (0);
+	
+	// Report error
+	if (status == CP_ERR_RESOURCE) {
+		if (stop) {
+			cpi_errorf(context, N_("Plug-in %s could not be stopped due to insufficient memory."), id);
+		} else {
+			cpi_errorf(context, N_("Plug-in %s could not be started due to insufficient memory."), id);
+		}
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources on error
+	cpi_free(op);
+	
+	return status;
+}
+
+CP_C_API cp_status_t cp_start_plugin_async(cp_context_t *context, const char *id, cp_plugin_op_func_t callback, void *user_data) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+	return queue_async_op(context, id, 0, callback, user_data, __func__);
+}
+
+CP_C_API cp_status_t cp_stop_plugin_async(cp_context_t *context, const char *id, cp_plugin_op_func_t callback, void *user_data) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+	return queue_async_op(context, id, 1, callback, user_data, __func__);
+}
+
+// Parallel plug-in start and stop
+
+/**
+ * Returns the job entry of the specified plug-in or NULL if the plug-in
+ * does not take part in the job.
+ * 
+ * @param job the job
+ * @param plugin the plug-in
+ * @return the entry or NULL
+ */
+static pjob_entry_t *pjob_entry(pjob_t *job, cp_plugin_t *plugin) {
+	hnode_t *node;
+	
+	if ((node = hash_lookup(job->entry_map, plugin)) != NULL) {
+		return hnode_get(node);
+	}
+	return NULL;
+}
+
+/**
+ * Returns the plug-ins which must be processed after the specified
+ * plug-in: the importing plug-ins when starting and the imported plug-ins
+ * when stopping.
+ * 
+ * @param job the job
+ * @param plugin the plug-in
+ * @return the set of plug-ins
+ */
+static cpi_plugin_set_t *pjob_dependents(pjob_t *job, cp_plugin_t *plugin) {
+	return job->stop ? &plugin->imported : &plugin->importing;
+}
+
+/**
+ * Returns the plug-ins which must be processed before the specified
+ * plug-in: the imported plug-ins when starting and the importing plug-ins
+ * when stopping.
+ * 
+ * @param job the job
+ * @param plugin the plug-in
+ * @return the set of plug-ins
+ */
+static cpi_plugin_set_t *pjob_prerequisites(pjob_t *job, cp_plugin_t *plugin) {
+	return job->stop ? &plugin->importing : &plugin->imported;
+}
+
+/**
+ * Adds the specified plug-in to the job unless already included.
+ * 
+ * @param job the job
+ * @param plugin the plug-in
+ * @return @ref CP_OK or @ref CP_ERR_RESOURCE
+ */
+static cp_status_t pjob_add(pjob_t *job, cp_plugin_t *plugin) {
+	pjob_entry_t *e;
+	
+	if (pjob_entry(job, plugin) != NULL) {
+		return CP_OK;
+	}
+	e = job->entries + job->num_entries;
+	if (!hash_alloc_insert(job->entry_map, plugin, e)) {
+		return CP_ERR_RESOURCE;
+	}
+	memset(e, 0, sizeof(pjob_entry_t));
+	e->plugin = plugin;
+	job->num_entries++;
+	job->num_left++;
+	
+	// Starting also includes the eager imported plug-ins not yet started
+	if (!job->stop) {
+		int i;
+		
+		for (i = 0; i < plugin->imported.num; i++) {
+			cp_plugin_t *ip = plugin->imported.plugins[i];
+			cp_status_t status;
+			
+			if (ip->state == CP_PLUGIN_RESOLVED
+				&& !is_lazy_plugin(job->context, ip)
+				&& (status = pjob_add(job, ip)) != CP_OK) {
+				return status;
+			}
+		}
+	}
+	return CP_OK;
+}
+
+/**
+ * Counts the prerequisites of each plug-in and queues the plug-ins that
+ * do not have to wait for others.
+ * 
+ * @param job the job
+ */
+static void pjob_init_queue(pjob_t *job) {
+	int i;
+	
+	for (i = 0; i < job->num_entries; i++) {
+		pjob_entry_t *e = job->entries + i;
+		cpi_plugin_set_t *prereqs = pjob_prerequisites(job, e->plugin);
+		int j;
+		
+		for (j = 0; j < prereqs->num; j++) {
+			if (pjob_entry(job, prereqs->plugins[j]) != NULL) {
+				e->waiting++;
+			}
+		}
+		if (e->waiting == 0) {
+			e->queued = 1;
+			job->ready[job->ready_tail++] = e;
+		}
+	}
+}
+
+/**
+ * Marks the specified plug-in processed and releases or, on failure,
+ * cancels the plug-ins waiting for it.
+ * 
+ * @param job the job
+ * @param e the processed or cancelled entry
+ * @param ok whether the plug-in was processed successfully
+ */
+static void pjob_finish(pjob_t *job, pjob_entry_t *e, int ok) {
+	cpi_plugin_set_t *deps = pjob_dependents(job, e->plugin);
+	int i;
+	
+	e->done = 1;
+	job->num_left--;
+	for (i = 0; i < deps->num; i++) {
+		pjob_entry_t *de = pjob_entry(job, deps->plugins[i]);
+		
+		if (de == NULL || de->queued || de->done) {
+			continue;
+		}
+		if (ok) {
+			if (--de->waiting == 0) {
+				de->queued = 1;
+				job->ready[job->ready_tail++] = de;
+			}
+		} else {
+			pjob_finish(job, de, 0);
+		}
+	}
+}
+
+/**
+ * Returns a waiting plug-in which is part of a dependency loop. This must
+ * only be called when no plug-in is ready or being processed, in which
+ * case every waiting plug-in waits for another waiting plug-in.
+ * 
+ * @param job the job
+ * @return a waiting plug-in within a dependency loop
+ */
+static pjob_entry_t *pjob_loop_entry(pjob_t *job) {
+	pjob_entry_t *e;
+	int i;
+	
+	for (i = 0; i < job->num_entries; i++) {
+		job->entries[i].visited = 0;
+	}
+	
+	// Follow waiting prerequisites until a plug-in is visited again
+	for (e = job->entries; e->queued || e->done; e++);
+	while (!e->visited) {
+		cpi_plugin_set_t *prereqs = pjob_prerequisites(job, e->plugin);
+		pjob_entry_t *next = NULL;
+		int i;
+		
+		e->visited = 1;
+		for (i = 0; i < prereqs->num && next == NULL; i++) {
+			pjob_entry_t *pe = pjob_entry(job, prereqs->plugins[i]);
+			
+			if (pe != NULL && !pe->queued && !pe->done) {
+				next = pe;
+			}
+		}
+		assert(next != NULL);
+		e = next;
+	}
+	return e;
+}
+
+/**
+ * Processes queued plug-ins until all plug-ins of the job have been
+ * processed. The caller must have locked the context.
+ * 
+ * @param job the job
+ */
+static void pjob_run(pjob_t *job) {
+	cp_context_t *context = job->context;
+	
+	assert(cpi_is_context_locked(context));
+	while (job->num_left > 0) {
+		pjob_entry_t *e;
+		int ok = 1;
+		
+		// Wait for a plug-in to become ready
+		if (job->ready_head == job->ready_tail) {
+			if (job->num_running > 0) {
+				cpi_wait_context(context);
+				continue;
+			}
+			
+			// Break a dependency loop
+			e = pjob_loop_entry(job);
+			cpi_infof(context, N_("Detected a static plug-in dependency loop: %s"), e->plugin->plugin->identifier);
+			e->queued = 1;
+			job->ready[job->ready_tail++] = e;
+		}
+		e = job->ready[job->ready_head++];
+		
+		// Start or stop the plug-in
+		job->num_running++;
+		if (job->stop) {
+			if (e->plugin->state == CP_PLUGIN_ACTIVE) {
+				stop_plugin_runtime(context, e->plugin, job->unlocked);
+			}
+		} else if (e->plugin->state == CP_PLUGIN_RESOLVED) {
+			cp_status_t status;
+			
+			if ((status = start_plugin_runtime(context, e->plugin, job->unlocked)) != CP_OK) {
+				if (job->status == CP_OK) {
+					job->status = status;
+				}
+				ok = 0;
+			}
+		}
+		job->num_running--;
+		pjob_finish(job, e, ok);
+		cpi_signal_context(context);
+	}
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Helper thread main function for parallel start and stop.
+ * 
+ * @param arg the job
+ */
+static void pjob_thread(void *arg) {
+	pjob_t *job = arg;
+	
+	cpi_lock_context(job->context);
+	pjob_run(job);
+	job->num_active--;
+	cpi_signal_context(job->context);
+	cpi_unlock_context(job->context);
+}
+
+#endif
+
+/**
+ * Initializes a job for the specified number of plug-ins.
+ * 
+ * @param job the job
+ * @param context the plug-in context
+ * @param stop whether plug-ins are to be stopped
+ * @param max_entries the maximum number of plug-ins
+ * @return @ref CP_OK or @ref CP_ERR_RESOURCE
+ */
+static cp_status_t pjob_init(pjob_t *job, cp_context_t *context, int stop, int max_entries) {
+	memset(job, 0, sizeof(pjob_t));
+	job->context = context;
+	job->stop = stop;
+	if (max_entries == 0) {
+		return CP_OK;
+	}
+	if ((job->entries = cpi_malloc(max_entries * sizeof(pjob_entry_t))) == NULL
+		|| (job->ready = cpi_malloc(max_entries * sizeof(pjob_entry_t *))) == NULL
+		|| (job->entry_map = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr)) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	return CP_OK;
+}
+
+/**
+ * Runs the job using the specified number of threads in total, including
+ * the calling thread. The caller must have locked the context exactly once.
+ * The helper threads are joined by ::pjob_destroy after the context has
+ * been unlocked.
+ * 
+ * @param job the job
+ * @param num_threads the number of threads
+ */
+static void pjob_execute(pjob_t *job, int num_threads) {
+	if (job->num_entries == 0) {
+		return;
+	}
+	pjob_init_queue(job);
+	
+#ifdef CP_THREADS
+	if (num_threads > job->num_entries) {
+		num_threads = job->num_entries;
+	}
+	if (num_threads > 1
+		&& (job->threads = cpi_malloc((num_threads - 1) * sizeof(cpi_thread_t *))) != NULL) {
+		
+		// The helpers can not run before the context lock is released 
+		job->unlocked = 1;
+		for (; job->num_threads < num_threads - 1; job->num_threads++) {
+			if ((job->threads[job->num_threads] = cpi_create_thread(pjob_thread, job)) == NULL) {
+				break;
+			}
+			job->num_active++;
+		}
+		if (job->num_threads == 0) {
+			job->unlocked = 0;
+		}
+	}
+#endif
+
+	pjob_run(job);
+	while (job->num_active > 0) {
+		cpi_wait_context(job->context);
+	}
+}
+
+/**
+ * Joins the helper threads and releases the job resources.
+ * 
+ * @param job the job
+ */
+static void pjob_destroy(pjob_t *job) {
+#ifdef CP_THREADS
+	int i;
+	
+	for (i = 0; i < job->num_threads; i++) {
+		cpi_join_thread(job->threads[i]);
+	}
+	cpi_free(job->threads);
+#endif
+	if (job->entry_map != NULL) {
+		hash_free_nodes(job->entry_map);
+		hash_destroy(job->entry_map);
+	}
+	cpi_free(job->entries);
+	cpi_free(job->ready);
+}
+
+CP_C_API cp_status_t cp_start_plugins_parallel(cp_context_t *context, const char * const *ids, int num_threads) {
+	pjob_t job;
+	cp_status_t status = CP_OK;
+	cpi_invocation_t lifecycle;
+	
+	CHECK_NOT_NULL(context);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_begin_lifecycle(context, &lifecycle);
+	do {
+		int i;
+		
+		if ((status = pjob_init(&job, context, 0, cpi_hmap_count(context->env->plugins))) != CP_OK) {
+			break;
+		}
+		
+		// Resolve the requested plug-ins and collect them with their imports 
+		if (ids != NULL) {
+			for (i = 0; ids[i] != NULL && status != CP_ERR_RESOURCE; i++) {
+				cp_plugin_t *plugin;
+				cp_status_t s;
+				
+				if ((plugin = cpi_hmap_get(context->env->plugins, ids[i])) == NULL) {
+					cpi_warnf(context, N_("Unknown plug-in %s could not be started."), ids[i]);
+					s = CP_ERR_UNKNOWN;
+				} else if ((s = resolve_plugin(context, plugin)) == CP_OK
+					&& plugin->state == CP_PLUGIN_RESOLVED) {
+					s = pjob_add(&job, plugin);
+				}
+				if (s != CP_OK && (status == CP_OK || s == CP_ERR_RESOURCE)) {
+					status = s;
+				}
+			}
+		} else {
+			cpi_hmap_scan_t scan;
+			cp_plugin_t *plugin;
+			
+			cpi_hmap_scan_begin(&scan, context->env->plugins);
+			while (status != CP_ERR_RESOURCE && (plugin = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+				cp_status_t s;
+				
+				// Lazy plug-ins stay installed until first use
+				if (is_lazy_plugin(context, plugin)) {
+					continue;
+				}
+				if ((s = resolve_plugin(context, plugin)) == CP_OK
+					&& plugin->state == CP_PLUGIN_RESOLVED) {
+					s = pjob_add(&job, plugin);
+				}
+				if (s != CP_OK && (status == CP_OK || s == CP_ERR_RESOURCE)) {
+					status = s;
+				}
+			}
+		}
+		if (status == CP_ERR_RESOURCE) {
+			cpi_error(context, N_("Plug-ins could not be started due to insufficient memory."));
+			break;
+		}
+		
+		// Start the plug-ins
+		pjob_execute(&job, num_threads);
+		if (status == CP_OK) {
+			status = job.status;
+		}
+		
+	} while (0);
+	cpi_end_lifecycle(context, &lifecycle);
+	cpi_unlock_context(context);
+	
+	// Release resources
+	pjob_destroy(&job);
+	
+	return status;
+}
+
+CP_C_API cp_status_t cp_stop_plugins_parallel(cp_context_t *context, int num_threads) {
+	pjob_t job;
+	cp_status_t status = CP_OK;
+	cpi_invocation_t lifecycle;
+	
+	CHECK_NOT_NULL(context);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_begin_lifecycle(context, &lifecycle);
+	do {
+		cpi_plugin_set_t *started = &(context->env->started_plugins);
+		int i;
+		
+		if ((status = pjob_init(&job, context, 1, started->num)) != CP_OK) {
+			cpi_error(context, N_("Plug-ins could not be stopped in parallel due to insufficient memory."));
+			break;
+		}
+		
+		// Collect the active plug-ins 
+		for (i = 0; i < started->num && status == CP_OK; i++) {
+			status = pjob_add(&job, started->plugins[i]);
 		}
-
-		// Release defined symbols
-		if (plugin->defined_symbols != NULL) {
-			hscan_t scan;
-			hnode_t *node;
-			
-			hash_scan_begin(&scan, plugin->defined_symbols);
-			while ((node = hash_scan_next(&scan)) != NULL) {
-				char *n = (char *) hnode_getkey(node);
-				hash_scan_delfree(plugin->defined_symbols, node);
-				free(n);
-			}
-			hash_destroy(plugin->defined_symbols);
-			plugin->defined_symbols = NULL;
+		if (status != CP_OK) {
+			cpi_error(context, N_("Plug-ins could not be stopped in parallel due to insufficient memory."));
+			break;
 		}
 		
+		// Stop the plug-ins
+		pjob_execute(&job, num_threads);
+		
+	} while (0);
+	
+	// Stop any remaining plug-ins serially
+	if (status != CP_OK) {
+		cpi_plugin_set_t *started = &(context->env->started_plugins);
+		
+		while (started->num > 0) {
+			stop_plugin(context, started->plugins[started->num - 1]);
+		}
 	}
+	cpi_end_lifecycle(context, &lifecycle);
+	cpi_unlock_context(context);
 	
-	// Plug-in stopped 
-	cpi_ptrset_remove(context->env->started_plugins, plugin);
-	event.old_state = plugin->state;
-	event.new_state = plugin->state = CP_PLUGIN_RESOLVED;
-	cpi_deliver_event(context, &event);
+	// Release resources
+	pjob_destroy(&job);
+	
+	return status;
 }
 
 /**
- * Stops the plug-in and all plug-ins depending on it.
- * 
- * @param context the plug-in context
+ * Marks the specified plug-in and the active plug-ins importing it as
+ * processed, if the plug-in is active.
+ *
  * @param plugin the plug-in
  */
-static void stop_plugin_rec(cp_context_t *context, cp_plugin_t *plugin) {
-	lnode_t *node;
-	
-	// Check if already stopped
-	if (plugin->state < CP_PLUGIN_ACTIVE) {
-		return;
-	}
+static void mark_affected_rec(cp_plugin_t *plugin) {
+	int i;
 	
-	// Check for dependency loops
-	if (plugin->processed) {
+	if (plugin->state < CP_PLUGIN_ACTIVE || plugin->processed) {
 		return;
 	}
 	plugin->processed = 1;
-	
-	// Stop the depending plug-ins
-	node = list_first(plugin->importing);
-	while (node != NULL) {
-		stop_plugin_rec(context, lnode_get(node));
-		node = list_next(plugin->importing, node);
+	for (i = 0; i < plugin->importing.num; i++) {
+		mark_affected_rec(plugin->importing.plugins[i]);
 	}
-
-	// Stop this plug-in
-	assert(plugin->state == CP_PLUGIN_ACTIVE);
-	stop_plugin_runtime(context, plugin);
-	assert(plugin->state < CP_PLUGIN_ACTIVE);
-	
-	// Clear processed flag
-	plugin->processed = 0;
 }
 
-static void stop_plugin(cp_context_t *context, cp_plugin_t *plugin) {
-	stop_plugin_rec(context, plugin);
+CP_HIDDEN cp_status_t cpi_stop_affected_plugins(cp_context_t *context, cp_plugin_t * const *plugins, int n, int num_threads, cpi_plugin_set_t *stopped) {
+	pjob_t job;
+	cpi_plugin_set_t *started = &(context->env->started_plugins);
+	cp_status_t status;
+	int i;
+	
+	assert(cpi_is_context_locked(context));
+	for (i = 0; i < n; i++) {
+		mark_affected_rec(plugins[i]);
+	}
+	
+	// Collect the affected plug-ins in start order, clearing the marks
+	status = pjob_init(&job, context, 1, started->num);
+	for (i = 0; i < started->num; i++) {
+		cp_plugin_t *plugin = started->plugins[i];
+	
+		if (!plugin->processed) {
+			continue;
+		}
+		plugin->processed = 0;
+		if (status == CP_OK
+			&& (!plugin_set_append(stopped, plugin)
+				|| (status = pjob_add(&job, plugin)) != CP_OK)) {
+			status = CP_ERR_RESOURCE;
+		}
+	}
 	assert_processed_zero(context);
-}
-
-CP_C_API cp_status_t cp_stop_plugin(cp_context_t *context, const char *id) {
-	hnode_t *node;
-	cp_plugin_t *plugin;
-	cp_status_t status = CP_OK;
-
-	CHECK_NOT_NULL(context);
-	CHECK_NOT_NULL(id);
-
-	// Look up and stop the plug-in 
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_ANY, __func__);
-	node = hash_lookup(context->env->plugins, id);
-	if (node != NULL) {
-		plugin = hnode_get(node);
-		stop_plugin(context, plugin);
+	
+	// Stop the plug-ins, or fall back to serial stopping
+	if (status == CP_OK) {
+		pjob_execute(&job, num_threads);
 	} else {
-		cpi_warnf(context, N_("Unknown plug-in %s could not be stopped."), id);
-		status = CP_ERR_UNKNOWN;
+		cpi_error(context, N_("Plug-ins could not be stopped in parallel due to insufficient memory."));
+		for (i = 0; i < n; i++) {
+			stop_plugin(context, plugins[i]);
+		}
 	}
-	cpi_unlock_context(context);
-
-	return status;
-}
-
-CP_C_API void cp_stop_plugins(cp_context_t *context) {
-	lnode_t *node;
 	
-	CHECK_NOT_NULL(context);
+	// Release resources
+	pjob_destroy(&job);
 	
-	// Stop the active plug-ins in the reverse order they were started 
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_ANY, __func__);
-	while ((node = list_last(context->env->started_plugins)) != NULL) {
-		stop_plugin(context, lnode_get(node));
-	}
-	cpi_unlock_context(context);
+	return status;
 }
 
 static void unresolve_plugin_rec(cp_context_t *context, cp_plugin_t *plugin) {
-	lnode_t *node;
 	cpi_plugin_event_t event;
+	int i;
 	
 	// Check if already unresolved
 	if (plugin->state < CP_PLUGIN_RESOLVED) {
@@ -1050,28 +2707,22 @@ static void unresolve_plugin_rec(cp_context_t *context, cp_plugin_t *plugin) {
 	}
 	assert(plugin->state == CP_PLUGIN_RESOLVED);
 	
-	// Clear the list of imported plug-ins (also breaks dependency loops)
-	while ((node = list_first(plugin->imported)) != NULL) {
-		cp_plugin_t *ip = lnode_get(node);
-		
-		cpi_ptrset_remove(ip->importing, plugin);
-		list_delete(plugin->imported, node);
-		lnode_destroy(node);
+	// Clear the set of imported plug-ins (also breaks dependency loops)
+	for (i = 0; i < plugin->imported.num; i++) {
+		cpi_plugin_set_remove(&plugin->imported.plugins[i]->importing, plugin);
 	}
-	assert(list_isempty(plugin->imported));
-	list_destroy(plugin->imported);
-	plugin->imported = NULL;
+	cpi_plugin_set_clear(&plugin->imported);
 
 	// Unresolve depending plugins
-	while ((node = list_first(plugin->importing)) != NULL) {
-		unresolve_plugin_rec(context, lnode_get(node));
+	while (plugin->importing.num > 0) {
+		unresolve_plugin_rec(context, plugin->importing.plugins[0]);
 	}
 	
 	// Unresolve this plug-in
-	unresolve_plugin_runtime(plugin);
+	unresolve_plugin_runtime(context, plugin, 1);
 	event.plugin_id = plugin->plugin->identifier;
 	event.old_state = plugin->state;
-	event.new_state = plugin->state = CP_PLUGIN_INSTALLED;
+	event.new_state = set_plugin_state(plugin, CP_PLUGIN_INSTALLED);
 	cpi_deliver_event(context, &event);
 }
 
@@ -1086,73 +2737,154 @@ static void unresolve_plugin(cp_context_t *context, cp_plugin_t *plugin) {
 	unresolve_plugin_rec(context, plugin);
 }
 
-static void free_plugin_import_content(cp_plugin_import_t *import) {
-	assert(import != NULL);
-	free(import->plugin_id);
-	free(import->version);
+/**
+ * Returns the memory block holding the specified plug-in description.
+ */
+#define PLUGIN_BLOCK(p) ((plugin_block_t *) ((char *) (p) - offsetof(plugin_block_t, plugin)))
+
+CP_HIDDEN cp_plugin_info_t *cpi_new_plugin(size_t size) {
+	cpi_arena_t *arena;
+	plugin_block_t *block;
+	
+	if ((arena = (size > 0 ? cpi_create_sized_arena(size) : cpi_create_arena())) == NULL) {
+		return NULL;
+	}
+	if ((block = cpi_arena_alloc(arena, sizeof(plugin_block_t))) == NULL) {
+		cpi_destroy_arena(arena);
+		return NULL;
+	}
+	memset(block, 0, sizeof(plugin_block_t));
+	assert(cpi_info_header(&(block->plugin)) == &(block->header));
+	block->arena = arena;
+	return &(block->plugin);
+}
+
+CP_HIDDEN void *cpi_plugin_alloc(cp_plugin_info_t *plugin, size_t size) {
+	assert(plugin != NULL);
+	return cpi_arena_alloc(PLUGIN_BLOCK(plugin)->arena, size);
 }
 
-static void free_ext_point_content(cp_ext_point_t *ext_point) {
-	free(ext_point->name);
-	free(ext_point->local_id);
-	free(ext_point->identifier);
-	free(ext_point->schema_path);
+CP_HIDDEN char *cpi_plugin_strdup(cp_plugin_info_t *plugin, const char *str) {
+	assert(plugin != NULL);
+	return cpi_arena_strdup(PLUGIN_BLOCK(plugin)->arena, str);
 }
 
-static void free_extension_content(cp_extension_t *extension) {
-	free(extension->name);
-	free(extension->local_id);
-	free(extension->identifier);
-	free(extension->ext_point_id);
+CP_HIDDEN size_t cpi_plugin_size(const cp_plugin_info_t *plugin) {
+	assert(plugin != NULL);
+	return cpi_arena_used(PLUGIN_BLOCK(plugin)->arena);
 }
 
-static void free_cfg_element_content(cp_cfg_element_t *ce) {
-	int i;
+CP_HIDDEN cp_status_t cpi_parse_plugin_versions(cp_plugin_info_t *plugin) {
+	plugin_block_t *block;
+	cpi_plugin_versions_t *versions;
+	unsigned int i;
+	
+	assert(plugin != NULL);
+	block = PLUGIN_BLOCK(plugin);
+	versions = &(block->versions);
+	if (!cpi_parse_version(block->arena, plugin->version, &(versions->version))
+		|| !cpi_parse_version(block->arena, plugin->abi_bw_compatibility, &(versions->abi_bw_compatibility))
+		|| !cpi_parse_version(block->arena, plugin->req_cpluff_version, &(versions->req_cpluff_version))) {
+		return CP_ERR_RESOURCE;
+	}
+	versions->imports = NULL;
+	if (plugin->num_imports > 0) {
+		if ((versions->imports = cpi_arena_alloc(block->arena, plugin->num_imports * sizeof(cpi_version_t))) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		for (i = 0; i < plugin->num_imports; i++) {
+			if (!cpi_parse_version(block->arena, plugin->imports[i].version, versions->imports + i)) {
+				return CP_ERR_RESOURCE;
+			}
+		}
+	}
+#ifndef NDEBUG
+	block->versions_parsed = 1;
+#endif
+	return CP_OK;
+}
+
+CP_HIDDEN const cpi_plugin_versions_t *cpi_plugin_versions(const cp_plugin_info_t *plugin) {
+	assert(plugin != NULL);
+	assert(PLUGIN_BLOCK(plugin)->versions_parsed);
+	return &(PLUGIN_BLOCK(plugin)->versions);
+}
 
-	assert(ce != NULL);
-	free(ce->name);
-	if (ce->atts != NULL) {
-		free(ce->atts[0]);
-		free(ce->atts);
+CP_HIDDEN char *cpi_get_cfg_source(const cp_extension_t *ext) {
+	plugin_block_t *block;
+	unsigned int i;
+	
+	assert(ext != NULL && ext->plugin != NULL);
+	block = PLUGIN_BLOCK(ext->plugin);
+	i = ext - ext->plugin->extensions;
+	return (i < block->cfg_sources_size ? block->cfg_sources[i] : NULL);
+}
+
+CP_HIDDEN cp_status_t cpi_set_cfg_source(cp_extension_t *ext, char *source) {
+	plugin_block_t *block;
+	unsigned int i;
+	
+	assert(ext != NULL && ext->plugin != NULL);
+	block = PLUGIN_BLOCK(ext->plugin);
+	i = ext - ext->plugin->extensions;
+	
+	// Allocate more space for the sources, if necessary
+	if (i >= block->cfg_sources_size) {
+		char **ns;
+		unsigned int size;
+		
+		if (source == NULL) {
+			return CP_OK;
+		}
+		size = (block->cfg_sources_size == 0 ? 16 : block->cfg_sources_size * 2);
+		while (i >= size) {
+			size *= 2;
+		}
+		if ((ns = cpi_arena_alloc(block->arena, size * sizeof(char *))) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		memset(ns, 0, size * sizeof(char *));
+		if (block->cfg_sources_size > 0) {
+			memcpy(ns, block->cfg_sources, block->cfg_sources_size * sizeof(char *));
+		}
+		block->cfg_sources = ns;
+		block->cfg_sources_size = size;
 	}
-	free(ce->value);
-	for (i = 0; i < ce->num_children; i++) {
-		free_cfg_element_content(ce->children + i);
+	
+	block->cfg_sources[i] = source;
+	return CP_OK;
+}
+
+CP_HIDDEN cp_timing_t *cpi_parse_timing(cp_plugin_info_t *plugin) {
+	assert(plugin != NULL);
+	return &(PLUGIN_BLOCK(plugin)->parse_timing);
+}
+
+CP_HIDDEN void cpi_descriptor_memory(const cp_plugin_info_t *plugin, cp_memory_stats_t *stats) {
+	size_t bytes = 0, objects = 0;
+	unsigned int i;
+	
+	assert(plugin != NULL);
+	cpi_arena_usage(PLUGIN_BLOCK(plugin)->arena, &bytes, &objects);
+	stats->descriptor_bytes += bytes;
+	stats->descriptor_objects += objects;
+	for (i = 0; i < plugin->num_extensions; i++) {
+		if (plugin->extensions[i].configuration != NULL) {
+			cpi_cfg_memory(plugin->extensions[i].configuration, stats);
+		}
 	}
-	free(ce->children);
 }
 
 CP_HIDDEN void cpi_free_plugin(cp_plugin_info_t *plugin) {
-	int i;
+	unsigned int i;
 	
 	assert(plugin != NULL);
-	free(plugin->name);
-	free(plugin->identifier);
-	free(plugin->version);
-	free(plugin->provider_name);
-	free(plugin->plugin_path);
-	free(plugin->abi_bw_compatibility);
-	free(plugin->api_bw_compatibility);
-	free(plugin->req_cpluff_version);
-	for (i = 0; i < plugin->num_imports; i++) {
-		free_plugin_import_content(plugin->imports + i);
-	}
-	free(plugin->imports);
-	free(plugin->runtime_lib_name);
-	free(plugin->runtime_funcs_symbol);
-	for (i = 0; i < plugin->num_ext_points; i++) {
-		free_ext_point_content(plugin->ext_points + i);
-	}
-	free(plugin->ext_points);
 	for (i = 0; i < plugin->num_extensions; i++) {
-		free_extension_content(plugin->extensions + i);
 		if (plugin->extensions[i].configuration != NULL) {
-			free_cfg_element_content(plugin->extensions[i].configuration);
-			free(plugin->extensions[i].configuration);
+			cpi_free_cfg_indexes(plugin->extensions[i].configuration);
 		}
 	}
-	free(plugin->extensions);
-	free(plugin);
+	cpi_destroy_arena(PLUGIN_BLOCK(plugin)->arena);
 }
 
 /**
@@ -1168,28 +2900,33 @@ static void free_registered_plugin(cp_context_t *context, cp_plugin_t *plugin) {
 	// Release plug-in information
 	cpi_release_info(context, plugin->plugin);
 
-	// Release data structures 
-	if (plugin->importing != NULL) {
-		assert(list_isempty(plugin->importing));
-		list_destroy(plugin->importing);
+	// Close a prefetched runtime library that was not used
+	if (plugin->prefetched_lib != NULL) {
+		DLCLOSE(plugin->prefetched_lib);
 	}
-	assert(plugin->imported == NULL);
 
-	free(plugin);
+	// Release data structures 
+	assert(plugin->importing.num == 0);
+	cpi_plugin_set_clear(&plugin->importing);
+	assert(plugin->imported.num == 0 && plugin->imported.plugins == NULL);
+	assert(plugin->import_targets == NULL && plugin->dependents == NULL);
+	assert(plugin->extension_nodes == NULL);
+	assert(list_isempty(&plugin->run_wait));
+	assert(!lnode_is_in_a_list(&plugin->run_queue_node));
+
+	cpi_free(plugin);
 }
 
 /**
- * Uninstalls a plug-in associated with the specified hash node.
+ * Uninstalls the specified installed plug-in.
  * 
  * @param context the plug-in context
- * @param node the hash node of the plug-in to be uninstalled
+ * @param plugin the plug-in to be uninstalled
  */
-static void uninstall_plugin(cp_context_t *context, hnode_t *node) {
-	cp_plugin_t *plugin;
+static void uninstall_plugin(cp_context_t *context, cp_plugin_t *plugin) {
 	cpi_plugin_event_t event;
 	
 	// Check if already uninstalled 
-	plugin = (cp_plugin_t *) hnode_get(node);
 	if (plugin->state <= CP_PLUGIN_UNINSTALLED) {
 		// TODO: Is this possible state?
 		return;
@@ -1202,22 +2939,23 @@ static void uninstall_plugin(cp_context_t *context, hnode_t *node) {
 	// Plug-in uninstalled 
 	event.plugin_id = plugin->plugin->identifier;
 	event.old_state = plugin->state;
-	event.new_state = plugin->state = CP_PLUGIN_UNINSTALLED;
+	event.new_state = set_plugin_state(plugin, CP_PLUGIN_UNINSTALLED);
 	cpi_deliver_event(context, &event);
 	
 	// Unregister extension objects
-	unregister_extensions(context, plugin->plugin);
+	unregister_extensions(context, plugin);
 
 	// Unregister the plug-in 
-	hash_delete_free(context->env->plugins, node);
+	unlink_dependencies(context, plugin);
+	cpi_hmap_remove(context->env->plugins, plugin->plugin->identifier);
 	
 	// If the plug-in was loaded using loaders, remove it from loader maps
 	if (plugin->loader != NULL) {
 		hash_t *loader_plugins;
+		hnode_t *node;
 		
-		node = hash_lookup(context->env->loaders_to_plugins, plugin->loader);
-		assert(node != NULL);
-		loader_plugins = hnode_get(node);
+		loader_plugins = cpi_hmap_get(context->env->loaders_to_plugins, plugin->loader);
+		assert(loader_plugins != NULL);
 		node = hash_lookup(loader_plugins, plugin->plugin->identifier);
 		assert(node != NULL);
 		hash_delete_free(loader_plugins, node);
@@ -1228,8 +2966,9 @@ static void uninstall_plugin(cp_context_t *context, hnode_t *node) {
 }
 
 CP_C_API cp_status_t cp_uninstall_plugin(cp_context_t *context, const char *id) {
-	hnode_t *node;
+	cp_plugin_t *plugin;
 	cp_status_t status = CP_OK;
+	cpi_invocation_t lifecycle;
 
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(id);
@@ -1237,35 +2976,238 @@ CP_C_API cp_status_t cp_uninstall_plugin(cp_context_t *context, const char *id)
 	// Look up and unload the plug-in 
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
-	node = hash_lookup(context->env->plugins, id);
-	if (node != NULL) {
-		uninstall_plugin(context, node);
+	cpi_begin_lifecycle(context, &lifecycle);
+	plugin = cpi_hmap_get(context->env->plugins, id);
+	if (plugin != NULL) {
+		uninstall_plugin(context, plugin);
 	} else {
 		cpi_warnf(context, N_("Unknown plug-in %s could not be uninstalled."), id);
 		status = CP_ERR_UNKNOWN;
 	}
 	
+	cpi_end_lifecycle(context, &lifecycle);
 	cpi_unlock_context(context);
 
 	return status;
 }
 
 CP_C_API void cp_uninstall_plugins(cp_context_t *context) {
-	hscan_t scan;
-	hnode_t *node;
+	cpi_plugin_set_t *order;
+	cpi_hmap_scan_t scan;
+	cp_plugin_t *plugin;
+	cpi_invocation_t lifecycle;
 	
 	CHECK_NOT_NULL(context);
 	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_begin_lifecycle(context, &lifecycle);
 	cp_stop_plugins(context);
+	
+	// Uninstall importing plug-ins before the plug-ins they import so that
+	// uninstalling a plug-in does not have to unresolve any other plug-ins
+	if ((order = topo_order(context)) != NULL) {
+		cpi_plugin_set_t plugins = *order;
+		int i;
+		
+		memset(order, 0, sizeof(cpi_plugin_set_t));
+		context->env->topo_valid = 0;
+		for (i = plugins.num - 1; i >= 0; i--) {
+			if ((plugin = cpi_hmap_get(context->env->plugins, plugins.plugins[i]->plugin->identifier)) != NULL) {
+				uninstall_plugin(context, plugin);
+			}
+		}
+		cpi_plugin_set_clear(&plugins);
+	}
+	
+	// Uninstall any remaining plug-ins
 	while (1) {
-		hash_scan_begin(&scan, context->env->plugins);
-		if ((node = hash_scan_next(&scan)) != NULL) {
-			uninstall_plugin(context, node);
+		cpi_hmap_scan_begin(&scan, context->env->plugins);
+		if ((plugin = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			uninstall_plugin(context, plugin);
 		} else {
 			break;
 		}
 	}
+	cpi_end_lifecycle(context, &lifecycle);
+	cpi_unlock_context(context);
+}
+
+CP_C_API void cp_set_runtime_retention(cp_context_t *context, int max_libs) {
+	CHECK_NOT_NULL(context);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	context->env->max_retained_runtimes = (max_libs > 0 ? max_libs : 0);
+	evict_retained_runtimes(context->env, context->env->max_retained_runtimes);
+	cpi_unlock_context(context);
+}
+
+CP_C_API int cp_release_retained_runtimes(cp_context_t *context) {
+	int n;
+	
+	CHECK_NOT_NULL(context);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	n = evict_retained_runtimes(context->env, 0);
+	cpi_unlock_context(context);
+	return n;
+}
+
+
+// Context compaction
+
+/**
+ * Returns whether the description of the specified plug-in can be replaced
+ * by a compact copy. Only descriptions of inactive plug-ins which are not
+ * referenced outside the registry and whose extensions are not indexed or
+ * bound to a configuration schema are replaced.
+ * 
+ * @param context the plug-in context
+ * @param rp the registered plug-in
+ * @return non-zero if the description can be replaced, otherwise zero
+ */
+static int is_compactable(cp_context_t *context, cp_plugin_t *rp) {
+	int i;
+	
+	if ((rp->state != CP_PLUGIN_INSTALLED && rp->state != CP_PLUGIN_RESOLVED)
+		|| cpi_is_shared_info(rp->plugin)
+		|| cpi_info_header(rp->plugin)->h.usage_count != 1) {
+		return 0;
+	}
+	for (i = 0; i < rp->plugin->num_extensions; i++) {
+		if (cpi_is_extension_indexed(context, rp->plugin->extensions + i)
+			|| cpi_is_extension_bound(context, rp->plugin->extensions + i)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Replaces the description of the specified plug-in by a compact copy and
+ * points the registries at the copy. The registries only lose entries
+ * before gaining equal ones so that updating them can not fail.
+ * 
+ * @param context the plug-in context
+ * @param rp the registered plug-in
+ * @param drop_cfg whether to replace configuration trees by their markup
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t compact_plugin(cp_context_t *context, cp_plugin_t *rp, int drop_cfg) {
+	cp_plugin_env_t *env = context->env;
+	cp_plugin_info_t *op = rp->plugin;
+	cp_plugin_info_t *np;
+	int i;
+	
+	if ((np = cpi_compact_plugin(context, op, drop_cfg)) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	
+	// Re-key the extension points
+	for (i = 0; i < op->num_ext_points; i++) {
+		if (cpi_hmap_get(env->ext_points, op->ext_points[i].identifier) == op->ext_points + i) {
+			cpi_invalidate_extensions_snapshot(context, op->ext_points[i].identifier);
+			cpi_hmap_remove(env->ext_points, op->ext_points[i].identifier);
+			cpi_hmap_put(env->ext_points, np->ext_points[i].identifier, np->ext_points + i);
+		}
+	}
+	
+	// Point the extension list nodes at the copies
+	for (i = 0; rp->extension_nodes != NULL && i < op->num_extensions; i++) {
+		if (lnode_is_in_a_list(rp->extension_nodes + i)) {
+			cpi_invalidate_extensions_snapshot(context, op->extensions[i].ext_point_id);
+			lnode_put(rp->extension_nodes + i, np->extensions + i);
+		}
+	}
+	
+	// Re-key the plug-in in the plug-in map and in the loader map
+	cpi_hmap_remove(env->plugins, op->identifier);
+	cpi_hmap_put(env->plugins, np->identifier, rp);
+	if (rp->loader != NULL) {
+		hash_t *loader_plugins;
+		hnode_t *node;
+		
+		loader_plugins = cpi_hmap_get(env->loaders_to_plugins, rp->loader);
+		assert(loader_plugins != NULL);
+		node = hash_lookup(loader_plugins, op->identifier);
+		assert(node != NULL);
+		hash_delete(loader_plugins, node);
+		hash_insert(loader_plugins, node, np->identifier);
+	}
+	
+	rp->plugin = np;
+	cpi_release_info(context, op);
+	return CP_OK;
+}
+
+CP_C_API cp_status_t cp_compact_context(cp_context_t *context, int flags) {
+	cp_plugin_env_t *env;
+	cpi_invocation_t lifecycle;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_begin_lifecycle(context, &lifecycle);
+	env = context->env;
+	
+	// Replace plug-in descriptions by compact copies
+	if (flags & (CP_CC_DESCRIPTORS | CP_CC_CFG)) {
+		cpi_hmap_scan_t scan;
+		cp_plugin_t **rps = NULL;
+		int i, n = 0;
+		
+		// Collect the plug-ins first as compaction re-keys the plug-in map
+		if (cpi_hmap_count(env->plugins) > 0
+			&& (rps = cpi_malloc(cpi_hmap_count(env->plugins) * sizeof(cp_plugin_t *))) == NULL) {
+			status = CP_ERR_RESOURCE;
+		} else {
+			cp_plugin_t *rp;
+			
+			cpi_hmap_scan_begin(&scan, env->plugins);
+			while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+				if (is_compactable(context, rp)) {
+					rps[n++] = rp;
+				}
+			}
+		}
+		for (i = 0; i < n && status == CP_OK; i++) {
+			status = compact_plugin(context, rps[i], flags & CP_CC_CFG);
+		}
+		cpi_free(rps);
+		if (status == CP_OK) {
+			cpi_debugf(context, N_("Compacted the descriptions of %d plug-ins."), n);
+		}
+	}
+	
+	// Shrink the registries
+	if (flags & CP_CC_REGISTRIES) {
+		cpi_hmap_compact(env->plugins);
+		cpi_hmap_compact(env->ext_points);
+		cpi_hmap_compact(env->extensions);
+		cpi_hmap_compact(env->loaders_to_plugins);
+#ifndef NDEBUG
+		cpi_hmap_compact(env->infos);
+#endif
+		if (env->started_plugins.num == 0) {
+			cpi_plugin_set_clear(&env->started_plugins);
+		} else if (env->started_plugins.num < env->started_plugins.size) {
+			cp_plugin_t **plugins;
+			
+			if ((plugins = cpi_realloc(env->started_plugins.plugins, env->started_plugins.num * sizeof(cp_plugin_t *))) != NULL) {
+				env->started_plugins.plugins = plugins;
+				env->started_plugins.size = env->started_plugins.num;
+			}
+		}
+		
+		// The topological order is rebuilt when needed
+		cpi_plugin_set_clear(&env->topo_order);
+		env->topo_valid = 0;
+	}
+	
+	cpi_end_lifecycle(context, &lifecycle);
 	cpi_unlock_context(context);
+	return status;
 }
@@ -36,12 +36,19 @@
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <expat.h>
 #include "cpluff.h"
 #include "defines.h"
 #include "util.h"
 #include "internal.h"
 
+// Use memory mapped descriptor files if available
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && defined(HAVE_MUNMAP)
+#define CP_USE_MMAP
+#include <sys/mman.h>
+#endif
+
 // Use XMLCALL if available
 #ifdef XMLCALL
 #define CP_XMLCALL XMLCALL
@@ -60,6 +67,9 @@
 /// Initial configuration element value size 
 #define CP_CFG_ELEMENT_VALUE_INITSIZE 64
 
+/// Initial configuration source buffer size
+#define CP_CFG_SOURCE_INITSIZE 256
+
 
 /* ------------------------------------------------------------------------
  * Internal data types
@@ -78,6 +88,23 @@ typedef enum parser_state_t {
 	PARSER_ERROR
 } parser_state_t;
 
+/// A streaming configuration consumer registered for an extension point
+struct cpi_cfg_stream_t {
+	
+	/// The extension point identifier, allocated with the structure
+	char *ext_point_id;
+	
+	/// The consumer functions
+	cp_cfg_stream_t funcs;
+	
+	/// The user data pointer passed to the consumer functions
+	void *user_data;
+	
+	/// The registering plug-in or NULL for the main program
+	cp_plugin_t *plugin;
+	
+};
+
 /// Plug-in loader context 
 struct ploader_context_t {
 
@@ -128,6 +155,36 @@ struct ploader_context_t {
 	/// Current length of value string 
 	size_t value_length;
 	
+	/// Whether the source of the current extension is being recorded
+	int recording;
+	
+	/// Whether the last recorded start tag was an empty element
+	int recorded_empty;
+	
+	/// Buffer for the recorded configuration source
+	char *source;
+	
+	/// Size of allocated source buffer
+	size_t source_size;
+	
+	/// Current length of the recorded source
+	size_t source_length;
+	
+	/// The extension whose configuration is being parsed lazily, or NULL
+	cp_extension_t *lazy_extension;
+	
+	/// Whether the configuration of the current extension is being streamed
+	int streaming;
+	
+	/// The consumer of the streamed configuration, cleared on rejection
+	cp_cfg_stream_t stream;
+	
+	/// The user data pointer passed to the consumer
+	void *stream_data;
+	
+	/// Whether the plug-in information is parsed for sharing by contexts
+	int shared;
+	
 	/// The number of parsing errors that have occurred 
 	unsigned int error_count;
 	
@@ -136,6 +193,41 @@ struct ploader_context_t {
 };
 
 
+/// A plug-in descriptor shared by the plug-in contexts of the framework
+typedef struct shared_descriptor_t {
+	
+	/// The plug-in path, allocated with the structure
+	char *path;
+	
+	/// The descriptor file name the information was parsed with
+	char *descriptor_name;
+	
+	/// The descriptor root element the information was parsed with
+	char *root_element;
+	
+	/// Modification time of the descriptor file
+	unsigned long long mtime;
+	
+	/// Size of the descriptor file
+	unsigned long long size;
+	
+	/// The shared plug-in information
+	cp_plugin_info_t *plugin;
+	
+} shared_descriptor_t;
+
+
+/* ------------------------------------------------------------------------
+ * Variables
+ * ----------------------------------------------------------------------*/
+
+/**
+ * Shared plug-in descriptors keyed by plug-in path, or NULL if none have
+ * been published. Protected by the framework lock.
+ */
+static hash_t *shared_descriptor_table = NULL;
+
+
 /* ------------------------------------------------------------------------
  * Function definitions
  * ----------------------------------------------------------------------*/
@@ -158,6 +250,7 @@ static void descriptor_errorf(ploader_context_t *plcontext, int warn,
 	vsnprintf(message, sizeof(message), error_msg, ap);
 	va_end(ap);
 	message[127] = '\0';
+	cpi_lock_context(plcontext->context);
 	if (warn) {
 		cpi_warnf(plcontext->context,
 			N_("Suspicious plug-in descriptor content in %s, line %d, column %d (%s)."),
@@ -173,6 +266,7 @@ static void descriptor_errorf(ploader_context_t *plcontext, int warn,
 			(int) (XML_GetCurrentColumnNumber(plcontext->parser) + 1),
 			message);
 	}
+	cpi_unlock_context(plcontext->context);
 	if (!warn) {
 		plcontext->error_count++;
 	}
@@ -186,11 +280,13 @@ static void descriptor_errorf(ploader_context_t *plcontext, int warn,
  */
 static void resource_error(ploader_context_t *plcontext) {
 	if (plcontext->resource_error_count == 0) {
+		cpi_lock_context(plcontext->context);
 		cpi_errorf(plcontext->context,
 			N_("Insufficient system resources to parse plug-in descriptor content in %s, line %d, column %d."),
 			plcontext->file,
 			(int) XML_GetCurrentLineNumber(plcontext->parser),
 			(int) (XML_GetCurrentColumnNumber(plcontext->parser) + 1));
+		cpi_unlock_context(plcontext->context);
 	}
 	plcontext->resource_error_count++;
 }
@@ -290,8 +386,9 @@ static int check_attributes(ploader_context_t *plcontext,
 }
 
 /**
- * Allocates memory using malloc. Reports a resource error if there is not
- * enough available memory.
+ * Allocates memory for the plug-in being constructed. The memory is released
+ * together with the plug-in information. Reports a resource error if there
+ * is not enough available memory.
  * 
  * @param context the parsing context
  * @param size the number of bytes to allocate
@@ -300,14 +397,36 @@ static int check_attributes(ploader_context_t *plcontext,
 static void *parser_malloc(ploader_context_t *plcontext, size_t size) {
 	void *ptr;
 
-	if ((ptr = malloc(size)) == NULL) {
+	if ((ptr = cpi_plugin_alloc(plcontext->plugin, size)) == NULL) {
 		resource_error(plcontext);
 	}
 	return ptr;
 }
 
 /**
- * Makes a copy of the specified string. The memory is allocated using malloc.
+ * Grows a table of the plug-in being constructed. The existing entries are
+ * copied to a newly allocated table and the old table is released together
+ * with the plug-in information. Reports a resource error if there is not
+ * enough available memory.
+ * 
+ * @param context the parsing context
+ * @param ptr the existing table or NULL
+ * @param size the size of the existing table in bytes
+ * @param new_size the size of the new table in bytes
+ * @return pointer to the new table, or NULL if memory allocation failed
+ */
+static void *parser_grow(ploader_context_t *plcontext, void *ptr, size_t size, size_t new_size) {
+	void *new_ptr;
+	
+	assert(new_size >= size);
+	if ((new_ptr = parser_malloc(plcontext, new_size)) != NULL && size > 0) {
+		memcpy(new_ptr, ptr, size);
+	}
+	return new_ptr;
+}
+
+/**
+ * Makes a copy of the specified string for the plug-in being constructed.
  * Reports a resource error if there is not enough available memory.
  * 
  * @param context the parsing context
@@ -317,15 +436,15 @@ static void *parser_malloc(ploader_context_t *plcontext, size_t size) {
 static char *parser_strdup(ploader_context_t *plcontext, const char *src) {
 	char *dup;
 
-	if ((dup = strdup(src)) == NULL) {
+	if ((dup = cpi_plugin_strdup(plcontext->plugin, src)) == NULL) {
 		resource_error(plcontext);
 	}
 	return dup;
 }
 
 /**
- * Concatenates the specified strings into a new string. The memory for the concatenated
- * string is allocated using malloc. Reports a resource error if there is not
+ * Concatenates the specified strings into a new string for the plug-in
+ * being constructed. Reports a resource error if there is not
  * enough available memory.
  * 
  * @param context the parsing context
@@ -363,6 +482,67 @@ static char *parser_strscat(ploader_context_t *plcontext, ...) {
 	return dst;
 }
 
+/**
+ * Returns the interned copy of the specified string. Equal strings are
+ * shared by all the plug-ins of the plug-in environment. Reports a
+ * resource error if there is not enough available memory.
+ * 
+ * @param context the parsing context
+ * @param str the string to be interned
+ * @return the interned string, or NULL if memory allocation failed
+ */
+static char *parser_intern(ploader_context_t *plcontext, const char *str) {
+	char *istr;
+	
+	// Shared information must not refer to strings of a single context
+	if (plcontext->context == NULL || plcontext->shared) {
+		return parser_strdup(plcontext, str);
+	}
+	cpi_lock_context(plcontext->context);
+	istr = cpi_intern_string(plcontext->context, str);
+	cpi_unlock_context(plcontext->context);
+	if (istr == NULL) {
+		resource_error(plcontext);
+	}
+	return istr;
+}
+
+/**
+ * Returns the interned global identifier for a local identifier of the
+ * plug-in being constructed. Reports a resource error if there is not
+ * enough available memory.
+ * 
+ * @param context the parsing context
+ * @param local_id the local identifier
+ * @return the interned global identifier, or NULL if memory allocation failed
+ */
+static char *parser_intern_id(ploader_context_t *plcontext, const char *local_id) {
+	char buffer[128];
+	char *id = buffer;
+	char *iid;
+	size_t plen, llen;
+	
+	// The plug-in identifier is missing from an invalid descriptor
+	if (plcontext->plugin->identifier == NULL) {
+		return NULL;
+	}
+	plen = strlen(plcontext->plugin->identifier);
+	llen = strlen(local_id);
+	if (plen + llen + 2 > sizeof(buffer)
+		&& (id = cpi_malloc((plen + llen + 2) * sizeof(char))) == NULL) {
+		resource_error(plcontext);
+		return NULL;
+	}
+	memcpy(id, plcontext->plugin->identifier, plen * sizeof(char));
+	id[plen] = '.';
+	memcpy(id + plen + 1, local_id, (llen + 1) * sizeof(char));
+	iid = parser_intern(plcontext, id);
+	if (id != buffer) {
+		cpi_free(id);
+	}
+	return iid;
+}
+
 /**
  * Puts the parser to a state in which it skips an unknown element.
  * Warns error handlers about the unknown element.
@@ -415,15 +595,13 @@ static char **parser_attsdup(ploader_context_t *plcontext, const XML_Char * cons
 		}
 	}
 	
-	// If successful then return duplicates, otherwise free any allocations 
+	// If successful then return duplicates, partial allocations are released with the plug-in
 	if (num == 0 || (atts != NULL && attr_data != NULL)) {
 		if (num_atts != NULL) {
 			*num_atts = num / 2;
 		}
 		return atts;
 	} else {
-		free(attr_data);
-		free(atts);
 		return NULL;
 	}
 }
@@ -442,7 +620,7 @@ static void init_cfg_element(ploader_context_t *plcontext, cp_cfg_element_t *ce,
 	
 	// Initialize the configuration element 
 	memset(ce, 0, sizeof(cp_cfg_element_t));
-	ce->name = parser_strdup(plcontext, name);
+	ce->name = parser_intern(plcontext, name);
 	ce->atts = parser_attsdup(plcontext, atts, &(ce->num_atts));
 	ce->value = NULL;
 	plcontext->value = NULL;
@@ -492,7 +670,7 @@ static void CP_XMLCALL character_data_handler(
 				ns = 2 * ns;
 			}
 		}
-		if ((nv = realloc(plcontext->value, ns * sizeof(char))) != NULL) {
+		if ((nv = cpi_realloc(plcontext->value, ns * sizeof(char))) != NULL) {
 			plcontext->value = nv;
 			plcontext->value_size = ns;
 		} else {
@@ -506,6 +684,175 @@ static void CP_XMLCALL character_data_handler(
 	plcontext->value_length += len;
 }
 
+/**
+ * Returns the extension currently being parsed.
+ * 
+ * @param context the parsing context
+ * @return the extension
+ */
+static cp_extension_t *current_extension(ploader_context_t *plcontext) {
+	return plcontext->plugin->extensions + plcontext->plugin->num_extensions - 1;
+}
+
+/**
+ * Reports a configuration rejected by its streaming consumer and stops
+ * delivering events for the rest of the extension.
+ * 
+ * @param context the parsing context
+ */
+static void stream_rejected(ploader_context_t *plcontext) {
+	memset(&(plcontext->stream), 0, sizeof(cp_cfg_stream_t));
+	descriptor_errorf(plcontext, 0, _("extension configuration was rejected by its consumer"));
+}
+
+/**
+ * Passes the character data of a streamed configuration to the consumer.
+ * 
+ * @param userData the parsing context
+ * @param str the string data
+ * @param len the string length
+ */
+static void CP_XMLCALL stream_character_data_handler(
+	void *userData, const XML_Char *str, int len) {
+	ploader_context_t *plcontext = userData;
+	
+	if (plcontext->stream.text != NULL
+		&& plcontext->stream.text(plcontext->stream_data, current_extension(plcontext), str, len)) {
+		stream_rejected(plcontext);
+	}
+}
+
+/**
+ * Looks up the streaming consumer for the configuration of extensions
+ * attached to the specified extension point and prepares to stream the
+ * configuration of the current extension if found.
+ * 
+ * @param context the parsing context
+ * @param ext_point_id the extension point identifier, or NULL
+ * @return whether there is a consumer
+ */
+static int lookup_cfg_stream(ploader_context_t *plcontext, const char *ext_point_id) {
+	hnode_t *node;
+	
+	if (plcontext->context == NULL || plcontext->shared || ext_point_id == NULL) {
+		return 0;
+	}
+	cpi_lock_context(plcontext->context);
+	if ((node = hash_lookup(plcontext->context->env->cfg_streams, ext_point_id)) != NULL) {
+		cpi_cfg_stream_t *cs = hnode_get(node);
+		
+		plcontext->stream = cs->funcs;
+		plcontext->stream_data = cs->user_data;
+	}
+	cpi_unlock_context(plcontext->context);
+	return node != NULL;
+}
+
+/**
+ * Starts streaming the configuration of an extension. Only the extension
+ * element itself is stored as the configuration.
+ * 
+ * @param context the parsing context
+ * @param extension the extension
+ * @param name the element name
+ * @param atts the element attributes
+ */
+static void init_extension_cfg_stream(ploader_context_t *plcontext, cp_extension_t *extension,
+	const XML_Char *name, const XML_Char * const *atts) {
+	if ((extension->configuration = parser_malloc(plcontext, sizeof(cp_cfg_element_t))) != NULL) {
+		init_cfg_element(plcontext, extension->configuration, name, atts, NULL);
+	}
+	plcontext->streaming = 1;
+	XML_SetCharacterDataHandler(plcontext->parser, stream_character_data_handler);
+	if (plcontext->stream.start_element != NULL
+		&& plcontext->stream.start_element(plcontext->stream_data, extension, name, (const char * const *) atts, 0)) {
+		stream_rejected(plcontext);
+	}
+}
+
+/**
+ * Starts parsing the configuration of an extension.
+ * 
+ * @param context the parser context
+ * @param extension the extension
+ * @param name the element name
+ * @param atts the element attributes
+ */
+static void init_extension_cfg(ploader_context_t *plcontext, cp_extension_t *extension,
+	const XML_Char *name, const XML_Char * const *atts) {
+	if ((extension->configuration = plcontext->configuration
+		= parser_malloc(plcontext, sizeof(cp_cfg_element_t))) != NULL) {
+		init_cfg_element(plcontext, plcontext->configuration, name, atts, NULL);
+	}
+	XML_SetCharacterDataHandler(plcontext->parser, character_data_handler);
+}
+
+/**
+ * Appends the markup passed on by Expat to the recorded configuration source.
+ * 
+ * @param userData the parsing context
+ * @param str the markup
+ * @param len the length of the markup
+ */
+static void CP_XMLCALL default_handler(
+	void *userData, const XML_Char *str, int len) {
+	ploader_context_t *plcontext = userData;
+	
+	if (len <= 0 || !plcontext->recording) {
+		return;
+	}
+	
+	// Allocate more memory for the source if needed
+	if (plcontext->source_length + len >= plcontext->source_size) {
+		size_t ns;
+		char *nsrc;
+		
+		ns = (plcontext->source_size == 0 ? CP_CFG_SOURCE_INITSIZE : plcontext->source_size);
+		while (plcontext->source_length + len >= ns) {
+			ns *= 2;
+		}
+		if ((nsrc = cpi_realloc(plcontext->source, ns * sizeof(char))) == NULL) {
+			plcontext->recording = 0;
+			resource_error(plcontext);
+			return;
+		}
+		plcontext->source = nsrc;
+		plcontext->source_size = ns;
+	}
+	
+	// Append the markup
+	memcpy(plcontext->source + plcontext->source_length, str, len * sizeof(char));
+	plcontext->source_length += len;
+}
+
+/**
+ * Records the markup of the current start tag into the configuration source.
+ * 
+ * @param context the parsing context
+ */
+static void record_start_tag(ploader_context_t *plcontext) {
+	size_t l = plcontext->source_length;
+	
+	XML_DefaultCurrent(plcontext->parser);
+	plcontext->recorded_empty = (plcontext->source_length >= l + 2
+		&& plcontext->source[plcontext->source_length - 2] == '/'
+		&& plcontext->source[plcontext->source_length - 1] == '>');
+}
+
+/**
+ * Records the markup of the current end tag into the configuration source.
+ * The end of an empty element has already been recorded with the start tag.
+ * 
+ * @param context the parsing context
+ */
+static void record_end_tag(ploader_context_t *plcontext) {
+	if (plcontext->recorded_empty) {
+		plcontext->recorded_empty = 0;
+	} else {
+		XML_DefaultCurrent(plcontext->parser);
+	}
+}
+
 /**
  * Processes the start of element events while parsing.
  * 
@@ -525,7 +872,7 @@ static void CP_XMLCALL start_element_handler(
 	const XML_Char * const req_import_atts[] = { plcontext->context->env->plugin_descriptor_root_element, NULL };
 	static const XML_Char * const opt_import_atts[] = { "version", "optional", NULL };
 	static const XML_Char * const req_runtime_atts[] = { "library", NULL };
-	static const XML_Char * const opt_runtime_atts[] = { "funcs", NULL };
+	static const XML_Char * const opt_runtime_atts[] = { "funcs", "symbols", "activation", NULL };
 	static const XML_Char * const req_ext_point_atts[] = { "id", NULL };
 	static const XML_Char * const opt_ext_point_atts[] = { "name", "schema", NULL };
 	static const XML_Char * const req_extension_atts[] = { "point", NULL };
@@ -548,7 +895,7 @@ static void CP_XMLCALL start_element_handler(
 							= parser_strdup(plcontext, atts[i+1]);
 					} else if (!strcmp(atts[i], "id")) {
 						plcontext->plugin->identifier
-							= parser_strdup(plcontext, atts[i+1]);
+							= parser_intern(plcontext, atts[i+1]);
 					} else if (!strcmp(atts[i], "version")) {
 						plcontext->plugin->version
 							= parser_strdup(plcontext, atts[i+1]);
@@ -586,6 +933,15 @@ static void CP_XMLCALL start_element_handler(
 						} else if (!strcmp(atts[i], "funcs")) {
 							plcontext->plugin->runtime_funcs_symbol
 								= parser_strdup(plcontext, atts[i+1]);
+						} else if (!strcmp(atts[i], "symbols")) {
+							plcontext->plugin->runtime_symbols_symbol
+								= parser_strdup(plcontext, atts[i+1]);
+						} else if (!strcmp(atts[i], "activation")) {
+							if (!strcmp(atts[i+1], "lazy")) {
+								plcontext->plugin->lazy_activation = 1;
+							} else if (strcmp(atts[i+1], "eager")) {
+								descriptor_errorf(plcontext, 0, _("unknown activation policy: %s"), atts[i+1]);
+							}
 						}
 					}
 				}
@@ -604,9 +960,9 @@ static void CP_XMLCALL start_element_handler(
 						} else {
 							ns = plcontext->ext_points_size * 2;
 						}
-						if ((nep = realloc(plcontext->plugin->ext_points,
+						if ((nep = parser_grow(plcontext, plcontext->plugin->ext_points,
+								plcontext->ext_points_size * sizeof(cp_ext_point_t),
 								ns * sizeof(cp_ext_point_t))) == NULL) {
-							resource_error(plcontext);
 							break;
 						}
 						plcontext->plugin->ext_points = nep;
@@ -630,8 +986,7 @@ static void CP_XMLCALL start_element_handler(
 							ext_point->local_id
 								= parser_strdup(plcontext, atts[i+1]);
 							ext_point->identifier
-								= parser_strscat(plcontext,
-									plcontext->plugin->identifier, ".", atts[i+1], NULL);
+								= parser_intern_id(plcontext, atts[i+1]);
 						} else if (!strcmp(atts[i], "schema")) {
 							ext_point->schema_path
 								= parser_strdup(plcontext, atts[i+1]);
@@ -643,7 +998,12 @@ static void CP_XMLCALL start_element_handler(
 			} else if (!(strcmp(name, "extension"))) {
 				plcontext->state = PARSER_EXTENSION;
 				plcontext->depth = 0;
-				if (check_req_attributes(
+				if (plcontext->lazy_extension != NULL) {
+					
+					// Parse the recorded configuration of an existing extension
+					init_extension_cfg(plcontext, plcontext->lazy_extension, name, atts);
+					
+				} else if (check_req_attributes(
 					plcontext, name, atts, req_extension_atts)) {
 					cp_extension_t *extension;
 				
@@ -657,9 +1017,9 @@ static void CP_XMLCALL start_element_handler(
 						} else {
 							ns = plcontext->extensions_size * 2;
 						}
-						if ((ne = realloc(plcontext->plugin->extensions,
+						if ((ne = parser_grow(plcontext, plcontext->plugin->extensions,
+								plcontext->extensions_size * sizeof(cp_extension_t),
 								ns * sizeof(cp_extension_t))) == NULL) {
-							resource_error(plcontext);
 							break;
 						}
 						plcontext->plugin->extensions = ne;
@@ -679,7 +1039,7 @@ static void CP_XMLCALL start_element_handler(
 					for (i = 0; atts[i] != NULL; i += 2) {
 						if (!strcmp(atts[i], "point")) {
 							extension->ext_point_id
-								= parser_strdup(plcontext, atts[i+1]);
+								= parser_intern(plcontext, atts[i+1]);
 						} else if (!strcmp(atts[i], "id")) {
 							extension->local_id
 								= parser_strdup(plcontext, atts[i+1]);
@@ -693,12 +1053,17 @@ static void CP_XMLCALL start_element_handler(
 					}
 					plcontext->plugin->num_extensions++;
 					
-					// Initialize configuration parsing 
-					if ((extension->configuration = plcontext->configuration
-						= parser_malloc(plcontext, sizeof(cp_cfg_element_t))) != NULL) {
-						init_cfg_element(plcontext, plcontext->configuration, name, atts, NULL);
+					// Stream or record the configuration source or initialize configuration parsing 
+					if (lookup_cfg_stream(plcontext, extension->ext_point_id)) {
+						init_extension_cfg_stream(plcontext, extension, name, atts);
+					} else if (plcontext->context->env->lazy_cfg && !plcontext->shared) {
+						plcontext->recording = 1;
+						plcontext->source_length = 0;
+						XML_SetDefaultHandler(plcontext->parser, default_handler);
+						record_start_tag(plcontext);
+					} else {
+						init_extension_cfg(plcontext, extension, name, atts);
 					}
-					XML_SetCharacterDataHandler(plcontext->parser, character_data_handler);
 				}
 			} else {
 				unexpected_element(plcontext, name);
@@ -730,9 +1095,9 @@ static void CP_XMLCALL start_element_handler(
 						} else {
 							ns = plcontext->imports_size * 2;
 						}
-						if ((ni = realloc(plcontext->plugin->imports,
+						if ((ni = parser_grow(plcontext, plcontext->plugin->imports,
+								plcontext->imports_size * sizeof(cp_plugin_import_t),
 								ns * sizeof(cp_plugin_import_t))) == NULL) {
-							resource_error(plcontext);
 							break;
 						}
 						plcontext->plugin->imports = ni;
@@ -748,7 +1113,7 @@ static void CP_XMLCALL start_element_handler(
 					for (i = 0; atts[i] != NULL; i += 2) {
 						if (!strcmp(atts[i], req_import_atts[0])) {
 							import->plugin_id
-								= parser_strdup(plcontext, atts[i+1]);
+								= parser_intern(plcontext, atts[i+1]);
 						} else if (!strcmp(atts[i], "version")) {
 							import->version = parser_strdup(plcontext, atts[i+1]);
 						} else if (!strcmp(atts[i], "optional")) {
@@ -770,6 +1135,14 @@ static void CP_XMLCALL start_element_handler(
 
 		case PARSER_EXTENSION:
 			plcontext->depth++;
+			if (plcontext->recording) {
+				record_start_tag(plcontext);
+			}
+			if (plcontext->stream.start_element != NULL
+				&& plcontext->stream.start_element(plcontext->stream_data, current_extension(plcontext),
+					name, (const char * const *) atts, plcontext->depth)) {
+				stream_rejected(plcontext);
+			}
 			if (plcontext->configuration != NULL && plcontext->skippedCEs == 0) {
 				cp_cfg_element_t *ce;
 				
@@ -777,18 +1150,26 @@ static void CP_XMLCALL start_element_handler(
 				if (plcontext->configuration->num_children == plcontext->configuration->index) {
 					cp_cfg_element_t *nce;
 					size_t ns;
+					unsigned int i, j;
 						
 					if (plcontext->configuration->index == 0) {
-						ns = 16;
+						ns = 4;
 					} else {
 						ns = plcontext->configuration->index * 2;
 					}
-					if ((nce = realloc(plcontext->configuration->children,
+					if ((nce = parser_grow(plcontext, plcontext->configuration->children,
+							plcontext->configuration->index * sizeof(cp_cfg_element_t),
 							ns * sizeof(cp_cfg_element_t))) == NULL) {
 						plcontext->skippedCEs++;
-						resource_error(plcontext);
 						break;
 					}
+					
+					// Update the parent pointers of the moved children
+					for (i = 0; i < plcontext->configuration->num_children; i++) {
+						for (j = 0; j < nce[i].num_children; j++) {
+							nce[i].children[j].parent = nce + i;
+						}
+					}
 					plcontext->configuration->children = nce;
 					plcontext->configuration->index = ns;
 				}
@@ -830,53 +1211,12 @@ static void CP_XMLCALL end_element_handler(
 
 		case PARSER_PLUGIN:
 			if (!strcmp(name, plcontext->context->env->plugin_descriptor_root_element)) {
-				
-				// Readjust memory allocated for extension points, if necessary 
-				if (plcontext->ext_points_size != plcontext->plugin->num_ext_points) {
-					cp_ext_point_t *nep;
-					
-					if ((nep = realloc(plcontext->plugin->ext_points,
-							plcontext->plugin->num_ext_points *
-								sizeof(cp_ext_point_t))) != NULL
-						|| plcontext->plugin->num_ext_points == 0) {
-						plcontext->plugin->ext_points = nep;
-						plcontext->ext_points_size = plcontext->plugin->num_ext_points;
-					}
-				}
-				
-				// Readjust memory allocated for extensions, if necessary 
-				if (plcontext->extensions_size != plcontext->plugin->num_extensions) {
-					cp_extension_t *ne;
-					
-					if ((ne = realloc(plcontext->plugin->extensions,
-							plcontext->plugin->num_extensions *
-								sizeof(cp_extension_t))) != NULL
-						|| plcontext->plugin->num_extensions == 0) {
-						plcontext->plugin->extensions = ne;
-						plcontext->extensions_size = plcontext->plugin->num_extensions;
-					}					
-				}
-				
 				plcontext->state = PARSER_END;
 			}
 			break;
 
 		case PARSER_REQUIRES:
 			if (!strcmp(name, "requires")) {
-				
-				// Readjust memory allocated for imports, if necessary 
-				if (plcontext->imports_size != plcontext->plugin->num_imports) {
-					cp_plugin_import_t *ni;
-					
-					if ((ni = realloc(plcontext->plugin->imports,
-							plcontext->plugin->num_imports *
-								sizeof(cp_plugin_import_t))) != NULL
-						|| plcontext->plugin->num_imports == 0) {
-						plcontext->plugin->imports = ni;
-						plcontext->imports_size = plcontext->plugin->num_imports;
-					}
-				}
-				
 				plcontext->state = PARSER_PLUGIN;
 			}
 			break;
@@ -888,22 +1228,17 @@ static void CP_XMLCALL end_element_handler(
 			break;
 
 		case PARSER_EXTENSION:
+			if (plcontext->recording) {
+				record_end_tag(plcontext);
+			}
+			if (plcontext->stream.end_element != NULL
+				&& plcontext->stream.end_element(plcontext->stream_data, current_extension(plcontext),
+					name, plcontext->depth)) {
+				stream_rejected(plcontext);
+			}
 			if (plcontext->skippedCEs > 0) {
 				plcontext->skippedCEs--;
 			} else if (plcontext->configuration != NULL) {
-				
-				// Readjust memory allocated for children, if necessary 
-				if (plcontext->configuration->index != plcontext->configuration->num_children) {
-					cp_cfg_element_t *nce;
-					
-					if ((nce = realloc(plcontext->configuration->children,
-							plcontext->configuration->num_children *
-								sizeof(cp_cfg_element_t))) != NULL
-						|| plcontext->configuration->num_children == 0) {
-						plcontext->configuration->children = nce;
-					}
-				}
-				
 				if (plcontext->configuration->parent != NULL) {
 					plcontext->configuration->index = plcontext->configuration->parent->num_children - 1;
 				} else {
@@ -920,7 +1255,7 @@ static void CP_XMLCALL end_element_handler(
 						}
 					}
 					if (i  < 0) {
-						free(plcontext->value);
+						cpi_free(plcontext->value);
 						plcontext->value = NULL;
 						plcontext->value_length = 0;
 						plcontext->value_size = 0;
@@ -930,17 +1265,10 @@ static void CP_XMLCALL end_element_handler(
 				}
 				if (plcontext->value != NULL) {
 					
-					// Readjust memory allocated for value, if necessary 
-					if (plcontext->value_size > plcontext->value_length + 1) {
-						char *nv;
-						
-						if ((nv = realloc(plcontext->value, (plcontext->value_length + 1) * sizeof(char))) != NULL) {
-							plcontext->value = nv;
-						}
-					}
-					
+					// Copy the value from the buffer to the plug-in
 					plcontext->value[plcontext->value_length] = '\0';
-					plcontext->configuration->value = plcontext->value;
+					plcontext->configuration->value = parser_strdup(plcontext, plcontext->value);
+					cpi_free(plcontext->value);
 					plcontext->value = NULL;
 					plcontext->value_size = 0;
 					plcontext->value_length = 0;
@@ -963,6 +1291,27 @@ static void CP_XMLCALL end_element_handler(
 				assert(!strcmp(name, "extension"));
 				plcontext->state = PARSER_PLUGIN;
 				XML_SetCharacterDataHandler(plcontext->parser, NULL);
+				if (plcontext->streaming) {
+					plcontext->streaming = 0;
+					memset(&(plcontext->stream), 0, sizeof(cp_cfg_stream_t));
+				}
+				
+				// Store the recorded configuration source
+				if (plcontext->recording) {
+					cp_extension_t *extension = plcontext->plugin->extensions
+						+ plcontext->plugin->num_extensions - 1;
+					char *src;
+					
+					plcontext->recording = 0;
+					XML_SetDefaultHandler(plcontext->parser, NULL);
+					if ((src = parser_malloc(plcontext, (plcontext->source_length + 1) * sizeof(char))) != NULL) {
+						memcpy(src, plcontext->source, plcontext->source_length * sizeof(char));
+						src[plcontext->source_length] = '\0';
+						if (cpi_set_cfg_source(extension, src) != CP_OK) {
+							resource_error(plcontext);
+						}
+					}
+				}
 			}
 			break;
 			
@@ -977,6 +1326,151 @@ static void dealloc_plugin_info(cp_context_t *ctx, cp_plugin_info_t *plugin) {
 	cpi_free_plugin(plugin);
 }
 
+/**
+ * Deallocates shared plug-in information and removes it from the shared
+ * descriptor table unless it has already been replaced there. Called with
+ * the framework locked.
+ * 
+ * @param ctx the plug-in context releasing the last reference
+ * @param plugin the plug-in information
+ */
+static void dealloc_shared_plugin_info(cp_context_t *ctx, cp_plugin_info_t *plugin) {
+	hnode_t *node;
+	
+	if (shared_descriptor_table != NULL
+		&& (node = hash_lookup(shared_descriptor_table, plugin->plugin_path)) != NULL) {
+		shared_descriptor_t *sd = hnode_get(node);
+		
+		if (sd->plugin == plugin) {
+			hash_delete_free(shared_descriptor_table, node);
+			cpi_free(sd);
+		}
+	}
+	cpi_free_plugin(plugin);
+}
+
+/**
+ * Returns the shared descriptor for the specified plug-in path if it
+ * matches the status of the descriptor file and the descriptor settings of
+ * the plug-in context. The caller must have locked the framework.
+ * 
+ * @param context the plug-in context
+ * @param path the plug-in path
+ * @param st the status of the plug-in descriptor file
+ * @return the shared descriptor, or NULL if there is no up to date one
+ */
+static shared_descriptor_t *find_shared_descriptor(cp_context_t *context, const char *path, const struct stat *st) {
+	hnode_t *node;
+	shared_descriptor_t *sd;
+	
+	if (shared_descriptor_table == NULL
+		|| (node = hash_lookup(shared_descriptor_table, path)) == NULL) {
+		return NULL;
+	}
+	sd = hnode_get(node);
+	if (sd->mtime != (unsigned long long) st->st_mtime
+		|| sd->size != (unsigned long long) st->st_size
+		|| strcmp(sd->descriptor_name, context->env->plugin_descriptor_name)
+		|| strcmp(sd->root_element, context->env->plugin_descriptor_root_element)) {
+		return NULL;
+	}
+	return sd;
+}
+
+/**
+ * Returns a new reference to the shared plug-in information for the
+ * specified plug-in path, if there is an up to date one.
+ * 
+ * @param context the plug-in context
+ * @param path the plug-in path
+ * @param st the status of the plug-in descriptor file
+ * @return the shared plug-in information, or NULL if none
+ */
+static cp_plugin_info_t *use_shared_descriptor(cp_context_t *context, const char *path, const struct stat *st) {
+	shared_descriptor_t *sd;
+	cp_plugin_info_t *plugin = NULL;
+	
+	cpi_lock_framework();
+	if ((sd = find_shared_descriptor(context, path, st)) != NULL) {
+		plugin = sd->plugin;
+		cpi_use_info(context, plugin);
+	}
+	cpi_unlock_framework();
+	return plugin;
+}
+
+/**
+ * Publishes newly parsed shared plug-in information in the shared
+ * descriptor table, replacing an out of date entry. If another context has
+ * concurrently published up to date information for the same plug-in,
+ * the new information is released and a reference to the published one is
+ * returned instead. Failing to publish only prevents later sharing.
+ * 
+ * @param context the plug-in context
+ * @param plugin the newly parsed plug-in information
+ * @param st the status of the plug-in descriptor file
+ * @return the plug-in information to be used
+ */
+static cp_plugin_info_t *publish_shared_descriptor(cp_context_t *context, cp_plugin_info_t *plugin, const struct stat *st) {
+	const char *name = context->env->plugin_descriptor_name;
+	const char *root = context->env->plugin_descriptor_root_element;
+	shared_descriptor_t *sd;
+	cp_plugin_info_t *published = NULL;
+	hnode_t *node;
+	size_t path_len, name_len, root_len;
+	
+	cpi_lock_framework();
+	do {
+		
+		// Use up to date information published concurrently
+		if ((sd = find_shared_descriptor(context, plugin->plugin_path, st)) != NULL) {
+			published = sd->plugin;
+			cpi_use_info(context, published);
+			break;
+		}
+		
+		// Drop an out of date entry
+		if (shared_descriptor_table == NULL
+			&& (shared_descriptor_table = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+			break;
+		}
+		if ((node = hash_lookup(shared_descriptor_table, plugin->plugin_path)) != NULL) {
+			sd = hnode_get(node);
+			hash_delete_free(shared_descriptor_table, node);
+			cpi_free(sd);
+		}
+		
+		// Add a new entry
+		path_len = strlen(plugin->plugin_path) + 1;
+		name_len = strlen(name) + 1;
+		root_len = strlen(root) + 1;
+		if ((sd = cpi_malloc(sizeof(shared_descriptor_t) + path_len + name_len + root_len)) == NULL) {
+			break;
+		}
+		sd->path = (char *) (sd + 1);
+		memcpy(sd->path, plugin->plugin_path, path_len);
+		sd->descriptor_name = sd->path + path_len;
+		memcpy(sd->descriptor_name, name, name_len);
+		sd->root_element = sd->descriptor_name + name_len;
+		memcpy(sd->root_element, root, root_len);
+		sd->mtime = st->st_mtime;
+		sd->size = st->st_size;
+		sd->plugin = plugin;
+		if (!hash_alloc_insert(shared_descriptor_table, sd->path, sd)) {
+			cpi_free(sd);
+		}
+		
+	} while (0);
+	cpi_unlock_framework();
+	
+	// Release the new information if it was not published
+	if (published != NULL) {
+		cpi_release_info(context, plugin);
+		return published;
+	}
+	return plugin;
+}
+
 static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_context_t **plcontextptr, XML_Parser *parserptr, char *file) {
 	XML_Parser parser;
 	ploader_context_t *plcontext;
@@ -991,11 +1485,11 @@ static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_contex
 		end_element_handler);
 		
 	// Initialize the parsing context 
-	if ((*plcontextptr = plcontext = malloc(sizeof(ploader_context_t))) == NULL) {
+	if ((*plcontextptr = plcontext = cpi_malloc(sizeof(ploader_context_t))) == NULL) {
 		return CP_ERR_RESOURCE;
 	}
 	memset(plcontext, 0, sizeof(ploader_context_t));
-	if ((plcontext->plugin = malloc(sizeof(cp_plugin_info_t))) == NULL) {
+	if ((plcontext->plugin = cpi_new_plugin(0)) == NULL) {
 		return CP_ERR_RESOURCE;
 	}
 	plcontext->context = context;
@@ -1004,7 +1498,6 @@ static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_contex
 	plcontext->parser = parser;
 	plcontext->file = file;
 	plcontext->state = PARSER_BEGIN;
-	memset(plcontext->plugin, 0, sizeof(cp_plugin_info_t));
 	plcontext->plugin->name = NULL;
 	plcontext->plugin->identifier = NULL;
 	plcontext->plugin->version = NULL;
@@ -1016,6 +1509,8 @@ static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_contex
 	plcontext->plugin->imports = NULL;
 	plcontext->plugin->runtime_lib_name = NULL;
 	plcontext->plugin->runtime_funcs_symbol = NULL;
+	plcontext->plugin->runtime_symbols_symbol = NULL;
+	plcontext->plugin->lazy_activation = 0;
 	plcontext->plugin->ext_points = NULL;
 	plcontext->plugin->extensions = NULL;
 	XML_SetUserData(parser, plcontext);
@@ -1023,12 +1518,21 @@ static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_contex
 	return CP_OK;
 }
 
-static cp_status_t do_descriptor_parsing(XML_Parser parser, cp_context_t *context, ploader_context_t *plcontext, char *file, unsigned int buffer_len) {
+/**
+ * Parses descriptor data. If @a buffer is NULL, the data is parsed from the
+ * Expat buffer and zero length denotes the end of data. Otherwise the
+ * specified buffer is parsed as the complete descriptor.
+ */
+static cp_status_t do_descriptor_parsing(XML_Parser parser, cp_context_t *context, ploader_context_t *plcontext, char *file, const char *buffer, unsigned int buffer_len) {
 	int i;
 
 	// Parse the data 
-	if (!(i = XML_ParseBuffer(parser, buffer_len, buffer_len == 0))
-		&& context != NULL) {
+	if (buffer != NULL) {
+		i = XML_Parse(parser, buffer, buffer_len, 1);
+	} else {
+		i = XML_ParseBuffer(parser, buffer_len, buffer_len == 0);
+	}
+	if (!i && context != NULL) {
 		cpi_lock_context(context);
 		cpi_errorf(context,
 			N_("XML parsing error in %s, line %d, column %d (%s)."),
@@ -1059,17 +1563,55 @@ static cp_status_t finish_descriptor_parsing(cp_status_t status, cp_context_t *c
 	}
 
 	// Initialize the plug-in path 
-	plcontext->plugin->plugin_path = *path;
+	if ((plcontext->plugin->plugin_path = cpi_plugin_strdup(plcontext->plugin, *path)) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	cpi_free(*path);
 	*path = NULL;
 
+	// Pre-parse the versions for comparisons
+	if ((status = cpi_parse_plugin_versions(plcontext->plugin)) != CP_OK) {
+		return status;
+	}
+
 	// Increase plug-in usage count
-	status = cpi_register_info(context, plcontext->plugin, (void (*)(cp_context_t *, void *)) dealloc_plugin_info);
+	if (plcontext->shared) {
+		status = cpi_register_shared_info(context, plcontext->plugin, (void (*)(cp_context_t *, void *)) dealloc_shared_plugin_info);
+	} else {
+		status = cpi_register_info(context, plcontext->plugin, (void (*)(cp_context_t *, void *)) dealloc_plugin_info);
+	}
 	return status;
 
 }
 
+/**
+ * Releases the buffered values of unfinished parent configuration elements
+ * after parsing has failed. These are not allocated for the plug-in.
+ * 
+ * @param context the parsing context
+ */
+static void release_parent_values(ploader_context_t *plcontext) {
+	cp_cfg_element_t *ce;
+	
+	if (plcontext->configuration != NULL) {
+		for (ce = plcontext->configuration->parent; ce != NULL; ce = ce->parent) {
+			cpi_free(ce->value);
+			ce->value = NULL;
+		}
+	}
+}
+
 static void check_cleanup_descriptor_parsing(cp_status_t status, cp_context_t *context, ploader_context_t *plcontext, XML_Parser parser, const char *path, char *file, cp_plugin_info_t **plugin) {
 
+	// Report the end of loading
+	if (status == CP_OK) {
+		const char *id = (plcontext != NULL ? plcontext->plugin : *plugin)->identifier;
+		
+		cpi_trace(context, load_end, CP_TRACE_LOAD_END, id, path, status);
+	} else {
+		cpi_trace(context, load_end, CP_TRACE_LOAD_END, NULL, path, status);
+	}
+
 	// Report possible errors
 	if (status != CP_OK) {
 		switch (status) {
@@ -1096,7 +1638,10 @@ static void check_cleanup_descriptor_parsing(cp_status_t status, cp_context_t *c
 	// Release persistently allocated data on failure 
 	if (status != CP_OK) {
 		if (file != NULL) {
-			free(file);
+			cpi_free(file);
+		}
+		if (plcontext != NULL) {
+			release_parent_values(plcontext);
 		}
 		if (plcontext != NULL && plcontext->plugin != NULL) {
 			cpi_free_plugin(plcontext->plugin);
@@ -1104,8 +1649,8 @@ static void check_cleanup_descriptor_parsing(cp_status_t status, cp_context_t *c
 		}
 	}
 	
-	// Otherwise copy the plug-in pointer
-	else {
+	// Otherwise copy the plug-in pointer, unless loaded from the cache
+	else if (plcontext != NULL) {
 		*plugin = plcontext->plugin;
 	}
 
@@ -1115,9 +1660,10 @@ static void check_cleanup_descriptor_parsing(cp_status_t status, cp_context_t *c
 	}
 	if (plcontext != NULL) {
 		if (plcontext->value != NULL) {
-			free(plcontext->value);
+			cpi_free(plcontext->value);
 		}
-		free(plcontext);
+		cpi_free(plcontext->source);
+		cpi_free(plcontext);
 		plcontext = NULL;
 	}
 
@@ -1130,11 +1676,16 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, con
 	XML_Parser parser = NULL;
 	ploader_context_t *plcontext = NULL;
 	cp_plugin_info_t *plugin = NULL;
+	struct stat st;
+	int use_cache = 0;
+	int shared = 0;
+	cp_timing_t timing = { 0, 0 };
 
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(path);
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_trace(context, load_begin, CP_TRACE_LOAD_BEGIN, NULL, path, CP_OK);
 	do {
 		int path_len;
 
@@ -1147,7 +1698,7 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, con
 		if (path[path_len - 1] == CP_FNAMESEP_CHAR) {
 			path_len--;
 		}
-		file = malloc((path_len + strlen(context->env->plugin_descriptor_name) + 2) * sizeof(char));
+		file = cpi_malloc((path_len + strlen(context->env->plugin_descriptor_name) + 2) * sizeof(char));
 		if (file == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
@@ -1156,47 +1707,126 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, con
 		file[path_len] = CP_FNAMESEP_CHAR;
 		strcpy(file + path_len + 1, context->env->plugin_descriptor_name);
 
-		// Open the file 
-		if ((fh = fopen(file, "rb")) == NULL) {
-			status = CP_ERR_IO;
-			break;
-		}
-
-		// Initialize descriptor parsing
-		status = init_descriptor_parsing(context, &plcontext, &parser, file);
-		if (status != CP_OK) {
-			break;
-		}
-
-		// Parse the plug-in descriptor 
-		while (1) {
-			unsigned int bytes_read;
-			void *xml_buffer;
+		// Use shared or cached plug-in information if it is up to date
+		shared = (context->env->shared_descriptors && hash_isempty(context->env->cfg_streams));
+		if ((context->env->descriptor_cache != NULL || shared)
+			&& hash_isempty(context->env->cfg_streams)
+			&& !stat(file, &st)) {
+			cp_plugin_info_t *cached;
 			
-			// Get buffer from Expat 
-			if ((xml_buffer = XML_GetBuffer(parser, CP_XML_PARSER_BUFFER_SIZE))
-				== NULL) {
-				status = CP_ERR_RESOURCE;
+			use_cache = 1;
+			file[path_len] = '\0';
+			if (shared && (cached = use_shared_descriptor(context, file, &st)) != NULL) {
+				plugin = cached;
+				cpi_free(file);
+				file = NULL;
 				break;
 			}
-			
-			// Read data into buffer 
-			bytes_read = fread(xml_buffer, 1, CP_XML_PARSER_BUFFER_SIZE, fh);
-			if (ferror(fh)) {
+			if (!shared && (cached = cpi_get_cached_descriptor(context, file, &st)) != NULL) {
+				if ((cached->plugin_path = cpi_plugin_strdup(cached, file)) == NULL) {
+					status = CP_ERR_RESOURCE;
+				} else {
+					status = cpi_register_info(context, cached, (void (*)(cp_context_t *, void *)) dealloc_plugin_info);
+				}
+				if (status != CP_OK) {
+					cpi_free_plugin(cached);
+				} else {
+					plugin = cached;
+					cpi_free(file);
+					file = NULL;
+				}
+				break;
+			}
+			file[path_len] = CP_FNAMESEP_CHAR;
+		} else {
+			shared = 0;
+		}
+
+		/*
+		 * Parse the descriptor without holding the context lock so that
+		 * several descriptors can be parsed concurrently. The context is
+		 * locked again for logging and for registering the result.
+		 */
+		cpi_timing_begin(context, timing);
+		cpi_unlock_context(context);
+		do {
+
+			// Open the file 
+			if ((fh = fopen(file, "rb")) == NULL) {
 				status = CP_ERR_IO;
 				break;
 			}
 
-			// Parse the data 
-			status = do_descriptor_parsing(parser, context, plcontext, file, bytes_read);
-			if (status != CP_OK || bytes_read == 0) {
+			// Initialize descriptor parsing
+			status = init_descriptor_parsing(context, &plcontext, &parser, file);
+			if (status != CP_OK) {
 				break;
 			}
-		}
+			plcontext->shared = shared;
+
+#ifdef CP_USE_MMAP
+			// Parse a regular file in a single pass from a memory mapping
+			{
+				struct stat fst;
+				void *map;
+				
+				if (!fstat(fileno(fh), &fst)
+					&& S_ISREG(fst.st_mode)
+					&& fst.st_size > 0
+					&& fst.st_size <= INT_MAX
+					&& (map = mmap(NULL, fst.st_size, PROT_READ, MAP_PRIVATE, fileno(fh), 0)) != MAP_FAILED) {
+					status = do_descriptor_parsing(parser, context, plcontext, file, map, fst.st_size);
+					munmap(map, fst.st_size);
+					break;
+				}
+			}
+#endif
+
+			// Otherwise parse the plug-in descriptor as a stream
+			while (1) {
+				unsigned int bytes_read;
+				void *xml_buffer;
+				
+				// Get buffer from Expat 
+				if ((xml_buffer = XML_GetBuffer(parser, CP_XML_PARSER_BUFFER_SIZE))
+					== NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				
+				// Read data into buffer 
+				bytes_read = fread(xml_buffer, 1, CP_XML_PARSER_BUFFER_SIZE, fh);
+				if (ferror(fh)) {
+					status = CP_ERR_IO;
+					break;
+				}
+
+				// Parse the data 
+				status = do_descriptor_parsing(parser, context, plcontext, file, NULL, bytes_read);
+				if (status != CP_OK || bytes_read == 0) {
+					break;
+				}
+			}
+		} while (0);
+		cpi_lock_context(context);
 
 		// Finish parsing
 		*(file + path_len) = '\0';
 		status = finish_descriptor_parsing(status, context, plcontext, &file);
+		cpi_timing_end(context, timing, &context->env->timings.parse_total);
+		if (status == CP_OK) {
+			*cpi_parse_timing(plcontext->plugin) = timing;
+		}
+		
+		// Update the descriptor cache
+		if (status == CP_OK && use_cache) {
+			cpi_put_cached_descriptor(context, plcontext->plugin->plugin_path, &st, plcontext->plugin);
+		}
+		
+		// Share the plug-in information with other contexts
+		if (status == CP_OK && shared) {
+			plcontext->plugin = publish_shared_descriptor(context, plcontext->plugin, &st);
+		}
 	} while (0);
 
 	// Check and clean up
@@ -1220,14 +1850,16 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
 	XML_Parser parser = NULL;
 	ploader_context_t *plcontext = NULL;
 	cp_plugin_info_t *plugin = NULL;
+	cp_timing_t timing = { 0, 0 };
 
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(buffer);
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_trace(context, load_begin, CP_TRACE_LOAD_BEGIN, NULL, path, CP_OK);
 	do {
 		int path_len = 6;
-		file = malloc((path_len + 1) * sizeof(char));
+		file = cpi_malloc((path_len + 1) * sizeof(char));
 		if (file == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
@@ -1235,35 +1867,22 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
 		strcpy(file, path);
 
 		// Initialize descriptor parsing
+		cpi_timing_begin(context, timing);
 		status = init_descriptor_parsing(context, &plcontext, &parser, file);
 		if (status != CP_OK) {
 			break;
 		}
 
-		// Parse the plug-in descriptor 
-		do {
-			void *xml_buffer;
-  		
-			// Get buffer from Expat 
-			if ((xml_buffer = XML_GetBuffer(parser, buffer_len))
-					== NULL) {
-				status = CP_ERR_RESOURCE;
-				break;
-			}
-
-			// Read data into buffer
-			memcpy(xml_buffer, buffer, buffer_len);
-
-			// Parse the data 
-			status = do_descriptor_parsing(parser, context, plcontext, file, buffer_len);
-			if (status == CP_OK) {
-				status = do_descriptor_parsing(parser, context, plcontext, file, 0);
-			}
-		} while (0);
+		// Parse the plug-in descriptor directly from the buffer
+		status = do_descriptor_parsing(parser, context, plcontext, file, buffer, buffer_len);
 
 		// Finish parsing
 		*(file + path_len) = '\0';
 		status = finish_descriptor_parsing(status, context, plcontext, &file);
+		cpi_timing_end(context, timing, &context->env->timings.parse_total);
+		if (status == CP_OK) {
+			*cpi_parse_timing(plcontext->plugin) = timing;
+		}
 		
 	} while (0);
 
@@ -1277,3 +1896,158 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
 
 	return plugin;
 }
+
+CP_HIDDEN cp_status_t cpi_materialize_cfg(cp_context_t *context, cp_extension_t *ext) {
+	const char *source;
+	XML_Parser parser = NULL;
+	ploader_context_t plcontext;
+	cp_status_t status = CP_OK;
+	
+	assert(cpi_is_context_locked(context));
+	if ((source = cpi_get_cfg_source(ext)) == NULL) {
+		return CP_OK;
+	}
+	memset(&plcontext, 0, sizeof(ploader_context_t));
+	do {
+		
+		// Initialize the XML parsing
+		if ((parser = XML_ParserCreate(NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		XML_SetElementHandler(parser,
+			start_element_handler,
+			end_element_handler);
+		plcontext.context = context;
+		plcontext.parser = parser;
+		plcontext.file = (ext->plugin->plugin_path != NULL ?
+			ext->plugin->plugin_path : ext->plugin->identifier);
+		plcontext.plugin = ext->plugin;
+		plcontext.state = PARSER_PLUGIN;
+		plcontext.lazy_extension = ext;
+		XML_SetUserData(parser, &plcontext);
+		
+		// Parse the recorded configuration source
+		status = do_descriptor_parsing(parser, context, &plcontext, plcontext.file, source, strlen(source));
+		if (status == CP_OK) {
+			if (plcontext.state != PARSER_PLUGIN || plcontext.error_count > 0) {
+				status = CP_ERR_MALFORMED;
+			}
+			if (plcontext.resource_error_count > 0) {
+				status = CP_ERR_RESOURCE;
+			}
+		}
+		
+	} while (0);
+	
+	// Release the source once parsed, otherwise the partial tree
+	if (status == CP_OK) {
+		cpi_set_cfg_source(ext, NULL);
+	} else {
+		release_parent_values(&plcontext);
+		ext->configuration = NULL;
+		cpi_errorf(context,
+			N_("Configuration of extension %s in plug-in %s could not be parsed."),
+			ext->identifier != NULL ? ext->identifier : ext->ext_point_id,
+			ext->plugin->identifier);
+	}
+	
+	// Release data allocated for parsing
+	if (parser != NULL) {
+		XML_ParserFree(parser);
+	}
+	cpi_free(plcontext.value);
+	
+	return status;
+}
+
+CP_C_API cp_status_t cp_register_cfg_stream(cp_context_t *context, const char *extpt_id, const cp_cfg_stream_t *stream, void *user_data) {
+	cpi_cfg_stream_t *cs = NULL;
+	hnode_t *node;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(extpt_id);
+	CHECK_NOT_NULL(stream);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	
+	// Replace a previous consumer in place
+	if ((node = hash_lookup(context->env->cfg_streams, extpt_id)) != NULL) {
+		cs = hnode_get(node);
+		cs->funcs = *stream;
+		cs->user_data = user_data;
+		cs->plugin = context->plugin;
+	}
+	
+	// Otherwise register a new consumer
+	else if ((cs = cpi_malloc(sizeof(cpi_cfg_stream_t) + strlen(extpt_id) + 1)) == NULL) {
+		status = CP_ERR_RESOURCE;
+	} else {
+		cs->ext_point_id = (char *) (cs + 1);
+		strcpy(cs->ext_point_id, extpt_id);
+		cs->funcs = *stream;
+		cs->user_data = user_data;
+		cs->plugin = context->plugin;
+		if (!hash_alloc_insert(context->env->cfg_streams, cs->ext_point_id, cs)) {
+			cpi_free(cs);
+			status = CP_ERR_RESOURCE;
+		}
+	}
+	
+	// Report error
+	if (status != CP_OK) {
+		cpi_errorf(context, N_("Configuration stream for extension point %s could not be registered due to insufficient memory."), extpt_id);
+	}
+	cpi_unlock_context(context);
+	return status;
+}
+
+CP_C_API void cp_unregister_cfg_stream(cp_context_t *context, const char *extpt_id) {
+	hnode_t *node;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(extpt_id);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	if ((node = hash_lookup(context->env->cfg_streams, extpt_id)) != NULL) {
+		cpi_cfg_stream_t *cs = hnode_get(node);
+		
+		hash_delete_free(context->env->cfg_streams, node);
+		cpi_free(cs);
+	}
+	cpi_unlock_context(context);
+}
+
+CP_HIDDEN void cpi_unregister_cfg_streams(cp_plugin_env_t *env, cp_plugin_t *plugin) {
+	hscan_t scan;
+	hnode_t *node;
+	
+	hash_scan_begin(&scan, env->cfg_streams);
+	while ((node = hash_scan_next(&scan)) != NULL) {
+		cpi_cfg_stream_t *cs = hnode_get(node);
+		
+		if (plugin == NULL || cs->plugin == plugin) {
+			hash_scan_delfree(env->cfg_streams, node);
+			cpi_free(cs);
+		}
+	}
+}
+
+CP_HIDDEN void cpi_free_shared_descriptors(void) {
+	hscan_t scan;
+	hnode_t *node;
+	
+	if (shared_descriptor_table == NULL) {
+		return;
+	}
+	hash_scan_begin(&scan, shared_descriptor_table);
+	while ((node = hash_scan_next(&scan)) != NULL) {
+		shared_descriptor_t *sd = hnode_get(node);
+		
+		hash_scan_delfree(shared_descriptor_table, node);
+		cpi_free(sd);
+	}
+	hash_destroy(shared_descriptor_table);
+	shared_descriptor_table = NULL;
+}
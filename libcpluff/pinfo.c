@@ -31,6 +31,8 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
 #include <assert.h>
 #include "../kazlib/hash.h"
 #include "cpluff.h"
@@ -43,34 +45,142 @@
  * Data types
  * ----------------------------------------------------------------------*/
 
-/// Registration of a dynamically allocated information object
-typedef struct info_resource_t {
+/// A plug-in listener registration
+struct cpi_plistener_t {
+	
+	/// The plug-in listener, or NULL for a batch listener
+	cp_plugin_listener_func_t plugin_listener;
+	
+	/// The batch plug-in listener, or NULL for a plug-in listener
+	cp_plugin_batch_listener_func_t batch_listener;
+	
+	/// The batch listener flags
+	int flags;
+	
+	/// The mask of new states of interest, see ::CP_STATE_MASK
+	int state_mask;
+	
+	/// The registering plug-in or NULL for the client program
+	cp_plugin_t *plugin;
+	
+	/// Associated user data
+	void *user_data;
+	
+};
+
+/// A lookup index over the children and attributes of a configuration element
+typedef struct cfg_index_t {
+	
+	/// The children ordered by name and then by position
+	cp_cfg_element_t **children;
+	
+	/// Pointers to the attribute name and value pairs ordered by name
+	char ***atts;
+	
+} cfg_index_t;
 
-	/// Pointer to the resource
-	void *resource;	
+/// An index of the extensions of an extension point by a configuration value
+struct cp_extension_index_t {
+	
+	/// The interned extension point identifier
+	const char *ext_point_id;
+	
+	/// The path of the indexed configuration value
+	char *path;
+	
+	/// Maps interned configuration values to lists of indexed extensions
+	hash_t *values;
+	
+};
 
-	/// Usage count for the resource
-	int usage_count;
+/// A field of a registered configuration schema
+typedef struct cfg_field_t {
+	
+	/// The interned path of the configuration value
+	const char *path;
+	
+	/// The value type
+	cp_cfg_type_t type;
 	
-	/// Deallocation function
-	cpi_dealloc_func_t dealloc_func;
+	/// The offset of the record member
+	size_t offset;
 	
-} info_resource_t;
+	/// Whether the value is required
+	int required;
+	
+	/// The interned default value or NULL
+	const char *default_value;
+	
+	/// The NULL-terminated list of interned enumeration values or NULL
+	const char **values;
+	
+} cfg_field_t;
 
-/// A plug-in listener registration
-typedef struct el_holder_t {
+/// A configuration schema registered for an extension point
+typedef struct cfg_schema_t {
 	
-	/// The plug-in listener
-	cp_plugin_listener_func_t plugin_listener;
+	/// The interned extension point identifier
+	const char *ext_point_id;
 	
 	/// The registering plug-in or NULL for the client program
 	cp_plugin_t *plugin;
 	
-	/// Associated user data
-	void *user_data;
+	/// The record size rounded up to a multiple of the record alignment
+	size_t record_size;
+	
+	/// Number of fields in the @ref fields array
+	unsigned int num_fields;
 	
-} el_holder_t;
+	/// The fields, allocated in the same block as the schema
+	cfg_field_t *fields;
+	
+	/// Maps extensions to their configuration records
+	cpi_hmap_t *records;
+	
+} cfg_schema_t;
+
+/// A segment of a compiled configuration path
+typedef struct cfg_segment_t {
+	
+	/// The interned element name or NULL for the parent element
+	const char *name;
+	
+	/// The length of the element name
+	int len;
+	
+} cfg_segment_t;
+
+/// A compiled configuration path
+struct cp_cfg_path_t {
+	
+	/// Number of segments in the @ref segments array
+	unsigned int num_segments;
+	
+	/// The path segments
+	cfg_segment_t *segments;
+	
+	/// The attribute name or NULL if the path designates an element
+	const char *attribute;
+	
+};
+
+
+
+/* ------------------------------------------------------------------------
+ * Variables
+ * ----------------------------------------------------------------------*/
 
+/**
+ * Set of in-use information objects shared by plug-in contexts, or NULL if
+ * there are none. Protected by the framework lock.
+ */
+static cpi_hmap_t *shared_infos = NULL;
+
+/**
+ * Lookup indexes of configuration elements keyed by the element, or NULL
+ * if there are none. Protected by the framework lock.
+ */
+static cpi_hmap_t *cfg_indexes = NULL;
 
 
 /* ------------------------------------------------------------------------
@@ -79,111 +189,310 @@ typedef struct el_holder_t {
 
 // General information object management
 
+/// Magic value of the header of a registered information object
+#define INFO_MAGIC 0x43504946
+
+/// Magic value of the header of an information object shared by contexts
+#define SHARED_INFO_MAGIC 0x43505348
+
+CP_HIDDEN void *cpi_alloc_info(size_t size) {
+	cpi_info_header_t *header;
+	
+	if ((header = cpi_malloc(sizeof(cpi_info_header_t) + size)) == NULL) {
+		return NULL;
+	}
+	memset(header, 0, sizeof(cpi_info_header_t));
+	return header + 1;
+}
+
+CP_HIDDEN void cpi_free_info(void *res) {
+	cpi_free(cpi_info_header(res));
+}
+
+/**
+ * Locks the set of information objects of the specified context. The set
+ * is modified with shared access to the context if ::CP_SHARED_INFOS is
+ * defined, so it has a lock of its own then.
+ * 
+ * @param context the plug-in context
+ */
+static void lock_infos(cp_context_t *context) {
+#ifdef CP_SHARED_INFOS
+	cpi_lock_mutex(context->env->infos_mutex);
+#endif
+}
+
+/**
+ * Unlocks the set of information objects locked using ::lock_infos.
+ * 
+ * @param context the plug-in context
+ */
+static void unlock_infos(cp_context_t *context) {
+#ifdef CP_SHARED_INFOS
+	cpi_unlock_mutex(context->env->infos_mutex);
+#endif
+}
+
+/**
+ * Returns the header of the specified information object. The header is
+ * only accessed once the object has been found among the registered
+ * objects, so that unknown pointers are never dereferenced.
+ * 
+ * @param context the plug-in context
+ * @param res the information object
+ * @return the header or NULL if the object is not a registered information object
+ */
+static cpi_info_header_t *find_info_header(cp_context_t *context, void *res) {
+	void *found;
+	
+	lock_infos(context);
+	found = cpi_hmap_get(context->env->infos, res);
+	unlock_infos(context);
+	if (found == NULL) {
+		cpi_lock_framework();
+		if (shared_infos != NULL) {
+			found = cpi_hmap_get(shared_infos, res);
+		}
+		cpi_unlock_framework();
+	}
+	if (found == NULL) {
+		return NULL;
+	}
+	assert(cpi_info_header(res)->h.magic == INFO_MAGIC
+		|| cpi_info_header(res)->h.magic == SHARED_INFO_MAGIC);
+	return cpi_info_header(res);
+}
+
 CP_HIDDEN cp_status_t cpi_register_info(cp_context_t *context, void *res, cpi_dealloc_func_t df) {
-	cp_status_t status = CP_OK;
-	info_resource_t *ir = NULL;
+	cpi_info_header_t *header;
+	int registered;
 
 	assert(context != NULL);
 	assert(res != NULL);
 	assert(df != NULL);
 	assert(cpi_is_context_locked(context));
-	do {
-		if ((ir = malloc(sizeof(info_resource_t))) == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
-		ir->resource = res;
-		ir->usage_count = 1;
-		ir->dealloc_func = df;
-		if (!hash_alloc_insert(context->env->infos, res, ir)) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
-	} while (0);
-	
-	// Report success
+	header = cpi_info_header(res);
+	header->h.magic = INFO_MAGIC;
+	header->h.usage_count = 1;
+	header->h.dealloc_func = df;
+	lock_infos(context);
+	registered = cpi_hmap_put(context->env->infos, res, res);
+	unlock_infos(context);
+	if (!registered) {
+		header->h.magic = 0;
+		return CP_ERR_RESOURCE;
+	}
+	cpi_debugf(context, N_("Registered a new reference counted object at address %p."), res);
+	return CP_OK;
+}
+
+CP_HIDDEN cp_status_t cpi_register_shared_info(cp_context_t *context, void *res, cpi_dealloc_func_t df) {
+	cpi_info_header_t *header;
+	cp_status_t status = CP_OK;
+
+	assert(context != NULL);
+	assert(res != NULL);
+	assert(df != NULL);
+	header = cpi_info_header(res);
+	header->h.magic = SHARED_INFO_MAGIC;
+	header->h.usage_count = 1;
+	header->h.dealloc_func = df;
+	cpi_lock_framework();
+	if ((shared_infos == NULL
+			&& (shared_infos = cpi_create_hmap(cpi_comp_ptr, cpi_hashfunc_ptr)) == NULL)
+		|| !cpi_hmap_put(shared_infos, res, res)) {
+		header->h.magic = 0;
+		status = CP_ERR_RESOURCE;
+	}
+	cpi_unlock_framework();
 	if (status == CP_OK) {
-		cpi_debugf(context, N_("Registered a new reference counted object at address %p."), res);
-	}		
-	
-	// Release resources on failure
-	if (status != CP_OK) {
-		if (ir != NULL) {
-			free(ir);
-		}
+		cpi_debugf(context, N_("Registered a new shared reference counted object at address %p."), res);
 	}
-	
 	return status;
 }
 
+CP_HIDDEN int cpi_is_shared_info(void *res) {
+	return cpi_info_header(res)->h.magic == SHARED_INFO_MAGIC;
+}
+
 CP_HIDDEN void cpi_use_info(cp_context_t *context, void *res) {
-	hnode_t *node;
+	cpi_info_header_t *header;
+	int usage_count;
 	
 	assert(context != NULL);
 	assert(res != NULL);
 	assert(cpi_is_context_locked(context));
-	if ((node = hash_lookup(context->env->infos, res)) != NULL) {
-		info_resource_t *ir = hnode_get(node);
-		ir->usage_count++;
-		cpi_debugf(context, N_("Reference count of the object at address %p increased to %d."), res, ir->usage_count);
-	} else {
+	if ((header = find_info_header(context, res)) == NULL) {
 		cpi_fatalf(_("Attempt to increase the reference count of an unknown object at address %p."), res);
 	}
+	if (header->h.magic == SHARED_INFO_MAGIC) {
+		cpi_lock_framework();
+		usage_count = ++header->h.usage_count;
+		cpi_unlock_framework();
+	} else {
+#ifdef CP_ATOMIC_INFOS
+		usage_count = cpi_atomic_inc(&header->h.usage_count);
+#else
+		usage_count = ++header->h.usage_count;
+#endif
+	}
+	cpi_debugf(context, N_("Reference count of the object at address %p increased to %d."), res, usage_count);
 }
 
 CP_HIDDEN void cpi_release_info(cp_context_t *context, void *info) {
-	hnode_t *node;
+	cpi_info_header_t *header;
+	int usage_count;
 	
 	assert(context != NULL);
 	assert(info != NULL);
 	assert(cpi_is_context_locked(context));
-	if ((node = hash_lookup(context->env->infos, info)) != NULL) {
-		info_resource_t *ir = hnode_get(node);
-		assert(ir != NULL && info == ir->resource);
-		ir->usage_count--;
-		cpi_debugf(context, N_("Reference count of the object at address %p decreased to %d."), info, ir->usage_count);
-		if (ir->usage_count == 0) {
-			hash_delete_free(context->env->infos, node);
-			ir->dealloc_func(context, info);
+	if ((header = find_info_header(context, info)) == NULL) {
+		cpi_fatalf(_("Attempt to release an unknown reference counted object at address %p."), info);
+	}
+	
+	/*
+	 * Objects shared by several contexts are counted under the framework
+	 * lock so that the last release and the deallocation can not race with
+	 * another context acquiring the object.
+	 */
+	if (header->h.magic == SHARED_INFO_MAGIC) {
+		cpi_lock_framework();
+		if ((usage_count = --header->h.usage_count) == 0) {
+			cpi_hmap_remove(shared_infos, info);
+			if (cpi_hmap_count(shared_infos) == 0) {
+				cpi_destroy_hmap(shared_infos);
+				shared_infos = NULL;
+			}
+			header->h.magic = 0;
+			header->h.dealloc_func(context, info);
+		}
+		cpi_unlock_framework();
+		cpi_debugf(context, N_("Reference count of the object at address %p decreased to %d."), info, usage_count);
+		if (usage_count == 0) {
 			cpi_debugf(context, N_("Deallocated the reference counted object at address %p."), info);
-			free(ir);
 		}
-	} else {
-		cpi_fatalf(_("Attempt to release an unknown reference counted object at address %p."), info);
+		return;
+	}
+#ifdef CP_ATOMIC_INFOS
+	usage_count = cpi_atomic_dec(&header->h.usage_count);
+#else
+	usage_count = --header->h.usage_count;
+#endif
+	cpi_debugf(context, N_("Reference count of the object at address %p decreased to %d."), info, usage_count);
+	if (usage_count == 0) {
+		lock_infos(context);
+		cpi_hmap_remove(context->env->infos, info);
+		unlock_infos(context);
+		header->h.magic = 0;
+		header->h.dealloc_func(context, info);
+		cpi_debugf(context, N_("Deallocated the reference counted object at address %p."), info);
 	}
 }
 
 CP_C_API void cp_release_info(cp_context_t *context, void *info) {
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(info);
-	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	
+#ifdef CP_SHARED_INFOS
+	/*
+	 * Drop a reference that is not the last one without locking the
+	 * context. The object is looked up first and the set of information
+	 * objects stays locked meanwhile, so the header is only accessed for a
+	 * registered object which can not be deallocated concurrently. The
+	 * last reference is released under the context lock so that the object
+	 * is deallocated normally.
+	 */
+	lock_infos(context);
+	if (cpi_hmap_get(context->env->infos, info) != NULL) {
+		int *usage_count = &cpi_info_header(info)->h.usage_count;
+		int count = cpi_atomic_load(usage_count);
+		
+		while (count > 1) {
+			if (cpi_atomic_cas(usage_count, &count, count - 1)) {
+				unlock_infos(context);
+				return;
+			}
+		}
+	}
+	unlock_infos(context);
+#endif
+	
+	cpi_lock_context(context);
 	cpi_release_info(context, info);
 	cpi_unlock_context(context);
 }
 
 CP_HIDDEN void cpi_release_infos(cp_context_t *context) {
-	hscan_t scan;
-	hnode_t *node;
+	cpi_hmap_scan_t scan;
+	void *res;
 		
-	hash_scan_begin(&scan, context->env->infos);
-	while ((node = hash_scan_next(&scan)) != NULL) {
-		info_resource_t *ir = hnode_get(node);			
+	cpi_hmap_scan_begin(&scan, context->env->infos);
+	while ((res = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
 		cpi_lock_context(context);
-		cpi_errorf(context, N_("An unreleased information object was encountered at address %p with reference count %d when destroying the associated plug-in context. Not releasing the object."), ir->resource, ir->usage_count);
+		cpi_errorf(context, N_("An unreleased information object was encountered at address %p with reference count %d when destroying the associated plug-in context. Not releasing the object."), res, cpi_info_header(res)->h.usage_count);
 		cpi_unlock_context(context);
-		hash_scan_delfree(context->env->infos, node);
-		free(ir);
+		cpi_hmap_remove(context->env->infos, res);
 	}
 }
 
 
 // Information acquiring functions
 
+/**
+ * Locks the context for returning information objects. Shared access is
+ * used if information objects can be used and registered without
+ * modifying the environment and no debug messages would be logged.
+ * 
+ * @param context the plug-in context
+ * @return whether the context was locked in shared mode
+ */
+static int lock_context_for_infos(cp_context_t *context) {
+#ifdef CP_SHARED_INFOS
+	cpi_lock_context_shared(context);
+	if (!cpi_is_logged(context, CP_LOG_DEBUG)) {
+		return 1;
+	}
+	cpi_unlock_context_shared(context);
+#endif
+	cpi_lock_context(context);
+	return 0;
+}
+
+/**
+ * Switches to exclusive access if the context was locked in shared mode,
+ * for example to log a message.
+ * 
+ * @param context the plug-in context
+ * @param shared pointer to the flag returned by ::lock_context_for_infos
+ */
+static void relock_context_exclusive(cp_context_t *context, int *shared) {
+	if (*shared) {
+		cpi_unlock_context_shared(context);
+		cpi_lock_context(context);
+		*shared = 0;
+	}
+}
+
+/**
+ * Unlocks the context locked using ::lock_context_for_infos.
+ * 
+ * @param context the plug-in context
+ * @param shared whether the context is locked in shared mode
+ */
+static void unlock_context_for_infos(cp_context_t *context, int shared) {
+	if (shared) {
+		cpi_unlock_context_shared(context);
+	} else {
+		cpi_unlock_context(context);
+	}
+}
+
 CP_C_API cp_plugin_info_t * cp_get_plugin_info(cp_context_t *context, const char *id, cp_status_t *error) {
-	hnode_t *node;
+	cp_plugin_t *rp;
 	cp_plugin_info_t *plugin = NULL;
 	cp_status_t status = CP_OK;
+	int shared;
 
 	CHECK_NOT_NULL(context);
 	if (id == NULL && context->plugin == NULL) {
@@ -191,25 +500,26 @@ CP_C_API cp_plugin_info_t * cp_get_plugin_info(cp_context_t *context, const char
 	}
 
 	// Look up the plug-in and return information 
-	cpi_lock_context(context);
+	shared = lock_context_for_infos(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
 	do {
 		
 		// Lookup plug-in information
 		if (id != NULL) {
-			if ((node = hash_lookup(context->env->plugins, id)) == NULL) {
+			if ((rp = cpi_hmap_get(context->env->plugins, id)) == NULL) {
+				relock_context_exclusive(context, &shared);
 				cpi_warnf(context, N_("Could not return information about unknown plug-in %s."), id);
 				status = CP_ERR_UNKNOWN;
 				break;
 			}
-			plugin = ((cp_plugin_t *) hnode_get(node))->plugin;
+			plugin = rp->plugin;
 		} else {
 			plugin = context->plugin->plugin;
 			assert(plugin != NULL);
 		}
 		cpi_use_info(context, plugin);
 	} while (0);
-	cpi_unlock_context(context);
+	unlock_context_for_infos(context, shared);
 
 	if (error != NULL) {
 		*error = status;
@@ -225,35 +535,34 @@ static void dealloc_plugins_info(cp_context_t *context, cp_plugin_info_t **plugi
 	for (i = 0; plugins[i] != NULL; i++) {
 		cpi_release_info(context, plugins[i]);
 	}
-	free(plugins);
+	cpi_free_info(plugins);
 }
 
 CP_C_API cp_plugin_info_t ** cp_get_plugins_info(cp_context_t *context, cp_status_t *error, int *num) {
 	cp_plugin_info_t **plugins = NULL;
 	int i, n;
 	cp_status_t status = CP_OK;
+	int shared;
 	
 	CHECK_NOT_NULL(context);
 	
-	cpi_lock_context(context);
+	shared = lock_context_for_infos(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
 	do {
-		hscan_t scan;
-		hnode_t *node;
+		cpi_hmap_scan_t scan;
+		cp_plugin_t *rp;
 		
 		// Allocate space for pointer array 
-		n = hash_count(context->env->plugins);
-		if ((plugins = malloc(sizeof(cp_plugin_info_t *) * (n + 1))) == NULL) {
+		n = cpi_hmap_count(context->env->plugins);
+		if ((plugins = cpi_alloc_info(sizeof(cp_plugin_info_t *) * (n + 1))) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
 		
 		// Get plug-in information structures 
-		hash_scan_begin(&scan, context->env->plugins);
+		cpi_hmap_scan_begin(&scan, context->env->plugins);
 		i = 0;
-		while ((node = hash_scan_next(&scan)) != NULL) {
-			cp_plugin_t *rp = hnode_get(node);
-			
+		while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
 			assert(i < n);
 			cpi_use_info(context, rp->plugin);
 			plugins[i] = rp->plugin;
@@ -268,9 +577,10 @@ CP_C_API cp_plugin_info_t ** cp_get_plugins_info(cp_context_t *context, cp_statu
 
 	// Report error
 	if (status != CP_OK) {
+		relock_context_exclusive(context, &shared);
 		cpi_error(context, N_("Plug-in information could not be returned due to insufficient memory."));
 	}
-	cpi_unlock_context(context);
+	unlock_context_for_infos(context, shared);
 
 	// Release resources on error 
 	if (status != CP_OK) {
@@ -292,138 +602,484 @@ CP_C_API cp_plugin_info_t ** cp_get_plugins_info(cp_context_t *context, cp_statu
 
 CP_C_API cp_plugin_state_t cp_get_plugin_state(cp_context_t *context, const char *id) {
 	cp_plugin_state_t state = CP_PLUGIN_UNINSTALLED;
-	hnode_t *hnode;
+	cp_plugin_t *rp;
 	
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(id);
 	
 	// Look up the plug-in state 
-	cpi_lock_context(context);
+	cpi_lock_context_shared(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
-	if ((hnode = hash_lookup(context->env->plugins, id)) != NULL) {
-		cp_plugin_t *rp = hnode_get(hnode);
+	if ((rp = cpi_hmap_get(context->env->plugins, id)) != NULL) {
 		state = rp->state;
 	}
-	cpi_unlock_context(context);
+	cpi_unlock_context_shared(context);
 	return state;
 }
 
-static void dealloc_ext_points_info(cp_context_t *context, cp_ext_point_t **ext_points) {
-	int i;
+/**
+ * Deallocates a plug-in handle and forgets it.
+ * 
+ * @param context the plug-in context
+ * @param handle the plug-in handle
+ */
+static void dealloc_plugin_handle(cp_context_t *context, cp_plugin_handle_t *handle) {
+	hnode_t *node;
+	cp_plugin_t *rp;
 	
-	assert(context != NULL);
-	assert(ext_points != NULL);
-	for (i = 0; ext_points[i] != NULL; i++) {
-		cpi_release_info(context, ext_points[i]->plugin);
+	if ((node = hash_lookup(context->env->plugin_handles, handle->identifier)) != NULL
+		&& hnode_get(node) == handle) {
+		hash_delete_free(context->env->plugin_handles, node);
 	}
-	free(ext_points);
+	if ((rp = cpi_hmap_get(context->env->plugins, handle->identifier)) != NULL
+		&& rp->handle == handle) {
+		rp->handle = NULL;
+	}
+	cpi_free(handle->identifier);
+	cpi_free_info(handle);
 }
 
-CP_C_API cp_ext_point_t ** cp_get_ext_points_info(cp_context_t *context, cp_status_t *error, int *num) {
-	cp_ext_point_t **ext_points = NULL;
-	int i, n;
+CP_C_API cp_plugin_handle_t * cp_get_plugin_handle(cp_context_t *context, const char *id, cp_status_t *error) {
+	cp_plugin_handle_t *handle = NULL;
 	cp_status_t status = CP_OK;
+	cp_plugin_t *rp;
+	hnode_t *node;
 	
 	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
 	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
 	do {
-		hscan_t scan;
-		hnode_t *node;
 		
-		// Allocate space for pointer array 
-		n = hash_count(context->env->ext_points);
-		if ((ext_points = malloc(sizeof(cp_ext_point_t *) * (n + 1))) == NULL) {
-			status = CP_ERR_RESOURCE;
+		// Share the existing handle of the plug-in identifier, if any
+		if (context->env->plugin_handles != NULL
+			&& (node = hash_lookup(context->env->plugin_handles, id)) != NULL) {
+			handle = hnode_get(node);
+			cpi_use_info(context, handle);
 			break;
 		}
 		
-		// Get extension point information structures 
-		hash_scan_begin(&scan, context->env->ext_points);
-		i = 0;
-		while ((node = hash_scan_next(&scan)) != NULL) {
-			cp_ext_point_t *ep = hnode_get(node);
-			
-			assert(i < n);
-			cpi_use_info(context, ep->plugin);
-			ext_points[i] = ep;
-			i++;
+		// Otherwise create a new handle
+		if (context->env->plugin_handles == NULL
+			&& (context->env->plugin_handles = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if ((handle = cpi_alloc_info(sizeof(cp_plugin_handle_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		handle->state = CP_PLUGIN_UNINSTALLED;
+		if ((handle->identifier = cpi_strdup(id)) == NULL
+			|| !hash_alloc_insert(context->env->plugin_handles, handle->identifier, handle)) {
+			cpi_free(handle->identifier);
+			cpi_free_info(handle);
+			handle = NULL;
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if ((status = cpi_register_info(context, handle, (void (*)(cp_context_t *, void *)) dealloc_plugin_handle)) != CP_OK) {
+			hash_delete_free(context->env->plugin_handles, hash_lookup(context->env->plugin_handles, id));
+			cpi_free(handle->identifier);
+			cpi_free_info(handle);
+			handle = NULL;
+			break;
 		}
-		ext_points[i] = NULL;
 		
-		// Register the array
-		status = cpi_register_info(context, ext_points, (void (*)(cp_context_t *, void *)) dealloc_ext_points_info);
+		// Publish the state of an installed plug-in
+		if ((rp = cpi_hmap_get(context->env->plugins, id)) != NULL) {
+			cpi_attach_plugin_handle(context, rp);
+		}
 		
 	} while (0);
 	
-	// Report error
+	// Report possible errors
 	if (status != CP_OK) {
-		cpi_error(context, N_("Extension point information could not be returned due to insufficient memory."));
+		cpi_error(context, N_("A plug-in handle could not be created due to insufficient memory."));
 	}
 	cpi_unlock_context(context);
 	
-	// Release resources on error 
-	if (status != CP_OK) {
-		if (ext_points != NULL) {
-			dealloc_ext_points_info(context, ext_points);
-			ext_points = NULL;
-		}
-	}
-	
-	assert(status != CP_OK || n == 0 || ext_points[n - 1] != NULL);
 	if (error != NULL) {
 		*error = status;
 	}
-	if (num != NULL && status == CP_OK) {
-		*num = n;
+	return handle;
+}
+
+CP_C_API cp_plugin_state_t cp_get_plugin_handle_state(cp_context_t *context, const cp_plugin_handle_t *handle) {
+	cp_plugin_state_t state;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(handle);
+#if defined(CP_THREADS) && defined(HAVE_ATOMIC_BUILTINS)
+	state = cpi_atomic_load(&handle->state);
+#else
+	cpi_lock_context_shared(context);
+	state = handle->state;
+	cpi_unlock_context_shared(context);
+#endif
+	return state;
+}
+
+CP_HIDDEN void cpi_attach_plugin_handle(cp_context_t *context, cp_plugin_t *plugin) {
+	hnode_t *node;
+	
+	assert(cpi_is_context_locked(context));
+	if (context->env->plugin_handles != NULL
+		&& (node = hash_lookup(context->env->plugin_handles, plugin->plugin->identifier)) != NULL) {
+		plugin->handle = hnode_get(node);
+		cpi_publish_plugin_state(plugin);
 	}
-	return ext_points;
 }
 
-static void dealloc_extensions_info(cp_context_t *context, cp_extension_t **extensions) {
-	int i;
+CP_HIDDEN void cpi_publish_plugin_state(cp_plugin_t *plugin) {
+	if (plugin->handle != NULL) {
+#if defined(CP_THREADS) && defined(HAVE_ATOMIC_BUILTINS)
+		cpi_atomic_store(&plugin->handle->state, (int) plugin->state);
+#else
+		plugin->handle->state = plugin->state;
+#endif
+	}
+}
+
+CP_HIDDEN void cpi_record_timing(cp_context_t *context, cp_timing_t *timing, unsigned long long *total) {
+	cp_timings_summary_t *summary = &(context->env->timings);
 	
-	assert(context != NULL);
-	assert(extensions != NULL);
-	for (i = 0; extensions[i] != NULL; i++) {
-		cpi_release_info(context, extensions[i]->plugin);
+	assert(cpi_is_context_locked(context));
+	timing->end = cpi_monotonic_time();
+	if (total != NULL) {
+		*total += timing->end - timing->begin;
+	}
+	if (summary->first == 0 || timing->begin < summary->first) {
+		summary->first = timing->begin;
+	}
+	if (timing->end > summary->last) {
+		summary->last = timing->end;
 	}
-	free(extensions);
 }
 
-CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *context, const char *extpt_id, cp_status_t *error, int *num) {
-	cp_extension_t **extensions = NULL;
-	int i, n;
+CP_C_API cp_status_t cp_get_plugin_timings(cp_context_t *context, const char *id, cp_plugin_timings_t *timings) {
 	cp_status_t status = CP_OK;
+	cp_plugin_t *rp;
 	
 	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+	CHECK_NOT_NULL(timings);
 	
+	// Look up the plug-in timings
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
-	do {
-		hscan_t scan;
-		hnode_t *hnode;
+	if ((rp = cpi_hmap_get(context->env->plugins, id)) != NULL) {
+		*timings = rp->timings;
+		timings->parse = *cpi_parse_timing(rp->plugin);
+	} else {
+		cpi_warnf(context, N_("Could not return timings of unknown plug-in %s."), id);
+		status = CP_ERR_UNKNOWN;
+	}
+	cpi_unlock_context(context);
+	return status;
+}
+
+CP_C_API void cp_get_timings_summary(cp_context_t *context, cp_timings_summary_t *summary) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(summary);
+	cpi_lock_context_shared(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	*summary = context->env->timings;
+	cpi_unlock_context_shared(context);
+}
+
+/**
+ * Adds the memory used by the specified installed plug-in to the memory
+ * statistics.
+ * 
+ * @param env the plug-in environment
+ * @param rp the installed plug-in
+ * @param stats the memory statistics
+ */
+static void add_plugin_memory(cp_plugin_env_t *env, cp_plugin_t *rp, cp_memory_stats_t *stats) {
+	stats->context_bytes += sizeof(cp_plugin_t);
+	if (rp->context != NULL) {
+		stats->contexts++;
+		stats->context_bytes += sizeof(cp_context_t);
+		cpi_symbol_memory(rp->context, stats);
+	}
+	cpi_descriptor_memory(rp->plugin, stats);
+	cpi_listener_memory(env, rp, stats);
+	cpi_logger_memory(env, rp, stats);
+	cpi_run_func_memory(env, rp, stats);
+}
+
+CP_C_API cp_status_t cp_get_memory_stats(cp_context_t *context, const char *id, cp_memory_stats_t *stats) {
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(stats);
+	
+	memset(stats, 0, sizeof(cp_memory_stats_t));
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	if (id != NULL) {
+		cp_plugin_t *rp;
+		
+		if ((rp = cpi_hmap_get(context->env->plugins, id)) != NULL) {
+			add_plugin_memory(context->env, rp, stats);
+		} else {
+			cpi_warnf(context, N_("Could not return memory usage of unknown plug-in %s."), id);
+			status = CP_ERR_UNKNOWN;
+		}
+	} else {
+		cpi_hmap_scan_t scan;
+		cp_plugin_t *rp;
+		
+		// Installed plug-ins
+		cpi_hmap_scan_begin(&scan, context->env->plugins);
+		while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			add_plugin_memory(context->env, rp, stats);
+		}
+		
+		// The client program
+		cpi_client_memory(context->env, stats);
+		cpi_listener_memory(context->env, NULL, stats);
+		cpi_logger_memory(context->env, NULL, stats);
+	}
+	stats->total_bytes = stats->descriptor_bytes
+		+ stats->context_bytes
+		+ stats->defined_symbol_bytes
+		+ stats->resolved_symbol_bytes
+		+ stats->listener_bytes
+		+ stats->logger_bytes
+		+ stats->run_func_bytes;
+	cpi_unlock_context(context);
+	return status;
+}
+
+CP_C_API void cp_get_registry_stats(cp_context_t *context, cp_registry_stats_t *stats) {
+	cp_plugin_env_t *env;
+	cpi_hmap_scan_t scan;
+	list_t *el;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(stats);
+	
+	memset(stats, 0, sizeof(cp_registry_stats_t));
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	env = context->env;
+	stats->plugins = cpi_hmap_count(env->plugins);
+	stats->plugin_slots = cpi_hmap_slots(env->plugins);
+	stats->ext_points = cpi_hmap_count(env->ext_points);
+	stats->ext_point_slots = cpi_hmap_slots(env->ext_points);
+	stats->extension_lists = cpi_hmap_count(env->extensions);
+	stats->extension_list_slots = cpi_hmap_slots(env->extensions);
+	cpi_hmap_scan_begin(&scan, env->extensions);
+	while ((el = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+		stats->extensions += list_count(el);
+	}
+	stats->extension_indexes = list_count(env->extension_indexes);
+	stats->interned_strings = hash_count(env->strings);
+#ifndef NDEBUG
+	stats->infos = cpi_hmap_count(env->infos);
+	stats->info_slots = cpi_hmap_slots(env->infos);
+#endif
+	stats->started_plugins = env->started_plugins.num;
+	stats->run_funcs = hash_count(env->run_funcs);
+	stats->queued_run_funcs = list_count(env->run_queue);
+	stats->generation = env->registry_generation;
+	cpi_unlock_context(context);
+}
+
+CP_C_API void cp_get_lock_stats(cp_context_t *context, cp_lock_stats_t *stats) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(stats);
+#ifdef CP_THREADS
+	cpi_get_mutex_stats(context->env->mutex, stats);
+#else
+	memset(stats, 0, sizeof(cp_lock_stats_t));
+#endif
+}
+
+static void dealloc_lock_holder_stats(cp_context_t *context, cp_lock_holder_stats_t *holders) {
+	cpi_free_info(holders);
+}
+
+#ifdef CP_THREADS
+static int comp_lock_holder_stats(const void *a, const void *b) {
+	const cp_lock_holder_stats_t *ha = a;
+	const cp_lock_holder_stats_t *hb = b;
+	
+	return (ha->hold_total < hb->hold_total) - (ha->hold_total > hb->hold_total);
+}
+#endif
+
+CP_C_API cp_lock_holder_stats_t * cp_get_lock_holder_stats(cp_context_t *context, cp_status_t *error, int *num) {
+	cp_lock_holder_stats_t *holders = NULL;
+	cp_status_t status = CP_OK;
+	int n = 0;
+	
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		
+		// Copy the holder table, which is only updated under this lock
+#ifdef CP_THREADS
+		if (context->env->lock_stats != NULL) {
+			n = context->env->lock_stats->num_holders;
+		}
+#endif
+		if ((holders = cpi_alloc_info(sizeof(cp_lock_holder_stats_t) * (n > 0 ? n : 1))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+#ifdef CP_THREADS
+		if (n > 0) {
+			memcpy(holders, context->env->lock_stats->holders, sizeof(cp_lock_holder_stats_t) * n);
+			qsort(holders, n, sizeof(cp_lock_holder_stats_t), comp_lock_holder_stats);
+		}
+#endif
+		
+		// Register the array
+		status = cpi_register_info(context, holders, (void (*)(cp_context_t *, void *)) dealloc_lock_holder_stats);
+		
+	} while (0);
+	
+	// Report error
+	if (status != CP_OK) {
+		cpi_error(context, N_("Lock statistics could not be returned due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources on error
+	if (status != CP_OK && holders != NULL) {
+		cpi_free_info(holders);
+		holders = NULL;
+	}
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	if (num != NULL && status == CP_OK) {
+		*num = n;
+	}
+	return holders;
+}
+
+static void dealloc_ext_points_info(cp_context_t *context, cp_ext_point_t **ext_points) {
+	int i;
+	
+	assert(context != NULL);
+	assert(ext_points != NULL);
+	for (i = 0; ext_points[i] != NULL; i++) {
+		cpi_release_info(context, ext_points[i]->plugin);
+	}
+	cpi_free_info(ext_points);
+}
+
+CP_C_API cp_ext_point_t ** cp_get_ext_points_info(cp_context_t *context, cp_status_t *error, int *num) {
+	cp_ext_point_t **ext_points = NULL;
+	int i, n;
+	cp_status_t status = CP_OK;
+	int shared;
+	
+	CHECK_NOT_NULL(context);
+	
+	shared = lock_context_for_infos(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		cpi_hmap_scan_t scan;
+		cp_ext_point_t *ep;
+		
+		// Allocate space for pointer array 
+		n = cpi_hmap_count(context->env->ext_points);
+		if ((ext_points = cpi_alloc_info(sizeof(cp_ext_point_t *) * (n + 1))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Get extension point information structures 
+		cpi_hmap_scan_begin(&scan, context->env->ext_points);
+		i = 0;
+		while ((ep = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			assert(i < n);
+			cpi_use_info(context, ep->plugin);
+			ext_points[i] = ep;
+			i++;
+		}
+		ext_points[i] = NULL;
+		
+		// Register the array
+		status = cpi_register_info(context, ext_points, (void (*)(cp_context_t *, void *)) dealloc_ext_points_info);
+		
+	} while (0);
+	
+	// Report error
+	if (status != CP_OK) {
+		relock_context_exclusive(context, &shared);
+		cpi_error(context, N_("Extension point information could not be returned due to insufficient memory."));
+	}
+	unlock_context_for_infos(context, shared);
+	
+	// Release resources on error 
+	if (status != CP_OK) {
+		if (ext_points != NULL) {
+			dealloc_ext_points_info(context, ext_points);
+			ext_points = NULL;
+		}
+	}
+	
+	assert(status != CP_OK || n == 0 || ext_points[n - 1] != NULL);
+	if (error != NULL) {
+		*error = status;
+	}
+	if (num != NULL && status == CP_OK) {
+		*num = n;
+	}
+	return ext_points;
+}
+
+static void dealloc_extensions_info(cp_context_t *context, cp_extension_t **extensions) {
+	int i;
+	
+	assert(context != NULL);
+	assert(extensions != NULL);
+	for (i = 0; extensions[i] != NULL; i++) {
+		cpi_release_info(context, extensions[i]->plugin);
+	}
+	cpi_free_info(extensions);
+}
+
+CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *context, const char *extpt_id, cp_status_t *error, int *num) {
+	cp_extension_t **extensions = NULL;
+	int i, n;
+	cp_status_t status = CP_OK;
+	int shared;
+	
+	CHECK_NOT_NULL(context);
+	
+	shared = lock_context_for_infos(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		cpi_hmap_scan_t scan;
+		list_t *el;
 
 		// Count the number of extensions
 		if (extpt_id != NULL) {
-			if ((hnode = hash_lookup(context->env->extensions, extpt_id)) != NULL) {
-				n = list_count((list_t *) hnode_get(hnode));
+			if ((el = cpi_hmap_get(context->env->extensions, extpt_id)) != NULL) {
+				n = list_count(el);
 			} else {
 				n = 0;
 			}
 		} else {
-			hscan_t scan;
-			
 			n = 0;
-			hash_scan_begin(&scan, context->env->extensions);
-			while ((hnode = hash_scan_next(&scan)) != NULL) {
-				n += list_count((list_t *) hnode_get(hnode));
+			cpi_hmap_scan_begin(&scan, context->env->extensions);
+			while ((el = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+				n += list_count(el);
 			}
 		}
 		
 		// Allocate space for pointer array 
-		if ((extensions = malloc(sizeof(cp_extension_t *) * (n + 1))) == NULL) {
+		if ((extensions = cpi_alloc_info(sizeof(cp_extension_t *) * (n + 1))) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -431,8 +1087,7 @@ CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *context, const c
 		// Get extension information structures
 		if (extpt_id != NULL) {
 			i = 0;
-			if ((hnode = hash_lookup(context->env->extensions, extpt_id)) != NULL) {
-				list_t *el = hnode_get(hnode);
+			if ((el = cpi_hmap_get(context->env->extensions, extpt_id)) != NULL) {
 				lnode_t *lnode;
 				
 				lnode = list_first(el);
@@ -448,10 +1103,9 @@ CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *context, const c
 			}
 			extensions[i] = NULL;
 		} else { 
-			hash_scan_begin(&scan, context->env->extensions);
+			cpi_hmap_scan_begin(&scan, context->env->extensions);
 			i = 0;
-			while ((hnode = hash_scan_next(&scan)) != NULL) {
-				list_t *el = hnode_get(hnode);
+			while ((el = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
 				lnode_t *lnode;
 			
 				lnode = list_first(el);
@@ -475,101 +1129,1466 @@ CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *context, const c
 	
 	// Report error
 	if (status != CP_OK) {
+		relock_context_exclusive(context, &shared);
 		cpi_error(context, N_("Extension information could not be returned due to insufficient memory."));
 	}
+	unlock_context_for_infos(context, shared);
+	
+	// Release resources on error 
+	if (status != CP_OK) {
+		if (extensions != NULL) {
+			dealloc_extensions_info(context, extensions);
+			extensions = NULL;
+		}
+	}
+	
+	assert(status != CP_OK || n == 0 || extensions[n - 1] != NULL);
+	if (error != NULL) {
+		*error = status;
+	}
+	if (num != NULL && status == CP_OK) {
+		*num = n;
+	}
+	return extensions;
+}
+
+CP_C_API int cp_foreach_plugin(cp_context_t *context, cp_plugin_visitor_func_t visitor, void *user_data) {
+	cpi_hmap_scan_t scan;
+	cp_plugin_t *rp;
+	cpi_invocation_t inv;
+	int stop = 0;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(visitor);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	cpi_begin_invocation(context->env, &inv, CPI_CF_VISITOR);
+	cpi_hmap_scan_begin(&scan, context->env->plugins);
+	while (!stop && (rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+		stop = visitor(rp->plugin, user_data);
+	}
+	cpi_end_invocation(&inv);
+	cpi_unlock_context(context);
+	
+	return stop;
+}
+
+/**
+ * Calls the visitor for the extensions in the specified list until the
+ * visitor returns a non-zero value.
+ * 
+ * @param el the list of extensions
+ * @param visitor the visitor function
+ * @param user_data the user data pointer passed to the visitor
+ * @return the non-zero value returned by the visitor, or zero
+ */
+static int visit_extensions(list_t *el, cp_extension_visitor_func_t visitor, void *user_data) {
+	lnode_t *lnode;
+	int stop = 0;
+	
+	for (lnode = list_first(el); !stop && lnode != NULL; lnode = list_next(el, lnode)) {
+		stop = visitor(lnode_get(lnode), user_data);
+	}
+	return stop;
+}
+
+CP_C_API int cp_foreach_extension(cp_context_t *context, const char *extpt_id, cp_extension_visitor_func_t visitor, void *user_data) {
+	list_t *el;
+	cpi_invocation_t inv;
+	int stop = 0;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(visitor);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	cpi_begin_invocation(context->env, &inv, CPI_CF_VISITOR);
+	if (extpt_id != NULL) {
+		if ((el = cpi_hmap_get(context->env->extensions, extpt_id)) != NULL) {
+			stop = visit_extensions(el, visitor, user_data);
+		}
+	} else {
+		cpi_hmap_scan_t scan;
+		
+		cpi_hmap_scan_begin(&scan, context->env->extensions);
+		while (!stop && (el = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			stop = visit_extensions(el, visitor, user_data);
+		}
+	}
+	cpi_end_invocation(&inv);
 	cpi_unlock_context(context);
 	
-	// Release resources on error 
+	return stop;
+}
+
+CP_HIDDEN void cpi_registry_changed(cp_context_t *context) {
+	assert(cpi_is_context_locked(context));
+#if defined(CP_THREADS) && defined(HAVE_ATOMIC_BUILTINS)
+	cpi_atomic_inc(&context->env->registry_generation);
+#else
+	context->env->registry_generation++;
+#endif
+}
+
+CP_HIDDEN void cpi_invalidate_extensions_snapshot(cp_context_t *context, const char *extpt_id) {
+	hnode_t *hnode;
+	unsigned int *generation = NULL;
+	
+	assert(cpi_is_context_locked(context));
+	cpi_registry_changed(context);
+	
+	// Record the generation of the extension point
+	if ((hnode = hash_lookup(context->env->ext_point_generations, extpt_id)) != NULL) {
+		generation = hnode_get(hnode);
+	} else {
+		char *epid;
+		
+		// The record is allocated from the string arena to last as long as the environment
+		if ((epid = cpi_intern_string(context, extpt_id)) != NULL
+			&& (generation = cpi_arena_alloc(context->env->strings_arena, sizeof(unsigned int))) != NULL
+			&& !hash_alloc_insert(context->env->ext_point_generations, epid, generation)) {
+			generation = NULL;
+		}
+	}
+	if (generation != NULL) {
+		*generation = context->env->registry_generation;
+	} else {
+		context->env->ext_point_generations_lost = 1;
+	}
+	
+	// Drop the snapshot
+	if ((hnode = hash_lookup(context->env->extension_snapshots, extpt_id)) != NULL) {
+		cp_extensions_snapshot_t *snapshot = hnode_get(hnode);
+		
+		hash_delete_free(context->env->extension_snapshots, hnode);
+		cpi_free(snapshot);
+	}
+}
+
+CP_HIDDEN void cpi_free_extensions_snapshots(cp_plugin_env_t *env) {
+	hscan_t scan;
+	hnode_t *hnode;
+	
+	hash_scan_begin(&scan, env->extension_snapshots);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		cp_extensions_snapshot_t *snapshot = hnode_get(hnode);
+		
+		hash_scan_delfree(env->extension_snapshots, hnode);
+		cpi_free(snapshot);
+	}
+}
+
+CP_C_API unsigned int cp_get_registry_generation(cp_context_t *context) {
+	unsigned int generation;
+	
+	CHECK_NOT_NULL(context);
+#if defined(CP_THREADS) && defined(HAVE_ATOMIC_BUILTINS)
+	generation = cpi_atomic_load(&context->env->registry_generation);
+#else
+	cpi_lock_context_shared(context);
+	generation = context->env->registry_generation;
+	cpi_unlock_context_shared(context);
+#endif
+	return generation;
+}
+
+CP_C_API unsigned int cp_get_ext_point_generation(cp_context_t *context, const char *extpt_id) {
+	hnode_t *hnode;
+	unsigned int generation;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(extpt_id);
+	cpi_lock_context_shared(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	if ((hnode = hash_lookup(context->env->ext_point_generations, extpt_id)) != NULL) {
+		generation = *((unsigned int *) hnode_get(hnode));
+	} else if (context->env->ext_point_generations_lost) {
+		
+		// Fall back to the registry generation if a change was not recorded
+		generation = context->env->registry_generation;
+	} else {
+		generation = 0;
+	}
+	cpi_unlock_context_shared(context);
+	return generation;
+}
+
+CP_C_API const cp_extensions_snapshot_t *cp_get_extensions_snapshot(cp_context_t *context, const char *extpt_id, cp_status_t *error) {
+	cp_extensions_snapshot_t *snapshot = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(extpt_id);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		hnode_t *hnode;
+		list_t *el = NULL;
+		cp_extension_t **extensions;
+		const char *epid;
+		int i, n = 0;
+		
+		// Return the current snapshot, if any
+		if ((hnode = hash_lookup(context->env->extension_snapshots, extpt_id)) != NULL) {
+			snapshot = hnode_get(hnode);
+			break;
+		}
+		
+		// Allocate a new snapshot and the extension array in one block
+		if ((el = cpi_hmap_get(context->env->extensions, extpt_id)) != NULL) {
+			n = list_count(el);
+		}
+		if ((snapshot = cpi_malloc(sizeof(cp_extensions_snapshot_t) + sizeof(cp_extension_t *) * (n + 1))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		extensions = (cp_extension_t **) (snapshot + 1);
+		snapshot->generation = context->env->registry_generation;
+		snapshot->num_extensions = n;
+		snapshot->extensions = extensions;
+		i = 0;
+		if (el != NULL) {
+			lnode_t *lnode;
+			
+			for (lnode = list_first(el); lnode != NULL; lnode = list_next(el, lnode)) {
+				assert(i < n);
+				extensions[i++] = lnode_get(lnode);
+			}
+		}
+		extensions[i] = NULL;
+		
+		// Register the snapshot under the interned identifier
+		if ((epid = cpi_intern_string(context, extpt_id)) == NULL
+			|| !hash_alloc_insert(context->env->extension_snapshots, epid, snapshot)) {
+			cpi_free(snapshot);
+			snapshot = NULL;
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+	} while (0);
+	
+	// Report error
+	if (status != CP_OK) {
+		cpi_error(context, N_("Extension information could not be returned due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	return snapshot;
+}
+
+
+
+// Extension indexes
+
+/**
+ * Returns the indexed configuration value of the specified extension.
+ * 
+ * @param context the plug-in context
+ * @param index the extension index
+ * @param ext the extension
+ * @param status pointer to the location where the status code is stored
+ * @return the configuration value or NULL if not available
+ */
+static const char *get_indexed_value(cp_context_t *context, const cp_extension_index_t *index, cp_extension_t *ext, cp_status_t *status) {
+	
+	// A malformed configuration has already been reported and is not indexed
+	if ((*status = cpi_materialize_cfg(context, ext)) != CP_ERR_RESOURCE) {
+		*status = CP_OK;
+	}
+	if (*status != CP_OK || ext->configuration == NULL) {
+		return NULL;
+	}
+	return cp_lookup_cfg_value(ext->configuration, index->path);
+}
+
+/**
+ * Adds an extension to an extension index.
+ * 
+ * @param context the plug-in context
+ * @param index the extension index
+ * @param ext the extension
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if out of resources
+ */
+static cp_status_t add_indexed_extension(cp_context_t *context, cp_extension_index_t *index, cp_extension_t *ext) {
+	const char *value;
+	hnode_t *hnode;
+	lnode_t *lnode;
+	list_t *el;
+	cp_status_t status;
+	
+	if ((value = get_indexed_value(context, index, ext, &status)) == NULL) {
+		return status;
+	}
+	if ((hnode = hash_lookup(index->values, value)) == NULL) {
+		char *ivalue;
+		
+		// The interned value remains valid as long as the environment
+		if ((el = list_create(LISTCOUNT_T_MAX)) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		if ((ivalue = cpi_intern_string(context, value)) == NULL
+			|| !hash_alloc_insert(index->values, ivalue, el)) {
+			list_destroy(el);
+			return CP_ERR_RESOURCE;
+		}
+		hnode = hash_lookup(index->values, ivalue);
+	} else {
+		el = hnode_get(hnode);
+	}
+	if ((lnode = lnode_create(ext)) == NULL) {
+		if (list_isempty(el)) {
+			hash_delete_free(index->values, hnode);
+			list_destroy(el);
+		}
+		return CP_ERR_RESOURCE;
+	}
+	list_append(el, lnode);
+	return CP_OK;
+}
+
+/**
+ * Removes an extension from an extension index, if it has been indexed.
+ * 
+ * @param index the extension index
+ * @param ext the extension
+ */
+static void remove_indexed_extension(cp_extension_index_t *index, cp_extension_t *ext) {
+	const char *value;
+	hnode_t *hnode;
+	
+	if (ext->configuration == NULL
+		|| (value = cp_lookup_cfg_value(ext->configuration, index->path)) == NULL) {
+		return;
+	}
+	if ((hnode = hash_lookup(index->values, value)) != NULL) {
+		list_t *el = hnode_get(hnode);
+		lnode_t *lnode;
+		
+		for (lnode = list_first(el); lnode != NULL; lnode = list_next(el, lnode)) {
+			if (lnode_get(lnode) == ext) {
+				list_delete(el, lnode);
+				lnode_destroy(lnode);
+				break;
+			}
+		}
+		if (list_isempty(el)) {
+			hash_delete_free(index->values, hnode);
+			list_destroy(el);
+		}
+	}
+}
+
+/**
+ * Frees an extension index.
+ * 
+ * @param index the extension index
+ */
+static void free_extension_index(cp_extension_index_t *index) {
+	if (index->values != NULL) {
+		hscan_t scan;
+		hnode_t *hnode;
+		
+		hash_scan_begin(&scan, index->values);
+		while ((hnode = hash_scan_next(&scan)) != NULL) {
+			list_t *el = hnode_get(hnode);
+			
+			hash_scan_delfree(index->values, hnode);
+			list_destroy_nodes(el);
+			list_destroy(el);
+		}
+		hash_destroy(index->values);
+	}
+	cpi_free(index);
+}
+
+CP_HIDDEN cp_status_t cpi_index_extension(cp_context_t *context, cp_extension_t *ext) {
+	lnode_t *lnode;
+	cp_status_t status = CP_OK;
+	
+	assert(cpi_is_context_locked(context));
+	for (lnode = list_first(context->env->extension_indexes);
+		lnode != NULL && status == CP_OK;
+		lnode = list_next(context->env->extension_indexes, lnode)) {
+		cp_extension_index_t *index = lnode_get(lnode);
+		
+		if (!strcmp(index->ext_point_id, ext->ext_point_id)) {
+			status = add_indexed_extension(context, index, ext);
+		}
+	}
+	return status;
+}
+
+CP_HIDDEN void cpi_unindex_extension(cp_context_t *context, cp_extension_t *ext) {
+	lnode_t *lnode;
+	
+	assert(cpi_is_context_locked(context));
+	for (lnode = list_first(context->env->extension_indexes);
+		lnode != NULL;
+		lnode = list_next(context->env->extension_indexes, lnode)) {
+		cp_extension_index_t *index = lnode_get(lnode);
+		
+		if (!strcmp(index->ext_point_id, ext->ext_point_id)) {
+			remove_indexed_extension(index, ext);
+		}
+	}
+}
+
+CP_HIDDEN int cpi_is_extension_indexed(cp_context_t *context, const cp_extension_t *ext) {
+	lnode_t *lnode;
+	
+	assert(cpi_is_context_locked(context));
+	for (lnode = list_first(context->env->extension_indexes);
+		lnode != NULL;
+		lnode = list_next(context->env->extension_indexes, lnode)) {
+		const cp_extension_index_t *index = lnode_get(lnode);
+		
+		if (!strcmp(index->ext_point_id, ext->ext_point_id)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+CP_HIDDEN void cpi_destroy_extension_indexes(cp_plugin_env_t *env) {
+	lnode_t *lnode;
+	
+	while ((lnode = list_first(env->extension_indexes)) != NULL) {
+		list_delete(env->extension_indexes, lnode);
+		free_extension_index(lnode_get(lnode));
+		lnode_destroy(lnode);
+	}
+}
+
+CP_C_API cp_extension_index_t * cp_create_extension_index(cp_context_t *context, const char *extpt_id, const char *path, cp_status_t *error) {
+	cp_extension_index_t *index = NULL;
+	lnode_t *lnode = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(extpt_id);
+	CHECK_NOT_NULL(path);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		list_t *el;
+		
+		// Allocate the index and a copy of the path in one block
+		if ((index = cpi_malloc(sizeof(cp_extension_index_t) + strlen(path) + 1)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(index, 0, sizeof(cp_extension_index_t));
+		index->path = (char *) (index + 1);
+		strcpy(index->path, path);
+		if ((index->ext_point_id = cpi_intern_string(context, extpt_id)) == NULL
+			|| (index->values = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL
+			|| (lnode = lnode_create(index)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Index the currently installed extensions
+		if ((el = cpi_hmap_get(context->env->extensions, extpt_id)) != NULL) {
+			lnode_t *n;
+			
+			for (n = list_first(el); n != NULL && status == CP_OK; n = list_next(el, n)) {
+				status = add_indexed_extension(context, index, lnode_get(n));
+			}
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Let the framework maintain the index
+		list_append(context->env->extension_indexes, lnode);
+		
+	} while (0);
+	
+	// Report error
+	if (status != CP_OK) {
+		cpi_error(context, N_("Extension index could not be created due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources on error
+	if (status != CP_OK) {
+		if (lnode != NULL) {
+			lnode_destroy(lnode);
+		}
+		if (index != NULL) {
+			free_extension_index(index);
+			index = NULL;
+		}
+	}
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	return index;
+}
+
+CP_C_API void cp_destroy_extension_index(cp_context_t *context, cp_extension_index_t *index) {
+	lnode_t *lnode;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(index);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	for (lnode = list_first(context->env->extension_indexes);
+		lnode != NULL && lnode_get(lnode) != index;
+		lnode = list_next(context->env->extension_indexes, lnode));
+	if (lnode != NULL) {
+		list_delete(context->env->extension_indexes, lnode);
+		lnode_destroy(lnode);
+		free_extension_index(index);
+	}
+	cpi_unlock_context(context);
+}
+
+CP_C_API cp_extension_t ** cp_query_extension_index(cp_context_t *context, const cp_extension_index_t *index, const char *value, cp_status_t *error, int *num) {
+	cp_extension_t **extensions = NULL;
+	cp_status_t status = CP_OK;
+	int n = 0;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(index);
+	CHECK_NOT_NULL(value);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		hnode_t *hnode;
+		list_t *el = NULL;
+		int i = 0;
+		
+		// Allocate space for pointer array
+		if ((hnode = hash_lookup(index->values, value)) != NULL) {
+			el = hnode_get(hnode);
+			n = list_count(el);
+		}
+		if ((extensions = cpi_alloc_info(sizeof(cp_extension_t *) * (n + 1))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Get the matching extensions
+		if (el != NULL) {
+			lnode_t *lnode;
+			
+			for (lnode = list_first(el); lnode != NULL; lnode = list_next(el, lnode)) {
+				cp_extension_t *e = lnode_get(lnode);
+				
+				assert(i < n);
+				cpi_use_info(context, e->plugin);
+				extensions[i++] = e;
+			}
+		}
+		extensions[i] = NULL;
+		
+		// Register the array
+		status = cpi_register_info(context, extensions, (void (*)(cp_context_t *, void *)) dealloc_extensions_info);
+		
+	} while (0);
+	
+	// Report error
+	if (status != CP_OK) {
+		cpi_error(context, N_("Extension information could not be returned due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources on error
+	if (status != CP_OK && extensions != NULL) {
+		dealloc_extensions_info(context, extensions);
+		extensions = NULL;
+	}
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	if (num != NULL && status == CP_OK) {
+		*num = n;
+	}
+	return extensions;
+}
+
+
+// Configuration schemas
+
+#ifndef NDEBUG
+
+/**
+ * Returns the size of the record member storing a value of the specified
+ * type.
+ * 
+ * @param type the value type
+ * @return the size of the record member in bytes
+ */
+static size_t cfg_type_size(cp_cfg_type_t type) {
+	switch (type) {
+		case CP_CFG_STRING:
+			return sizeof(const char *);
+		case CP_CFG_INT:
+			return sizeof(long);
+		case CP_CFG_DOUBLE:
+			return sizeof(double);
+		default:
+			return sizeof(int);
+	}
+}
+
+#endif
+
+/**
+ * Allocates a zero-filled configuration record aligned to
+ * @ref CP_CFG_RECORD_ALIGN bytes. The start of the allocated block is
+ * stored just before the record.
+ * 
+ * @param size the record size
+ * @return the record or NULL if insufficient memory
+ */
+static char *alloc_cfg_record(size_t size) {
+	char *block, *record;
+	
+	if ((block = cpi_malloc(size + sizeof(void *) + CP_CFG_RECORD_ALIGN - 1)) == NULL) {
+		return NULL;
+	}
+	record = block + sizeof(void *);
+	record += (CP_CFG_RECORD_ALIGN - ((size_t) record) % CP_CFG_RECORD_ALIGN) % CP_CFG_RECORD_ALIGN;
+	((void **) record)[-1] = block;
+	memset(record, 0, size);
+	return record;
+}
+
+/**
+ * Frees a configuration record allocated using ::alloc_cfg_record.
+ * 
+ * @param record the record
+ */
+static void free_cfg_record(void *record) {
+	cpi_free(((void **) record)[-1]);
+}
+
+/**
+ * Converts a configuration value as specified by a schema field and
+ * stores it in the corresponding record member.
+ * 
+ * @param context the plug-in context
+ * @param field the schema field
+ * @param value the configuration value
+ * @param record the configuration record
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_MALFORMED if the value is not valid or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t convert_cfg_value(cp_context_t *context, const cfg_field_t *field, const char *value, char *record) {
+	char *member = record + field->offset;
+	char *end;
+	int i;
+	
+	switch (field->type) {
+		
+		case CP_CFG_STRING:
+			if ((*((const char **) member) = cpi_intern_string(context, value)) == NULL) {
+				return CP_ERR_RESOURCE;
+			}
+			return CP_OK;
+		
+		case CP_CFG_INT:
+			errno = 0;
+			*((long *) member) = strtol(value, &end, 0);
+			break;
+		
+		case CP_CFG_DOUBLE:
+			errno = 0;
+			*((double *) member) = strtod(value, &end);
+			break;
+		
+		case CP_CFG_BOOL:
+			if (!strcmp(value, "true") || !strcmp(value, "1")) {
+				*((int *) member) = 1;
+			} else if (!strcmp(value, "false") || !strcmp(value, "0")) {
+				*((int *) member) = 0;
+			} else {
+				return CP_ERR_MALFORMED;
+			}
+			return CP_OK;
+		
+		case CP_CFG_ENUM:
+			for (i = 0; field->values[i] != NULL; i++) {
+				if (!strcmp(value, field->values[i])) {
+					*((int *) member) = i;
+					return CP_OK;
+				}
+			}
+			return CP_ERR_MALFORMED;
+		
+		default:
+			return CP_ERR_MALFORMED;
+	}
+	
+	// Accept a numeric value surrounded by whitespace only
+	if (end == value || errno == ERANGE) {
+		return CP_ERR_MALFORMED;
+	}
+	while (isspace((unsigned char) *end)) {
+		end++;
+	}
+	return (*end == '\0' ? CP_OK : CP_ERR_MALFORMED);
+}
+
+/**
+ * Validates the configuration of an extension against a schema and stores
+ * the resulting configuration record. Logs an error if the configuration
+ * does not match the schema.
+ * 
+ * @param context the plug-in context
+ * @param schema the configuration schema
+ * @param ext the extension
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_MALFORMED if the configuration does not match or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+static cp_status_t bind_extension_cfg(cp_context_t *context, cfg_schema_t *schema, cp_extension_t *ext) {
+	char *record;
+	cp_status_t status;
+	unsigned int i;
+	
+	// Parse a lazily loaded configuration first
+	if ((status = cpi_materialize_cfg(context, ext)) != CP_OK) {
+		return status;
+	}
+	if ((record = alloc_cfg_record(schema->record_size)) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	
+	// Convert the values, falling back to the default values
+	for (i = 0; status == CP_OK && i < schema->num_fields; i++) {
+		const cfg_field_t *field = schema->fields + i;
+		const char *value = NULL;
+		
+		if (ext->configuration != NULL) {
+			value = cp_lookup_cfg_value(ext->configuration, field->path);
+		}
+		if (value == NULL && field->required) {
+			cpi_errorf(context, N_("Configuration value %s of an extension of plug-in %s is required by extension point %s."), field->path, ext->plugin->identifier, schema->ext_point_id);
+			status = CP_ERR_MALFORMED;
+		} else if (value == NULL) {
+			value = field->default_value;
+		}
+		if (value != NULL
+			&& (status = convert_cfg_value(context, field, value, record)) == CP_ERR_MALFORMED) {
+			cpi_errorf(context, N_("Configuration value %s of an extension of plug-in %s is not valid for extension point %s: %s"), field->path, ext->plugin->identifier, schema->ext_point_id, value);
+		}
+	}
+	
+	// Store the record
+	if (status == CP_OK && !cpi_hmap_put(schema->records, ext, record)) {
+		status = CP_ERR_RESOURCE;
+	}
+	if (status != CP_OK) {
+		free_cfg_record(record);
+	}
+	return status;
+}
+
+/**
+ * Frees a configuration schema and its configuration records.
+ * 
+ * @param schema the configuration schema
+ */
+static void free_cfg_schema(cfg_schema_t *schema) {
+	unsigned int i;
+	
+	if (schema->records != NULL) {
+		cpi_hmap_scan_t scan;
+		void *record;
+		
+		cpi_hmap_scan_begin(&scan, schema->records);
+		while ((record = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			free_cfg_record(record);
+		}
+		cpi_destroy_hmap(schema->records);
+	}
+	for (i = 0; i < schema->num_fields; i++) {
+		if (schema->fields[i].values != NULL) {
+			cpi_free(schema->fields[i].values);
+		}
+	}
+	cpi_free(schema);
+}
+
+CP_HIDDEN cp_status_t cpi_bind_extension_cfg(cp_context_t *context, cp_extension_t *ext) {
+	hnode_t *node;
+	
+	assert(cpi_is_context_locked(context));
+	if ((node = hash_lookup(context->env->cfg_schemas, ext->ext_point_id)) == NULL) {
+		return CP_OK;
+	}
+	return bind_extension_cfg(context, hnode_get(node), ext);
+}
+
+CP_HIDDEN void cpi_unbind_extension_cfg(cp_context_t *context, cp_extension_t *ext) {
+	hnode_t *node;
+	
+	assert(cpi_is_context_locked(context));
+	if ((node = hash_lookup(context->env->cfg_schemas, ext->ext_point_id)) != NULL) {
+		cfg_schema_t *schema = hnode_get(node);
+		void *record;
+		
+		if ((record = cpi_hmap_remove(schema->records, ext)) != NULL) {
+			free_cfg_record(record);
+		}
+	}
+}
+
+CP_HIDDEN int cpi_is_extension_bound(cp_context_t *context, const cp_extension_t *ext) {
+	assert(cpi_is_context_locked(context));
+	return hash_lookup(context->env->cfg_schemas, ext->ext_point_id) != NULL;
+}
+
+CP_HIDDEN void cpi_unregister_cfg_schemas(cp_plugin_env_t *env, cp_plugin_t *plugin) {
+	hscan_t scan;
+	hnode_t *node;
+	
+	hash_scan_begin(&scan, env->cfg_schemas);
+	while ((node = hash_scan_next(&scan)) != NULL) {
+		cfg_schema_t *schema = hnode_get(node);
+		
+		if (plugin == NULL || schema->plugin == plugin) {
+			hash_scan_delfree(env->cfg_schemas, node);
+			free_cfg_schema(schema);
+		}
+	}
+}
+
+CP_C_API cp_status_t cp_register_cfg_schema(cp_context_t *context, const char *extpt_id, const cp_cfg_schema_t *schema) {
+	cfg_schema_t *cs = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(extpt_id);
+	CHECK_NOT_NULL(schema);
+	if (schema->num_fields > 0) {
+		CHECK_NOT_NULL(schema->fields);
+	}
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		hnode_t *node;
+		list_t *el;
+		unsigned int i;
+		
+		// Allocate the schema and its fields in one block
+		if ((cs = cpi_malloc(sizeof(cfg_schema_t) + schema->num_fields * sizeof(cfg_field_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(cs, 0, sizeof(cfg_schema_t) + schema->num_fields * sizeof(cfg_field_t));
+		cs->plugin = context->plugin;
+		cs->record_size = (schema->record_size + CP_CFG_RECORD_ALIGN - 1) / CP_CFG_RECORD_ALIGN * CP_CFG_RECORD_ALIGN;
+		cs->num_fields = schema->num_fields;
+		cs->fields = (cfg_field_t *) (cs + 1);
+		if ((cs->ext_point_id = cpi_intern_string(context, extpt_id)) == NULL
+			|| (cs->records = cpi_create_hmap(cpi_comp_ptr, cpi_hashfunc_ptr)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Copy the fields, interning the strings
+		for (i = 0; status == CP_OK && i < schema->num_fields; i++) {
+			const cp_cfg_field_t *f = schema->fields + i;
+			cfg_field_t *cf = cs->fields + i;
+			
+			CHECK_NOT_NULL(f->path);
+			assert(f->type >= CP_CFG_STRING && f->type <= CP_CFG_ENUM);
+			assert(f->offset + cfg_type_size(f->type) <= schema->record_size);
+			cf->type = f->type;
+			cf->offset = f->offset;
+			cf->required = f->required;
+			if ((cf->path = cpi_intern_string(context, f->path)) == NULL
+				|| (f->default_value != NULL
+					&& (cf->default_value = cpi_intern_string(context, f->default_value)) == NULL)) {
+				status = CP_ERR_RESOURCE;
+			} else if (f->type == CP_CFG_ENUM) {
+				int n;
+				
+				CHECK_NOT_NULL(f->values);
+				for (n = 0; f->values[n] != NULL; n++);
+				if ((cf->values = cpi_malloc((n + 1) * sizeof(const char *))) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				cf->values[n] = NULL;
+				while (n-- > 0) {
+					if ((cf->values[n] = cpi_intern_string(context, f->values[n])) == NULL) {
+						status = CP_ERR_RESOURCE;
+						break;
+					}
+				}
+			}
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Validate and convert the configuration of the installed extensions
+		if ((el = cpi_hmap_get(context->env->extensions, extpt_id)) != NULL) {
+			lnode_t *n;
+			
+			for (n = list_first(el); n != NULL && status == CP_OK; n = list_next(el, n)) {
+				status = bind_extension_cfg(context, cs, lnode_get(n));
+			}
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Replace a previous schema, the interned key remains the same
+		if ((node = hash_lookup(context->env->cfg_schemas, extpt_id)) != NULL) {
+			free_cfg_schema(hnode_get(node));
+			hnode_put(node, cs);
+		} else if (!hash_alloc_insert(context->env->cfg_schemas, cs->ext_point_id, cs)) {
+			status = CP_ERR_RESOURCE;
+		}
+		
+	} while (0);
+	
+	// Report error
+	if (status == CP_ERR_RESOURCE) {
+		cpi_errorf(context, N_("Configuration schema for extension point %s could not be registered due to insufficient memory."), extpt_id);
+	} else if (status != CP_OK) {
+		cpi_errorf(context, N_("Configuration schema for extension point %s could not be registered because installed extensions do not match it."), extpt_id);
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources on error
+	if (status != CP_OK && cs != NULL) {
+		free_cfg_schema(cs);
+	}
+	
+	return status;
+}
+
+CP_C_API void cp_unregister_cfg_schema(cp_context_t *context, const char *extpt_id) {
+	hnode_t *node;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(extpt_id);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	if ((node = hash_lookup(context->env->cfg_schemas, extpt_id)) != NULL) {
+		cfg_schema_t *schema = hnode_get(node);
+		
+		hash_delete_free(context->env->cfg_schemas, node);
+		free_cfg_schema(schema);
+	}
+	cpi_unlock_context(context);
+}
+
+CP_C_API const void * cp_get_extension_record(cp_context_t *context, const cp_extension_t *ext, cp_status_t *error) {
+	const void *record = NULL;
+	hnode_t *node;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(ext);
+	cpi_lock_context_shared(context);
+	if ((node = hash_lookup(context->env->cfg_schemas, ext->ext_point_id)) != NULL) {
+		const cfg_schema_t *schema = hnode_get(node);
+		
+		record = cpi_hmap_get(schema->records, ext);
+	}
+	cpi_unlock_context_shared(context);
+	if (error != NULL) {
+		*error = (record != NULL ? CP_OK : CP_ERR_UNKNOWN);
+	}
+	return record;
+}
+
+
+// Plug-in listeners 
+
+/**
+ * Returns the index of a plug-in listener registration.
+ * 
+ * @param listeners the listener set
+ * @param plugin_listener the plug-in listener or NULL
+ * @param batch_listener the batch plug-in listener or NULL
+ * @return the index of the registration or -1 if not registered
+ */
+static int find_plistener(const cpi_plistener_set_t *listeners, cp_plugin_listener_func_t plugin_listener, cp_plugin_batch_listener_func_t batch_listener) {
+	int i;
+	
+	for (i = 0; i < listeners->num; i++) {
+		if (listeners->listeners[i].plugin_listener == plugin_listener
+			&& listeners->listeners[i].batch_listener == batch_listener) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Appends a new plug-in listener registration to a listener set.
+ * 
+ * @param listeners the listener set
+ * @param context the registering plug-in context
+ * @param user_data the user data pointer
+ * @return the cleared registration or NULL if out of memory
+ */
+static cpi_plistener_t *add_plistener(cpi_plistener_set_t *listeners, cp_context_t *context, void *user_data) {
+	cpi_plistener_t *h;
+	
+	if (listeners->num == listeners->size) {
+		int size = (listeners->size == 0 ? 4 : listeners->size * 2);
+		
+		if ((h = cpi_realloc(listeners->listeners, size * sizeof(cpi_plistener_t))) == NULL) {
+			return NULL;
+		}
+		listeners->listeners = h;
+		listeners->size = size;
+	}
+	h = listeners->listeners + listeners->num++;
+	memset(h, 0, sizeof(cpi_plistener_t));
+	h->plugin = context->plugin;
+	h->user_data = user_data;
+	return h;
+}
+
+/**
+ * Removes a plug-in listener registration from a listener set preserving
+ * the order of the remaining registrations.
+ * 
+ * @param listeners the listener set
+ * @param i the index of the registration
+ */
+static void remove_plistener(cpi_plistener_set_t *listeners, int i) {
+	listeners->num--;
+	memmove(listeners->listeners + i, listeners->listeners + i + 1, (listeners->num - i) * sizeof(cpi_plistener_t));
+}
+
+/**
+ * Delivers the specified event to the plug-in listeners of a set.
+ * 
+ * @param listeners the listener set
+ * @param e the event
+ */
+static void deliver_to_plisteners(const cpi_plistener_set_t *listeners, const cpi_plugin_event_t *e) {
+	int i;
+	
+	for (i = 0; i < listeners->num; i++) {
+		const cpi_plistener_t *h = listeners->listeners + i;
+		
+		if (h->state_mask & CP_STATE_MASK(e->new_state)) {
+			h->plugin_listener(e->plugin_id, e->old_state, e->new_state, h->user_data);
+		}
+	}
+}
+
+CP_HIDDEN void cpi_unregister_plisteners(cpi_plistener_set_t *listeners, cp_plugin_t *plugin) {
+	int i, j = 0;
+	
+	for (i = 0; i < listeners->num; i++) {
+		if (plugin != NULL && listeners->listeners[i].plugin != plugin) {
+			listeners->listeners[j++] = listeners->listeners[i];
+		}
+	}
+	listeners->num = j;
+	if (j == 0) {
+		cpi_free(listeners->listeners);
+		listeners->listeners = NULL;
+		listeners->size = 0;
+	}
+}
+
+/**
+ * Waits until the batch plug-in listener dispatcher has completed a
+ * delivery in progress. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ */
+static void wait_event_delivery(cp_context_t *context) {
+#ifdef CP_THREADS
+	while (context->env->delivering_events) {
+		cpi_wait_context(context);
+	}
+#endif
+}
+
+CP_HIDDEN void cpi_unregister_batch_plisteners(cp_context_t *context, cp_plugin_t *plugin) {
+	cpi_unregister_plisteners(&(context->env->batch_listeners), plugin);
+	wait_event_delivery(context);
+}
+
+/**
+ * Removes the specified node of the plug-in listener index if its set of
+ * listeners has become empty.
+ * 
+ * @param index the plug-in listener index
+ * @param hnode the index node
+ */
+static void prune_plistener_index(hash_t *index, hnode_t *hnode) {
+	cpi_plistener_set_t *listeners = hnode_get(hnode);
+	
+	if (listeners->num == 0) {
+		hash_delete_free(index, hnode);
+		cpi_free(listeners->listeners);
+		cpi_free(listeners);
+	}
+}
+
+CP_HIDDEN void cpi_unregister_indexed_plisteners(hash_t *index, cp_plugin_t *plugin) {
+	hscan_t scan;
+	hnode_t *hnode;
+	
+	hash_scan_begin(&scan, index);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		cpi_plistener_set_t *listeners = hnode_get(hnode);
+		
+		cpi_unregister_plisteners(listeners, plugin);
+		if (listeners->num == 0) {
+			hash_scan_delfree(index, hnode);
+			cpi_free(listeners);
+		}
+	}
+}
+
+/**
+ * Collapses the events concerning the same plug-in into one event from
+ * the first old state to the last new state. The collapsed event takes
+ * the place of the first event of the plug-in. Events for plug-ins which
+ * end up in their original state are left out. The plug-in identifiers
+ * must be interned.
+ * 
+ * @param events the plug-in events
+ * @param num_events the number of events
+ * @param coalesced filled with the collapsed events, space for num_events
+ * @return the number of collapsed events or -1 if out of resources
+ */
+static int coalesce_events(const cp_plugin_event_t *events, int num_events, cp_plugin_event_t *coalesced) {
+	hash_t *slots;
+	int i, n = 0;
+	
+	if ((slots = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr)) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < num_events; i++) {
+		hnode_t *node;
+		
+		if ((node = hash_lookup(slots, events[i].plugin_id)) != NULL) {
+			cp_plugin_event_t *pe = hnode_get(node);
+			
+			pe->new_state = events[i].new_state;
+		} else if (hash_alloc_insert(slots, events[i].plugin_id, coalesced + n)) {
+			coalesced[n++] = events[i];
+		} else {
+			n = -1;
+			break;
+		}
+	}
+	hash_free_nodes(slots);
+	hash_destroy(slots);
+	
+	// Leave out the plug-ins whose state did not change
+	if (n > 0) {
+		int j = 0;
+		
+		for (i = 0; i < n; i++) {
+			if (coalesced[i].old_state != coalesced[i].new_state) {
+				coalesced[j++] = coalesced[i];
+			}
+		}
+		n = j;
+	}
+	return n;
+}
+
+/**
+ * Delivers a batch of plug-in events to the batch plug-in listeners.
+ * Listeners requesting coalescing receive the collapsed events, or the
+ * original events if there is not enough memory for collapsing them.
+ * 
+ * @param env the plug-in environment
+ * @param listeners the batch plug-in listeners
+ * @param num_listeners the number of listeners
+ * @param events the plug-in events
+ * @param num_events the number of events
+ */
+static void deliver_batch(cp_plugin_env_t *env, const cpi_plistener_t *listeners, int num_listeners, const cp_plugin_event_t *events, int num_events) {
+	cp_plugin_event_t *coalesced = NULL;
+	int num_coalesced = -1;
+	int coalesce_tried = 0;
+	cpi_invocation_t inv;
+	int i;
+	
+	cpi_begin_invocation(env, &inv, CPI_CF_LISTENER);
+	for (i = 0; i < num_listeners; i++) {
+		const cpi_plistener_t *h = listeners + i;
+		
+		if ((h->flags & CP_PLF_COALESCE) && num_events > 1) {
+			if (!coalesce_tried) {
+				if ((coalesced = cpi_malloc(num_events * sizeof(cp_plugin_event_t))) != NULL) {
+					num_coalesced = coalesce_events(events, num_events, coalesced);
+				}
+				coalesce_tried = 1;
+			}
+			if (num_coalesced >= 0) {
+				if (num_coalesced > 0) {
+					h->batch_listener(coalesced, num_coalesced, h->user_data);
+				}
+				continue;
+			}
+		}
+		h->batch_listener(events, num_events, h->user_data);
+	}
+	cpi_end_invocation(&inv);
+	cpi_free(coalesced);
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Delivers the queued events with the context lock released. The queue
+ * and the listener registrations are taken over before unlocking, so
+ * state changes made meanwhile are queued for the next batch. Listeners
+ * unregistered during the delivery may still be called until it is
+ * complete, see ::cpi_unregister_batch_plisteners. Falls back to
+ * delivering with the lock held if the registrations can not be copied.
+ * The caller must have locked the context.
+ * 
+ * @param env the plug-in environment
+ */
+static void deliver_queued_events(cp_plugin_env_t *env) {
+	cp_plugin_event_t *events = env->event_queue;
+	int num_events = env->num_events;
+	int max_events = env->max_events;
+	int num_listeners = env->batch_listeners.num;
+	cpi_plistener_t *listeners;
+	
+	if (num_listeners == 0) {
+		env->num_events = 0;
+		return;
+	}
+	if ((listeners = cpi_malloc(num_listeners * sizeof(cpi_plistener_t))) == NULL) {
+		deliver_batch(env, env->batch_listeners.listeners, num_listeners, events, num_events);
+		env->num_events = 0;
+		return;
+	}
+	memcpy(listeners, env->batch_listeners.listeners, num_listeners * sizeof(cpi_plistener_t));
+	env->event_queue = NULL;
+	env->num_events = 0;
+	env->max_events = 0;
+	env->delivering_events = 1;
+	cpi_unlock_mutex(env->mutex);
+	deliver_batch(env, listeners, num_listeners, events, num_events);
+	cpi_lock_mutex(env->mutex);
+	env->delivering_events = 0;
+	cpi_signal_mutex(env->mutex);
+	cpi_free(listeners);
+	
+	// Reuse the delivered queue unless a new one has been allocated
+	if (env->event_queue == NULL) {
+		env->event_queue = events;
+		env->max_events = max_events;
+	} else {
+		cpi_free(events);
+	}
+}
+
+/**
+ * Batch plug-in listener dispatcher main function. Delivers the queued
+ * events until the dispatcher is shut down and the queue is empty.
+ * 
+ * @param arg the plug-in environment
+ */
+static void dispatch_thread(void *arg) {
+	cp_plugin_env_t *env = arg;
+	
+	cpi_lock_mutex(env->mutex);
+	for (;;) {
+		if (env->num_events > 0) {
+			deliver_queued_events(env);
+		} else if (env->event_shutdown) {
+			break;
+		} else {
+			cpi_wait_mutex(env->mutex);
+		}
+	}
+	cpi_unlock_mutex(env->mutex);
+}
+
+CP_HIDDEN void cpi_stop_event_dispatcher(cp_context_t *context) {
+	cpi_thread_t *thread;
+	
+	cpi_lock_context(context);
+	thread = context->env->event_thread;
+	context->env->event_thread = NULL;
+	context->env->event_shutdown = 1;
+	cpi_signal_context(context);
+	cpi_unlock_context(context);
+	if (thread != NULL) {
+		cpi_join_thread(thread);
+	}
+	cpi_lock_context(context);
+	context->env->event_shutdown = 0;
+	cpi_unlock_context(context);
+}
+
+CP_HIDDEN void cpi_resume_event_dispatcher(cp_context_t *context) {
+	cpi_lock_context(context);
+	if (context->env->batch_listeners.num > 0 && context->env->event_thread == NULL) {
+		context->env->event_thread = cpi_create_thread(dispatch_thread, context->env);
+	}
+	cpi_unlock_context(context);
+}
+
+#endif
+
+CP_C_API cp_status_t cp_register_plistener(cp_context_t *context, cp_plugin_listener_func_t listener, void *user_data) {
+	cp_status_t status = CP_ERR_RESOURCE;
+	cpi_plistener_t *holder;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(listener);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	if ((holder = add_plistener(&(context->env->plugin_listeners), context, user_data)) != NULL) {
+		holder->plugin_listener = listener;
+		holder->state_mask = CP_STATE_MASK_ALL;
+		status = CP_OK;
+	}
+	
+	// Report error or success
+	if (status != CP_OK) {
+		cpi_error(context, N_("A plug-in listener could not be registered due to insufficient memory."));
+	} else if (cpi_is_logged(context, CP_LOG_DEBUG)) {
+		char owner[64];
+		/* TRANSLATORS: %s is the context owner */
+		cpi_debugf(context, N_("%s registered a plug-in listener."), cpi_context_owner(context, owner, sizeof(owner)));
+	}
+	cpi_unlock_context(context);
+	
+	return status;
+}
+
+CP_C_API void cp_unregister_plistener(cp_context_t *context, cp_plugin_listener_func_t listener) {
+	int i;
+	
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	if ((i = find_plistener(&(context->env->plugin_listeners), listener, NULL)) >= 0) {
+		remove_plistener(&(context->env->plugin_listeners), i);
+	} else {
+		hscan_t scan;
+		hnode_t *hnode;
+		
+		// Look for a listener restricted to a single plug-in
+		hash_scan_begin(&scan, context->env->plugin_listener_index);
+		while ((hnode = hash_scan_next(&scan)) != NULL) {
+			cpi_plistener_set_t *listeners = hnode_get(hnode);
+			
+			if ((i = find_plistener(listeners, listener, NULL)) >= 0) {
+				remove_plistener(listeners, i);
+				prune_plistener_index(context->env->plugin_listener_index, hnode);
+				break;
+			}
+		}
+	}
+	if (cpi_is_logged(context, CP_LOG_DEBUG)) {
+		char owner[64];
+		/* TRANSLATORS: %s is the context owner */
+		cpi_debugf(context, N_("%s unregistered a plug-in listener."), cpi_context_owner(context, owner, sizeof(owner)));
+	}
+	cpi_unlock_context(context);
+}
+
+CP_C_API cp_status_t cp_register_plistener_filtered(cp_context_t *context, cp_plugin_listener_func_t listener, void *user_data, const char *plugin_id, int state_mask) {
+	cp_status_t status = CP_ERR_RESOURCE;
+	cpi_plistener_t *holder;
+	cpi_plistener_set_t *listeners = NULL;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(listener);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	do {
+		
+		// Find or create the set of listeners for the plug-in
+		if (plugin_id == NULL) {
+			listeners = &(context->env->plugin_listeners);
+		} else {
+			hnode_t *hnode;
+			char *id;
+			
+			if ((hnode = hash_lookup(context->env->plugin_listener_index, plugin_id)) != NULL) {
+				listeners = hnode_get(hnode);
+			} else if ((id = cpi_intern_string(context, plugin_id)) == NULL
+				|| (listeners = cpi_calloc(1, sizeof(cpi_plistener_set_t))) == NULL) {
+				break;
+			} else if (!hash_alloc_insert(context->env->plugin_listener_index, id, listeners)) {
+				cpi_free(listeners);
+				listeners = NULL;
+				break;
+			}
+		}
+		
+		// Register the listener
+		if ((holder = add_plistener(listeners, context, user_data)) == NULL) {
+			break;
+		}
+		holder->plugin_listener = listener;
+		holder->state_mask = state_mask;
+		status = CP_OK;
+		
+	} while (0);
+	
+	// Report error or success
 	if (status != CP_OK) {
-		if (extensions != NULL) {
-			dealloc_extensions_info(context, extensions);
-			extensions = NULL;
+		if (plugin_id != NULL && listeners != NULL) {
+			prune_plistener_index(context->env->plugin_listener_index,
+				hash_lookup(context->env->plugin_listener_index, plugin_id));
 		}
+		cpi_error(context, N_("A plug-in listener could not be registered due to insufficient memory."));
+	} else if (cpi_is_logged(context, CP_LOG_DEBUG)) {
+		char owner[64];
+		/* TRANSLATORS: %s is the context owner */
+		cpi_debugf(context, N_("%s registered a plug-in listener."), cpi_context_owner(context, owner, sizeof(owner)));
 	}
+	cpi_unlock_context(context);
 	
-	assert(status != CP_OK || n == 0 || extensions[n - 1] != NULL);
-	if (error != NULL) {
-		*error = status;
-	}
-	if (num != NULL && status == CP_OK) {
-		*num = n;
-	}
-	return extensions;
-}
-
-
-// Plug-in listeners 
-
-/**
- * Compares plug-in listener holders.
- * 
- * @param h1 the first holder to be compared
- * @param h2 the second holder to be compared
- * @return zero if the holders point to the same function, otherwise non-zero
- */
-static int comp_el_holder(const void *h1, const void *h2) {
-	const el_holder_t *plh1 = h1;
-	const el_holder_t *plh2 = h2;
-	
-	return (plh1->plugin_listener != plh2->plugin_listener);
-}
-
-/**
- * Processes a node by delivering the specified event to the associated
- * plug-in listener.
- * 
- * @param list the list being processed
- * @param node the node being processed
- * @param event the event
- */
-static void process_event(list_t *list, lnode_t *node, void *event) {
-	el_holder_t *h = lnode_get(node);
-	cpi_plugin_event_t *e = event;
-	h->plugin_listener(e->plugin_id, e->old_state, e->new_state, h->user_data);
-}
-
-/**
- * Processes a node by unregistering the associated plug-in listener.
- * 
- * @param list the list being processed
- * @param node the node being processed
- * @param plugin plugin whose listeners are to be unregistered or NULL for all
- */
-static void process_unregister_plistener(list_t *list, lnode_t *node, void *plugin) {
-	el_holder_t *h = lnode_get(node);
-	if (plugin == NULL || h->plugin == plugin) {
-		list_delete(list, node);
-		lnode_destroy(node);
-		free(h);
-	}
-}
-
-CP_HIDDEN void cpi_unregister_plisteners(list_t *listeners, cp_plugin_t *plugin) {
-	list_process(listeners, plugin, process_unregister_plistener);
+	return status;
 }
 
-CP_C_API cp_status_t cp_register_plistener(cp_context_t *context, cp_plugin_listener_func_t listener, void *user_data) {
+CP_C_API cp_status_t cp_register_plistener_batch(cp_context_t *context, cp_plugin_batch_listener_func_t listener, void *user_data, int flags) {
 	cp_status_t status = CP_ERR_RESOURCE;
-	el_holder_t *holder;
-	lnode_t *node;
+	cpi_plistener_t *holder;
 
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(listener);
 	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
-	if ((holder = malloc(sizeof(el_holder_t))) != NULL) {
-		holder->plugin_listener = listener;
-		holder->plugin = context->plugin;
-		holder->user_data = user_data;
-		if ((node = lnode_create(holder)) != NULL) {
-			list_append(context->env->plugin_listeners, node);
-			status = CP_OK;
-		} else {
-			free(holder);
-		}
+	if ((holder = add_plistener(&(context->env->batch_listeners), context, user_data)) != NULL) {
+		holder->batch_listener = listener;
+		holder->flags = flags;
+		holder->state_mask = CP_STATE_MASK_ALL;
+		status = CP_OK;
 	}
 	
+#ifdef CP_THREADS
+	// Start the dispatcher on first use, deliver synchronously on failure
+	if (status == CP_OK && context->env->event_thread == NULL) {
+		context->env->event_thread = cpi_create_thread(dispatch_thread, context->env);
+	}
+#endif
+	
 	// Report error or success
 	if (status != CP_OK) {
 		cpi_error(context, N_("A plug-in listener could not be registered due to insufficient memory."));
@@ -583,17 +2602,15 @@ CP_C_API cp_status_t cp_register_plistener(cp_context_t *context, cp_plugin_list
 	return status;
 }
 
-CP_C_API void cp_unregister_plistener(cp_context_t *context, cp_plugin_listener_func_t listener) {
-	el_holder_t holder;
-	lnode_t *node;
+CP_C_API void cp_unregister_plistener_batch(cp_context_t *context, cp_plugin_batch_listener_func_t listener) {
+	int i;
 	
 	CHECK_NOT_NULL(context);
-	holder.plugin_listener = listener;
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
-	node = list_find(context->env->plugin_listeners, &holder, comp_el_holder);
-	if (node != NULL) {
-		process_unregister_plistener(context->env->plugin_listeners, node, NULL);
+	if ((i = find_plistener(&(context->env->batch_listeners), NULL, listener)) >= 0) {
+		remove_plistener(&(context->env->batch_listeners), i);
+		wait_event_delivery(context);
 	}
 	if (cpi_is_logged(context, CP_LOG_DEBUG)) {
 		char owner[64];
@@ -603,13 +2620,75 @@ CP_C_API void cp_unregister_plistener(cp_context_t *context, cp_plugin_listener_
 	cpi_unlock_context(context);
 }
 
+#ifdef CP_THREADS
+
+/**
+ * Queues a plug-in event for the batch plug-in listener dispatcher. The
+ * caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param event the plug-in event
+ * @return whether the event was queued
+ */
+static int queue_event(cp_context_t *context, const cpi_plugin_event_t *event) {
+	cp_plugin_env_t *env = context->env;
+	cp_plugin_event_t *pe;
+	const char *plugin_id;
+	
+	if (env->num_events >= env->max_events) {
+		int n = (env->max_events > 0 ? env->max_events * 2 : 16);
+		cp_plugin_event_t *queue;
+		
+		if ((queue = cpi_realloc(env->event_queue, n * sizeof(cp_plugin_event_t))) == NULL) {
+			return 0;
+		}
+		env->event_queue = queue;
+		env->max_events = n;
+	}
+	
+	// The interned identifier remains valid after the plug-in is uninstalled
+	if ((plugin_id = cpi_intern_string(context, event->plugin_id)) == NULL) {
+		return 0;
+	}
+	pe = env->event_queue + env->num_events++;
+	pe->plugin_id = plugin_id;
+	pe->old_state = event->old_state;
+	pe->new_state = event->new_state;
+	cpi_signal_context(context);
+	return 1;
+}
+
+#endif
+
 CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t *event) {
+	cpi_invocation_t inv;
+	
 	assert(event != NULL);
 	assert(event->plugin_id != NULL);
 	cpi_lock_context(context);
-	context->env->in_event_listener_invocation++;
-	list_process(context->env->plugin_listeners, (void *) event, process_event);
-	context->env->in_event_listener_invocation--;
+	cpi_begin_invocation(context->env, &inv, CPI_CF_LISTENER);
+	deliver_to_plisteners(&(context->env->plugin_listeners), event);
+	if (!hash_isempty(context->env->plugin_listener_index)) {
+		hnode_t *hnode;
+		
+		if ((hnode = hash_lookup(context->env->plugin_listener_index, event->plugin_id)) != NULL) {
+			deliver_to_plisteners(hnode_get(hnode), event);
+		}
+	}
+	cpi_end_invocation(&inv);
+	if (context->env->batch_listeners.num > 0) {
+#ifdef CP_THREADS
+		if (context->env->event_thread == NULL || !queue_event(context, event))
+#endif
+		{
+			cp_plugin_event_t pe;
+			
+			pe.plugin_id = event->plugin_id;
+			pe.old_state = event->old_state;
+			pe.new_state = event->new_state;
+			deliver_batch(context->env, context->env->batch_listeners.listeners, context->env->batch_listeners.num, &pe, 1);
+		}
+	}
 	cpi_unlock_context(context);
 	if (cpi_is_logged(context, CP_LOG_INFO)) {
 		char *str;
@@ -650,9 +2729,283 @@ CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t
 	}
 }
 
+/**
+ * Adds the memory used by the plug-in listeners of the specified set
+ * registered by the specified plug-in to the memory statistics.
+ * 
+ * @param listeners the listener set
+ * @param plugin the registering plug-in or NULL for the client program
+ * @param stats the memory statistics
+ */
+static void add_listener_memory(const cpi_plistener_set_t *listeners, cp_plugin_t *plugin, cp_memory_stats_t *stats) {
+	int i;
+	
+	for (i = 0; i < listeners->num; i++) {
+		if (listeners->listeners[i].plugin == plugin) {
+			stats->listeners++;
+			stats->listener_bytes += sizeof(cpi_plistener_t);
+		}
+	}
+}
+
+CP_HIDDEN void cpi_listener_memory(cp_plugin_env_t *env, cp_plugin_t *plugin, cp_memory_stats_t *stats) {
+	hscan_t scan;
+	hnode_t *hnode;
+	
+	add_listener_memory(&(env->plugin_listeners), plugin, stats);
+	add_listener_memory(&(env->batch_listeners), plugin, stats);
+	hash_scan_begin(&scan, env->plugin_listener_index);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		add_listener_memory(hnode_get(hnode), plugin, stats);
+	}
+}
 
 // Configuration element helpers
 
+/// Minimum number of children or attributes for which an index is built
+#define CFG_INDEX_THRESHOLD 8
+
+/**
+ * Compares a path segment to a name.
+ * 
+ * @param seg the path segment
+ * @param len the length of the path segment
+ * @param name the name
+ * @return negative, zero or positive as for strcmp
+ */
+static int comp_segment(const char *seg, int len, const char *name) {
+	int c;
+	
+	if ((c = strncmp(seg, name, len)) == 0 && name[len] != '\0') {
+		c = -1;
+	}
+	return c;
+}
+
+static int comp_cfg_child(const void *p1, const void *p2) {
+	const cp_cfg_element_t *e1 = *((const cp_cfg_element_t * const *) p1);
+	const cp_cfg_element_t *e2 = *((const cp_cfg_element_t * const *) p2);
+	int c;
+	
+	if ((c = strcmp(e1->name, e2->name)) == 0) {
+		c = (e1 < e2 ? -1 : (e1 > e2 ? 1 : 0));
+	}
+	return c;
+}
+
+static int comp_cfg_att(const void *p1, const void *p2) {
+	char * const *a1 = *((char * const * const *) p1);
+	char * const *a2 = *((char * const * const *) p2);
+	int c;
+	
+	if ((c = strcmp(*a1, *a2)) == 0) {
+		c = (a1 < a2 ? -1 : (a1 > a2 ? 1 : 0));
+	}
+	return c;
+}
+
+/**
+ * Builds a lookup index for the specified configuration element.
+ * 
+ * @param e the configuration element
+ * @return the index or NULL if out of resources
+ */
+static cfg_index_t *build_cfg_index(cp_cfg_element_t *e) {
+	cfg_index_t *index;
+	unsigned int i;
+	
+	if ((index = cpi_malloc(sizeof(cfg_index_t)
+		+ e->num_children * sizeof(cp_cfg_element_t *)
+		+ e->num_atts * sizeof(char **))) == NULL) {
+		return NULL;
+	}
+	index->children = (cp_cfg_element_t **) (index + 1);
+	index->atts = (char ***) (index->children + e->num_children);
+	for (i = 0; i < e->num_children; i++) {
+		index->children[i] = e->children + i;
+	}
+	for (i = 0; i < e->num_atts; i++) {
+		index->atts[i] = e->atts + 2*i;
+	}
+	qsort(index->children, e->num_children, sizeof(cp_cfg_element_t *), comp_cfg_child);
+	qsort(index->atts, e->num_atts, sizeof(char **), comp_cfg_att);
+	return index;
+}
+
+/**
+ * Returns the lookup index of the specified configuration element, building
+ * it on the first call. Returns NULL if the element is too small to be
+ * indexed or if the index could not be built.
+ * 
+ * @param e the configuration element
+ * @return the index or NULL
+ */
+static cfg_index_t *get_cfg_index(cp_cfg_element_t *e) {
+	cfg_index_t *index = NULL;
+	
+	if (e->num_children < CFG_INDEX_THRESHOLD && e->num_atts < CFG_INDEX_THRESHOLD) {
+		return NULL;
+	}
+	cpi_lock_framework();
+	if (cfg_indexes != NULL) {
+		index = cpi_hmap_get(cfg_indexes, e);
+	}
+	if (index == NULL
+		&& (cfg_indexes != NULL
+			|| (cfg_indexes = cpi_create_hmap(cpi_comp_ptr, cpi_hashfunc_ptr)) != NULL)
+		&& (index = build_cfg_index(e)) != NULL
+		&& !cpi_hmap_put(cfg_indexes, e, index)) {
+		cpi_free(index);
+		index = NULL;
+	}
+	cpi_unlock_framework();
+	return index;
+}
+
+/**
+ * Returns the first child with the specified name.
+ * 
+ * @param e the parent element
+ * @param seg the name as a path segment
+ * @param len the length of the path segment
+ * @return the child or NULL if not found
+ */
+static cp_cfg_element_t *find_cfg_child(cp_cfg_element_t *e, const char *seg, int len) {
+	cfg_index_t *index;
+	unsigned int i;
+	
+	if ((index = get_cfg_index(e)) != NULL) {
+		unsigned int lo = 0, hi = e->num_children;
+		
+		// Find the first child not ordered before the segment
+		while (lo < hi) {
+			unsigned int mid = lo + (hi - lo) / 2;
+			if (comp_segment(seg, len, index->children[mid]->name) > 0) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo < e->num_children
+			&& !comp_segment(seg, len, index->children[lo]->name)) {
+			return index->children[lo];
+		}
+		return NULL;
+	}
+	for (i = 0; i < e->num_children; i++) {
+		if (!comp_segment(seg, len, e->children[i].name)) {
+			return e->children + i;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Returns the value of the specified attribute.
+ * 
+ * @param e the configuration element
+ * @param name the attribute name
+ * @return the attribute value or NULL if not found
+ */
+static char *find_cfg_att(cp_cfg_element_t *e, const char *name) {
+	cfg_index_t *index;
+	unsigned int i;
+	
+	if ((index = get_cfg_index(e)) != NULL) {
+		unsigned int lo = 0, hi = e->num_atts;
+		
+		// Find the first attribute not ordered before the name
+		while (lo < hi) {
+			unsigned int mid = lo + (hi - lo) / 2;
+			if (strcmp(name, index->atts[mid][0]) > 0) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo < e->num_atts && !strcmp(name, index->atts[lo][0])) {
+			return index->atts[lo][1];
+		}
+		return NULL;
+	}
+	for (i = 0; i < e->num_atts; i++) {
+		if (!strcmp(name, e->atts[2*i])) {
+			return e->atts[2*i + 1];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Adds the memory used by the specified configuration element and its
+ * descendants to the memory statistics. The caller must hold the framework
+ * lock which protects the lookup indexes.
+ * 
+ * @param ce the configuration element
+ * @param stats the memory statistics
+ */
+static void add_cfg_memory(const cp_cfg_element_t *ce, cp_memory_stats_t *stats) {
+	unsigned int i;
+	
+	stats->cfg_elements++;
+	stats->cfg_bytes += sizeof(cp_cfg_element_t) + strlen(ce->name) + 1;
+	if (ce->value != NULL) {
+		stats->cfg_bytes += strlen(ce->value) + 1;
+	}
+	for (i = 0; i < 2 * ce->num_atts; i++) {
+		stats->cfg_bytes += sizeof(char *) + strlen(ce->atts[i]) + 1;
+	}
+	
+	// Lookup indexes are allocated separately from the plug-in description
+	if (cfg_indexes != NULL && cpi_hmap_get(cfg_indexes, ce) != NULL) {
+		size_t bytes = sizeof(cfg_index_t)
+			+ ce->num_children * sizeof(cp_cfg_element_t *)
+			+ ce->num_atts * sizeof(char **);
+		
+		stats->cfg_bytes += bytes;
+		stats->descriptor_bytes += bytes;
+		stats->descriptor_objects++;
+	}
+	for (i = 0; i < ce->num_children; i++) {
+		add_cfg_memory(ce->children + i, stats);
+	}
+}
+
+CP_HIDDEN void cpi_cfg_memory(const cp_cfg_element_t *ce, cp_memory_stats_t *stats) {
+	cpi_lock_framework();
+	add_cfg_memory(ce, stats);
+	cpi_unlock_framework();
+}
+
+/**
+ * Frees the lookup indexes built for the specified configuration element
+ * tree. The caller must hold the framework lock.
+ * 
+ * @param ce the root of the configuration element tree
+ */
+static void free_cfg_indexes(cp_cfg_element_t *ce) {
+	unsigned int i;
+	
+	for (i = 0; i < ce->num_children; i++) {
+		free_cfg_indexes(ce->children + i);
+	}
+	if (ce->num_children >= CFG_INDEX_THRESHOLD || ce->num_atts >= CFG_INDEX_THRESHOLD) {
+		cpi_free(cpi_hmap_remove(cfg_indexes, ce));
+	}
+}
+
+CP_HIDDEN void cpi_free_cfg_indexes(cp_cfg_element_t *ce) {
+	cpi_lock_framework();
+	if (cfg_indexes != NULL) {
+		free_cfg_indexes(ce);
+		if (cpi_hmap_count(cfg_indexes) == 0) {
+			cpi_destroy_hmap(cfg_indexes);
+			cfg_indexes = NULL;
+		}
+	}
+	cpi_unlock_framework();
+}
+
 static cp_cfg_element_t * lookup_cfg_element(cp_cfg_element_t *base, const char *path, int len) {
 	int start = 0;
 	
@@ -667,20 +3020,7 @@ static cp_cfg_element_t * lookup_cfg_element(cp_cfg_element_t *base, const char
 		if (end - start == 2 && !strncmp(path + start, "..", 2)) {
 			base = base->parent;
 		} else {
-			int i;
-			int found = 0;
-			
-			for (i = 0; !found && i < base->num_children; i++) {
-				cp_cfg_element_t *e = base->children + i;
-				if (end - start == strlen(e->name)
-					&& !strncmp(path + start, e->name, end - start)) {
-					base = e;
-					found = 1;
-				}
-			}
-			if (!found) {
-				base = NULL;
-			}
+			base = find_cfg_child(base, path + start, end - start);
 		}
 		start = end;
 		if (path[start] == '/') {
@@ -694,6 +3034,21 @@ CP_C_API cp_cfg_element_t * cp_lookup_cfg_element(cp_cfg_element_t *base, const
 	return lookup_cfg_element(base, path, -1);
 }
 
+CP_C_API cp_cfg_element_t * cp_get_extension_cfg(cp_context_t *context, cp_extension_t *ext, cp_status_t *error) {
+	cp_status_t status;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(ext);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	status = cpi_materialize_cfg(context, ext);
+	cpi_unlock_context(context);
+	if (error != NULL) {
+		*error = status;
+	}
+	return ext->configuration;
+}
+
 CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) {
 	cp_cfg_element_t *e;
 	const char *attr;
@@ -711,16 +3066,133 @@ CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) {
 		if (attr == NULL) {
 			return e->value;
 		} else {
-			int i;
+			return find_cfg_att(e, attr);
+		}
+	} else {
+		return NULL;
+	}
+}
+
+static void dealloc_cfg_path(cp_context_t *context, cp_cfg_path_t *path) {
+	cpi_free_info(path);
+}
+
+CP_C_API cp_cfg_path_t * cp_compile_cfg_path(cp_context_t *context, const char *path, cp_status_t *error) {
+	cp_cfg_path_t *cpath = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(path);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		const char *attr;
+		char *buffer;
+		int len, plen, start, end;
+		unsigned int n;
+		
+		// Count the segments
+		len = strlen(path);
+		plen = ((attr = strrchr(path, '@')) != NULL ? attr - path : len);
+		for (n = 0, start = 0; start < plen; n++) {
+			for (end = start; end < plen && path[end] != '/'; end++);
+			start = (end < plen ? end + 1 : end);
+		}
+		
+		// Allocate the path, the segments and a copy of the path in one block
+		if ((cpath = cpi_alloc_info(sizeof(cp_cfg_path_t)
+			+ n * sizeof(cfg_segment_t) + len + 1)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(cpath, 0, sizeof(cp_cfg_path_t));
+		cpath->segments = (cfg_segment_t *) (cpath + 1);
+		buffer = (char *) (cpath->segments + n);
+		strcpy(buffer, path);
+		if (attr != NULL) {
+			cpath->attribute = buffer + plen + 1;
+		}
+		
+		// Split and intern the segments
+		for (start = 0; start < plen && status == CP_OK; cpath->num_segments++) {
+			cfg_segment_t *seg = cpath->segments + cpath->num_segments;
+			
+			for (end = start; end < plen && path[end] != '/'; end++);
+			buffer[end] = '\0';
+			if (end - start == 2 && !strncmp(path + start, "..", 2)) {
+				seg->name = NULL;
+			} else if ((seg->name = cpi_intern_string(context, buffer + start)) == NULL) {
+				status = CP_ERR_RESOURCE;
+			}
+			seg->len = end - start;
+			start = (end < plen ? end + 1 : end);
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Register the path
+		status = cpi_register_info(context, cpath, (void (*)(cp_context_t *, void *)) dealloc_cfg_path);
+		
+	} while (0);
+	
+	// Report error
+	if (status != CP_OK) {
+		cpi_error(context, N_("Configuration path could not be compiled due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources on error
+	if (status != CP_OK && cpath != NULL) {
+		dealloc_cfg_path(context, cpath);
+		cpath = NULL;
+	}
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	return cpath;
+}
+
+CP_C_API cp_cfg_element_t * cp_lookup_cfg_compiled(cp_cfg_element_t *base, const cp_cfg_path_t *path) {
+	unsigned int i;
+	
+	CHECK_NOT_NULL(base);
+	CHECK_NOT_NULL(path);
+	
+	// Traverse the path, comparing the interned names by pointer first
+	for (i = 0; base != NULL && i < path->num_segments; i++) {
+		const cfg_segment_t *seg = path->segments + i;
+		
+		if (seg->name == NULL) {
+			base = base->parent;
+		} else if (base->num_children >= CFG_INDEX_THRESHOLD) {
+			base = find_cfg_child(base, seg->name, seg->len);
+		} else {
+			cp_cfg_element_t *e = NULL;
+			unsigned int j;
 			
-			for (i = 0; i < e->num_atts; i++) {
-				if (!strcmp(attr, e->atts[2*i])) {
-					return e->atts[2*i + 1];
+			for (j = 0; e == NULL && j < base->num_children; j++) {
+				const char *name = base->children[j].name;
+				if (name == seg->name
+					|| (name[0] == seg->name[0] && !strcmp(name, seg->name))) {
+					e = base->children + j;
 				}
 			}
-			return NULL;
+			base = e;
 		}
-	} else {
+	}
+	return base;
+}
+
+CP_C_API char * cp_lookup_cfg_value_compiled(cp_cfg_element_t *base, const cp_cfg_path_t *path) {
+	cp_cfg_element_t *e;
+	
+	if ((e = cp_lookup_cfg_compiled(base, path)) == NULL) {
 		return NULL;
+	} else if (path->attribute == NULL) {
+		return e->value;
+	} else {
+		return find_cfg_att(e, path->attribute);
 	}
 }
@@ -44,6 +44,72 @@
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// Local plug-in loader data
+typedef struct lpl_data_t {
+
+	/// The registered plug-in directories
+	list_t *dirs;
+	
+	/// The number of descriptor parser threads, or 0 for serial parsing
+	int num_parser_threads;
+	
+	/// Maps descriptor file paths to descriptor stamps seen on the last scan
+	hash_t *stamps;
+	
+	/// The number of scans performed
+	unsigned int num_scans;
+
+} lpl_data_t;
+
+/// Status of a plug-in descriptor at the time of a scan
+typedef struct lpl_stamp_t {
+
+	/// The descriptor file path
+	char *file;
+	
+	/// Modification time of the descriptor file
+	time_t mtime;
+	
+	/// Size of the descriptor file
+	off_t size;
+	
+	/// The number of the scan this descriptor was last seen in
+	unsigned int scan;
+
+} lpl_stamp_t;
+
+#ifdef CP_THREADS
+
+/// State shared by the threads of a parallel descriptor parsing job
+typedef struct lpl_parse_job_t {
+
+	/// The plug-in context
+	cp_context_t *context;
+	
+	/// The plug-in paths to be parsed
+	char **paths;
+	
+	/// The loaded descriptors in path order, NULL for failed ones
+	cp_plugin_info_t **plugins;
+	
+	/// The number of paths
+	int num_paths;
+	
+	/// The index of the next path to be parsed
+	int next_path;
+	
+	/// The number of parser threads still running
+	int num_active;
+
+} lpl_parse_job_t;
+
+#endif
+
+
 /* ------------------------------------------------------------------------
  * Variables
  * ----------------------------------------------------------------------*/
@@ -57,27 +123,37 @@ static list_t *local_ploaders = NULL;
  * ----------------------------------------------------------------------*/
 
 static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx);
+static cp_plugin_info_t **lpl_scan_changes(void *data, cp_context_t *ctx);
+
+/// Registration options of local plug-in loaders
+static const cpi_ploader_options_t lpl_options = { CP_PLR_THREAD_SAFE, lpl_scan_changes };
 
 CP_C_API cp_plugin_loader_t *cp_create_local_ploader(cp_status_t *error) {
 	cp_plugin_loader_t *loader = NULL;
+	lpl_data_t *data;
 	cp_status_t status = CP_OK;
 	
 	// Allocate and initialize a new local plug-in loader
 	do {
 	
 		// Allocate memory for the loader
-		if ((loader = malloc(sizeof(cp_plugin_loader_t))) == NULL) {
+		if ((loader = cpi_create_ploader(&lpl_options)) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
 		
 		// Initialize loader
-		memset(loader, 0, sizeof(cp_plugin_loader_t));
-		loader->data = list_create(LISTCOUNT_T_MAX);
+		loader->data = data = cpi_malloc(sizeof(lpl_data_t));
 		loader->scan_plugins = lpl_scan_plugins;
 		loader->resolve_files = NULL;
-		loader->release_plugins = NULL;
-		if (loader->data == NULL) {
+		loader->release_plugins = cpi_release_loaded_plugins;
+		if (data == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(data, 0, sizeof(lpl_data_t));
+		if ((data->dirs = list_create(LISTCOUNT_T_MAX)) == NULL
+			|| (data->stamps = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -120,17 +196,33 @@ CP_C_API cp_plugin_loader_t *cp_create_local_ploader(cp_status_t *error) {
 }
 
 CP_C_API void cp_destroy_local_ploader(cp_plugin_loader_t *loader) {
-	list_t *dirs;
+	lpl_data_t *data;
 	
 	CHECK_NOT_NULL(loader);
 	
-	dirs = (list_t *) loader->data;
-	if (loader->data != NULL) {
-		list_process(dirs, NULL, cpi_process_free_ptr);
-		list_destroy(dirs);
+	data = (lpl_data_t *) loader->data;
+	if (data != NULL) {
+		if (data->dirs != NULL) {
+			list_process(data->dirs, NULL, cpi_process_free_ptr);
+			list_destroy(data->dirs);
+		}
+		if (data->stamps != NULL) {
+			hscan_t hscan;
+			hnode_t *hnode;
+			
+			hash_scan_begin(&hscan, data->stamps);
+			while ((hnode = hash_scan_next(&hscan)) != NULL) {
+				lpl_stamp_t *stamp = hnode_get(hnode);
+				hash_scan_delfree(data->stamps, hnode);
+				cpi_free(stamp->file);
+				cpi_free(stamp);
+			}
+			hash_destroy(data->stamps);
+		}
+		cpi_free(data);
 		loader->data = NULL;
 	}
-	free(loader);
+	cpi_destroy_ploader(loader);
 }
 
 CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char *dir) {
@@ -142,7 +234,7 @@ CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char
 	CHECK_NOT_NULL(loader);
 	CHECK_NOT_NULL(dir);
 	
-	dirs = (list_t *) loader->data;
+	dirs = ((lpl_data_t *) loader->data)->dirs;
 	do {
 	
 		// Check if directory has already been registered 
@@ -151,7 +243,7 @@ CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char
 		}
 	
 		// Allocate resources 
-		d = malloc(sizeof(char) * (strlen(dir) + 1));
+		d = cpi_malloc(sizeof(char) * (strlen(dir) + 1));
 		node = lnode_create(d);
 		if (d == NULL || node == NULL) {
 			status = CP_ERR_RESOURCE;
@@ -167,7 +259,7 @@ CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char
 	// Release resources on failure 
 	if (status != CP_OK) {	
 		if (d != NULL) {
-			free(d);
+			cpi_free(d);
 		}
 		if (node != NULL) {
 			lnode_destroy(node);
@@ -185,13 +277,13 @@ CP_C_API void cp_lpl_unregister_dir(cp_plugin_loader_t *loader, const char *dir)
 	CHECK_NOT_NULL(loader);
 	CHECK_NOT_NULL(dir);
 	
-	dirs = (list_t *) loader->data;
+	dirs = ((lpl_data_t *) loader->data)->dirs;
 	node = list_find(dirs, dir, (int (*)(const void *, const void *)) strcmp);
 	if (node != NULL) {
 		d = lnode_get(node);
 		list_delete(dirs, node);
 		lnode_destroy(node);
-		free(d);
+		cpi_free(d);
 	}
 }
 
@@ -199,34 +291,237 @@ CP_C_API void cp_lpl_unregister_dirs(cp_plugin_loader_t *loader) {
 	list_t *dirs;
 	
 	CHECK_NOT_NULL(loader);
-	dirs = (list_t *) loader->data;
+	dirs = ((lpl_data_t *) loader->data)->dirs;
 	list_process(dirs, NULL, cpi_process_free_ptr);
 }
 
-static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx) {
+CP_C_API void cp_lpl_set_parser_threads(cp_plugin_loader_t *loader, int num_threads) {
+	CHECK_NOT_NULL(loader);
+	((lpl_data_t *) loader->data)->num_parser_threads = (num_threads > 1 ? num_threads : 0);
+}
+
+CP_HIDDEN cp_status_t cpi_lpl_copy(cp_plugin_loader_t *dst, const cp_plugin_loader_t *src) {
+	lpl_data_t *sdata = (lpl_data_t *) src->data;
+	lpl_data_t *ddata = (lpl_data_t *) dst->data;
+	lnode_t *node;
+	hscan_t hscan;
+	hnode_t *hnode;
+	cp_status_t status = CP_OK;
+	
+	// Copy the registered directories
+	for (node = list_first(sdata->dirs);
+		node != NULL && status == CP_OK;
+		node = list_next(sdata->dirs, node)) {
+		status = cp_lpl_register_dir(dst, lnode_get(node));
+	}
+	
+	// Copy the descriptor stamps so that change scans continue from the same state
+	hash_scan_begin(&hscan, sdata->stamps);
+	while (status == CP_OK && (hnode = hash_scan_next(&hscan)) != NULL) {
+		lpl_stamp_t *stamp = hnode_get(hnode);
+		lpl_stamp_t *copy;
+		
+		if (hash_lookup(ddata->stamps, stamp->file) != NULL) {
+			continue;
+		}
+		if ((copy = cpi_malloc(sizeof(lpl_stamp_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		*copy = *stamp;
+		if ((copy->file = cpi_strdup(stamp->file)) == NULL
+			|| !hash_alloc_insert(ddata->stamps, copy->file, copy)) {
+			cpi_free(copy->file);
+			cpi_free(copy);
+			status = CP_ERR_RESOURCE;
+		}
+	}
+	ddata->num_parser_threads = sdata->num_parser_threads;
+	ddata->num_scans = sdata->num_scans;
+	
+	return status;
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Parser thread main function. Loads descriptors from the job paths until
+ * all paths have been taken and then signals the scanning thread.
+ * 
+ * @param arg the parsing job
+ */
+static void lpl_parse_thread(void *arg) {
+	lpl_parse_job_t *job = arg;
+	cp_context_t *ctx = job->context;
+	
+	cpi_lock_context(ctx);
+	while (job->next_path < job->num_paths) {
+		int i = job->next_path++;
+		cp_status_t s;
+		
+		// Parse without holding the context lock
+		cpi_unlock_context(ctx);
+		job->plugins[i] = cp_load_plugin_descriptor(ctx, job->paths[i], &s);
+		cpi_lock_context(ctx);
+	}
+	job->num_active--;
+	cpi_signal_context(ctx);
+	cpi_unlock_context(ctx);
+}
+
+#endif
+
+/**
+ * Loads the plug-in descriptors from the specified paths. The descriptors
+ * are parsed by parser threads if so configured and otherwise serially by
+ * the calling thread. The resulting descriptors are stored in path order
+ * so that the outcome does not depend on the parsing order.
+ * 
+ * @param data the loader data
+ * @param ctx the plug-in context
+ * @param paths the plug-in paths
+ * @param plugins the array where the loaded descriptors are stored
+ * @param num_paths the number of paths
+ */
+static void lpl_load_descriptors(lpl_data_t *data, cp_context_t *ctx, char **paths, cp_plugin_info_t **plugins, int num_paths) {
+	int i = 0;
+
+#ifdef CP_THREADS
+	if (data->num_parser_threads > 1 && num_paths > 1) {
+		lpl_parse_job_t job;
+		cpi_thread_t **threads;
+		int num_threads;
+		
+		memset(&job, 0, sizeof(lpl_parse_job_t));
+		job.context = ctx;
+		job.paths = paths;
+		job.plugins = plugins;
+		job.num_paths = num_paths;
+		num_threads = data->num_parser_threads;
+		if (num_threads > num_paths) {
+			num_threads = num_paths;
+		}
+		
+		// Start the parser threads and wait for them to complete
+		if ((threads = cpi_malloc(sizeof(cpi_thread_t *) * num_threads)) != NULL) {
+			int t;
+			
+			cpi_lock_context(ctx);
+			for (t = 0; t < num_threads; t++) {
+				if ((threads[t] = cpi_create_thread(lpl_parse_thread, &job)) == NULL) {
+					break;
+				}
+				job.num_active++;
+			}
+			num_threads = t;
+			while (job.num_active > 0) {
+				cpi_wait_context(ctx);
+			}
+			i = job.next_path;
+			cpi_unlock_context(ctx);
+			for (t = 0; t < num_threads; t++) {
+				cpi_join_thread(threads[t]);
+			}
+			cpi_free(threads);
+		}
+	}
+#endif
+
+	// Load any remaining descriptors serially
+	for (; i < num_paths; i++) {
+		cp_status_t s;
+		
+		plugins[i] = cp_load_plugin_descriptor(ctx, paths[i], &s);
+	}
+}
+
+/**
+ * Records the current status of the plug-in descriptor at the specified
+ * plug-in location and returns whether it has changed since the previous
+ * scan. Locations without an accessible descriptor are reported unchanged.
+ * 
+ * @param data the loader data
+ * @param ctx the plug-in context
+ * @param pdir_path the plug-in location
+ * @return whether the descriptor is new or has been modified
+ */
+static int lpl_update_stamp(lpl_data_t *data, cp_context_t *ctx, const char *pdir_path) {
+	char *file;
+	struct stat st;
+	hnode_t *hnode;
+	lpl_stamp_t *stamp;
+	int pdir_path_len;
+	int changed = 1;
+	
+	// Construct the descriptor file path
+	pdir_path_len = strlen(pdir_path);
+	if ((file = cpi_malloc((pdir_path_len + strlen(ctx->env->plugin_descriptor_name) + 2) * sizeof(char))) == NULL) {
+		return 1;
+	}
+	strcpy(file, pdir_path);
+	file[pdir_path_len] = CP_FNAMESEP_CHAR;
+	strcpy(file + pdir_path_len + 1, ctx->env->plugin_descriptor_name);
+	if (stat(file, &st)) {
+		cpi_free(file);
+		return 0;
+	}
+	
+	// Compare to and update the previous status
+	if ((hnode = hash_lookup(data->stamps, file)) != NULL) {
+		stamp = hnode_get(hnode);
+		changed = (stamp->mtime != st.st_mtime || stamp->size != st.st_size);
+		cpi_free(file);
+	} else {
+		if ((stamp = cpi_malloc(sizeof(lpl_stamp_t))) == NULL) {
+			cpi_free(file);
+			return 1;
+		}
+		stamp->file = file;
+		if (!hash_alloc_insert(data->stamps, stamp->file, stamp)) {
+			cpi_free(file);
+			cpi_free(stamp);
+			return 1;
+		}
+	}
+	stamp->mtime = st.st_mtime;
+	stamp->size = st.st_size;
+	stamp->scan = data->num_scans;
+	return changed;
+}
+
+/**
+ * Scans the registered directories for plug-ins.
+ * 
+ * @param data the loader data
+ * @param ctx the plug-in context
+ * @param changes_only whether to only load descriptors that are new or have
+ * 			been modified since the previous scan
+ * @return pointer to a NULL-terminated array of plug-in information pointers, or NULL on failure
+ */
+static cp_plugin_info_t **lpl_scan(lpl_data_t *data, cp_context_t *ctx, int changes_only) {
 	hash_t *avail_plugins = NULL;
-	char *pdir_path = NULL;
-	int pdir_path_size = 0;
+	char **pdir_paths = NULL;
+	int num_pdir_paths = 0;
+	int pdir_paths_size = 0;
+	cp_plugin_info_t **loaded_plugins = NULL;
 	list_t *dirs;
 	cp_plugin_info_t **plugins = NULL;
+	int i;
 	
-	CHECK_NOT_NULL(data);
-	CHECK_NOT_NULL(ctx);
-	
-	dirs = (list_t*) data;
+	dirs = data->dirs;
+	data->num_scans++;
 	do {
 		lnode_t *lnode;
 		hscan_t hscan;
 		hnode_t *hnode;
 		int num_avail_plugins;
-		int i;
 	
 		// Create a hash for available plug-ins 
-		if ((avail_plugins = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+		if ((avail_plugins = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL) {
 			break;
 		}
 	
-		// Scan plug-in loaders for available plug-ins 
+		// Collect the possible plug-in locations
 		lnode = list_first(dirs);
 		while (lnode != NULL) {			
 			const char *dir_path;
@@ -246,81 +541,121 @@ static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx) {
 				while ((de = readdir(dir)) != NULL) {
 					if (de->d_name[0] != '\0' && de->d_name[0] != '.') {
 						int pdir_path_len = dir_path_len + 1 + strlen(de->d_name) + 1;
-						cp_plugin_info_t *plugin;
-						cp_status_t s;
-						hnode_t *hnode;
+						char *pdir_path;
 
 						// Allocate memory for plug-in descriptor path 
-						if (pdir_path_size <= pdir_path_len) {
-							char *new_pdir_path;
-						
-							if (pdir_path_size == 0) {
-								pdir_path_size = 128;
-							}
-							while (pdir_path_size <= pdir_path_len) {
-								pdir_path_size *= 2;
+						if (num_pdir_paths == pdir_paths_size) {
+							char **new_pdir_paths;
+							int ns;
+							
+							ns = (pdir_paths_size == 0 ? 64 : pdir_paths_size * 2);
+							new_pdir_paths = cpi_realloc(pdir_paths, ns * sizeof(char *));
+							if (new_pdir_paths != NULL) {
+								pdir_paths = new_pdir_paths;
+								pdir_paths_size = ns;
 							}
-							new_pdir_path = realloc(pdir_path, pdir_path_size * sizeof(char));
-							if (new_pdir_path == NULL) {
-								cpi_errorf(ctx, N_("Could not check possible plug-in location %s%c%s due to insufficient system resources."), dir_path, CP_FNAMESEP_CHAR, de->d_name);
+						}
+						pdir_path = NULL;
+						if (num_pdir_paths < pdir_paths_size) {
+							pdir_path = cpi_malloc(pdir_path_len * sizeof(char));
+						}
+						if (pdir_path == NULL) {
+							cpi_lock_context(ctx);
+							cpi_errorf(ctx, N_("Could not check possible plug-in location %s%c%s due to insufficient system resources."), dir_path, CP_FNAMESEP_CHAR, de->d_name);
+							cpi_unlock_context(ctx);
 
-								// continue loading plug-ins from other directories 
-								continue;
-							}
-							pdir_path = new_pdir_path;
+							// continue loading plug-ins from other directories 
+							errno = 0;
+							continue;
 						}
 					
 						// Construct plug-in descriptor path 
 						strcpy(pdir_path, dir_path);
 						pdir_path[dir_path_len] = CP_FNAMESEP_CHAR;
 						strcpy(pdir_path + dir_path_len + 1, de->d_name);
-							
-						// Try to load a plug-in 
-						plugin = cp_load_plugin_descriptor(ctx, pdir_path, &s);
-						if (plugin == NULL) {
 						
-							// continue loading plug-ins from other directories 
+						// Skip unchanged locations when scanning for changes
+						if (!lpl_update_stamp(data, ctx, pdir_path) && changes_only) {
+							cpi_free(pdir_path);
+							errno = 0;
 							continue;
 						}
-					
-						// Insert plug-in to the list of available plug-ins 
-						if ((hnode = hash_lookup(avail_plugins, plugin->identifier)) != NULL) {
-							cp_plugin_info_t *plugin2 = hnode_get(hnode);
-							if (cpi_vercmp(plugin->version, plugin2->version) > 0) {
-								hash_delete_free(avail_plugins, hnode);
-								cp_release_info(ctx, plugin2);
-								hnode = NULL;
-							}
-						}
-						if (hnode == NULL) {
-							if (!hash_alloc_insert(avail_plugins, plugin->identifier, plugin)) {
-								cpi_errorf(ctx, N_("Plug-in %s version %s could not be loaded due to insufficient system resources."), plugin->identifier, plugin->version);
-								cp_release_info(ctx, plugin);
-
-								// continue loading plug-ins from other directories 
-								continue;
-							}
-						}
-						
+						pdir_paths[num_pdir_paths++] = pdir_path;
 					}
 					errno = 0;
 				}
 				if (errno) {
+					cpi_lock_context(ctx);
 					cpi_errorf(ctx, N_("Could not read plug-in directory %s: %s"), dir_path, strerror(errno));
+					cpi_unlock_context(ctx);
 					// continue loading plug-ins from other directories 
 				}
 				closedir(dir);
 			} else {
+				cpi_lock_context(ctx);
 				cpi_errorf(ctx, N_("Could not open plug-in directory %s: %s"), dir_path, strerror(errno));
+				cpi_unlock_context(ctx);
 				// continue loading plug-ins from other directories 
 			}
 			
 			lnode = list_next(dirs, lnode);
 		}
+		
+		// Forget the descriptors that were not seen anymore
+		hash_scan_begin(&hscan, data->stamps);
+		while ((hnode = hash_scan_next(&hscan)) != NULL) {
+			lpl_stamp_t *stamp = hnode_get(hnode);
+			
+			if (stamp->scan != data->num_scans) {
+				hash_scan_delfree(data->stamps, hnode);
+				cpi_free(stamp->file);
+				cpi_free(stamp);
+			}
+		}
+		
+		// Try to load the plug-ins
+		if (num_pdir_paths > 0) {
+			if ((loaded_plugins = cpi_malloc(sizeof(cp_plugin_info_t *) * num_pdir_paths)) == NULL) {
+				break;
+			}
+			memset(loaded_plugins, 0, sizeof(cp_plugin_info_t *) * num_pdir_paths);
+			lpl_load_descriptors(data, ctx, pdir_paths, loaded_plugins, num_pdir_paths);
+		}
+		
+		// Insert plug-ins to the list of available plug-ins in location order
+		for (i = 0; i < num_pdir_paths; i++) {
+			cp_plugin_info_t *plugin = loaded_plugins[i];
+			
+			if (plugin == NULL) {
+				continue;
+			}
+			loaded_plugins[i] = NULL;
+			if ((hnode = hash_lookup(avail_plugins, plugin->identifier)) != NULL) {
+				cp_plugin_info_t *plugin2 = hnode_get(hnode);
+				if (cpi_version_cmp(&cpi_plugin_versions(plugin)->version, &cpi_plugin_versions(plugin2)->version) > 0) {
+					hash_delete_free(avail_plugins, hnode);
+					cp_release_info(ctx, plugin2);
+					hnode = NULL;
+				} else {
+					cp_release_info(ctx, plugin);
+				}
+			}
+			if (hnode == NULL) {
+				if (!hash_alloc_insert(avail_plugins, plugin->identifier, plugin)) {
+					cpi_lock_context(ctx);
+					cpi_errorf(ctx, N_("Plug-in %s version %s could not be loaded due to insufficient system resources."), plugin->identifier, plugin->version);
+					cpi_unlock_context(ctx);
+					cp_release_info(ctx, plugin);
+
+					// continue loading other plug-ins
+					continue;
+				}
+			}
+		}
 
 		// Construct an array of plug-ins
 		num_avail_plugins = hash_count(avail_plugins);
-		if ((plugins = malloc(sizeof(cp_plugin_info_t *) * (num_avail_plugins + 1))) == NULL) {
+		if ((plugins = cpi_malloc(sizeof(cp_plugin_info_t *) * (num_avail_plugins + 1))) == NULL) {
 			break;
 		}
 		hash_scan_begin(&hscan, avail_plugins);
@@ -337,8 +672,19 @@ static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx) {
 	} while (0);
 	
 	// Release resources 
-	if (pdir_path != NULL) {
-		free(pdir_path);
+	if (loaded_plugins != NULL) {
+		for (i = 0; i < num_pdir_paths; i++) {
+			if (loaded_plugins[i] != NULL) {
+				cp_release_info(ctx, loaded_plugins[i]);
+			}
+		}
+		cpi_free(loaded_plugins);
+	}
+	if (pdir_paths != NULL) {
+		for (i = 0; i < num_pdir_paths; i++) {
+			cpi_free(pdir_paths[i]);
+		}
+		cpi_free(pdir_paths);
 	}
 	if (avail_plugins != NULL) {
 		hscan_t hscan;
@@ -355,3 +701,15 @@ static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx) {
 	
 	return plugins;
 }
+
+static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx) {
+	CHECK_NOT_NULL(data);
+	CHECK_NOT_NULL(ctx);
+	return lpl_scan(data, ctx, 0);
+}
+
+static cp_plugin_info_t **lpl_scan_changes(void *data, cp_context_t *ctx) {
+	CHECK_NOT_NULL(data);
+	CHECK_NOT_NULL(ctx);
+	return lpl_scan(data, ctx, 1);
+}
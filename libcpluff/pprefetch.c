@@ -0,0 +1,317 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/** @file
+ * Background prefetch of plug-in runtime libraries
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#if defined(HAVE_POSIX_FADVISE) && defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H)
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef POSIX_FADV_WILLNEED
+#define CP_USE_FADVISE
+#endif
+#endif
+#include "cpluff.h"
+#include "defines.h"
+#include "util.h"
+#include "internal.h"
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Buffer size for reading a runtime library without read-ahead advice
+#define CP_PREFETCH_BUFFER_SIZE 16384
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// A runtime library to be prefetched
+typedef struct prefetch_item_t {
+	
+	/// Identifier of the plug-in
+	char *plugin_id;
+	
+	/// Path of the runtime library
+	char *path;
+	
+} prefetch_item_t;
+
+/// A runtime library prefetch
+struct cpi_prefetch_t {
+	
+	/// The plug-in context
+	cp_context_t *context;
+	
+	/// The prefetch flags
+	int flags;
+	
+	/// The runtime libraries to be prefetched
+	prefetch_item_t *items;
+	
+	/// The number of runtime libraries
+	int num_items;
+	
+	/// Whether the prefetch has been cancelled
+	int cancelled;
+	
+#ifdef CP_THREADS
+	/// The prefetch thread, or NULL if prefetching in the calling thread
+	cpi_thread_t *thread;
+#endif
+
+};
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+static void free_prefetch(cpi_prefetch_t *prefetch) {
+	int i;
+	
+	for (i = 0; i < prefetch->num_items; i++) {
+		cpi_free(prefetch->items[i].plugin_id);
+		cpi_free(prefetch->items[i].path);
+	}
+	cpi_free(prefetch->items);
+	cpi_free(prefetch);
+}
+
+/**
+ * Brings the contents of the specified file into the page cache. Uses
+ * read-ahead advice if available and otherwise reads the file.
+ * 
+ * @param path the file path
+ */
+static void read_ahead(const char *path) {
+#ifdef CP_USE_FADVISE
+	int fd;
+	
+	if ((fd = open(path, O_RDONLY)) >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+#else
+	FILE *fh;
+	
+	if ((fh = fopen(path, "rb")) != NULL) {
+		char *buffer;
+		
+		if ((buffer = cpi_malloc(CP_PREFETCH_BUFFER_SIZE)) != NULL) {
+			while (fread(buffer, 1, CP_PREFETCH_BUFFER_SIZE, fh) == CP_PREFETCH_BUFFER_SIZE);
+			cpi_free(buffer);
+		}
+		fclose(fh);
+	}
+#endif
+}
+
+/**
+ * Stores a runtime library handle opened by the prefetch for the plug-in
+ * to use when it is resolved. The handle is closed if the plug-in has been
+ * uninstalled, replaced or resolved meanwhile. The caller must have locked
+ * the plug-in context.
+ * 
+ * @param context the plug-in context
+ * @param item the prefetched runtime library
+ * @param handle the runtime library handle
+ */
+static void store_handle(cp_context_t *context, const prefetch_item_t *item, DLHANDLE handle) {
+	cp_plugin_t *plugin;
+	char *rlpath;
+	int stored = 0;
+	
+	if ((plugin = cpi_hmap_get(context->env->plugins, item->plugin_id)) != NULL
+		&& plugin->runtime_lib == NULL
+		&& plugin->prefetched_lib == NULL
+		&& plugin->plugin->runtime_lib_name != NULL
+		&& (rlpath = cpi_runtime_lib_path(plugin->plugin)) != NULL) {
+		if (!strcmp(rlpath, item->path)) {
+			plugin->prefetched_lib = handle;
+			stored = 1;
+		}
+		cpi_free(rlpath);
+	}
+	if (!stored) {
+		DLCLOSE(handle);
+	}
+}
+
+/**
+ * Prefetches the runtime libraries until all have been processed or the
+ * prefetch is cancelled. The context lock is released while accessing the
+ * files. The caller must have locked the plug-in context exactly once.
+ * 
+ * @param prefetch the prefetch
+ */
+static void run_prefetch(cpi_prefetch_t *prefetch) {
+	cp_context_t *context = prefetch->context;
+	int i;
+	
+	for (i = 0; i < prefetch->num_items && !prefetch->cancelled; i++) {
+		prefetch_item_t *item = prefetch->items + i;
+		DLHANDLE handle = NULL;
+		
+		cpi_unlock_context(context);
+		read_ahead(item->path);
+		if (prefetch->flags & CP_PF_DLOPEN) {
+			handle = DLOPEN(item->path);
+		}
+		cpi_lock_context(context);
+		if (handle != NULL) {
+			store_handle(context, item, handle);
+		}
+	}
+	cpi_debugf(context, N_("Prefetched %d plug-in runtime libraries."), i);
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Prefetch thread main function.
+ * 
+ * @param arg the prefetch
+ */
+static void prefetch_thread(void *arg) {
+	cpi_prefetch_t *prefetch = arg;
+	
+	cpi_lock_context(prefetch->context);
+	run_prefetch(prefetch);
+	cpi_unlock_context(prefetch->context);
+}
+
+#endif
+
+CP_HIDDEN void cpi_stop_prefetch(cp_context_t *context) {
+	cpi_prefetch_t *prefetch;
+	
+	cpi_lock_context(context);
+	if ((prefetch = context->env->prefetch) != NULL) {
+		prefetch->cancelled = 1;
+		context->env->prefetch = NULL;
+	}
+	cpi_unlock_context(context);
+	if (prefetch != NULL) {
+#ifdef CP_THREADS
+		cpi_join_thread(prefetch->thread);
+#endif
+		free_prefetch(prefetch);
+	}
+}
+
+CP_C_API cp_status_t cp_prefetch_plugins(cp_context_t *context, int flags) {
+	cpi_prefetch_t *prefetch = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	
+	// Cancel a previous prefetch
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_stop_prefetch(context);
+	
+	cpi_lock_context(context);
+	do {
+		cpi_hmap_scan_t scan;
+		cp_plugin_t *plugin;
+		
+		// Allocate the prefetch
+		if ((prefetch = cpi_malloc(sizeof(cpi_prefetch_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(prefetch, 0, sizeof(cpi_prefetch_t));
+		prefetch->context = context;
+		prefetch->flags = flags;
+		if (cpi_hmap_count(context->env->plugins) > 0
+			&& (prefetch->items = cpi_malloc(cpi_hmap_count(context->env->plugins) * sizeof(prefetch_item_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		/*
+		 * Collect the runtime libraries of unresolved plug-ins. Plug-ins
+		 * with loaders resolving files on demand are skipped because their
+		 * files might not be in place yet.
+		 */
+		cpi_hmap_scan_begin(&scan, context->env->plugins);
+		while ((plugin = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			prefetch_item_t *item = prefetch->items + prefetch->num_items;
+			
+			if (plugin->plugin->runtime_lib_name == NULL
+				|| plugin->runtime_lib != NULL
+				|| plugin->prefetched_lib != NULL
+				|| (plugin->loader != NULL && plugin->loader->resolve_files != NULL)) {
+				continue;
+			}
+			if ((item->plugin_id = cpi_strdup(plugin->plugin->identifier)) == NULL
+				|| (item->path = cpi_runtime_lib_path(plugin->plugin)) == NULL) {
+				cpi_free(item->plugin_id);
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			prefetch->num_items++;
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Prefetch in the background if possible
+#ifdef CP_THREADS
+		if ((prefetch->thread = cpi_create_thread(prefetch_thread, prefetch)) != NULL) {
+			context->env->prefetch = prefetch;
+			prefetch = NULL;
+			break;
+		}
+#endif
+
+		// Otherwise prefetch in the calling thread
+		run_prefetch(prefetch);
+		
+	} while (0);
+	
+	// Report error
+	if (status == CP_ERR_RESOURCE) {
+		cpi_error(context, N_("Plug-in runtime libraries could not be prefetched due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources unless prefetching in the background
+	if (prefetch != NULL) {
+		free_prefetch(prefetch);
+	}
+	
+	return status;
+}
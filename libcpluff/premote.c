@@ -0,0 +1,1591 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/** @file
+ * Remote plug-in repository loader
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if defined(HAVE_SYS_SOCKET_H) && defined(HAVE_NETDB_H) && defined(HAVE_GETADDRINFO) && defined(HAVE_UNISTD_H)
+#define CP_USE_SOCKETS
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#endif
+#include "cpluff.h"
+#include "defines.h"
+#include "util.h"
+#include "internal.h"
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// The name of the repository index
+#define RPL_INDEX_NAME "index"
+
+/// The name of the file holding the hash of the repository index
+#define RPL_INDEX_HASH_NAME "index.sha256"
+
+/// The size of a content hash in bytes
+#define RPL_HASH_SIZE 32
+
+/// The length of a content hash in hexadecimal notation
+#define RPL_HASH_HEX_LEN (RPL_HASH_SIZE * 2)
+
+/// The initial size of a download buffer
+#define RPL_BUFFER_INITSIZE 16384
+
+/// Send and receive timeout for HTTP connections, in seconds
+#define RPL_HTTP_TIMEOUT 30
+
+/// The maximum size of an HTTP response header
+#define RPL_MAX_HEADER_SIZE 16384
+
+/// The maximum size of a downloaded file whose size is not known
+#define RPL_MAX_DOWNLOAD_SIZE (64 * 1024 * 1024)
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// Remote plug-in loader data
+typedef struct rpl_data_t {
+
+	/// The repository base URL without a trailing slash
+	char *url;
+	
+	/// The local cache directory
+	char *cache_dir;
+	
+	/// The number of download threads, or 0 for serial downloads
+	int num_download_threads;
+	
+	/// The pinned hash of the repository index, or an empty string if none
+	char index_hash[RPL_HASH_HEX_LEN + 1];
+	
+	/// Sizes of runtime libraries listed in the last index by hash, protected by the framework lock
+	cpi_hmap_t *runtime_sizes;
+
+} rpl_data_t;
+
+/// A plug-in listed in the repository index
+typedef struct rpl_entry_t {
+
+	/// The plug-in identifier
+	const char *plugin_id;
+	
+	/// The hash of the plug-in descriptor
+	char desc_hash[RPL_HASH_HEX_LEN + 1];
+	
+	/// The hash of the runtime library, or an empty string if none
+	char runtime_hash[RPL_HASH_HEX_LEN + 1];
+	
+	/// The size of the plug-in descriptor, or 0 if not listed
+	size_t desc_size;
+	
+	/// The size of the runtime library, or 0 if not listed
+	size_t runtime_size;
+
+} rpl_entry_t;
+
+/// The size of a runtime library listed in the repository index
+typedef struct rpl_runtime_size_t {
+
+	/// The hash of the runtime library
+	char hash[RPL_HASH_HEX_LEN + 1];
+	
+	/// The size of the runtime library
+	size_t size;
+
+} rpl_runtime_size_t;
+
+/// State shared by the threads of a descriptor download job
+typedef struct rpl_fetch_job_t {
+
+	/// The plug-in context
+	cp_context_t *context;
+	
+	/// The loader data
+	rpl_data_t *data;
+	
+	/// The plug-in descriptor file name
+	const char *descriptor_name;
+	
+	/// The index entries
+	const rpl_entry_t *entries;
+	
+	/// The loaded descriptors in index order, NULL for failed ones
+	cp_plugin_info_t **plugins;
+	
+	/// The number of entries
+	int num_entries;
+	
+	/// The index of the next entry to be loaded
+	int next_entry;
+	
+	/// The number of download threads still running
+	int num_active;
+
+} rpl_fetch_job_t;
+
+
+/* ------------------------------------------------------------------------
+ * Variables
+ * ----------------------------------------------------------------------*/
+
+/// SHA-256 round constants
+static const unsigned long sha256_k[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+/// Counter making temporary cache file names unique within the process
+static unsigned int temp_counter = 0;
+
+/// Registration options of remote plug-in loaders
+static const cpi_ploader_options_t rpl_options = { CP_PLR_THREAD_SAFE, NULL };
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+// Content hashes
+
+/// Rotates a 32-bit word right
+#define ROTR32(x, n) ((((x) >> (n)) | ((x) << (32 - (n)))) & 0xffffffffUL)
+
+/**
+ * Processes a 64 byte block of SHA-256 input.
+ *
+ * @param h the hash state
+ * @param p the block
+ */
+static void sha256_block(unsigned long *h, const unsigned char *p) {
+	unsigned long w[64], v[8];
+	int i;
+	
+	for (i = 0; i < 16; i++) {
+		w[i] = ((unsigned long) p[4 * i] << 24) | ((unsigned long) p[4 * i + 1] << 16)
+			| ((unsigned long) p[4 * i + 2] << 8) | (unsigned long) p[4 * i + 3];
+	}
+	for (; i < 64; i++) {
+		unsigned long s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		unsigned long s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		
+		w[i] = (w[i - 16] + s0 + w[i - 7] + s1) & 0xffffffffUL;
+	}
+	memcpy(v, h, sizeof(v));
+	for (i = 0; i < 64; i++) {
+		unsigned long s1 = ROTR32(v[4], 6) ^ ROTR32(v[4], 11) ^ ROTR32(v[4], 25);
+		unsigned long ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+		unsigned long t1 = (v[7] + s1 + ch + sha256_k[i] + w[i]) & 0xffffffffUL;
+		unsigned long s0 = ROTR32(v[0], 2) ^ ROTR32(v[0], 13) ^ ROTR32(v[0], 22);
+		unsigned long maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+		
+		memmove(v + 1, v, 7 * sizeof(unsigned long));
+		v[4] = (v[4] + t1) & 0xffffffffUL;
+		v[0] = (t1 + s0 + maj) & 0xffffffffUL;
+	}
+	for (i = 0; i < 8; i++) {
+		h[i] = (h[i] + v[i]) & 0xffffffffUL;
+	}
+}
+
+/**
+ * Calculates the SHA-256 hash of the specified data in hexadecimal
+ * notation.
+ *
+ * @param data the data
+ * @param len the length of the data
+ * @param hex the buffer receiving the NUL terminated hash
+ */
+static void content_hash(const unsigned char *data, size_t len, char *hex) {
+	static const char digits[] = "0123456789abcdef";
+	unsigned long h[8] = {
+		0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+		0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL
+	};
+	unsigned char tail[128];
+	unsigned long long bits = (unsigned long long) len * 8;
+	size_t i, rem, tail_len;
+	
+	// Hash the full blocks and then the padded remainder
+	for (i = 0; i + 64 <= len; i += 64) {
+		sha256_block(h, data + i);
+	}
+	rem = len - i;
+	tail_len = (rem < 56 ? 64 : 128);
+	memset(tail, 0, sizeof(tail));
+	if (rem > 0) {
+		memcpy(tail, data + i, rem);
+	}
+	tail[rem] = 0x80;
+	for (i = 0; i < 8; i++) {
+		tail[tail_len - 1 - i] = (unsigned char) (bits >> (8 * i));
+	}
+	for (i = 0; i < tail_len; i += 64) {
+		sha256_block(h, tail + i);
+	}
+	
+	// Format the hash
+	for (i = 0; i < RPL_HASH_SIZE; i++) {
+		unsigned int b = (h[i / 4] >> (24 - 8 * (i % 4))) & 0xff;
+		
+		hex[2 * i] = digits[b >> 4];
+		hex[2 * i + 1] = digits[b & 0x0f];
+	}
+	hex[RPL_HASH_HEX_LEN] = '\0';
+}
+
+/**
+ * Returns whether the specified data matches the specified hash.
+ *
+ * @param data the data
+ * @param len the length of the data
+ * @param hash the expected hash in hexadecimal notation
+ * @return non-zero if the data matches the hash
+ */
+static int hash_matches(const unsigned char *data, size_t len, const char *hash) {
+	char hex[RPL_HASH_HEX_LEN + 1];
+	
+	content_hash(data, len, hex);
+	return !strcmp(hex, hash);
+}
+
+/**
+ * Returns whether the specified string is a valid hash in hexadecimal
+ * notation. Upper case digits are converted to lower case.
+ *
+ * @param str the string
+ * @return non-zero if the string is a valid hash
+ */
+static int check_hash(char *str) {
+	int i;
+	
+	for (i = 0; i < RPL_HASH_HEX_LEN; i++) {
+		if (!isxdigit((unsigned char) str[i])) {
+			return 0;
+		}
+		str[i] = tolower((unsigned char) str[i]);
+	}
+	return str[i] == '\0';
+}
+
+/**
+ * Checks a hash in hexadecimal notation optionally followed by a colon and
+ * the size of the hashed file in bytes, and terminates the hash. Upper
+ * case digits are converted to lower case.
+ *
+ * @param str the string
+ * @param size pointer to the location where the size, or 0 if none, is stored
+ * @return non-zero if the string is a valid hash and size
+ */
+static int check_hash_size(char *str, size_t *size) {
+	char *colon, *end;
+	
+	*size = 0;
+	if ((colon = strchr(str, ':')) != NULL) {
+		unsigned long long s;
+		
+		*colon = '\0';
+		if (!isdigit((unsigned char) colon[1])) {
+			return 0;
+		}
+		errno = 0;
+		s = strtoull(colon + 1, &end, 10);
+		if (*end != '\0' || errno != 0 || s == 0 || s != (size_t) s) {
+			return 0;
+		}
+		*size = (size_t) s;
+	}
+	return check_hash(str);
+}
+
+// Local files
+
+/**
+ * Creates the specified directory unless it already exists.
+ *
+ * @param path the directory path
+ * @return non-zero on success or zero on failure
+ */
+static int ensure_dir(const char *path) {
+#ifdef _WIN32
+	return !_mkdir(path) || errno == EEXIST;
+#else
+	return !mkdir(path, 0777) || errno == EEXIST;
+#endif
+}
+
+/**
+ * Reads the whole contents of a local file into a NUL terminated buffer.
+ *
+ * @param path the file path
+ * @param data pointer to the location where the buffer is stored
+ * @param data_len pointer to the location where the data length is stored
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t read_local_file(const char *path, unsigned char **data, size_t *data_len) {
+	FILE *fh;
+	size_t size = 0;
+	cp_status_t status = CP_OK;
+	
+	*data = NULL;
+	*data_len = 0;
+	if ((fh = fopen(path, "rb")) == NULL) {
+		return CP_ERR_IO;
+	}
+	while (!feof(fh) && !ferror(fh)) {
+		if (*data_len + 1 >= size) {
+			unsigned char *nd;
+			
+			size = (size == 0 ? RPL_BUFFER_INITSIZE : size * 2);
+			if ((nd = cpi_realloc(*data, size)) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			*data = nd;
+		}
+		*data_len += fread(*data + *data_len, 1, size - *data_len - 1, fh);
+	}
+	if (status == CP_OK && ferror(fh)) {
+		status = CP_ERR_IO;
+	}
+	fclose(fh);
+	if (status != CP_OK) {
+		cpi_free(*data);
+		*data = NULL;
+		*data_len = 0;
+	} else {
+		(*data)[*data_len] = '\0';
+	}
+	return status;
+}
+
+/**
+ * Writes data into a uniquely named temporary file and then replaces the
+ * specified file with it so that concurrent readers and writers of the
+ * same cache never see a partially written file.
+ *
+ * @param path the file path
+ * @param data the data
+ * @param len the length of the data
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t store_file(const char *path, const unsigned char *data, size_t len) {
+	char *tmp_path;
+	FILE *fh = NULL;
+	unsigned long pid = 0;
+	unsigned int n;
+	cp_status_t status = CP_ERR_IO;
+	
+	if ((tmp_path = cpi_malloc((strlen(path) + 32) * sizeof(char))) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+#ifdef HAVE_UNISTD_H
+	pid = (unsigned long) getpid();
+#endif
+	cpi_lock_framework();
+	n = temp_counter++;
+	cpi_unlock_framework();
+	sprintf(tmp_path, "%s.%lu.%u.tmp", path, pid, n);
+	do {
+		if ((fh = fopen(tmp_path, "wb")) == NULL) {
+			break;
+		}
+		if (fwrite(data, 1, len, fh) != len) {
+			break;
+		}
+		if (fclose(fh)) {
+			fh = NULL;
+			break;
+		}
+		fh = NULL;
+		if (rename(tmp_path, path)) {
+			remove(path);
+			if (rename(tmp_path, path)) {
+				break;
+			}
+		}
+		status = CP_OK;
+	} while (0);
+	
+	// Release resources
+	if (fh != NULL) {
+		fclose(fh);
+	}
+	if (status != CP_OK) {
+		remove(tmp_path);
+	}
+	cpi_free(tmp_path);
+	return status;
+}
+
+/**
+ * Joins up to three path or URL components using the specified separator.
+ * The last components may be NULL. The caller is responsible for freeing
+ * the returned string.
+ *
+ * @param sep the separator
+ * @param a the first component
+ * @param b the second component, or NULL
+ * @param c the third component, or NULL
+ * @return the joined string or NULL if insufficient memory
+ */
+static char *join3(char sep, const char *a, const char *b, const char *c) {
+	char *str;
+	size_t len;
+	
+	len = strlen(a) + (b != NULL ? strlen(b) + 1 : 0) + (c != NULL ? strlen(c) + 1 : 0);
+	if ((str = cpi_malloc((len + 1) * sizeof(char))) == NULL) {
+		return NULL;
+	}
+	if (c != NULL) {
+		sprintf(str, "%s%c%s%c%s", a, sep, b, sep, c);
+	} else if (b != NULL) {
+		sprintf(str, "%s%c%s", a, sep, b);
+	} else {
+		strcpy(str, a);
+	}
+	return str;
+}
+
+// Downloads
+
+#ifdef CP_USE_SOCKETS
+
+/**
+ * Finds the value of the specified header in an HTTP response header.
+ *
+ * @param headers the NUL terminated response header
+ * @param name the header name followed by a colon
+ * @return the header value or NULL if not present
+ */
+static const char *http_header(const char *headers, const char *name) {
+	size_t name_len = strlen(name);
+	const char *line;
+	
+	for (line = strstr(headers, "\r\n"); line != NULL; line = strstr(line, "\r\n")) {
+		size_t i;
+		
+		line += 2;
+		for (i = 0; i < name_len && tolower((unsigned char) line[i]) == name[i]; i++);
+		if (i == name_len) {
+			line += name_len;
+			while (*line == ' ' || *line == '\t') {
+				line++;
+			}
+			return line;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Downloads the resource at the specified HTTP URL into a NUL terminated
+ * buffer. Only plain HTTP without redirects is supported. The download is
+ * aborted as soon as the response header or body grows too large.
+ *
+ * @param url the URL starting with "http://"
+ * @param max_len the maximum length of the response body
+ * @param data pointer to the location where the buffer is stored
+ * @param data_len pointer to the location where the data length is stored
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t http_get(const char *url, size_t max_len, unsigned char **data, size_t *data_len) {
+	const char *authority = url + 7;
+	const char *path;
+	const char *port = "80";
+	char *host = NULL, *hostname, *request = NULL;
+	struct addrinfo hints, *addrs = NULL, *ai;
+	unsigned char *buffer = NULL;
+	size_t len = 0, size = 0, header_len = 0, authority_len;
+	int fd = -1;
+	cp_status_t status = CP_ERR_IO;
+	
+	*data = NULL;
+	*data_len = 0;
+	do {
+		struct timeval tv;
+		char *p, *body;
+		const char *value;
+		size_t sent;
+		
+		// Split the URL into the host, the port and the path
+		if ((path = strchr(authority, '/')) == NULL) {
+			path = authority + strlen(authority);
+		}
+		authority_len = path - authority;
+		if ((host = cpi_malloc(authority_len + 1)) == NULL
+			|| (request = cpi_malloc(strlen(path) + authority_len + 64)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memcpy(host, authority, authority_len);
+		host[authority_len] = '\0';
+		hostname = host;
+		if ((p = (host[0] == '[' ? strchr(host, ']') : host)) == NULL) {
+			break;
+		}
+		if ((p = strchr(p, ':')) != NULL) {
+			*p = '\0';
+			port = p + 1;
+		}
+		if (host[0] == '[') {
+			hostname = host + 1;
+			hostname[strlen(hostname) - 1] = '\0';
+		}
+		sprintf(request, "GET %s HTTP/1.0\r\nHost: %.*s\r\nConnection: close\r\n\r\n",
+			(*path != '\0' ? path : "/"), (int) authority_len, authority);
+		
+		// Connect to the server
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(hostname, port, &hints, &addrs)) {
+			break;
+		}
+		for (ai = addrs; ai != NULL; ai = ai->ai_next) {
+			if ((fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0) {
+				continue;
+			}
+			if (!connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+				break;
+			}
+			close(fd);
+			fd = -1;
+		}
+		if (fd < 0) {
+			break;
+		}
+		tv.tv_sec = RPL_HTTP_TIMEOUT;
+		tv.tv_usec = 0;
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+		
+		// Send the request and read the whole response
+		for (sent = 0; sent < strlen(request); ) {
+			ssize_t n;
+
+#ifdef MSG_NOSIGNAL
+			n = send(fd, request + sent, strlen(request) - sent, MSG_NOSIGNAL);
+#else
+			n = send(fd, request + sent, strlen(request) - sent, 0);
+#endif
+			if (n <= 0) {
+				break;
+			}
+			sent += n;
+		}
+		if (sent < strlen(request)) {
+			break;
+		}
+		for (;;) {
+			ssize_t n;
+			
+			if (len + 1 >= size) {
+				unsigned char *nb;
+				
+				size = (size == 0 ? RPL_BUFFER_INITSIZE : size * 2);
+				if ((nb = cpi_realloc(buffer, size)) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				buffer = nb;
+			}
+			if ((n = recv(fd, buffer + len, size - len - 1, 0)) <= 0) {
+				if (n == 0) {
+					status = CP_OK;
+				}
+				break;
+			}
+			len += n;
+			buffer[len] = '\0';
+			
+			// Stop reading a response that is too large
+			if (header_len == 0 && (p = strstr((char *) buffer, "\r\n\r\n")) != NULL) {
+				header_len = p + 4 - (char *) buffer;
+			}
+			if (header_len == 0 ? len > RPL_MAX_HEADER_SIZE : len - header_len > max_len) {
+				break;
+			}
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		buffer[len] = '\0';
+		status = CP_ERR_IO;
+		
+		// Check the status and separate the body from the header
+		if (strncmp((char *) buffer, "HTTP/1.", 7)
+			|| (p = strchr((char *) buffer, ' ')) == NULL
+			|| atoi(p + 1) != 200
+			|| header_len == 0) {
+			break;
+		}
+		body = (char *) buffer + header_len - 4;
+		body[2] = '\0';
+		body += 4;
+		len -= body - (char *) buffer;
+		if ((value = http_header((char *) buffer, "content-length:")) != NULL) {
+			unsigned long long cl = strtoull(value, NULL, 10);
+			
+			if (cl > len) {
+				break;
+			}
+			len = cl;
+		}
+		memmove(buffer, body, len);
+		buffer[len] = '\0';
+		*data = buffer;
+		*data_len = len;
+		buffer = NULL;
+		status = CP_OK;
+	
+	} while (0);
+	
+	// Release resources
+	if (fd >= 0) {
+		close(fd);
+	}
+	if (addrs != NULL) {
+		freeaddrinfo(addrs);
+	}
+	cpi_free(host);
+	cpi_free(request);
+	cpi_free(buffer);
+	return status;
+}
+
+#endif //CP_USE_SOCKETS
+
+/**
+ * Returns whether the repository index of a loader is trusted, that is
+ * whether its hash has been pinned or it is read from the local file
+ * system. Runtime libraries are only loaded from trusted repositories.
+ *
+ * @param data the loader data
+ * @return non-zero if the index is trusted
+ */
+static int index_trusted(const rpl_data_t *data) {
+	return data->index_hash[0] != '\0' || strncmp(data->url, "http://", 7);
+}
+
+/**
+ * Returns the maximum size of a repository file to be downloaded. A size
+ * listed in a trusted index is used as is, while a size listed in an
+ * untrusted index can only lower the default limit.
+ *
+ * @param data the loader data
+ * @param size the size of the file listed in the index, or 0 if not listed
+ * @return the maximum size of the file
+ */
+static size_t max_download_size(const rpl_data_t *data, size_t size) {
+	if (size != 0 && (size < RPL_MAX_DOWNLOAD_SIZE || index_trusted(data))) {
+		return size;
+	}
+	return RPL_MAX_DOWNLOAD_SIZE;
+}
+
+/**
+ * Fetches the resource at the specified URL into a NUL terminated buffer.
+ * HTTP URLs are downloaded and file URLs and plain paths are read locally.
+ *
+ * @param url the URL
+ * @param max_len the maximum length of a downloaded resource
+ * @param data pointer to the location where the buffer is stored
+ * @param data_len pointer to the location where the data length is stored
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t fetch_url(const char *url, size_t max_len, unsigned char **data, size_t *data_len) {
+	if (!strncmp(url, "http://", 7)) {
+#ifdef CP_USE_SOCKETS
+		return http_get(url, max_len, data, data_len);
+#else
+		*data = NULL;
+		*data_len = 0;
+		return CP_ERR_IO;
+#endif
+	} else if (!strncmp(url, "file://", 7)) {
+		return read_local_file(url + 7, data, data_len);
+	} else {
+		return read_local_file(url, data, data_len);
+	}
+}
+
+/**
+ * Obtains a repository object from the content-addressed cache or, if it
+ * is missing or damaged, downloads it and stores it in the cache. The
+ * object is stored as the named file in a cache subdirectory named after
+ * its hash. Downloaded objects are verified against the hash.
+ *
+ * @param context the plug-in context
+ * @param data the loader data
+ * @param plugin_id the identifier of the plug-in owning the object
+ * @param hash the expected hash of the object
+ * @param size the size of the object listed in the index, or 0 if not listed
+ * @param name the file name of the object
+ * @param buf pointer to the location where the contents are stored, or NULL if only the cached file is needed
+ * @param len pointer to the location where the length is stored, or NULL
+ * @return @ref CP_OK on success or an error code on failure
+ */
+static cp_status_t fetch_object(cp_context_t *context, rpl_data_t *data, const char *plugin_id, const char *hash, size_t size, const char *name, unsigned char **buf, size_t *len) {
+	char *dir = NULL, *path = NULL, *url = NULL;
+	unsigned char *contents = NULL;
+	size_t contents_len = 0;
+	cp_status_t status;
+	
+	do {
+		if ((dir = join3(CP_FNAMESEP_CHAR, data->cache_dir, hash, NULL)) == NULL
+			|| (path = join3(CP_FNAMESEP_CHAR, dir, name, NULL)) == NULL
+			|| (url = join3('/', data->url, plugin_id, name)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Use the cached copy if it is intact
+		if ((status = read_local_file(path, &contents, &contents_len)) == CP_OK) {
+			if (hash_matches(contents, contents_len, hash)) {
+				break;
+			}
+			cpi_lock_context(context);
+			cpi_warnf(context, N_("Cached file %s is damaged and is downloaded again."), path);
+			cpi_unlock_context(context);
+			cpi_free(contents);
+			contents = NULL;
+		} else if (status == CP_ERR_RESOURCE) {
+			break;
+		}
+		
+		// Download and verify the object
+		if ((status = fetch_url(url, max_download_size(data, size), &contents, &contents_len)) != CP_OK) {
+			cpi_lock_context(context);
+			cpi_errorf(context, N_("Could not fetch %s."), url);
+			cpi_unlock_context(context);
+			break;
+		}
+		if (!hash_matches(contents, contents_len, hash)) {
+			cpi_lock_context(context);
+			cpi_errorf(context, N_("The contents of %s do not match the repository index."), url);
+			cpi_unlock_context(context);
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		cpi_lock_context(context);
+		cpi_debugf(context, N_("Fetched %s."), url);
+		cpi_unlock_context(context);
+		
+		// Store the object, which is only required if the file is needed
+		if (!ensure_dir(data->cache_dir)
+			|| !ensure_dir(dir)
+			|| (status = store_file(path, contents, contents_len)) != CP_OK) {
+			if (buf == NULL) {
+				cpi_lock_context(context);
+				cpi_errorf(context, N_("Could not store %s in the cache."), path);
+				cpi_unlock_context(context);
+				status = CP_ERR_IO;
+				break;
+			}
+			cpi_lock_context(context);
+			cpi_warnf(context, N_("Could not store %s in the cache."), path);
+			cpi_unlock_context(context);
+		}
+		status = CP_OK;
+	
+	} while (0);
+	
+	// Return the contents if requested
+	if (status == CP_OK && buf != NULL) {
+		*buf = contents;
+		*len = contents_len;
+		contents = NULL;
+	}
+	cpi_free(contents);
+	cpi_free(dir);
+	cpi_free(path);
+	cpi_free(url);
+	return status;
+}
+
+// Repository index
+
+/**
+ * Returns the next white space separated token of a line and terminates it.
+ *
+ * @param pos pointer to the current position, updated past the token
+ * @return the token or NULL if there are no more tokens
+ */
+static char *next_token(char **pos) {
+	char *token = *pos + strspn(*pos, " \t\r");
+	char *end;
+	
+	if (*token == '\0') {
+		return NULL;
+	}
+	end = token + strcspn(token, " \t\r");
+	*pos = end;
+	if (*end != '\0') {
+		*end = '\0';
+		*pos = end + 1;
+	}
+	return token;
+}
+
+/**
+ * Parses the repository index in place. Each non-empty line not starting
+ * with '#' lists a plug-in identifier, the hash of the plug-in descriptor
+ * and optionally the hash of the runtime library, separated by white space.
+ * Each hash may be followed by a colon and the size of the file in bytes.
+ *
+ * @param index the NUL terminated index, modified by parsing
+ * @param entries pointer to the location where the entries are stored
+ * @param num_entries pointer to the location where the number of entries is stored
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_MALFORMED
+ */
+static cp_status_t parse_index(char *index, rpl_entry_t **entries, int *num_entries) {
+	char *line, *next;
+	int size = 0;
+	
+	*entries = NULL;
+	*num_entries = 0;
+	for (line = index; line != NULL; line = next) {
+		char *id, *desc_hash, *runtime_hash;
+		size_t desc_size, runtime_size = 0;
+		rpl_entry_t *entry;
+		
+		if ((next = strchr(line, '\n')) != NULL) {
+			*(next++) = '\0';
+		}
+		if ((id = next_token(&line)) == NULL || id[0] == '#') {
+			continue;
+		}
+		desc_hash = next_token(&line);
+		runtime_hash = next_token(&line);
+		
+		// Identifiers are used as URL path components
+		if (id[0] == '.' || strpbrk(id, "/\\?#%") != NULL
+			|| desc_hash == NULL || !check_hash_size(desc_hash, &desc_size)
+			|| (runtime_hash != NULL && !check_hash_size(runtime_hash, &runtime_size))
+			|| next_token(&line) != NULL) {
+			cpi_free(*entries);
+			*entries = NULL;
+			*num_entries = 0;
+			return CP_ERR_MALFORMED;
+		}
+		if (*num_entries == size) {
+			rpl_entry_t *ne;
+			
+			size = (size == 0 ? 16 : size * 2);
+			if ((ne = cpi_realloc(*entries, size * sizeof(rpl_entry_t))) == NULL) {
+				cpi_free(*entries);
+				*entries = NULL;
+				*num_entries = 0;
+				return CP_ERR_RESOURCE;
+			}
+			*entries = ne;
+		}
+		entry = *entries + (*num_entries)++;
+		entry->plugin_id = id;
+		strcpy(entry->desc_hash, desc_hash);
+		strcpy(entry->runtime_hash, runtime_hash != NULL ? runtime_hash : "");
+		entry->desc_size = desc_size;
+		entry->runtime_size = runtime_size;
+	}
+	return CP_OK;
+}
+
+/**
+ * Fetches the repository index. If the repository can not be reached, the
+ * copy of the index saved in the cache on the last successful fetch is used.
+ * If the hash of the index has been pinned, an index not matching it is
+ * rejected, also when read from the cache.
+ *
+ * @param context the plug-in context
+ * @param data the loader data
+ * @param index pointer to the location where the NUL terminated index is stored
+ * @return @ref CP_OK on success or an error code on failure
+ */
+static cp_status_t fetch_index(cp_context_t *context, rpl_data_t *data, char **index) {
+	char *url = NULL, *path = NULL;
+	unsigned char *contents = NULL;
+	size_t len;
+	cp_status_t status;
+	
+	do {
+		if ((url = join3('/', data->url, RPL_INDEX_NAME, NULL)) == NULL
+			|| (path = join3(CP_FNAMESEP_CHAR, data->cache_dir, RPL_INDEX_NAME, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if ((status = fetch_url(url, RPL_MAX_DOWNLOAD_SIZE, &contents, &len)) == CP_OK
+			&& data->index_hash[0] != '\0'
+			&& !hash_matches(contents, len, data->index_hash)) {
+			cpi_lock_context(context);
+			cpi_errorf(context, N_("The contents of %s do not match the pinned hash of the repository index."), url);
+			cpi_unlock_context(context);
+			cpi_free(contents);
+			contents = NULL;
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		if (status == CP_OK) {
+			if (!ensure_dir(data->cache_dir) || store_file(path, contents, len) != CP_OK) {
+				cpi_lock_context(context);
+				cpi_warnf(context, N_("Could not store %s in the cache."), path);
+				cpi_unlock_context(context);
+			}
+		} else if (status == CP_ERR_IO) {
+			if ((status = read_local_file(path, &contents, &len)) == CP_OK
+				&& data->index_hash[0] != '\0'
+				&& !hash_matches(contents, len, data->index_hash)) {
+				cpi_lock_context(context);
+				cpi_errorf(context, N_("Could not fetch %s and the cached repository index does not match the pinned hash."), url);
+				cpi_unlock_context(context);
+				cpi_free(contents);
+				contents = NULL;
+				status = CP_ERR_MALFORMED;
+			} else if (status == CP_OK) {
+				cpi_lock_context(context);
+				cpi_warnf(context, N_("Could not fetch %s, using the cached repository index."), url);
+				cpi_unlock_context(context);
+			} else {
+				cpi_lock_context(context);
+				cpi_errorf(context, N_("Could not fetch %s."), url);
+				cpi_unlock_context(context);
+			}
+		}
+	} while (0);
+	if (status == CP_ERR_RESOURCE) {
+		cpi_lock_context(context);
+		cpi_errorf(context, N_("Repository index %s could not be loaded due to insufficient system resources."), data->url);
+		cpi_unlock_context(context);
+	}
+	*index = (char *) contents;
+	cpi_free(url);
+	cpi_free(path);
+	return status;
+}
+
+/**
+ * Frees the runtime library sizes of a loader. The caller must hold the
+ * framework lock.
+ *
+ * @param data the loader data
+ */
+static void free_runtime_sizes(rpl_data_t *data) {
+	cpi_hmap_scan_t scan;
+	rpl_runtime_size_t *rs;
+	
+	if (data->runtime_sizes == NULL) {
+		return;
+	}
+	cpi_hmap_scan_begin(&scan, data->runtime_sizes);
+	while ((rs = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+		cpi_free(rs);
+	}
+	cpi_destroy_hmap(data->runtime_sizes);
+	data->runtime_sizes = NULL;
+}
+
+/**
+ * Replaces the runtime library sizes of a loader with those listed in the
+ * index entries. Failing to record a size only leaves the default limit
+ * in effect for the runtime library.
+ *
+ * @param data the loader data
+ * @param entries the index entries
+ * @param num_entries the number of entries
+ */
+static void set_runtime_sizes(rpl_data_t *data, const rpl_entry_t *entries, int num_entries) {
+	int i;
+	
+	cpi_lock_framework();
+	free_runtime_sizes(data);
+	for (i = 0; i < num_entries; i++) {
+		rpl_runtime_size_t *rs;
+		
+		if (entries[i].runtime_size == 0) {
+			continue;
+		}
+		if (data->runtime_sizes == NULL
+			&& (data->runtime_sizes = cpi_create_hmap(cpi_comp_str, NULL)) == NULL) {
+			break;
+		}
+		if (cpi_hmap_get(data->runtime_sizes, entries[i].runtime_hash) != NULL
+			|| (rs = cpi_malloc(sizeof(rpl_runtime_size_t))) == NULL) {
+			continue;
+		}
+		strcpy(rs->hash, entries[i].runtime_hash);
+		rs->size = entries[i].runtime_size;
+		if (!cpi_hmap_put(data->runtime_sizes, rs->hash, rs)) {
+			cpi_free(rs);
+		}
+	}
+	cpi_unlock_framework();
+}
+
+/**
+ * Returns the size of a runtime library listed in the last index.
+ *
+ * @param data the loader data
+ * @param hash the hash of the runtime library
+ * @return the size of the runtime library, or 0 if not listed
+ */
+static size_t get_runtime_size(rpl_data_t *data, const char *hash) {
+	rpl_runtime_size_t *rs = NULL;
+	size_t size;
+	
+	cpi_lock_framework();
+	if (data->runtime_sizes != NULL) {
+		rs = cpi_hmap_get(data->runtime_sizes, hash);
+	}
+	size = (rs != NULL ? rs->size : 0);
+	cpi_unlock_framework();
+	return size;
+}
+
+// Plug-in loader
+
+/**
+ * Loads the plug-in listed in the specified index entry.
+ *
+ * @param context the plug-in context
+ * @param data the loader data
+ * @param descriptor_name the plug-in descriptor file name
+ * @param entry the index entry
+ * @return the plug-in information or NULL on failure
+ */
+static cp_plugin_info_t *load_entry(cp_context_t *context, rpl_data_t *data, const char *descriptor_name, const rpl_entry_t *entry) {
+	cp_plugin_info_t *plugin = NULL;
+	unsigned char *desc = NULL;
+	size_t desc_len;
+	char *path = NULL;
+	cp_status_t status;
+	
+	do {
+		if ((status = fetch_object(context, data, entry->plugin_id, entry->desc_hash, entry->desc_size, descriptor_name, &desc, &desc_len)) != CP_OK) {
+			break;
+		}
+		if ((plugin = cp_load_plugin_descriptor_from_memory(context, (char *) desc, desc_len, &status)) == NULL) {
+			break;
+		}
+		if (strcmp(plugin->identifier, entry->plugin_id)) {
+			cpi_lock_context(context);
+			cpi_errorf(context, N_("Plug-in %s is listed as %s in repository %s."), plugin->identifier, entry->plugin_id, data->url);
+			cpi_unlock_context(context);
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		
+		// The plug-in path is the cache directory of the runtime library
+		if ((path = join3(CP_FNAMESEP_CHAR, data->cache_dir, (entry->runtime_hash[0] != '\0' ? entry->runtime_hash : entry->desc_hash), NULL)) == NULL
+			|| (plugin->plugin_path = cpi_plugin_strdup(plugin, path)) == NULL) {
+			cpi_lock_context(context);
+			cpi_errorf(context, N_("Plug-in %s could not be loaded due to insufficient system resources."), entry->plugin_id);
+			cpi_unlock_context(context);
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if ((plugin->runtime_lib_name != NULL) != (entry->runtime_hash[0] != '\0')) {
+			cpi_lock_context(context);
+			cpi_errorf(context, N_("The runtime library of plug-in %s does not match the index of repository %s."), entry->plugin_id, data->url);
+			cpi_unlock_context(context);
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+	
+	} while (0);
+	
+	// Release resources
+	if (status != CP_OK && plugin != NULL) {
+		cp_release_info(context, plugin);
+		plugin = NULL;
+	}
+	cpi_free(desc);
+	cpi_free(path);
+	return plugin;
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Download thread main function. Loads plug-ins from the job entries until
+ * all entries have been taken and then signals the scanning thread.
+ *
+ * @param arg the download job
+ */
+static void rpl_fetch_thread(void *arg) {
+	rpl_fetch_job_t *job = arg;
+	cp_context_t *ctx = job->context;
+	
+	cpi_lock_context(ctx);
+	while (job->next_entry < job->num_entries) {
+		int i = job->next_entry++;
+		
+		// Download without holding the context lock
+		cpi_unlock_context(ctx);
+		job->plugins[i] = load_entry(ctx, job->data, job->descriptor_name, job->entries + i);
+		cpi_lock_context(ctx);
+	}
+	job->num_active--;
+	cpi_signal_context(ctx);
+	cpi_unlock_context(ctx);
+}
+
+#endif
+
+static cp_plugin_info_t **rpl_scan_plugins(void *d, cp_context_t *context) {
+	rpl_data_t *data = d;
+	char *index = NULL;
+	const char *descriptor_name;
+	rpl_entry_t *entries = NULL;
+	cp_plugin_info_t **plugins = NULL;
+	int num_entries = 0;
+	int i = 0, j;
+	cp_status_t status;
+	
+	CHECK_NOT_NULL(data);
+	CHECK_NOT_NULL(context);
+	do {
+		
+		// Fetch and parse the index
+		if ((status = fetch_index(context, data, &index)) != CP_OK) {
+			break;
+		}
+		if ((status = parse_index(index, &entries, &num_entries)) != CP_OK) {
+			if (status == CP_ERR_MALFORMED) {
+				cpi_lock_context(context);
+				cpi_errorf(context, N_("The index of repository %s is invalid."), data->url);
+				cpi_unlock_context(context);
+			} else {
+				cpi_lock_context(context);
+				cpi_errorf(context, N_("Repository index %s could not be loaded due to insufficient system resources."), data->url);
+				cpi_unlock_context(context);
+			}
+			break;
+		}
+		set_runtime_sizes(data, entries, num_entries);
+		if ((plugins = cpi_malloc((num_entries + 1) * sizeof(cp_plugin_info_t *))) == NULL) {
+			cpi_lock_context(context);
+			cpi_errorf(context, N_("Repository index %s could not be loaded due to insufficient system resources."), data->url);
+			cpi_unlock_context(context);
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		cpi_lock_context(context);
+		descriptor_name = context->env->plugin_descriptor_name;
+		cpi_unlock_context(context);
+
+#ifdef CP_THREADS
+		// Download the descriptors concurrently if so configured
+		if (data->num_download_threads > 1 && num_entries > 1) {
+			rpl_fetch_job_t job;
+			cpi_thread_t **threads;
+			int num_threads;
+			
+			memset(&job, 0, sizeof(rpl_fetch_job_t));
+			job.context = context;
+			job.data = data;
+			job.descriptor_name = descriptor_name;
+			job.entries = entries;
+			job.plugins = plugins;
+			job.num_entries = num_entries;
+			num_threads = data->num_download_threads;
+			if (num_threads > num_entries) {
+				num_threads = num_entries;
+			}
+			if ((threads = cpi_malloc(sizeof(cpi_thread_t *) * num_threads)) != NULL) {
+				int t;
+				
+				cpi_lock_context(context);
+				for (t = 0; t < num_threads; t++) {
+					if ((threads[t] = cpi_create_thread(rpl_fetch_thread, &job)) == NULL) {
+						break;
+					}
+					job.num_active++;
+				}
+				num_threads = t;
+				while (job.num_active > 0) {
+					cpi_wait_context(context);
+				}
+				i = job.next_entry;
+				cpi_unlock_context(context);
+				for (t = 0; t < num_threads; t++) {
+					cpi_join_thread(threads[t]);
+				}
+				cpi_free(threads);
+			}
+		}
+#endif
+
+		// Load any remaining plug-ins serially
+		for (; i < num_entries; i++) {
+			plugins[i] = load_entry(context, data, descriptor_name, entries + i);
+		}
+		
+		// Leave out the plug-ins that could not be loaded
+		for (i = 0, j = 0; i < num_entries; i++) {
+			if (plugins[i] != NULL) {
+				plugins[j++] = plugins[i];
+			}
+		}
+		plugins[j] = NULL;
+	
+	} while (0);
+	
+	// Release resources
+	cpi_free(entries);
+	cpi_free(index);
+	
+	return plugins;
+}
+
+static int rpl_resolve_files(void *d, cp_context_t *context, cp_plugin_info_t *plugin) {
+	rpl_data_t *data = d;
+	const char *hash;
+	char *name;
+	int ok;
+	
+	CHECK_NOT_NULL(data);
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(plugin);
+	if (plugin->runtime_lib_name == NULL) {
+		return 1;
+	}
+	
+	// Runtime libraries are code, so an unverified index must not name them
+	if (!index_trusted(data)) {
+		cpi_errorf(context, N_("The runtime library of plug-in %s is not loaded because the index of repository %s is fetched over plain HTTP without a pinned hash."), plugin->identifier, data->url);
+		return 0;
+	}
+	
+	// The plug-in path is named after the hash of the runtime library
+	assert(strlen(plugin->plugin_path) >= RPL_HASH_HEX_LEN);
+	hash = plugin->plugin_path + strlen(plugin->plugin_path) - RPL_HASH_HEX_LEN;
+	if ((name = cpi_malloc((strlen(plugin->runtime_lib_name) + strlen(CP_SHREXT) + 1) * sizeof(char))) == NULL) {
+		cpi_errorf(context, N_("The runtime library of plug-in %s could not be fetched due to insufficient system resources."), plugin->identifier);
+		return 0;
+	}
+	strcpy(name, plugin->runtime_lib_name);
+	strcat(name, CP_SHREXT);
+	ok = (fetch_object(context, data, plugin->identifier, hash, get_runtime_size(data, hash), name, NULL, NULL) == CP_OK);
+	cpi_free(name);
+	return ok;
+}
+
+CP_C_API cp_plugin_loader_t *cp_create_remote_ploader(const char *url, const char *cache_dir, cp_status_t *error) {
+	cp_plugin_loader_t *loader = NULL;
+	rpl_data_t *data;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(url);
+	CHECK_NOT_NULL(cache_dir);
+	do {
+		size_t len;
+		
+		// Allocate memory for the loader
+		if ((loader = cpi_create_ploader(&rpl_options)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Initialize loader
+		loader->data = data = cpi_malloc(sizeof(rpl_data_t));
+		loader->scan_plugins = rpl_scan_plugins;
+		loader->resolve_files = rpl_resolve_files;
+		loader->release_plugins = cpi_release_loaded_plugins;
+		if (data == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(data, 0, sizeof(rpl_data_t));
+		if ((data->url = cpi_strdup(url)) == NULL
+			|| (data->cache_dir = cpi_strdup(cache_dir)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Remove trailing separators
+		for (len = strlen(data->url); len > 1 && data->url[len - 1] == '/'; len--) {
+			data->url[len - 1] = '\0';
+		}
+		for (len = strlen(data->cache_dir); len > 1 && data->cache_dir[len - 1] == CP_FNAMESEP_CHAR; len--) {
+			data->cache_dir[len - 1] = '\0';
+		}
+	
+	} while (0);
+	
+	// Release resources on failure
+	if (status != CP_OK) {
+		if (loader != NULL) {
+			cp_destroy_remote_ploader(loader);
+		}
+		loader = NULL;
+	}
+	
+	// Return the final status
+	if (error != NULL) {
+		*error = status;
+	}
+	
+	return loader;
+}
+
+CP_C_API void cp_destroy_remote_ploader(cp_plugin_loader_t *loader) {
+	rpl_data_t *data;
+	
+	CHECK_NOT_NULL(loader);
+	if ((data = loader->data) != NULL) {
+		cpi_lock_framework();
+		free_runtime_sizes(data);
+		cpi_unlock_framework();
+		cpi_free(data->url);
+		cpi_free(data->cache_dir);
+		cpi_free(data);
+	}
+	cpi_destroy_ploader(loader);
+}
+
+CP_C_API void cp_rpl_set_download_threads(cp_plugin_loader_t *loader, int num_threads) {
+	CHECK_NOT_NULL(loader);
+	((rpl_data_t *) loader->data)->num_download_threads = (num_threads > 1 ? num_threads : 0);
+}
+
+CP_C_API cp_status_t cp_rpl_set_index_hash(cp_plugin_loader_t *loader, const char *hash) {
+	rpl_data_t *data;
+	char buffer[RPL_HASH_HEX_LEN + 1];
+	
+	CHECK_NOT_NULL(loader);
+	data = loader->data;
+	if (hash == NULL) {
+		data->index_hash[0] = '\0';
+		return CP_OK;
+	}
+	if (strlen(hash) != RPL_HASH_HEX_LEN) {
+		return CP_ERR_MALFORMED;
+	}
+	strcpy(buffer, hash);
+	if (!check_hash(buffer)) {
+		return CP_ERR_MALFORMED;
+	}
+	strcpy(data->index_hash, buffer);
+	return CP_OK;
+}
+
+// Repository export
+
+/**
+ * Copies a plug-in file into the repository and appends its hash and size
+ * to the index line.
+ *
+ * @param src the source file path
+ * @param dir the plug-in directory in the repository
+ * @param name the file name
+ * @param line the index line
+ * @param failed pointer to the location where the failed path is stored
+ * @return @ref CP_OK, @ref CP_ERR_RESOURCE or @ref CP_ERR_IO
+ */
+static cp_status_t export_file(const char *src, const char *dir, const char *name, char *line, char **failed) {
+	unsigned char *contents = NULL;
+	size_t len;
+	char *path = NULL;
+	cp_status_t status;
+	
+	do {
+		if ((path = join3(CP_FNAMESEP_CHAR, dir, name, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if ((status = read_local_file(src, &contents, &len)) != CP_OK) {
+			if (status == CP_ERR_IO) {
+				*failed = cpi_strdup(src);
+			}
+			break;
+		}
+		if ((status = store_file(path, contents, len)) != CP_OK) {
+			if (status == CP_ERR_IO) {
+				*failed = cpi_strdup(path);
+			}
+			break;
+		}
+		strcat(line, " ");
+		content_hash(contents, len, line + strlen(line));
+		sprintf(line + strlen(line), ":%llu", (unsigned long long) len);
+	} while (0);
+	cpi_free(contents);
+	cpi_free(path);
+	return status;
+}
+
+CP_C_API cp_status_t cp_save_repository(cp_context_t *context, const char *dir) {
+	char *index = NULL;
+	size_t index_len = 0;
+	char *pdir = NULL, *path = NULL, *failed = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(dir);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	do {
+		const char *descriptor_name = context->env->plugin_descriptor_name;
+		char hash_line[RPL_HASH_HEX_LEN + sizeof(RPL_INDEX_NAME) + 3];
+		cpi_hmap_scan_t scan;
+		cp_plugin_t *rp;
+		
+		if ((index = cpi_malloc(sizeof(char))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if (!ensure_dir(dir)) {
+			failed = cpi_strdup(dir);
+			status = CP_ERR_IO;
+			break;
+		}
+		
+		// Copy the descriptors and runtime libraries of the installed plug-ins
+		cpi_hmap_scan_begin(&scan, context->env->plugins);
+		while ((rp = cpi_hmap_scan_next(&scan, NULL)) != NULL) {
+			cp_plugin_info_t *plugin = rp->plugin;
+			char line[2 * (RPL_HASH_HEX_LEN + 22) + 1];
+			char *ni;
+			
+			cpi_free(pdir);
+			cpi_free(path);
+			pdir = path = NULL;
+			line[0] = '\0';
+			if ((pdir = join3(CP_FNAMESEP_CHAR, dir, plugin->identifier, NULL)) == NULL
+				|| (path = join3(CP_FNAMESEP_CHAR, plugin->plugin_path, descriptor_name, NULL)) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			if (!ensure_dir(pdir)) {
+				failed = cpi_strdup(pdir);
+				status = CP_ERR_IO;
+				break;
+			}
+			if ((status = export_file(path, pdir, descriptor_name, line, &failed)) != CP_OK) {
+				break;
+			}
+			if (plugin->runtime_lib_name != NULL) {
+				cpi_free(path);
+				if ((path = cpi_runtime_lib_path(plugin)) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				if ((status = export_file(path, pdir, strrchr(path, CP_FNAMESEP_CHAR) + 1, line, &failed)) != CP_OK) {
+					break;
+				}
+			}
+			
+			// Append the index line
+			if ((ni = cpi_realloc(index, index_len + strlen(plugin->identifier) + strlen(line) + 2)) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			index = ni;
+			index_len += sprintf(index + index_len, "%s%s\n", plugin->identifier, line);
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Write the index last so that it never refers to missing files
+		cpi_free(path);
+		if ((path = join3(CP_FNAMESEP_CHAR, dir, RPL_INDEX_NAME, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if ((status = store_file(path, (unsigned char *) index, index_len)) != CP_OK) {
+			if (status == CP_ERR_IO) {
+				failed = cpi_strdup(path);
+			}
+			break;
+		}
+		
+		// Write the hash of the index to be passed on through a trusted channel
+		cpi_free(path);
+		if ((path = join3(CP_FNAMESEP_CHAR, dir, RPL_INDEX_HASH_NAME, NULL)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		content_hash((unsigned char *) index, index_len, hash_line);
+		strcat(hash_line, "  " RPL_INDEX_NAME "\n");
+		if ((status = store_file(path, (unsigned char *) hash_line, strlen(hash_line))) == CP_ERR_IO) {
+			failed = cpi_strdup(path);
+		}
+	
+	} while (0);
+	
+	// Report the result
+	switch (status) {
+		case CP_OK:
+			cpi_debugf(context, N_("Saved a plug-in repository to %s."), dir);
+			break;
+		case CP_ERR_IO:
+			if (failed != NULL) {
+				cpi_errorf(context, N_("Plug-in repository %s could not be saved because %s could not be accessed."), dir, failed);
+				break;
+			}
+			// Fall through
+		default:
+			cpi_errorf(context, N_("Plug-in repository %s could not be saved due to insufficient system resources."), dir);
+			break;
+	}
+	cpi_unlock_context(context);
+	
+	// Release resources
+	cpi_free(index);
+	cpi_free(pdir);
+	cpi_free(path);
+	cpi_free(failed);
+	
+	return status;
+}
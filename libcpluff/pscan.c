@@ -37,6 +37,17 @@
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Maximum number of threads used to stop and restart affected plug-ins
+#define CP_SCAN_RESTART_THREADS 4
+
+/// Maximum number of threads used to scan thread-safe plug-in loaders
+#define CP_SCAN_LOADER_THREADS 4
+
+
 /* ------------------------------------------------------------------------
  * Data structures
  * ----------------------------------------------------------------------*/
@@ -51,28 +62,407 @@ struct available_plugin_t {
 
 };
 
+/// A concurrent plug-in loader scanning job
+typedef struct scan_job_t {
+	
+	/// The plug-in context
+	cp_context_t *context;
+	
+	/// The scanning flags
+	int flags;
+	
+	/// The loaders to be scanned
+	cp_plugin_loader_t **loaders;
+	
+	/// The registration options of the loaders, NULL for the defaults
+	const cpi_ploader_options_t **options;
+	
+	/// The scanned plug-ins in loader order, NULL for failed loaders
+	cp_plugin_info_t ***results;
+	
+	/// The indexes of the thread-safe loaders
+	int *tasks;
+	
+	/// The number of thread-safe loaders
+	int num_tasks;
+	
+	/// The index of the next thread-safe loader to be scanned
+	int next_task;
+	
+	/// The number of scanning threads still running
+	int num_active;
+
+} scan_job_t;
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
  * ----------------------------------------------------------------------*/
 
+/**
+ * Returns whether the specified plug-in is a later version of the
+ * installed plug-in.
+ *
+ * @param ip the installed plug-in
+ * @param plugin the available plug-in
+ * @return non-zero if the available plug-in is an upgrade
+ */
+static int is_upgrade(cp_plugin_t *ip, cp_plugin_info_t *plugin) {
+	return (ip->plugin->version == NULL && plugin->version != NULL)
+		|| (ip->plugin->version != NULL
+			&& plugin->version != NULL
+			&& cpi_version_cmp(&cpi_plugin_versions(plugin)->version, &cpi_plugin_versions(ip->plugin)->version) > 0);
+}
+
+/**
+ * Stops the installed plug-ins to be upgraded together with the active
+ * plug-ins importing them and returns the identifiers of the stopped
+ * plug-ins in start order.
+ *
+ * @param context the plug-in context
+ * @param avail_plugins the available plug-ins
+ * @param status pointer to the location where status code is to be stored
+ * @return NULL-terminated array of identifiers or NULL on failure
+ */
+static char **stop_affected_plugins(cp_context_t *context, hash_t *avail_plugins, cp_status_t *status) {
+	cp_plugin_t **upgraded = NULL;
+	cpi_plugin_set_t stopped;
+	char **ids = NULL;
+	int num_upgraded = 0;
+	
+	memset(&stopped, 0, sizeof(cpi_plugin_set_t));
+	do {
+		hscan_t hscan;
+		hnode_t *hnode;
+		int i;
+		
+		// Collect the installed plug-ins to be upgraded
+		if ((upgraded = cpi_malloc(hash_count(avail_plugins) * sizeof(cp_plugin_t *))) == NULL) {
+			*status = CP_ERR_RESOURCE;
+			break;
+		}
+		hash_scan_begin(&hscan, avail_plugins);
+		while ((hnode = hash_scan_next(&hscan)) != NULL) {
+			available_plugin_t *ap = hnode_get(hnode);
+			cp_plugin_t *ip;
+			
+			if ((ip = cpi_hmap_get(context->env->plugins, ap->info->identifier)) != NULL
+				&& is_upgrade(ip, ap->info)) {
+				upgraded[num_upgraded++] = ip;
+			}
+		}
+		
+		// Stop them and the plug-ins depending on them
+		if (num_upgraded > 0) {
+			cp_status_t s;
+			
+			s = cpi_stop_affected_plugins(context, upgraded, num_upgraded, CP_SCAN_RESTART_THREADS, &stopped);
+			if (s != CP_OK) {
+				*status = s;
+			}
+		}
+		
+		// Copy the identifiers, the upgraded plug-ins are uninstalled later
+		if ((ids = cpi_malloc((stopped.num + 1) * sizeof(char *))) == NULL) {
+			*status = CP_ERR_RESOURCE;
+			break;
+		}
+		for (i = 0; i < stopped.num; i++) {
+			if ((ids[i] = cpi_strdup(stopped.plugins[i]->plugin->identifier)) == NULL) {
+				*status = CP_ERR_RESOURCE;
+				break;
+			}
+		}
+		ids[i] = NULL;
+		
+	} while (0);
+	
+	// Release resources
+	cpi_free(upgraded);
+	cpi_plugin_set_clear(&stopped);
+	
+	return ids;
+}
+
+/**
+ * Scans the specified plug-in loader for available plug-ins.
+ *
+ * @param context the plug-in context
+ * @param loader the plug-in loader
+ * @param options the registration options of the loader or NULL for the defaults
+ * @param flags the scanning flags
+ * @return NULL-terminated array of plug-ins or NULL on failure
+ */
+static cp_plugin_info_t **scan_loader(cp_context_t *context, cp_plugin_loader_t *loader, const cpi_ploader_options_t *options, int flags) {
+	if ((flags & CP_SP_INCREMENTAL) && options != NULL && options->scan_changes != NULL) {
+		return options->scan_changes(loader->data, context);
+	} else {
+		return loader->scan_plugins(loader->data, context);
+	}
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Scanning thread main function. Scans the thread-safe loaders of the job
+ * until all of them have been taken and then signals the scanning thread.
+ *
+ * @param arg the scanning job
+ */
+static void scan_thread(void *arg) {
+	scan_job_t *job = arg;
+	cp_context_t *ctx = job->context;
+	
+	cpi_lock_context(ctx);
+	while (job->next_task < job->num_tasks) {
+		int i = job->tasks[job->next_task++];
+		
+		// Scan without holding the context lock
+		cpi_unlock_context(ctx);
+		job->results[i] = scan_loader(ctx, job->loaders[i], job->options[i], job->flags);
+		cpi_lock_context(ctx);
+	}
+	job->num_active--;
+	cpi_signal_context(ctx);
+	cpi_unlock_context(ctx);
+}
+
+#endif
+
+/**
+ * Adds the plug-ins loaded by the specified loader to the available
+ * plug-ins, preferring the later version of a plug-in known to several
+ * loaders, and releases the loaded plug-in information.
+ *
+ * @param context the plug-in context
+ * @param avail_plugins the available plug-ins
+ * @param loader the plug-in loader
+ * @param loaded_plugins the plug-ins loaded by the loader
+ * @return CP_OK (0) on success or CP_ERR_RESOURCE if out of resources
+ */
+static cp_status_t add_available_plugins(cp_context_t *context, hash_t *avail_plugins, cp_plugin_loader_t *loader, cp_plugin_info_t **loaded_plugins) {
+	cp_status_t status = CP_OK;
+	int i;
+	
+	// Go through the loaded plug-ins
+	for (i = 0; loaded_plugins[i] != NULL; i++) {
+		cp_plugin_info_t *plugin = loaded_plugins[i];
+		hnode_t *hnode;
+	
+		// Check if equal or later version of the plug-in is already known 
+		if ((hnode = hash_lookup(avail_plugins, plugin->identifier)) != NULL) {
+			available_plugin_t *ap = hnode_get(hnode);
+			cp_plugin_info_t *plugin2 = ap->info;
+			if (cpi_version_cmp(&cpi_plugin_versions(plugin)->version, &cpi_plugin_versions(plugin2)->version) > 0) {
+				
+				// Release plug-in with smaller version number
+				hash_delete_free(avail_plugins, hnode);
+				cpi_free(ap);
+				cp_release_info(context, plugin2);
+				hnode = NULL;
+			}
+		}
+		
+		// If no equal or later version found, use the plug-in
+		if (hnode == NULL) {
+			available_plugin_t *ap = NULL;
+			int hok = 0;
+			
+			if ((ap = cpi_malloc(sizeof(available_plugin_t))) != NULL) {
+				memset(ap, 0, sizeof(available_plugin_t));
+				ap->info = plugin;
+				ap->loader = loader;
+				hok = hash_alloc_insert(avail_plugins, plugin->identifier, ap);
+				cpi_use_info(context, plugin);
+			}
+			
+			// Report error and release resources on error
+			if (!hok) {
+				cpi_errorf(context, N_("Plug-in %s version %s could not be loaded due to insufficient system resources."), plugin->identifier, plugin->version);
+				if (ap != NULL) {
+					cpi_free(ap);
+				}
+				status = CP_ERR_RESOURCE;
+			}
+		
+		}
+			
+	}
+	
+	// Release loaded plug-in information, the array of a loader without
+	// a release function has been allocated using the system allocator
+	if (loader->release_plugins != NULL) {
+		loader->release_plugins(loader->data, context, loaded_plugins);
+	} else {
+		for (i = 0; loaded_plugins[i] != NULL; i++) {
+			cp_release_info(context, loaded_plugins[i]);
+		}
+		free(loaded_plugins);				
+	}
+	
+	return status;
+}
+
+/**
+ * Scans the registered plug-in loaders for available plug-ins. If there
+ * are several loaders, the thread-safe ones are scanned concurrently
+ * without holding the context lock while the calling thread scans the
+ * others. The results are merged in loader order so that the outcome does
+ * not depend on the scanning order. The caller must hold the context lock.
+ *
+ * @param context the plug-in context
+ * @param flags the scanning flags
+ * @param avail_plugins the available plug-ins
+ * @return CP_OK (0) on success or CP_ERR_RESOURCE if out of resources
+ */
+static cp_status_t scan_loaders(cp_context_t *context, int flags, hash_t *avail_plugins) {
+	scan_job_t job;
+	cpi_hmap_scan_t hscan;
+	const void *key;
+	int num_loaders, i;
+	cp_status_t status = CP_OK;
+#ifdef CP_THREADS
+	cpi_thread_t *threads[CP_SCAN_LOADER_THREADS];
+	int num_threads = 0;
+#endif
+	
+	// Collect the loaders and the thread-safe ones to be scanned concurrently
+	memset(&job, 0, sizeof(scan_job_t));
+	job.context = context;
+	job.flags = flags;
+	if ((num_loaders = cpi_hmap_count(context->env->loaders_to_plugins)) == 0) {
+		return CP_OK;
+	}
+	if ((job.loaders = cpi_malloc(num_loaders * sizeof(cp_plugin_loader_t *))) == NULL
+		|| (job.options = cpi_malloc(num_loaders * sizeof(cpi_ploader_options_t *))) == NULL
+		|| (job.results = cpi_malloc(num_loaders * sizeof(cp_plugin_info_t **))) == NULL
+		|| (job.tasks = cpi_malloc(num_loaders * sizeof(int))) == NULL) {
+		cpi_free(job.loaders);
+		cpi_free(job.options);
+		cpi_free(job.results);
+		return CP_ERR_RESOURCE;
+	}
+	i = 0;
+	cpi_hmap_scan_begin(&hscan, context->env->loaders_to_plugins);
+	while (cpi_hmap_scan_next(&hscan, &key) != NULL) {
+		cp_plugin_loader_t *loader = (cp_plugin_loader_t *) key;
+		
+		cpi_debugf(context, N_("Scanning plug-ins using loader %p."), (void *) loader);
+		job.loaders[i] = loader;
+		job.options[i] = cpi_hmap_get(context->env->ploader_options, loader);
+		job.results[i] = NULL;
+		if (job.options[i] != NULL && (job.options[i]->flags & CP_PLR_THREAD_SAFE) && num_loaders > 1) {
+			job.tasks[job.num_tasks++] = i;
+		}
+		i++;
+	}
+	
+#ifdef CP_THREADS
+	// Start the scanning threads, the calling thread takes part if it has no other loaders
+	if (job.num_tasks > 0) {
+		int max_threads = job.num_tasks;
+		
+		if (max_threads == num_loaders) {
+			max_threads--;
+		}
+		if (max_threads > CP_SCAN_LOADER_THREADS) {
+			max_threads = CP_SCAN_LOADER_THREADS;
+		}
+		context->env->concurrent_scan++;
+		for (; num_threads < max_threads; num_threads++) {
+			if ((threads[num_threads] = cpi_create_thread(scan_thread, &job)) == NULL) {
+				break;
+			}
+			job.num_active++;
+		}
+	}
+#endif
+
+	// Scan the other loaders while holding the context lock
+	for (i = 0; i < num_loaders; i++) {
+		if (job.options[i] == NULL || !(job.options[i]->flags & CP_PLR_THREAD_SAFE) || num_loaders == 1) {
+			job.results[i] = scan_loader(context, job.loaders[i], job.options[i], flags);
+		}
+	}
+	
+	// Scan any remaining thread-safe loaders
+	while (job.next_task < job.num_tasks) {
+		int j = job.tasks[job.next_task++];
+		
+		cpi_unlock_context(context);
+		job.results[j] = scan_loader(context, job.loaders[j], job.options[j], flags);
+		cpi_lock_context(context);
+	}
+	
+#ifdef CP_THREADS
+	// Wait for the scanning threads to complete
+	if (job.num_tasks > 0) {
+		int t;
+		
+		while (job.num_active > 0) {
+			cpi_wait_context(context);
+		}
+		for (t = 0; t < num_threads; t++) {
+			cpi_join_thread(threads[t]);
+		}
+		context->env->concurrent_scan--;
+		cpi_signal_context(context);
+	}
+#endif
+	
+	// Merge the results in loader order
+	for (i = 0; i < num_loaders; i++) {
+		if (job.results[i] == NULL) {
+			cpi_errorf(context, N_("Plug-in loader %p failed to scan for plug-ins."), (void *) job.loaders[i]);
+		} else if (add_available_plugins(context, avail_plugins, job.loaders[i], job.results[i]) != CP_OK) {
+			status = CP_ERR_RESOURCE;
+		}
+	}
+	
+	// Release resources
+	cpi_free(job.loaders);
+	cpi_free(job.options);
+	cpi_free(job.results);
+	cpi_free(job.tasks);
+	
+	return status;
+}
+
+CP_HIDDEN void cpi_release_loaded_plugins(void *data, cp_context_t *context, cp_plugin_info_t **plugins) {
+	int i;
+	
+	for (i = 0; plugins[i] != NULL; i++) {
+		cp_release_info(context, plugins[i]);
+	}
+	cpi_free(plugins);
+}
+
 CP_C_API cp_status_t cp_scan_plugins(cp_context_t *context, int flags) {
 	hash_t *avail_plugins = NULL;
 	list_t *started_plugins = NULL;
+	char **affected_plugins = NULL;
 	cp_plugin_info_t **plugins = NULL;
+	cp_plugin_info_t **install_infos = NULL;
+	cp_plugin_loader_t **install_loaders = NULL;
+	cp_status_t *install_statuses = NULL;
+	unsigned int num_avail, num_install = 0;
 	char *pdir_path = NULL;
 	int plugins_stopped = 0;
+	cpi_invocation_t lifecycle;
 	cp_status_t status = CP_OK;
 	
 	CHECK_NOT_NULL(context);
 	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_begin_lifecycle(context, &lifecycle);
+	cpi_wait_loader_scans(context);
 	cpi_debug(context, N_("Plug-in scan is starting."));
 	do {
 		lnode_t *lnode;
 		hscan_t hscan;
 		hnode_t *hnode;
+		cp_status_t s;
 	
 		// Copy the list of started plug-ins, if necessary 
 		if ((flags & CP_SP_RESTART_ACTIVE)
@@ -95,12 +485,12 @@ CP_C_API cp_status_t cp_scan_plugins(cp_context_t *context, int flags) {
 				if (state == CP_PLUGIN_STARTING || state == CP_PLUGIN_ACTIVE) {
 					char *pid;
 				
-					if ((pid = strdup(plugins[i]->identifier)) == NULL) {
+					if ((pid = cpi_strdup(plugins[i]->identifier)) == NULL) {
 						status = CP_ERR_RESOURCE;
 						break;
 					}
 					if ((lnode = lnode_create(pid)) == NULL) {
-						free(pid);
+						cpi_free(pid);
 						status = CP_ERR_RESOURCE;
 						break;
 					}
@@ -112,120 +502,64 @@ CP_C_API cp_status_t cp_scan_plugins(cp_context_t *context, int flags) {
 		}
 		
 		// Create a hash for available plug-ins 
-		if ((avail_plugins = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+		if ((avail_plugins = hash_create(HASHCOUNT_T_MAX, cpi_comp_str, NULL)) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
 	
 		// Scan plug-in loaders for available plug-ins 
-		hash_scan_begin(&hscan, context->env->loaders_to_plugins);
-		while ((hnode = hash_scan_next(&hscan)) != NULL) {
-			cp_plugin_loader_t *loader = (cp_plugin_loader_t *) hnode_getkey(hnode);
-			cp_plugin_info_t **loaded_plugins;
-			int i;
-			
-			// Scan plug-ins using the loader
-			cpi_debugf(context, N_("Scanning plug-ins using loader %p."), (void *) loader);
-			loaded_plugins = loader->scan_plugins(loader->data, context);
-			if (loaded_plugins == NULL) {
-				cpi_errorf(context, N_("Plug-in loader %p failed to scan for plug-ins."), (void *) loader);
-				continue;
-			}
-
-			// Go through the loaded plug-ins
-			for (i = 0; loaded_plugins[i] != NULL; i++) {
-				cp_plugin_info_t *plugin = loaded_plugins[i];
-			
-				// Check if equal or later version of the plug-in is already known 
-				if ((hnode = hash_lookup(avail_plugins, plugin->identifier)) != NULL) {
-					available_plugin_t *ap = hnode_get(hnode);
-					cp_plugin_info_t *plugin2 = ap->info;
-					if (cpi_vercmp(plugin->version, plugin2->version) > 0) {
-						
-						// Release plug-in with smaller version number
-						hash_delete_free(avail_plugins, hnode);
-						free(ap);
-						cp_release_info(context, plugin2);
-						hnode = NULL;
-					}
-				}
-				
-				// If no equal or later version found, use the plug-in
-				if (hnode == NULL) {
-					available_plugin_t *ap = NULL;
-					int hok = 0;
-					
-					if ((ap = malloc(sizeof(available_plugin_t))) != NULL) {
-						memset(ap, 0, sizeof(available_plugin_t));
-						ap->info = plugin;
-						ap->loader = loader;
-						hok = hash_alloc_insert(avail_plugins, plugin->identifier, ap);
-						cpi_use_info(context, plugin);
-					}
-					
-					// Report error and release resources on error
-					if (!hok) {
-						cpi_errorf(context, N_("Plug-in %s version %s could not be loaded due to insufficient system resources."), plugin->identifier, plugin->version);
-						if (ap != NULL) {
-							free(ap);
-						}
-						status = CP_ERR_RESOURCE;
-					}
-				
-				}
-					
-			}
-			
-			// Release loaded plug-in information
-			if (loader->release_plugins != NULL) {
-				loader->release_plugins(loader->data, context, loaded_plugins);
-			} else {
-				int i;
-				for (i = 0; loaded_plugins[i] != NULL; i++) {
-					cp_release_info(context, loaded_plugins[i]);
-				}
-				free(loaded_plugins);				
-			}
+		if ((s = scan_loaders(context, flags, avail_plugins)) != CP_OK) {
+			status = s;
 		}
 		
-		// Install/upgrade plug-ins 
+		// Allocate space for the batch of plug-ins to be installed
+		num_avail = hash_count(avail_plugins);
+		if (num_avail > 0
+			&& ((install_infos = cpi_malloc(num_avail * sizeof(cp_plugin_info_t *))) == NULL
+				|| (install_loaders = cpi_malloc(num_avail * sizeof(cp_plugin_loader_t *))) == NULL
+				|| (install_statuses = cpi_malloc(num_avail * sizeof(cp_status_t))) == NULL)) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Stop only the plug-ins affected by upgrades, if so specified
+		if ((flags & CP_SP_UPGRADE)
+			&& (flags & CP_SP_RESTART_AFFECTED)
+			&& !(flags & (CP_SP_STOP_ALL_ON_UPGRADE | CP_SP_STOP_ALL_ON_INSTALL))
+			&& num_avail > 0) {
+			affected_plugins = stop_affected_plugins(context, avail_plugins, &status);
+		}
+		
+		// Uninstall plug-ins to be upgraded and collect plug-ins to be installed 
 		hash_scan_begin(&hscan, avail_plugins);
 		while ((hnode = hash_scan_next(&hscan)) != NULL) {
 			available_plugin_t *ap;
 			cp_plugin_info_t *plugin;
 			cp_plugin_loader_t *loader;
-			cp_plugin_t *ip = NULL;
-			hnode_t *hn2;
-			int s;
+			cp_plugin_t *ip;
 			
 			ap = hnode_get(hnode);
 			plugin = ap->info;
 			loader = ap->loader;
-			hn2 = hash_lookup(context->env->plugins, plugin->identifier);
-			if (hn2 != NULL) {
-				ip = hnode_get(hn2);
-			}
+			ip = cpi_hmap_get(context->env->plugins, plugin->identifier);
 			
 			// Unload the installed plug-in if it is to be upgraded 
 			if (ip != NULL
 				&& (flags & CP_SP_UPGRADE)
-				&& ((ip->plugin->version == NULL && plugin->version != NULL)
-					|| (ip->plugin->version != NULL
-						&& plugin->version != NULL
-						&& cpi_vercmp(plugin->version, ip->plugin->version) > 0))) {
+				&& is_upgrade(ip, plugin)) {
 				if ((flags & (CP_SP_STOP_ALL_ON_UPGRADE | CP_SP_STOP_ALL_ON_INSTALL))
 					&& !plugins_stopped) {
 					plugins_stopped = 1;
 					cp_stop_plugins(context);
 				}
-				s = cp_uninstall_plugin(context, plugin->identifier);
-				assert(s == CP_OK);
+				if ((s = cp_uninstall_plugin(context, plugin->identifier)) != CP_OK) {
+					status = s;
+				}
 				ip = NULL;
 			}
 			
-			// Install the plug-in, if to be installed 
+			// Collect the plug-in, if to be installed 
 			if (ip == NULL) {
-				int hok = 0;
 				hash_t *loader_plugins;
 			
 				// First stop all plug-ins if so specified
@@ -235,36 +569,40 @@ CP_C_API cp_status_t cp_scan_plugins(cp_context_t *context, int flags) {
 				}
 				
 				// Add plug-in to loader map
-				loader_plugins = hnode_get(hash_lookup(context->env->loaders_to_plugins, loader));
+				loader_plugins = cpi_hmap_get(context->env->loaders_to_plugins, loader);
 				assert(loader_plugins != NULL);
-				if ((hok = hash_alloc_insert(loader_plugins, plugin->identifier, NULL))) {
-					
-					// Install new plug-in
-					s = cpi_install_plugin(context, plugin, loader);
-				}
-				
-				// Release resources and set status code on failure
-				if (!hok || s != CP_OK) {
-					if (hok) {
-						hash_delete_free(
-							loader_plugins,
-							hash_lookup(loader_plugins, plugin->identifier)
-						);
-					}
-					if (hok) {
-						status = s;
-					} else {
-						status = CP_ERR_RESOURCE;
-					}
+				if (!hash_alloc_insert(loader_plugins, plugin->identifier, NULL)) {
+					status = CP_ERR_RESOURCE;
 					break;
 				}
-				
+				install_infos[num_install] = plugin;
+				install_loaders[num_install] = loader;
+				num_install++;
+			}
+		}
+		
+		// Install the collected plug-ins as a single batch
+		if (num_install > 0) {
+			cp_status_t s;
+			unsigned int i;
+			
+			s = cpi_install_plugins(context, install_infos, install_loaders, num_install, 0, install_statuses);
+			if (status == CP_OK) {
+				status = s;
 			}
 			
-			// Remove the plug-in from the hash
-			free(ap);
-			hash_scan_delfree(avail_plugins, hnode);
-			cp_release_info(context, plugin);
+			// Remove the plug-ins that failed from the loader maps
+			for (i = 0; i < num_install; i++) {
+				if (install_statuses[i] != CP_OK) {
+					hash_t *loader_plugins;
+					
+					loader_plugins = cpi_hmap_get(context->env->loaders_to_plugins, install_loaders[i]);
+					hash_delete_free(
+						loader_plugins,
+						hash_lookup(loader_plugins, install_infos[i]->identifier)
+					);
+				}
+			}
 		}
 		
 		// Restart stopped plug-ins if necessary 
@@ -283,8 +621,21 @@ CP_C_API cp_status_t cp_scan_plugins(cp_context_t *context, int flags) {
 			}
 		}
 		
+		// Restart the plug-ins affected by upgrades
+		if (affected_plugins != NULL && affected_plugins[0] != NULL) {
+			cp_status_t s;
+			
+			s = cp_start_plugins_parallel(context, (const char * const *) affected_plugins, CP_SCAN_RESTART_THREADS);
+			if (s != CP_OK) {
+				status = s;
+			}
+		}
+		
 	} while (0);
 
+	// Persist any changes to the descriptor cache
+	cpi_save_descriptor_cache(context);
+
 	// Report error
 	switch (status) {
 		case CP_OK:
@@ -297,11 +648,12 @@ CP_C_API cp_status_t cp_scan_plugins(cp_context_t *context, int flags) {
 			cpi_error(context, N_("Could not scan all plug-ins."));
 			break;
 	}
+	cpi_end_lifecycle(context, &lifecycle);
 	cpi_unlock_context(context);
 	
 	// Release resources 
 	if (pdir_path != NULL) {
-		free(pdir_path);
+		cpi_free(pdir_path);
 	}
 	if (avail_plugins != NULL) {
 		hscan_t hscan;
@@ -309,16 +661,28 @@ CP_C_API cp_status_t cp_scan_plugins(cp_context_t *context, int flags) {
 		
 		hash_scan_begin(&hscan, avail_plugins);
 		while ((hnode = hash_scan_next(&hscan)) != NULL) {
-			cp_plugin_info_t *p = hnode_get(hnode);
+			available_plugin_t *ap = hnode_get(hnode);
 			hash_scan_delfree(avail_plugins, hnode);
-			cp_release_info(context, p);
+			cp_release_info(context, ap->info);
+			cpi_free(ap);
 		}
 		hash_destroy(avail_plugins);
 	}
+	cpi_free(install_infos);
+	cpi_free(install_loaders);
+	cpi_free(install_statuses);
 	if (started_plugins != NULL) {
 		list_process(started_plugins, NULL, cpi_process_free_ptr);
 		list_destroy(started_plugins);
 	}
+	if (affected_plugins != NULL) {
+		int i;
+		
+		for (i = 0; affected_plugins[i] != NULL; i++) {
+			cpi_free(affected_plugins[i]);
+		}
+		cpi_free(affected_plugins);
+	}
 	if (plugins != NULL) {
 		cp_release_info(context, plugins);
 	}
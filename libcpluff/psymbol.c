@@ -39,6 +39,21 @@
 #include "util.h"
 
 
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+#ifdef CP_SYMBOL_CACHE
+
+/// Number of reader slots of a symbol cache, a power of two
+#define CP_SYMBOL_CACHE_SLOTS 16
+
+/// Assumed size of a cache line, used to keep the reader slots apart
+#define CP_SYMBOL_CACHE_LINE 64
+
+#endif
+
+
 /* ------------------------------------------------------------------------
  * Data structures
  * ----------------------------------------------------------------------*/
@@ -57,6 +72,11 @@ typedef struct symbol_provider_info_t {
 	
 } symbol_provider_info_t;
 
+#ifdef CP_SYMBOL_CACHE
+typedef struct symbol_cache_entry_t symbol_cache_entry_t;
+typedef struct symbol_cache_table_t symbol_cache_table_t;
+#endif
+
 /// Information about used symbol
 typedef struct symbol_info_t {
 
@@ -66,13 +86,482 @@ typedef struct symbol_info_t {
 	// Information about providing plug-in
 	symbol_provider_info_t *provider_info;
 	
+#ifdef CP_SYMBOL_CACHE
+
+	// The cache entry holding a reference to the symbol, or NULL if none
+	symbol_cache_entry_t *cache_entry;
+
+#endif
+	
 } symbol_info_t;
 
+#ifdef CP_SYMBOL_CACHE
+
+/**
+ * A cached symbol resolution. The key and the symbol are immutable while
+ * the entry is reachable by readers. An entry holds one usage of the
+ * symbol on behalf of the references handed out by the cache.
+ */
+struct symbol_cache_entry_t {
+
+	/// Identifier of the providing plug-in
+	char *plugin_id;
+	
+	/// Interned name of the symbol
+	const char *name;
+	
+	/// Hash value of the key
+	hash_val_t hash;
+	
+	/// The symbol
+	void *symbol;
+	
+	/// Information about the used symbol, or NULL if the entry has been dropped
+	symbol_info_t *symbol_info;
+	
+	/// Symbol generation at which the entry was last validated
+	unsigned int generation;
+	
+	/// Whether the entry may currently be used by readers
+	int valid;
+	
+	/// Number of references handed out by the cache and not yet released
+	int num_refs;
+	
+	/// Reclamation epoch at which the entry was retired
+	unsigned int retired_epoch;
+	
+	/// Next retired entry waiting to be freed
+	symbol_cache_entry_t *next_retired;
+
+};
+
+/**
+ * An open addressing hash table of cached symbols. A table is not modified
+ * after it has been published. Instead, it is replaced by a new table.
+ */
+struct symbol_cache_table_t {
+
+	/// Number of slots, a power of two
+	unsigned int size;
+	
+	/// The slots, NULL for empty slots
+	symbol_cache_entry_t **entries;
+	
+	/// Reclamation epoch at which the table was retired
+	unsigned int retired_epoch;
+	
+	/// Next retired table waiting to be freed
+	symbol_cache_table_t *next_retired;
+
+};
+
+/**
+ * A reader slot of a symbol cache, padded to a cache line of its own so
+ * that readers using different slots do not contend.
+ */
+typedef struct symbol_cache_slot_t {
+	
+	/// The reclamation epoch announced by the reader, or zero if unused
+	unsigned int epoch;
+	
+	/// Padding up to the cache line size
+	char padding[CP_SYMBOL_CACHE_LINE - sizeof(unsigned int)];
+	
+} symbol_cache_slot_t;
+
+/**
+ * A per-context cache of resolved symbols. Readers look up symbols without
+ * locking the context. Tables and entries replaced by the writers, which
+ * hold the context lock, are retired with the current reclamation epoch
+ * and the epoch is advanced. A reader announces the epoch it entered in a
+ * reader slot of its own, so a retired object can be freed once every
+ * reader in a slot has entered at a later epoch.
+ */
+struct cpi_symbol_cache_t {
+
+	/// The current table, or NULL if empty
+	symbol_cache_table_t *table;
+	
+	/// The current reclamation epoch, always odd so that it is never zero
+	unsigned int epoch;
+	
+	/// The reader slots
+	symbol_cache_slot_t slots[CP_SYMBOL_CACHE_SLOTS];
+	
+	/// Retired tables
+	symbol_cache_table_t *retired_tables;
+	
+	/// Retired entries
+	symbol_cache_entry_t *retired_entries;
+
+};
+
+#endif
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
  * ----------------------------------------------------------------------*/
 
+#ifdef CP_SYMBOL_CACHE
+
+/**
+ * Returns a hash value for the symbol cache key.
+ * 
+ * @param id the plug-in identifier
+ * @param key the symbol key
+ * @return the hash value
+ */
+static hash_val_t symbol_key_hash(const char *id, const cp_symbol_key_t *key) {
+	hash_val_t hash = key->hash;
+	
+	while (*id != '\0') {
+		hash = hash * 33 + (unsigned char) *(id++);
+	}
+	return hash;
+}
+
+/**
+ * Looks up a cache entry in the specified table.
+ * 
+ * @param table the table
+ * @param id the plug-in identifier
+ * @param name the symbol name
+ * @param hash the hash value of the key
+ * @return the entry or NULL if not found
+ */
+static symbol_cache_entry_t *find_cached_symbol(const symbol_cache_table_t *table, const char *id, const char *name, hash_val_t hash) {
+	symbol_cache_entry_t *entry;
+	unsigned int i;
+	
+	for (i = hash & (table->size - 1); (entry = table->entries[i]) != NULL; i = (i + 1) & (table->size - 1)) {
+		if (entry->hash == hash
+			&& (entry->name == name || !strcmp(entry->name, name))
+			&& !strcmp(entry->plugin_id, id)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Resolves a symbol from the symbol cache without locking the context.
+ * A successful lookup hands out a new reference to the symbol.
+ * 
+ * @param context the plug-in context
+ * @param id the plug-in identifier
+ * @param key the symbol key
+ * @return the symbol or NULL if it must be resolved the normal way
+ */
+static void *resolve_cached_symbol(cp_context_t *context, const char *id, const cp_symbol_key_t *key) {
+	cpi_symbol_cache_t *cache;
+	symbol_cache_slot_t *slot = NULL;
+	symbol_cache_table_t *table;
+	symbol_cache_entry_t *entry;
+	unsigned int generation, epoch, start, i;
+	void *symbol = NULL;
+	
+	if ((cache = cpi_atomic_load(&context->symbol_cache)) == NULL) {
+		return NULL;
+	}
+	
+	/*
+	 * Enter a free reader slot at the current epoch. Threads have separate
+	 * stacks, so hashing the address of a local variable spreads them over
+	 * the slots. The symbol is resolved the normal way if all are busy.
+	 */
+	epoch = cpi_atomic_load(&cache->epoch);
+	start = (unsigned int) (((size_t) &slot >> 12) * 2654435761U) >> 28;
+	for (i = 0; i < CP_SYMBOL_CACHE_SLOTS && slot == NULL; i++) {
+		symbol_cache_slot_t *s = cache->slots + ((start + i) & (CP_SYMBOL_CACHE_SLOTS - 1));
+		unsigned int unused = 0;
+		
+		if (cpi_atomic_cas(&s->epoch, &unused, epoch)) {
+			slot = s;
+		}
+	}
+	if (slot == NULL) {
+		return NULL;
+	}
+	
+	generation = cpi_atomic_load(&context->env->symbol_generation);
+	if ((table = cpi_atomic_load(&cache->table)) != NULL
+		&& (entry = find_cached_symbol(table, id, key->name, symbol_key_hash(id, key))) != NULL
+		&& cpi_atomic_load(&entry->generation) == generation) {
+		
+		/*
+		 * Take the reference first and then check that the entry is still
+		 * valid. A writer dropping the entry invalidates it first and then
+		 * checks for references, so one of the two sees the other.
+		 */
+		cpi_atomic_inc(&entry->num_refs);
+		if (cpi_atomic_load(&entry->valid)
+			&& cpi_atomic_load(&context->env->symbol_generation) == generation) {
+			symbol = entry->symbol;
+		} else {
+			cpi_atomic_dec(&entry->num_refs);
+		}
+	}
+	cpi_atomic_store(&slot->epoch, 0);
+	return symbol;
+}
+
+/**
+ * Returns whether a reclamation epoch precedes another one, allowing for
+ * the epoch counter to wrap around.
+ * 
+ * @param a the first epoch
+ * @param b the second epoch
+ * @return non-zero if @a a precedes @a b
+ */
+static int epoch_before(unsigned int a, unsigned int b) {
+	return (int) (a - b) < 0;
+}
+
+/**
+ * Retires the current table of the symbol cache, if any, together with
+ * the dropped entries in it, those with no symbol information, and
+ * advances the reclamation epoch. The table must already have been
+ * replaced for readers. The caller must have locked the context.
+ * 
+ * @param cache the symbol cache
+ * @param old the replaced table or NULL
+ */
+static void retire_symbol_cache_table(cpi_symbol_cache_t *cache, symbol_cache_table_t *old) {
+	unsigned int i;
+	
+	if (old == NULL) {
+		return;
+	}
+	for (i = 0; i < old->size; i++) {
+		symbol_cache_entry_t *entry = old->entries[i];
+		
+		if (entry != NULL && entry->symbol_info == NULL) {
+			entry->retired_epoch = cache->epoch;
+			entry->next_retired = cache->retired_entries;
+			cache->retired_entries = entry;
+		}
+	}
+	old->retired_epoch = cache->epoch;
+	old->next_retired = cache->retired_tables;
+	cache->retired_tables = old;
+	cpi_atomic_store(&cache->epoch, cache->epoch + 2);
+}
+
+/**
+ * Frees the retired tables and entries of the symbol cache that can no
+ * longer be reached by any reader, that is those retired before the
+ * oldest epoch announced in the reader slots. The caller must have locked
+ * the context.
+ * 
+ * @param cache the symbol cache
+ */
+static void reclaim_symbol_cache(cpi_symbol_cache_t *cache) {
+	symbol_cache_table_t **tablep;
+	symbol_cache_entry_t **entryp;
+	unsigned int oldest = cache->epoch;
+	int i;
+	
+	if (cache->retired_tables == NULL && cache->retired_entries == NULL) {
+		return;
+	}
+	for (i = 0; i < CP_SYMBOL_CACHE_SLOTS; i++) {
+		unsigned int epoch = cpi_atomic_load(&cache->slots[i].epoch);
+		
+		if (epoch != 0 && epoch_before(epoch, oldest)) {
+			oldest = epoch;
+		}
+	}
+	tablep = &cache->retired_tables;
+	while (*tablep != NULL) {
+		symbol_cache_table_t *table = *tablep;
+		
+		if (epoch_before(table->retired_epoch, oldest)) {
+			*tablep = table->next_retired;
+			cpi_free(table);
+		} else {
+			tablep = &table->next_retired;
+		}
+	}
+	entryp = &cache->retired_entries;
+	while (*entryp != NULL) {
+		symbol_cache_entry_t *entry = *entryp;
+		
+		if (epoch_before(entry->retired_epoch, oldest)) {
+			*entryp = entry->next_retired;
+			cpi_free(entry->plugin_id);
+			cpi_free(entry);
+		} else {
+			entryp = &entry->next_retired;
+		}
+	}
+}
+
+/**
+ * Publishes a new symbol cache table containing the live entries of the
+ * current table and optionally a new entry. Dropped entries, those with no
+ * symbol information, are retired. The caller must have locked the context.
+ * 
+ * @param cache the symbol cache
+ * @param add the entry to be added or NULL
+ * @return non-zero on success or zero if insufficient memory
+ */
+static int rebuild_symbol_cache(cpi_symbol_cache_t *cache, symbol_cache_entry_t *add) {
+	symbol_cache_table_t *old = cache->table;
+	symbol_cache_table_t *table = NULL;
+	unsigned int n = (add != NULL);
+	unsigned int i;
+	
+	// Count the live entries
+	if (old != NULL) {
+		for (i = 0; i < old->size; i++) {
+			if (old->entries[i] != NULL && old->entries[i]->symbol_info != NULL) {
+				n++;
+			}
+		}
+	}
+	
+	// Build the new table
+	if (n > 0) {
+		unsigned int size;
+		
+		for (size = 8; size < 2 * n; size *= 2);
+		if ((table = cpi_malloc(sizeof(symbol_cache_table_t) + size * sizeof(symbol_cache_entry_t *))) == NULL) {
+			return 0;
+		}
+		table->size = size;
+		table->entries = (symbol_cache_entry_t **) (table + 1);
+		table->next_retired = NULL;
+		memset(table->entries, 0, size * sizeof(symbol_cache_entry_t *));
+		for (i = 0; old != NULL && i < old->size; i++) {
+			symbol_cache_entry_t *entry = old->entries[i];
+			unsigned int j;
+			
+			if (entry == NULL || entry->symbol_info == NULL) {
+				continue;
+			}
+			for (j = entry->hash & (size - 1); table->entries[j] != NULL; j = (j + 1) & (size - 1));
+			table->entries[j] = entry;
+		}
+		if (add != NULL) {
+			for (i = add->hash & (size - 1); table->entries[i] != NULL; i = (i + 1) & (size - 1));
+			table->entries[i] = add;
+		}
+	}
+	
+	// Publish the new table and retire the old one
+	cpi_atomic_store(&cache->table, table);
+	retire_symbol_cache_table(cache, old);
+	reclaim_symbol_cache(cache);
+	return 1;
+}
+
+/**
+ * Returns the memory used by the symbol cache, including the retired
+ * tables and entries not yet reclaimed. The caller must have locked the
+ * context.
+ * 
+ * @param cache the symbol cache
+ * @return the number of bytes used
+ */
+static size_t symbol_cache_memory(const cpi_symbol_cache_t *cache) {
+	const symbol_cache_table_t *table;
+	const symbol_cache_entry_t *entry;
+	size_t bytes = sizeof(cpi_symbol_cache_t);
+	
+	if (cache->table != NULL) {
+		unsigned int i;
+		
+		bytes += sizeof(symbol_cache_table_t) + cache->table->size * sizeof(symbol_cache_entry_t *);
+		for (i = 0; i < cache->table->size; i++) {
+			if ((entry = cache->table->entries[i]) != NULL) {
+				bytes += sizeof(symbol_cache_entry_t) + strlen(entry->plugin_id) + 1;
+			}
+		}
+	}
+	for (table = cache->retired_tables; table != NULL; table = table->next_retired) {
+		bytes += sizeof(symbol_cache_table_t) + table->size * sizeof(symbol_cache_entry_t *);
+	}
+	for (entry = cache->retired_entries; entry != NULL; entry = entry->next_retired) {
+		bytes += sizeof(symbol_cache_entry_t) + strlen(entry->plugin_id) + 1;
+	}
+	return bytes;
+}
+
+/**
+ * Adds a symbol resolved the normal way into the symbol cache, or
+ * revalidates an existing entry for it. Failures are silently ignored
+ * because the cache is only an optimization. The caller must have locked
+ * the context.
+ * 
+ * @param context the plug-in context
+ * @param id the plug-in identifier
+ * @param key the symbol key
+ * @param symbol the symbol
+ * @param symbol_info information about the used symbol
+ */
+static void cache_symbol(cp_context_t *context, const char *id, const cp_symbol_key_t *key, void *symbol, symbol_info_t *symbol_info) {
+	cpi_symbol_cache_t *cache = context->symbol_cache;
+	symbol_cache_entry_t *entry;
+	hash_val_t hash = symbol_key_hash(id, key);
+	
+	// Create the cache, if necessary
+	if (cache == NULL) {
+		if ((cache = cpi_malloc(sizeof(cpi_symbol_cache_t))) == NULL) {
+			return;
+		}
+		memset(cache, 0, sizeof(cpi_symbol_cache_t));
+		cache->epoch = 1;
+		cpi_atomic_store(&context->symbol_cache, cache);
+	}
+	
+	// Free the objects no longer reachable by readers
+	reclaim_symbol_cache(cache);
+	
+	// Revalidate an existing entry
+	if (cache->table != NULL
+		&& (entry = find_cached_symbol(cache->table, id, key->name, hash)) != NULL
+		&& entry->symbol_info != NULL) {
+		if (entry->symbol == symbol) {
+			cpi_atomic_store(&entry->generation, cpi_atomic_load(&context->env->symbol_generation));
+		}
+		return;
+	}
+	
+	// Check whether the symbol is already cached under another key
+	if (symbol_info->cache_entry != NULL) {
+		return;
+	}
+	
+	// Add a new entry
+	if ((entry = cpi_malloc(sizeof(symbol_cache_entry_t))) == NULL) {
+		return;
+	}
+	memset(entry, 0, sizeof(symbol_cache_entry_t));
+	entry->plugin_id = cpi_strdup(id);
+	entry->name = cpi_intern_string(context, key->name);
+	entry->hash = hash;
+	entry->symbol = symbol;
+	entry->symbol_info = symbol_info;
+	entry->generation = cpi_atomic_load(&context->env->symbol_generation);
+	entry->valid = 1;
+	if (entry->plugin_id == NULL
+		|| entry->name == NULL
+		|| !rebuild_symbol_cache(cache, entry)) {
+		cpi_free(entry->plugin_id);
+		cpi_free(entry);
+		return;
+	}
+	
+	// The entry holds a usage of the symbol
+	symbol_info->cache_entry = entry;
+	symbol_info->usage_count++;
+	symbol_info->provider_info->usage_count++;
+}
+
+#endif
+
 CP_C_API cp_status_t cp_define_symbol(cp_context_t *context, const char *name, void *ptr) {
 	cp_status_t status = CP_OK;
 	
@@ -86,7 +575,7 @@ CP_C_API cp_status_t cp_define_symbol(cp_context_t *context, const char *name, v
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
 	do {
-		char *n;
+		const char *n;
 		
 		// Create a symbol hash if necessary
 		if (context->plugin->defined_symbols == NULL) {
@@ -102,10 +591,9 @@ CP_C_API cp_status_t cp_define_symbol(cp_context_t *context, const char *name, v
 			break;
 		}
 
-		// Insert the symbol into the symbol hash
-		n = strdup(name);
+		// Insert the symbol into the symbol hash using an interned name
+		n = cpi_intern_string(context, name);
 		if (n == NULL || !hash_alloc_insert(context->plugin->defined_symbols, n, ptr)) {
-			free(n);
 			status = CP_ERR_RESOURCE;
 			break;
 		} 
@@ -130,58 +618,347 @@ CP_C_API cp_status_t cp_define_symbol(cp_context_t *context, const char *name, v
 	return status;
 }
 
-CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const char *name, cp_status_t *error) {
-	cp_status_t status = CP_OK;
-	int error_reported = 1;
-	hnode_t *node;
-	void *symbol = NULL;
-	symbol_info_t *symbol_info = NULL;
-	symbol_provider_info_t *provider_info = NULL;
-	cp_plugin_t *pp = NULL;
+CP_HIDDEN void cpi_symbol_memory(cp_context_t *context, cp_memory_stats_t *stats) {
+	
+	// Symbols defined by the plug-in, the names are interned
+	if (context->plugin != NULL && context->plugin->defined_symbols != NULL) {
+		hashcount_t n = hash_count(context->plugin->defined_symbols);
+		
+		stats->defined_symbols += n;
+		stats->defined_symbol_bytes += sizeof(hash_t) + n * sizeof(hnode_t);
+	}
+	
+	// Symbols resolved by the context and their providers
+	if (context->resolved_symbols != NULL) {
+		hashcount_t n = hash_count(context->resolved_symbols);
+		
+		stats->resolved_symbols += n;
+		stats->resolved_symbol_bytes += sizeof(hash_t) + n * (sizeof(hnode_t) + sizeof(symbol_info_t));
+	}
+	if (context->symbol_providers != NULL) {
+		stats->resolved_symbol_bytes += sizeof(hash_t)
+			+ hash_count(context->symbol_providers) * (sizeof(hnode_t) + sizeof(symbol_provider_info_t));
+	}
+#ifdef CP_SYMBOL_CACHE
+	
+	// The symbol cache, including objects not yet reclaimed
+	if (context->symbol_cache != NULL) {
+		stats->resolved_symbol_bytes += symbol_cache_memory(context->symbol_cache);
+	}
+#endif
+}
 
-	CHECK_NOT_NULL(context);
-	CHECK_NOT_NULL(id);
-	CHECK_NOT_NULL(name);
+/**
+ * Releases a usage of the symbol associated with the specified node of the
+ * resolved symbols hash. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param node the node of the resolved symbol
+ */
+static void release_symbol(cp_context_t *context, hnode_t *node) {
+	const void *ptr = hnode_getkey(node);
+	symbol_info_t *symbol_info = hnode_get(node);
+	symbol_provider_info_t *provider_info = symbol_info->provider_info;
 	
-	// Resolve the symbol
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER | CPI_CF_STOP, __func__);
-	do {
+	// Decrease usage count
+	assert(symbol_info->usage_count > 0);
+	symbol_info->usage_count--;
+	assert(provider_info->usage_count > 0);
+	provider_info->usage_count--;
 
-		// Allocate space for symbol hashes, if necessary
-		if (context->resolved_symbols == NULL) {
-			context->resolved_symbols = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
+	// Check if the symbol is not being used anymore
+	if (symbol_info->usage_count == 0) {
+		hash_delete_free(context->resolved_symbols, node);
+		cpi_free(symbol_info);
+		if (cpi_is_logged(context, CP_LOG_DEBUG)) {
+			char owner[64];
+			/* TRANSLATORS: First %s is the context owner */
+			cpi_debugf(context, N_("%s released the symbol at address %p defined by plug-in %s."), cpi_context_owner(context, owner, sizeof(owner)), ptr, provider_info->plugin->plugin->identifier);
 		}
-		if (context->symbol_providers == NULL) {
-			context->symbol_providers = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
+	}
+
+	// Check if the symbol providing plug-in is not being used anymore
+	if (provider_info->usage_count == 0) {
+		node = hash_lookup(context->symbol_providers, provider_info->plugin);
+		assert(node != NULL);
+		hash_delete_free(context->symbol_providers, node);
+		if (!provider_info->imported) {
+			cpi_plugin_set_remove(&context->plugin->imported, provider_info->plugin);
+			cpi_plugin_set_remove(&provider_info->plugin->importing, context->plugin);
+			cpi_debugf(context, N_("A dynamic dependency from plug-in %s to plug-in %s was removed."), context->plugin->plugin->identifier, provider_info->plugin->plugin->identifier);
 		}
-		if (context->resolved_symbols == NULL
-			|| context->symbol_providers == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
+		cpi_free(provider_info);
+	}
+}
+
+#ifdef CP_SYMBOL_CACHE
+
+/**
+ * Drops the cache entry of a resolved symbol if the usage held by the
+ * entry is the only remaining usage. The caller must have locked the
+ * context.
+ * 
+ * @param context the plug-in context
+ * @param node the node of the resolved symbol
+ */
+static void uncache_symbol(cp_context_t *context, hnode_t *node) {
+	symbol_info_t *symbol_info = hnode_get(node);
+	symbol_cache_entry_t *entry = symbol_info->cache_entry;
+	
+	if (entry == NULL || symbol_info->usage_count != 1) {
+		return;
+	}
+	
+	// Keep the entry if a reader has just taken a reference
+	cpi_atomic_store(&entry->valid, 0);
+	if (cpi_atomic_load(&entry->num_refs) != 0) {
+		cpi_atomic_store(&entry->valid, 1);
+		return;
+	}
+	
+	// Drop the entry and the usage held by it
+	entry->symbol_info = NULL;
+	symbol_info->cache_entry = NULL;
+	rebuild_symbol_cache(context->symbol_cache, NULL);
+	release_symbol(context, node);
+}
+
+CP_HIDDEN void cpi_clear_symbol_cache(cp_context_t *context) {
+	cpi_symbol_cache_t *cache = context->symbol_cache;
+	unsigned int i;
+	
+	assert(cpi_is_context_locked(context));
+	if (cache == NULL || cache->table == NULL) {
+		return;
+	}
+	for (i = 0; i < cache->table->size; i++) {
+		symbol_cache_entry_t *entry = cache->table->entries[i];
+		symbol_info_t *symbol_info;
+		hnode_t *node;
+		int num_refs;
+		
+		if (entry == NULL || (symbol_info = entry->symbol_info) == NULL) {
+			continue;
 		}
+		
+		// Convert references handed out by the cache into ordinary ones
+		cpi_atomic_store(&entry->valid, 0);
+		num_refs = cpi_atomic_load(&entry->num_refs);
+		symbol_info->usage_count += num_refs;
+		symbol_info->provider_info->usage_count += num_refs;
+		
+		// Release the usage held by the entry
+		entry->symbol_info = NULL;
+		symbol_info->cache_entry = NULL;
+		node = hash_lookup(context->resolved_symbols, entry->symbol);
+		assert(node != NULL);
+		release_symbol(context, node);
+	}
+	rebuild_symbol_cache(cache, NULL);
+}
 
-		// Look up the symbol defining plug-in
-		node = hash_lookup(context->env->plugins, id);
-		if (node == NULL) {
+CP_HIDDEN void cpi_free_symbol_cache(cp_context_t *context) {
+	cpi_symbol_cache_t *cache = context->symbol_cache;
+	symbol_cache_table_t *table;
+	
+	if (cache == NULL) {
+		return;
+	}
+#ifndef NDEBUG
+	{
+		int i;
+		
+		for (i = 0; i < CP_SYMBOL_CACHE_SLOTS; i++) {
+			assert(cache->slots[i].epoch == 0);
+		}
+	}
+#endif
+	if ((table = cache->table) != NULL) {
+		unsigned int i;
+		
+		for (i = 0; i < table->size; i++) {
+			if (table->entries[i] != NULL) {
+				table->entries[i]->symbol_info = NULL;
+			}
+		}
+		cache->table = NULL;
+		retire_symbol_cache_table(cache, table);
+	}
+	reclaim_symbol_cache(cache);
+	assert(cache->retired_tables == NULL && cache->retired_entries == NULL);
+	cpi_free(cache);
+	context->symbol_cache = NULL;
+}
+
+#endif
+
+/**
+ * Releases a usage of the specified symbol. The caller must have locked
+ * the context.
+ * 
+ * @param context the plug-in context
+ * @param ptr the symbol
+ */
+static void release_symbol_ptr(cp_context_t *context, const void *ptr) {
+	hnode_t *node;
+#ifdef CP_SYMBOL_CACHE
+	symbol_info_t *symbol_info;
+#endif
+
+	// Look up the symbol
+	if (context->resolved_symbols == NULL
+		|| (node = hash_lookup(context->resolved_symbols, ptr)) == NULL) {
+		cpi_errorf(context, N_("Could not release unknown symbol at address %p."), ptr);
+		return;
+	}
+	cpi_trace(context, symbol_release, CP_TRACE_SYMBOL_RELEASE, ((symbol_info_t *) hnode_get(node))->provider_info->plugin->plugin->identifier, NULL, CP_OK);
+	
+#ifdef CP_SYMBOL_CACHE
+	/*
+	 * References are interchangeable. If only the usage held by the
+	 * cache entry remains then the reference being released was handed
+	 * out by the cache.
+	 */
+	symbol_info = hnode_get(node);
+	if (symbol_info->cache_entry != NULL) {
+		if (symbol_info->usage_count == 1) {
+			cpi_atomic_dec(&symbol_info->cache_entry->num_refs);
+		} else {
+			release_symbol(context, node);
+		}
+		uncache_symbol(context, node);
+		return;
+	}
+#endif
+
+	// Release the symbol
+	release_symbol(context, node);
+}
+
+/**
+ * Looks up the symbol providing plug-in, makes sure it has been started and
+ * initializes the symbol hashes of the context, if necessary. The caller
+ * must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param id the plug-in identifier
+ * @param name the symbol name for error messages, or NULL for several symbols
+ * @param ppptr filled with the providing plug-in
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+static cp_status_t prepare_symbol_provider(cp_context_t *context, const char *id, const char *name, cp_plugin_t **ppptr) {
+	cpi_invocation_t lifecycle;
+	cp_status_t status = CP_OK;
+	cp_plugin_t *pp;
+	
+	// Allocate space for symbol hashes, if necessary
+	if (context->resolved_symbols == NULL) {
+		context->resolved_symbols = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
+	}
+	if (context->symbol_providers == NULL) {
+		context->symbol_providers = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
+	}
+	if (context->resolved_symbols == NULL
+		|| context->symbol_providers == NULL) {
+		if (name != NULL) {
+			cpi_errorf(context, N_("Symbol %s in plug-in %s could not be resolved due to insufficient memory."), name, id);
+		} else {
+			cpi_errorf(context, N_("Symbols in plug-in %s could not be resolved due to insufficient memory."), id);
+		}
+		return CP_ERR_RESOURCE;
+	}
+
+	// Look up the symbol defining plug-in
+	if ((pp = cpi_hmap_get(context->env->plugins, id)) == NULL) {
+		if (name != NULL) {
 			cpi_warnf(context, N_("Symbol %s in unknown plug-in %s could not be resolved."), name, id);
-			status = CP_ERR_UNKNOWN;
-			break;
+		} else {
+			cpi_warnf(context, N_("Symbols in unknown plug-in %s could not be resolved."), id);
 		}
-		pp = hnode_get(node);
+		return CP_ERR_UNKNOWN;
+	}
 
-		// Make sure the plug-in has been started
-		if ((status = cpi_start_plugin(context, pp)) != CP_OK) {
+	// Make sure the plug-in has been started, looking it up again if
+	// the context lock was released while waiting for the lifecycle lock
+	if (pp->state != CP_PLUGIN_ACTIVE) {
+		cpi_begin_lifecycle(context, &lifecycle);
+		if ((pp = cpi_hmap_get(context->env->plugins, id)) != NULL) {
+			status = cpi_start_plugin(context, pp);
+		} else {
+			status = CP_ERR_UNKNOWN;
+		}
+		cpi_end_lifecycle(context, &lifecycle);
+	}
+	if (status != CP_OK) {
+		if (name != NULL) {
 			cpi_errorf(context, N_("Symbol %s in plug-in %s could not be resolved because the plug-in could not be started."), name, id);
-			error_reported = 1;
-			break;
+		} else {
+			cpi_errorf(context, N_("Symbols in plug-in %s could not be resolved because the plug-in could not be started."), id);
 		}
+		return status;
+	}
+	
+	*ppptr = pp;
+	return CP_OK;
+}
+
+/**
+ * Looks up a symbol in a static symbol export table using binary search.
+ * 
+ * @param table the symbol export table
+ * @param name the name of the symbol
+ * @return the symbol or NULL if not exported by the table
+ */
+static void *lookup_exported_symbol(const cp_symbol_table_t *table, const char *name) {
+	unsigned int lo = 0, hi = table->num_symbols;
+	
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		int cmp = strcmp(name, table->symbols[mid].name);
+		
+		if (cmp == 0) {
+			return table->symbols[mid].ptr;
+		} else if (cmp < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Resolves a symbol provided by a started plug-in and records the usage.
+ * The caller must have locked the context and prepared the provider using
+ * ::prepare_symbol_provider.
+ * 
+ * @param context the plug-in context
+ * @param pp the symbol providing plug-in
+ * @param key the symbol key
+ * @param symbolptr filled with the symbol
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+static cp_status_t resolve_symbol(cp_context_t *context, cp_plugin_t *pp, const cp_symbol_key_t *key, void **symbolptr) {
+	cp_status_t status = CP_OK;
+	const char *name = key->name;
+	hnode_t *node;
+	void *symbol = NULL;
+	symbol_info_t *symbol_info = NULL;
+	symbol_provider_info_t *provider_info = NULL;
+	const char *id = pp->plugin->identifier;
+
+	do {
 
 		// Check for a context specific symbol
-		if (pp->defined_symbols != NULL && (node = hash_lookup(pp->defined_symbols, name)) != NULL) {
+		if (pp->defined_symbols != NULL && (node = hash_lookup_hashed(pp->defined_symbols, name, key->hash)) != NULL) {
 			symbol = hnode_get(node);
 		}
 
+		// Check the static symbol export table
+		if (symbol == NULL && pp->symbol_table != NULL) {
+			symbol = lookup_exported_symbol(pp->symbol_table, name);
+		}
+
 		// Fall back to global symbols, if necessary
 		if (symbol == NULL && pp->runtime_lib != NULL) {
 			symbol = DLSYM(pp->runtime_lib, name);
@@ -200,13 +977,13 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 		if ((node = hash_lookup(context->symbol_providers, pp)) != NULL) {
 			provider_info = hnode_get(node);
 		} else {
-			if ((provider_info = malloc(sizeof(symbol_provider_info_t))) == NULL) {
+			if ((provider_info = cpi_malloc(sizeof(symbol_provider_info_t))) == NULL) {
 				status = CP_ERR_RESOURCE;
 				break;
 			}
 			memset(provider_info, 0, sizeof(symbol_provider_info_t));
 			provider_info->plugin = pp;
-			provider_info->imported = (context->plugin == NULL || cpi_ptrset_contains(context->plugin->imported, pp));
+			provider_info->imported = (context->plugin == NULL || cpi_plugin_set_contains(&context->plugin->imported, pp));
 			if (!hash_alloc_insert(context->symbol_providers, pp, provider_info)) {
 				status = CP_ERR_RESOURCE;
 				break;
@@ -217,7 +994,7 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 		if ((node = hash_lookup(context->resolved_symbols, symbol)) != NULL) {
 			symbol_info = hnode_get(node);
 		} else {
-			if ((symbol_info = malloc(sizeof(symbol_info_t))) == NULL) {
+			if ((symbol_info = cpi_malloc(sizeof(symbol_info_t))) == NULL) {
 				status = CP_ERR_RESOURCE;
 				break;
 			}
@@ -233,12 +1010,12 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 		if (provider_info != NULL
 			&& !provider_info->imported
 			&& provider_info->usage_count == 0) {
-			if (!cpi_ptrset_add(context->plugin->imported, pp)) {
+			if (!cpi_plugin_set_add(&context->plugin->imported, pp)) {
 				status = CP_ERR_RESOURCE;
 				break;
 			}
-			if (!cpi_ptrset_add(pp->importing, context->plugin)) {
-				cpi_ptrset_remove(context->plugin->imported, pp);
+			if (!cpi_plugin_set_add(&pp->importing, context->plugin)) {
+				cpi_plugin_set_remove(&context->plugin->imported, pp);
 				status = CP_ERR_RESOURCE;
 				break;
 			}
@@ -248,6 +1025,11 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 		// Increase usage counts
 		symbol_info->usage_count++;
 		provider_info->usage_count++;
+		
+#ifdef CP_SYMBOL_CACHE
+		// Serve further resolutions from the symbol cache
+		cache_symbol(context, id, key, symbol, symbol_info);
+#endif
 
 		if (cpi_is_logged(context, CP_LOG_DEBUG)) {
 			char owner[64];
@@ -261,19 +1043,62 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 		if ((node = hash_lookup(context->resolved_symbols, symbol)) != NULL) {
 			hash_delete_free(context->resolved_symbols, node);
 		}
-		free(symbol_info);
+		cpi_free(symbol_info);
 	}
 	if (provider_info != NULL && provider_info->usage_count == 0) {
 		if ((node = hash_lookup(context->symbol_providers, pp)) != NULL) {
 			hash_delete_free(context->symbol_providers, node);
 		}
-		free(provider_info);
+		cpi_free(provider_info);
 	}
 
 	// Report insufficient memory error
-	if (status == CP_ERR_RESOURCE && !error_reported) {
+	if (status == CP_ERR_RESOURCE) {
 		cpi_errorf(context, N_("Symbol %s in plug-in %s could not be resolved due to insufficient memory."), name, id);
 	}
+	cpi_trace(context, symbol_resolve, CP_TRACE_SYMBOL_RESOLVE, id, name, status);
+	
+	*symbolptr = (status == CP_OK ? symbol : NULL);
+	return status;
+}
+
+/**
+ * Resolves a symbol using the symbol cache, if possible, and otherwise the
+ * normal way.
+ * 
+ * @param context the plug-in context
+ * @param id the plug-in identifier
+ * @param key the symbol key
+ * @param error filled with the status code, or NULL
+ * @param func the name of the calling API function
+ * @return the symbol or NULL on failure
+ */
+static void *resolve_symbol_by_key(cp_context_t *context, const char *id, const cp_symbol_key_t *key, cp_status_t *error, const char *func) {
+	cp_status_t status;
+	void *symbol = NULL;
+	cp_plugin_t *pp;
+
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER | CPI_CF_STOP, func);
+#ifdef CP_SYMBOL_CACHE
+	// Try the symbol cache first
+	if ((symbol = resolve_cached_symbol(context, id, key)) != NULL) {
+		if (error != NULL) {
+			*error = CP_OK;
+		}
+		return symbol;
+	}
+#endif
+	
+	// Resolve the symbol, attributing the hold to the API function
+	cpi_lock_context(context);
+#ifdef CP_THREADS
+	if (context->env->lock_stats != NULL) {
+		cpi_set_mutex_holder(context->env->mutex, func);
+	}
+#endif
+	if ((status = prepare_symbol_provider(context, id, key->name, &pp)) == CP_OK) {
+		status = resolve_symbol(context, pp, key, &symbol);
+	}
 	cpi_unlock_context(context);
 
 	// Return error code
@@ -285,56 +1110,117 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 	return symbol;
 }
 
-CP_C_API void cp_release_symbol(cp_context_t *context, const void *ptr) {
-	hnode_t *node;
-	symbol_info_t *symbol_info;
-	symbol_provider_info_t *provider_info;
+CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const char *name, cp_status_t *error) {
+	cp_symbol_key_t key;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+	CHECK_NOT_NULL(name);
 	
+	key.name = name;
+	key.hash = hash_fun_string(name);
+	return resolve_symbol_by_key(context, id, &key, error, __func__);
+}
+
+CP_C_API void * cp_resolve_symbol_by_key(cp_context_t *context, const char *id, const cp_symbol_key_t *key, cp_status_t *error) {
 	CHECK_NOT_NULL(context);
-	CHECK_NOT_NULL(ptr);
+	CHECK_NOT_NULL(id);
+	CHECK_NOT_NULL(key);
+	CHECK_NOT_NULL(key->name);
+	
+	return resolve_symbol_by_key(context, id, key, error, __func__);
+}
 
+CP_C_API cp_status_t cp_symbol_key(cp_context_t *context, const char *name, cp_symbol_key_t *key) {
+	cp_status_t status = CP_OK;
+	const char *n;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(name);
+	CHECK_NOT_NULL(key);
+	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
-	do {
-
-		// Look up the symbol
-		if ((node = hash_lookup(context->resolved_symbols, ptr)) == NULL) {
-			cpi_errorf(context, N_("Could not release unknown symbol at address %p."), ptr);
-			break;
-		}
-		symbol_info = hnode_get(node);
-		provider_info = symbol_info->provider_info;
+	if ((n = cpi_intern_string(context, name)) != NULL) {
+		key->name = n;
+		key->hash = hash_fun_string(n);
+	} else {
+		cpi_errorf(context, N_("Symbol key for %s could not be created due to insufficient memory."), name);
+		status = CP_ERR_RESOURCE;
+	}
+	cpi_unlock_context(context);
 	
-		// Decrease usage count
-		assert(symbol_info->usage_count > 0);
-		symbol_info->usage_count--;
-		assert(provider_info->usage_count > 0);
-		provider_info->usage_count--;
+	return status;
+}
+
+CP_C_API int cp_resolve_symbols(cp_context_t *context, const char *id, const char * const *names, void **ptrs, int n, cp_status_t *error) {
+	cp_status_t status;
+	cp_plugin_t *pp;
+	int i = 0;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+	CHECK_NOT_NULL(names);
+	CHECK_NOT_NULL(ptrs);
 	
-		// Check if the symbol is not being used anymore
-		if (symbol_info->usage_count == 0) {
-			hash_delete_free(context->resolved_symbols, node);
-			free(symbol_info);
-			if (cpi_is_logged(context, CP_LOG_DEBUG)) {
-				char owner[64];
-				/* TRANSLATORS: First %s is the context owner */
-				cpi_debugf(context, N_("%s released the symbol at address %p defined by plug-in %s."), cpi_context_owner(context, owner, sizeof(owner)), ptr, provider_info->plugin->plugin->identifier);
+	// Resolve the symbols
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER | CPI_CF_STOP, __func__);
+	if ((status = prepare_symbol_provider(context, id, NULL, &pp)) == CP_OK) {
+		for (i = 0; i < n; i++) {
+			cp_symbol_key_t key;
+			
+			key.name = names[i];
+			key.hash = hash_fun_string(names[i]);
+			if ((status = resolve_symbol(context, pp, &key, ptrs + i)) != CP_OK) {
+				break;
 			}
 		}
+	}
 	
-		// Check if the symbol providing plug-in is not being used anymore
-		if (provider_info->usage_count == 0) {
-			node = hash_lookup(context->symbol_providers, provider_info->plugin);
-			assert(node != NULL);
-			hash_delete_free(context->symbol_providers, node);
-			if (!provider_info->imported) {
-				cpi_ptrset_remove(context->plugin->imported, provider_info->plugin);
-				cpi_ptrset_remove(provider_info->plugin->importing, context->plugin);
-				cpi_debugf(context, N_("A dynamic dependency from plug-in %s to plug-in %s was removed."), context->plugin->plugin->identifier, provider_info->plugin->plugin->identifier);
-			}
-			free(provider_info);
+	// Release the symbols already resolved on failure
+	if (status != CP_OK) {
+		while (i > 0) {
+			i--;
+			release_symbol_ptr(context, ptrs[i]);
 		}
-		
-	} while (0);
+		for (i = 0; i < n; i++) {
+			ptrs[i] = NULL;
+		}
+		i = 0;
+	}
+	cpi_unlock_context(context);
+
+	// Return error code
+	if (error != NULL) {
+		*error = status;
+	}
+	
+	return i;
+}
+
+CP_C_API void cp_release_symbol(cp_context_t *context, const void *ptr) {
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(ptr);
+
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	release_symbol_ptr(context, ptr);
+	cpi_unlock_context(context);
+}
+
+CP_C_API void cp_release_symbols(cp_context_t *context, void * const *ptrs, int n) {
+	int i;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(ptrs);
+
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	for (i = 0; i < n; i++) {
+		if (ptrs[i] != NULL) {
+			release_symbol_ptr(context, ptrs[i]);
+		}
+	}
 	cpi_unlock_context(context);
 }
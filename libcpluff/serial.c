@@ -32,6 +32,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include "cpluff.h"
+#include "defines.h"
+#include "util.h"
 #include "internal.h"
 
 
@@ -48,18 +50,301 @@ typedef struct run_func_t {
 	/// The registering plug-in instance
 	cp_plugin_t *plugin;
 	
-	/// Whether currently in execution
-	int in_execution;
+	/// The monotonic time in nanoseconds when a delayed run function is due
+	unsigned long long due;
 	
 } run_func_t;
 
-CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+// Registered run functions
+
+CP_HIDDEN int cpi_comp_run_func(const void *rf1, const void *rf2) {
+	const run_func_t *r1 = rf1;
+	const run_func_t *r2 = rf2;
+	
+	return !(r1->runfunc == r2->runfunc && r1->plugin == r2->plugin);
+}
+
+CP_HIDDEN hash_val_t cpi_hashfunc_run_func(const void *rf) {
+	const run_func_t *r = rf;
+	
+	return cpi_hashfunc_ptr(r->plugin) * 31 + (hash_val_t) (size_t) r->runfunc;
+}
+
+CP_HIDDEN void cpi_run_func_memory(cp_plugin_env_t *env, cp_plugin_t *plugin, cp_memory_stats_t *stats) {
+	hscan_t scan;
+	hnode_t *hnode;
+	
+	hash_scan_begin(&scan, env->run_funcs);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		const run_func_t *rf = hnode_getkey(hnode);
+		
+		if (rf->plugin == plugin) {
+			stats->run_funcs++;
+			stats->run_func_bytes += sizeof(hnode_t) + sizeof(lnode_t) + sizeof(run_func_t);
+		}
+	}
+}
+
+/**
+ * Unregisters a run function which is not in any queue and releases it.
+ * The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param node the list node of the run function
+ */
+static void unregister_run_function(cp_context_t *ctx, lnode_t *node) {
+	run_func_t *rf = lnode_get(node);
+	hnode_t *hnode;
+	
+	hnode = hash_lookup(ctx->env->run_funcs, rf);
+	assert(hnode != NULL);
+	hash_delete_free(ctx->env->run_funcs, hnode);
+	lnode_destroy(node);
+	cpi_free(rf);
+}
+
+/**
+ * Takes the next waiting run function from the round-robin queue of
+ * plug-ins. The run queue of the plug-in is moved to the back of the
+ * round-robin queue if it has more waiting run functions. The caller must
+ * have locked the context and there must be a waiting run function.
+ * 
+ * @param ctx the plug-in context
+ * @return the list node of the run function
+ */
+static lnode_t *take_waiting_run_function(cp_context_t *ctx) {
+	lnode_t *qnode = list_first(ctx->env->run_queue);
+	cp_plugin_t *plugin = lnode_get(qnode);
+	lnode_t *node;
+	
+	assert(!list_isempty(&plugin->run_wait));
+	node = list_del_first(&plugin->run_wait);
+	list_delete(ctx->env->run_queue, qnode);
+	if (!list_isempty(&plugin->run_wait)) {
+		list_append(ctx->env->run_queue, qnode);
+	}
+	return node;
+}
+
+
+// Delayed run functions
+
+/**
+ * Returns the due time of a delayed run function.
+ * 
+ * @param node the list node of the run function
+ * @return the due time
+ */
+static unsigned long long due_time(lnode_t *node) {
+	return ((run_func_t *) lnode_get(node))->due;
+}
+
+/**
+ * Moves the delayed run function at the specified heap position towards
+ * the root until the heap order is restored.
+ * 
+ * @param env the plug-in environment
+ * @param i the heap position
+ */
+static void sift_up_delayed(cp_plugin_env_t *env, unsigned int i) {
+	lnode_t *node = env->run_delayed[i];
+	
+	while (i > 0 && due_time(env->run_delayed[(i - 1) / 2]) > due_time(node)) {
+		env->run_delayed[i] = env->run_delayed[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	env->run_delayed[i] = node;
+}
+
+/**
+ * Moves the delayed run function at the specified heap position towards
+ * the leaves until the heap order is restored.
+ * 
+ * @param env the plug-in environment
+ * @param i the heap position
+ */
+static void sift_down_delayed(cp_plugin_env_t *env, unsigned int i) {
+	lnode_t *node = env->run_delayed[i];
+	unsigned int n = env->num_run_delayed;
+	
+	while (2 * i + 1 < n) {
+		unsigned int c = 2 * i + 1;
+		
+		if (c + 1 < n && due_time(env->run_delayed[c + 1]) < due_time(env->run_delayed[c])) {
+			c++;
+		}
+		if (due_time(env->run_delayed[c]) >= due_time(node)) {
+			break;
+		}
+		env->run_delayed[i] = env->run_delayed[c];
+		i = c;
+	}
+	env->run_delayed[i] = node;
+}
+
+/**
+ * Makes sure that the delayed run function heap can hold all registered
+ * run functions and one more, so that rescheduling a run function never
+ * fails. The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE
+ */
+static cp_status_t reserve_delayed(cp_context_t *ctx) {
+	cp_plugin_env_t *env = ctx->env;
+	unsigned int n = hash_count(env->run_funcs) + 1;
+	
+	if (n > env->max_run_delayed) {
+		unsigned int max = (env->max_run_delayed > 0 ? env->max_run_delayed : 8);
+		lnode_t **heap;
+		
+		while (max < n) {
+			max *= 2;
+		}
+		if ((heap = cpi_realloc(env->run_delayed, max * sizeof(lnode_t *))) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		env->run_delayed = heap;
+		env->max_run_delayed = max;
+	}
+	return CP_OK;
+}
+
+/**
+ * Schedules a run function which is not in any queue. The run function is
+ * appended to the waiting run functions of the plug-in if there is no delay
+ * and otherwise added to the delayed run functions. The caller must have
+ * locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param node the list node of the run function
+ * @param delay the delay in microseconds
+ */
+static void schedule_run_function(cp_context_t *ctx, lnode_t *node, unsigned long delay) {
+	cp_plugin_env_t *env = ctx->env;
+	
+	run_func_t *rf = lnode_get(node);
+	
+	if (delay == 0) {
+		cp_plugin_t *plugin = rf->plugin;
+		
+		list_append(&plugin->run_wait, node);
+		if (!lnode_is_in_a_list(&plugin->run_queue_node)) {
+			list_append(env->run_queue, &plugin->run_queue_node);
+		}
+	} else {
+		assert(env->num_run_delayed < env->max_run_delayed);
+		rf->due = cpi_monotonic_time() + delay * 1000ULL;
+		env->run_delayed[env->num_run_delayed++] = node;
+		sift_up_delayed(env, env->num_run_delayed - 1);
+	}
+}
+
+/**
+ * Moves the delayed run functions that are due to the waiting run
+ * functions. The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ */
+static void promote_due_run_functions(cp_context_t *ctx) {
+	cp_plugin_env_t *env = ctx->env;
+	unsigned long long now;
+	
+	if (env->num_run_delayed == 0) {
+		return;
+	}
+	now = cpi_monotonic_time();
+	while (env->num_run_delayed > 0 && due_time(env->run_delayed[0]) <= now) {
+		lnode_t *node = env->run_delayed[0];
+		
+		if (--env->num_run_delayed > 0) {
+			env->run_delayed[0] = env->run_delayed[env->num_run_delayed];
+			sift_down_delayed(env, 0);
+		}
+		schedule_run_function(ctx, node, 0);
+	}
+}
+
+/**
+ * Returns the time until the next delayed run function is due. The caller
+ * must have locked the context and there must be a delayed run function.
+ * 
+ * @param ctx the plug-in context
+ * @return the time in nanoseconds, zero if already due
+ */
+static unsigned long long next_run_delay(cp_context_t *ctx) {
+	unsigned long long due = due_time(ctx->env->run_delayed[0]);
+	unsigned long long now = cpi_monotonic_time();
+	
+	return (due > now ? due - now : 0);
+}
+
+/**
+ * Removes the delayed run functions of the specified plug-in. The caller
+ * must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param plugin the plug-in
+ */
+static void remove_delayed_run_functions(cp_context_t *ctx, cp_plugin_t *plugin) {
+	cp_plugin_env_t *env = ctx->env;
+	unsigned int i, n;
+	
+	for (i = 0, n = 0; i < env->num_run_delayed; i++) {
+		lnode_t *node = env->run_delayed[i];
+		run_func_t *rf = lnode_get(node);
+		
+		if (rf->plugin == plugin) {
+			unregister_run_function(ctx, node);
+		} else {
+			env->run_delayed[n++] = node;
+		}
+	}
+	if (n < env->num_run_delayed) {
+		
+		// Restore the heap order
+		env->num_run_delayed = n;
+		for (i = n / 2; i > 0; i--) {
+			sift_down_delayed(env, i - 1);
+		}
+	}
+}
+
+/**
+ * Returns whether the specified run function is registered, either in a
+ * queue, among the delayed run functions or currently executing.
+ * 
+ * @param ctx the plug-in context of the registering plug-in
+ * @param runfunc the run function
+ * @return whether the run function is registered
+ */
+static int is_run_function_registered(cp_context_t *ctx, cp_run_func_t runfunc) {
+	run_func_t key;
+	
+	key.runfunc = runfunc;
+	key.plugin = ctx->plugin;
+	return hash_lookup(ctx->env->run_funcs, &key) != NULL;
+}
+
+/**
+ * Registers a new run function to be called after the specified delay.
+ * 
+ * @param ctx the plug-in context of the registering plug-in
+ * @param runfunc the run function to be registered
+ * @param delay the delay in microseconds
+ * @param func the name of the API function being called
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+static cp_status_t register_run_function(cp_context_t *ctx, cp_run_func_t runfunc, unsigned long delay, const char *func) {
 	lnode_t *node = NULL;
 	run_func_t *rf = NULL;
 	cp_status_t status = CP_OK;
 	
-	CHECK_NOT_NULL(ctx);
-	CHECK_NOT_NULL(runfunc);
 	if (ctx->plugin == NULL) {
 		cpi_fatalf(_("Only plug-ins can register run functions."));
 	}
@@ -69,26 +354,19 @@ CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
 	}
 	
 	cpi_lock_context(ctx);
-	cpi_check_invocation(ctx, CPI_CF_STOP | CPI_CF_LOGGER, __func__);
+	cpi_check_invocation(ctx, CPI_CF_STOP | CPI_CF_LOGGER, func);
 	do {
-		int found = 0;
-		lnode_t *n;
 	
 		// Check if already registered
-		n = list_first(ctx->env->run_funcs);
-		while (n != NULL && !found) {
-			run_func_t *r = lnode_get(n);
-			if (runfunc == r->runfunc && ctx->plugin == r->plugin) {
-				found = 1;
-			}
-			n = list_next(ctx->env->run_funcs, n);
-		}
-		if (found) {
+		if (is_run_function_registered(ctx, runfunc)) {
 			break;
 		}
 
 		// Allocate memory for a new run function entry
-		if ((rf = malloc(sizeof(run_func_t))) == NULL) {
+		if ((status = reserve_delayed(ctx)) != CP_OK) {
+			break;
+		}
+		if ((rf = cpi_malloc(sizeof(run_func_t))) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -101,12 +379,14 @@ CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
 		memset(rf, 0, sizeof(run_func_t));
 		rf->runfunc = runfunc;
 		rf->plugin = ctx->plugin;
-		
-		// Append the run function to queue
-		list_append(ctx->env->run_funcs, node);
-		if (ctx->env->run_wait == NULL) {
-			ctx->env->run_wait = node;
+		if (!hash_alloc_insert(ctx->env->run_funcs, rf, node)) {
+			status = CP_ERR_RESOURCE;
+			break;
 		}
+		
+		// Schedule the run function and wake up idle runners
+		schedule_run_function(ctx, node, delay);
+		cpi_signal_context(ctx);
 
 	} while (0);
 
@@ -122,15 +402,91 @@ CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
 			lnode_destroy(node);
 		}
 		if (rf != NULL) {
-			free(rf);
+			cpi_free(rf);
 		}
 	}
 	
 	return status;
 }
 
+CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(runfunc);
+	return register_run_function(ctx, runfunc, 0, __func__);
+}
+
+CP_C_API cp_status_t cp_run_function_after(cp_context_t *ctx, cp_run_func_t runfunc, unsigned long delay_us) {
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(runfunc);
+	return register_run_function(ctx, runfunc, delay_us, __func__);
+}
+
+/**
+ * Runs the next waiting run function. The run function is not in any queue
+ * for the duration of the call so that no other thread executes it
+ * concurrently. The caller must have locked the context exactly once and
+ * there must be a waiting run function.
+ * 
+ * @param ctx the plug-in context
+ */
+static void run_next(cp_context_t *ctx) {
+	lnode_t *node = take_waiting_run_function(ctx);
+	run_func_t *rf = lnode_get(node);
+	cp_plugin_t *plugin = rf->plugin;
+	int rerun;
+	
+	assert(cpi_is_context_locked(ctx));
+	plugin->num_run_executing++;
+	ctx->env->num_run_executing++;
+	cpi_trace(ctx, run_begin, CP_TRACE_RUN_BEGIN, plugin->plugin->identifier, NULL, CP_OK);
+	cpi_unlock_context(ctx);
+	rerun = rf->runfunc(plugin->plugin_data);
+	cpi_lock_context(ctx);
+	cpi_trace(ctx, run_end, CP_TRACE_RUN_END, plugin->plugin->identifier, NULL, CP_OK);
+	plugin->num_run_executing--;
+	ctx->env->num_run_executing--;
+	if (rerun) {
+		
+		// Negative values request a delay, see CP_RUN_AFTER
+		schedule_run_function(ctx, node, rerun < 0 ? (unsigned long) -(rerun + 1) : 0);
+		
+	} else {
+		unregister_run_function(ctx, node);
+	}
+	cpi_signal_context(ctx);
+}
+
+/**
+ * Runs waiting run functions until there are neither waiting nor delayed
+ * run functions left, sleeping until the next delayed run function is due
+ * if there is nothing else to do. Optionally also waits for the run
+ * functions being executed by other threads because they may be rerun.
+ * The caller must have locked the context exactly once.
+ * 
+ * @param ctx the plug-in context
+ * @param wait_executing whether to wait for run functions executed by other threads
+ */
+static void run_all(cp_context_t *ctx, int wait_executing) {
+	assert(cpi_is_context_locked(ctx));
+	for (;;) {
+		promote_due_run_functions(ctx);
+		if (!list_isempty(ctx->env->run_queue)) {
+			run_next(ctx);
+		} else if (ctx->env->num_run_delayed > 0) {
+			cpi_wait_context_timed(ctx, next_run_delay(ctx));
+		} else if (wait_executing && ctx->env->num_run_executing > 0) {
+			cpi_wait_context(ctx);
+		} else {
+			break;
+		}
+	}
+}
+
 CP_C_API void cp_run_plugins(cp_context_t *ctx) {
-	while (cp_run_plugins_step(ctx));
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	run_all(ctx, 0);
+	cpi_unlock_context(ctx);
 }
 
 CP_C_API int cp_run_plugins_step(cp_context_t *ctx) {
@@ -138,68 +494,163 @@ CP_C_API int cp_run_plugins_step(cp_context_t *ctx) {
 	
 	CHECK_NOT_NULL(ctx);
 	cpi_lock_context(ctx);
-	if (ctx->env->run_wait != NULL) {
-		lnode_t *node = ctx->env->run_wait;
-		run_func_t *rf = lnode_get(node);
-		int rerun;
+	promote_due_run_functions(ctx);
+	if (!list_isempty(ctx->env->run_queue)) {
+		run_next(ctx);
+	}
+	runnables = (!list_isempty(ctx->env->run_queue) || ctx->env->num_run_delayed > 0);
+	cpi_unlock_context(ctx);
+	return runnables;
+}
+
+CP_C_API int cp_run_plugins_for(cp_context_t *ctx, unsigned long budget_us) {
+	unsigned long long deadline;
+	int runnables;
+	
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	deadline = cpi_monotonic_time() + budget_us * 1000ULL;
+	do {
+		promote_due_run_functions(ctx);
+		if (list_isempty(ctx->env->run_queue)) {
+			break;
+		}
+		run_next(ctx);
+	} while (cpi_monotonic_time() < deadline);
+	runnables = (!list_isempty(ctx->env->run_queue) || ctx->env->num_run_delayed > 0);
+	cpi_unlock_context(ctx);
+	return runnables;
+}
+
+CP_C_API int cp_run_plugins_wait(cp_context_t *ctx, long timeout_us) {
+	unsigned long long deadline = 0;
+	int runnables;
+	
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	if (timeout_us > 0) {
+		deadline = cpi_monotonic_time() + timeout_us * 1000ULL;
+	}
+	for (;;) {
+		unsigned long long timeout = 0;
 		
-		ctx->env->run_wait = list_next(ctx->env->run_funcs, node);
-		rf->in_execution = 1;
-		cpi_unlock_context(ctx);
-		rerun = rf->runfunc(rf->plugin->plugin_data);
-		cpi_lock_context(ctx);
-		rf->in_execution = 0;
-		list_delete(ctx->env->run_funcs, node);
-		if (rerun) {
-			list_append(ctx->env->run_funcs, node);
-			if (ctx->env->run_wait == NULL) {
-				ctx->env->run_wait = node;
+		promote_due_run_functions(ctx);
+		if (!list_isempty(ctx->env->run_queue) || timeout_us == 0) {
+			break;
+		}
+		
+		// Wait until the deadline or the next delayed run function is due
+		if (deadline != 0) {
+			unsigned long long now = cpi_monotonic_time();
+			
+			if (now >= deadline) {
+				break;
+			}
+			timeout = deadline - now;
+		}
+		if (ctx->env->num_run_delayed > 0) {
+			unsigned long long delay = next_run_delay(ctx);
+			
+			if (delay == 0) {
+				continue;
 			}
+			if (timeout == 0 || delay < timeout) {
+				timeout = delay;
+			}
+		}
+		if (timeout != 0) {
+			cpi_wait_context_timed(ctx, timeout);
 		} else {
-			lnode_destroy(node);
-			free(rf);
+#ifdef CP_THREADS
+			cpi_wait_context(ctx);
+#else
+			// No other thread could register a run function
+			break;
+#endif
 		}
-		cpi_signal_context(ctx);
 	}
-	runnables = (ctx->env->run_wait != NULL);
+	runnables = !list_isempty(ctx->env->run_queue);
 	cpi_unlock_context(ctx);
 	return runnables;
 }
 
+#ifdef CP_THREADS
+
+/**
+ * Helper thread main function for running plug-ins in parallel.
+ * 
+ * @param arg the plug-in context
+ */
+static void run_thread(void *arg) {
+	cp_context_t *ctx = arg;
+	
+	cpi_lock_context(ctx);
+	run_all(ctx, 1);
+	cpi_unlock_context(ctx);
+}
+
+#endif
+
+CP_C_API void cp_run_plugins_parallel(cp_context_t *ctx, int num_threads) {
+#ifdef CP_THREADS
+	cpi_thread_t **threads = NULL;
+	int n = 0;
+	int num_funcs;
+#endif
+	
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	
+#ifdef CP_THREADS
+	// Start the helper threads, they run once the context is unlocked
+	num_funcs = hash_count(ctx->env->run_funcs);
+	if (num_threads > num_funcs) {
+		num_threads = num_funcs;
+	}
+	if (num_threads > 1
+		&& (threads = cpi_malloc((num_threads - 1) * sizeof(cpi_thread_t *))) != NULL) {
+		for (; n < num_threads - 1; n++) {
+			if ((threads[n] = cpi_create_thread(run_thread, ctx)) == NULL) {
+				cpi_warn(ctx, N_("Could not create all threads for running plug-ins."));
+				break;
+			}
+		}
+	}
+#endif
+	
+	run_all(ctx, 1);
+	cpi_unlock_context(ctx);
+	
+#ifdef CP_THREADS
+	// Join the helper threads
+	while (n > 0) {
+		cpi_join_thread(threads[--n]);
+	}
+	cpi_free(threads);
+#endif
+}
+
 CP_HIDDEN void cpi_stop_plugin_run(cp_plugin_t *plugin) {
-	int stopped = 0;
 	cp_context_t *ctx;
 	
 	CHECK_NOT_NULL(plugin);
 	ctx = plugin->context;
 	assert(cpi_is_context_locked(ctx));
-	while (!stopped) {
-		lnode_t *node;
+	for (;;) {
 		
-		stopped = 1;
-		node = list_first(ctx->env->run_funcs);
-		while (node != NULL) {
-			run_func_t *rf = lnode_get(node);
-			lnode_t *next_node = list_next(ctx->env->run_funcs, node);
-			
-			if (rf->plugin == plugin) {
-				if (rf->in_execution) {
-					stopped = 0;
-				} else {
-					if (ctx->env->run_wait == node) {
-						ctx->env->run_wait = list_next(ctx->env->run_funcs, node);
-					}
-					list_delete(ctx->env->run_funcs, node);
-					lnode_destroy(node);
-					free(rf);
-				}
-			}
-			node = next_node;
+		// Unregister the waiting and delayed run functions
+		if (lnode_is_in_a_list(&plugin->run_queue_node)) {
+			list_delete(ctx->env->run_queue, &plugin->run_queue_node);
 		}
+		while (!list_isempty(&plugin->run_wait)) {
+			unregister_run_function(ctx, list_del_first(&plugin->run_wait));
+		}
+		remove_delayed_run_functions(ctx, plugin);
 		
 		// If some run functions were in execution, wait for them to finish
-		if (!stopped) {
-			cpi_wait_context(ctx);
+		if (plugin->num_run_executing == 0) {
+			break;
 		}
+		cpi_wait_context_yielding(ctx);
 	}
 }
@@ -43,6 +43,15 @@ extern "C" {
 // A generic mutex implementation 
 typedef struct cpi_mutex_t cpi_mutex_t;
 
+// A generic thread implementation
+typedef struct cpi_thread_t cpi_thread_t;
+
+// A generic thread-local storage slot
+typedef struct cpi_tls_t cpi_tls_t;
+
+// Lock statistics, defined in util.h
+struct cpi_lock_stats_t;
+
 
 /* ------------------------------------------------------------------------
  * Function declarations
@@ -64,14 +73,25 @@ CP_HIDDEN cpi_mutex_t * cpi_create_mutex(void);
  */
 CP_HIDDEN void cpi_destroy_mutex(cpi_mutex_t *mutex);
 
+/**
+ * Reinitializes a mutex in a child process after forking. The mutex must
+ * have been locked exclusively by the forking thread, which continues to
+ * hold it. The bookkeeping of the threads which do not exist in the child
+ * process is discarded.
+ * 
+ * @param mutex the mutex
+ */
+CP_HIDDEN void cpi_reset_mutex(cpi_mutex_t *mutex);
+
 /**
  * Waits for the specified mutex to become available and locks it.
  * If the calling thread has already locked the mutex then the
  * lock count of the mutex is increased.
  * 
  * @param mutex the mutex
+ * @return the time waited in nanoseconds, or zero if the mutex was available
  */
-CP_HIDDEN void cpi_lock_mutex(cpi_mutex_t *mutex);
+CP_HIDDEN unsigned long long cpi_lock_mutex(cpi_mutex_t *mutex);
 
 /**
  * Unlocks the specified mutex which must have been previously locked
@@ -83,6 +103,28 @@ CP_HIDDEN void cpi_lock_mutex(cpi_mutex_t *mutex);
  */
 CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex);
 
+/**
+ * Waits for the specified mutex to become available for shared access and
+ * locks it in shared mode. Several threads may hold the mutex in shared
+ * mode at the same time but not while some thread holds it exclusively.
+ * Threads waiting for exclusive access take precedence over new shared
+ * lockers. If the calling thread has already locked the mutex exclusively
+ * then the exclusive lock count is increased instead. A thread holding the
+ * mutex only in shared mode must not lock it again.
+ * 
+ * @param mutex the mutex
+ * @return the time waited in nanoseconds, or zero if the mutex was available
+ */
+CP_HIDDEN unsigned long long cpi_lock_mutex_shared(cpi_mutex_t *mutex);
+
+/**
+ * Unlocks the specified mutex which must have been previously locked
+ * by this thread using ::cpi_lock_mutex_shared.
+ * 
+ * @param mutex the mutex
+ */
+CP_HIDDEN void cpi_unlock_mutex_shared(cpi_mutex_t *mutex);
+
 /**
  * Waits on the specified mutex until it is signaled. The calling thread
  * must hold the mutex. The mutex is released on call to this function and
@@ -92,6 +134,16 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex);
  */
 CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex);
 
+/**
+ * Waits on the specified mutex until it is signaled or until the specified
+ * timeout has elapsed. Otherwise works like ::cpi_wait_mutex. The caller
+ * can not tell whether the mutex was signaled.
+ * 
+ * @param mutex the mutex to wait on
+ * @param timeout the timeout in nanoseconds
+ */
+CP_HIDDEN void cpi_wait_mutex_timed(cpi_mutex_t *mutex, unsigned long long timeout);
+
 /**
  * Signals the specified mutex waking all the threads currently waiting on
  * the mutex. The calling thread must hold the mutex. The mutex is not
@@ -101,10 +153,40 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex);
  */
 CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex);
 
+/**
+ * Attaches lock statistics to the specified mutex or detaches them. While
+ * attached, the statistics are updated on each outermost acquisition and
+ * release of the mutex. If the calling thread holds the mutex exclusively
+ * then timing of its hold begins immediately.
+ * 
+ * @param mutex the mutex
+ * @param stats the statistics to attach or NULL to detach
+ */
+CP_HIDDEN void cpi_set_mutex_stats(cpi_mutex_t *mutex, struct cpi_lock_stats_t *stats);
+
+/**
+ * Attributes the current exclusive hold of the specified mutex to the
+ * specified holder unless already attributed. Does nothing unless the
+ * calling thread holds the mutex exclusively and statistics are attached.
+ * 
+ * @param mutex the mutex
+ * @param holder the holder, typically an API function name
+ */
+CP_HIDDEN void cpi_set_mutex_holder(cpi_mutex_t *mutex, const char *holder);
+
+/**
+ * Copies the summary of the lock statistics attached to the specified
+ * mutex. The summary is zeroed if no statistics are attached.
+ * 
+ * @param mutex the mutex
+ * @param stats filled with the summary
+ */
+CP_HIDDEN void cpi_get_mutex_stats(cpi_mutex_t *mutex, cp_lock_stats_t *stats);
+
 #if !defined(NDEBUG)
 
 /**
- * Returns whether the mutex is currently locked. This function
+ * Returns whether the mutex is currently locked in either mode. This function
  * is only intended to be used for assertions. The returned state
  * reflects the state of the mutex only at the time of inspection.
  */
@@ -112,6 +194,86 @@ CP_HIDDEN int cpi_is_mutex_locked(cpi_mutex_t *mutex);
 
 #endif
 
+// Thread functions
+
+/**
+ * Creates a new thread executing the specified function. The function is
+ * passed the specified argument. The thread must be eventually joined using
+ * ::cpi_join_thread to release the associated resources.
+ * 
+ * @param func the function to be executed
+ * @param arg the argument to be passed to the function
+ * @return the created thread or NULL if no resources available
+ */
+CP_HIDDEN cpi_thread_t * cpi_create_thread(void (*func)(void *arg), void *arg) CP_GCC_NONNULL(1);
+
+/**
+ * Waits for the specified thread to terminate and releases the resources
+ * associated with it. The thread handle is not valid after this call.
+ * 
+ * @param thread the thread to join
+ */
+CP_HIDDEN void cpi_join_thread(cpi_thread_t *thread) CP_GCC_NONNULL(1);
+
+// Thread-local storage functions
+
+/**
+ * Creates a thread-local storage slot holding a pointer. The slot
+ * initially holds NULL for every thread.
+ * 
+ * @return the created slot or NULL if no resources available
+ */
+CP_HIDDEN cpi_tls_t * cpi_create_tls(void);
+
+/**
+ * Destroys the specified thread-local storage slot. Values stored by
+ * threads are not released.
+ * 
+ * @param tls the slot
+ */
+CP_HIDDEN void cpi_destroy_tls(cpi_tls_t *tls) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the value the calling thread has stored in the specified slot.
+ * 
+ * @param tls the slot
+ * @return the stored value or NULL if none
+ */
+CP_HIDDEN void * cpi_get_tls(cpi_tls_t *tls) CP_GCC_NONNULL(1);
+
+/**
+ * Stores a value in the specified slot for the calling thread.
+ * 
+ * @param tls the slot
+ * @param value the value to be stored
+ */
+CP_HIDDEN void cpi_set_tls(cpi_tls_t *tls, void *value) CP_GCC_NONNULL(1);
+
+// Atomic operations
+
+#ifdef HAVE_ATOMIC_BUILTINS
+
+/// Atomically loads the value at the specified address
+#define cpi_atomic_load(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+
+/// Atomically stores a value at the specified address
+#define cpi_atomic_store(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_SEQ_CST)
+
+/// Atomically increments the value at the specified address and returns the new value
+#define cpi_atomic_inc(ptr) __atomic_add_fetch((ptr), 1, __ATOMIC_SEQ_CST)
+
+/// Atomically decrements the value at the specified address and returns the new value
+#define cpi_atomic_dec(ptr) __atomic_sub_fetch((ptr), 1, __ATOMIC_SEQ_CST)
+
+/**
+ * Atomically replaces the value at the specified address with the desired
+ * value if it equals the expected value. Returns non-zero on success.
+ * Otherwise the current value is stored at the address of the expected value.
+ */
+#define cpi_atomic_cas(ptr, expected, desired) __atomic_compare_exchange_n((ptr), (expected), (desired), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+#endif //HAVE_ATOMIC_BUILTINS
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus 
@@ -33,7 +33,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
 #include <pthread.h>
+#if defined(HAVE_CLOCK_GETTIME)
+#include <time.h>
+#else
+#include <sys/time.h>
+#endif
 #include "cpluff.h"
 #include "defines.h"
 #include "util.h"
@@ -51,6 +57,12 @@ struct cpi_mutex_t {
 	/// The current lock count 
 	int lock_count;
 	
+	/// The number of threads holding the mutex in shared mode
+	int num_readers;
+	
+	/// The number of threads waiting to lock the mutex exclusively
+	int num_writers_waiting;
+	
 	/// The underlying operating system mutex 
 	pthread_mutex_t os_mutex;
 	
@@ -63,6 +75,31 @@ struct cpi_mutex_t {
 	/// The locking thread if currently locked 
 	pthread_t os_thread;
 	
+	/// The lock statistics or NULL if not collected
+	cpi_lock_stats_t *stats;
+	
+};
+
+// A generic thread implementation
+struct cpi_thread_t {
+
+	/// The underlying operating system thread
+	pthread_t os_thread;
+	
+	/// The function to be executed
+	void (*func)(void *arg);
+	
+	/// The argument for the function
+	void *arg;
+	
+};
+
+// A generic thread-local storage slot
+struct cpi_tls_t {
+	
+	/// The underlying thread-specific data key
+	pthread_key_t os_key;
+	
 };
 
 
@@ -73,7 +110,7 @@ struct cpi_mutex_t {
 CP_HIDDEN cpi_mutex_t * cpi_create_mutex(void) {
 	cpi_mutex_t *mutex;
 	
-	if ((mutex = malloc(sizeof(cpi_mutex_t))) == NULL) {
+	if ((mutex = cpi_malloc(sizeof(cpi_mutex_t))) == NULL) {
 		return NULL;
 	}
 	memset(mutex, 0, sizeof(cpi_mutex_t));
@@ -102,13 +139,27 @@ CP_HIDDEN void cpi_destroy_mutex(cpi_mutex_t *mutex) {
 	
 	assert(mutex != NULL);
 	assert(mutex->lock_count == 0);
+	assert(mutex->num_readers == 0);
 	ec = pthread_mutex_destroy(&(mutex->os_mutex));
 	assert(!ec);
 	ec = pthread_cond_destroy(&(mutex->os_cond_lock));
 	assert(!ec);
 	ec = pthread_cond_destroy(&(mutex->os_cond_wake));
 	assert(!ec);
-	free(mutex);
+	cpi_free(mutex);
+}
+
+CP_HIDDEN void cpi_reset_mutex(cpi_mutex_t *mutex) {
+	assert(mutex != NULL);
+	assert(mutex->lock_count > 0);
+	assert(mutex->num_readers == 0);
+	if (pthread_mutex_init(&(mutex->os_mutex), NULL)
+		|| pthread_cond_init(&(mutex->os_cond_lock), NULL)
+		|| pthread_cond_init(&(mutex->os_cond_wake), NULL)) {
+		cpi_fatalf(_("Could not reinitialize a mutex after forking."));
+	}
+	mutex->num_writers_waiting = 0;
+	mutex->os_thread = pthread_self();
 }
 
 static void lock_mutex(pthread_mutex_t *mutex) {
@@ -127,26 +178,84 @@ static void unlock_mutex(pthread_mutex_t *mutex) {
 	}
 }
 
-static void lock_mutex_holding(cpi_mutex_t *mutex) {
+/**
+ * Wakes up the threads waiting for the mutex to become available. The
+ * caller must hold the underlying operating system mutex.
+ * 
+ * @param mutex the mutex
+ */
+static void signal_available(cpi_mutex_t *mutex) {
+	int ec;
+	
+	if ((ec = pthread_cond_broadcast(&(mutex->os_cond_lock)))) {
+		cpi_fatalf(_("Could not broadcast a condition variable due to error %d."), ec);
+	}
+}
+
+/**
+ * Waits for the mutex to become available. The caller must hold the
+ * underlying operating system mutex.
+ * 
+ * @param mutex the mutex
+ */
+static void wait_available(cpi_mutex_t *mutex) {
+	int ec;
+	
+	if ((ec = pthread_cond_wait(&(mutex->os_cond_lock), &(mutex->os_mutex)))) {
+		cpi_fatalf(_("Could not wait for a condition variable due to error %d."), ec);
+	}
+}
+
+/**
+ * Locks the mutex exclusively, waiting for it to become available if
+ * necessary. The caller must hold the underlying operating system mutex.
+ * 
+ * @param mutex the mutex
+ * @return the time waited in nanoseconds, or zero if the mutex was available
+ */
+static unsigned long long lock_mutex_holding(cpi_mutex_t *mutex) {
 	pthread_t self = pthread_self();
+	unsigned long long begin = 0;
+	unsigned long long waited;
 	
-	while (mutex->lock_count != 0
-			&& !pthread_equal(self, mutex->os_thread)) {
-		int ec;
-		
-		if ((ec = pthread_cond_wait(&(mutex->os_cond_lock), &(mutex->os_mutex)))) {
-			cpi_fatalf(_("Could not wait for a condition variable due to error %d."), ec);
+	while ((mutex->lock_count != 0
+			&& !pthread_equal(self, mutex->os_thread))
+			|| mutex->num_readers != 0) {
+		if (begin == 0) {
+			begin = cpi_monotonic_time();
 		}
+		mutex->num_writers_waiting++;
+		wait_available(mutex);
+		mutex->num_writers_waiting--;
 	}
+	waited = (begin != 0 ? cpi_monotonic_time() - begin : 0);
 	mutex->os_thread = self;
-	mutex->lock_count++;
+	if (mutex->lock_count++ == 0 && mutex->stats != NULL) {
+		cpi_lock_stats_acquired(mutex->stats, waited, 1);
+	}
+	return waited;
 }
 
-CP_HIDDEN void cpi_lock_mutex(cpi_mutex_t *mutex) {
+/**
+ * Records the end of an exclusive hold if statistics are being collected.
+ * The caller must hold the underlying operating system mutex.
+ * 
+ * @param mutex the mutex
+ */
+static void released_exclusive(cpi_mutex_t *mutex) {
+	if (mutex->stats != NULL) {
+		cpi_lock_stats_released(mutex->stats);
+	}
+}
+
+CP_HIDDEN unsigned long long cpi_lock_mutex(cpi_mutex_t *mutex) {
+	unsigned long long waited;
+	
 	assert(mutex != NULL);
 	lock_mutex(&(mutex->os_mutex));
-	lock_mutex_holding(mutex);
+	waited = lock_mutex_holding(mutex);
 	unlock_mutex(&(mutex->os_mutex));
+	return waited;
 }
 
 CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
@@ -157,11 +266,60 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
 	if (mutex->lock_count > 0
 		&& pthread_equal(self, mutex->os_thread)) {
 		if (--mutex->lock_count == 0) {
-			int ec;
-			
-			if ((ec = pthread_cond_signal(&(mutex->os_cond_lock)))) {
-				cpi_fatalf(_("Could not signal a condition variable due to error %d."), ec);
+			released_exclusive(mutex);
+			signal_available(mutex);
+		}
+	} else {
+		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at unlocking a mutex."));
+	}
+	unlock_mutex(&(mutex->os_mutex));
+}
+
+CP_HIDDEN unsigned long long cpi_lock_mutex_shared(cpi_mutex_t *mutex) {
+	pthread_t self = pthread_self();
+	unsigned long long begin = 0;
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_mutex));
+	if (mutex->lock_count != 0
+		&& pthread_equal(self, mutex->os_thread)) {
+		
+		// Already locked exclusively by this thread
+		mutex->lock_count++;
+		
+	} else {
+		
+		// Let threads waiting for exclusive access go first
+		while (mutex->lock_count != 0 || mutex->num_writers_waiting != 0) {
+			if (begin == 0) {
+				begin = cpi_monotonic_time();
 			}
+			wait_available(mutex);
+		}
+		mutex->num_readers++;
+		if (mutex->stats != NULL) {
+			cpi_lock_stats_acquired(mutex->stats, (begin != 0 ? cpi_monotonic_time() - begin : 0), 0);
+		}
+		
+	}
+	unlock_mutex(&(mutex->os_mutex));
+	return (begin != 0 ? cpi_monotonic_time() - begin : 0);
+}
+
+CP_HIDDEN void cpi_unlock_mutex_shared(cpi_mutex_t *mutex) {
+	pthread_t self = pthread_self();
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_mutex));
+	if (mutex->lock_count > 0
+		&& pthread_equal(self, mutex->os_thread)) {
+		if (--mutex->lock_count == 0) {
+			released_exclusive(mutex);
+			signal_available(mutex);
+		}
+	} else if (mutex->num_readers > 0) {
+		if (--mutex->num_readers == 0) {
+			signal_available(mutex);
 		}
 	} else {
 		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at unlocking a mutex."));
@@ -169,7 +327,14 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(&(mutex->os_mutex));
 }
 
-CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+/**
+ * Waits on the specified mutex until it is signaled or, optionally, until
+ * the specified absolute time has passed.
+ * 
+ * @param mutex the mutex to wait on
+ * @param abstime the absolute wall clock time to wait until or NULL to wait indefinitely
+ */
+static void wait_mutex(cpi_mutex_t *mutex, const struct timespec *abstime) {
 	pthread_t self = pthread_self();
 	
 	assert(mutex != NULL);
@@ -178,21 +343,29 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 		&& pthread_equal(self, mutex->os_thread)) {
 		int ec;
 		int lc = mutex->lock_count;
+		const char *holder = (mutex->stats != NULL ? mutex->stats->holder : NULL);
 		
 		// Release mutex
 		mutex->lock_count = 0;
-		if ((ec = pthread_cond_signal(&(mutex->os_cond_lock)))) {
-			cpi_fatalf(_("Could not signal a condition variable due to error %d."), ec);
-		}
+		released_exclusive(mutex);
+		signal_available(mutex);
 		
 		// Wait for signal
-		if ((ec = pthread_cond_wait(&(mutex->os_cond_wake), &(mutex->os_mutex)))) {
+		if (abstime == NULL) {
+			ec = pthread_cond_wait(&(mutex->os_cond_wake), &(mutex->os_mutex));
+		} else if ((ec = pthread_cond_timedwait(&(mutex->os_cond_wake), &(mutex->os_mutex), abstime)) == ETIMEDOUT) {
+			ec = 0;
+		}
+		if (ec) {
 			cpi_fatalf(_("Could not wait for a condition variable due to error %d."), ec);
 		}
 		
 		// Re-acquire mutex and restore lock count for this thread
 		lock_mutex_holding(mutex);
 		mutex->lock_count = lc;
+		if (mutex->stats != NULL) {
+			mutex->stats->holder = holder;
+		}
 		
 	} else {
 		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at waiting on a mutex."));
@@ -200,6 +373,28 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(&(mutex->os_mutex));
 }
 
+CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+	wait_mutex(mutex, NULL);
+}
+
+CP_HIDDEN void cpi_wait_mutex_timed(cpi_mutex_t *mutex, unsigned long long timeout) {
+	struct timespec abstime;
+	
+#if defined(HAVE_CLOCK_GETTIME)
+	clock_gettime(CLOCK_REALTIME, &abstime);
+#else
+	struct timeval tv;
+	
+	gettimeofday(&tv, NULL);
+	abstime.tv_sec = tv.tv_sec;
+	abstime.tv_nsec = tv.tv_usec * 1000L;
+#endif
+	timeout += abstime.tv_nsec;
+	abstime.tv_sec += timeout / 1000000000ULL;
+	abstime.tv_nsec = timeout % 1000000000ULL;
+	wait_mutex(mutex, &abstime);
+}
+
 CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	pthread_t self = pthread_self();
 	
@@ -220,13 +415,116 @@ CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(&(mutex->os_mutex));
 }
 
+CP_HIDDEN void cpi_set_mutex_stats(cpi_mutex_t *mutex, cpi_lock_stats_t *stats) {
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_mutex));
+	mutex->stats = stats;
+	if (stats != NULL
+		&& mutex->lock_count > 0
+		&& pthread_equal(pthread_self(), mutex->os_thread)) {
+		stats->holder = NULL;
+		stats->hold_begin = cpi_monotonic_time();
+	}
+	unlock_mutex(&(mutex->os_mutex));
+}
+
+CP_HIDDEN void cpi_set_mutex_holder(cpi_mutex_t *mutex, const char *holder) {
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_mutex));
+	if (mutex->stats != NULL
+		&& mutex->stats->holder == NULL
+		&& mutex->lock_count > 0
+		&& pthread_equal(pthread_self(), mutex->os_thread)) {
+		mutex->stats->holder = holder;
+	}
+	unlock_mutex(&(mutex->os_mutex));
+}
+
+CP_HIDDEN void cpi_get_mutex_stats(cpi_mutex_t *mutex, cp_lock_stats_t *stats) {
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_mutex));
+	if (mutex->stats != NULL) {
+		*stats = mutex->stats->summary;
+	} else {
+		memset(stats, 0, sizeof(cp_lock_stats_t));
+	}
+	unlock_mutex(&(mutex->os_mutex));
+}
+
 #if !defined(NDEBUG)
 CP_HIDDEN int cpi_is_mutex_locked(cpi_mutex_t *mutex) {
 	int locked;
 	
 	lock_mutex(&(mutex->os_mutex));
-	locked = (mutex->lock_count != 0);
+	locked = (mutex->lock_count != 0 || mutex->num_readers != 0);
 	unlock_mutex(&(mutex->os_mutex));
 	return locked;
 }
 #endif
+
+static void *thread_main(void *arg) {
+	cpi_thread_t *thread = arg;
+	
+	thread->func(thread->arg);
+	return NULL;
+}
+
+CP_HIDDEN cpi_thread_t * cpi_create_thread(void (*func)(void *arg), void *arg) {
+	cpi_thread_t *thread;
+	
+	if ((thread = cpi_malloc(sizeof(cpi_thread_t))) == NULL) {
+		return NULL;
+	}
+	memset(thread, 0, sizeof(cpi_thread_t));
+	thread->func = func;
+	thread->arg = arg;
+	if (pthread_create(&(thread->os_thread), NULL, thread_main, thread)) {
+		cpi_free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+CP_HIDDEN void cpi_join_thread(cpi_thread_t *thread) {
+	int ec;
+	
+	assert(thread != NULL);
+	if ((ec = pthread_join(thread->os_thread, NULL))) {
+		cpi_fatalf(_("Could not join a thread due to error %d."), ec);
+	}
+	cpi_free(thread);
+}
+
+CP_HIDDEN cpi_tls_t * cpi_create_tls(void) {
+	cpi_tls_t *tls;
+	
+	if ((tls = cpi_malloc(sizeof(cpi_tls_t))) == NULL) {
+		return NULL;
+	}
+	if (pthread_key_create(&(tls->os_key), NULL)) {
+		cpi_free(tls);
+		return NULL;
+	}
+	return tls;
+}
+
+CP_HIDDEN void cpi_destroy_tls(cpi_tls_t *tls) {
+	int ec;
+	
+	if ((ec = pthread_key_delete(tls->os_key))) {
+		cpi_fatalf(_("Could not destroy thread-local storage due to error %d."), ec);
+	}
+	cpi_free(tls);
+}
+
+CP_HIDDEN void * cpi_get_tls(cpi_tls_t *tls) {
+	return pthread_getspecific(tls->os_key);
+}
+
+CP_HIDDEN void cpi_set_tls(cpi_tls_t *tls, void *value) {
+	int ec;
+	
+	if ((ec = pthread_setspecific(tls->os_key, value))) {
+		cpi_fatalf(_("Could not set thread-specific data due to error %d."), ec);
+	}
+}
@@ -51,6 +51,25 @@ struct cpi_mutex_t {
 	/// The current lock count 
 	int lock_count;
 	
+	/// The number of threads holding the mutex in shared mode
+	int num_readers;
+	
+	/// The number of threads waiting to lock the mutex exclusively
+	int num_writers_waiting;
+	
+#ifdef HAVE_SRWLOCK
+
+	/// The slim reader/writer lock protecting the mutex state, used exclusively
+	SRWLOCK os_lock;
+	
+	/// The condition variable for signaling availability
+	CONDITION_VARIABLE os_cond_lock;
+	
+	/// The condition variable for broadcasting a wake request
+	CONDITION_VARIABLE os_cond_wake;
+
+#else
+
 	/// The underlying operating system mutex 
 	HANDLE os_mutex;
 	
@@ -59,13 +78,43 @@ struct cpi_mutex_t {
 	
 	/// The condition variable for signaling a wake request
 	HANDLE os_cond_wake;
+	
+	/// The condition variable for signaling availability in shared mode
+	HANDLE os_cond_shared;
 
 	/// Number of threads currently waiting on this mutex
 	int num_wait_threads;
 
+#endif
+
 	/// The locking thread if currently locked 
 	DWORD os_thread;
 	
+	/// The lock statistics or NULL if not collected
+	cpi_lock_stats_t *stats;
+	
+};
+
+// A generic thread implementation
+struct cpi_thread_t {
+
+	/// The underlying operating system thread
+	HANDLE os_thread;
+	
+	/// The function to be executed
+	void (*func)(void *arg);
+	
+	/// The argument for the function
+	void *arg;
+	
+};
+
+// A generic thread-local storage slot
+struct cpi_tls_t {
+	
+	/// The underlying thread local storage index
+	DWORD os_index;
+	
 };
 
 
@@ -73,10 +122,322 @@ struct cpi_mutex_t {
  * Function definitions
  * ----------------------------------------------------------------------*/
 
+static char *get_win_errormsg(DWORD error, char *buffer, size_t size) {
+	if (!FormatMessageA(FORMAT_MESSAGE_IGNORE_INSERTS
+		| FORMAT_MESSAGE_FROM_SYSTEM,
+		NULL,
+		error,
+		0,
+		buffer,
+		size / sizeof(char),
+		NULL)) {
+		strncpy(buffer, _("unknown error"), size);
+	}
+	buffer[size/sizeof(char) - 1] = '\0';
+	return buffer;
+}
+
+/**
+ * Records the end of an exclusive hold if statistics are being collected.
+ * The caller must hold the underlying operating system lock.
+ * 
+ * @param mutex the mutex
+ */
+static void released_exclusive(cpi_mutex_t *mutex) {
+	if (mutex->stats != NULL) {
+		cpi_lock_stats_released(mutex->stats);
+	}
+}
+
+#ifdef HAVE_SRWLOCK
+
+CP_HIDDEN cpi_mutex_t * cpi_create_mutex(void) {
+	cpi_mutex_t *mutex;
+	
+	if ((mutex = cpi_malloc(sizeof(cpi_mutex_t))) == NULL) {
+		return NULL;
+	}
+	memset(mutex, 0, sizeof(cpi_mutex_t));
+	InitializeSRWLock(&(mutex->os_lock));
+	InitializeConditionVariable(&(mutex->os_cond_lock));
+	InitializeConditionVariable(&(mutex->os_cond_wake));
+	return mutex;
+}
+
+CP_HIDDEN void cpi_destroy_mutex(cpi_mutex_t *mutex) {
+	assert(mutex != NULL);
+	assert(mutex->lock_count == 0);
+	assert(mutex->num_readers == 0);
+	cpi_free(mutex);
+}
+
+CP_HIDDEN void cpi_reset_mutex(cpi_mutex_t *mutex) {
+	assert(mutex != NULL);
+	assert(mutex->lock_count > 0);
+	assert(mutex->num_readers == 0);
+	mutex->num_writers_waiting = 0;
+#ifndef HAVE_SRWLOCK
+	mutex->num_wait_threads = 0;
+#endif
+	mutex->os_thread = GetCurrentThreadId();
+}
+
+static void lock_mutex(SRWLOCK *lock) {
+	AcquireSRWLockExclusive(lock);
+}
+
+static void unlock_mutex(SRWLOCK *lock) {
+	ReleaseSRWLockExclusive(lock);
+}
+
+/**
+ * Waits on a condition variable until it is woken up or until the
+ * specified timeout has elapsed. The caller must hold the slim
+ * reader/writer lock of the mutex.
+ * 
+ * @param mutex the mutex
+ * @param cond the condition variable
+ * @param timeout the timeout in milliseconds or INFINITE
+ */
+static void wait_cond(cpi_mutex_t *mutex, CONDITION_VARIABLE *cond, DWORD timeout) {
+	if (!SleepConditionVariableSRW(cond, &(mutex->os_lock), timeout, 0)) {
+		DWORD ec = GetLastError();
+		
+		if (ec != ERROR_TIMEOUT) {
+			char buffer[256];
+			cpi_fatalf(_("Could not wait for a condition variable due to error %ld: %s"),
+				(long) ec, get_win_errormsg(ec, buffer, sizeof(buffer)));
+		}
+	}
+}
+
+/**
+ * Wakes up the threads waiting for the mutex to become available. The
+ * caller must hold the slim reader/writer lock of the mutex.
+ * 
+ * @param mutex the mutex
+ */
+static void signal_available(cpi_mutex_t *mutex) {
+	WakeAllConditionVariable(&(mutex->os_cond_lock));
+}
+
+static unsigned long long lock_mutex_holding(cpi_mutex_t *mutex) {
+	DWORD self = GetCurrentThreadId();
+	unsigned long long begin = 0;
+	unsigned long long waited;
+	
+	while ((mutex->lock_count != 0
+			&& self != mutex->os_thread)
+			|| mutex->num_readers != 0) {
+		if (begin == 0) {
+			begin = cpi_monotonic_time();
+		}
+		mutex->num_writers_waiting++;
+		wait_cond(mutex, &(mutex->os_cond_lock), INFINITE);
+		mutex->num_writers_waiting--;
+	}
+	waited = (begin != 0 ? cpi_monotonic_time() - begin : 0);
+	mutex->os_thread = self;
+	if (mutex->lock_count++ == 0 && mutex->stats != NULL) {
+		cpi_lock_stats_acquired(mutex->stats, waited, 1);
+	}
+	return waited;
+}
+
+CP_HIDDEN unsigned long long cpi_lock_mutex(cpi_mutex_t *mutex) {
+	unsigned long long waited;
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	waited = lock_mutex_holding(mutex);
+	unlock_mutex(&(mutex->os_lock));
+	return waited;
+}
+
+CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
+	DWORD self = GetCurrentThreadId();
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	if (mutex->lock_count > 0
+		&& self == mutex->os_thread) {
+		if (--mutex->lock_count == 0) {
+			released_exclusive(mutex);
+			signal_available(mutex);
+		}
+	} else {
+		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at unlocking a mutex."));
+	}
+	unlock_mutex(&(mutex->os_lock));
+}
+
+CP_HIDDEN unsigned long long cpi_lock_mutex_shared(cpi_mutex_t *mutex) {
+	DWORD self = GetCurrentThreadId();
+	unsigned long long begin = 0;
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	if (mutex->lock_count != 0
+		&& self == mutex->os_thread) {
+		
+		// Already locked exclusively by this thread
+		mutex->lock_count++;
+		
+	} else {
+		
+		// Let threads waiting for exclusive access go first
+		while (mutex->lock_count != 0 || mutex->num_writers_waiting != 0) {
+			if (begin == 0) {
+				begin = cpi_monotonic_time();
+			}
+			wait_cond(mutex, &(mutex->os_cond_lock), INFINITE);
+		}
+		mutex->num_readers++;
+		if (mutex->stats != NULL) {
+			cpi_lock_stats_acquired(mutex->stats, (begin != 0 ? cpi_monotonic_time() - begin : 0), 0);
+		}
+		
+	}
+	unlock_mutex(&(mutex->os_lock));
+	return (begin != 0 ? cpi_monotonic_time() - begin : 0);
+}
+
+CP_HIDDEN void cpi_unlock_mutex_shared(cpi_mutex_t *mutex) {
+	DWORD self = GetCurrentThreadId();
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	if (mutex->lock_count > 0
+		&& self == mutex->os_thread) {
+		if (--mutex->lock_count == 0) {
+			released_exclusive(mutex);
+			signal_available(mutex);
+		}
+	} else if (mutex->num_readers > 0) {
+		if (--mutex->num_readers == 0) {
+			signal_available(mutex);
+		}
+	} else {
+		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at unlocking a mutex."));
+	}
+	unlock_mutex(&(mutex->os_lock));
+}
+
+/**
+ * Waits on the specified mutex until it is signaled or until the
+ * specified timeout has elapsed.
+ * 
+ * @param mutex the mutex to wait on
+ * @param timeout the timeout in milliseconds or INFINITE
+ */
+static void wait_mutex(cpi_mutex_t *mutex, DWORD timeout) {
+	DWORD self = GetCurrentThreadId();
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	if (mutex->lock_count > 0
+		&& self == mutex->os_thread) {
+		int lc = mutex->lock_count;
+		const char *holder = (mutex->stats != NULL ? mutex->stats->holder : NULL);
+		
+		// Release mutex
+		mutex->lock_count = 0;
+		released_exclusive(mutex);
+		signal_available(mutex);
+		
+		// Wait for signal
+		wait_cond(mutex, &(mutex->os_cond_wake), timeout);
+		
+		// Re-acquire mutex and restore lock count for this thread
+		lock_mutex_holding(mutex);
+		mutex->lock_count = lc;
+		if (mutex->stats != NULL) {
+			mutex->stats->holder = holder;
+		}
+		
+	} else {
+		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at waiting on a mutex."));
+	}
+	unlock_mutex(&(mutex->os_lock));
+}
+
+CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+	wait_mutex(mutex, INFINITE);
+}
+
+CP_HIDDEN void cpi_wait_mutex_timed(cpi_mutex_t *mutex, unsigned long long timeout) {
+	unsigned long long ms = (timeout + 999999ULL) / 1000000ULL;
+	
+	wait_mutex(mutex, ms < INFINITE ? (DWORD) ms : INFINITE - 1);
+}
+
+CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
+	DWORD self = GetCurrentThreadId();
+	
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	if (mutex->lock_count > 0
+		&& self == mutex->os_thread) {
+		WakeAllConditionVariable(&(mutex->os_cond_wake));
+	} else {
+		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at signaling a mutex."));
+	}
+	unlock_mutex(&(mutex->os_lock));
+}
+
+CP_HIDDEN void cpi_set_mutex_stats(cpi_mutex_t *mutex, cpi_lock_stats_t *stats) {
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	mutex->stats = stats;
+	if (stats != NULL
+		&& mutex->lock_count > 0
+		&& GetCurrentThreadId() == mutex->os_thread) {
+		stats->holder = NULL;
+		stats->hold_begin = cpi_monotonic_time();
+	}
+	unlock_mutex(&(mutex->os_lock));
+}
+
+CP_HIDDEN void cpi_set_mutex_holder(cpi_mutex_t *mutex, const char *holder) {
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	if (mutex->stats != NULL
+		&& mutex->stats->holder == NULL
+		&& mutex->lock_count > 0
+		&& GetCurrentThreadId() == mutex->os_thread) {
+		mutex->stats->holder = holder;
+	}
+	unlock_mutex(&(mutex->os_lock));
+}
+
+CP_HIDDEN void cpi_get_mutex_stats(cpi_mutex_t *mutex, cp_lock_stats_t *stats) {
+	assert(mutex != NULL);
+	lock_mutex(&(mutex->os_lock));
+	if (mutex->stats != NULL) {
+		*stats = mutex->stats->summary;
+	} else {
+		memset(stats, 0, sizeof(cp_lock_stats_t));
+	}
+	unlock_mutex(&(mutex->os_lock));
+}
+
+#if !defined(NDEBUG)
+CP_HIDDEN int cpi_is_mutex_locked(cpi_mutex_t *mutex) {
+	int locked;
+	
+	lock_mutex(&(mutex->os_lock));
+	locked = (mutex->lock_count != 0 || mutex->num_readers != 0);
+	unlock_mutex(&(mutex->os_lock));
+	return locked;
+}
+#endif
+
+#else //HAVE_SRWLOCK
+
 CP_HIDDEN cpi_mutex_t * cpi_create_mutex(void) {
 	cpi_mutex_t *mutex;
 	
-	if ((mutex = malloc(sizeof(cpi_mutex_t))) == NULL) {
+	if ((mutex = cpi_malloc(sizeof(cpi_mutex_t))) == NULL) {
 		return NULL;
 	}
 	memset(mutex, 0, sizeof(cpi_mutex_t));
@@ -96,6 +457,16 @@ CP_HIDDEN cpi_mutex_t * cpi_create_mutex(void) {
 		ec = CloseHandle(mutex->os_cond_lock);
 		assert(ec);
 		return NULL;
+	} else if ((mutex->os_cond_shared = CreateEvent(NULL, TRUE, FALSE, NULL)) == NULL) {
+		int ec;
+		
+		ec = CloseHandle(mutex->os_mutex);
+		assert(ec);
+		ec = CloseHandle(mutex->os_cond_lock);
+		assert(ec);
+		ec = CloseHandle(mutex->os_cond_wake);
+		assert(ec);
+		return NULL;
 	}
 	return mutex;
 }
@@ -105,28 +476,16 @@ CP_HIDDEN void cpi_destroy_mutex(cpi_mutex_t *mutex) {
 	
 	assert(mutex != NULL);
 	assert(mutex->lock_count == 0);
+	assert(mutex->num_readers == 0);
 	ec = CloseHandle(mutex->os_mutex);
 	assert(ec);
 	ec = CloseHandle(mutex->os_cond_lock);
 	assert(ec);
 	ec = CloseHandle(mutex->os_cond_wake);
 	assert(ec);
-	free(mutex);
-}
-
-static char *get_win_errormsg(DWORD error, char *buffer, size_t size) {
-	if (!FormatMessageA(FORMAT_MESSAGE_IGNORE_INSERTS
-		| FORMAT_MESSAGE_FROM_SYSTEM,
-		NULL,
-		error,
-		0,
-		buffer,
-		size / sizeof(char),
-		NULL)) {
-		strncpy(buffer, _("unknown error"), size);
-	}
-	buffer[size/sizeof(char) - 1] = '\0';
-	return buffer;
+	ec = CloseHandle(mutex->os_cond_shared);
+	assert(ec);
+	cpi_free(mutex);
 }
 
 static void lock_mutex(HANDLE mutex) {
@@ -176,24 +535,60 @@ static void reset_event(HANDLE event) {
 	}
 }
 
-static void lock_mutex_holding(cpi_mutex_t *mutex) {
+/**
+ * Wakes up the threads waiting for the mutex to become available. Threads
+ * waiting for exclusive access take precedence over threads waiting for
+ * shared access. The caller must hold the underlying operating system mutex.
+ * 
+ * @param mutex the mutex
+ */
+static void signal_available(cpi_mutex_t *mutex) {
+	if (mutex->num_writers_waiting > 0) {
+		if (mutex->num_readers == 0) {
+			set_event(mutex->os_cond_lock);
+		}
+	} else {
+		set_event(mutex->os_cond_shared);
+	}
+}
+
+static unsigned long long lock_mutex_holding(cpi_mutex_t *mutex) {
 	DWORD self = GetCurrentThreadId();
+	unsigned long long begin = 0;
+	unsigned long long waited;
 	
-	while (mutex->lock_count != 0
-			&& self != mutex->os_thread) {
+	while ((mutex->lock_count != 0
+			&& self != mutex->os_thread)
+			|| mutex->num_readers != 0) {
+		if (begin == 0) {
+			begin = cpi_monotonic_time();
+		}
+		mutex->num_writers_waiting++;
+		reset_event(mutex->os_cond_shared);
 		unlock_mutex(mutex->os_mutex);
 		wait_for_event(mutex->os_cond_lock);
 		lock_mutex(mutex->os_mutex);
+		mutex->num_writers_waiting--;
 	}
+	if (mutex->lock_count == 0) {
+		reset_event(mutex->os_cond_shared);
+	}
+	waited = (begin != 0 ? cpi_monotonic_time() - begin : 0);
 	mutex->os_thread = self;
-	mutex->lock_count++;
+	if (mutex->lock_count++ == 0 && mutex->stats != NULL) {
+		cpi_lock_stats_acquired(mutex->stats, waited, 1);
+	}
+	return waited;
 }
 
-CP_HIDDEN void cpi_lock_mutex(cpi_mutex_t *mutex) {
+CP_HIDDEN unsigned long long cpi_lock_mutex(cpi_mutex_t *mutex) {
+	unsigned long long waited;
+	
 	assert(mutex != NULL);
 	lock_mutex(mutex->os_mutex);
-	lock_mutex_holding(mutex);
+	waited = lock_mutex_holding(mutex);
 	unlock_mutex(mutex->os_mutex);
+	return waited;
 }
 
 CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
@@ -204,7 +599,8 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
 	if (mutex->lock_count > 0
 		&& self == mutex->os_thread) {
 		if (--mutex->lock_count == 0) {
-			set_event(mutex->os_cond_lock);
+			released_exclusive(mutex);
+			signal_available(mutex);
 		}
 	} else {
 		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at unlocking a mutex."));
@@ -212,7 +608,68 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(mutex->os_mutex);
 }
 
-CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+CP_HIDDEN unsigned long long cpi_lock_mutex_shared(cpi_mutex_t *mutex) {
+	DWORD self = GetCurrentThreadId();
+	unsigned long long begin = 0;
+	
+	assert(mutex != NULL);
+	lock_mutex(mutex->os_mutex);
+	if (mutex->lock_count != 0
+		&& self == mutex->os_thread) {
+		
+		// Already locked exclusively by this thread
+		mutex->lock_count++;
+		
+	} else {
+		
+		// Let threads waiting for exclusive access go first
+		while (mutex->lock_count != 0 || mutex->num_writers_waiting != 0) {
+			if (begin == 0) {
+				begin = cpi_monotonic_time();
+			}
+			unlock_mutex(mutex->os_mutex);
+			wait_for_event(mutex->os_cond_shared);
+			lock_mutex(mutex->os_mutex);
+		}
+		mutex->num_readers++;
+		if (mutex->stats != NULL) {
+			cpi_lock_stats_acquired(mutex->stats, (begin != 0 ? cpi_monotonic_time() - begin : 0), 0);
+		}
+		
+	}
+	unlock_mutex(mutex->os_mutex);
+	return (begin != 0 ? cpi_monotonic_time() - begin : 0);
+}
+
+CP_HIDDEN void cpi_unlock_mutex_shared(cpi_mutex_t *mutex) {
+	DWORD self = GetCurrentThreadId();
+	
+	assert(mutex != NULL);
+	lock_mutex(mutex->os_mutex);
+	if (mutex->lock_count > 0
+		&& self == mutex->os_thread) {
+		if (--mutex->lock_count == 0) {
+			released_exclusive(mutex);
+			signal_available(mutex);
+		}
+	} else if (mutex->num_readers > 0) {
+		if (--mutex->num_readers == 0) {
+			signal_available(mutex);
+		}
+	} else {
+		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at unlocking a mutex."));
+	}
+	unlock_mutex(mutex->os_mutex);
+}
+
+/**
+ * Waits on the specified mutex until it is signaled or until the
+ * specified timeout has elapsed.
+ * 
+ * @param mutex the mutex to wait on
+ * @param timeout the timeout in milliseconds or INFINITE
+ */
+static void wait_mutex(cpi_mutex_t *mutex, DWORD timeout) {
 	DWORD self = GetCurrentThreadId();
 	
 	assert(mutex != NULL);
@@ -220,15 +677,24 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 	if (mutex->lock_count > 0
 		&& self == mutex->os_thread) {
 		int lc = mutex->lock_count;
+		const char *holder = (mutex->stats != NULL ? mutex->stats->holder : NULL);
 		
 		// Release mutex
 		mutex->lock_count = 0;
+		released_exclusive(mutex);
 		mutex->num_wait_threads++;
-		set_event(mutex->os_cond_lock);
+		signal_available(mutex);
 		unlock_mutex(mutex->os_mutex);
 		
 		// Wait for signal
-		wait_for_event(mutex->os_cond_wake);
+		if (timeout == INFINITE) {
+			wait_for_event(mutex->os_cond_wake);
+		} else if (WaitForSingleObject(mutex->os_cond_wake, timeout) == WAIT_FAILED) {
+			char buffer[256];
+			DWORD ec = GetLastError();
+			cpi_fatalf(_("Could not wait for an event due to error %ld: %s"),
+				(long) ec, get_win_errormsg(ec, buffer, sizeof(buffer)));
+		}
 		
 		// Reset wake signal if last one waking up
 		lock_mutex(mutex->os_mutex);
@@ -238,7 +704,10 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 		
 		// Re-acquire mutex and restore lock count for this thread
 		lock_mutex_holding(mutex);
-		mutex->lock_count = lc;		
+		mutex->lock_count = lc;
+		if (mutex->stats != NULL) {
+			mutex->stats->holder = holder;
+		}
 		
 	} else {
 		cpi_fatalf(_("Internal C-Pluff error: Unauthorized attempt at waiting on a mutex."));
@@ -246,6 +715,16 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(mutex->os_mutex);
 }
 
+CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+	wait_mutex(mutex, INFINITE);
+}
+
+CP_HIDDEN void cpi_wait_mutex_timed(cpi_mutex_t *mutex, unsigned long long timeout) {
+	unsigned long long ms = (timeout + 999999ULL) / 1000000ULL;
+	
+	wait_mutex(mutex, ms < INFINITE ? (DWORD) ms : INFINITE - 1);
+}
+
 CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	DWORD self = GetCurrentThreadId();
 	
@@ -260,13 +739,126 @@ CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(mutex->os_mutex);	
 }
 
+CP_HIDDEN void cpi_set_mutex_stats(cpi_mutex_t *mutex, cpi_lock_stats_t *stats) {
+	assert(mutex != NULL);
+	lock_mutex(mutex->os_mutex);
+	mutex->stats = stats;
+	if (stats != NULL
+		&& mutex->lock_count > 0
+		&& GetCurrentThreadId() == mutex->os_thread) {
+		stats->holder = NULL;
+		stats->hold_begin = cpi_monotonic_time();
+	}
+	unlock_mutex(mutex->os_mutex);
+}
+
+CP_HIDDEN void cpi_set_mutex_holder(cpi_mutex_t *mutex, const char *holder) {
+	assert(mutex != NULL);
+	lock_mutex(mutex->os_mutex);
+	if (mutex->stats != NULL
+		&& mutex->stats->holder == NULL
+		&& mutex->lock_count > 0
+		&& GetCurrentThreadId() == mutex->os_thread) {
+		mutex->stats->holder = holder;
+	}
+	unlock_mutex(mutex->os_mutex);
+}
+
+CP_HIDDEN void cpi_get_mutex_stats(cpi_mutex_t *mutex, cp_lock_stats_t *stats) {
+	assert(mutex != NULL);
+	lock_mutex(mutex->os_mutex);
+	if (mutex->stats != NULL) {
+		*stats = mutex->stats->summary;
+	} else {
+		memset(stats, 0, sizeof(cp_lock_stats_t));
+	}
+	unlock_mutex(mutex->os_mutex);
+}
+
 #if !defined(NDEBUG)
 CP_HIDDEN int cpi_is_mutex_locked(cpi_mutex_t *mutex) {
 	int locked;
 	
 	lock_mutex(mutex->os_mutex);
-	locked = (mutex->lock_count != 0);
+	locked = (mutex->lock_count != 0 || mutex->num_readers != 0);
 	unlock_mutex(mutex->os_mutex);
 	return locked;
 }
 #endif
+
+#endif //HAVE_SRWLOCK
+
+static DWORD WINAPI thread_main(LPVOID arg) {
+	cpi_thread_t *thread = arg;
+	
+	thread->func(thread->arg);
+	return 0;
+}
+
+CP_HIDDEN cpi_thread_t * cpi_create_thread(void (*func)(void *arg), void *arg) {
+	cpi_thread_t *thread;
+	
+	if ((thread = cpi_malloc(sizeof(cpi_thread_t))) == NULL) {
+		return NULL;
+	}
+	memset(thread, 0, sizeof(cpi_thread_t));
+	thread->func = func;
+	thread->arg = arg;
+	if ((thread->os_thread = CreateThread(NULL, 0, thread_main, thread, 0, NULL)) == NULL) {
+		cpi_free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+CP_HIDDEN void cpi_join_thread(cpi_thread_t *thread) {
+	int ec;
+	
+	assert(thread != NULL);
+	if (WaitForSingleObject(thread->os_thread, INFINITE) != WAIT_OBJECT_0) {
+		char buffer[256];
+		DWORD error = GetLastError();
+		cpi_fatalf(_("Could not join a thread due to error %ld: %s"),
+			(long) error, get_win_errormsg(error, buffer, sizeof(buffer)));
+	}
+	ec = CloseHandle(thread->os_thread);
+	assert(ec);
+	cpi_free(thread);
+}
+
+CP_HIDDEN cpi_tls_t * cpi_create_tls(void) {
+	cpi_tls_t *tls;
+	
+	if ((tls = cpi_malloc(sizeof(cpi_tls_t))) == NULL) {
+		return NULL;
+	}
+	if ((tls->os_index = TlsAlloc()) == TLS_OUT_OF_INDEXES) {
+		cpi_free(tls);
+		return NULL;
+	}
+	return tls;
+}
+
+CP_HIDDEN void cpi_destroy_tls(cpi_tls_t *tls) {
+	if (!TlsFree(tls->os_index)) {
+		DWORD ec = GetLastError();
+		char buffer[256];
+		
+		cpi_fatalf(_("Could not destroy thread-local storage due to error %ld: %s"),
+			(long) ec, get_win_errormsg(ec, buffer, sizeof(buffer)));
+	}
+	cpi_free(tls);
+}
+
+CP_HIDDEN void * cpi_get_tls(cpi_tls_t *tls) {
+	return TlsGetValue(tls->os_index);
+}
+
+CP_HIDDEN void cpi_set_tls(cpi_tls_t *tls, void *value) {
+	if (!TlsSetValue(tls->os_index, value)) {
+		char buffer[256];
+		DWORD error = GetLastError();
+		cpi_fatalf(_("Could not set thread local data due to error %ld: %s"),
+			(long) error, get_win_errormsg(error, buffer, sizeof(buffer)));
+	}
+}
@@ -33,7 +33,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stddef.h>
 #include <assert.h>
+#if defined(HAVE_CLOCK_GETTIME) || defined(HAVE_NANOSLEEP) || !defined(HAVE_GETTIMEOFDAY)
+#include <time.h>
+#endif
+#if !defined(HAVE_CLOCK_GETTIME) && defined(HAVE_GETTIMEOFDAY)
+#include <sys/time.h>
+#endif
+#if !defined(HAVE_NANOSLEEP) && defined(_WIN32)
+#include <windows.h>
+#endif
 #include "../kazlib/list.h"
 #include "cpluff.h"
 #include "defines.h"
@@ -52,6 +62,13 @@ CP_HIDDEN hash_val_t cpi_hashfunc_ptr(const void *ptr) {
 	return (hash_val_t) ptr;
 }
 
+CP_HIDDEN int cpi_comp_str(const void *str1, const void *str2) {
+	if (str1 == str2) {
+		return 0;
+	}
+	return strcmp(str1, str2);
+}
+
 CP_HIDDEN int cpi_ptrset_add(list_t *set, void *ptr) {
 	
 
@@ -94,7 +111,485 @@ CP_HIDDEN void cpi_process_free_ptr(list_t *list, lnode_t *node, void *dummy) {
 	void *ptr = lnode_get(node);
 	list_delete(list, node);
 	lnode_destroy(node);
-	free(ptr);
+	cpi_free(ptr);
+}
+
+/// Initial number of slots of a hash table
+#define CPI_HMAP_MIN_SLOTS 8
+
+/// Returns the maximum number of entries for the specified number of slots
+#define HMAP_MAX_COUNT(slots) ((slots) - (slots) / 8)
+
+/// Returns the probe distance of an entry stored in the specified slot
+#define HMAP_DIST(hmap, e, i) (((i) - ((e)->hash & (hmap)->mask)) & (hmap)->mask)
+
+/// A slot of a hash table
+typedef struct hmap_entry_t {
+	
+	/// The key or NULL if the slot is empty
+	const void *key;
+	
+	/// The value
+	void *value;
+	
+	/// The stored hash value of the key
+	size_t hash;
+	
+} hmap_entry_t;
+
+struct cpi_hmap_t {
+	
+	/// The key comparison function
+	int (*compare)(const void *, const void *);
+	
+	/// The key hash function or NULL for string keys
+	hash_val_t (*hashf)(const void *);
+	
+	/// The slots or NULL if none have been allocated yet
+	hmap_entry_t *entries;
+	
+	/// The number of slots minus one, or zero if there are no slots
+	size_t mask;
+	
+	/// The number of entries
+	size_t count;
+	
+};
+
+CP_HIDDEN cpi_hmap_t *cpi_create_hmap(int (*compare)(const void *, const void *), hash_val_t (*hashf)(const void *)) {
+	cpi_hmap_t *hmap;
+	
+	if ((hmap = cpi_malloc(sizeof(cpi_hmap_t))) != NULL) {
+		hmap->compare = compare;
+		hmap->hashf = hashf;
+		hmap->entries = NULL;
+		hmap->mask = 0;
+		hmap->count = 0;
+	}
+	return hmap;
+}
+
+CP_HIDDEN void cpi_destroy_hmap(cpi_hmap_t *hmap) {
+	cpi_free(hmap->entries);
+	cpi_free(hmap);
+}
+
+CP_HIDDEN size_t cpi_hmap_count(const cpi_hmap_t *hmap) {
+	return hmap->count;
+}
+
+CP_HIDDEN size_t cpi_hmap_slots(const cpi_hmap_t *hmap) {
+	return (hmap->entries != NULL ? hmap->mask + 1 : 0);
+}
+
+/**
+ * Calculates the stored hash value of a key. The result is mixed so that
+ * the low bits used for slot selection depend on all bits of the key hash,
+ * which matters for aligned pointer keys.
+ * 
+ * @param hmap the table
+ * @param key the key
+ * @return the hash value
+ */
+static size_t hmap_hash(const cpi_hmap_t *hmap, const void *key) {
+	size_t h;
+	
+	if (hmap->hashf != NULL) {
+		h = hmap->hashf(key);
+	} else {
+		const unsigned char *s;
+		
+		// FNV-1a
+		h = 2166136261U;
+		for (s = key; *s != '\0'; s++) {
+			h = (h ^ *s) * 16777619U;
+		}
+	}
+	h ^= h >> 16;
+	h *= 0x45d9f3bU;
+	h ^= h >> 16;
+	return h;
+}
+
+/**
+ * Returns the slot holding the specified key.
+ * 
+ * @param hmap the table
+ * @param key the key
+ * @param h the hash value of the key
+ * @return the slot or NULL if the key is not included
+ */
+static hmap_entry_t *hmap_find(const cpi_hmap_t *hmap, const void *key, size_t h) {
+	size_t i, dist;
+	
+	if (hmap->entries == NULL) {
+		return NULL;
+	}
+	for (i = h & hmap->mask, dist = 0;; i = (i + 1) & hmap->mask, dist++) {
+		hmap_entry_t *e = hmap->entries + i;
+		
+		// Robin Hood invariant: the key would have displaced this entry
+		if (e->key == NULL || HMAP_DIST(hmap, e, i) < dist) {
+			return NULL;
+		}
+		if (e->hash == h && !hmap->compare(e->key, key)) {
+			return e;
+		}
+	}
+}
+
+/**
+ * Inserts a new entry into a table having a free slot for it.
+ * 
+ * @param hmap the table
+ * @param entry the entry to be inserted
+ */
+static void hmap_insert(cpi_hmap_t *hmap, hmap_entry_t entry) {
+	size_t i, dist;
+	
+	for (i = entry.hash & hmap->mask, dist = 0;; i = (i + 1) & hmap->mask, dist++) {
+		hmap_entry_t *e = hmap->entries + i;
+		size_t edist;
+		
+		if (e->key == NULL) {
+			*e = entry;
+			return;
+		}
+		
+		// Take the slot from an entry closer to its home slot
+		if ((edist = HMAP_DIST(hmap, e, i)) < dist) {
+			hmap_entry_t tmp = *e;
+			
+			*e = entry;
+			entry = tmp;
+			dist = edist;
+		}
+	}
+}
+
+/**
+ * Reallocates the slots of a table.
+ * 
+ * @param hmap the table
+ * @param slots the new number of slots, a power of two
+ * @return non-zero on success or zero if memory allocation failed
+ */
+static int hmap_resize(cpi_hmap_t *hmap, size_t slots) {
+	hmap_entry_t *old = hmap->entries;
+	size_t i, num_old = old != NULL ? hmap->mask + 1 : 0;
+	
+	if ((hmap->entries = cpi_calloc(slots, sizeof(hmap_entry_t))) == NULL) {
+		hmap->entries = old;
+		return 0;
+	}
+	hmap->mask = slots - 1;
+	for (i = 0; i < num_old; i++) {
+		if (old[i].key != NULL) {
+			hmap_insert(hmap, old[i]);
+		}
+	}
+	cpi_free(old);
+	return 1;
+}
+
+CP_HIDDEN int cpi_hmap_reserve(cpi_hmap_t *hmap, size_t n) {
+	size_t slots = hmap->entries != NULL ? hmap->mask + 1 : CPI_HMAP_MIN_SLOTS;
+	
+	while (HMAP_MAX_COUNT(slots) < n) {
+		slots *= 2;
+	}
+	if (hmap->entries == NULL || slots > hmap->mask + 1) {
+		return hmap_resize(hmap, slots);
+	}
+	return 1;
+}
+
+CP_HIDDEN void cpi_hmap_compact(cpi_hmap_t *hmap) {
+	size_t slots = CPI_HMAP_MIN_SLOTS;
+	
+	if (hmap->count == 0) {
+		cpi_free(hmap->entries);
+		hmap->entries = NULL;
+		hmap->mask = 0;
+		return;
+	}
+	while (HMAP_MAX_COUNT(slots) < hmap->count) {
+		slots *= 2;
+	}
+	if (slots < hmap->mask + 1) {
+		hmap_resize(hmap, slots);
+	}
+}
+
+CP_HIDDEN void *cpi_hmap_get(const cpi_hmap_t *hmap, const void *key) {
+	hmap_entry_t *e;
+	
+	if ((e = hmap_find(hmap, key, hmap_hash(hmap, key))) != NULL) {
+		return e->value;
+	}
+	return NULL;
+}
+
+CP_HIDDEN int cpi_hmap_put(cpi_hmap_t *hmap, const void *key, void *value) {
+	hmap_entry_t entry;
+	hmap_entry_t *e;
+	
+	assert(value != NULL);
+	entry.hash = hmap_hash(hmap, key);
+	if ((e = hmap_find(hmap, key, entry.hash)) != NULL) {
+		e->value = value;
+		return 1;
+	}
+	if (!cpi_hmap_reserve(hmap, hmap->count + 1)) {
+		return 0;
+	}
+	entry.key = key;
+	entry.value = value;
+	hmap_insert(hmap, entry);
+	hmap->count++;
+	return 1;
+}
+
+CP_HIDDEN void *cpi_hmap_remove(cpi_hmap_t *hmap, const void *key) {
+	hmap_entry_t *e;
+	void *value;
+	size_t i;
+	
+	if ((e = hmap_find(hmap, key, hmap_hash(hmap, key))) == NULL) {
+		return NULL;
+	}
+	value = e->value;
+	
+	// Shift the following entries of the cluster back by one slot
+	for (i = e - hmap->entries;;) {
+		size_t j = (i + 1) & hmap->mask;
+		hmap_entry_t *n = hmap->entries + j;
+		
+		if (n->key == NULL || HMAP_DIST(hmap, n, j) == 0) {
+			hmap->entries[i].key = NULL;
+			break;
+		}
+		hmap->entries[i] = *n;
+		i = j;
+	}
+	hmap->count--;
+	return value;
+}
+
+CP_HIDDEN size_t cpi_hmap_memory(const cpi_hmap_t *hmap) {
+	return sizeof(cpi_hmap_t)
+		+ (hmap->entries != NULL ? (hmap->mask + 1) * sizeof(hmap_entry_t) : 0);
+}
+
+CP_HIDDEN void cpi_hmap_scan_begin(cpi_hmap_scan_t *scan, const cpi_hmap_t *hmap) {
+	scan->hmap = hmap;
+	scan->index = 0;
+	scan->remaining = 0;
+	scan->key = NULL;
+	
+	// Start from an empty slot so that removals never move an entry
+	// from the unscanned part of the table into the scanned part
+	if (hmap->entries != NULL) {
+		while (hmap->entries[scan->index].key != NULL) {
+			scan->index++;
+		}
+		scan->remaining = hmap->mask + 1;
+	}
+}
+
+CP_HIDDEN void *cpi_hmap_scan_next(cpi_hmap_scan_t *scan, const void **key) {
+	const cpi_hmap_t *hmap = scan->hmap;
+	
+	while (scan->remaining > 0) {
+		const hmap_entry_t *e = hmap->entries + scan->index;
+		
+		// Revisit the slot if the previous entry was removed and
+		// the next entry of its cluster was shifted into its place
+		if (scan->key == NULL || e->key == NULL || e->key == scan->key) {
+			scan->index = (scan->index + 1) & hmap->mask;
+			scan->remaining--;
+			e = hmap->entries + scan->index;
+		}
+		scan->key = e->key;
+		if (e->key != NULL) {
+			if (key != NULL) {
+				*key = e->key;
+			}
+			return e->value;
+		}
+	}
+	return NULL;
+}
+
+/// Size of the first memory block of an arena
+#define CPI_ARENA_INITIAL_BLOCK_SIZE 1024
+
+/// Maximum size of a shared memory block of an arena
+#define CPI_ARENA_MAX_BLOCK_SIZE 65536
+
+/// Memory block alignment for arena allocations
+typedef union arena_align_t {
+	long l;
+	double d;
+	long double ld;
+	void *p;
+} arena_align_t;
+
+/// A memory block of an arena, followed by the allocated data
+typedef struct arena_block_t arena_block_t;
+struct arena_block_t {
+
+	/// The previously allocated block or NULL
+	arena_block_t *prev;
+	
+	/// The number of data bytes in this block
+	size_t size;
+	
+	/// The number of data bytes already allocated from this block
+	size_t used;
+	
+	/// Ensures the alignment of the following data
+	arena_align_t align[1];
+};
+
+struct cpi_arena_t {
+
+	/// The block currently being allocated from or NULL
+	arena_block_t *current;
+	
+	/// The size of the next shared block to be allocated
+	size_t block_size;
+	
+	/// The number of bytes allocated for the arena and its blocks
+	size_t bytes;
+	
+	/// The number of allocations made from the arena
+	size_t num_allocs;
+};
+
+/// Returns a pointer to the data of an arena block
+#define ARENA_BLOCK_DATA(block) ((char *) (block)->align)
+
+CP_HIDDEN cpi_arena_t *cpi_create_arena(void) {
+	return cpi_create_sized_arena(CPI_ARENA_INITIAL_BLOCK_SIZE);
+}
+
+CP_HIDDEN cpi_arena_t *cpi_create_sized_arena(size_t size) {
+	cpi_arena_t *arena;
+	
+	// Keep the block size aligned
+	size = (size + sizeof(arena_align_t) - 1) / sizeof(arena_align_t) * sizeof(arena_align_t);
+	if (size == 0) {
+		size = CPI_ARENA_INITIAL_BLOCK_SIZE;
+	}
+	if ((arena = cpi_malloc(sizeof(cpi_arena_t))) != NULL) {
+		arena->current = NULL;
+		arena->block_size = size;
+		arena->bytes = sizeof(cpi_arena_t);
+		arena->num_allocs = 0;
+	}
+	return arena;
+}
+
+CP_HIDDEN void *cpi_arena_alloc(cpi_arena_t *arena, size_t size) {
+	arena_block_t *block;
+	size_t bs;
+	
+	assert(arena != NULL);
+	
+	// Round up the size to keep the following allocations aligned
+	if (size == 0) {
+		size = 1;
+	}
+	size = (size + sizeof(arena_align_t) - 1) / sizeof(arena_align_t) * sizeof(arena_align_t);
+	
+	// Allocate from the current block, if possible
+	block = arena->current;
+	if (block != NULL && block->size - block->used >= size) {
+		void *ptr = ARENA_BLOCK_DATA(block) + block->used;
+		block->used += size;
+		arena->num_allocs++;
+		return ptr;
+	}
+	
+	// Allocate a dedicated block for a large allocation
+	if (size > arena->block_size / 4) {
+		if ((block = cpi_malloc(offsetof(arena_block_t, align) + size)) == NULL) {
+			return NULL;
+		}
+		block->size = size;
+		block->used = size;
+		arena->bytes += offsetof(arena_block_t, align) + size;
+		arena->num_allocs++;
+		
+		// Keep allocating from the current block
+		if (arena->current != NULL) {
+			block->prev = arena->current->prev;
+			arena->current->prev = block;
+		} else {
+			block->prev = NULL;
+			arena->current = block;
+		}
+		return ARENA_BLOCK_DATA(block);
+	}
+	
+	// Otherwise start a new shared block
+	bs = arena->block_size;
+	if ((block = cpi_malloc(offsetof(arena_block_t, align) + bs)) == NULL) {
+		return NULL;
+	}
+	block->prev = arena->current;
+	block->size = bs;
+	block->used = size;
+	arena->current = block;
+	arena->bytes += offsetof(arena_block_t, align) + bs;
+	arena->num_allocs++;
+	if (bs < CPI_ARENA_MAX_BLOCK_SIZE) {
+		arena->block_size = bs * 2;
+	}
+	return ARENA_BLOCK_DATA(block);
+}
+
+CP_HIDDEN char *cpi_arena_strdup(cpi_arena_t *arena, const char *str) {
+	size_t len;
+	char *dup;
+	
+	assert(str != NULL);
+	len = strlen(str) + 1;
+	if ((dup = cpi_arena_alloc(arena, len * sizeof(char))) != NULL) {
+		memcpy(dup, str, len * sizeof(char));
+	}
+	return dup;
+}
+
+CP_HIDDEN void cpi_arena_usage(const cpi_arena_t *arena, size_t *bytes, size_t *num_allocs) {
+	assert(arena != NULL);
+	*bytes += arena->bytes;
+	*num_allocs += arena->num_allocs;
+}
+
+CP_HIDDEN size_t cpi_arena_used(const cpi_arena_t *arena) {
+	const arena_block_t *block;
+	size_t used = 0;
+	
+	assert(arena != NULL);
+	for (block = arena->current; block != NULL; block = block->prev) {
+		used += block->used;
+	}
+	return used;
+}
+
+CP_HIDDEN void cpi_destroy_arena(cpi_arena_t *arena) {
+	arena_block_t *block;
+	
+	assert(arena != NULL);
+	block = arena->current;
+	while (block != NULL) {
+		arena_block_t *prev = block->prev;
+		cpi_free(block);
+		block = prev;
+	}
+	cpi_free(arena);
 }
 
 static const char *vercmp_nondigit_end(const char *v) {
@@ -213,3 +708,179 @@ CP_HIDDEN int cpi_vercmp(const char *v1, const char *v2) {
 	}
 	return 0;
 }
+
+CP_HIDDEN int cpi_version_key(const char *v, int *key, int size) {
+	int len = 0;
+	int trimmed = 0;
+	
+	while (*v != '\0') {
+		const char *vn;
+		int value;
+		
+		// Non-digit characters followed by a terminator
+		vn = vercmp_nondigit_end(v);
+		do {
+			value = (v < vn ? vercmp_char_value(*v++) : 0);
+			if (len < size) {
+				key[len] = value;
+			}
+			len++;
+			if (value != 0) {
+				trimmed = len;
+			}
+		} while (value != 0);
+		
+		// The numeric value of the digits
+		vn = vercmp_digit_end(v);
+		value = vercmp_num_value(v, vn);
+		if (len < size) {
+			key[len] = value;
+		}
+		len++;
+		if (value != 0) {
+			trimmed = len;
+		}
+		v = vn;
+	}
+	return trimmed;
+}
+
+CP_HIDDEN int cpi_parse_version(cpi_arena_t *arena, const char *v, cpi_version_t *version) {
+	int *key;
+	int len;
+	
+	version->key = NULL;
+	if (v == NULL) {
+		version->len = -1;
+		return 1;
+	}
+	if ((len = cpi_version_key(v, NULL, 0)) > 0) {
+		if ((key = cpi_arena_alloc(arena, len * sizeof(int))) == NULL) {
+			return 0;
+		}
+		cpi_version_key(v, key, len);
+		version->key = key;
+	}
+	version->len = len;
+	return 1;
+}
+
+CP_HIDDEN int cpi_version_cmp(const cpi_version_t *v1, const cpi_version_t *v2) {
+	int i, n;
+	
+	// Check for NULL versions
+	if (v1->len < 0 || v2->len < 0) {
+		return (v1->len >= 0) - (v2->len >= 0);
+	}
+	
+	// Compare the keys as if the shorter one was padded with zeros
+	n = (v1->len > v2->len ? v1->len : v2->len);
+	for (i = 0; i < n; i++) {
+		int k1 = (i < v1->len ? v1->key[i] : 0);
+		int k2 = (i < v2->len ? v2->key[i] : 0);
+		
+		if (k1 != k2) {
+			return (k1 < k2 ? -1 : 1);
+		}
+	}
+	return 0;
+}
+
+CP_HIDDEN unsigned long long cpi_monotonic_time(void) {
+	unsigned long long t;
+	
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	
+	if (!clock_gettime(CLOCK_MONOTONIC, &ts)) {
+		t = (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	} else {
+		t = (unsigned long long) time(NULL) * 1000000000ULL;
+	}
+#elif defined(HAVE_GETTIMEOFDAY)
+	struct timeval tv;
+	
+	gettimeofday(&tv, NULL);
+	t = (unsigned long long) tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#else
+	t = (unsigned long long) time(NULL) * 1000000000ULL;
+#endif
+
+	// Zero is reserved for unrecorded times
+	return (t != 0 ? t : 1);
+}
+
+CP_HIDDEN void cpi_sleep(unsigned long long duration) {
+#if defined(HAVE_NANOSLEEP)
+	struct timespec ts;
+	
+	ts.tv_sec = duration / 1000000000ULL;
+	ts.tv_nsec = duration % 1000000000ULL;
+	nanosleep(&ts, NULL);
+#elif defined(_WIN32)
+	Sleep((DWORD) ((duration + 999999ULL) / 1000000ULL));
+#endif
+}
+
+CP_HIDDEN void cpi_lock_stats_acquired(cpi_lock_stats_t *stats, unsigned long long waited, int exclusive) {
+	stats->summary.acquisitions++;
+	if (waited != 0) {
+		stats->summary.contended++;
+		stats->summary.wait_total += waited;
+		if (waited > stats->summary.wait_max) {
+			stats->summary.wait_max = waited;
+		}
+	}
+	if (exclusive) {
+		stats->holder = NULL;
+		stats->hold_begin = cpi_monotonic_time();
+	}
+}
+
+CP_HIDDEN void cpi_lock_stats_released(cpi_lock_stats_t *stats) {
+	unsigned long long held;
+	cp_lock_holder_stats_t *hs = NULL;
+	int i;
+	
+	if (stats->hold_begin == 0) {
+		return;
+	}
+	held = cpi_monotonic_time() - stats->hold_begin;
+	stats->hold_begin = 0;
+	stats->summary.hold_total += held;
+	if (held > stats->summary.hold_max) {
+		stats->summary.hold_max = held;
+	}
+	
+	// Look up or add the holder, dropping the attribution if out of memory
+	for (i = 0; i < stats->num_holders && hs == NULL; i++) {
+		if (stats->holders[i].function == stats->holder) {
+			hs = stats->holders + i;
+		}
+	}
+	if (hs == NULL) {
+		if (stats->num_holders == stats->max_holders) {
+			int nm = (stats->max_holders > 0 ? stats->max_holders * 2 : 16);
+			cp_lock_holder_stats_t *nh;
+			
+			if ((nh = cpi_realloc(stats->holders, nm * sizeof(cp_lock_holder_stats_t))) == NULL) {
+				return;
+			}
+			stats->holders = nh;
+			stats->max_holders = nm;
+		}
+		hs = stats->holders + stats->num_holders++;
+		memset(hs, 0, sizeof(cp_lock_holder_stats_t));
+		hs->function = stats->holder;
+	}
+	hs->holds++;
+	hs->hold_total += held;
+	if (held > hs->hold_max) {
+		hs->hold_max = held;
+	}
+}
+
+CP_HIDDEN void cpi_lock_stats_reset(cpi_lock_stats_t *stats) {
+	memset(&(stats->summary), 0, sizeof(cp_lock_stats_t));
+	stats->num_holders = 0;
+}
@@ -38,6 +38,75 @@ extern "C" {
 #endif //__cplusplus
 
 
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// An opaque memory arena
+typedef struct cpi_arena_t cpi_arena_t;
+
+/// An opaque open addressing hash table
+typedef struct cpi_hmap_t cpi_hmap_t;
+
+/// A scan over the entries of an open addressing hash table
+typedef struct cpi_hmap_scan_t {
+	
+	/// The table being scanned
+	const cpi_hmap_t *hmap;
+	
+	/// The slot of the previously returned entry
+	size_t index;
+	
+	/// The number of slots still to be visited
+	size_t remaining;
+	
+	/// The key of the previously returned entry or NULL
+	const void *key;
+	
+} cpi_hmap_scan_t;
+
+/**
+ * A version string pre-parsed into a comparison key. Comparing two keys
+ * using ::cpi_version_cmp gives the same ordering as comparing the version
+ * strings using ::cpi_vercmp.
+ */
+typedef struct cpi_version_t {
+	
+	/// The comparison key, or NULL if the key is empty
+	const int *key;
+	
+	/// The number of elements in the key, or -1 for a NULL version
+	int len;
+	
+} cpi_version_t;
+
+/**
+ * Contention statistics of a lock. The lock implementation updates the
+ * statistics while holding its internal state protection.
+ */
+typedef struct cpi_lock_stats_t {
+	
+	/// The summary counters
+	cp_lock_stats_t summary;
+	
+	/// The API function of the current exclusive hold, or NULL if none
+	const char *holder;
+	
+	/// The monotonic time when the current exclusive hold began, or zero
+	unsigned long long hold_begin;
+	
+	/// The statistics of the completed holds per API function
+	cp_lock_holder_stats_t *holders;
+	
+	/// The number of entries in holders
+	int num_holders;
+	
+	/// The capacity of holders
+	int max_holders;
+	
+} cpi_lock_stats_t;
+
+
 /* ------------------------------------------------------------------------
  * Function declarations
  * ----------------------------------------------------------------------*/
@@ -89,6 +158,130 @@ CP_HIDDEN int cpi_ptrset_remove(list_t *set, const void *ptr);
 CP_HIDDEN int cpi_ptrset_contains(list_t *set, const void *ptr) CP_GCC_PURE;
 
 
+/**
+ * Compares strings. Identical pointers, such as two references to the same
+ * interned string, compare equal without comparing the contents.
+ * 
+ * @param str1 the first string
+ * @param str2 the second string
+ * @return zero if the strings are equal, otherwise non-zero
+ */
+CP_HIDDEN int cpi_comp_str(const void *str1, const void *str2) CP_GCC_PURE;
+
+
+// Open addressing hash tables
+
+/**
+ * Creates a new open addressing hash table. The table uses Robin Hood
+ * hashing with stored hash values and backward shift deletion, so
+ * entries are stored inline in a single slot array. The key pointers
+ * are stored in the table and must stay valid while the entry exists.
+ * 
+ * @param compare the key comparison function, returning zero for equal keys
+ * @param hashf the key hash function or NULL for string keys
+ * @return the table or NULL if memory allocation failed
+ */
+CP_HIDDEN cpi_hmap_t *cpi_create_hmap(int (*compare)(const void *, const void *), hash_val_t (*hashf)(const void *)) CP_GCC_NONNULL(1);
+
+/**
+ * Destroys a hash table. The keys and values are not released.
+ * 
+ * @param hmap the table to be destroyed
+ */
+CP_HIDDEN void cpi_destroy_hmap(cpi_hmap_t *hmap) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the number of entries in a hash table.
+ * 
+ * @param hmap the table
+ * @return the number of entries
+ */
+CP_HIDDEN size_t cpi_hmap_count(const cpi_hmap_t *hmap) CP_GCC_PURE CP_GCC_NONNULL(1);
+
+/**
+ * Returns the number of slots allocated for a hash table.
+ * 
+ * @param hmap the table
+ * @return the number of slots
+ */
+CP_HIDDEN size_t cpi_hmap_slots(const cpi_hmap_t *hmap) CP_GCC_PURE CP_GCC_NONNULL(1);
+
+/**
+ * Returns the value associated with a key.
+ * 
+ * @param hmap the table
+ * @param key the key
+ * @return the value or NULL if the key is not included
+ */
+CP_HIDDEN void *cpi_hmap_get(const cpi_hmap_t *hmap, const void *key) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Associates a value with a key, replacing any previous value.
+ * 
+ * @param hmap the table
+ * @param key the key
+ * @param value the value, must not be NULL
+ * @return non-zero on success or zero if memory allocation failed
+ */
+CP_HIDDEN int cpi_hmap_put(cpi_hmap_t *hmap, const void *key, void *value) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Removes a key from a hash table. The entry most recently returned by
+ * an ongoing scan may be removed without disturbing the scan.
+ * 
+ * @param hmap the table
+ * @param key the key
+ * @return the removed value or NULL if the key was not included
+ */
+CP_HIDDEN void *cpi_hmap_remove(cpi_hmap_t *hmap, const void *key) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Makes room for the specified number of entries so that inserting
+ * them does not have to grow the table.
+ * 
+ * @param hmap the table
+ * @param n the total number of entries expected
+ * @return non-zero on success or zero if memory allocation failed
+ */
+CP_HIDDEN int cpi_hmap_reserve(cpi_hmap_t *hmap, size_t n) CP_GCC_NONNULL(1);
+
+/**
+ * Shrinks a hash table to the smallest size holding its current entries
+ * within the maximum load factor. The table is left as it is if memory
+ * allocation fails.
+ * 
+ * @param hmap the table
+ */
+CP_HIDDEN void cpi_hmap_compact(cpi_hmap_t *hmap) CP_GCC_NONNULL(1);
+
+/**
+ * Returns the number of bytes allocated for a hash table.
+ * 
+ * @param hmap the table
+ * @return the number of bytes allocated
+ */
+CP_HIDDEN size_t cpi_hmap_memory(const cpi_hmap_t *hmap) CP_GCC_PURE CP_GCC_NONNULL(1);
+
+/**
+ * Begins a scan over the entries of a hash table. Entries must not be
+ * added to the table during the scan and only the entry most recently
+ * returned may be removed.
+ * 
+ * @param scan the scan to be initialized
+ * @param hmap the table
+ */
+CP_HIDDEN void cpi_hmap_scan_begin(cpi_hmap_scan_t *scan, const cpi_hmap_t *hmap) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the next entry of a scan.
+ * 
+ * @param scan the scan
+ * @param key filled with the key of the entry, or NULL if not needed
+ * @return the value of the entry or NULL if all entries have been scanned
+ */
+CP_HIDDEN void *cpi_hmap_scan_next(cpi_hmap_scan_t *scan, const void **key) CP_GCC_NONNULL(1);
+
+
 // Other list processing utility functions 
 
 /**
@@ -102,6 +295,137 @@ CP_HIDDEN int cpi_ptrset_contains(list_t *set, const void *ptr) CP_GCC_PURE;
 CP_HIDDEN void cpi_process_free_ptr(list_t *list, lnode_t *node, void *dummy);
 
 
+// Memory allocation
+
+/**
+ * Allocates memory using the allocator set by ::cp_set_allocator or the
+ * system allocator by default. All memory owned by the framework is
+ * allocated using these functions.
+ * 
+ * @param size the number of bytes to allocate
+ * @return the allocated memory or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_malloc(size_t size);
+
+/**
+ * Allocates zero initialized memory for an array.
+ * 
+ * @param nmemb the number of array elements
+ * @param size the size of an array element
+ * @return the allocated memory or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_calloc(size_t nmemb, size_t size);
+
+/**
+ * Resizes memory allocated using ::cpi_malloc.
+ * 
+ * @param ptr the memory to be resized or NULL
+ * @param size the new size in bytes
+ * @return the resized memory or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_realloc(void *ptr, size_t size);
+
+/**
+ * Releases memory allocated using ::cpi_malloc, ::cpi_calloc,
+ * ::cpi_realloc or ::cpi_strdup.
+ * 
+ * @param ptr the memory to be released or NULL
+ */
+CP_HIDDEN void cpi_free(void *ptr);
+
+/**
+ * Duplicates a string using ::cpi_malloc.
+ * 
+ * @param str the string to be duplicated
+ * @return the duplicate or NULL if memory allocation failed
+ */
+CP_HIDDEN char *cpi_strdup(const char *str) CP_GCC_NONNULL(1);
+
+/**
+ * Allocates a small fixed size object, such as a list or hash node.
+ * Released objects are kept on per size class free lists while the
+ * framework is initialized and they are reused by later allocations.
+ * 
+ * @param size the size of the object in bytes
+ * @return the allocated object or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_pool_alloc(size_t size);
+
+/**
+ * Releases an object allocated using ::cpi_pool_alloc.
+ * 
+ * @param ptr the object to be released or NULL
+ * @param size the size given when the object was allocated
+ */
+CP_HIDDEN void cpi_pool_free(void *ptr, size_t size);
+
+
+// Memory arenas
+
+/**
+ * Creates a new memory arena. Memory allocated from an arena can not be
+ * released individually. Instead, all of it is released at once when the
+ * arena is destroyed.
+ * 
+ * @return the arena or NULL if memory allocation failed
+ */
+CP_HIDDEN cpi_arena_t *cpi_create_arena(void);
+
+/**
+ * Creates a new memory arena whose first block holds the specified number
+ * of bytes. Used when the total size of the contents is known in advance.
+ * 
+ * @param size the size of the first block in bytes
+ * @return the arena or NULL if memory allocation failed
+ */
+CP_HIDDEN cpi_arena_t *cpi_create_sized_arena(size_t size);
+
+/**
+ * Allocates memory from an arena. The returned memory is suitably aligned
+ * for any kind of variable.
+ * 
+ * @param arena the arena
+ * @param size the number of bytes to allocate
+ * @return pointer to the allocated memory or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_arena_alloc(cpi_arena_t *arena, size_t size) CP_GCC_NONNULL(1);
+
+/**
+ * Makes a copy of the specified string using memory allocated from an arena.
+ * 
+ * @param arena the arena
+ * @param str the string to be copied
+ * @return the copy or NULL if memory allocation failed
+ */
+CP_HIDDEN char *cpi_arena_strdup(cpi_arena_t *arena, const char *str) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Adds the memory usage of an arena to the specified counters. The byte
+ * count includes the unused space of the arena blocks.
+ * 
+ * @param arena the arena
+ * @param bytes the counter for the number of bytes allocated for the arena
+ * @param num_allocs the counter for the number of allocations from the arena
+ */
+CP_HIDDEN void cpi_arena_usage(const cpi_arena_t *arena, size_t *bytes, size_t *num_allocs) CP_GCC_NONNULL(1, 2, 3);
+
+/**
+ * Returns the number of bytes allocated from an arena, including the
+ * alignment padding but excluding the unused space of the arena blocks.
+ * 
+ * @param arena the arena
+ * @return the number of bytes in use
+ */
+CP_HIDDEN size_t cpi_arena_used(const cpi_arena_t *arena) CP_GCC_PURE CP_GCC_NONNULL(1);
+
+/**
+ * Destroys an arena and releases all memory allocated from it.
+ * 
+ * @param arena the arena to be destroyed
+ */
+CP_HIDDEN void cpi_destroy_arena(cpi_arena_t *arena) CP_GCC_NONNULL(1);
+
+
 // Version strings
 
 /**
@@ -123,6 +447,87 @@ CP_HIDDEN void cpi_process_free_ptr(list_t *list, lnode_t *node, void *dummy);
  */
 CP_HIDDEN int cpi_vercmp(const char *v1, const char *v2) CP_GCC_PURE;
 
+/**
+ * Computes the comparison key of a version string. The key consists of
+ * the character values of each non-digit component followed by a zero
+ * terminator and the numeric value of the following digit component.
+ * Trailing zeros are left out because keys are compared as if padded
+ * with zeros. At most @a size elements are stored.
+ * 
+ * @param v the version string
+ * @param key the array to be filled with the key
+ * @param size the size of the array
+ * @return the length of the key
+ */
+CP_HIDDEN int cpi_version_key(const char *v, int *key, int size) CP_GCC_NONNULL(1);
+
+/**
+ * Parses a version string into a comparison key allocated from an arena.
+ * 
+ * @param arena the arena used for the key
+ * @param v the version string or NULL
+ * @param version filled with the parsed version
+ * @return non-zero on success or zero if memory allocation failed
+ */
+CP_HIDDEN int cpi_parse_version(cpi_arena_t *arena, const char *v, cpi_version_t *version) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Compares two pre-parsed versions. A NULL version is earlier than any
+ * non-NULL version. See ::cpi_vercmp for the ordering.
+ * 
+ * @param v1 the first version
+ * @param v2 the second version
+ * @return less than, equal to or greater than zero when @a v1 < @a v2, @a v1 == @a v2 or @a v1 > @a v2, correspondingly
+ */
+CP_HIDDEN int cpi_version_cmp(const cpi_version_t *v1, const cpi_version_t *v2) CP_GCC_NONNULL(1, 2) CP_GCC_PURE;
+
+
+// Time
+
+/**
+ * Returns the current time of a monotonic clock in nanoseconds. Falls back
+ * to the wall clock time if no monotonic clock is available.
+ * 
+ * @return the current time in nanoseconds, never zero
+ */
+CP_HIDDEN unsigned long long cpi_monotonic_time(void);
+
+/**
+ * Suspends the calling thread for the specified duration. Returns
+ * immediately if sleeping is not supported on the platform.
+ * 
+ * @param duration the duration in nanoseconds
+ */
+CP_HIDDEN void cpi_sleep(unsigned long long duration);
+
+
+// Lock statistics
+
+/**
+ * Records an outermost acquisition of a lock. An exclusive acquisition
+ * also begins timing an exclusive hold.
+ * 
+ * @param stats the lock statistics
+ * @param waited the time waited in nanoseconds, or zero if the lock was available
+ * @param exclusive whether the lock was acquired exclusively
+ */
+CP_HIDDEN void cpi_lock_stats_acquired(cpi_lock_stats_t *stats, unsigned long long waited, int exclusive) CP_GCC_NONNULL(1);
+
+/**
+ * Records the end of an exclusive hold of a lock begun by
+ * ::cpi_lock_stats_acquired and attributes it to the current holder.
+ * 
+ * @param stats the lock statistics
+ */
+CP_HIDDEN void cpi_lock_stats_released(cpi_lock_stats_t *stats) CP_GCC_NONNULL(1);
+
+/**
+ * Resets the lock statistics, keeping the allocated holder table.
+ * 
+ * @param stats the lock statistics
+ */
+CP_HIDDEN void cpi_lock_stats_reset(cpi_lock_stats_t *stats) CP_GCC_NONNULL(1);
+
 
 #ifdef __cplusplus
 }
@@ -35,6 +35,8 @@
 #ifndef CPLUFFXX_H_
 #define CPLUFFXX_H_
 
+#include <string>
+#include <vector>
 #include <cpluffxx/defines.h>
 #include <cpluffxx/except.h>
 #include <cpluffxx/enums.h>
@@ -54,6 +56,8 @@ class plugin_import;
 class ext_point_info;
 class extension_info;
 class cfg_element;
+template <typename T> class symbol_ref;
+template <typename R> class async_result;
 
 /**
  * The core class used for global initialization and to access global
@@ -186,15 +190,278 @@ public:
 	 */
 	virtual bool is_logged(logger::severity severity) throw () = 0;
 
+	/**
+	 * Resolves a symbol provided by the specified plug-in and returns a
+	 * typed reference to it. The plug-in is started automatically if it is
+	 * not already active. The symbol is released when the returned
+	 * reference is destroyed or explicitly released, so a resolved symbol
+	 * can be kept in a member variable instead of being resolved again on
+	 * each use. The reference must be released before this plug-in context
+	 * is destroyed. Otherwise the semantics are those of
+	 * ::cp_resolve_symbol.
+	 * 
+	 * @param plugin_id the identifier of the symbol defining plug-in
+	 * @param name the name of the symbol
+	 * @return a reference to the resolved symbol
+	 * @throw api_error if the symbol could not be resolved
+	 * @sa symbol_ref
+	 */
+	template <typename T> symbol_ref<T> resolve_symbol(const char* plugin_id, const char* name) throw (api_error);
+
+	/**
+	 * @internal
+	 * Resolves a symbol provided by the specified plug-in. Used by
+	 * @ref resolve_symbol.
+	 * 
+	 * @param plugin_id the identifier of the symbol defining plug-in
+	 * @param name the name of the symbol
+	 * @return the pointer associated with the symbol
+	 * @throw api_error if the symbol could not be resolved
+	 */
+	virtual void* resolve_symbol_ptr(const char* plugin_id, const char* name) throw (api_error) = 0;
+
+	/**
+	 * @internal
+	 * Releases a symbol resolved using @ref resolve_symbol_ptr. Used by
+	 * @ref symbol_ref.
+	 * 
+	 * @param ptr the pointer associated with the symbol
+	 */
+	virtual void release_symbol_ptr(const void* ptr) throw () = 0;
+
 protected:
 
 	/** @internal */
 	inline ~plugin_context() {};
 };
 
+/**
+ * A typed reference to a symbol resolved using
+ * plugin_context::resolve_symbol. The symbol is released when the reference
+ * is destroyed. References can be moved but not copied, so that each
+ * resolution is released exactly once. The type parameter may be an object
+ * type or a function type, in which case @ref get returns a function
+ * pointer. Accessing the symbol does not lock the plug-in context.
+ */
+template <typename T> class symbol_ref {
+public:
+
+	/**
+	 * Constructs an empty reference.
+	 */
+	inline symbol_ref() throw ():
+	context(NULL), ptr(NULL) {}
+
+	/**
+	 * Constructs a reference by taking over the symbol of another
+	 * reference. The other reference becomes empty.
+	 * 
+	 * @param other the reference to be moved
+	 */
+	inline symbol_ref(symbol_ref&& other) throw ():
+	context(other.context), ptr(other.ptr) {
+		other.context = NULL;
+		other.ptr = NULL;
+	}
+
+	/**
+	 * Releases the referenced symbol, if any.
+	 */
+	inline ~symbol_ref() throw () {
+		release();
+	}
+
+	/**
+	 * Releases the currently referenced symbol, if any, and takes over the
+	 * symbol of another reference. The other reference becomes empty.
+	 * 
+	 * @param other the reference to be moved
+	 * @return this reference
+	 */
+	inline symbol_ref& operator=(symbol_ref&& other) throw () {
+		if (this != &other) {
+			release();
+			context = other.context;
+			ptr = other.ptr;
+			other.context = NULL;
+			other.ptr = NULL;
+		}
+		return *this;
+	}
+
+	/**
+	 * Returns the referenced symbol.
+	 * 
+	 * @return the pointer associated with the symbol or NULL if empty
+	 */
+	inline T* get() const throw () {
+		return reinterpret_cast<T*>(ptr);
+	}
+
+	/**
+	 * Returns the referenced symbol.
+	 * 
+	 * @return the pointer associated with the symbol
+	 */
+	inline T* operator->() const throw () {
+		return get();
+	}
+
+	/**
+	 * Returns the referenced object or function.
+	 * 
+	 * @return the referenced object or function
+	 */
+	inline T& operator*() const throw () {
+		return *get();
+	}
+
+	/**
+	 * Returns whether this reference is empty.
+	 * 
+	 * @return whether this reference is empty
+	 */
+	inline bool empty() const throw () {
+		return ptr == NULL;
+	}
+
+	/**
+	 * Releases the referenced symbol, if any. The reference becomes empty.
+	 */
+	inline void release() throw () {
+		if (ptr != NULL) {
+			context->release_symbol_ptr(ptr);
+			context = NULL;
+			ptr = NULL;
+		}
+	}
+
+private:
+
+	friend class plugin_context;
+
+	/**
+	 * Constructs a reference to a resolved symbol.
+	 * 
+	 * @param context the plug-in context used to resolve the symbol
+	 * @param ptr the pointer associated with the symbol
+	 */
+	inline symbol_ref(plugin_context* context, void* ptr) throw ():
+	context(context), ptr(ptr) {}
+
+	symbol_ref(const symbol_ref&);
+
+	symbol_ref& operator=(const symbol_ref&);
+
+	/** The plug-in context used to resolve the symbol, or NULL if empty */
+	plugin_context* context;
+
+	/** The pointer associated with the symbol, or NULL if empty */
+	void* ptr;
+};
+
+template <typename T> inline symbol_ref<T> plugin_context::resolve_symbol(const char* plugin_id, const char* name) throw (api_error) {
+	return symbol_ref<T>(this, resolve_symbol_ptr(plugin_id, name));
+}
+
+/**
+ * The result of an asynchronous plug-in container operation. The result
+ * becomes available when the operation completes and it is obtained
+ * using @ref get. Results can be moved but not copied. A result may be
+ * destroyed without waiting for the operation. The type parameter is the
+ * result type of the operation, or @c void for operations without a
+ * result. This class is not intended to be subclassed by the client
+ * program.
+ */
+template <typename R> class async_result {
+public:
+
+	/**
+	 * Constructs an empty result not associated with any operation.
+	 */
+	async_result() throw ();
+
+	/**
+	 * Constructs a result by taking over the operation of another result.
+	 * The other result becomes empty.
+	 * 
+	 * @param other the result to be moved
+	 */
+	async_result(async_result&& other) throw ();
+
+	/**
+	 * Destructs the result without waiting for the operation.
+	 */
+	~async_result() throw ();
+
+	/**
+	 * Takes over the operation of another result. The other result
+	 * becomes empty.
+	 * 
+	 * @param other the result to be moved
+	 * @return this result
+	 */
+	async_result& operator=(async_result&& other) throw ();
+
+	/**
+	 * Returns whether this result is associated with an operation whose
+	 * result has not yet been obtained.
+	 * 
+	 * @return whether the result can be obtained using @ref get
+	 */
+	bool valid() const throw ();
+
+	/**
+	 * Waits for the operation to complete. Returns immediately if the
+	 * result is not valid.
+	 */
+	void wait() const throw ();
+
+	/**
+	 * Waits for the operation to complete and returns its result. The
+	 * result can only be obtained once, after which it is no longer valid.
+	 * 
+	 * @return the result of the operation
+	 * @throw api_error if the operation failed or the result is not valid
+	 */
+	R get() throw (api_error);
+
+private:
+
+	friend class plugin_container_impl;
+
+	/** @internal The implementation specific state of the operation */
+	class state;
+
+	/**
+	 * @internal
+	 * Constructs a result for an operation.
+	 * 
+	 * @param impl the state of the operation
+	 */
+	explicit async_result(state* impl) throw ();
+
+	async_result(const async_result&);
+
+	async_result& operator=(const async_result&);
+
+	/** @internal The state of the operation, or NULL if empty */
+	state* impl;
+};
+
 /**
  * A plug-in container is a container for plug-ins. It represents plug-in
  * context from the view point of the main program.
+ * 
+ * Operations ending with @c _async return an async_result instead of
+ * blocking, so that the main program can overlap plug-in management with
+ * its own initialization. Errors of such operations are thrown as
+ * api_error by async_result::get. Individual plug-in starts and stops are
+ * queued to the framework worker of the plug-in context, while the other
+ * operations run in a background thread. Without multi-threading support
+ * the operations are completed before the result is returned. A result
+ * may be discarded without waiting for the operation. A container waits
+ * for its background operations to complete before it is destroyed.
  */
 class plugin_container : public virtual plugin_context {
 public:
@@ -232,6 +499,16 @@ public:
 	 */
 	virtual void unregister_plugin_collections() throw () = 0;
 
+	/**
+	 * Enables or disables sharing of loaded plug-in descriptors with other
+	 * plug-in containers using ::cp_set_shared_descriptors. While sharing
+	 * is enabled, loading an unchanged descriptor again returns the same
+	 * plug-in information object as long as it is referenced.
+	 * 
+	 * @param enabled whether to share loaded plug-in descriptors
+	 */
+	virtual void set_shared_descriptors(bool enabled) throw () = 0;
+
 	/**
 	 * Loads a plug-in descriptor from the specified plug-in installation
 	 * path and returns information about the plug-in. The plug-in descriptor
@@ -246,6 +523,184 @@ public:
 	 */
 	virtual shared_ptr<plugin_info> load_plugin_descriptor(const char* path) throw (api_error) = 0;
 
+	/**
+	 * Loads plug-in descriptors from the specified plug-in installation
+	 * paths. Works like @ref load_plugin_descriptor for each path. If
+	 * loading any of the descriptors fails, the already loaded descriptors
+	 * are released.
+	 * 
+	 * @param paths the installation paths of the plug-ins
+	 * @return the plug-in information structures, in the order of the paths
+	 * @throw api_error if loading fails or a plug-in descriptor is malformed
+	 */
+	virtual std::vector<shared_ptr<plugin_info> > load_plugin_descriptors(const std::vector<std::string>& paths) throw (api_error) = 0;
+
+	/**
+	 * Loads plug-in descriptors from a range of plug-in installation
+	 * paths given as C strings or strings.
+	 * 
+	 * @param first the beginning of the range of paths
+	 * @param last the end of the range of paths
+	 * @return the plug-in information structures, in the order of the paths
+	 * @throw api_error if loading fails or a plug-in descriptor is malformed
+	 */
+	template <typename InputIterator> inline std::vector<shared_ptr<plugin_info> > load_plugin_descriptors(InputIterator first, InputIterator last) throw (api_error) {
+		return load_plugin_descriptors(std::vector<std::string>(first, last));
+	}
+
+	/**
+	 * Loads a plug-in descriptor in the background. Otherwise works like
+	 * @ref load_plugin_descriptor. Loading errors are reported by the
+	 * returned result.
+	 * 
+	 * @param path the installation path of the plug-in
+	 * @return the result holding the plug-in information structure
+	 * @throw api_error if insufficient resources to start the operation
+	 */
+	virtual async_result<shared_ptr<plugin_info> > load_plugin_descriptor_async(const char* path) throw (api_error) = 0;
+
+	/**
+	 * Loads plug-in descriptors in the background. Otherwise works like
+	 * @ref load_plugin_descriptors. Loading errors are reported by the
+	 * returned result.
+	 * 
+	 * @param paths the installation paths of the plug-ins
+	 * @return the result holding the plug-in information structures
+	 * @throw api_error if insufficient resources to start the operation
+	 */
+	virtual async_result<std::vector<shared_ptr<plugin_info> > > load_plugin_descriptors_async(const std::vector<std::string>& paths) throw (api_error) = 0;
+
+	/**
+	 * Scans the registered plug-in collections for plug-ins, installing new
+	 * plug-ins and upgrading installed plug-ins. The semantics and the flags
+	 * are those of ::cp_scan_plugins.
+	 * 
+	 * @param flags the bitmask of C API scan flags, such as #CP_SP_UPGRADE
+	 * @throw api_error if the scan fails
+	 */
+	virtual void scan_plugins(int flags) throw (api_error) = 0;
+
+	/**
+	 * Scans for plug-ins in the background. Otherwise works like
+	 * @ref scan_plugins. Scan errors are reported by the returned result.
+	 * 
+	 * @param flags the bitmask of C API scan flags, such as #CP_SP_UPGRADE
+	 * @return the result signaling the completion of the scan
+	 * @throw api_error if insufficient resources to start the operation
+	 */
+	virtual async_result<void> scan_plugins_async(int flags) throw (api_error) = 0;
+
+	/**
+	 * Starts a plug-in and the plug-ins it imports. The semantics are those
+	 * of ::cp_start_plugin.
+	 * 
+	 * @param id the identifier of the plug-in to be started
+	 * @throw api_error if the plug-in could not be started
+	 */
+	virtual void start_plugin(const char* id) throw (api_error) = 0;
+
+	/**
+	 * Starts the specified plug-ins and the plug-ins they import using
+	 * several threads, as ::cp_start_plugins_parallel does.
+	 * 
+	 * @param ids the identifiers of the plug-ins to be started
+	 * @param num_threads the total number of threads, including the calling thread
+	 * @throw api_error if some plug-in could not be started
+	 */
+	virtual void start_plugins(const std::vector<std::string>& ids, int num_threads = 1) throw (api_error) = 0;
+
+	/**
+	 * Starts a range of plug-ins whose identifiers are given as C strings
+	 * or strings. Otherwise works like @ref start_plugins.
+	 * 
+	 * @param first the beginning of the range of plug-in identifiers
+	 * @param last the end of the range of plug-in identifiers
+	 * @param num_threads the total number of threads, including the calling thread
+	 * @throw api_error if some plug-in could not be started
+	 */
+	template <typename InputIterator> inline void start_plugins(InputIterator first, InputIterator last, int num_threads = 1) throw (api_error) {
+		start_plugins(std::vector<std::string>(first, last), num_threads);
+	}
+
+	/**
+	 * Starts a plug-in asynchronously using ::cp_start_plugin_async.
+	 * Start errors are reported by the returned result.
+	 * 
+	 * @param id the identifier of the plug-in to be started
+	 * @return the result signaling the completion of the start
+	 * @throw api_error if insufficient resources to queue the request
+	 */
+	virtual async_result<void> start_plugin_async(const char* id) throw (api_error) = 0;
+
+	/**
+	 * Starts plug-ins in the background. Otherwise works like
+	 * @ref start_plugins. Start errors are reported by the returned result.
+	 * 
+	 * @param ids the identifiers of the plug-ins to be started
+	 * @param num_threads the total number of threads, including the background thread
+	 * @return the result signaling the completion of the starts
+	 * @throw api_error if insufficient resources to start the operation
+	 */
+	virtual async_result<void> start_plugins_async(const std::vector<std::string>& ids, int num_threads = 1) throw (api_error) = 0;
+
+	/**
+	 * Stops a plug-in and the active plug-ins depending on it. The
+	 * semantics are those of ::cp_stop_plugin.
+	 * 
+	 * @param id the identifier of the plug-in to be stopped
+	 * @throw api_error if the plug-in is unknown
+	 */
+	virtual void stop_plugin(const char* id) throw (api_error) = 0;
+
+	/**
+	 * Stops the specified plug-ins and the active plug-ins depending on
+	 * them. All the plug-ins are stopped even if some of them are unknown.
+	 * 
+	 * @param ids the identifiers of the plug-ins to be stopped
+	 * @throw api_error if some plug-in is unknown
+	 */
+	virtual void stop_plugins(const std::vector<std::string>& ids) throw (api_error) = 0;
+
+	/**
+	 * Stops a range of plug-ins whose identifiers are given as C strings
+	 * or strings. Otherwise works like @ref stop_plugins.
+	 * 
+	 * @param first the beginning of the range of plug-in identifiers
+	 * @param last the end of the range of plug-in identifiers
+	 * @throw api_error if some plug-in is unknown
+	 */
+	template <typename InputIterator> inline void stop_plugins(InputIterator first, InputIterator last) throw (api_error) {
+		stop_plugins(std::vector<std::string>(first, last));
+	}
+
+	/**
+	 * Stops all active plug-ins. If more than one thread is specified, the
+	 * plug-ins are stopped as by ::cp_stop_plugins_parallel.
+	 * 
+	 * @param num_threads the total number of threads, including the calling thread
+	 */
+	virtual void stop_all_plugins(int num_threads = 1) throw () = 0;
+
+	/**
+	 * Stops a plug-in asynchronously using ::cp_stop_plugin_async.
+	 * Stop errors are reported by the returned result.
+	 * 
+	 * @param id the identifier of the plug-in to be stopped
+	 * @return the result signaling the completion of the stop
+	 * @throw api_error if insufficient resources to queue the request
+	 */
+	virtual async_result<void> stop_plugin_async(const char* id) throw (api_error) = 0;
+
+	/**
+	 * Stops all active plug-ins in the background. Otherwise works like
+	 * @ref stop_all_plugins.
+	 * 
+	 * @param num_threads the total number of threads, including the background thread
+	 * @return the result signaling the completion of the stops
+	 * @throw api_error if insufficient resources to start the operation
+	 */
+	virtual async_result<void> stop_all_plugins_async(int num_threads = 1) throw (api_error) = 0;
+
 protected:
 
 	/** @internal */
@@ -28,7 +28,10 @@
 #ifndef CPLUFFXX_INFO_H_
 #define CPLUFFXX_INFO_H_
 
+#include <cstddef>
 #include <cstring>
+#include <iterator>
+#include <utility>
 #include <vector>
 #include <map>
 #include <cpluff.h>
@@ -56,6 +59,305 @@ public:
 	}
 };
 
+class cfg_element;
+
+/**
+ * A non-owning view of a C API information array. The iterators wrap the
+ * array elements into C++ information objects on the fly without
+ * allocating memory. The view is valid as long as the underlying
+ * information is. This class is not intended to be instantiated by the
+ * client program.
+ *
+ * @param T the C++ wrapper type
+ * @param C the C API element type
+ */
+template <typename T, typename C>
+class info_range {
+public:
+
+	/**
+	 * An iterator over the wrapped elements. Dereferencing returns a
+	 * wrapper by value.
+	 */
+	class iterator {
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef T reference;
+
+		/**
+		 * @internal
+		 * Constructs an iterator at the specified element.
+		 * 
+		 * @param ptr the C API element
+		 * @param parent the parent configuration element or NULL
+		 */
+		inline iterator(const C* ptr, cfg_element* parent):
+		ptr(ptr), parent(parent) {}
+
+		/**
+		 * Returns the wrapped current element.
+		 * 
+		 * @return the wrapped current element
+		 */
+		inline T operator*() const {
+			return wrap_info(ptr, parent);
+		}
+
+		/**
+		 * Advances to the next element.
+		 * 
+		 * @return this iterator
+		 */
+		inline iterator& operator++() {
+			ptr++;
+			return *this;
+		}
+
+		/**
+		 * Advances to the next element.
+		 * 
+		 * @return the iterator before advancing
+		 */
+		inline iterator operator++(int) {
+			iterator i(*this);
+			ptr++;
+			return i;
+		}
+
+		inline bool operator==(const iterator& i) const {
+			return ptr == i.ptr;
+		}
+
+		inline bool operator!=(const iterator& i) const {
+			return ptr != i.ptr;
+		}
+
+	private:
+
+		/** @internal The current C API element */
+		const C* ptr;
+
+		/** @internal The parent configuration element or NULL */
+		cfg_element* parent;
+	};
+
+	/**
+	 * @internal
+	 * Constructs a view of the specified C API array.
+	 * 
+	 * @param first the first element of the array
+	 * @param num the number of elements in the array
+	 * @param parent the parent configuration element of the elements or NULL
+	 */
+	inline info_range(const C* first, unsigned int num, cfg_element* parent = NULL):
+	first(first), num(num), parent(parent) {}
+
+	/**
+	 * Returns an iterator at the first element.
+	 * 
+	 * @return an iterator at the first element
+	 */
+	inline iterator begin() const {
+		return iterator(first, parent);
+	}
+
+	/**
+	 * Returns an iterator past the last element.
+	 * 
+	 * @return an iterator past the last element
+	 */
+	inline iterator end() const {
+		return iterator(first + num, parent);
+	}
+
+	/**
+	 * Returns the number of elements.
+	 * 
+	 * @return the number of elements
+	 */
+	inline unsigned int size() const {
+		return num;
+	}
+
+	/**
+	 * Returns whether there are no elements.
+	 * 
+	 * @return whether there are no elements
+	 */
+	inline bool empty() const {
+		return num == 0;
+	}
+
+	/**
+	 * Returns the wrapped element at the specified index.
+	 * 
+	 * @param i the index of the element
+	 * @return the wrapped element
+	 */
+	inline T operator[](unsigned int i) const {
+		return wrap_info(first + i, parent);
+	}
+
+private:
+
+	/** @internal The first C API element */
+	const C* first;
+
+	/** @internal The number of elements */
+	unsigned int num;
+
+	/** @internal The parent configuration element or NULL */
+	cfg_element* parent;
+};
+
+/**
+ * A non-owning view of the attributes of a C API configuration element.
+ * The iterators return attribute name and value pairs without allocating
+ * memory. This class is not intended to be instantiated by the client
+ * program.
+ */
+class attribute_range {
+public:
+
+	/** An attribute name and value pair */
+	typedef std::pair<const char*, const char*> value_type;
+
+	/**
+	 * An iterator over the attribute name and value pairs.
+	 */
+	class iterator {
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef attribute_range::value_type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const value_type* pointer;
+		typedef value_type reference;
+
+		/**
+		 * @internal
+		 * Constructs an iterator at the specified attribute.
+		 * 
+		 * @param ptr the name of the attribute in the C API array
+		 */
+		inline iterator(char* const* ptr): ptr(ptr) {}
+
+		/**
+		 * Returns the current attribute name and value pair.
+		 * 
+		 * @return the current attribute name and value pair
+		 */
+		inline value_type operator*() const {
+			return value_type(ptr[0], ptr[1]);
+		}
+
+		/**
+		 * Advances to the next attribute.
+		 * 
+		 * @return this iterator
+		 */
+		inline iterator& operator++() {
+			ptr += 2;
+			return *this;
+		}
+
+		/**
+		 * Advances to the next attribute.
+		 * 
+		 * @return the iterator before advancing
+		 */
+		inline iterator operator++(int) {
+			iterator i(*this);
+			ptr += 2;
+			return i;
+		}
+
+		inline bool operator==(const iterator& i) const {
+			return ptr == i.ptr;
+		}
+
+		inline bool operator!=(const iterator& i) const {
+			return ptr != i.ptr;
+		}
+
+	private:
+
+		/** @internal The name of the current attribute */
+		char* const* ptr;
+	};
+
+	/**
+	 * @internal
+	 * Constructs a view of the attributes of a C API configuration element.
+	 * 
+	 * @param cfge the C API configuration element
+	 */
+	inline attribute_range(const cp_cfg_element_t* cfge):
+	atts(cfge->atts), num(cfge->num_atts) {}
+
+	/**
+	 * Returns an iterator at the first attribute.
+	 * 
+	 * @return an iterator at the first attribute
+	 */
+	inline iterator begin() const {
+		return iterator(atts);
+	}
+
+	/**
+	 * Returns an iterator past the last attribute.
+	 * 
+	 * @return an iterator past the last attribute
+	 */
+	inline iterator end() const {
+		return iterator(atts + 2 * num);
+	}
+
+	/**
+	 * Returns the number of attributes.
+	 * 
+	 * @return the number of attributes
+	 */
+	inline unsigned int size() const {
+		return num;
+	}
+
+	/**
+	 * Returns whether there are no attributes.
+	 * 
+	 * @return whether there are no attributes
+	 */
+	inline bool empty() const {
+		return num == 0;
+	}
+
+	/**
+	 * Returns the value of the specified attribute or NULL if the
+	 * attribute does not exist.
+	 * 
+	 * @param name the name of the attribute
+	 * @return the value of the attribute or NULL
+	 */
+	inline const char* value(const char* name) const {
+		for (unsigned int i = 0; i < num; i++) {
+			if (!strcmp(atts[2*i], name)) {
+				return atts[2*i + 1];
+			}
+		}
+		return NULL;
+	}
+
+private:
+
+	/** @internal The attribute names and values */
+	char* const* atts;
+
+	/** @internal The number of attributes */
+	unsigned int num;
+};
+
 /**
  * Describes plugins dependency to other plug-ins. Import information can be
  * obtained using plugin_info::getImports. This class is not intended to be
@@ -196,7 +498,8 @@ protected:
  * element is available from extension_info::getConfiguration and
  * descendant elements can be accessed via their ancestors. The actual
  * semantics of the configuration information are defined by the associated
- * extension point. This class is not intended to be subclassed by the client
+ * extension point. The attribute map and the child elements are built on
+ * first access. This class is not intended to be subclassed by the client
  * program.
  */
 class cfg_element {
@@ -209,9 +512,8 @@ public:
 	 * 
 	 * @param cfge the associated C API configuration element
 	 */
-	inline cfg_element(const cp_cfg_element_t* cfge) {
-	 	cfg_element(NULL, cfge);
-	 }
+	inline cfg_element(const cp_cfg_element_t* cfge):
+	cfge(cfge), cfg_parent(NULL), attrs_built(false), children_built(false) {}
 
 	/**
 	 * @internal
@@ -221,7 +523,35 @@ public:
 	 * @param parent the parent element or NULL if none
 	 * @param cfge the associated C API configuration element
 	 */
-	cfg_element(cfg_element* parent, const cp_cfg_element_t* cfge);
+	inline cfg_element(cfg_element* parent, const cp_cfg_element_t* cfge):
+	cfge(cfge), cfg_parent(parent), attrs_built(false), children_built(false) {}
+
+	/**
+	 * @internal
+	 * Constructs a copy of a configuration element. The copy builds its
+	 * own attribute map and child elements on first access.
+	 * 
+	 * @param e the element to be copied
+	 */
+	inline cfg_element(const cfg_element& e):
+	cfge(e.cfge), cfg_parent(e.cfg_parent), attrs_built(false), children_built(false) {}
+
+	/**
+	 * @internal
+	 * Destructs a configuration element and the child elements
+	 * built for it.
+	 */
+	~cfg_element();
+
+	/**
+	 * @internal
+	 * Associates this element with the same C API configuration element
+	 * as another element. Built child elements are released.
+	 * 
+	 * @param e the element to be copied
+	 * @return this element
+	 */
+	cfg_element& operator=(const cfg_element& e);
 
 	/**
 	 * Returns the name of the configuration element. This corresponds to the
@@ -240,6 +570,9 @@ public:
 	 * @return the attribute map for this element
 	 */
 	inline const std::map<const char*, const char*, less_str>& attributes() const {
+		if (!attrs_built) {
+			build_attributes();
+		}
 		return attr_map;
 	}
 
@@ -259,22 +592,59 @@ public:
 	 * @return the children of this configuration element as a vector
 	 */
 	inline const std::vector<const cfg_element*>& children() const {
+		if (!children_built) {
+			build_children();
+		}
 		return cfg_children;
 	}
 
+	/**
+	 * Returns a view of the attributes of this element. Unlike
+	 * @ref attributes, the view does not build a map.
+	 * 
+	 * @return a view of the attributes of this element
+	 */
+	inline attribute_range attribute_view() const {
+		return attribute_range(cfge);
+	}
+
+	/**
+	 * Returns a view of the children of this element. Unlike
+	 * @ref children, the view wraps the children on the fly and does
+	 * not allocate any memory. The wrapped children refer to this element
+	 * as their parent.
+	 * 
+	 * @return a view of the children of this element
+	 */
+	inline info_range<cfg_element, cp_cfg_element_t> child_range() const {
+		return info_range<cfg_element, cp_cfg_element_t>(cfge->children, cfge->num_children, const_cast<cfg_element*>(this));
+	}
+
 protected:
 
 	/** @internal The associated C API configuration element */
 	const cp_cfg_element_t* cfge;
 	
-	/** @internal The attribute map */
-	std::map<const char*, const char*, less_str> attr_map;
+	/** @internal The attribute map, built on first access */
+	mutable std::map<const char*, const char*, less_str> attr_map;
 	
 	/** @internal The parent element or NULL */
 	cfg_element* cfg_parent;
 	
-	/** @internal Children elements */
-	std::vector<const cfg_element*> cfg_children;
+	/** @internal Children elements, built on first access */
+	mutable std::vector<const cfg_element*> cfg_children;
+
+	/** @internal Whether the attribute map has been built */
+	mutable bool attrs_built;
+
+	/** @internal Whether the children elements have been built */
+	mutable bool children_built;
+
+	/** @internal Builds the attribute map */
+	void build_attributes() const;
+
+	/** @internal Builds the children elements */
+	void build_children() const;
 
 };
 
@@ -355,6 +725,17 @@ public:
 		return cfg_root;
 	}
 
+	/**
+	 * Returns a view of the children of the root configuration element.
+	 * This is equivalent to calling cfg_element::child_range on
+	 * @ref configuration.
+	 * 
+	 * @return a view of the children of the root configuration element
+	 */
+	inline info_range<cfg_element, cp_cfg_element_t> cfg_child_range() const {
+		return cfg_root.child_range();
+	}
+
 protected:
 
 	/** @internal The associated C APi extension */
@@ -370,8 +751,9 @@ protected:
  * CPPluginContext::loadPluginDescriptor. Corresponding information about
  * installed plug-ins can be obtained by using CPPluginContext::getPlugin
  * and CPPluginContext::getPlugins. This class corresponds to the top level
- * @a plugin element in a plug-in descriptor file. This class is not intended
- * to be instantiated or subclassed by the client program.
+ * @a plugin element in a plug-in descriptor file. The import, extension
+ * point and extension wrappers are built on first access. This class is
+ * not intended to be instantiated or subclassed by the client program.
  */
 class plugin_info {
 public:
@@ -495,9 +877,22 @@ public:
 	 * @return plug-in imports as a vector
 	 */
 	inline const std::vector<plugin_import>& imports() const {
+		if (imports_vec.size() != pinfo->num_imports) {
+			build_imports();
+		}
 		return imports_vec;
 	}
 
+	/**
+	 * Returns a view of the plug-in imports. Unlike @ref imports, the
+	 * view wraps the imports on the fly and does not allocate any memory.
+	 * 
+	 * @return a view of the plug-in imports
+	 */
+	inline info_range<plugin_import, cp_plugin_import_t> import_range() const {
+		return info_range<plugin_import, cp_plugin_import_t>(pinfo->imports, pinfo->num_imports);
+	}
+
     /**
      * Returns the base name of the plug-in runtime library or NULL
      * if none. A platform specific prefix (for example, "lib") and an extension
@@ -524,24 +919,78 @@ public:
 		return pinfo->runtime_funcs_symbol;
 	}
 
+    /**
+     * Returns the name of symbol pointing to the static symbol export
+     * table or NULL if none. The symbol with this name should point to an
+     * instance of @ref cp_symbol_table_t structure. This corresponds to the
+     * @a symbols attribute of the @a runtime element in a plug-in
+     * descriptor.
+     * 
+     * @return the name of the symbol pointing to the symbol export table or NULL
+     */
+	inline const char* runtime_symbols_symbol() const {
+		return pinfo->runtime_symbols_symbol;
+	}
+
+    /**
+     * Returns whether the plug-in is activated lazily. A lazily activated
+     * plug-in is not started together with the plug-ins importing it but
+     * only when explicitly requested or when a symbol it defines is first
+     * resolved. This corresponds to the @a activation attribute of the
+     * @a runtime element in a plug-in descriptor.
+     *
+     * @return whether the plug-in is activated lazily
+     */
+	inline bool lazy_activation() const {
+		return pinfo->lazy_activation;
+	}
+
 	/**
 	 * Returns the extension points provided by this plug-in.
 	 * 
 	 * @return extension points provided by this plug-in
 	 */
-	inline const std::vector<ext_point_info> ext_points() const {
+	inline const std::vector<ext_point_info>& ext_points() const {
+		if (ext_points_vec.size() != pinfo->num_ext_points) {
+			build_ext_points();
+		}
 		return ext_points_vec;
 	}
+
+	/**
+	 * Returns a view of the extension points provided by this plug-in.
+	 * Unlike @ref ext_points, the view wraps the extension points on the
+	 * fly and does not allocate any memory.
+	 * 
+	 * @return a view of the extension points provided by this plug-in
+	 */
+	inline info_range<ext_point_info, cp_ext_point_t> ext_point_range() const {
+		return info_range<ext_point_info, cp_ext_point_t>(pinfo->ext_points, pinfo->num_ext_points);
+	}
 	
 	/**
 	 * Returns the extensions provided by this plug-in.
 	 * 
 	 * @return extensions provided by this plug-in
 	 */
-	inline const std::vector<extension_info> extensions() const {
+	inline const std::vector<extension_info>& extensions() const {
+		if (extensions_vec.size() != pinfo->num_extensions) {
+			build_extensions();
+		}
 		return extensions_vec;
 	}
 
+	/**
+	 * Returns a view of the extensions provided by this plug-in. Unlike
+	 * @ref extensions, the view wraps the extensions on the fly and does
+	 * not allocate any memory.
+	 * 
+	 * @return a view of the extensions provided by this plug-in
+	 */
+	inline info_range<extension_info, cp_extension_t> extension_range() const {
+		return info_range<extension_info, cp_extension_t>(pinfo->extensions, pinfo->num_extensions);
+	}
+
 	~plugin_info();
 
 protected:
@@ -552,17 +1001,49 @@ protected:
 	/** @internal The C API plug-in descriptor pointer */
 	cp_plugin_info_t* pinfo;
 	
-	/** @internal The plug-in import objects */
-	std::vector<plugin_import> imports_vec;
+	/** @internal The plug-in import objects, built on first access */
+	mutable std::vector<plugin_import> imports_vec;
 	
-	/** @internal The extension point objects */
-	std::vector<ext_point_info> ext_points_vec;
+	/** @internal The extension point objects, built on first access */
+	mutable std::vector<ext_point_info> ext_points_vec;
 	
-	/** @internal The extension objects */
-	std::vector<extension_info> extensions_vec;
+	/** @internal The extension objects, built on first access */
+	mutable std::vector<extension_info> extensions_vec;
+
+	/** @internal Builds the plug-in import objects */
+	void build_imports() const;
+
+	/** @internal Builds the extension point objects */
+	void build_ext_points() const;
+
+	/** @internal Builds the extension objects */
+	void build_extensions() const;
 
 };
 
+/**
+ * @internal
+ * Wraps C API information into C++ information objects for
+ * @ref info_range.
+ */
+/*@{*/
+inline plugin_import wrap_info(const cp_plugin_import_t* pimport, cfg_element*) {
+	return plugin_import(pimport);
+}
+
+inline ext_point_info wrap_info(const cp_ext_point_t* extpt, cfg_element*) {
+	return ext_point_info(extpt);
+}
+
+inline extension_info wrap_info(const cp_extension_t* ext, cfg_element*) {
+	return extension_info(ext);
+}
+
+inline cfg_element wrap_info(const cp_cfg_element_t* cfge, cfg_element* parent) {
+	return cfg_element(parent, cfge);
+}
+/*@}*/
+
 }
 
 #endif /*CPLUFFXX_INFO_H_*/
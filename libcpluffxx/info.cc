@@ -35,34 +35,70 @@
 namespace cpluff {
 
 CP_HIDDEN plugin_info::plugin_info(cp_context_t* context, cp_plugin_info_t* pinfo):
-context(context), pinfo(pinfo) {
+context(context), pinfo(pinfo) {}
+
+plugin_info::~plugin_info() {
+	cp_release_info(context, pinfo);
+}
+
+void plugin_info::build_imports() const {
+	imports_vec.clear();
 	imports_vec.reserve(pinfo->num_imports);
 	for (unsigned int i = 0; i < pinfo->num_imports; i++) {
 		imports_vec.push_back(plugin_import(pinfo->imports + i));
 	}
+}
+
+void plugin_info::build_ext_points() const {
+	ext_points_vec.clear();
 	ext_points_vec.reserve(pinfo->num_ext_points);
 	for (unsigned int i = 0; i < pinfo->num_ext_points; i++) {
 		ext_points_vec.push_back(ext_point_info(pinfo->ext_points + i));
 	}
+}
+
+void plugin_info::build_extensions() const {
+	extensions_vec.clear();
 	extensions_vec.reserve(pinfo->num_extensions);
 	for (unsigned int i = 0; i < pinfo->num_extensions; i++) {
 		extensions_vec.push_back(extension_info(pinfo->extensions + i));
 	}
 }
 
-CP_HIDDEN plugin_info::~plugin_info() {
-	cp_release_info(context, pinfo);
+cfg_element::~cfg_element() {
+	for (unsigned int i = 0; i < cfg_children.size(); i++) {
+		delete cfg_children[i];
+	}
 }
 
-CP_HIDDEN cfg_element::cfg_element(cfg_element* parent, const cp_cfg_element_t* cfge):
-cfge(cfge), cfg_parent(parent) {
-	for (unsigned int i = 0; i < cfge->num_atts; i += 2) {
-		attr_map[cfge->atts[i]] = cfge->atts[i+1];
+cfg_element& cfg_element::operator=(const cfg_element& e) {
+	if (this != &e) {
+		for (unsigned int i = 0; i < cfg_children.size(); i++) {
+			delete cfg_children[i];
+		}
+		cfg_children.clear();
+		attr_map.clear();
+		cfge = e.cfge;
+		cfg_parent = e.cfg_parent;
+		attrs_built = false;
+		children_built = false;
 	}
+	return *this;
+}
+
+void cfg_element::build_attributes() const {
+	for (unsigned int i = 0; i < cfge->num_atts; i++) {
+		attr_map[cfge->atts[2*i]] = cfge->atts[2*i + 1];
+	}
+	attrs_built = true;
+}
+
+void cfg_element::build_children() const {
 	cfg_children.reserve(cfge->num_children);
 	for (unsigned int i = 0; i < cfge->num_children; i++) {
-		cfg_children.push_back(new cfg_element(this, cfge->children + i));
+		cfg_children.push_back(new cfg_element(const_cast<cfg_element*>(this), cfge->children + i));
 	}
+	children_built = true;
 }
 
 }
@@ -30,6 +30,10 @@
 
 #include <set>
 #include <map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
 #include <cpluff.h>
 #include <cpluffxx.h>
 #include "../libcpluff/defines.h"
@@ -115,6 +119,10 @@ public:
 
 	CP_HIDDEN bool is_logged(logger::severity severity) throw ();
 
+	CP_HIDDEN void* resolve_symbol_ptr(const char* plugin_id, const char* name) throw (api_error);
+
+	CP_HIDDEN void release_symbol_ptr(const void* ptr) throw ();
+
 	/**
 	 * Emits a new formatted log message if the associated severity is being
 	 * logged. Uses gettext to translate the message.
@@ -124,6 +132,16 @@ public:
 	 */
 	CP_HIDDEN void logf(logger::severity severity, const char* msg, ...) throw ();
 
+	/**
+	 * Returns the shared wrapper for the specified C API plug-in
+	 * information, creating it if there is none. Takes over the reference
+	 * to the information held by the caller.
+	 * 
+	 * @param pinfo the C API plug-in information
+	 * @return the shared wrapper
+	 */
+	CP_HIDDEN shared_ptr<plugin_info> wrap_plugin_info(cp_plugin_info_t* pinfo);
+
 protected:
 
 	/**
@@ -156,6 +174,22 @@ private:
 	 */
 	logger::severity min_logger_severity;
 
+	/**
+	 * Protects the plug-in information wrappers against concurrent
+	 * background operations.
+	 */
+	std::mutex plugin_infos_mutex;
+
+	/**
+	 * The live plug-in information wrappers by C API plug-in information.
+	 */
+	std::map<cp_plugin_info_t*, weak_ptr<plugin_info> > plugin_infos;
+
+	/**
+	 * The number of wrapper entries at which expired entries are purged.
+	 */
+	std::size_t plugin_infos_purge_limit;
+
 	/**
 	 * Delivers a logged message to all registered C++ loggers of a specific
 	 * plug-in context object.
@@ -187,12 +221,88 @@ public:
 
 	CP_HIDDEN void unregister_plugin_collections() throw ();
 
+	/**
+	 * Destructs a plug-in container after waiting for its background
+	 * operations to complete.
+	 */
+	CP_HIDDEN ~plugin_container_impl() throw ();
+
+	CP_HIDDEN void set_shared_descriptors(bool enabled) throw ();
+
 	CP_HIDDEN shared_ptr<plugin_info> load_plugin_descriptor(const char* path) throw (api_error);
 
+	CP_HIDDEN std::vector<shared_ptr<plugin_info> > load_plugin_descriptors(const std::vector<std::string>& paths) throw (api_error);
+
+	CP_HIDDEN async_result<shared_ptr<plugin_info> > load_plugin_descriptor_async(const char* path) throw (api_error);
+
+	CP_HIDDEN async_result<std::vector<shared_ptr<plugin_info> > > load_plugin_descriptors_async(const std::vector<std::string>& paths) throw (api_error);
+
+	CP_HIDDEN void scan_plugins(int flags) throw (api_error);
+
+	CP_HIDDEN async_result<void> scan_plugins_async(int flags) throw (api_error);
+
+	CP_HIDDEN void start_plugin(const char* id) throw (api_error);
+
+	CP_HIDDEN void start_plugins(const std::vector<std::string>& ids, int num_threads) throw (api_error);
+
+	CP_HIDDEN async_result<void> start_plugin_async(const char* id) throw (api_error);
+
+	CP_HIDDEN async_result<void> start_plugins_async(const std::vector<std::string>& ids, int num_threads) throw (api_error);
+
+	CP_HIDDEN void stop_plugin(const char* id) throw (api_error);
+
+	CP_HIDDEN void stop_plugins(const std::vector<std::string>& ids) throw (api_error);
+
+	CP_HIDDEN void stop_all_plugins(int num_threads) throw ();
+
+	CP_HIDDEN async_result<void> stop_plugin_async(const char* id) throw (api_error);
+
+	CP_HIDDEN async_result<void> stop_all_plugins_async(int num_threads) throw (api_error);
+
 private:
 
 	shared_ptr<framework> fw;
 
+	/**
+	 * Protects the count of pending background operations.
+	 */
+	std::mutex pending_mutex;
+
+	/**
+	 * Signaled when a background operation completes.
+	 */
+	std::condition_variable pending_done;
+
+	/**
+	 * The number of background operations not yet completed.
+	 */
+	int num_pending;
+
+	/**
+	 * Runs the specified operation in a background thread and returns its
+	 * result. Without multi-threading support the operation
+	 * is run before returning.
+	 * 
+	 * @param op the operation
+	 * @return the result of the operation
+	 * @throw api_error if insufficient resources to start the operation
+	 */
+	template <typename R> CP_HIDDEN async_result<R> run_async(std::function<R ()> op) throw (api_error);
+
+	/**
+	 * Returns an asynchronous result for the specified future.
+	 * 
+	 * @param future the future of the operation
+	 * @return the result of the operation
+	 * @throw api_error if insufficient memory
+	 */
+	template <typename R> CP_HIDDEN static async_result<R> make_result(std::future<R>&& future) throw (api_error);
+
+	/**
+	 * Marks a background operation completed.
+	 */
+	CP_HIDDEN void end_pending() throw ();
+
 };
 
 }
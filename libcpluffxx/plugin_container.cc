@@ -4,19 +4,165 @@
 
 #include <cstdarg>
 #include <cassert>
+#include <new>
+#include <system_error>
+#include <future>
+#include <memory>
+#include <thread>
 #include <cpluff.h>
 #include "internalxx.h"
 
 namespace cpluff {
 
 
-CP_HIDDEN plugin_container_impl::plugin_container_impl(shared_ptr<framework> fw): fw(fw) {
+/**
+ * Completes the future of an asynchronous plug-in start or stop.
+ * 
+ * @param plugin_id the identifier of the plug-in
+ * @param status the final status of the operation
+ * @param user_data the promise of the operation
+ */
+static void complete_plugin_op(const char* plugin_id, cp_status_t status, void* user_data) {
+	std::promise<void>* promise = static_cast<std::promise<void>*>(user_data);
+
+	try {
+		check_cp_status(status);
+		promise->set_value();
+	} catch (...) {
+		promise->set_exception(std::current_exception());
+	}
+	delete promise;
+}
+
+template <typename R> class async_result<R>::state {
+public:
+
+	/**
+	 * Constructs the state of an operation.
+	 * 
+	 * @param future the future of the operation
+	 */
+	inline state(std::future<R>&& future): future(std::move(future)) {}
+
+	/** The future of the operation */
+	std::future<R> future;
+};
+
+template <typename R> async_result<R>::async_result() throw (): impl(NULL) {}
+
+template <typename R> async_result<R>::async_result(state* impl) throw (): impl(impl) {}
+
+template <typename R> async_result<R>::async_result(async_result&& other) throw (): impl(other.impl) {
+	other.impl = NULL;
+}
+
+template <typename R> async_result<R>::~async_result() throw () {
+	delete impl;
+}
+
+template <typename R> async_result<R>& async_result<R>::operator=(async_result&& other) throw () {
+	if (this != &other) {
+		delete impl;
+		impl = other.impl;
+		other.impl = NULL;
+	}
+	return *this;
+}
+
+template <typename R> bool async_result<R>::valid() const throw () {
+	return impl != NULL && impl->future.valid();
+}
+
+template <typename R> void async_result<R>::wait() const throw () {
+	if (valid()) {
+		impl->future.wait();
+	}
+}
+
+template <typename R> R async_result<R>::get() throw (api_error) {
+	if (!valid()) {
+		check_cp_status(CP_ERR_RUNTIME);
+	}
+	try {
+		return impl->future.get();
+	} catch (const std::bad_alloc&) {
+		check_cp_status(CP_ERR_RESOURCE);
+		throw;
+	}
+}
+
+template class async_result<void>;
+template class async_result<shared_ptr<plugin_info> >;
+template class async_result<std::vector<shared_ptr<plugin_info> > >;
+
+CP_HIDDEN plugin_container_impl::plugin_container_impl(shared_ptr<framework> fw): fw(fw), num_pending(0) {
 	cp_status_t status;
 	context = cp_create_context(&status);
 	check_cp_status(status);
 	this->context = context;
 }
 
+CP_HIDDEN plugin_container_impl::~plugin_container_impl() throw () {
+	std::unique_lock<std::mutex> lock(pending_mutex);
+	while (num_pending > 0) {
+		pending_done.wait(lock);
+	}
+	lock.unlock();
+
+	// Destroy the context before the framework reference is released
+	cp_destroy_context(context);
+	context = NULL;
+}
+
+template <typename R> CP_HIDDEN async_result<R> plugin_container_impl::make_result(std::future<R>&& future) throw (api_error) {
+	typename async_result<R>::state* impl = new(std::nothrow) typename async_result<R>::state(std::move(future));
+
+	if (impl == NULL) {
+		check_cp_status(CP_ERR_RESOURCE);
+	}
+	return async_result<R>(impl);
+}
+
+template <typename R> CP_HIDDEN async_result<R> plugin_container_impl::run_async(std::function<R ()> op) throw (api_error) {
+#ifdef CP_THREADS
+	std::packaged_task<R ()> task(op);
+	async_result<R> result = make_result(task.get_future());
+	std::lock_guard<std::mutex> lock(pending_mutex);
+	try {
+
+		// A detached thread is used because a future obtained from
+		// std::async would block in its destructor if discarded
+		std::thread thread([this](std::packaged_task<R ()> task) {
+			struct pending_guard {
+				plugin_container_impl* container;
+				~pending_guard() {
+					container->end_pending();
+				}
+			} guard = { this };
+			std::packaged_task<R ()> t(std::move(task));
+			t();
+		}, std::move(task));
+		num_pending++;
+		thread.detach();
+		return result;
+	} catch (const std::system_error&) {
+		check_cp_status(CP_ERR_RESOURCE);
+		throw;
+	}
+#else
+	std::packaged_task<R ()> task(op);
+	async_result<R> result = make_result(task.get_future());
+	task();
+	return result;
+#endif
+}
+
+CP_HIDDEN void plugin_container_impl::end_pending() throw () {
+	std::lock_guard<std::mutex> lock(pending_mutex);
+	num_pending--;
+	pending_done.notify_all();
+}
+
 CP_HIDDEN void plugin_container_impl::register_plugin_collection(const char* dir) throw (api_error) {
 	check_cp_status(cp_register_pcollection(context, dir));
 }
@@ -29,12 +175,121 @@ CP_HIDDEN void plugin_container_impl::unregister_plugin_collections() throw () {
 	cp_unregister_pcollections(context);
 }
 
+CP_HIDDEN void plugin_container_impl::set_shared_descriptors(bool enabled) throw () {
+	cp_set_shared_descriptors(context, enabled);
+}
+
 CP_HIDDEN shared_ptr<plugin_info> plugin_container_impl::load_plugin_descriptor(const char* path) throw (api_error) {
 	cp_status_t status;
 	cp_plugin_info_t *pinfo = cp_load_plugin_descriptor(context, path, &status);
 	check_cp_status(status);
-	shared_ptr<plugin_info> ptr(new plugin_info(context, pinfo));
-	return ptr;
+	return wrap_plugin_info(pinfo);
+}
+
+CP_HIDDEN std::vector<shared_ptr<plugin_info> > plugin_container_impl::load_plugin_descriptors(const std::vector<std::string>& paths) throw (api_error) {
+	std::vector<shared_ptr<plugin_info> > infos;
+
+	infos.reserve(paths.size());
+	for (std::size_t i = 0; i < paths.size(); i++) {
+		infos.push_back(load_plugin_descriptor(paths[i].c_str()));
+	}
+	return infos;
+}
+
+CP_HIDDEN async_result<shared_ptr<plugin_info> > plugin_container_impl::load_plugin_descriptor_async(const char* path) throw (api_error) {
+	std::string p(path);
+	return run_async<shared_ptr<plugin_info> >([this, p]() {
+		return load_plugin_descriptor(p.c_str());
+	});
+}
+
+CP_HIDDEN async_result<std::vector<shared_ptr<plugin_info> > > plugin_container_impl::load_plugin_descriptors_async(const std::vector<std::string>& paths) throw (api_error) {
+	return run_async<std::vector<shared_ptr<plugin_info> > >([this, paths]() {
+		return load_plugin_descriptors(paths);
+	});
+}
+
+CP_HIDDEN void plugin_container_impl::scan_plugins(int flags) throw (api_error) {
+	check_cp_status(cp_scan_plugins(context, flags));
+}
+
+CP_HIDDEN async_result<void> plugin_container_impl::scan_plugins_async(int flags) throw (api_error) {
+	return run_async<void>([this, flags]() {
+		scan_plugins(flags);
+	});
+}
+
+CP_HIDDEN void plugin_container_impl::start_plugin(const char* id) throw (api_error) {
+	check_cp_status(cp_start_plugin(context, id));
+}
+
+CP_HIDDEN void plugin_container_impl::start_plugins(const std::vector<std::string>& ids, int num_threads) throw (api_error) {
+	std::vector<const char*> cids;
+
+	// An empty array would start all installed plug-ins
+	if (ids.empty()) {
+		return;
+	}
+	cids.reserve(ids.size() + 1);
+	for (std::size_t i = 0; i < ids.size(); i++) {
+		cids.push_back(ids[i].c_str());
+	}
+	cids.push_back(NULL);
+	check_cp_status(cp_start_plugins_parallel(context, &cids[0], num_threads));
+}
+
+CP_HIDDEN async_result<void> plugin_container_impl::start_plugin_async(const char* id) throw (api_error) {
+	std::unique_ptr<std::promise<void> > promise(new std::promise<void>());
+	async_result<void> result = make_result(promise->get_future());
+
+	check_cp_status(cp_start_plugin_async(context, id, complete_plugin_op, promise.get()));
+	promise.release();
+	return result;
+}
+
+CP_HIDDEN async_result<void> plugin_container_impl::start_plugins_async(const std::vector<std::string>& ids, int num_threads) throw (api_error) {
+	return run_async<void>([this, ids, num_threads]() {
+		start_plugins(ids, num_threads);
+	});
+}
+
+CP_HIDDEN void plugin_container_impl::stop_plugin(const char* id) throw (api_error) {
+	check_cp_status(cp_stop_plugin(context, id));
+}
+
+CP_HIDDEN void plugin_container_impl::stop_plugins(const std::vector<std::string>& ids) throw (api_error) {
+	cp_status_t status = CP_OK;
+
+	for (std::size_t i = 0; i < ids.size(); i++) {
+		cp_status_t s = cp_stop_plugin(context, ids[i].c_str());
+		if (status == CP_OK) {
+			status = s;
+		}
+	}
+	check_cp_status(status);
+}
+
+CP_HIDDEN void plugin_container_impl::stop_all_plugins(int num_threads) throw () {
+	if (num_threads > 1) {
+		cp_stop_plugins_parallel(context, num_threads);
+	} else {
+		cp_stop_plugins(context);
+	}
+}
+
+CP_HIDDEN async_result<void> plugin_container_impl::stop_plugin_async(const char* id) throw (api_error) {
+	std::unique_ptr<std::promise<void> > promise(new std::promise<void>());
+	async_result<void> result = make_result(promise->get_future());
+
+	check_cp_status(cp_stop_plugin_async(context, id, complete_plugin_op, promise.get()));
+	promise.release();
+	return result;
+}
+
+CP_HIDDEN async_result<void> plugin_container_impl::stop_all_plugins_async(int num_threads) throw (api_error) {
+	return run_async<void>([this, num_threads]() {
+		stop_all_plugins(num_threads);
+	});
 }
 
 }
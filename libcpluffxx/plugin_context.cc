@@ -40,14 +40,18 @@ namespace cpluff {
 
 CP_HIDDEN plugin_context_impl::plugin_context_impl(cp_context_t *context)
 : context(context),
-  min_logger_severity(static_cast<logger::severity>(logger::ERROR + 1)) {}
+  min_logger_severity(static_cast<logger::severity>(logger::ERROR + 1)),
+  plugin_infos_purge_limit(16) {}
 
-CP_HIDDEN plugin_context_impl::plugin_context_impl() {
-	plugin_context_impl(NULL);
-}
+CP_HIDDEN plugin_context_impl::plugin_context_impl()
+: context(NULL),
+  min_logger_severity(static_cast<logger::severity>(logger::ERROR + 1)),
+  plugin_infos_purge_limit(16) {}
 
 CP_HIDDEN plugin_context_impl::~plugin_context_impl() throw () {
-	cp_destroy_context(context);
+	if (context != NULL) {
+		cp_destroy_context(context);
+	}
 }
 
 CP_HIDDEN void plugin_context_impl::register_logger(logger* logger, logger::severity minseverity) throw (api_error) {
@@ -70,6 +74,47 @@ CP_HIDDEN bool plugin_context_impl::is_logged(logger::severity severity) throw (
 	return cp_is_logged(context, (cp_log_severity_t) severity);
 }
 
+CP_HIDDEN void* plugin_context_impl::resolve_symbol_ptr(const char* plugin_id, const char* name) throw (api_error) {
+	cp_status_t status;
+	void* ptr = cp_resolve_symbol(context, plugin_id, name, &status);
+	check_cp_status(status);
+	return ptr;
+}
+
+CP_HIDDEN shared_ptr<plugin_info> plugin_context_impl::wrap_plugin_info(cp_plugin_info_t* pinfo) {
+	std::lock_guard<std::mutex> lock(plugin_infos_mutex);
+	std::map<cp_plugin_info_t*, weak_ptr<plugin_info> >::iterator iter = plugin_infos.find(pinfo);
+
+	// Share a live wrapper, dropping the extra reference
+	if (iter != plugin_infos.end()) {
+		shared_ptr<plugin_info> ptr = iter->second.lock();
+		if (ptr) {
+			cp_release_info(context, pinfo);
+			return ptr;
+		}
+	}
+
+	// Purge expired entries once the map has grown enough
+	if (plugin_infos.size() >= plugin_infos_purge_limit) {
+		for (iter = plugin_infos.begin(); iter != plugin_infos.end();) {
+			if (iter->second.expired()) {
+				plugin_infos.erase(iter++);
+			} else {
+				++iter;
+			}
+		}
+		plugin_infos_purge_limit = 2 * plugin_infos.size() + 16;
+	}
+
+	shared_ptr<plugin_info> ptr(new plugin_info(context, pinfo));
+	plugin_infos[pinfo] = ptr;
+	return ptr;
+}
+
+CP_HIDDEN void plugin_context_impl::release_symbol_ptr(const void* ptr) throw () {
+	cp_release_symbol(context, ptr);
+}
+
 CP_HIDDEN void plugin_context_impl::logf(logger::severity severity, const char* msg, ...) throw () {
 	assert(msg != NULL);
 	assert(severity >= logger::DEBUG && severity <= logger::ERROR);
@@ -29,6 +29,13 @@
 #include <stdarg.h>
 #include <string.h>
 #include <unistd.h>
+#include <limits.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
 #ifdef HAVE_GETTEXT
 #include <libintl.h>
 #include <locale.h>
@@ -104,6 +111,9 @@ struct str_list_entry_t {
 /// The level of verbosity
 static int verbosity = 1;
 
+/// Wall clock times of the startup phases in nanoseconds
+static double startup_times[5];
+
 
 /* -----------------------------------------------------------------------
  * Functions
@@ -185,6 +195,58 @@ static void str_list_clear(str_list_t *list) {
 	list->last = NULL;
 }
 
+/**
+ * Returns the current value of a monotonic clock in nanoseconds.
+ * 
+ * @return the current time in nanoseconds
+ */
+static double now_ns(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER freq, count;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double) count.QuadPart * 1e9 / (double) freq.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec * 1e9 + (double) tv.tv_usec * 1e3;
+#endif
+}
+
+/**
+ * Prints the startup time breakdown. The wall clock times of the loader
+ * phases are followed by the cumulative plug-in lifecycle timings recorded
+ * by the framework, which may exceed the wall clock time when plug-ins
+ * are started in parallel.
+ * 
+ * @param summary the timings summary recorded by the framework
+ */
+static void print_startup_times(const cp_timings_summary_t *summary) {
+	const double *t = startup_times;
+
+	/* TRANSLATORS: The header of the startup time breakdown. */
+	fputs(_("C-Pluff Loader: startup time breakdown (ms):\n"), stderr);
+	fprintf(stderr, _("  initialization        %10.3f\n"), (t[1] - t[0]) / 1e6);
+	fprintf(stderr, _("  loading plug-ins      %10.3f\n"), (t[2] - t[1]) / 1e6);
+	fprintf(stderr, _("  prefetching           %10.3f\n"), (t[3] - t[2]) / 1e6);
+	fprintf(stderr, _("  starting plug-ins     %10.3f\n"), (t[4] - t[3]) / 1e6);
+	fprintf(stderr, _("  total                 %10.3f\n"), (t[4] - t[0]) / 1e6);
+	/* TRANSLATORS: The header of the cumulative lifecycle timings. */
+	fputs(_("  of which cumulatively:\n"), stderr);
+	fprintf(stderr, _("    descriptor parsing  %10.3f\n"), summary->parse_total / 1e6);
+	fprintf(stderr, _("    resolving           %10.3f\n"), summary->resolve_total / 1e6);
+	fprintf(stderr, _("    runtime loading     %10.3f\n"), summary->load_total / 1e6);
+	fprintf(stderr, _("    create functions    %10.3f\n"), summary->create_total / 1e6);
+	fprintf(stderr, _("    start functions     %10.3f\n"), summary->start_total / 1e6);
+}
+
 /**
  * Prints the help text.
  */
@@ -196,7 +258,15 @@ static void print_help(void) {
 		"  -h       print this help text\n"
 		"  -c DIR   add plug-in collection in directory DIR\n"
 		"  -p DIR   add plug-in in directory DIR\n"
+		"  -a FILE  add plug-ins from packed plug-in archive FILE\n"
+		"  -S FILE  add plug-ins from registry snapshot FILE\n"
+		"  -P FILE  pack the added plug-ins into archive FILE and exit\n"
+		"  -W FILE  save the added plug-ins into registry snapshot FILE\n"
+		"  -C FILE  use FILE as a plug-in descriptor cache\n"
 		"  -s PID   start plug-in PID\n"
+		"  -j N     start plug-ins using N threads\n"
+		"  -f       prefetch plug-in runtime libraries before starting\n"
+		"  -t       print a startup time breakdown on exit\n"
 		"  -v       be more verbose (repeat for increased verbosity)\n"
 		"  -q       be quiet\n"
 		"  -V       print C-Pluff version number and exit\n"
@@ -250,10 +320,26 @@ int main(int argc, char *argv[]) {
 	str_list_t lst_plugin_collections = STR_LIST_INITIALIZER;
 	str_list_t lst_plugin_dirs = STR_LIST_INITIALIZER;
 	str_list_t lst_start = STR_LIST_INITIALIZER;
+	str_list_t lst_archives = STR_LIST_INITIALIZER;
+	cp_plugin_loader_t **archive_loaders = NULL;
+	int num_archive_loaders = 0;
+	const char *pack_file = NULL;
+	const char *snapshot_file = NULL;
+	const char *save_snapshot_file = NULL;
+	const char *cache_file = NULL;
+	cp_plugin_loader_t *snapshot_loader = NULL;
+	int num_threads = 1;
+	int num_start = 0;
+	int prefetch = 0;
+	int report_times = 0;
+	cp_timings_summary_t summary;
 	cp_context_t *context;
 	char **ctx_argv;
 	str_list_entry_t *entry;
 
+	// Record the start time for the startup time breakdown
+	startup_times[0] = now_ns();
+
 	// Set locale
 #ifdef HAVE_GETTEXT
 	setlocale(LC_ALL, "");
@@ -270,7 +356,7 @@ int main(int argc, char *argv[]) {
 #endif
 
 	// Parse arguments
-	while ((i = getopt(argc, argv, "hc:p:s:vqV")) != -1) {
+	while ((i = getopt(argc, argv, "hc:p:a:S:P:W:C:s:j:ftvqV")) != -1) {
 		switch (i) {
 			
 			// Display help and exit
@@ -287,10 +373,59 @@ int main(int argc, char *argv[]) {
 			case 'p':
 				str_list_append(&lst_plugin_dirs, optarg);
 				break;
+
+			// Add a plug-in archive
+			case 'a':
+				str_list_append(&lst_archives, optarg);
+				num_archive_loaders++;
+				break;
+
+			// Add plug-ins from a registry snapshot
+			case 'S':
+				snapshot_file = optarg;
+				break;
+
+			// Pack the plug-ins into an archive
+			case 'P':
+				pack_file = optarg;
+				break;
+				
+			// Save the plug-ins into a registry snapshot
+			case 'W':
+				save_snapshot_file = optarg;
+				break;
+				
+			// Use a descriptor cache
+			case 'C':
+				cache_file = optarg;
+				break;
 				
 			// Add a plug-in to be started
 			case 's':
 				str_list_append(&lst_start, optarg);
+				num_start++;
+				break;
+
+			// Set the number of start threads
+			case 'j': {
+				char *end;
+				long n = strtol(optarg, &end, 10);
+				
+				if (*optarg == '\0' || *end != '\0' || n < 1 || n > INT_MAX) {
+					errorf(_("Invalid number of threads %s."), optarg);
+				}
+				num_threads = (int) n;
+				break;
+			}
+
+			// Prefetch runtime libraries
+			case 'f':
+				prefetch = 1;
+				break;
+
+			// Print a startup time breakdown
+			case 't':
+				report_times = 1;
 				break;
 
 			// Be more verbose
@@ -334,7 +469,10 @@ int main(int argc, char *argv[]) {
 	}
 	
 	// Check arguments
-	if (lst_plugin_dirs.first == NULL && lst_plugin_collections.first == NULL) {
+	if (lst_plugin_dirs.first == NULL
+		&& lst_plugin_collections.first == NULL
+		&& lst_archives.first == NULL
+		&& snapshot_file == NULL) {
 		error(_("No plug-ins to load. Try option -h for help."));
 	}
 	
@@ -360,6 +498,14 @@ int main(int argc, char *argv[]) {
 		cp_register_logger(context, logger, NULL, mv);
 	}
 	
+	// Enable the descriptor cache and timings, if requested
+	if (cache_file != NULL && cp_set_descriptor_cache(context, cache_file) != CP_OK) {
+		errorf(_("Failed to set descriptor cache %s."), cache_file);
+	}
+	if (report_times) {
+		cp_set_timings(context, 1);
+	}
+	
 	// Set context arguments
 	ctx_argv = chk_malloc((argc - optind + 2) * sizeof(char *));
 	ctx_argv[0] = "";
@@ -368,6 +514,7 @@ int main(int argc, char *argv[]) {
 	}
 	ctx_argv[argc - optind + 1] = NULL;
 	cp_set_context_args(context, ctx_argv);
+	startup_times[1] = now_ns();
 
 	// Load individual plug-ins
 	for (entry = lst_plugin_dirs.first; entry != NULL; entry = entry->next) {
@@ -388,27 +535,101 @@ int main(int argc, char *argv[]) {
 			errorf(_("Failed to register a plug-in collection at path %s."), entry->str); 
 		}
 	}
-	if (lst_plugin_collections.first != NULL
+	
+	// Load plug-in archives
+	if (num_archive_loaders > 0) {
+		archive_loaders = chk_malloc(num_archive_loaders * sizeof(cp_plugin_loader_t *));
+	}
+	for (entry = lst_archives.first, i = 0; entry != NULL; entry = entry->next, i++) {
+		if ((archive_loaders[i] = cp_create_archive_ploader(entry->str, NULL, NULL)) == NULL
+			|| cp_register_ploader(context, archive_loaders[i]) != CP_OK) {
+			errorf(_("Failed to register a plug-in archive at path %s."), entry->str);
+		}
+	}
+	
+	// Load the registry snapshot
+	if (snapshot_file != NULL
+		&& ((snapshot_loader = cp_create_snapshot_ploader(snapshot_file, NULL)) == NULL
+			|| cp_register_ploader(context, snapshot_loader) != CP_OK)) {
+		errorf(_("Failed to register a registry snapshot at path %s."), snapshot_file);
+	}
+	if ((lst_plugin_collections.first != NULL || lst_archives.first != NULL
+			|| snapshot_loader != NULL)
 		&& cp_scan_plugins(context, 0) != CP_OK) {
 		error(_("Failed to load and install plug-ins from plug-in collections."));
 	}
 	str_list_clear(&lst_plugin_collections);
+	str_list_clear(&lst_archives);
+	
+	// Pack plug-ins instead of running them, if requested
+	if (pack_file != NULL) {
+		if (cp_save_archive(context, pack_file) != CP_OK) {
+			errorf(_("Failed to save plug-in archive %s."), pack_file);
+		}
+		str_list_clear(&lst_start);
+		num_start = 0;
+	}
+	
+	// Save a registry snapshot, if requested
+	if (save_snapshot_file != NULL
+		&& cp_save_snapshot(context, save_snapshot_file) != CP_OK) {
+		errorf(_("Failed to save registry snapshot %s."), save_snapshot_file);
+	}
+	startup_times[2] = now_ns();
+	
+	// Prefetch runtime libraries, if requested
+	if (prefetch && num_start > 0
+		&& cp_prefetch_plugins(context, CP_PF_DLOPEN) != CP_OK) {
+		error(_("Failed to prefetch plug-in runtime libraries."));
+	}
+	startup_times[3] = now_ns();
 	
 	// Start plug-ins
-	for (entry = lst_start.first; entry != NULL; entry = entry->next) {
-		if (cp_start_plugin(context, entry->str) != CP_OK) {
-			errorf(_("Failed to start plug-in %s."), entry->str);
+	if (num_threads > 1 && num_start > 0) {
+		const char **ids = chk_malloc((num_start + 1) * sizeof(char *));
+		
+		for (entry = lst_start.first, i = 0; entry != NULL; entry = entry->next, i++) {
+			ids[i] = entry->str;
+		}
+		ids[i] = NULL;
+		if (cp_start_plugins_parallel(context, ids, num_threads) != CP_OK) {
+			error(_("Failed to start plug-ins."));
+		}
+		free(ids);
+	} else {
+		for (entry = lst_start.first; entry != NULL; entry = entry->next) {
+			if (cp_start_plugin(context, entry->str) != CP_OK) {
+				errorf(_("Failed to start plug-in %s."), entry->str);
+			}
 		}
 	}
 	str_list_clear(&lst_start);
+	startup_times[4] = now_ns();
+	if (report_times) {
+		cp_get_timings_summary(context, &summary);
+	}
 
 	// Run plug-ins
-	cp_run_plugins(context);
+	if (pack_file == NULL) {
+		cp_run_plugins(context);
+	}
+
+	// Print the startup time breakdown, if requested
+	if (report_times) {
+		print_startup_times(&summary);
+	}
 
 	// Destroy framework
 	cp_destroy();
 	
-	// Release context argument data
+	// Release archive loaders and context argument data
+	for (i = 0; i < num_archive_loaders; i++) {
+		cp_destroy_archive_ploader(archive_loaders[i]);
+	}
+	free(archive_loaders);
+	if (snapshot_loader != NULL) {
+		cp_destroy_snapshot_ploader(snapshot_loader);
+	}
 	free(ctx_argv);
 
 	// Return from the main program
@@ -22,6 +22,7 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <string.h>
 #include "test.h"
 
 void nocollections(void) {
@@ -116,3 +117,57 @@ void scanunregcollection(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+void clonecontext(void) {
+	cp_context_t *ctx, *clone, *plain;
+	cp_plugin_loader_t *loader;
+	cp_plugin_info_t *plugin, *cloned;
+	cp_status_t status;
+	int errors;
+	
+	// The clone has the same plug-ins installed, sharing their information
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_shared_descriptors(ctx, 1);
+	check(cp_register_pcollection(ctx, pcollectiondir("collection1")) == CP_OK);
+	check((loader = cp_create_local_ploader(&status)) != NULL && status == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection2")) == CP_OK);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((clone = cp_clone_context(ctx, 0, &status)) != NULL && status == CP_OK);
+	check(cp_get_plugin_state(clone, "plugin1") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(clone, "plugin2a") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(clone, "plugin2b") == CP_PLUGIN_INSTALLED);
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", NULL)) != NULL);
+	check((cloned = cp_get_plugin_info(clone, "plugin1", NULL)) != NULL);
+	check(plugin == cloned);
+	cp_release_info(ctx, plugin);
+	cp_release_info(clone, cloned);
+	
+	// The plug-ins are associated with the same plug-in loaders
+	cp_unregister_ploader(clone, loader);
+	check(cp_get_plugin_state(clone, "plugin1") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(clone, "plugin2a") == CP_PLUGIN_UNINSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2a") == CP_PLUGIN_INSTALLED);
+	
+	// The clone remains usable after the source context is destroyed
+	cp_destroy_context(ctx);
+	check((cloned = cp_get_plugin_info(clone, "plugin1", NULL)) != NULL);
+	check(!strcmp(cloned->identifier, "plugin1"));
+	cp_release_info(clone, cloned);
+	check(cp_scan_plugins(clone, CP_SP_INCREMENTAL) == CP_OK);
+	check(cp_get_plugin_state(clone, "plugin1") == CP_PLUGIN_INSTALLED);
+	
+	// Information not shared by the source context is copied
+	check((plain = cp_create_context(&status)) != NULL && status == CP_OK);
+	check(cp_register_pcollection(plain, pcollectiondir("collection1")) == CP_OK);
+	check(cp_scan_plugins(plain, 0) == CP_OK);
+	check((clone = cp_clone_context(plain, 0, &status)) != NULL && status == CP_OK);
+	check((plugin = cp_get_plugin_info(plain, "plugin1", NULL)) != NULL);
+	check((cloned = cp_get_plugin_info(clone, "plugin1", NULL)) != NULL);
+	check(plugin != cloned && !strcmp(plugin->identifier, cloned->identifier));
+	cp_release_info(plain, plugin);
+	cp_release_info(clone, cloned);
+	
+	cp_destroy();
+	check(errors == 0);
+}
@@ -65,3 +65,575 @@ void extcfgutils(void) {
 	cp_destroy_context(ctx);
 	check(errors == 0); 
 }
+
+void extcfgindex(void) {
+	static const char descriptor[] =
+		"<plugin id=\"wide\">"
+		"<extension point=\"wide.extpt\" id=\"ext\"><wide"
+		" k9=\"v9\" k1=\"v1\" k8=\"v8\" k2=\"v2\" k7=\"v7\""
+		" k3=\"v3\" k6=\"v6\" k4=\"v4\" k5=\"v5\">"
+		"<item>first</item><abc>abc</abc><z>z</z><ab>ab</ab>"
+		"<item>second</item><a>a<sub>sub</sub></a><m>m</m><b>b</b>"
+		"<item>third</item><y>y</y>"
+		"</wide></extension></plugin>";
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_cfg_element_t *cfg, *ce;
+	cp_cfg_path_t *path;
+	const char *str;
+	int errors;
+	cp_status_t status;
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor_from_memory(ctx, descriptor, strlen(descriptor), &status)) != NULL && status == CP_OK);
+	check(plugin->num_extensions == 1);
+	check((cfg = cp_get_extension_cfg(ctx, plugin->extensions, &status)) != NULL && status == CP_OK);
+	
+	// Repeat the lookups to exercise both building and using the index
+	for (i = 0; i < 2; i++) {
+		check((ce = cp_lookup_cfg_element(cfg, "wide/item")) != NULL && ce->index == 0 && !strcmp(ce->value, "first"));
+		check((str = cp_lookup_cfg_value(cfg, "wide/a")) != NULL && !strcmp(str, "a"));
+		check((str = cp_lookup_cfg_value(cfg, "wide/ab")) != NULL && !strcmp(str, "ab"));
+		check((str = cp_lookup_cfg_value(cfg, "wide/abc")) != NULL && !strcmp(str, "abc"));
+		check((str = cp_lookup_cfg_value(cfg, "wide/y")) != NULL && !strcmp(str, "y"));
+		check((str = cp_lookup_cfg_value(cfg, "wide/a/sub/../../z")) != NULL && !strcmp(str, "z"));
+		check((str = cp_lookup_cfg_value(cfg, "wide@k1")) != NULL && !strcmp(str, "v1"));
+		check((str = cp_lookup_cfg_value(cfg, "wide@k5")) != NULL && !strcmp(str, "v5"));
+		check((str = cp_lookup_cfg_value(cfg, "wide@k9")) != NULL && !strcmp(str, "v9"));
+		check(cp_lookup_cfg_element(cfg, "wide/aa") == NULL);
+		check(cp_lookup_cfg_element(cfg, "wide/abcd") == NULL);
+		check(cp_lookup_cfg_element(cfg, "wide/zz") == NULL);
+		check(cp_lookup_cfg_value(cfg, "wide@k") == NULL);
+		check(cp_lookup_cfg_value(cfg, "wide@k10") == NULL);
+	}
+	
+	// Compiled paths use the same index
+	check((path = cp_compile_cfg_path(ctx, "wide/a/sub/../../item@k1", &status)) != NULL && status == CP_OK);
+	check((ce = cp_lookup_cfg_compiled(cfg, path)) != NULL && !strcmp(ce->value, "first"));
+	check(cp_lookup_cfg_value_compiled(cfg, path) == NULL);
+	cp_release_info(ctx, path);
+	check((path = cp_compile_cfg_path(ctx, "wide@k7", &status)) != NULL && status == CP_OK);
+	check((str = cp_lookup_cfg_value_compiled(cfg, path)) != NULL && !strcmp(str, "v7"));
+	cp_release_info(ctx, path);
+	
+	cp_release_info(ctx, plugin);
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void extcfgcompiled(void) {
+	static const char * const paths[] = {
+		"structure/parameter",
+		"structure/deeper/struct/is",
+		"structure/../structure/assertion",
+		"structure/deeper/",
+		"@name",
+		"structure@nonexisting",
+		"structure//parameter",
+		"non/existing",
+		"structure/../..",
+		NULL
+	};
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_extension_t *ext;
+	cp_cfg_path_t *path;
+	int errors;
+	cp_status_t status;
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	for (i = 0, ext = NULL; ext == NULL && i < plugin->num_extensions; i++) {
+		cp_extension_t *e = plugin->extensions + i;
+		if (e->identifier != NULL && !strcmp(e->local_id, "ext1")) {
+			ext = e;
+		}
+	}
+	check(ext != NULL);
+	
+	// Compiled lookups must agree with the uncompiled ones
+	for (i = 0; paths[i] != NULL; i++) {
+		check((path = cp_compile_cfg_path(ctx, paths[i], &status)) != NULL && status == CP_OK);
+		check(cp_lookup_cfg_value_compiled(ext->configuration, path) == cp_lookup_cfg_value(ext->configuration, paths[i]));
+		if (strchr(paths[i], '@') == NULL) {
+			check(cp_lookup_cfg_compiled(ext->configuration, path) == cp_lookup_cfg_element(ext->configuration, paths[i]));
+		}
+		cp_release_info(ctx, path);
+	}
+	
+	// An attribute path selects the element carrying the attribute
+	check((path = cp_compile_cfg_path(ctx, "structure@name", &status)) != NULL && status == CP_OK);
+	check(cp_lookup_cfg_compiled(ext->configuration, path) == cp_lookup_cfg_element(ext->configuration, "structure"));
+	cp_release_info(ctx, path);
+	
+	cp_release_info(ctx, plugin);
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+static void check_extindex(int lazy) {
+	static const char d1[] =
+		"<plugin id=\"handlers\">"
+		"<extension-point id=\"handler\"/>"
+		"<extension point=\"handlers.handler\" id=\"h1\" type=\"a\"/>"
+		"<extension point=\"handlers.handler\" id=\"h2\" type=\"b\"/>"
+		"<extension point=\"handlers.handler\" id=\"h3\"/>"
+		"</plugin>";
+	static const char d2[] =
+		"<plugin id=\"morehandlers\">"
+		"<extension point=\"handlers.handler\" id=\"h4\" type=\"a\"/>"
+		"<extension point=\"other.point\" id=\"h5\" type=\"a\"/>"
+		"</plugin>";
+	cp_context_t *ctx;
+	cp_plugin_info_t *p1, *p2;
+	cp_extension_index_t *index, *index2;
+	cp_extension_t **exts;
+	int errors;
+	cp_status_t status;
+	int n;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_lazy_cfg(ctx, lazy);
+	check((p1 = cp_load_plugin_descriptor_from_memory(ctx, d1, strlen(d1), &status)) != NULL && status == CP_OK);
+	check((p2 = cp_load_plugin_descriptor_from_memory(ctx, d2, strlen(d2), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, p1) == CP_OK);
+	
+	// Index the installed extensions
+	check((index = cp_create_extension_index(ctx, "handlers.handler", "@type", &status)) != NULL && status == CP_OK);
+	check((exts = cp_query_extension_index(ctx, index, "a", &status, &n)) != NULL && status == CP_OK);
+	check(n == 1 && !strcmp(exts[0]->identifier, "handlers.h1") && exts[1] == NULL);
+	cp_release_info(ctx, exts);
+	check((exts = cp_query_extension_index(ctx, index, "c", &status, &n)) != NULL && status == CP_OK);
+	check(n == 0 && exts[0] == NULL);
+	cp_release_info(ctx, exts);
+	
+	// The index follows installations and uninstallations
+	check((index2 = cp_create_extension_index(ctx, "handlers.handler", "@type", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, p2) == CP_OK);
+	check((exts = cp_query_extension_index(ctx, index, "a", &status, &n)) != NULL && status == CP_OK);
+	check(n == 2 && !strcmp(exts[0]->identifier, "handlers.h1") && !strcmp(exts[1]->identifier, "morehandlers.h4"));
+	cp_release_info(ctx, exts);
+	check(cp_uninstall_plugin(ctx, "morehandlers") == CP_OK);
+	check((exts = cp_query_extension_index(ctx, index, "a", &status, &n)) != NULL && status == CP_OK);
+	check(n == 1 && !strcmp(exts[0]->identifier, "handlers.h1"));
+	cp_release_info(ctx, exts);
+	check((exts = cp_query_extension_index(ctx, index, "b", &status, &n)) != NULL && status == CP_OK);
+	check(n == 1 && !strcmp(exts[0]->identifier, "handlers.h2"));
+	cp_release_info(ctx, exts);
+	cp_destroy_extension_index(ctx, index);
+	check(cp_uninstall_plugin(ctx, "handlers") == CP_OK);
+	check((exts = cp_query_extension_index(ctx, index2, "b", &status, &n)) != NULL && status == CP_OK);
+	check(n == 0);
+	cp_release_info(ctx, exts);
+	
+	// The remaining index is destroyed with the context
+	cp_release_info(ctx, p1);
+	cp_release_info(ctx, p2);
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void extindex(void) {
+	check_extindex(0);
+	check_extindex(1);
+}
+
+typedef struct schema_record_t {
+	const char *label;
+	long size;
+	double ratio;
+	int enabled;
+	int kind;
+} schema_record_t;
+
+void extcfgschema(void) {
+	static const char d1[] =
+		"<plugin id=\"typed\">"
+		"<extension point=\"typed.point\" id=\"e1\" kind=\"slow\" size=\"0x10\" ratio=\" 2.5 \" enabled=\"true\"><label>first</label></extension>"
+		"<extension point=\"typed.point\" id=\"e2\" kind=\"fast\"/>"
+		"</plugin>";
+	static const char d2[] =
+		"<plugin id=\"badtyped\">"
+		"<extension point=\"typed.point\" id=\"e3\" kind=\"fast\" size=\"ten\"/>"
+		"</plugin>";
+	static const char * const kinds[] = { "fast", "slow", NULL };
+	static const cp_cfg_field_t fields[] = {
+		{ "label", CP_CFG_STRING, offsetof(schema_record_t, label), 0, NULL, NULL },
+		{ "@size", CP_CFG_INT, offsetof(schema_record_t, size), 0, "1", NULL },
+		{ "@ratio", CP_CFG_DOUBLE, offsetof(schema_record_t, ratio), 0, NULL, NULL },
+		{ "@enabled", CP_CFG_BOOL, offsetof(schema_record_t, enabled), 0, "false", NULL },
+		{ "@kind", CP_CFG_ENUM, offsetof(schema_record_t, kind), 1, NULL, kinds }
+	};
+	static const cp_cfg_field_t strict_fields[] = {
+		{ "label", CP_CFG_STRING, offsetof(schema_record_t, label), 1, NULL, NULL }
+	};
+	cp_cfg_schema_t schema = { sizeof(schema_record_t), 5, fields };
+	cp_cfg_schema_t strict_schema = { sizeof(schema_record_t), 1, strict_fields };
+	cp_context_t *ctx;
+	cp_plugin_info_t *p1, *p2;
+	const schema_record_t *r1, *r2;
+	int errors;
+	cp_status_t status;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_lazy_cfg(ctx, 1);
+	check((p1 = cp_load_plugin_descriptor_from_memory(ctx, d1, strlen(d1), &status)) != NULL && status == CP_OK);
+	check((p2 = cp_load_plugin_descriptor_from_memory(ctx, d2, strlen(d2), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, p1) == CP_OK);
+	check(cp_get_extension_record(ctx, p1->extensions, &status) == NULL && status == CP_ERR_UNKNOWN);
+	
+	// The installed extensions are converted on registration
+	check(cp_register_cfg_schema(ctx, "typed.point", &schema) == CP_OK);
+	check((r1 = cp_get_extension_record(ctx, p1->extensions, &status)) != NULL && status == CP_OK);
+	check((r2 = cp_get_extension_record(ctx, p1->extensions + 1, NULL)) != NULL);
+	check(((size_t) r1) % CP_CFG_RECORD_ALIGN == 0 && ((size_t) r2) % CP_CFG_RECORD_ALIGN == 0);
+	check(!strcmp(r1->label, "first") && r1->size == 16 && r1->ratio == 2.5 && r1->enabled == 1 && r1->kind == 1);
+	check(r2->label == NULL && r2->size == 1 && r2->ratio == 0.0 && r2->enabled == 0 && r2->kind == 0);
+	
+	// Extensions not matching the schema are rejected on installation
+	check(cp_install_plugin(ctx, p2) == CP_ERR_MALFORMED);
+	check(errors > 0);
+	errors = 0;
+	check(cp_get_plugin_state(ctx, "badtyped") == CP_PLUGIN_UNINSTALLED);
+	
+	// A schema not matching the installed extensions is not registered
+	check(cp_register_cfg_schema(ctx, "typed.point", &strict_schema) == CP_ERR_MALFORMED);
+	check(errors > 0);
+	errors = 0;
+	check(cp_get_extension_record(ctx, p1->extensions, NULL) == r1);
+	
+	// Records are freed on uninstallation and unregistration
+	check(cp_uninstall_plugin(ctx, "typed") == CP_OK);
+	check(cp_get_extension_record(ctx, p1->extensions, &status) == NULL && status == CP_ERR_UNKNOWN);
+	check(cp_install_plugin(ctx, p1) == CP_OK);
+	check(cp_get_extension_record(ctx, p1->extensions, NULL) != NULL);
+	cp_unregister_cfg_schema(ctx, "typed.point");
+	check(cp_get_extension_record(ctx, p1->extensions, NULL) == NULL);
+	check(cp_install_plugin(ctx, p2) == CP_OK);
+	
+	// A remaining schema is unregistered with the context
+	check(cp_register_cfg_schema(ctx, "typed.point", &schema) == CP_ERR_MALFORMED);
+	errors = 0;
+	check(cp_uninstall_plugin(ctx, "badtyped") == CP_OK);
+	check(cp_register_cfg_schema(ctx, "typed.point", &schema) == CP_OK);
+	cp_release_info(ctx, p1);
+	cp_release_info(ctx, p2);
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void registrygen(void) {
+	static const char d1[] =
+		"<plugin id=\"genpoint\"><extension-point id=\"ep\"/></plugin>";
+	static const char d2[] =
+		"<plugin id=\"genext\"><extension point=\"genpoint.ep\"/></plugin>";
+	static const char d3[] =
+		"<plugin id=\"genplain\"/>";
+	cp_context_t *ctx;
+	cp_plugin_info_t *p1, *p2, *p3;
+	unsigned int g0, g1, g2, g3, e1, e2;
+	int errors;
+	cp_status_t status;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((p1 = cp_load_plugin_descriptor_from_memory(ctx, d1, strlen(d1), &status)) != NULL && status == CP_OK);
+	check((p2 = cp_load_plugin_descriptor_from_memory(ctx, d2, strlen(d2), &status)) != NULL && status == CP_OK);
+	check((p3 = cp_load_plugin_descriptor_from_memory(ctx, d3, strlen(d3), &status)) != NULL && status == CP_OK);
+	g0 = cp_get_registry_generation(ctx);
+	check(cp_get_ext_point_generation(ctx, "genpoint.ep") == 0);
+	
+	// Installing the extension point changes both generations
+	check(cp_install_plugin(ctx, p1) == CP_OK);
+	check((g1 = cp_get_registry_generation(ctx)) != g0);
+	check((e1 = cp_get_ext_point_generation(ctx, "genpoint.ep")) != 0);
+	
+	// An unrelated plug-in only changes the registry generation
+	check(cp_install_plugin(ctx, p3) == CP_OK);
+	check((g2 = cp_get_registry_generation(ctx)) != g1);
+	check(cp_get_ext_point_generation(ctx, "genpoint.ep") == e1);
+	
+	// Extensions change the generation of their extension point
+	check(cp_install_plugin(ctx, p2) == CP_OK);
+	check((g3 = cp_get_registry_generation(ctx)) != g2);
+	check((e2 = cp_get_ext_point_generation(ctx, "genpoint.ep")) != e1);
+	check(cp_get_registry_generation(ctx) == g3);
+	check(cp_uninstall_plugin(ctx, "genext") == CP_OK);
+	check(cp_get_registry_generation(ctx) != g3);
+	check(cp_get_ext_point_generation(ctx, "genpoint.ep") != e2);
+	
+	cp_release_info(ctx, p1);
+	cp_release_info(ctx, p2);
+	cp_release_info(ctx, p3);
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+static int count_plugin(const cp_plugin_info_t *plugin, void *user_data) {
+	(*((int *) user_data))++;
+	return 0;
+}
+
+static int find_symprovider(const cp_plugin_info_t *plugin, void *user_data) {
+	return !strcmp(plugin->identifier, "symprovider") ? 2 : 0;
+}
+
+static int count_extension(const cp_extension_t *extension, void *user_data) {
+	(*((int *) user_data))++;
+	return 0;
+}
+
+static int stop_extension(const cp_extension_t *extension, void *user_data) {
+	(*((int *) user_data))++;
+	return 1;
+}
+
+void extsnapshot(void) {
+	cp_context_t *ctx;
+	const cp_extensions_snapshot_t *snapshot, *snapshot2;
+	cp_status_t status;
+	unsigned int generation;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Repeated calls return the same snapshot
+	check((snapshot = cp_get_extensions_snapshot(ctx, "symuser.strings", &status)) != NULL && status == CP_OK);
+	check(snapshot->num_extensions == 1);
+	check(snapshot->extensions[0] != NULL && snapshot->extensions[1] == NULL);
+	check(!strcmp(snapshot->extensions[0]->plugin->identifier, "symprovider"));
+	check(cp_get_extensions_snapshot(ctx, "symuser.strings", NULL) == snapshot);
+	generation = snapshot->generation;
+	
+	// Unknown extension points have empty snapshots
+	check((snapshot2 = cp_get_extensions_snapshot(ctx, "nonexisting", &status)) != NULL && status == CP_OK);
+	check(snapshot2->num_extensions == 0 && snapshot2->extensions[0] == NULL);
+	
+	// Uninstalling the contributing plug-in creates a new generation
+	check(cp_uninstall_plugin(ctx, "symprovider") == CP_OK);
+	check((snapshot2 = cp_get_extensions_snapshot(ctx, "symuser.strings", &status)) != NULL && status == CP_OK);
+	check(snapshot2->num_extensions == 0 && snapshot2->extensions[0] == NULL);
+	check(snapshot2->generation != generation);
+	
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void foreachinfo(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t **plugins;
+	cp_extension_t **exts;
+	int errors, num, count;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// All plug-ins are visited
+	check((plugins = cp_get_plugins_info(ctx, NULL, &num)) != NULL);
+	cp_release_info(ctx, plugins);
+	count = 0;
+	check(cp_foreach_plugin(ctx, count_plugin, &count) == 0);
+	check(count == num);
+	
+	// The visitor can stop the iteration
+	check(cp_foreach_plugin(ctx, find_symprovider, NULL) == 2);
+	
+	// Extensions of an extension point and all extensions are visited
+	count = 0;
+	check(cp_foreach_extension(ctx, "symuser.strings", count_extension, &count) == 0);
+	check(count == 1);
+	check((exts = cp_get_extensions_info(ctx, NULL, NULL, &num)) != NULL);
+	cp_release_info(ctx, exts);
+	count = 0;
+	check(cp_foreach_extension(ctx, NULL, count_extension, &count) == 0);
+	check(count == num);
+	count = 0;
+	check(cp_foreach_extension(ctx, NULL, stop_extension, &count) == 1);
+	check(count == 1);
+	count = 0;
+	check(cp_foreach_extension(ctx, "nonexisting", count_extension, &count) == 0);
+	check(count == 0);
+	
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void extuninstall(void) {
+	static const char * const descriptors[] = {
+		"<plugin id=\"unpoint\"><extension-point id=\"ep\"/></plugin>",
+		"<plugin id=\"unext1\"><extension point=\"unpoint.ep\" id=\"a\"/><extension point=\"unpoint.ep\" id=\"b\"/></plugin>",
+		"<plugin id=\"unext2\"><extension point=\"unpoint.ep\" id=\"a\"/><extension point=\"other.ep\" id=\"b\"/><extension point=\"unpoint.ep\" id=\"c\"/></plugin>",
+		"<plugin id=\"unext3\"><extension point=\"unpoint.ep\" id=\"a\"/></plugin>",
+		NULL
+	};
+	cp_context_t *ctx;
+	cp_extension_t **exts;
+	cp_status_t status;
+	int errors, num, i;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	for (i = 0; descriptors[i] != NULL; i++) {
+		cp_plugin_info_t *pi;
+		
+		check((pi = cp_load_plugin_descriptor_from_memory(ctx, descriptors[i], strlen(descriptors[i]), &status)) != NULL && status == CP_OK);
+		check(cp_install_plugin(ctx, pi) == CP_OK);
+		cp_release_info(ctx, pi);
+	}
+	check((exts = cp_get_extensions_info(ctx, "unpoint.ep", &status, &num)) != NULL && status == CP_OK);
+	check(num == 5);
+	cp_release_info(ctx, exts);
+	
+	// Removing a plug-in in the middle keeps the order of the others
+	check(cp_uninstall_plugin(ctx, "unext2") == CP_OK);
+	check((exts = cp_get_extensions_info(ctx, "unpoint.ep", &status, &num)) != NULL && status == CP_OK);
+	check(num == 3);
+	check(!strcmp(exts[0]->identifier, "unext1.a"));
+	check(!strcmp(exts[1]->identifier, "unext1.b"));
+	check(!strcmp(exts[2]->identifier, "unext3.a"));
+	cp_release_info(ctx, exts);
+	check((exts = cp_get_extensions_info(ctx, "other.ep", &status, &num)) != NULL && status == CP_OK);
+	check(num == 0);
+	cp_release_info(ctx, exts);
+	
+	// Removing the remaining contributors empties the extension point
+	check(cp_uninstall_plugin(ctx, "unext1") == CP_OK);
+	check(cp_uninstall_plugin(ctx, "unext3") == CP_OK);
+	check((exts = cp_get_extensions_info(ctx, "unpoint.ep", &status, &num)) != NULL && status == CP_OK);
+	check(num == 0);
+	cp_release_info(ctx, exts);
+	
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void compactcontext(void) {
+	static const char descriptor[] =
+		"<plugin id=\"compact\" name=\"Compact\" provider-name=\"Provider\">"
+		"<extension point=\"compact.ep\" id=\"ext\" name=\"Extension\">"
+		"<item key=\"a &amp; &quot;b&quot;\">x &lt; y</item><empty/>"
+		"</extension></plugin>";
+	cp_context_t *ctx;
+	cp_plugin_info_t *pi;
+	const cp_extensions_snapshot_t *snapshot;
+	cp_cfg_element_t *ce;
+	cp_memory_stats_t stats, stats2;
+	cp_status_t status;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((pi = cp_load_plugin_descriptor_from_memory(ctx, descriptor, strlen(descriptor), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, pi) == CP_OK);
+	cp_release_info(ctx, pi);
+	check(cp_get_memory_stats(ctx, "compact", &stats) == CP_OK);
+	check(stats.cfg_elements == 3);
+	
+	// Dropping the configuration shrinks the description
+	check(cp_compact_context(ctx, CP_CC_REGISTRIES | CP_CC_CFG) == CP_OK);
+	check(cp_get_memory_stats(ctx, "compact", &stats2) == CP_OK);
+	check(stats2.cfg_elements == 0);
+	check(stats2.descriptor_bytes < stats.descriptor_bytes);
+	
+	// The configuration is parsed again on demand
+	check((snapshot = cp_get_extensions_snapshot(ctx, "compact.ep", &status)) != NULL && status == CP_OK);
+	check(snapshot->num_extensions == 1);
+	check(snapshot->extensions[0]->configuration == NULL);
+	check(!strcmp(snapshot->extensions[0]->name, "Extension"));
+	check((ce = cp_get_extension_cfg(ctx, snapshot->extensions[0], &status)) != NULL && status == CP_OK);
+	check(!strcmp(cp_lookup_cfg_value(ce, "@point"), "compact.ep"));
+	check(!strcmp(cp_lookup_cfg_value(ce, "item"), "x < y"));
+	check(!strcmp(cp_lookup_cfg_value(ce, "item/@key"), "a & \"b\""));
+	check(cp_lookup_cfg_element(ce, "empty") != NULL);
+	
+	// The compacted plug-ins can still be looked up, started and uninstalled
+	check((pi = cp_get_plugin_info(ctx, "compact", &status)) != NULL && status == CP_OK);
+	check(!strcmp(pi->name, "Compact") && !strcmp(pi->provider_name, "Provider"));
+	cp_release_info(ctx, pi);
+	check(cp_start_plugin(ctx, "compact") == CP_OK);
+	check(cp_compact_context(ctx, CP_CC_REGISTRIES | CP_CC_DESCRIPTORS) == CP_OK);
+	check(cp_get_plugin_state(ctx, "compact") == CP_PLUGIN_ACTIVE);
+	check(cp_uninstall_plugin(ctx, "compact") == CP_OK);
+	check(cp_uninstall_plugin(ctx, "symprovider") == CP_OK);
+	
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void registrystats(void) {
+	cp_context_t *ctx;
+	cp_registry_stats_t stats;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_get_registry_stats(ctx, &stats);
+	check(stats.plugins == 0 && stats.ext_points == 0 && stats.extensions == 0);
+	check(stats.plugins <= stats.plugin_slots);
+	
+	// The sizes follow the installed plug-ins
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	cp_get_registry_stats(ctx, &stats);
+	check(stats.plugins == 3 && stats.plugin_slots >= stats.plugins);
+	check(stats.ext_points == 1 && stats.ext_point_slots >= stats.ext_points);
+	check(stats.extension_lists == 1 && stats.extensions == 1);
+	check(stats.started_plugins == 0);
+	check(stats.generation == cp_get_registry_generation(ctx));
+	check(cp_start_plugin(ctx, "symuser") == CP_OK);
+	cp_get_registry_stats(ctx, &stats);
+	check(stats.started_plugins == 2);
+	
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
+
+void lockstats(void) {
+	cp_context_t *ctx;
+	cp_lock_stats_t stats;
+	cp_lock_holder_stats_t *holders;
+	cp_status_t status;
+	int errors, i, n, found = 0;
+	
+	// Nothing is collected by default
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	cp_get_lock_stats(ctx, &stats);
+	check(stats.acquisitions == 0 && stats.hold_total == 0);
+	
+	// Holds are attributed to the API functions holding the lock
+	check(cp_set_lock_stats(ctx, 1) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_start_plugin(ctx, "symuser") == CP_OK);
+	cp_get_lock_stats(ctx, &stats);
+	check(stats.contended <= stats.acquisitions);
+	check(stats.wait_max <= stats.wait_total && stats.hold_max <= stats.hold_total);
+	check((holders = cp_get_lock_holder_stats(ctx, &status, &n)) != NULL && status == CP_OK);
+	for (i = 0; i < n; i++) {
+		check(i == 0 || holders[i - 1].hold_total >= holders[i].hold_total);
+		check(holders[i].hold_max <= holders[i].hold_total);
+		if (holders[i].function != NULL && !strcmp(holders[i].function, "cp_scan_plugins")) {
+			found = holders[i].holds;
+		}
+	}
+	cp_release_info(ctx, holders);
+#ifdef CP_THREADS
+	check(stats.acquisitions > 0);
+	check(found > 0);
+#else
+	check(stats.acquisitions == 0 && n == 0);
+#endif
+	
+	// Disabling discards the statistics
+	check(cp_set_lock_stats(ctx, 0) == CP_OK);
+	cp_get_lock_stats(ctx, &stats);
+	check(stats.acquisitions == 0);
+	check((holders = cp_get_lock_holder_stats(ctx, &status, &n)) != NULL && n == 0);
+	cp_release_info(ctx, holders);
+	
+	cp_destroy_context(ctx);
+	check(errors == 0);
+}
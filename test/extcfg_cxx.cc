@@ -0,0 +1,80 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <cstring>
+#include <cpluffxx.h>
+#include "test_cxx.h"
+
+extern "C" void extcfgrange_cxx(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_extension_t *ext = NULL;
+	cp_status_t status;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	for (unsigned int i = 0; ext == NULL && i < plugin->num_extensions; i++) {
+		if (plugin->extensions[i].local_id != NULL && !strcmp(plugin->extensions[i].local_id, "ext1")) {
+			ext = plugin->extensions + i;
+		}
+	}
+	check(ext != NULL);
+	
+	// Extension views wrap the C API extensions in order
+	cpluff::info_range<cpluff::extension_info, cp_extension_t> exts(plugin->extensions, plugin->num_extensions);
+	unsigned int n = 0;
+	for (cpluff::info_range<cpluff::extension_info, cp_extension_t>::iterator i = exts.begin(); i != exts.end(); ++i, n++) {
+		check(!strcmp((*i).ext_point_id(), plugin->extensions[n].ext_point_id));
+	}
+	check(n == plugin->num_extensions && exts.size() == n);
+	
+	// Configuration views match the C API tree
+	cpluff::extension_info info(ext);
+	const cpluff::cfg_element& root = info.configuration();
+	check(!strcmp(root.name(), "extension"));
+	check(root.attribute_view().size() == ext->configuration->num_atts);
+	check(!strcmp(root.attribute_view().value("name"), "Extension 1"));
+	check(root.attribute_view().value("nonexisting") == NULL);
+	n = 0;
+	for (cpluff::attribute_range::iterator i = root.attribute_view().begin(); i != root.attribute_view().end(); i++, n++) {
+		check(!strcmp((*i).first, ext->configuration->atts[2*n]));
+		check(!strcmp((*i).second, ext->configuration->atts[2*n + 1]));
+	}
+	check(n == ext->configuration->num_atts);
+	check(info.cfg_child_range().size() == 1);
+	cpluff::cfg_element structure = info.cfg_child_range()[0];
+	check(!strcmp(structure.name(), "structure"));
+	check(structure.parent() == &root);
+	check(structure.child_range().size() == 4);
+	check(!strcmp(structure.child_range()[3].name(), "deeper"));
+	check(structure.child_range()[3].parent() == &structure);
+	
+	// The views agree with the built wrappers
+	check(root.attributes().size() == ext->configuration->num_atts);
+	check(root.children().size() == 1 && !strcmp(root.children()[0]->name(), "structure"));
+	
+	cp_release_info(ctx, plugin);
+	cp_destroy();
+	check(errors == 0);
+}
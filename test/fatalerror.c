@@ -57,3 +57,26 @@ void fatalerrorreset(void) {
 	cp_set_fatal_error_handler(NULL);
 	cause_fatal_error();
 }
+
+static int uninstall_visitor(const cp_plugin_info_t *plugin, void *user_data) {
+	cp_uninstall_plugins(user_data);
+	return 1;
+}
+
+void fatalerrorinvocation(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	
+	cp_set_fatal_error_handler(error_handler);
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	
+	// Calls from the visitor are checked in the visiting thread
+	cp_foreach_plugin(ctx, uninstall_visitor, ctx);
+	cp_destroy();
+	free_test_resources();
+	exit(1);
+}
@@ -22,6 +22,7 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "test.h"
 #include <cpluff.h>
 
@@ -123,3 +124,60 @@ void initstartdestroyboth(void) {
 		check(errors == 0);
 	}
 }
+
+static void *counting_malloc(size_t size, void *user_data) {
+	long *counts = user_data;
+	void *ptr;
+	
+	if ((ptr = malloc(size)) != NULL) {
+		counts[0]++;
+		counts[1]++;
+	}
+	return ptr;
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *user_data) {
+	long *counts = user_data;
+	void *nptr;
+	
+	if ((nptr = realloc(ptr, size)) != NULL && ptr == NULL) {
+		counts[0]++;
+		counts[1]++;
+	}
+	return nptr;
+}
+
+static void counting_free(void *ptr, void *user_data) {
+	long *counts = user_data;
+	
+	check(ptr != NULL);
+	counts[1]--;
+	free(ptr);
+}
+
+void initallocatordestroy(void) {
+	long counts[2] = { 0, 0 };
+	int i;
+	
+	cp_set_allocator(counting_malloc, counting_realloc, counting_free, counts);
+	for (i = 0; i < 3; i++) {
+		cp_context_t *ctx;
+		cp_plugin_info_t *pi;
+		cp_status_t status;
+		const char *pdir = plugindir("minimal");
+		int errors;
+		
+		ctx = init_context(CP_LOG_ERROR, &errors);
+		check((pi = cp_load_plugin_descriptor(ctx, pdir, &status)) != NULL && status == CP_OK);
+		check(cp_install_plugin(ctx, pi) == CP_OK);
+		cp_release_info(ctx, pi);
+		check(cp_start_plugin(ctx, "minimal") == CP_OK);
+		cp_destroy();
+		check(errors == 0);
+	}
+	cp_set_allocator(NULL, NULL, NULL, NULL);
+	
+	// Everything was allocated and released using the given allocator
+	check(counts[0] > 0);
+	check(counts[1] == 0);
+}
@@ -22,7 +22,17 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
 #include <cpluffxx.h>
+#include "plugins-source/callbackcounter/callbackcounter.h"
 #include "test_cxx.h"
 
 extern "C" void initdestroy_cxx(void) {
@@ -70,6 +80,156 @@ extern "C" void initinstalldestroy_cxx(void) {
 	}
 }
 
+extern "C" void sharedinfo_cxx(void) {
+	int errors;
+	
+	do {
+		shared_ptr<cpluff::plugin_container> pc = init_container_cxx(cpluff::logger::ERROR, &errors);
+		
+		// Two lookups of a shared descriptor return the same wrapper
+		pc.get()->set_shared_descriptors(true);
+		shared_ptr<cpluff::plugin_info> pi1 = pc.get()->load_plugin_descriptor(plugindir("maximal"));
+		shared_ptr<cpluff::plugin_info> pi2 = pc.get()->load_plugin_descriptor(plugindir("maximal"));
+		check(pi1.get() == pi2.get());
+		check(&pi1.get()->extensions() == &pi2.get()->extensions());
+		
+		// A separately parsed descriptor gets a wrapper of its own
+		pc.get()->set_shared_descriptors(false);
+		shared_ptr<cpluff::plugin_info> pi3 = pc.get()->load_plugin_descriptor(plugindir("maximal"));
+		check(pi3.get() != pi1.get());
+		check(strcmp(pi3.get()->identifier(), pi1.get()->identifier()) == 0);
+		check(pi3.get()->extensions().size() == pi1.get()->extensions().size());
+	} while (0);
+	check(errors == 0);
+}
+
+extern "C" void asynccontrol_cxx(void) {
+	cbc_counters_t *counters;
+	int errors;
+	
+	do {
+		shared_ptr<cpluff::plugin_container> pc = init_container_cxx(cpluff::logger::ERROR, &errors);
+		
+		// Scan and load a descriptor concurrently
+		pc.get()->register_plugin_collection("tmp/install/plugins");
+		cpluff::async_result<void> scan = pc.get()->scan_plugins_async(0);
+		cpluff::async_result<shared_ptr<cpluff::plugin_info> > load = pc.get()->load_plugin_descriptor_async(plugindir("minimal"));
+		scan.get();
+		check(load.valid());
+		check(strcmp(load.get().get()->identifier(), "minimal") == 0);
+		check(!load.valid());
+		
+		// Start and stop asynchronously
+		pc.get()->start_plugin_async("callbackcounter").get();
+		do {
+			cpluff::symbol_ref<cbc_counters_t> ref = pc.get()->resolve_symbol<cbc_counters_t>("callbackcounter", "cbc_counters");
+			counters = ref.get();
+			check(counters->start == 1);
+		} while (0);
+		pc.get()->stop_plugin_async("callbackcounter").get();
+		check(counters->stop == 1);
+		
+		// Errors are reported by the results
+		cpluff::async_result<void> start = pc.get()->start_plugin_async("nonexisting");
+		try {
+			start.get();
+			check(0);
+		} catch (const cpluff::api_error& e) {
+			check(e.reason() == cpluff::api_error::UNKNOWN);
+		}
+	} while (0);
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+extern "C" void discardasync_cxx(void) {
+	std::promise<void> gate;
+	bool timed_out = false;
+	int errors;
+	
+	// Loading the descriptor blocks until a writer opens the FIFO
+	mkdir("tmp", 0777);
+	mkdir("tmp/discardasync", 0777);
+	unlink("tmp/discardasync/plugin.xml");
+	check(mkfifo("tmp/discardasync/plugin.xml", 0666) == 0);
+	std::thread writer([&gate, &timed_out]() {
+		FILE *fh;
+		
+		if (gate.get_future().wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+			timed_out = true;
+		}
+		check((fh = fopen("tmp/discardasync/plugin.xml", "w")) != NULL);
+		fputs("<plugin id=\"discardasync\"/>\n", fh);
+		fclose(fh);
+	});
+	do {
+		shared_ptr<cpluff::plugin_container> pc = init_container_cxx(cpluff::logger::ERROR, &errors);
+		
+		// Discarding the result must not wait for the blocked operation
+		pc.get()->load_plugin_descriptor_async("tmp/discardasync");
+		gate.set_value();
+	} while (0);
+	writer.join();
+	unlink("tmp/discardasync/plugin.xml");
+	check(!timed_out);
+	check(errors == 0);
+}
+
+extern "C" void batchcontrol_cxx(void) {
+	const char *ids[] = { "symuser", "callbackcounter" };
+	const char *unknown_ids[] = { "nonexisting", "callbackcounter" };
+	cbc_counters_t *counters;
+	int errors;
+	
+	do {
+		shared_ptr<cpluff::plugin_container> pc = init_container_cxx(cpluff::logger::ERROR, &errors);
+		std::vector<std::string> paths;
+		
+		// Load several descriptors
+		paths.push_back(plugindir("minimal"));
+		paths.push_back(plugindir("maximal"));
+		std::vector<shared_ptr<cpluff::plugin_info> > infos = pc.get()->load_plugin_descriptors(paths.begin(), paths.end());
+		check(infos.size() == 2);
+		check(strcmp(infos[0].get()->identifier(), "minimal") == 0);
+		check(strcmp(infos[1].get()->identifier(), "maximal") == 0);
+		check(pc.get()->load_plugin_descriptors_async(paths).get().size() == 2);
+		
+		// Start and stop a range of plug-ins
+		pc.get()->register_plugin_collection("tmp/install/plugins");
+		pc.get()->scan_plugins(0);
+		pc.get()->start_plugins(ids, ids + 2, 2);
+		do {
+			cpluff::symbol_ref<cbc_counters_t> ref = pc.get()->resolve_symbol<cbc_counters_t>("callbackcounter", "cbc_counters");
+			counters = ref.get();
+			check(counters->start == 1);
+		} while (0);
+		pc.get()->stop_plugins(ids, ids + 2);
+		check(counters->stop == 1);
+		
+		// Unknown plug-ins are reported after stopping the known ones
+		pc.get()->start_plugins_async(std::vector<std::string>(ids, ids + 2), 2).get();
+		check(counters->start == 2);
+		try {
+			pc.get()->stop_plugins(unknown_ids, unknown_ids + 2);
+			check(0);
+		} catch (const cpluff::api_error& e) {
+			check(e.reason() == cpluff::api_error::UNKNOWN);
+		}
+		check(counters->stop == 2);
+		
+		// Stop all in the background
+		pc.get()->start_plugin("callbackcounter");
+		pc.get()->stop_all_plugins_async(2).get();
+		check(counters->stop == 3);
+	} while (0);
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
 #if 0
 extern "C" void initstartdestroy_cxx(void) {
 	int i;
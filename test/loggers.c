@@ -159,6 +159,50 @@ void updatelogger(void) {
 	check(errors == 0);
 }
 
+static char logger_order[64];
+
+static void order_logger(char id) {
+	size_t len = strlen(logger_order);
+	
+	if (len < sizeof(logger_order) - 1) {
+		logger_order[len] = id;
+	}
+}
+
+static void order_logger_a(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	order_logger('a');
+}
+
+static void order_logger_b(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	order_logger('b');
+}
+
+static void order_logger_c(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	order_logger('c');
+}
+
+void loggerorder(void) {
+	cp_context_t *ctx;
+	int errors;
+	
+	memset(logger_order, 0, sizeof(logger_order));
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_logger(ctx, order_logger_a, NULL, CP_LOG_INFO) == CP_OK);
+	check(cp_register_logger(ctx, order_logger_b, NULL, CP_LOG_INFO) == CP_OK);
+	check(cp_register_logger(ctx, order_logger_c, NULL, CP_LOG_INFO) == CP_OK);
+	cp_log(ctx, CP_LOG_INFO, "first");
+	check(!strcmp(logger_order, "abc"));
+	
+	// Removing a logger keeps the others in registration order
+	cp_unregister_logger(ctx, order_logger_b);
+	check(cp_register_logger(ctx, order_logger_a, NULL, CP_LOG_WARNING) == CP_OK);
+	cp_log(ctx, CP_LOG_INFO, "second");
+	cp_log(ctx, CP_LOG_WARNING, "third");
+	check(!strcmp(logger_order, "abccac"));
+	cp_destroy();
+	check(errors == 0);
+}
+
 struct log_info_t {
 	cp_log_severity_t severity;
 	char *msg;
@@ -245,3 +289,134 @@ void islogged(void) {
 	islogged_sev(ctx, CP_LOG_ERROR);
 	cp_destroy();
 }
+
+void logthreshold(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	int count = 0;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check(cp_register_logger(ctx, increment_logger, &count, CP_LOG_DEBUG) == CP_OK);
+	check(cp_is_logged(ctx, CP_LOG_DEBUG));
+	
+	// The default threshold applies to the main program and to plug-ins
+	check(cp_set_log_threshold(ctx, NULL, CP_LOG_WARNING) == CP_OK);
+	count = 0;
+	check(!cp_is_logged(ctx, CP_LOG_INFO));
+	check(cp_is_logged(ctx, CP_LOG_WARNING));
+	cp_log(ctx, CP_LOG_INFO, "info");
+	cp_log(ctx, CP_LOG_WARNING, "warning");
+	check(count == 1);
+	
+	// A plug-in threshold does not affect the main program
+	check(cp_set_log_threshold(ctx, "minimal", CP_LOG_DEBUG) == CP_OK);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check(count == 1);
+	
+	// Lowering the default threshold lets framework messages through
+	check(cp_set_log_threshold(ctx, NULL, CP_LOG_DEBUG) == CP_OK);
+	check(cp_start_plugin(ctx, "minimal") == CP_OK);
+	check(count > 1);
+	cp_destroy();
+}
+
+void concurrentlogging(void) {
+	cp_context_t *ctx;
+	int count = 0;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	cp_set_concurrent_logging(ctx, 1);
+	logmsg_sev(ctx, CP_LOG_DEBUG, "debug");
+	logmsg_sev(ctx, CP_LOG_ERROR, "error");
+	
+	// Logger changes take effect for the following messages
+	check(cp_register_logger(ctx, increment_logger, &count, CP_LOG_WARNING) == CP_OK);
+	cp_log(ctx, CP_LOG_INFO, "info");
+	cp_log(ctx, CP_LOG_WARNING, "warning");
+	check(count == 1);
+	check(cp_register_logger(ctx, increment_logger, &count, CP_LOG_INFO) == CP_OK);
+	cp_log(ctx, CP_LOG_INFO, "info");
+	check(count == 2);
+	cp_unregister_logger(ctx, increment_logger);
+	cp_log(ctx, CP_LOG_ERROR, "error");
+	check(count == 2);
+	cp_destroy();
+}
+
+void asynclogging(void) {
+	cp_context_t *ctx;
+	int count = 0;
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check(cp_register_logger(ctx, increment_logger, &count, CP_LOG_INFO) == CP_OK);
+	
+	// Messages are passed to the loggers at the latest when disabling
+	check(cp_set_async_logging(ctx, 4, CP_AL_BLOCK) == CP_OK);
+	for (i = 0; i < 100; i++) {
+		cp_log(ctx, CP_LOG_INFO, "info");
+		cp_log(ctx, CP_LOG_DEBUG, "debug");
+	}
+	check(cp_set_async_logging(ctx, 0, 0) == CP_OK);
+	check(count == 100);
+	
+	// Nothing is dropped while there is space in the ring
+	check(cp_set_async_logging(ctx, 64, 0) == CP_OK);
+	cp_log(ctx, CP_LOG_WARNING, "warning");
+	cp_unregister_logger(ctx, increment_logger);
+	cp_log(ctx, CP_LOG_WARNING, "warning");
+	check(cp_set_async_logging(ctx, 0, 0) == CP_OK);
+	check(count == 101);
+	check(cp_get_dropped_log_messages(ctx) == 0);
+	cp_destroy();
+}
+
+struct record_log_t {
+	int count;
+	int num_formatted;
+	char format[64];
+	char text[64];
+};
+
+static void record_logger(const cp_log_record_t *record, void *user_data) {
+	struct record_log_t *rl = user_data;
+	
+	rl->count++;
+	if (record->num_args > 0) {
+		rl->num_formatted++;
+	}
+	strncpy(rl->format, record->format, sizeof(rl->format));
+	rl->format[sizeof(rl->format) - 1] = '\0';
+	
+	// Truncated rendering reports the complete length
+	check(cp_render_log_record(record, rl->text, 4) == cp_render_log_record(record, rl->text, sizeof(rl->text)));
+	check(cp_render_log_record(record, NULL, 0) == (int) strlen(rl->text));
+}
+
+void structuredlogger(void) {
+	cp_context_t *ctx;
+	struct record_log_t rl;
+	
+	memset(&rl, 0, sizeof(rl));
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check(cp_register_structured_logger(ctx, record_logger, &rl, CP_LOG_DEBUG) == CP_OK);
+	
+	// Framework messages are passed unformatted
+	check(cp_register_logger(ctx, increment_logger, &rl.count, CP_LOG_ERROR) == CP_OK);
+	check(rl.num_formatted > 0);
+	check(strcmp(rl.format, "%s registered a logger.") == 0);
+	check(strstr(rl.text, " registered a logger.") != NULL && strchr(rl.text, '%') == NULL);
+	
+	// Application messages are passed as is
+	cp_log(ctx, CP_LOG_INFO, "100% done");
+	check(!strcmp(rl.format, "100% done") && !strcmp(rl.text, "100% done"));
+	
+	cp_unregister_structured_logger(ctx, record_logger);
+	rl.count = 0;
+	cp_log(ctx, CP_LOG_INFO, "info");
+	check(rl.count == 0);
+	cp_destroy();
+}
@@ -25,7 +25,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include "plugins-source/callbackcounter/callbackcounter.h"
+#include "plugins-source/slowstart/slowstart.h"
 #include "test.h"
+#if defined(CP_THREADS) && !defined(_WIN32)
+#define TEST_THREADS 1
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_UNISTD_H)
+#define TEST_FORK 1
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 static char *argv[] = { "testarg0", NULL };
 
@@ -70,6 +84,7 @@ void plugincallbacks(void) {
 	check(counters->logger == 1);
 	check(counters->listener == 1);
 	check(counters->run == 1);
+	check(counters->delayed_run == 0);
 	check(counters->stop == 0);
 	check(counters->destroy == 0);
 
@@ -80,6 +95,7 @@ void plugincallbacks(void) {
 	check(counters->logger == 1);
 	check(counters->listener == 1);
 	check(counters->run == 3);
+	check(counters->delayed_run == 3);
 	check(counters->stop == 0);
 	check(counters->destroy == 0);
 
@@ -117,3 +133,736 @@ void plugincallbacks(void) {
 	/* Free the counter data that was intentionally leaked by the plug-in */
 	free(counters);
 }
+
+void pluginrunparallel(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(counters->run == 0);
+	
+	// Run until no more work, a run function is never called concurrently
+	cp_run_plugins_parallel(ctx, 4);
+	check(counters->run == 3);
+	check(counters->delayed_run == 3);
+	check(!cp_run_plugins_step(ctx));
+	
+	// Nothing to run
+	cp_run_plugins_parallel(ctx, 4);
+	check(counters->run == 3);
+	check(counters->delayed_run == 3);
+	cp_release_symbol(ctx, counters);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void pluginrunwait(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	
+	// Waiting work is reported immediately
+	check(cp_run_plugins_wait(ctx, 0));
+	check(cp_run_plugins_wait(ctx, -1));
+	check(counters->run == 0);
+	
+	// Wait for the delayed run function once the others are done
+	while (counters->run < 3) {
+		cp_run_plugins_step(ctx);
+	}
+	if (counters->delayed_run < 3) {
+		check(cp_run_plugins_wait(ctx, 10000000));
+	}
+	cp_run_plugins(ctx);
+	check(counters->delayed_run == 3);
+	
+	// Nothing to run, the wait times out
+	check(!cp_run_plugins_wait(ctx, 0));
+	check(!cp_run_plugins_wait(ctx, 1000));
+	cp_release_symbol(ctx, counters);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void pluginprefetch(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	
+	// Prefetch twice, the second prefetch cancelling the first one
+	check(cp_prefetch_plugins(ctx, 0) == CP_OK);
+	check(cp_prefetch_plugins(ctx, CP_PF_DLOPEN) == CP_OK);
+	
+	// Start the plug-in using the prefetched runtime library if available
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(counters->create == 1);
+	check(counters->start == 1);
+	cp_release_symbol(ctx, counters);
+	
+	// Leave a prefetch running over context destruction
+	check(cp_prefetch_plugins(ctx, CP_PF_DLOPEN) == CP_OK);
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void plugintimings(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	cp_plugin_timings_t timings;
+	cp_timings_summary_t summary;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	cp_set_timings(ctx, 1);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check(cp_start_plugin(ctx, "callbackcounter") == CP_OK);
+	
+	// Check the plug-in timeline
+	check(cp_get_plugin_timings(ctx, "callbackcounter", &timings) == CP_OK);
+	check(timings.parse.begin != 0 && timings.parse.begin <= timings.parse.end);
+	check(timings.resolve.begin != 0 && timings.resolve.begin <= timings.resolve.end);
+	check(timings.load.begin >= timings.resolve.begin && timings.load.end <= timings.resolve.end);
+	check(timings.create.begin >= timings.resolve.end && timings.create.begin <= timings.create.end);
+	check(timings.start.begin >= timings.create.end && timings.start.begin <= timings.start.end);
+	check(cp_get_plugin_timings(ctx, "nonexisting", &timings) == CP_ERR_UNKNOWN);
+	
+	// Check the summary
+	cp_get_timings_summary(ctx, &summary);
+	check(summary.first == timings.parse.begin);
+	check(summary.last == timings.start.end);
+	check(summary.resolve_total >= summary.load_total);
+	
+	// Nothing is recorded while disabled
+	cp_set_timings(ctx, 0);
+	check(cp_stop_plugin(ctx, "callbackcounter") == CP_OK);
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	cp_release_symbol(ctx, counters);
+	check(cp_get_plugin_timings(ctx, "callbackcounter", &timings) == CP_OK);
+	check(timings.start.end == summary.last);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+/// The maximum number of recorded trace events
+#define MAX_TRACE_EVENTS 64
+
+/// A recorded trace event
+typedef struct trace_event_t {
+	cp_trace_event_t event;
+	int own;
+	cp_status_t status;
+} trace_event_t;
+
+static trace_event_t trace_events[MAX_TRACE_EVENTS];
+
+static int num_trace_events;
+
+static void trace_hook(const cp_trace_record_t *record, void *user_data) {
+	check(user_data == trace_events);
+	check(record->time != 0);
+	if (record->event != CP_TRACE_LOCK_WAIT && num_trace_events < MAX_TRACE_EVENTS) {
+		trace_event_t *te = trace_events + num_trace_events++;
+		
+		te->event = record->event;
+		te->own = (record->plugin_id != NULL && !strcmp(record->plugin_id, "callbackcounter"));
+		te->status = record->status;
+	}
+}
+
+/**
+ * Returns the index of the first recorded event of the specified type
+ * concerning the callbackcounter plug-in at or after the specified index,
+ * or -1 if there is none.
+ */
+static int find_trace_event(cp_trace_event_t event, int from) {
+	int i;
+	
+	for (i = from; i < num_trace_events; i++) {
+		if (trace_events[i].event == event
+			&& (trace_events[i].own || event == CP_TRACE_LOAD_BEGIN)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void tracehook(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	int i;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	num_trace_events = 0;
+	cp_set_trace_hook(ctx, trace_hook, trace_events);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check(cp_start_plugin(ctx, "callbackcounter") == CP_OK);
+	
+	// Check the order of the lifecycle events
+	check((i = find_trace_event(CP_TRACE_LOAD_BEGIN, 0)) == 0);
+	check((i = find_trace_event(CP_TRACE_LOAD_END, i)) > 0 && trace_events[i].status == CP_OK);
+	check((i = find_trace_event(CP_TRACE_INSTALL, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_RESOLVE_BEGIN, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_DLOPEN_BEGIN, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_DLOPEN_END, i)) > 0 && trace_events[i].status == CP_OK);
+	check((i = find_trace_event(CP_TRACE_RESOLVE_END, i)) > 0 && trace_events[i].status == CP_OK);
+	check((i = find_trace_event(CP_TRACE_CREATE_BEGIN, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_CREATE_END, i)) > 0 && trace_events[i].status == CP_OK);
+	check((i = find_trace_event(CP_TRACE_START_BEGIN, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_START_END, i)) > 0 && trace_events[i].status == CP_OK);
+	
+	// Run functions and symbols
+	cp_run_plugins_step(ctx);
+	check((i = find_trace_event(CP_TRACE_RUN_BEGIN, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_RUN_END, i)) > 0);
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check((i = find_trace_event(CP_TRACE_SYMBOL_RESOLVE, i)) > 0 && trace_events[i].status == CP_OK);
+	cp_release_symbol(ctx, counters);
+	check((i = find_trace_event(CP_TRACE_SYMBOL_RELEASE, i)) > 0);
+	
+	// Stopping and uninstalling
+	check(cp_uninstall_plugin(ctx, "callbackcounter") == CP_OK);
+	check((i = find_trace_event(CP_TRACE_STOP_BEGIN, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_STOP_END, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_DESTROY_BEGIN, i)) > 0);
+	check((i = find_trace_event(CP_TRACE_DESTROY_END, i)) > 0);
+	
+	// Nothing is reported after removing the hook
+	cp_set_trace_hook(ctx, NULL, NULL);
+	i = num_trace_events;
+	check(cp_load_plugin_descriptor(ctx, "tmp/install/plugins/nonexisting", &status) == NULL);
+	check(num_trace_events == i);
+	
+	cp_destroy();
+	check(errors == 1);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void memorystats(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	cp_memory_stats_t stats, env_stats;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	
+	// An installed plug-in only uses memory for its description
+	check(cp_get_memory_stats(ctx, "callbackcounter", &stats) == CP_OK);
+	check(stats.descriptor_bytes > 0 && stats.descriptor_objects > 0);
+	check(stats.cfg_bytes <= stats.descriptor_bytes);
+	check(stats.contexts == 0);
+	check(stats.defined_symbols == 0 && stats.loggers == 0 && stats.listeners == 0 && stats.run_funcs == 0);
+	check(cp_get_memory_stats(ctx, "nonexisting", &stats) == CP_ERR_UNKNOWN);
+	
+	// The started plug-in registers a symbol, a logger, a listener and run functions
+	check(cp_start_plugin(ctx, "callbackcounter") == CP_OK);
+	check(cp_get_memory_stats(ctx, "callbackcounter", &stats) == CP_OK);
+	check(stats.contexts == 1 && stats.context_bytes > 0);
+	check(stats.defined_symbols == 1 && stats.defined_symbol_bytes > 0);
+	check(stats.loggers == 1 && stats.logger_bytes > 0);
+	check(stats.listeners == 1 && stats.listener_bytes > 0);
+	check(stats.run_funcs == 2 && stats.run_func_bytes > 0);
+	check(stats.total_bytes == stats.descriptor_bytes + stats.context_bytes
+		+ stats.defined_symbol_bytes + stats.resolved_symbol_bytes
+		+ stats.listener_bytes + stats.logger_bytes + stats.run_func_bytes);
+	
+	// The environment totals include the client program
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(cp_get_memory_stats(ctx, NULL, &env_stats) == CP_OK);
+	check(env_stats.contexts == 2);
+	check(env_stats.resolved_symbols == 1);
+	check(env_stats.loggers > stats.loggers);
+	check(env_stats.descriptor_bytes == stats.descriptor_bytes);
+	check(env_stats.total_bytes > stats.total_bytes);
+	cp_release_symbol(ctx, counters);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void pluginrunfor(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	
+	// A zero budget still runs one waiting run function
+	check(cp_run_plugins_for(ctx, 0));
+	check(counters->run == 1);
+	
+	// Run until all work, including the delayed run function, is done
+	while (cp_run_plugins_for(ctx, 1000000));
+	check(counters->run == 3);
+	check(counters->delayed_run == 3);
+	check(!cp_run_plugins_for(ctx, 1000));
+	cp_release_symbol(ctx, counters);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void pluginfastexit(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(counters->start == 1);
+	cp_release_symbol(ctx, counters);
+	
+	// The plug-in is stopped but not destroyed
+	cp_set_fast_exit(ctx, 1);
+	cp_destroy();
+	check(counters->stop == 1);
+	check(counters->destroy == 0);
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void pluginretention(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters1, *counters2, *counters3;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	cp_set_runtime_retention(ctx, 1);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	check((counters1 = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	cp_release_symbol(ctx, counters1);
+	
+	// The runtime library is retained over uninstallation
+	check(cp_uninstall_plugin(ctx, "callbackcounter") == CP_OK);
+	check(counters1->destroy == 1);
+	
+	// Reinstalling and starting takes the retained library back into use
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	check((counters2 = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(counters2->create == 1);
+	check(counters2->start == 1);
+	cp_release_symbol(ctx, counters2);
+	check(cp_release_retained_runtimes(ctx) == 0);
+	
+	// Retained libraries can be released explicitly
+	check(cp_uninstall_plugin(ctx, "callbackcounter") == CP_OK);
+	check(cp_release_retained_runtimes(ctx) == 1);
+	check(cp_release_retained_runtimes(ctx) == 0);
+	
+	// Disabling retention closes the libraries on uninstallation
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	check((counters3 = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	cp_release_symbol(ctx, counters3);
+	cp_set_runtime_retention(ctx, 0);
+	check(cp_uninstall_plugin(ctx, "callbackcounter") == CP_OK);
+	check(cp_release_retained_runtimes(ctx) == 0);
+	cp_release_info(ctx, plugin);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters1);
+	free(counters2);
+	free(counters3);
+}
+
+#ifdef TEST_FORK
+
+/**
+ * Uses the context in a forked child process. Failed checks abort the
+ * child process.
+ * 
+ * @param ctx the plug-in context inherited from the parent process
+ * @param errors the error counter of the context
+ * @return the exit status of the child process
+ */
+static int forked_child(cp_context_t *ctx, int *errors) {
+	cp_status_t status;
+	cbc_counters_t *counters;
+	int logged;
+	
+	cp_after_fork_child();
+	
+	// Log through the asynchronous ring restarted in the child
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(counters->start == 1);
+	logged = counters->logger;
+	cp_log(ctx, CP_LOG_WARNING, "Logged by a forked child process.");
+	check(cp_set_async_logging(ctx, 0, 0) == CP_OK);
+	check(counters->logger == logged + 1);
+	cp_release_symbol(ctx, counters);
+	
+	// Stop and start the inherited plug-in
+	check(cp_stop_plugin(ctx, "callbackcounter") == CP_OK);
+	check(counters->stop == 1);
+	check(cp_start_plugin(ctx, "callbackcounter") == CP_OK);
+	check(cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status) == counters && status == CP_OK);
+	check(counters->start == 2);
+	cp_release_symbol(ctx, counters);
+	check(cp_stop_plugin(ctx, "callbackcounter") == CP_OK);
+	check(counters->stop == 2);
+	
+	return (*errors == 0 ? 0 : 1);
+}
+
+#endif
+
+void pluginfork(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_context_args(ctx, argv);
+	check(cp_set_async_logging(ctx, 16, 0) == CP_OK);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	
+	// Preparing for a fork stops a prefetch in progress
+	check(cp_prefetch_plugins(ctx, CP_PF_DLOPEN) == CP_OK);
+	cp_prepare_fork();
+	cp_after_fork_parent();
+	
+	// The context remains usable in the parent
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(counters->create == 1);
+	check(counters->start == 1);
+	cp_release_symbol(ctx, counters);
+	cp_prepare_fork();
+	cp_after_fork_parent();
+	
+#ifdef TEST_FORK
+	// The context is usable in a forked child process
+	do {
+		pid_t pid;
+		int wstatus;
+		
+		cp_prepare_fork();
+		pid = fork();
+		if (pid == 0) {
+			_exit(forked_child(ctx, &errors));
+		}
+		cp_after_fork_parent();
+		check(pid != -1);
+		check(waitpid(pid, &wstatus, 0) == pid);
+		check(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+	} while (0);
+	check(counters->stop == 0);
+#endif
+	
+	check(cp_stop_plugin(ctx, "callbackcounter") == CP_OK);
+	check(counters->stop == 1);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+#ifdef TEST_THREADS
+
+/// A lifecycle operation run in a separate thread
+typedef struct lifecycle_op_t {
+	
+	/// The plug-in context
+	cp_context_t *ctx;
+	
+	/// The identifier of the plug-in to be started, or NULL to uninstall
+	const char *start_id;
+	
+	/// The identifier of the plug-in to be uninstalled
+	const char *uninstall_id;
+	
+	/// The status of the operation
+	cp_status_t status;
+	
+	/// The state of the slowly starting plug-in when the operation returned
+	cp_plugin_state_t slow_state;
+	
+	/// The thread running the operation
+	pthread_t thread;
+} lifecycle_op_t;
+
+static void *run_lifecycle_op(void *arg) {
+	lifecycle_op_t *op = arg;
+	
+	if (op->start_id != NULL) {
+		op->status = cp_start_plugin(op->ctx, op->start_id);
+	} else {
+		op->status = cp_uninstall_plugin(op->ctx, op->uninstall_id);
+	}
+	op->slow_state = cp_get_plugin_state(op->ctx, "slowstart");
+	return NULL;
+}
+
+static void start_lifecycle_op(lifecycle_op_t *op, cp_context_t *ctx, const char *start_id, const char *uninstall_id) {
+	op->ctx = ctx;
+	op->start_id = start_id;
+	op->uninstall_id = uninstall_id;
+	op->status = CP_ERR_RUNTIME;
+	op->slow_state = CP_PLUGIN_UNINSTALLED;
+	check(pthread_create(&op->thread, NULL, run_lifecycle_op, op) == 0);
+}
+
+static void sleep_ms(int ms) {
+	struct timespec ts;
+	
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+}
+
+#endif
+
+void lifecyclelocking(void) {
+#ifdef TEST_THREADS
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	lifecycle_op_t slow, start, uninstall;
+	cbc_counters_t *counters;
+	FILE *fh;
+	int errors;
+	int logged;
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/lifecycle-plugins/slowstart", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check(cp_start_plugin(ctx, "callbackcounter") == CP_OK);
+	
+	// Block the start function of the slowly starting plug-in
+	unlink(SS_GATE);
+	check(mkfifo(SS_GATE, 0666) == 0);
+	start_lifecycle_op(&slow, ctx, "slowstart", NULL);
+	for (i = 0; i < 10000 && cp_get_plugin_state(ctx, "slowstart") != CP_PLUGIN_STARTING; i++) {
+		sleep_ms(1);
+	}
+	check(cp_get_plugin_state(ctx, "slowstart") == CP_PLUGIN_STARTING);
+	
+	// Queries, logging and resolving symbols of active plug-ins proceed
+	check((plugin = cp_get_plugin_info(ctx, "callbackcounter", &status)) != NULL && status == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	logged = counters->logger;
+	cp_log(ctx, CP_LOG_WARNING, "Logged during a blocked plug-in start.");
+	check(counters->logger == logged + 1);
+	cp_release_symbol(ctx, counters);
+	
+	// Starting and uninstalling other plug-ins wait for the blocked start
+	start_lifecycle_op(&start, ctx, "minimal", NULL);
+	start_lifecycle_op(&uninstall, ctx, NULL, "callbackcounter");
+	sleep_ms(100);
+	check(cp_get_plugin_state(ctx, "minimal") != CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "callbackcounter") == CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "slowstart") == CP_PLUGIN_STARTING);
+	
+	// Release the start function
+	check((fh = fopen(SS_GATE, "w")) != NULL);
+	fclose(fh);
+	check(pthread_join(slow.thread, NULL) == 0);
+	check(pthread_join(start.thread, NULL) == 0);
+	check(pthread_join(uninstall.thread, NULL) == 0);
+	unlink(SS_GATE);
+	check(slow.status == CP_OK);
+	check(start.status == CP_OK && start.slow_state == CP_PLUGIN_ACTIVE);
+	check(uninstall.status == CP_OK && uninstall.slow_state == CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "callbackcounter") == CP_PLUGIN_UNINSTALLED);
+	check(counters->stop == 1);
+	
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+#endif
+}
+
+#ifdef TEST_THREADS
+
+/// The progress of a blocking batch plug-in listener
+typedef struct slow_batch_t {
+	
+	/// Protects the other fields
+	pthread_mutex_t mutex;
+	
+	/// Signaled when the listener has been called or released
+	pthread_cond_t cond;
+	
+	/// Whether the listener has been called
+	int entered;
+	
+	/// Whether the listener may return
+	int released;
+	
+	/// Whether the listener gave up waiting to be released
+	int timed_out;
+} slow_batch_t;
+
+/**
+ * Waits for the specified flag of a blocking batch listener to be set,
+ * giving up after ten seconds. The caller must hold the mutex.
+ * 
+ * @param sb the listener progress
+ * @param flag the flag to wait for
+ * @return whether the flag was set
+ */
+static int wait_slow_batch(slow_batch_t *sb, int *flag) {
+	struct timespec deadline;
+	
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 10;
+	while (!*flag) {
+		if (pthread_cond_timedwait(&sb->cond, &sb->mutex, &deadline) != 0) {
+			break;
+		}
+	}
+	return *flag;
+}
+
+static void slow_batch_listener(const cp_plugin_event_t *events, int num_events, void *user_data) {
+	slow_batch_t *sb = user_data;
+	
+	// Block the first batch until released
+	pthread_mutex_lock(&sb->mutex);
+	if (!sb->entered) {
+		sb->entered = 1;
+		pthread_cond_broadcast(&sb->cond);
+		sb->timed_out = !wait_slow_batch(sb, &sb->released);
+	}
+	pthread_mutex_unlock(&sb->mutex);
+}
+
+#endif
+
+void slowbatchlistener(void) {
+#ifdef TEST_THREADS
+	cp_context_t *ctx;
+	slow_batch_t sb;
+	int errors;
+	int entered;
+	
+	memset(&sb, 0, sizeof(sb));
+	check(pthread_mutex_init(&sb.mutex, NULL) == 0);
+	check(pthread_cond_init(&sb.cond, NULL) == 0);
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, pcollectiondir("dependencies")) == CP_OK);
+	check(cp_register_plistener_batch(ctx, slow_batch_listener, &sb, 0) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	pthread_mutex_lock(&sb.mutex);
+	entered = wait_slow_batch(&sb, &sb.entered);
+	pthread_mutex_unlock(&sb.mutex);
+	check(entered);
+	
+	// The context is not locked while a batch listener is running
+	check(cp_get_plugin_state(ctx, "chain1") == CP_PLUGIN_INSTALLED);
+	check(cp_start_plugin(ctx, "chain1") == CP_OK);
+	pthread_mutex_lock(&sb.mutex);
+	sb.released = 1;
+	pthread_cond_broadcast(&sb.cond);
+	pthread_mutex_unlock(&sb.mutex);
+	cp_destroy();
+	pthread_mutex_lock(&sb.mutex);
+	check(!sb.timed_out);
+	pthread_mutex_unlock(&sb.mutex);
+	check(errors == 0);
+	pthread_cond_destroy(&sb.cond);
+	pthread_mutex_destroy(&sb.mutex);
+#endif
+}
@@ -22,6 +22,7 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "test.h"
 
@@ -157,3 +158,366 @@ void plugindeploop(void) {
 
 	cp_destroy();	
 }
+
+/// Sequence numbers of plug-in state changes recorded by a listener
+typedef struct seq_t {
+	int counter;
+	int started[5];
+	int stopped[5];
+} seq_t;
+
+static const char * const seq_ids[] = { "chain1", "chain2", "chain3", "loop2", "loop4" };
+
+static void seq_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	seq_t *seq = user_data;
+	int i;
+	
+	for (i = 0; i < 5; i++) {
+		if (!strcmp(plugin_id, seq_ids[i])) {
+			if (new_state == CP_PLUGIN_ACTIVE) {
+				seq->started[i] = ++seq->counter;
+			} else if (old_state == CP_PLUGIN_ACTIVE) {
+				seq->stopped[i] = ++seq->counter;
+			}
+		}
+	}
+}
+
+void plugindepparallel(void) {
+	cp_context_t *ctx;
+	const char * const act_none[] = { NULL };
+	const char * const act_all[] = { "chain1", "chain2", "chain3", "loop1", "loop2", "loop3", "loop4", "loop5", "sloop1", "sloop2", NULL };
+	const char * const act_chain123[] = { "chain1", "chain2", "chain3", NULL };
+	const char * const ids_chain1[] = { "chain1", NULL };
+	seq_t seq;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((cp_register_pcollection(ctx, pcollectiondir("dependencies"))) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	memset(&seq, 0, sizeof(seq));
+	check(cp_register_plistener(ctx, seq_listener, &seq) == CP_OK);
+	
+	// Start a chain and check that imports were started first
+	check(cp_start_plugins_parallel(ctx, ids_chain1, 4) == CP_OK);
+	check(active(ctx, act_chain123));
+	check(seq.started[2] < seq.started[1] && seq.started[1] < seq.started[0]);
+	
+	// Start all plug-ins, the ones with missing dependencies fail
+	check(cp_start_plugins_parallel(ctx, NULL, 4) == CP_ERR_DEPENDENCY);
+	check(active(ctx, act_all));
+	check(seq.started[4] < seq.started[3]);
+	
+	// Stop all plug-ins and check that importers were stopped first
+	check(cp_stop_plugins_parallel(ctx, 4) == CP_OK);
+	check(active(ctx, act_none));
+	check(seq.stopped[0] < seq.stopped[1] && seq.stopped[1] < seq.stopped[2]);
+	check(seq.stopped[3] < seq.stopped[4]);
+	
+	cp_destroy();
+}
+
+/// Plug-in state queries made by a listener
+typedef struct query_t {
+	cp_context_t *ctx;
+	int num_events;
+	int num_mismatches;
+} query_t;
+
+static void query_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	query_t *q = user_data;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	
+	// The listener holds the context, queries must not block
+	q->num_events++;
+	if (cp_get_plugin_state(q->ctx, plugin_id) != new_state
+		|| !cp_is_logged(q->ctx, CP_LOG_ERROR)) {
+		q->num_mismatches++;
+	}
+	if ((plugin = cp_get_plugin_info(q->ctx, plugin_id, &status)) == NULL
+		|| strcmp(plugin->identifier, plugin_id)) {
+		q->num_mismatches++;
+	}
+	if (plugin != NULL) {
+		cp_release_info(q->ctx, plugin);
+	}
+}
+
+void plugindepparallelquery(void) {
+	cp_context_t *ctx;
+	const char * const act_none[] = { NULL };
+	const char * const act_chain123[] = { "chain1", "chain2", "chain3", NULL };
+	const char * const ids_chain1[] = { "chain1", NULL };
+	cp_plugin_info_t **plugins;
+	cp_timings_summary_t summary;
+	query_t q;
+	int n;
+	
+	ctx = init_context(CP_LOG_ERROR, NULL);
+	check((cp_register_pcollection(ctx, pcollectiondir("dependencies"))) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	memset(&q, 0, sizeof(q));
+	q.ctx = ctx;
+	check(cp_register_plistener(ctx, query_listener, &q) == CP_OK);
+	
+	// Query the state from listeners while several threads start plug-ins
+	check(cp_start_plugins_parallel(ctx, ids_chain1, 4) == CP_OK);
+	check(active(ctx, act_chain123));
+	check(q.num_events > 0);
+	check(q.num_mismatches == 0);
+	
+	// Queries between changes
+	check((plugins = cp_get_plugins_info(ctx, NULL, &n)) != NULL);
+	check(n == 12);
+	cp_release_info(ctx, plugins);
+	cp_get_timings_summary(ctx, &summary);
+	
+	check(cp_stop_plugins_parallel(ctx, 4) == CP_OK);
+	check(active(ctx, act_none));
+	check(q.num_mismatches == 0);
+	
+	cp_destroy();
+}
+
+/// Completed asynchronous plug-in start and stop requests
+typedef struct async_t {
+	cp_context_t *ctx;
+	seq_t seq;
+	int num_done;
+	cp_status_t status[4];
+	int chain_active[4];
+} async_t;
+
+static void async_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	async_t *a = user_data;
+	
+	seq_listener(plugin_id, old_state, new_state, &a->seq);
+}
+
+static void async_done(const char *plugin_id, cp_status_t status, void *user_data) {
+	async_t *a = user_data;
+	
+	if (a->num_done < 4) {
+		a->status[a->num_done] = status;
+		a->chain_active[a->num_done] = (cp_get_plugin_state(a->ctx, "chain3") == CP_PLUGIN_ACTIVE);
+	}
+	a->num_done++;
+}
+
+void plugindepasync(void) {
+	cp_context_t *ctx;
+	async_t a;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((cp_register_pcollection(ctx, pcollectiondir("dependencies"))) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	memset(&a, 0, sizeof(a));
+	a.ctx = ctx;
+	check(cp_register_plistener(ctx, async_listener, &a) == CP_OK);
+	
+	// Queue requests, they are completed in order at the latest on destroy
+	check(cp_start_plugin_async(ctx, "chain1", async_done, &a) == CP_OK);
+	check(cp_start_plugin_async(ctx, "nonexisting", async_done, &a) == CP_OK);
+	check(cp_start_plugin_async(ctx, "loop1", NULL, NULL) == CP_OK);
+	check(cp_stop_plugin_async(ctx, "chain3", async_done, &a) == CP_OK);
+	check(cp_stop_plugin_async(ctx, "nonexisting", async_done, &a) == CP_OK);
+	cp_destroy();
+	
+	check(a.num_done == 4);
+	check(a.status[0] == CP_OK && a.chain_active[0]);
+	check(a.status[1] == CP_ERR_UNKNOWN);
+	check(a.status[2] == CP_OK && !a.chain_active[2]);
+	check(a.status[3] == CP_ERR_UNKNOWN);
+	
+	// State transitions were reported to listeners
+	check(a.seq.started[2] < a.seq.started[1] && a.seq.started[1] < a.seq.started[0]);
+	check(a.seq.stopped[0] > a.seq.started[3]);
+	check(a.seq.stopped[0] < a.seq.stopped[1] && a.seq.stopped[1] < a.seq.stopped[2]);
+}
+
+/// A recorded plug-in event
+typedef struct event_t {
+	char plugin_id[32];
+	cp_plugin_state_t old_state;
+	cp_plugin_state_t new_state;
+} event_t;
+
+/// Plug-in events received by plug-in listeners
+typedef struct events_t {
+	int num_events;
+	int num_batches;
+	event_t events[256];
+} events_t;
+
+static void record_event(events_t *e, const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state) {
+	if (e->num_events < 256) {
+		strncpy(e->events[e->num_events].plugin_id, plugin_id, sizeof(e->events[e->num_events].plugin_id) - 1);
+		e->events[e->num_events].old_state = old_state;
+		e->events[e->num_events].new_state = new_state;
+	}
+	e->num_events++;
+}
+
+static void sync_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	record_event(user_data, plugin_id, old_state, new_state);
+}
+
+static void batch_listener(const cp_plugin_event_t *events, int num_events, void *user_data) {
+	events_t *e = user_data;
+	int i;
+	
+	e->num_batches++;
+	for (i = 0; i < num_events; i++) {
+		record_event(e, events[i].plugin_id, events[i].old_state, events[i].new_state);
+	}
+}
+
+static void coalescing_listener(const cp_plugin_event_t *events, int num_events, void *user_data) {
+	batch_listener(events, num_events, user_data);
+}
+
+void plugindepbatchlistener(void) {
+	cp_context_t *ctx;
+	events_t *se, *be, *ce;
+	int i;
+	
+	check((se = calloc(3, sizeof(events_t))) != NULL);
+	be = se + 1;
+	ce = se + 2;
+	ctx = init_context(CP_LOG_ERROR, NULL);
+	check((cp_register_pcollection(ctx, pcollectiondir("dependencies"))) == CP_OK);
+	check(cp_register_plistener(ctx, sync_listener, se) == CP_OK);
+	check(cp_register_plistener_batch(ctx, batch_listener, be, 0) == CP_OK);
+	check(cp_register_plistener_batch(ctx, coalescing_listener, ce, CP_PLF_COALESCE) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_start_plugin(ctx, "chain1") == CP_OK);
+	check(cp_stop_plugin(ctx, "chain3") == CP_OK);
+	
+	// Queued events are delivered before the context is destroyed
+	cp_destroy();
+	
+	// Batch listeners receive the same events in the same order
+	check(se->num_events > 0 && se->num_events <= 256);
+	check(be->num_events == se->num_events);
+	check(be->num_batches > 0 && be->num_batches <= be->num_events);
+	for (i = 0; i < se->num_events; i++) {
+		check(!strcmp(be->events[i].plugin_id, se->events[i].plugin_id));
+		check(be->events[i].old_state == se->events[i].old_state);
+		check(be->events[i].new_state == se->events[i].new_state);
+	}
+	
+	// Coalesced events form a chain of actual changes for each plug-in
+	check(ce->num_events <= se->num_events);
+	for (i = 0; i < ce->num_events; i++) {
+		int j;
+		
+		check(ce->events[i].old_state != ce->events[i].new_state);
+		for (j = i + 1; j < ce->num_events; j++) {
+			if (!strcmp(ce->events[j].plugin_id, ce->events[i].plugin_id)) {
+				check(ce->events[j].old_state == ce->events[i].new_state);
+				break;
+			}
+		}
+	}
+	
+	free(se);
+}
+
+static void filtered_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	record_event(user_data, plugin_id, old_state, new_state);
+}
+
+static void removed_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	record_event(user_data, plugin_id, old_state, new_state);
+}
+
+void plugindepfilteredlistener(void) {
+	cp_context_t *ctx;
+	events_t *pe, *se, *re;
+	
+	check((pe = calloc(3, sizeof(events_t))) != NULL);
+	se = pe + 1;
+	re = pe + 2;
+	ctx = init_context(CP_LOG_ERROR, NULL);
+	check((cp_register_pcollection(ctx, pcollectiondir("dependencies"))) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Listeners for one plug-in and for one state of any plug-in
+	check(cp_register_plistener_filtered(ctx, filtered_listener, pe, "chain2", CP_STATE_MASK(CP_PLUGIN_ACTIVE) | CP_STATE_MASK(CP_PLUGIN_RESOLVED)) == CP_OK);
+	check(cp_register_plistener_filtered(ctx, sync_listener, se, NULL, CP_STATE_MASK(CP_PLUGIN_ACTIVE)) == CP_OK);
+	check(cp_register_plistener_filtered(ctx, removed_listener, re, "chain2", CP_STATE_MASK_ALL) == CP_OK);
+	cp_unregister_plistener(ctx, removed_listener);
+	
+	check(cp_start_plugin(ctx, "chain1") == CP_OK);
+	check(pe->num_events == 2);
+	check(!strcmp(pe->events[0].plugin_id, "chain2") && pe->events[0].new_state == CP_PLUGIN_RESOLVED);
+	check(!strcmp(pe->events[1].plugin_id, "chain2") && pe->events[1].new_state == CP_PLUGIN_ACTIVE);
+	check(se->num_events == 3);
+	check(!strcmp(se->events[0].plugin_id, "chain3"));
+	check(!strcmp(se->events[2].plugin_id, "chain1"));
+	
+	check(cp_stop_plugin(ctx, "chain3") == CP_OK);
+	check(pe->num_events == 3);
+	check(pe->events[2].old_state == CP_PLUGIN_ACTIVE && pe->events[2].new_state == CP_PLUGIN_RESOLVED);
+	check(se->num_events == 3);
+	check(re->num_events == 0);
+	
+	cp_destroy();
+	free(pe);
+}
+
+static cp_plugin_info_t *load_dependency(cp_context_t *ctx, const char *id) {
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	char path[512];
+	
+	snprintf(path, sizeof(path), "%s" CP_FNAMESEP_STR "%s", pcollectiondir("dependencies"), id);
+	check((plugin = cp_load_plugin_descriptor(ctx, path, &status)) != NULL && status == CP_OK);
+	return plugin;
+}
+
+static void install_dependency(cp_context_t *ctx, const char *id) {
+	cp_plugin_info_t *plugin;
+	
+	plugin = load_dependency(ctx, id);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+}
+
+void plugindeplateinstall(void) {
+	cp_context_t *ctx;
+	const char * const act_chain123[] = { "chain1", "chain2", "chain3", NULL };
+	const char * const act_chain3[] = { "chain3", NULL };
+	events_t *ue;
+	
+	check((ue = calloc(1, sizeof(events_t))) != NULL);
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	
+	// Install the importing plug-in before the plug-ins it imports
+	install_dependency(ctx, "chain1");
+	check(cp_start_plugin(ctx, "chain1") == CP_ERR_DEPENDENCY);
+	install_dependency(ctx, "chain3");
+	install_dependency(ctx, "chain2");
+	check(cp_start_plugin(ctx, "chain1") == CP_OK);
+	check(active(ctx, act_chain123));
+	
+	// Uninstall and reinstall a plug-in in the middle of the chain
+	check(cp_uninstall_plugin(ctx, "chain2") == CP_OK);
+	check(cp_get_plugin_state(ctx, "chain1") == CP_PLUGIN_INSTALLED);
+	check(active(ctx, act_chain3));
+	check(cp_start_plugin(ctx, "chain1") == CP_ERR_DEPENDENCY);
+	install_dependency(ctx, "chain2");
+	check(cp_start_plugin(ctx, "chain1") == CP_OK);
+	check(active(ctx, act_chain123));
+	
+	// Importing plug-ins are uninstalled before the plug-ins they import
+	check(cp_register_plistener_filtered(ctx, sync_listener, ue, NULL, CP_STATE_MASK(CP_PLUGIN_UNINSTALLED)) == CP_OK);
+	cp_uninstall_plugins(ctx);
+	check(ue->num_events == 3);
+	check(!strcmp(ue->events[0].plugin_id, "chain1"));
+	check(!strcmp(ue->events[1].plugin_id, "chain2"));
+	check(!strcmp(ue->events[2].plugin_id, "chain3"));
+	
+	cp_destroy();
+	free(ue);
+}
@@ -22,6 +22,7 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <string.h>
 #include "test.h"
 
 void install(void) {
@@ -83,6 +84,39 @@ void installconflict(void) {
 	cp_destroy();
 }
 
+void installbatch(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugins[3];
+	cp_status_t status;
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((plugins[0] = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check((plugins[1] = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check((plugins[2] = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	
+	// An atomic batch with a conflict installs nothing
+	check(cp_install_plugins(ctx, plugins, 3, CP_IP_ATOMIC) == CP_ERR_CONFLICT);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_UNINSTALLED);
+	check(cp_get_plugin_state(ctx, "maximal") == CP_PLUGIN_UNINSTALLED);
+	
+	// Otherwise the plug-ins that do not conflict are installed
+	check(cp_install_plugins(ctx, plugins, 3, 0) == CP_ERR_CONFLICT);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "maximal") == CP_PLUGIN_INSTALLED);
+	check(cp_uninstall_plugin(ctx, "minimal") == CP_OK);
+	check(cp_uninstall_plugin(ctx, "maximal") == CP_OK);
+	
+	// A batch without conflicts is installed as a whole
+	check(cp_install_plugins(ctx, plugins, 2, CP_IP_ATOMIC) == CP_OK);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "maximal") == CP_PLUGIN_INSTALLED);
+	for (i = 0; i < 3; i++) {
+		cp_release_info(ctx, plugins[i]);
+	}
+	cp_destroy();
+}
+
 void uninstall(void) {
 	cp_context_t *ctx;
 	cp_plugin_info_t *plugin;
@@ -99,3 +133,124 @@ void uninstall(void) {
 	cp_destroy();
 	check(errors == 0);	
 }
+
+void installmany(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t **plugins;
+	cp_ext_point_t **ext_points;
+	cp_status_t status;
+	char buffer[256], id[32];
+	int errors, i, n;
+	
+	// Install enough plug-ins to grow the registries several times
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	for (i = 0; i < 500; i++) {
+		cp_plugin_info_t *plugin;
+		
+		sprintf(buffer, "<plugin id=\"many%d\"><extension-point id=\"ep\"/><extension point=\"many%d.ep\"/></plugin>", i, (i + 1) % 500);
+		check((plugin = cp_load_plugin_descriptor_from_memory(ctx, buffer, strlen(buffer), &status)) != NULL && status == CP_OK);
+		check(cp_install_plugin(ctx, plugin) == CP_OK);
+		cp_release_info(ctx, plugin);
+	}
+	
+	// Uninstall every other plug-in and check the rest are still found
+	for (i = 0; i < 500; i += 2) {
+		sprintf(id, "many%d", i);
+		check(cp_uninstall_plugin(ctx, id) == CP_OK);
+	}
+	for (i = 0; i < 500; i++) {
+		sprintf(id, "many%d", i);
+		check(cp_get_plugin_state(ctx, id) == (i % 2 ? CP_PLUGIN_INSTALLED : CP_PLUGIN_UNINSTALLED));
+	}
+	check((plugins = cp_get_plugins_info(ctx, &status, &n)) != NULL && status == CP_OK && n == 250);
+	cp_release_info(ctx, plugins);
+	check((ext_points = cp_get_ext_points_info(ctx, &status, &n)) != NULL && status == CP_OK && n == 250);
+	cp_release_info(ctx, ext_points);
+	cp_uninstall_plugins(ctx);
+	check((plugins = cp_get_plugins_info(ctx, &status, &n)) != NULL && status == CP_OK && n == 0);
+	cp_release_info(ctx, plugins);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void pluginhandle(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugins[2];
+	cp_plugin_handle_t *handle, *handle2;
+	cp_status_t status;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((plugins[0] = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check((plugins[1] = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	
+	// A handle can be obtained before the plug-in is installed
+	check((handle = cp_get_plugin_handle(ctx, "minimal", &status)) != NULL && status == CP_OK);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_UNINSTALLED);
+	
+	// A rolled back batch is never visible through the handle
+	check(cp_install_plugins(ctx, plugins, 2, CP_IP_ATOMIC) == CP_ERR_CONFLICT);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_UNINSTALLED);
+	
+	// The handle follows the state changes
+	check(cp_install_plugin(ctx, plugins[0]) == CP_OK);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_INSTALLED);
+	check(cp_start_plugin(ctx, "minimal") == CP_OK);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_ACTIVE);
+	check((handle2 = cp_get_plugin_handle(ctx, "minimal", &status)) == handle && status == CP_OK);
+	check(cp_stop_plugin(ctx, "minimal") == CP_OK);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_RESOLVED);
+	cp_release_info(ctx, handle2);
+	
+	// The handle survives uninstallation and follows a reinstallation
+	check(cp_uninstall_plugin(ctx, "minimal") == CP_OK);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_UNINSTALLED);
+	check(cp_install_plugin(ctx, plugins[1]) == CP_OK);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_INSTALLED);
+	cp_release_info(ctx, handle);
+	
+	// A handle obtained for an installed plug-in reports its state
+	check((handle = cp_get_plugin_handle(ctx, "minimal", &status)) != NULL && status == CP_OK);
+	check(cp_get_plugin_handle_state(ctx, handle) == CP_PLUGIN_INSTALLED);
+	cp_release_info(ctx, handle);
+	
+	cp_release_info(ctx, plugins[0]);
+	cp_release_info(ctx, plugins[1]);
+	cp_destroy();
+}
+
+void inforefcount(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin, *plugin1, *plugin2, **plugins;
+	cp_status_t status;
+	int errors, i, n;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	
+	// Each query returns a new reference to the same object
+	check((plugin1 = cp_get_plugin_info(ctx, "minimal", &status)) == plugin && status == CP_OK);
+	check((plugin2 = cp_get_plugin_info(ctx, "minimal", &status)) == plugin && status == CP_OK);
+	cp_release_info(ctx, plugin);
+	cp_release_info(ctx, plugin1);
+	check(!strcmp(plugin2->identifier, "minimal"));
+	
+	// Array references are counted separately from their elements
+	for (i = 0; i < 16; i++) {
+		check((plugins = cp_get_plugins_info(ctx, &status, &n)) != NULL && status == CP_OK && n == 1);
+		check(plugins[0] == plugin2);
+		cp_release_info(ctx, plugins);
+	}
+	check(!strcmp(plugin2->identifier, "minimal"));
+	
+	// The installed plug-in keeps its information over the last release
+	cp_release_info(ctx, plugin2);
+	check((plugin = cp_get_plugin_info(ctx, "minimal", &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin->identifier, "minimal"));
+	check(cp_uninstall_plugin(ctx, "minimal") == CP_OK);
+	check(!strcmp(plugin->identifier, "minimal"));
+	cp_release_info(ctx, plugin);
+	
+	cp_destroy();
+	check(errors == 0);
+}
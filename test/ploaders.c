@@ -22,6 +22,10 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "test.h"
 
 void oneploader(void) {
@@ -163,3 +167,336 @@ void unregploader(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+void ploaderparallel(void) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t *loader;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	int errors;
+
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	loader = cp_create_local_ploader(&status);
+	check(loader != NULL);
+	check(status == CP_OK);
+	cp_lpl_set_parser_threads(loader, 4);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection1v2")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection1v3")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection1")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection2")) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "plugin1") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2a") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2b") == CP_PLUGIN_INSTALLED);
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", &status)) != NULL && status == CP_OK);
+	check(plugin->version != NULL && !strcmp(plugin->version, "3"));
+	cp_release_info(ctx, plugin);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void ploaderconcurrent(void) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t *loader1, *loader2, *loader3;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	int errors;
+
+	// Thread-safe loaders are scanned concurrently with the others
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((loader1 = cp_create_local_ploader(&status)) != NULL && status == CP_OK);
+	check((loader2 = cp_create_local_ploader(&status)) != NULL && status == CP_OK);
+	check((loader3 = cp_create_local_ploader(&status)) != NULL && status == CP_OK);
+	check(cp_lpl_register_dir(loader1, pcollectiondir("collection1v3")) == CP_OK);
+	check(cp_lpl_register_dir(loader2, pcollectiondir("collection1")) == CP_OK);
+	check(cp_lpl_register_dir(loader3, pcollectiondir("collection2")) == CP_OK);
+	check(cp_register_ploader(ctx, loader1) == CP_OK);
+	check(cp_register_ploader(ctx, loader2) == CP_OK);
+	check(cp_register_ploader_flags(ctx, loader3, 0) == CP_OK);
+	check(cp_register_pcollection(ctx, pcollectiondir("collection1v2")) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "plugin2a") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2b") == CP_PLUGIN_INSTALLED);
+	
+	// The latest version is installed regardless of the scanning order
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", &status)) != NULL && status == CP_OK);
+	check(plugin->version != NULL && !strcmp(plugin->version, "3"));
+	cp_release_info(ctx, plugin);
+	
+	// Unregistering a loader uninstalls its plug-ins
+	cp_unregister_ploader(ctx, loader1);
+	check(cp_get_plugin_state(ctx, "plugin1") == CP_PLUGIN_UNINSTALLED);
+	check(cp_scan_plugins(ctx, CP_SP_UPGRADE) == CP_OK);
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", &status)) != NULL && status == CP_OK);
+	check(plugin->version != NULL && !strcmp(plugin->version, "2"));
+	cp_release_info(ctx, plugin);
+	cp_destroy();
+	check(errors == 0);
+}
+
+typedef struct counting_ploader_t {
+	cp_plugin_loader_t *local;
+	int num_scans;
+	int num_changes;
+} counting_ploader_t;
+
+static cp_plugin_info_t **counting_scan_plugins(void *data, cp_context_t *ctx) {
+	counting_ploader_t *cpl = data;
+	
+	cpl->num_scans++;
+	return cpl->local->scan_plugins(cpl->local->data, ctx);
+}
+
+static cp_plugin_info_t **counting_scan_changes(void *data, cp_context_t *ctx) {
+	counting_ploader_t *cpl = data;
+	
+	cpl->num_changes++;
+	return cpl->local->scan_plugins(cpl->local->data, ctx);
+}
+
+static void counting_release_plugins(void *data, cp_context_t *ctx, cp_plugin_info_t **plugins) {
+	counting_ploader_t *cpl = data;
+	
+	cpl->local->release_plugins(cpl->local->data, ctx, plugins);
+}
+
+void ploaderscanchanges(void) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t loader;
+	counting_ploader_t cpl;
+	cp_status_t status;
+	int errors;
+
+	// A loader allocated by the client is scanned fully until it gets an incremental scanning function
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	memset(&cpl, 0, sizeof(cpl));
+	check((cpl.local = cp_create_local_ploader(&status)) != NULL && status == CP_OK);
+	check(cp_lpl_register_dir(cpl.local, pcollectiondir("collection1")) == CP_OK);
+	memset(&loader, 0, sizeof(loader));
+	loader.data = &cpl;
+	loader.scan_plugins = counting_scan_plugins;
+	loader.release_plugins = counting_release_plugins;
+	check(cp_set_ploader_scan_changes(ctx, &loader, counting_scan_changes) == CP_ERR_UNKNOWN);
+	check(cp_register_ploader(ctx, &loader) == CP_OK);
+	check(cp_scan_plugins(ctx, CP_SP_INCREMENTAL) == CP_OK);
+	check(cpl.num_scans == 1 && cpl.num_changes == 0);
+	check(cp_get_plugin_state(ctx, "plugin1") == CP_PLUGIN_INSTALLED);
+	
+	// Only incremental scans use the incremental scanning function
+	check(cp_set_ploader_scan_changes(ctx, &loader, counting_scan_changes) == CP_OK);
+	check(cp_scan_plugins(ctx, CP_SP_INCREMENTAL) == CP_OK);
+	check(cpl.num_scans == 1 && cpl.num_changes == 1);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cpl.num_scans == 2 && cpl.num_changes == 1);
+	
+	// The function can be cleared again
+	check(cp_set_ploader_scan_changes(ctx, &loader, NULL) == CP_OK);
+	check(cp_scan_plugins(ctx, CP_SP_INCREMENTAL) == CP_OK);
+	check(cpl.num_scans == 3 && cpl.num_changes == 1);
+	cp_unregister_ploader(ctx, &loader);
+	check(cp_get_plugin_state(ctx, "plugin1") == CP_PLUGIN_UNINSTALLED);
+	cp_destroy_local_ploader(cpl.local);
+	cp_destroy();
+	check(errors == 1);
+}
+
+void snapshotploader(void) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t *loader;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	const char *snapshot = "tmp" CP_FNAMESEP_STR "registry.snapshot";
+	char *path;
+	int errors;
+
+	// Scan plug-ins from local collections and save a snapshot
+	mkdir("tmp", 0777);
+	remove(snapshot);
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, pcollectiondir("collection1")) == CP_OK);
+	check(cp_register_pcollection(ctx, pcollectiondir("collection2")) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", &status)) != NULL && status == CP_OK);
+	check((path = strdup(plugin->plugin_path)) != NULL);
+	cp_release_info(ctx, plugin);
+	check(cp_save_snapshot(ctx, snapshot) == CP_OK);
+	cp_destroy_context(ctx);
+	
+	// Install the plug-ins from the snapshot
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	loader = cp_create_snapshot_ploader(snapshot, &status);
+	check(loader != NULL);
+	check(status == CP_OK);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "plugin1") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2a") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2b") == CP_PLUGIN_INSTALLED);
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin->plugin_path, path));
+	cp_release_info(ctx, plugin);
+	check(cp_start_plugin(ctx, "plugin2b") == CP_OK);
+	check(cp_get_plugin_state(ctx, "plugin2b") == CP_PLUGIN_ACTIVE);
+	cp_unregister_ploader(ctx, loader);
+	check(cp_get_plugin_state(ctx, "plugin1") == CP_PLUGIN_UNINSTALLED);
+	cp_destroy_snapshot_ploader(loader);
+	free(path);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void archiveploader(void) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t *loader;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	const char *archive = "tmp" CP_FNAMESEP_STR "plugins.archive";
+	const char *str;
+	char lib_path[256];
+	struct stat st;
+	int errors;
+
+	// Pack plug-ins with runtime libraries into an archive
+	mkdir("tmp", 0777);
+	remove(archive);
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_save_archive(ctx, archive) == CP_OK);
+	cp_destroy_context(ctx);
+	
+	// Install the plug-ins from the archive
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	loader = cp_create_archive_ploader(archive, "tmp" CP_FNAMESEP_STR "archive", &status);
+	check(loader != NULL);
+	check(status == CP_OK);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "symprovider") == CP_PLUGIN_INSTALLED);
+	check((plugin = cp_get_plugin_info(ctx, "symuser", &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin->plugin_path, "tmp" CP_FNAMESEP_STR "archive" CP_FNAMESEP_STR "symuser"));
+	snprintf(lib_path, sizeof(lib_path), "%s" CP_FNAMESEP_STR "%s" CP_SHREXT, plugin->plugin_path, plugin->runtime_lib_name);
+	cp_release_info(ctx, plugin);
+	
+	// Runtime libraries are extracted when the plug-ins are resolved
+	remove(lib_path);
+	check(stat(lib_path, &st) != 0);
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Provided string") == 0);
+	cp_release_symbol(ctx, str);
+	check(stat(lib_path, &st) == 0);
+	
+	cp_unregister_ploader(ctx, loader);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_UNINSTALLED);
+	cp_destroy_archive_ploader(loader);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void remoteploader(void) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t *loader;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	const char *repository = "tmp" CP_FNAMESEP_STR "repository";
+	const char *cache = "tmp" CP_FNAMESEP_STR "remotecache";
+	const char *str;
+	char lib_path[256], hash[65];
+	struct stat st;
+	FILE *fh;
+	int errors;
+
+	// Export plug-ins with runtime libraries into a repository
+	mkdir("tmp", 0777);
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_save_repository(ctx, repository) == CP_OK);
+	cp_destroy_context(ctx);
+	
+	// Install the plug-ins from the repository using concurrent downloads
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	loader = cp_create_remote_ploader(repository, cache, &status);
+	check(loader != NULL);
+	check(status == CP_OK);
+	cp_rpl_set_download_threads(loader, 4);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "symprovider") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "callbackcounter") == CP_PLUGIN_INSTALLED);
+	check((plugin = cp_get_plugin_info(ctx, "symuser", &status)) != NULL && status == CP_OK);
+	check(!strncmp(plugin->plugin_path, cache, strlen(cache)));
+	snprintf(lib_path, sizeof(lib_path), "%s" CP_FNAMESEP_STR "%s" CP_SHREXT, plugin->plugin_path, plugin->runtime_lib_name);
+	cp_release_info(ctx, plugin);
+	
+	// Runtime libraries are fetched into the cache when resolved
+	remove(lib_path);
+	check(stat(lib_path, &st) != 0);
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Provided string") == 0);
+	cp_release_symbol(ctx, str);
+	check(stat(lib_path, &st) == 0);
+	cp_unregister_ploader(ctx, loader);
+	cp_destroy_remote_ploader(loader);
+	cp_destroy_context(ctx);
+	
+	// The cache is used when the repository can not be reached
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	loader = cp_create_remote_ploader("tmp" CP_FNAMESEP_STR "unreachable", cache, &status);
+	check(loader != NULL);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Provided string") == 0);
+	cp_release_symbol(ctx, str);
+	cp_unregister_ploader(ctx, loader);
+	cp_destroy_remote_ploader(loader);
+	cp_destroy();
+	check(errors == 0);
+	
+	// Runtime libraries are not loaded over plain HTTP without a pinned index hash
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	loader = cp_create_remote_ploader("http://127.0.0.1:1", cache, &status);
+	check(loader != NULL);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_INSTALLED);
+	check(cp_resolve_symbol(ctx, "symuser", "used_string", &status) == NULL && status != CP_OK);
+	check(cp_get_plugin_state(ctx, "symprovider") == CP_PLUGIN_INSTALLED);
+	check(errors > 0);
+	cp_unregister_ploader(ctx, loader);
+	cp_destroy_remote_ploader(loader);
+	cp_destroy_context(ctx);
+	
+	// An index not matching the pinned hash is rejected
+	snprintf(lib_path, sizeof(lib_path), "%s" CP_FNAMESEP_STR "index.sha256", repository);
+	check((fh = fopen(lib_path, "r")) != NULL);
+	check(fscanf(fh, "%64s", hash) == 1 && strlen(hash) == 64);
+	fclose(fh);
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	loader = cp_create_remote_ploader("http://127.0.0.1:1", cache, &status);
+	check(loader != NULL);
+	check(cp_rpl_set_index_hash(loader, "0123") == CP_ERR_MALFORMED);
+	check(cp_rpl_set_index_hash(loader, "0000000000000000000000000000000000000000000000000000000000000000") == CP_OK);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_UNINSTALLED);
+	check(errors > 0);
+	cp_unregister_ploader(ctx, loader);
+	errors = 0;
+	
+	// The pinned repository is trusted
+	check(cp_rpl_set_index_hash(loader, hash) == CP_OK);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Provided string") == 0);
+	cp_release_symbol(ctx, str);
+	cp_unregister_ploader(ctx, loader);
+	cp_destroy_remote_ploader(loader);
+	cp_destroy();
+	check(errors == 0);
+}
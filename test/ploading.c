@@ -24,6 +24,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "test.h"
 
 #define MEMBUFFERSIZE 16384
@@ -90,3 +92,442 @@ void loadonlymaximalfrommemory(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+static void check_same_str(const char *s1, const char *s2) {
+	check(s1 == NULL ? s2 == NULL : (s2 != NULL && !strcmp(s1, s2)));
+}
+
+static void check_same_cfg(const cp_cfg_element_t *ce1, const cp_cfg_element_t *ce2) {
+	unsigned int i;
+	
+	check_same_str(ce1->name, ce2->name);
+	check(ce1->num_atts == ce2->num_atts);
+	for (i = 0; i < ce1->num_atts * 2; i++) {
+		check_same_str(ce1->atts[i], ce2->atts[i]);
+	}
+	check_same_str(ce1->value, ce2->value);
+	check(ce1->index == ce2->index);
+	check(ce1->num_children == ce2->num_children);
+	for (i = 0; i < ce1->num_children; i++) {
+		check(ce2->children[i].parent == ce2);
+		check_same_cfg(ce1->children + i, ce2->children + i);
+	}
+}
+
+static void check_same_plugin(const cp_plugin_info_t *p1, const cp_plugin_info_t *p2) {
+	unsigned int i;
+	
+	check_same_str(p1->identifier, p2->identifier);
+	check_same_str(p1->name, p2->name);
+	check_same_str(p1->version, p2->version);
+	check_same_str(p1->provider_name, p2->provider_name);
+	check_same_str(p1->plugin_path, p2->plugin_path);
+	check_same_str(p1->abi_bw_compatibility, p2->abi_bw_compatibility);
+	check_same_str(p1->api_bw_compatibility, p2->api_bw_compatibility);
+	check_same_str(p1->req_cpluff_version, p2->req_cpluff_version);
+	check(p1->num_imports == p2->num_imports);
+	for (i = 0; i < p1->num_imports; i++) {
+		check_same_str(p1->imports[i].plugin_id, p2->imports[i].plugin_id);
+		check_same_str(p1->imports[i].version, p2->imports[i].version);
+		check(p1->imports[i].optional == p2->imports[i].optional);
+	}
+	check_same_str(p1->runtime_lib_name, p2->runtime_lib_name);
+	check_same_str(p1->runtime_funcs_symbol, p2->runtime_funcs_symbol);
+	check_same_str(p1->runtime_symbols_symbol, p2->runtime_symbols_symbol);
+	check(p1->lazy_activation == p2->lazy_activation);
+	check(p1->num_ext_points == p2->num_ext_points);
+	for (i = 0; i < p1->num_ext_points; i++) {
+		check(p2->ext_points[i].plugin == p2);
+		check_same_str(p1->ext_points[i].local_id, p2->ext_points[i].local_id);
+		check_same_str(p1->ext_points[i].identifier, p2->ext_points[i].identifier);
+		check_same_str(p1->ext_points[i].name, p2->ext_points[i].name);
+		check_same_str(p1->ext_points[i].schema_path, p2->ext_points[i].schema_path);
+	}
+	check(p1->num_extensions == p2->num_extensions);
+	for (i = 0; i < p1->num_extensions; i++) {
+		check(p2->extensions[i].plugin == p2);
+		check_same_str(p1->extensions[i].ext_point_id, p2->extensions[i].ext_point_id);
+		check_same_str(p1->extensions[i].local_id, p2->extensions[i].local_id);
+		check_same_str(p1->extensions[i].identifier, p2->extensions[i].identifier);
+		check_same_str(p1->extensions[i].name, p2->extensions[i].name);
+		check((p1->extensions[i].configuration == NULL) == (p2->extensions[i].configuration == NULL));
+		if (p1->extensions[i].configuration != NULL) {
+			check(p2->extensions[i].configuration->parent == NULL);
+			check_same_cfg(p1->extensions[i].configuration, p2->extensions[i].configuration);
+		}
+	}
+}
+
+static void write_descriptor(const char *dir, const char *version) {
+	char file[256];
+	FILE *f;
+	
+	snprintf(file, sizeof(file), "%s" CP_FNAMESEP_STR PLUGINFILENAME, dir);
+	check((f = fopen(file, "w")) != NULL);
+	fprintf(f, "<plugin id=\"cached\" version=\"%s\"/>\n", version);
+	check(!fclose(f));
+}
+
+static void write_file(const char *dir, const char *data, size_t size) {
+	char file[256];
+	FILE *f;
+	
+	snprintf(file, sizeof(file), "%s" CP_FNAMESEP_STR PLUGINFILENAME, dir);
+	check((f = fopen(file, "wb")) != NULL);
+	check(fwrite(data, 1, size, f) == size);
+	check(!fclose(f));
+}
+
+void loadmappeddescriptor(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin, *parsed;
+	cp_status_t status;
+	const char *pdir = "tmp" CP_FNAMESEP_STR "mapped";
+	char *pdfilename, *membuffer;
+	size_t size = 0, i;
+	int errors;
+	FILE *f;
+	
+	// Read the maximal descriptor into memory
+	check((pdfilename = malloc(strlen(plugindir("maximal")) + strlen(CP_FNAMESEP_STR PLUGINFILENAME) + 1)) != NULL);
+	strcpy(pdfilename, plugindir("maximal"));
+	strcat(pdfilename, CP_FNAMESEP_STR PLUGINFILENAME);
+	check((membuffer = malloc(MEMBUFFERSIZE)) != NULL);
+	check((f = fopen(pdfilename, "rb")) != NULL);
+	do {
+		i = fread(membuffer + size, 1, MEMBUFFERSIZE - size, f);
+		check(!ferror(f));
+		size += i;
+	} while (i > 0);
+	fclose(f);
+	free(pdfilename);
+	check(size > 0 && size < MEMBUFFERSIZE);
+	mkdir("tmp", 0777);
+	mkdir(pdir, 0777);
+	
+	// A complete descriptor file parses like the same data in memory
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	check((parsed = cp_load_plugin_descriptor_from_memory(ctx, membuffer, size, &status)) != NULL && status == CP_OK);
+	write_file(pdir, membuffer, size);
+	check((plugin = cp_load_plugin_descriptor(ctx, pdir, &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin->identifier, parsed->identifier));
+	check(!strcmp(plugin->version, parsed->version));
+	check(plugin->num_imports == parsed->num_imports);
+	check(plugin->num_ext_points == parsed->num_ext_points);
+	check(plugin->num_extensions == parsed->num_extensions);
+	cp_release_info(ctx, plugin);
+	cp_release_info(ctx, parsed);
+	
+	// A file ending at a typical page boundary is not read past its end
+	check(size <= 4096);
+	memset(membuffer + size, ' ', 4096 - size);
+	write_file(pdir, membuffer, 4096);
+	check((plugin = cp_load_plugin_descriptor(ctx, pdir, &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin->identifier, "maximal"));
+	cp_release_info(ctx, plugin);
+	check(errors == 0);
+	
+	// Empty and truncated files are rejected as malformed
+	write_file(pdir, membuffer, 0);
+	check(cp_load_plugin_descriptor(ctx, pdir, &status) == NULL && status == CP_ERR_MALFORMED);
+	check(errors > 0);
+	errors = 0;
+	write_file(pdir, membuffer, size / 2);
+	check(cp_load_plugin_descriptor(ctx, pdir, &status) == NULL && status == CP_ERR_MALFORMED);
+	check(errors > 0);
+	
+	cp_destroy();
+	free(membuffer);
+}
+
+void loaddescriptorcache(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin, *parsed;
+	cp_status_t status;
+	const char *cache = "tmp" CP_FNAMESEP_STR "descriptors.cache";
+	const char *pdir = "tmp" CP_FNAMESEP_STR "cached";
+	int errors;
+	FILE *f;
+	
+	mkdir("tmp", 0777);
+	mkdir(pdir, 0777);
+	remove(cache);
+	write_descriptor(pdir, "1");
+	
+	// Populate the cache and check it is persisted when context is destroyed
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_set_descriptor_cache(ctx, cache) == CP_OK);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((plugin = cp_load_plugin_descriptor(ctx, pdir, &status)) != NULL && status == CP_OK);
+	cp_release_info(ctx, plugin);
+	cp_destroy_context(ctx);
+	check((f = fopen(cache, "rb")) != NULL);
+	fclose(f);
+	
+	// Check that cached information equals to parsed information
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((parsed = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(cp_set_descriptor_cache(ctx, cache) == CP_OK);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(plugin != parsed);
+	check_same_plugin(parsed, plugin);
+	cp_release_info(ctx, plugin);
+	cp_release_info(ctx, parsed);
+	
+	// Check that a modified descriptor is parsed again
+	write_descriptor(pdir, "1.1");
+	check((plugin = cp_load_plugin_descriptor(ctx, pdir, &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin->version, "1.1"));
+	cp_release_info(ctx, plugin);
+	check(cp_set_descriptor_cache(ctx, NULL) == CP_OK);
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+void loadcfgparents(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_cfg_element_t *ce;
+	cp_status_t status;
+	char buffer[MEMBUFFERSIZE];
+	size_t len;
+	int errors;
+	int i;
+	
+	// Construct a descriptor with enough elements to grow the children tables
+	len = sprintf(buffer,
+		"<plugin id=\"cfgparents\">\n"
+		"<extension point=\"cfgparents.x\">\n");
+	for (i = 0; i < 20; i++) {
+		len += sprintf(buffer + len, "<item>value %d<sub>%d</sub> continued</item>\n", i, i);
+	}
+	len += sprintf(buffer + len, "</extension>\n</plugin>\n");
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor_from_memory(ctx, buffer, len, &status)) != NULL && status == CP_OK);
+	check(plugin->num_extensions == 1);
+	check((ce = plugin->extensions[0].configuration) != NULL);
+	check(ce->num_children == 20);
+	for (i = 0; i < 20; i++) {
+		cp_cfg_element_t *item = ce->children + i;
+		char value[32];
+		
+		check(item->parent == ce);
+		check(item->index == (unsigned int) i);
+		sprintf(value, "value %d continued", i);
+		check(item->value != NULL && !strcmp(item->value, value));
+		check(item->num_children == 1);
+		check(item->children[0].parent == item);
+		sprintf(value, "%d", i);
+		check(item->children[0].value != NULL && !strcmp(item->children[0].value, value));
+		check(cp_lookup_cfg_element(item->children, "../..") == ce);
+	}
+	cp_release_info(ctx, plugin);
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+void loadinternedstrings(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *p1, *p2;
+	cp_status_t status;
+	const char *d1 =
+		"<plugin id=\"interned1\">\n"
+		"<requires><import plugin=\"interned0\"/></requires>\n"
+		"<extension point=\"interned0.ep\"><param/></extension>\n"
+		"</plugin>\n";
+	const char *d2 =
+		"<plugin id=\"interned2\">\n"
+		"<requires><import plugin=\"interned0\"/></requires>\n"
+		"<extension point=\"interned0.ep\"><param/></extension>\n"
+		"</plugin>\n";
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((p1 = cp_load_plugin_descriptor_from_memory(ctx, d1, strlen(d1), &status)) != NULL && status == CP_OK);
+	check((p2 = cp_load_plugin_descriptor_from_memory(ctx, d2, strlen(d2), &status)) != NULL && status == CP_OK);
+	
+	// Check that equal strings share the same copy
+	check(p1->num_imports == 1 && p2->num_imports == 1);
+	check(p1->imports[0].plugin_id == p2->imports[0].plugin_id);
+	check(p1->num_extensions == 1 && p2->num_extensions == 1);
+	check(p1->extensions[0].ext_point_id == p2->extensions[0].ext_point_id);
+	check(!strcmp(p1->extensions[0].ext_point_id, "interned0.ep"));
+	check(p1->extensions[0].configuration->name == p2->extensions[0].configuration->name);
+	check(p1->extensions[0].configuration->num_children == 1);
+	check(p1->extensions[0].configuration->children[0].name == p2->extensions[0].configuration->children[0].name);
+	check(!strcmp(p1->extensions[0].configuration->children[0].name, "param"));
+	
+	cp_release_info(ctx, p1);
+	cp_release_info(ctx, p2);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void loadlazycfg(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin, *parsed;
+	cp_status_t status;
+	unsigned int i;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((parsed = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	cp_set_lazy_cfg(ctx, 1);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	
+	// Check that configuration is parsed on first access only
+	check(plugin->num_extensions == parsed->num_extensions);
+	for (i = 0; i < plugin->num_extensions; i++) {
+		cp_cfg_element_t *ce;
+		
+		check(plugin->extensions[i].configuration == NULL);
+		ce = cp_get_extension_cfg(ctx, plugin->extensions + i, &status);
+		check(status == CP_OK && ce != NULL);
+		check(ce == plugin->extensions[i].configuration);
+		check(cp_get_extension_cfg(ctx, plugin->extensions + i, NULL) == ce);
+	}
+	check_same_plugin(parsed, plugin);
+	
+	cp_release_info(ctx, plugin);
+	cp_release_info(ctx, parsed);
+	cp_destroy();
+	check(errors == 0);
+}
+
+/// Streamed configuration events collected by the test consumer
+typedef struct stream_events_t {
+	
+	/// The element names separated by spaces, ends marked with a slash
+	char elements[256];
+	
+	/// The concatenated character data
+	char text[256];
+	
+	/// The deepest element seen
+	int max_depth;
+	
+	/// The element whose end is rejected, or NULL
+	const char *reject;
+	
+} stream_events_t;
+
+static void append_str(char *buffer, size_t size, const char *str, size_t len) {
+	size_t l = strlen(buffer);
+	
+	if (l + len < size) {
+		memcpy(buffer + l, str, len);
+		buffer[l + len] = '\0';
+	}
+}
+
+static int stream_start(void *user_data, const cp_extension_t *ext, const char *name, const char * const *atts, int depth) {
+	stream_events_t *events = user_data;
+	
+	check(!strcmp(ext->ext_point_id, "nonexisting.extptA"));
+	check(depth > 0 || (!strcmp(name, "extension") && atts[0] != NULL));
+	append_str(events->elements, sizeof(events->elements), name, strlen(name));
+	append_str(events->elements, sizeof(events->elements), " ", 1);
+	if (depth > events->max_depth) {
+		events->max_depth = depth;
+	}
+	return 0;
+}
+
+static int stream_text(void *user_data, const cp_extension_t *ext, const char *text, int len) {
+	stream_events_t *events = user_data;
+	
+	append_str(events->text, sizeof(events->text), text, len);
+	return 0;
+}
+
+static int stream_end(void *user_data, const cp_extension_t *ext, const char *name, int depth) {
+	stream_events_t *events = user_data;
+	
+	append_str(events->elements, sizeof(events->elements), "/ ", 2);
+	return events->reject != NULL && !strcmp(name, events->reject);
+}
+
+void loadcfgstream(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	cp_cfg_stream_t stream = { stream_start, stream_text, stream_end };
+	stream_events_t events;
+	int errors;
+	
+	// The configuration of the extension is streamed instead of stored
+	memset(&events, 0, sizeof(events));
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	check(cp_register_cfg_stream(ctx, "nonexisting.extptA", &stream, &events) == CP_OK);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(!strcmp(events.elements, "extension structure parameter / parameter / assertion / deeper struct is / / / / / "));
+	check(events.max_depth == 4);
+	check(strstr(events.text, "Extension data begins") != NULL);
+	check(strstr(events.text, "1<2") != NULL && strstr(events.text, "here") != NULL);
+	check(strstr(events.text, "commented out") == NULL);
+	check(!strcmp(plugin->extensions[0].configuration->name, "extension"));
+	check(plugin->extensions[0].configuration->num_children == 0);
+	check(plugin->extensions[0].configuration->value == NULL);
+	check(plugin->extensions[0].configuration->num_atts == 3);
+	check(plugin->extensions[2].configuration != NULL);
+	cp_release_info(ctx, plugin);
+	check(errors == 0);
+	
+	// A rejected configuration makes the descriptor invalid
+	memset(&events, 0, sizeof(events));
+	events.reject = "deeper";
+	check(cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status) == NULL && status == CP_ERR_MALFORMED);
+	check(errors > 0);
+	
+	// The configuration tree is built again after unregistering
+	cp_unregister_cfg_stream(ctx, "nonexisting.extptA");
+	memset(&events, 0, sizeof(events));
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(events.elements[0] == '\0');
+	check(plugin->extensions[0].configuration->num_children == 1);
+	cp_release_info(ctx, plugin);
+	
+	cp_destroy();
+}
+
+void loadshareddescriptors(void) {
+	cp_context_t *ctx1, *ctx2, *ctx3;
+	cp_plugin_info_t *plugin1, *plugin2, *plugin3;
+	cp_status_t status;
+	int errors;
+	
+	// Contexts sharing descriptors get the same information
+	ctx1 = init_context(CP_LOG_ERROR, &errors);
+	check((ctx2 = cp_create_context(&status)) != NULL && status == CP_OK);
+	cp_set_shared_descriptors(ctx1, 1);
+	cp_set_shared_descriptors(ctx2, 1);
+	check((plugin1 = cp_load_plugin_descriptor(ctx1, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check((plugin2 = cp_load_plugin_descriptor(ctx2, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(plugin1 == plugin2);
+	
+	// Other contexts parse their own copy
+	check((ctx3 = cp_create_context(&status)) != NULL && status == CP_OK);
+	check((plugin3 = cp_load_plugin_descriptor(ctx3, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(plugin3 != plugin1);
+	check_same_plugin(plugin1, plugin3);
+	cp_release_info(ctx3, plugin3);
+	
+	// Shared information outlives the context that loaded it
+	check(cp_install_plugin(ctx1, plugin1) == CP_OK);
+	check(cp_install_plugin(ctx2, plugin2) == CP_OK);
+	cp_release_info(ctx1, plugin1);
+	cp_destroy_context(ctx1);
+	check(cp_get_plugin_state(ctx2, "maximal") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_info(ctx2, "maximal", NULL) == plugin2);
+	cp_release_info(ctx2, plugin2);
+	check(!strcmp(plugin2->identifier, "maximal"));
+	check(plugin2->num_extensions > 0 && plugin2->extensions[0].configuration != NULL);
+	cp_release_info(ctx2, plugin2);
+	
+	cp_destroy();
+	check(errors == 0);
+}
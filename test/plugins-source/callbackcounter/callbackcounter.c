@@ -76,6 +76,13 @@ static int run(void *d) {
 	return (data->counters->run < 3);
 }
 
+static int delayed_run(void *d) {
+	struct runtime_data *data = d;
+	
+	data->counters->delayed_run++;
+	return (data->counters->delayed_run < 3 ? CP_RUN_AFTER(2000) : 0);
+}
+
 static int start(void *d) {
 	struct runtime_data *data = d;
 	char **argv;
@@ -90,7 +97,8 @@ static int start(void *d) {
 	if (cp_define_symbol(data->ctx, "cbc_counters", data->counters) != CP_OK
 		|| cp_register_logger(data->ctx, logger, data, CP_LOG_WARNING) != CP_OK
 		|| cp_register_plistener(data->ctx, listener, data) != CP_OK
-		|| cp_run_function(data->ctx, run) != CP_OK) {
+		|| cp_run_function(data->ctx, run) != CP_OK
+		|| cp_run_function_after(data->ctx, delayed_run, 2000) != CP_OK) {
 		return CP_ERR_RUNTIME;
 	} else {
 		return CP_OK;
@@ -49,6 +49,9 @@ struct cbc_counters_t {
 	/** Call counter for the run function */
 	int run;
 	
+	/** Call counter for the delayed run function */
+	int delayed_run;
+	
 	/** Call counter for the stop function */
 	int stop;
 	
@@ -0,0 +1,54 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <cpluff.h>
+#include "slowstart.h"
+
+static void *create(cp_context_t *ctx) {
+	return ctx;
+}
+
+static int start(void *d) {
+	FILE *fh;
+	
+	// Block until the gate file has been read to its end
+	if ((fh = fopen(SS_GATE, "r")) != NULL) {
+		while (fgetc(fh) != EOF);
+		fclose(fh);
+	}
+	return CP_OK;
+}
+
+static void stop(void *d) {
+}
+
+static void destroy(void *d) {
+}
+
+CP_EXPORT cp_plugin_runtime_t ss_runtime = {
+	create,
+	start,
+	stop,
+	destroy
+};
@@ -45,7 +45,9 @@ static void *create(cp_context_t *ctx) {
 static int start(void *d) {
 	plugin_data_t *data = d;
 	
-	if ((data->str = malloc(sizeof(char) * 16)) == NULL) {
+	// The string is kept until destroy, beyond the stop functions of users
+	if (data->str == NULL
+		&& (data->str = malloc(sizeof(char) * 16)) == NULL) {
 		return CP_ERR_RESOURCE;
 	}
 	strcpy(data->str, "Provided string");
@@ -69,3 +71,18 @@ CP_EXPORT cp_plugin_runtime_t sp_runtime = {
 	NULL,
 	destroy
 };
+
+static const char static_string[] = "Exported string";
+
+static const char other_string[] = "Other exported string";
+
+static const cp_symbol_export_t sp_exports[] = {
+	{ "sp_other_string", (void *) other_string },
+	{ "sp_static_string", (void *) static_string }
+};
+
+CP_EXPORT cp_symbol_table_t sp_symbols = {
+	CP_SYMBOL_TABLE_VERSION,
+	sizeof(sp_exports) / sizeof(sp_exports[0]),
+	sp_exports
+};
@@ -21,8 +21,11 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *-----------------------------------------------------------------------*/
 
+#include <stdio.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "test.h"
 
 /*
@@ -179,3 +182,151 @@ void scanrestart(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+static void scanincremental_writepd(const char *plugin, const char *ver) {
+	char path[256];
+	FILE *f;
+	
+	snprintf(path, sizeof(path), "tmp" CP_FNAMESEP_STR "incremental" CP_FNAMESEP_STR "%s", plugin);
+	mkdir(path, 0777);
+	strcat(path, CP_FNAMESEP_STR "plugin.xml");
+	check((f = fopen(path, "w")) != NULL);
+	fprintf(f, "<plugin id=\"%s\" version=\"%s\"/>\n", plugin, ver);
+	check(!fclose(f));
+}
+
+void scanincremental(void) {
+	cp_context_t *ctx;
+	int errors;
+	
+	mkdir("tmp", 0777);
+	mkdir("tmp" CP_FNAMESEP_STR "incremental", 0777);
+	scanincremental_writepd("incr1", "1");
+	remove("tmp" CP_FNAMESEP_STR "incremental" CP_FNAMESEP_STR "incr2" CP_FNAMESEP_STR "plugin.xml");
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp" CP_FNAMESEP_STR "incremental") == CP_OK);
+	check(cp_scan_plugins(ctx, CP_SP_INCREMENTAL) == CP_OK);
+	check(cp_get_plugin_state(ctx, "incr1") == CP_PLUGIN_INSTALLED);
+	
+	// Unchanged plug-ins are not reinstalled by an incremental scan
+	check(cp_uninstall_plugin(ctx, "incr1") == CP_OK);
+	check(cp_scan_plugins(ctx, CP_SP_INCREMENTAL) == CP_OK);
+	check(cp_get_plugin_state(ctx, "incr1") == CP_PLUGIN_UNINSTALLED);
+	
+	// New plug-ins are installed
+	scanincremental_writepd("incr2", "1");
+	check(cp_scan_plugins(ctx, CP_SP_INCREMENTAL) == CP_OK);
+	check(cp_get_plugin_state(ctx, "incr1") == CP_PLUGIN_UNINSTALLED);
+	check(cp_get_plugin_state(ctx, "incr2") == CP_PLUGIN_INSTALLED);
+	
+	// Modified plug-ins are upgraded
+	scanincremental_writepd("incr2", "2.0");
+	check(cp_scan_plugins(ctx, CP_SP_INCREMENTAL | CP_SP_UPGRADE) == CP_OK);
+	check(cp_get_plugin_state(ctx, "incr1") == CP_PLUGIN_UNINSTALLED);
+	scanupgrade_checkpver(ctx, "incr2", "2.0");
+	
+	// A full scan considers all plug-ins
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "incr1") == CP_PLUGIN_INSTALLED);
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+static void scanversions_writepd(const char *dir, const char *plugin, const char *ver, const char *requires) {
+	char path[256];
+	FILE *f;
+	
+	snprintf(path, sizeof(path), "tmp" CP_FNAMESEP_STR "versions" CP_FNAMESEP_STR "%s", dir);
+	mkdir(path, 0777);
+	strcat(path, CP_FNAMESEP_STR "plugin.xml");
+	check((f = fopen(path, "w")) != NULL);
+	fprintf(f, "<plugin id=\"%s\" version=\"%s\">%s</plugin>\n", plugin, ver, requires);
+	check(!fclose(f));
+}
+
+void scanversions(void) {
+	cp_context_t *ctx;
+	int errors;
+	
+	mkdir("tmp", 0777);
+	mkdir("tmp" CP_FNAMESEP_STR "versions", 0777);
+	scanversions_writepd("a", "verp", "1.9", "");
+	scanversions_writepd("b", "verp", "1.10", "");
+	scanversions_writepd("c", "verp", "1.2b", "");
+	scanversions_writepd("d", "verimp", "1", "<requires><import plugin=\"verp\" version=\"01.010\"/></requires>");
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp" CP_FNAMESEP_STR "versions") == CP_OK);
+	
+	// Numeric components are compared numerically
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	scanupgrade_checkpver(ctx, "verp", "1.10");
+	
+	// Leading zeros do not matter when checking import versions
+	check(cp_start_plugin(ctx, "verimp") == CP_OK);
+	check(cp_get_plugin_state(ctx, "verp") == CP_PLUGIN_ACTIVE);
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+static void scanrestartaffected_writepd(const char *dir, const char *plugin, const char *ver, const char *requires) {
+	char path[256];
+	FILE *f;
+	
+	snprintf(path, sizeof(path), "tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "%s" CP_FNAMESEP_STR "plugin.xml", dir);
+	check((f = fopen(path, "w")) != NULL);
+	fprintf(f, "<plugin id=\"%s\" version=\"%s\">%s</plugin>\n", plugin, ver, requires);
+	check(!fclose(f));
+}
+
+static void scanrestartaffected_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	int *stops = user_data;
+	
+	if (!strcmp(plugin_id, "affother") && new_state == CP_PLUGIN_STOPPING) {
+		(*stops)++;
+	}
+}
+
+void scanrestartaffected(void) {
+	cp_context_t *ctx;
+	int errors;
+	int stops = 0;
+	
+	mkdir("tmp", 0777);
+	mkdir("tmp" CP_FNAMESEP_STR "affected", 0777);
+	remove("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "base2" CP_FNAMESEP_STR "plugin.xml");
+	remove("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "base2");
+	mkdir("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "base", 0777);
+	mkdir("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "user", 0777);
+	mkdir("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "indirect", 0777);
+	mkdir("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "idle", 0777);
+	mkdir("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "other", 0777);
+	scanrestartaffected_writepd("base", "affbase", "1", "");
+	scanrestartaffected_writepd("user", "affuser", "1", "<requires><import plugin=\"affbase\"/></requires>");
+	scanrestartaffected_writepd("indirect", "affindirect", "1", "<requires><import plugin=\"affuser\"/></requires>");
+	scanrestartaffected_writepd("idle", "affidle", "1", "<requires><import plugin=\"affbase\"/></requires>");
+	scanrestartaffected_writepd("other", "affother", "1", "");
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp" CP_FNAMESEP_STR "affected") == CP_OK);
+	check(cp_register_plistener(ctx, scanrestartaffected_listener, &stops) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_start_plugin(ctx, "affindirect") == CP_OK);
+	check(cp_start_plugin(ctx, "affother") == CP_OK);
+	check(cp_get_plugin_state(ctx, "affidle") == CP_PLUGIN_INSTALLED);
+	
+	// Only the upgraded plug-in and its active importers are restarted
+	mkdir("tmp" CP_FNAMESEP_STR "affected" CP_FNAMESEP_STR "base2", 0777);
+	scanrestartaffected_writepd("base2", "affbase", "2", "");
+	check(cp_scan_plugins(ctx, CP_SP_UPGRADE | CP_SP_RESTART_AFFECTED) == CP_OK);
+	scanupgrade_checkpver(ctx, "affbase", "2");
+	check(cp_get_plugin_state(ctx, "affbase") == CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "affuser") == CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "affindirect") == CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "affidle") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "affother") == CP_PLUGIN_ACTIVE);
+	check(stops == 0);
+	
+	cp_destroy();
+	check(errors == 0);
+}
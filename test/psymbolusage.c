@@ -49,3 +49,203 @@ void symbolusage(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+void symbolcache(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_memory_stats_t stats, stats2;
+	int errors, i;
+	const char *str, *str2;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Repeated resolutions return the same symbol
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check((str2 = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) == str && status == CP_OK);
+	check((str2 = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) == str && status == CP_OK);
+	
+	// Every resolution must be released exactly once
+	cp_release_symbol(ctx, str);
+	cp_release_symbol(ctx, str);
+	cp_release_symbol(ctx, str);
+	check(errors == 0);
+	cp_release_symbol(ctx, str);
+	check(errors == 1);
+	
+	// Resolving a symbol of a stopped plug-in starts the plug-in again
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check((str2 = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) == str && status == CP_OK);
+	check(cp_stop_plugin(ctx, "symuser") == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_RESOLVED);
+	check((str2 = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_ACTIVE);
+	check(strcmp(str2, "Provided string") == 0);
+	cp_release_symbol(ctx, str);
+	cp_release_symbol(ctx, str);
+	cp_release_symbol(ctx, str2);
+	check(errors == 1);
+	
+	// Replaced cache tables and entries are reclaimed
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check(cp_get_memory_stats(ctx, NULL, &stats) == CP_OK);
+	for (i = 0; i < 10; i++) {
+		cp_release_symbol(ctx, str);
+		check(cp_stop_plugin(ctx, "symuser") == CP_OK);
+		check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	}
+	check(cp_get_memory_stats(ctx, NULL, &stats2) == CP_OK);
+	check(stats2.resolved_symbols == stats.resolved_symbols);
+	check(stats2.resolved_symbol_bytes == stats.resolved_symbol_bytes);
+	cp_release_symbol(ctx, str);
+	check(errors == 1);
+
+	// Shutdown framework
+	cp_destroy();
+	check(errors == 1);
+}
+
+void symbolbatch(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	int errors;
+	const char *names[] = { "used_string", "used_string", "nonexisting" };
+	void *ptrs[3];
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Resolve several symbols at once
+	check(cp_resolve_symbols(ctx, "symuser", names, ptrs, 2, &status) == 2 && status == CP_OK);
+	check(ptrs[0] != NULL && ptrs[0] == ptrs[1]);
+	check(strcmp(ptrs[0], "Provided string") == 0);
+	cp_release_symbols(ctx, ptrs, 2);
+	check(errors == 0);
+	
+	// A failure resolves none of the symbols
+	check(cp_resolve_symbols(ctx, "symuser", names, ptrs, 3, &status) == 0 && status == CP_ERR_UNKNOWN);
+	check(ptrs[0] == NULL && ptrs[1] == NULL && ptrs[2] == NULL);
+	check(cp_resolve_symbols(ctx, "nonexisting", names, ptrs, 1, &status) == 0 && status == CP_ERR_UNKNOWN);
+	cp_release_symbols(ctx, ptrs, 3);
+	check(errors == 0);
+	
+	// The usages of the failed resolution have been rolled back
+	check(cp_resolve_symbols(ctx, "symuser", names, ptrs, 1, &status) == 1 && status == CP_OK);
+	cp_release_symbol(ctx, ptrs[0]);
+	check(errors == 0);
+	cp_release_symbol(ctx, ptrs[0]);
+	check(errors == 1);
+
+	// Shutdown framework
+	cp_destroy();
+	check(errors == 1);
+}
+
+void symboltable(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	const char *str;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Start the plug-ins via the symbol user
+	check(cp_start_plugin(ctx, "symuser") == CP_OK);
+	
+	// Symbols are resolved from the static export table
+	check((str = cp_resolve_symbol(ctx, "symprovider", "sp_static_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Exported string") == 0);
+	cp_release_symbol(ctx, str);
+	check((str = cp_resolve_symbol(ctx, "symprovider", "sp_other_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Other exported string") == 0);
+	cp_release_symbol(ctx, str);
+	
+	// Defined symbols and global symbols are still available
+	check((str = cp_resolve_symbol(ctx, "symprovider", "sp_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Provided string") == 0);
+	cp_release_symbol(ctx, str);
+	check((str = cp_resolve_symbol(ctx, "symprovider", "sp_runtime", &status)) != NULL && status == CP_OK);
+	cp_release_symbol(ctx, str);
+	check(errors == 0);
+	
+	// Shutdown framework
+	cp_destroy();
+	check(errors == 0);
+}
+
+void symbolkey(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_symbol_key_t key, key2;
+	const char *str, *str2;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Keys for the same name share the interned name
+	check(cp_symbol_key(ctx, "used_string", &key) == CP_OK);
+	check(cp_symbol_key(ctx, "used_string", &key2) == CP_OK);
+	check(key.name == key2.name && key.hash == key2.hash);
+	check(strcmp(key.name, "used_string") == 0);
+	
+	// Resolving by key and by name gives the same symbol
+	check((str = cp_resolve_symbol_by_key(ctx, "symuser", &key, &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Provided string") == 0);
+	check((str2 = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) == str && status == CP_OK);
+	check((str2 = cp_resolve_symbol_by_key(ctx, "symuser", &key2, &status)) == str && status == CP_OK);
+	cp_release_symbol(ctx, str);
+	cp_release_symbol(ctx, str);
+	cp_release_symbol(ctx, str);
+	check(errors == 0);
+	
+	// Unknown symbols fail by key, too
+	check(cp_symbol_key(ctx, "nonexisting", &key) == CP_OK);
+	check(cp_resolve_symbol_by_key(ctx, "symuser", &key, &status) == NULL && status == CP_ERR_UNKNOWN);
+	check(errors == 0);
+	
+	// Shutdown framework
+	cp_destroy();
+	check(errors == 0);
+}
+
+void symbollazy(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	const char *str;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	cp_set_lazy_activation(ctx, 1);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Starting all plug-ins leaves lazy plug-ins installed
+	check(cp_start_plugins_parallel(ctx, NULL, 1) == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "symprovider") == CP_PLUGIN_INSTALLED);
+	
+	// Starting a plug-in only resolves its lazy imports
+	check(cp_start_plugin(ctx, "symprovider") == CP_OK);
+	check(cp_get_plugin_state(ctx, "symprovider") == CP_PLUGIN_ACTIVE);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_RESOLVED);
+	
+	// The import is started on first symbol resolution
+	check((str = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Provided string") == 0);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_ACTIVE);
+	cp_release_symbol(ctx, str);
+	
+	// Stopping the import also stops the importing plug-in
+	check(cp_stop_plugin(ctx, "symuser") == CP_OK);
+	check(cp_get_plugin_state(ctx, "symprovider") == CP_PLUGIN_RESOLVED);
+	
+	// Shutdown framework
+	cp_destroy();
+	check(errors == 0);
+}
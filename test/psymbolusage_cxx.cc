@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <utility>
+#include <cpluffxx.h>
+#include "test_cxx.h"
+
+extern "C" void symbolref_cxx(void) {
+	cpluff::symbol_ref<const char> ref;
+	
+	// An empty reference has no symbol
+	check(ref.empty());
+	check(ref.get() == NULL);
+	ref.release();
+	check(ref.empty());
+	
+	// Moving an empty reference gives an empty reference
+	cpluff::symbol_ref<const char> ref2(std::move(ref));
+	check(ref2.empty() && ref.empty());
+	ref = std::move(ref2);
+	check(ref.empty() && ref2.empty());
+	
+	// Function types give function pointers
+	cpluff::symbol_ref<int (int)> func;
+	check(func.get() == NULL);
+}